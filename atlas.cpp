@@ -0,0 +1,285 @@
+#include "atlas.h"
+#include "host_parallel.h"
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+bool Atlas_Packer::init(size_t __page_width, size_t __page_height, size_t __page_slices, size_t __max_pages, size_t __align)
+{
+    m_pages.clear();
+    m_arrays.clear();
+    m_live = 0;
+    if (__page_width == 0 || __page_height == 0 || __page_slices == 0 || __align == 0 || __page_width > 0xffff || __page_height > 0xffff) {
+        std::cout << "Failed to init atlas packer, page sides must be 1 to 65535 and slices and alignment non-zero." << std::endl;
+        return false;
+    }
+    m_page_width = __page_width;
+    m_page_height = __page_height;
+    m_page_slices = __page_slices;
+    m_max_pages = __max_pages;
+    m_align = __align;
+    return true;
+}
+
+void Atlas_Packer::reset(Slice& slice) const
+{
+    slice.skyline.assign(1, Skyline_Node{ 0, 0, (uint32_t)m_page_width });
+    slice.live_rects = 0;
+    slice.live_texels = 0;
+}
+
+bool Atlas_Packer::find(const Slice& slice, uint32_t width, uint32_t height, size_t& node, uint32_t& y) const
+{
+    bool found = false;
+    uint32_t best_top = 0;
+    const std::vector<Skyline_Node>& nodes = slice.skyline;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].x + width > m_page_width)
+            break;
+        // The rectangle rests on the highest node it spans
+        uint32_t top = 0;
+        uint32_t covered = 0;
+        for (size_t j = i; covered < width; j++) {
+            top = nodes[j].y > top ? nodes[j].y : top;
+            covered += nodes[j].width;
+        }
+        if (top + height > m_page_height)
+            continue;
+        if (!found || top + height < best_top + height) {
+            found = true;
+            best_top = top;
+            node = i;
+        }
+    }
+    y = best_top;
+    return found;
+}
+
+void Atlas_Packer::place(Slice& slice, size_t node, uint32_t y, uint32_t width, uint32_t height)
+{
+    std::vector<Skyline_Node>& nodes = slice.skyline;
+    const uint32_t x = nodes[node].x;
+    nodes.insert(nodes.begin() + node, Skyline_Node{ x, y + height, width });
+    // Cut the nodes the rectangle now covers
+    for (size_t j = node + 1; j < nodes.size();) {
+        const uint32_t end = x + width;
+        if (nodes[j].x >= end)
+            break;
+        const uint32_t cut = end - nodes[j].x;
+        if (cut >= nodes[j].width) {
+            nodes.erase(nodes.begin() + j);
+            continue;
+        }
+        nodes[j].x += cut;
+        nodes[j].width -= cut;
+        break;
+    }
+    // Merge neighbours of the same height
+    for (size_t j = 0; j + 1 < nodes.size();) {
+        if (nodes[j].y == nodes[j + 1].y) {
+            nodes[j].width += nodes[j + 1].width;
+            nodes.erase(nodes.begin() + j + 1);
+        }
+        else {
+            j++;
+        }
+    }
+}
+
+void Atlas_Packer::free_rect(const Atlas_Rect& rect, uint64_t texels)
+{
+    Slice& slice = m_pages[rect.page][rect.slice];
+    slice.live_texels -= texels;
+    if (--slice.live_rects == 0)
+        reset(slice);
+}
+
+uint32_t Atlas_Packer::allocate(size_t channels, size_t height, size_t width)
+{
+    const size_t w = (width + m_align - 1) / m_align * m_align;
+    const size_t h = (height + m_align - 1) / m_align * m_align;
+    if (channels == 0 || height == 0 || width == 0 || w > m_page_width || h > m_page_height)
+        return atlas_invalid_id;
+
+    Array array;
+    array.height = height;
+    array.width = width;
+    const uint64_t texels = (uint64_t)w * h;
+    // Slices as they were before this array touched them and the pages there were, to undo a partial placement:
+    // freeing the rectangles again would leave the skylines raised and the pages it opened in place
+    std::vector<std::pair<Atlas_Rect, Slice>> touched;
+    const size_t pages = m_pages.size();
+    for (size_t c = 0; c < channels; c++) {
+        bool placed = false;
+        for (size_t p = 0; p <= m_pages.size() && !placed; p++) {
+            if (p == m_pages.size()) {
+                if (m_max_pages && p == m_max_pages)
+                    break;
+                m_pages.emplace_back(m_page_slices);
+                for (Slice& s : m_pages.back())
+                    reset(s);
+            }
+            for (size_t s = 0; s < m_page_slices && !placed; s++) {
+                Slice& slice = m_pages[p][s];
+                size_t node;
+                uint32_t y;
+                if (!find(slice, (uint32_t)w, (uint32_t)h, node, y))
+                    continue;
+                Atlas_Rect rect;
+                rect.page = (uint32_t)p;
+                rect.slice = (uint32_t)s;
+                bool saved = false;
+                for (const std::pair<Atlas_Rect, Slice>& t : touched)
+                    saved = saved || (t.first.page == rect.page && t.first.slice == rect.slice);
+                if (!saved && p < pages)
+                    touched.emplace_back(rect, slice);
+                rect.x = slice.skyline[node].x;
+                rect.y = y;
+                place(slice, node, y, (uint32_t)w, (uint32_t)h);
+                slice.live_rects++;
+                slice.live_texels += texels;
+                array.rects.push_back(rect);
+                placed = true;
+            }
+        }
+        if (!placed) {
+            for (const std::pair<Atlas_Rect, Slice>& t : touched)
+                m_pages[t.first.page][t.first.slice] = t.second;
+            m_pages.resize(pages);
+            return atlas_invalid_id;
+        }
+    }
+    array.live = true;
+    m_arrays.push_back(array);
+    m_live++;
+    return (uint32_t)(m_arrays.size() - 1);
+}
+
+void Atlas_Packer::release(uint32_t id)
+{
+    if (!live(id))
+        return;
+    Array& array = m_arrays[id];
+    const uint64_t texels = (uint64_t)((array.width + m_align - 1) / m_align * m_align) * ((array.height + m_align - 1) / m_align * m_align);
+    for (const Atlas_Rect& rect : array.rects)
+        free_rect(rect, texels);
+    array.rects.clear();
+    array.live = false;
+    m_live--;
+}
+
+size_t Atlas_Packer::used_slices(size_t page) const
+{
+    const std::vector<Slice>& slices = m_pages[page];
+    for (size_t s = slices.size(); s > 0; s--) {
+        if (slices[s - 1].live_rects)
+            return s;
+    }
+    return 0;
+}
+
+double Atlas_Packer::occupancy() const
+{
+    uint64_t live = 0;
+    uint64_t used = 0;
+    for (size_t p = 0; p < m_pages.size(); p++) {
+        for (const Slice& s : m_pages[p])
+            live += s.live_texels;
+        used += (uint64_t)used_slices(p) * m_page_width * m_page_height;
+    }
+    return used ? (double)live / used : 0.0;
+}
+
+void Atlas_Packer::tiles(const uint32_t* ids, size_t count, uint32_t tile_width, uint32_t tile_height,
+    std::vector<std::vector<Atlas_Tile>>& per_page) const
+{
+    per_page.assign(m_pages.size(), std::vector<Atlas_Tile>());
+    for (size_t i = 0; i < count; i++) {
+        if (!live(ids[i]))
+            continue;
+        const Array& array = m_arrays[ids[i]];
+        for (size_t c = 0; c < array.rects.size(); c++) {
+            const Atlas_Rect& rect = array.rects[c];
+            for (size_t h0 = 0; h0 < array.height; h0 += tile_height) {
+                for (size_t w0 = 0; w0 < array.width; w0 += tile_width) {
+                    const size_t tw = w0 + tile_width < array.width ? tile_width : array.width - w0;
+                    const size_t th = h0 + tile_height < array.height ? tile_height : array.height - h0;
+                    Atlas_Tile t;
+                    t.x = rect.x + (uint32_t)w0;
+                    t.y = rect.y + (uint32_t)h0;
+                    t.slice = rect.slice;
+                    t.array = (uint32_t)i;
+                    t.channel = (uint32_t)c;
+                    t.h0 = (uint32_t)h0;
+                    t.w0 = (uint32_t)w0;
+                    t.extent = (uint32_t)(tw | th << 16);
+                    per_page[rect.page].push_back(t);
+                }
+            }
+        }
+    }
+}
+
+void Atlas_Storage::init(size_t __element_size)
+{
+    element_size = __element_size;
+    pages.clear();
+    dirty_slices.clear();
+}
+
+void Atlas_Storage::sync(const Atlas_Packer& packer)
+{
+    const size_t page_bytes = packer.page_slices() * packer.page_height() * packer.page_width() * element_size;
+    while (pages.size() < packer.page_count()) {
+        pages.emplace_back(page_bytes, 0);
+        dirty_slices.push_back(0);
+    }
+}
+
+void Atlas_Storage::write(const Atlas_Packer& packer, uint32_t id, const void* chw)
+{
+    sync(packer);
+    const size_t row = packer.width(id) * element_size;
+    const unsigned char* src = (const unsigned char*)chw;
+    const std::vector<Atlas_Rect>& rects = packer.rects(id);
+    for (const Atlas_Rect& r : rects) {
+        for (size_t y = 0; y < packer.height(id); y++, src += row)
+            memcpy(element(packer, r.page, r.slice, r.y + y, r.x), src, row);
+        if (dirty_slices[r.page] < r.slice + 1)
+            dirty_slices[r.page] = r.slice + 1;
+    }
+}
+
+void Atlas_Storage::read(const Atlas_Packer& packer, uint32_t id, void* chw) const
+{
+    const size_t row = packer.width(id) * element_size;
+    unsigned char* dst = (unsigned char*)chw;
+    for (const Atlas_Rect& r : packer.rects(id)) {
+        for (size_t y = 0; y < packer.height(id); y++, dst += row) {
+            const size_t offset = ((r.slice * packer.page_height() + r.y + y) * packer.page_width() + r.x) * element_size;
+            memcpy(dst, pages[r.page].data() + offset, row);
+        }
+    }
+}
+
+size_t Atlas_Storage::take_dirty(size_t page)
+{
+    const size_t dirty = dirty_slices[page];
+    dirty_slices[page] = 0;
+    return dirty;
+}
+
+void run_atlas_tiles(const std::vector<Atlas_Tile>& tiles, const std::function<void(const Atlas_Tile&, uint32_t, uint32_t)>& fn,
+    size_t threads)
+{
+    parallel_for(tiles.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const Atlas_Tile& t = tiles[i];
+            const uint32_t tw = t.extent & 0xffff;
+            const uint32_t th = t.extent >> 16;
+            for (uint32_t dy = 0; dy < th; dy++)
+                for (uint32_t dx = 0; dx < tw; dx++)
+                    fn(t, dx, dy);
+        }
+    }, threads);
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+ * Packing of many small (channels, height, width) arrays into a few large physical
+ * texture arrays ("pages" of page_slices slices of page_height x page_width), so
+ * thousands of arrays cost a handful of textures, views and staging copies instead
+ * of one set each. Every channel of an array is a rectangle in one slice of one page,
+ * placed by a skyline bottom-left packer per slice; slices and then pages are tried
+ * in order, so a page fills from its leading slices and transfers of the leading
+ * slices cover everything written. A slice's space is reclaimed when every rectangle
+ * in it is released.
+ *
+ * A packer is a layout, not storage: several atlases (inputs and outputs of a kernel)
+ * can share one, so the same coordinates address an array in all of them. Work over a
+ * batch of arrays is a list of Atlas_Tile, one per tile_width x tile_height block of
+ * each rectangle; the device runs one thread group per tile in a single dispatch per
+ * page (the offset table), and run_atlas_tiles() runs the same list on the host.
+ * Host-only, no D3D dependency (see d3d11_atlas.h for the device side).
+ */
+static const uint32_t atlas_invalid_id = 0xffffffffu;
+
+// Where one channel of an array lives
+struct Atlas_Rect
+{
+    uint32_t page = 0;
+    uint32_t slice = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+};
+
+// One thread group's block, laid out as atlas.hlsl reads it (32 bytes)
+struct Atlas_Tile
+{
+    uint32_t x;         // Block origin in the page
+    uint32_t y;
+    uint32_t slice;
+    uint32_t array;     // Position of the array in the batch
+    uint32_t channel;
+    uint32_t h0;        // Block origin in the logical array
+    uint32_t w0;
+    uint32_t extent;    // Block width | height << 16, clipped to the array
+};
+
+class Atlas_Packer
+{
+public:
+    // align rounds rectangles up to multiples of it (e.g. the kernel tile, so blocks never share a group).
+    // max_pages = 0 grows without limit.
+    bool init(size_t __page_width, size_t __page_height, size_t __page_slices, size_t __max_pages = 0, size_t __align = 1);
+    // Place every channel of a channels x height x width array; atlas_invalid_id if a channel is larger
+    // than a page or the pages ran out (the packer is left as it was then)
+    uint32_t allocate(size_t channels, size_t height, size_t width);
+    void release(uint32_t id);
+
+    bool live(uint32_t id) const
+    {
+        return id < m_arrays.size() && m_arrays[id].live;
+    }
+    const std::vector<Atlas_Rect>& rects(uint32_t id) const
+    {
+        return m_arrays[id].rects;
+    }
+    size_t channels(uint32_t id) const
+    {
+        return m_arrays[id].rects.size();
+    }
+    size_t height(uint32_t id) const
+    {
+        return m_arrays[id].height;
+    }
+    size_t width(uint32_t id) const
+    {
+        return m_arrays[id].width;
+    }
+    size_t page_width() const
+    {
+        return m_page_width;
+    }
+    size_t page_height() const
+    {
+        return m_page_height;
+    }
+    size_t page_slices() const
+    {
+        return m_page_slices;
+    }
+    size_t page_count() const
+    {
+        return m_pages.size();
+    }
+    // Ids issued so far, live or released
+    size_t array_count() const
+    {
+        return m_arrays.size();
+    }
+    size_t live_arrays() const
+    {
+        return m_live;
+    }
+    // Slices of a page up to the last one holding a rectangle, what a transfer of the page has to cover
+    size_t used_slices(size_t page) const;
+    // Live rectangle texels over the texels of the used slices
+    double occupancy() const;
+    // Tiles of the live arrays in ids, one list per page (pages without any are empty);
+    // Atlas_Tile::array is the position in ids
+    void tiles(const uint32_t* ids, size_t count, uint32_t tile_width, uint32_t tile_height,
+        std::vector<std::vector<Atlas_Tile>>& per_page) const;
+private:
+    struct Skyline_Node
+    {
+        uint32_t x;
+        uint32_t y;         // Height of the skyline over [x, x + width)
+        uint32_t width;
+    };
+    struct Slice
+    {
+        std::vector<Skyline_Node> skyline;
+        size_t live_rects = 0;
+        uint64_t live_texels = 0;
+    };
+    struct Array
+    {
+        std::vector<Atlas_Rect> rects;
+        size_t height = 0;
+        size_t width = 0;
+        bool live = false;
+    };
+
+    void reset(Slice& slice) const;
+    // Lowest top edge a width x height rectangle can have on the slice, false if none fits
+    bool find(const Slice& slice, uint32_t width, uint32_t height, size_t& node, uint32_t& y) const;
+    void place(Slice& slice, size_t node, uint32_t y, uint32_t width, uint32_t height);
+    void free_rect(const Atlas_Rect& rect, uint64_t texels);
+
+    size_t m_page_width = 0;
+    size_t m_page_height = 0;
+    size_t m_page_slices = 0;
+    size_t m_max_pages = 0;
+    size_t m_align = 1;
+    size_t m_live = 0;
+    std::vector<std::vector<Slice>> m_pages;
+    std::vector<Array> m_arrays;
+};
+
+/*
+ * Host copy of the pages of one atlas: the host backing of an atlas, or the shadow the
+ * device side stages batched transfers through. Pages are slices x height x width
+ * elements; write() tracks how many leading slices of each page changed since
+ * take_dirty().
+ */
+struct Atlas_Storage
+{
+    size_t element_size = 0;
+    std::vector<std::vector<unsigned char>> pages;
+    std::vector<size_t> dirty_slices;
+
+    void init(size_t __element_size);
+    // Add storage for pages the packer opened since the last call
+    void sync(const Atlas_Packer& packer);
+    // Dense CHW host array into the array's rectangles, and back
+    void write(const Atlas_Packer& packer, uint32_t id, const void* chw);
+    void read(const Atlas_Packer& packer, uint32_t id, void* chw) const;
+    unsigned char* element(const Atlas_Packer& packer, size_t page, size_t slice, size_t y, size_t x)
+    {
+        return pages[page].data() + ((slice * packer.page_height() + y) * packer.page_width() + x) * element_size;
+    }
+    // Leading slices of a page written since the last call, 0 if it is clean
+    size_t take_dirty(size_t page);
+};
+
+// The host side of a batched dispatch: fn(tile, dx, dy) for every element (x + dx, y + dy) of every tile
+void run_atlas_tiles(const std::vector<Atlas_Tile>& tiles, const std::function<void(const Atlas_Tile&, uint32_t, uint32_t)>& fn,
+    size_t threads = 0);
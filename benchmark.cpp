@@ -0,0 +1,502 @@
+#include "benchmark.h"
+#include "host_parallel.h"
+#include "layout_transform.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+struct Benchmark_Format
+{
+    const char* name;
+    uint32_t dxgi_format;
+    size_t element_size;
+};
+
+// DXGI_FORMAT values, spelled out so the host side needs no D3D headers
+static const Benchmark_Format benchmark_formats[] = {
+    { "R8_UNORM", 61, 1 },
+    { "R8_UINT", 62, 1 },
+    { "R16_FLOAT", 54, 2 },
+    { "R16_UNORM", 56, 2 },
+    { "R32_FLOAT", 41, 4 },
+    { "R32_UINT", 42, 4 },
+};
+
+bool benchmark_format(const std::string& name, uint32_t& dxgi_format, size_t& element_size)
+{
+    for (const Benchmark_Format& f : benchmark_formats) {
+        if (name == f.name) {
+            dxgi_format = f.dxgi_format;
+            element_size = f.element_size;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string Benchmark_Case::define(const char* name, const char* fallback) const
+{
+    for (const std::pair<std::string, std::string>& d : defines) {
+        if (d.first == name)
+            return d.second;
+    }
+    return fallback;
+}
+
+std::string Benchmark_Case::label() const
+{
+    std::ostringstream out;
+    out << workload << "/" << kernel << "/" << format << "/" << channels << "x" << height << "x" << width;
+    for (const std::pair<std::string, std::string>& d : defines)
+        out << "/" << d.first << "=" << d.second;
+    return out.str();
+}
+
+uint64_t benchmark_case_bytes(const Benchmark_Case& c)
+{
+    const uint64_t array_bytes = (uint64_t)c.elements() * c.element_size;
+    uint64_t per_instance = 0;
+    if (c.kernel == "upload" || c.kernel == "download")
+        per_instance = array_bytes;
+    else if (c.kernel == "array_sum")
+        per_instance = 3 * array_bytes;
+    else if (c.kernel == "hwc_to_chw")
+        per_instance = 2 * array_bytes;
+    return per_instance * c.concurrency;
+}
+
+static bool known_kernel(const std::string& kernel)
+{
+    return kernel == "upload" || kernel == "download" || kernel == "array_sum" || kernel == "hwc_to_chw";
+}
+
+// A non-negative integer member, fallback if absent
+static bool read_count(const Json_Value& object, const char* key, size_t& value, std::string& error)
+{
+    const Json_Value* v = object.find(key);
+    if (v == nullptr)
+        return true;
+    if (v->type != JSON_NUMBER || v->number < 0.0 || v->number != std::floor(v->number)) {
+        error = std::string("\"") + key + "\" must be a non-negative integer";
+        return false;
+    }
+    value = (size_t)v->number;
+    return true;
+}
+
+// Run settings of an object (the defaults or a workload) applied over c
+static bool read_settings(const Json_Value& object, Benchmark_Case& c, std::string& error)
+{
+    if (!read_count(object, "warmup", c.warmup, error) || !read_count(object, "iterations", c.iterations, error)
+        || !read_count(object, "concurrency", c.concurrency, error))
+        return false;
+    c.outlier_k = object.get_number("outlier_k", c.outlier_k);
+    if (c.iterations == 0 || c.concurrency == 0) {
+        error = "\"iterations\" and \"concurrency\" must be at least 1";
+        return false;
+    }
+    return true;
+}
+
+bool parse_benchmark_workload(const Json_Value& root, std::vector<Benchmark_Case>& cases, std::string& error)
+{
+    cases.clear();
+    Benchmark_Case defaults;
+    if (root.type != JSON_OBJECT) {
+        error = "workload description must be an object";
+        return false;
+    }
+    if (const Json_Value* d = root.find("defaults")) {
+        if (!read_settings(*d, defaults, error))
+            return false;
+    }
+    const Json_Value* workloads = root.find("workloads");
+    if (workloads == nullptr || workloads->type != JSON_ARRAY) {
+        error = "\"workloads\" must be an array";
+        return false;
+    }
+
+    for (size_t w = 0; w < workloads->array.size(); w++) {
+        const Json_Value& desc = workloads->array[w];
+        Benchmark_Case base = defaults;
+        base.kernel = desc.get_string("kernel", "");
+        base.workload = desc.get_string("name", base.kernel.c_str());
+        const std::string where = "workload " + std::to_string(w) + " (" + base.workload + "): ";
+        if (!known_kernel(base.kernel)) {
+            error = where + "unknown kernel \"" + base.kernel + "\"";
+            return false;
+        }
+        if (!read_settings(desc, base, error)) {
+            error = where + error;
+            return false;
+        }
+
+        const Json_Value* formats = desc.find("formats");
+        const Json_Value* shapes = desc.find("shapes");
+        if (formats == nullptr || formats->type != JSON_ARRAY || formats->array.empty() || shapes == nullptr
+            || shapes->type != JSON_ARRAY || shapes->array.empty()) {
+            error = where + "\"formats\" and \"shapes\" must be non-empty arrays";
+            return false;
+        }
+        // No define sets is one empty set
+        std::vector<std::vector<std::pair<std::string, std::string>>> define_sets;
+        if (const Json_Value* defines = desc.find("defines")) {
+            if (defines->type != JSON_ARRAY) {
+                error = where + "\"defines\" must be an array of objects";
+                return false;
+            }
+            for (const Json_Value& set : defines->array) {
+                if (set.type != JSON_OBJECT) {
+                    error = where + "\"defines\" must be an array of objects";
+                    return false;
+                }
+                define_sets.emplace_back();
+                for (const std::pair<std::string, Json_Value>& d : set.object)
+                    define_sets.back().push_back({ d.first, d.second.as_text() });
+            }
+        }
+        if (define_sets.empty())
+            define_sets.emplace_back();
+
+        for (const Json_Value& format : formats->array) {
+            Benchmark_Case with_format = base;
+            with_format.format = format.as_text();
+            if (!benchmark_format(with_format.format, with_format.dxgi_format, with_format.element_size)) {
+                error = where + "unknown format \"" + with_format.format + "\"";
+                return false;
+            }
+            for (const Json_Value& shape : shapes->array) {
+                if (shape.type != JSON_ARRAY || shape.array.size() != 3) {
+                    error = where + "shapes are [channels, height, width]";
+                    return false;
+                }
+                size_t dims[3];
+                for (size_t i = 0; i < 3; i++) {
+                    const Json_Value& d = shape.array[i];
+                    if (d.type != JSON_NUMBER || d.number < 1.0 || d.number != std::floor(d.number)) {
+                        error = where + "shape dimensions must be positive integers";
+                        return false;
+                    }
+                    dims[i] = (size_t)d.number;
+                }
+                for (const std::vector<std::pair<std::string, std::string>>& defines : define_sets) {
+                    Benchmark_Case c = with_format;
+                    c.channels = dims[0];
+                    c.height = dims[1];
+                    c.width = dims[2];
+                    c.defines = defines;
+                    cases.push_back(c);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool load_benchmark_workload(const char* path, std::vector<Benchmark_Case>& cases, std::string& error)
+{
+    Json_Value root;
+    if (!json_parse_file(path, root, error))
+        return false;
+    if (!parse_benchmark_workload(root, cases, error)) {
+        error = std::string(path) + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+double student_t_95(size_t df)
+{
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (df == 0)
+        return 0.0;
+    if (df <= sizeof(table) / sizeof(table[0]))
+        return table[df - 1];
+    // Cornish-Fisher expansion around the normal quantile, within 0.001 of the exact value past 30
+    const double z = 1.959964;
+    const double n = (double)df;
+    return z + (z * z * z + z) / (4.0 * n) + (5.0 * std::pow(z, 5) + 16.0 * z * z * z + 3.0 * z) / (96.0 * n * n);
+}
+
+// Linear interpolation between closest ranks of sorted samples, q in [0, 1]
+static double quantile(const std::vector<double>& sorted, double q)
+{
+    const double rank = q * (sorted.size() - 1);
+    const size_t below = (size_t)rank;
+    if (below + 1 >= sorted.size())
+        return sorted.back();
+    return sorted[below] + (rank - below) * (sorted[below + 1] - sorted[below]);
+}
+
+Sample_Stats summarize_samples(const std::vector<double>& samples, double outlier_k)
+{
+    Sample_Stats s;
+    s.samples = samples.size();
+    if (samples.empty())
+        return s;
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    // Tukey fences: robust to the outliers themselves, unlike a cut at a number of standard deviations
+    std::vector<double> kept;
+    if (outlier_k > 0.0 && sorted.size() >= 4) {
+        const double q1 = quantile(sorted, 0.25);
+        const double q3 = quantile(sorted, 0.75);
+        const double low = q1 - outlier_k * (q3 - q1);
+        const double high = q3 + outlier_k * (q3 - q1);
+        for (double v : sorted) {
+            if (v >= low && v <= high)
+                kept.push_back(v);
+        }
+    }
+    else {
+        kept = sorted;
+    }
+    s.kept = kept.size();
+    s.outliers = s.samples - s.kept;
+
+    double sum = 0.0;
+    for (double v : kept)
+        sum += v;
+    s.mean = sum / kept.size();
+    double squares = 0.0;
+    for (double v : kept)
+        squares += (v - s.mean) * (v - s.mean);
+    s.stddev = kept.size() > 1 ? std::sqrt(squares / (kept.size() - 1)) : 0.0;
+    s.median = quantile(kept, 0.5);
+    s.min = kept.front();
+    s.max = kept.back();
+    const double half = student_t_95(kept.size() - 1) * s.stddev / std::sqrt((double)kept.size());
+    s.ci_low = s.mean - half;
+    s.ci_high = s.mean + half;
+    return s;
+}
+
+Benchmark_Result run_benchmark_case(const Benchmark_Case& c, Benchmark_Backend& backend)
+{
+    Benchmark_Result r;
+    r.c = c;
+    r.backend = backend.name();
+    if (!backend.prepare(c, r.reason)) {
+        r.status = "skipped";
+        backend.finish_case();
+        return r;
+    }
+    r.status = "ok";
+    for (size_t i = 0; i < c.warmup + c.iterations; i++) {
+        const double ms = backend.run(c);
+        if (ms < 0.0) {
+            r.status = "failed";
+            r.reason = "iteration " + std::to_string(i) + " failed";
+            break;
+        }
+        if (i >= c.warmup)
+            r.samples.push_back(ms);
+    }
+    backend.finish_case();
+    r.stats = summarize_samples(r.samples, c.outlier_k);
+    if (r.stats.median > 0.0)
+        r.gbs = benchmark_case_bytes(c) / (r.stats.median * 1e6);
+    return r;
+}
+
+std::vector<Benchmark_Result> run_benchmarks(const std::vector<Benchmark_Case>& cases, Benchmark_Backend& backend, bool verbose)
+{
+    std::vector<Benchmark_Result> results;
+    for (const Benchmark_Case& c : cases) {
+        results.push_back(run_benchmark_case(c, backend));
+        if (!verbose)
+            continue;
+        const Benchmark_Result& r = results.back();
+        std::cerr << c.label() << ": ";
+        if (r.status != "ok") {
+            std::cerr << r.status << " (" << r.reason << ")" << std::endl;
+            continue;
+        }
+        std::cerr << std::fixed << std::setprecision(4) << r.stats.median << " ms median, " << r.stats.mean << " +/- "
+            << (r.stats.ci_high - r.stats.mean) << " ms mean, " << std::setprecision(2) << r.gbs << " GB/s, " << r.stats.outliers
+            << " of " << r.stats.samples << " samples rejected" << std::endl;
+        std::cerr.unsetf(std::ios::floatfield);
+    }
+    return results;
+}
+
+// Shortest round-tripping text; NaN and infinities have no JSON spelling
+static std::string number(double v)
+{
+    if (!std::isfinite(v))
+        return "null";
+    std::ostringstream out;
+    out << std::setprecision(9) << v;
+    return out.str();
+}
+
+std::string benchmark_results_json(const std::vector<Benchmark_Result>& results)
+{
+    std::ostringstream out;
+    out << "{\"results\":[";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Benchmark_Result& r = results[i];
+        const Benchmark_Case& c = r.c;
+        const Sample_Stats& s = r.stats;
+        out << (i ? "," : "") << "\n{\"workload\":" << json_quote(c.workload) << ",\"kernel\":" << json_quote(c.kernel)
+            << ",\"format\":" << json_quote(c.format) << ",\"shape\":[" << c.channels << "," << c.height << "," << c.width
+            << "],\"defines\":{";
+        for (size_t d = 0; d < c.defines.size(); d++)
+            out << (d ? "," : "") << json_quote(c.defines[d].first) << ":" << json_quote(c.defines[d].second);
+        out << "},\"backend\":" << json_quote(r.backend) << ",\"warmup\":" << c.warmup << ",\"iterations\":" << c.iterations
+            << ",\"concurrency\":" << c.concurrency << ",\"status\":" << json_quote(r.status);
+        if (!r.reason.empty())
+            out << ",\"reason\":" << json_quote(r.reason);
+        out << ",\"bytes\":" << benchmark_case_bytes(c);
+        if (r.status == "ok") {
+            out << ",\"ms\":{\"mean\":" << number(s.mean) << ",\"median\":" << number(s.median) << ",\"stddev\":" << number(s.stddev)
+                << ",\"min\":" << number(s.min) << ",\"max\":" << number(s.max) << ",\"ci95\":[" << number(s.ci_low) << ","
+                << number(s.ci_high) << "]},\"kept\":" << s.kept << ",\"outliers\":" << s.outliers << ",\"gbs\":" << number(r.gbs);
+        }
+        out << ",\"samples\":[";
+        for (size_t j = 0; j < r.samples.size(); j++)
+            out << (j ? "," : "") << number(r.samples[j]);
+        out << "]}";
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+bool save_benchmark_results(const char* path, const std::vector<Benchmark_Result>& results)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cout << "Failed to open benchmark results file " << path << std::endl;
+        return false;
+    }
+    file << benchmark_results_json(results);
+    return (bool)file;
+}
+
+const char* Host_Benchmark_Backend::name() const
+{
+    return "host";
+}
+
+bool Host_Benchmark_Backend::prepare(const Benchmark_Case& c, std::string& reason)
+{
+    if (c.kernel == "array_sum" && c.format != "R32_FLOAT") {
+        reason = "host array_sum takes R32_FLOAT";
+        return false;
+    }
+    const size_t bytes = c.elements() * c.element_size;
+    m_instances.assign(c.concurrency, Instance());
+    uint32_t seed = 1;
+    for (Instance& instance : m_instances) {
+        instance.input_0.resize(bytes);
+        instance.output.resize(bytes);
+        if (c.kernel == "array_sum")
+            instance.input_1.resize(bytes);
+        // Float patterns stay finite and small whatever the element size
+        for (size_t i = 0; i < bytes; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            instance.input_0[i] = (unsigned char)((seed >> 24) & 0x3f);
+        }
+        if (c.kernel == "array_sum")
+            instance.input_1 = instance.input_0;
+    }
+    return true;
+}
+
+double Host_Benchmark_Backend::run(const Benchmark_Case& c)
+{
+    const size_t bytes = c.elements() * c.element_size;
+    const float bias = (float)(std::atof(c.define("THREAD_GROUP_SIZE_X", "0").c_str()) + std::atof(c.define("THREAD_GROUP_SIZE_Y", "0").c_str())
+        + c.height + c.width);
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    parallel_for(m_instances.size(), [&](size_t begin, size_t end) {
+        for (size_t n = begin; n < end; n++) {
+            Instance& instance = m_instances[n];
+            if (c.kernel == "upload") {
+                memcpy(instance.output.data(), instance.input_0.data(), bytes);
+            }
+            else if (c.kernel == "download") {
+                memcpy(instance.input_0.data(), instance.output.data(), bytes);
+            }
+            else if (c.kernel == "array_sum") {
+                const float* a = (const float*)instance.input_0.data();
+                const float* b = (const float*)instance.input_1.data();
+                float* out = (float*)instance.output.data();
+                for (size_t i = 0; i < c.elements(); i++)
+                    out[i] = a[i] + b[i] + bias;
+            }
+            else {
+                hwc_to_chw(instance.input_0.data(), instance.output.data(), c.channels, c.height, c.width, c.element_size, 1);
+            }
+        }
+    }, m_instances.size());
+    std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+void Host_Benchmark_Backend::finish_case()
+{
+    m_instances.clear();
+}
+
+bool parse_benchmark_options(int argc, char* argv[], Benchmark_Options& options, std::string& error)
+{
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--workload" && has_value) {
+            options.workload = argv[++i];
+        }
+        else if (arg == "--output" && has_value) {
+            options.output = argv[++i];
+        }
+        else if (arg == "--device" && has_value) {
+            options.device_index = std::atoi(argv[++i]);
+        }
+        else if (arg == "--host") {
+            options.host = true;
+        }
+        else if (!arg.empty() && arg.find_first_not_of("0123456789") == std::string::npos) {
+            // Bare device index, the original command line
+            options.device_index = std::atoi(arg.c_str());
+        }
+        else {
+            error = "unknown or incomplete argument " + arg;
+            return false;
+        }
+    }
+    return true;
+}
+
+int run_benchmark_driver(const Benchmark_Options& options, Benchmark_Backend& backend)
+{
+    std::vector<Benchmark_Case> cases;
+    std::string error;
+    if (!load_benchmark_workload(options.workload.c_str(), cases, error)) {
+        std::cout << "Failed to load benchmark workload: " << error << std::endl;
+        return 1;
+    }
+    const std::vector<Benchmark_Result> results = run_benchmarks(cases, backend);
+    if (options.output == "-")
+        std::cout << benchmark_results_json(results);
+    else if (save_benchmark_results(options.output.c_str(), results))
+        std::cout << "Benchmark results written to " << options.output << std::endl;
+    else
+        return 1;
+    for (const Benchmark_Result& r : results) {
+        if (r.status == "failed")
+            return 1;
+    }
+    return 0;
+}
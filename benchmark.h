@@ -0,0 +1,159 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "json.h"
+
+/*
+ * Benchmark driver: a JSON workload description expands into cases (every format x
+ * shape x define set of each workload), each case runs warm-up iterations that are
+ * discarded and then timed iterations on a Benchmark_Backend, and the samples are
+ * summarized with outliers rejected by Tukey fences and a Student-t confidence
+ * interval on the mean. Results are written as JSON, one object per case.
+ *
+ *   {
+ *     "defaults": { "warmup": 3, "iterations": 30, "concurrency": 1, "outlier_k": 1.5 },
+ *     "workloads": [
+ *       { "name": "sum", "kernel": "array_sum", "formats": ["R32_FLOAT"],
+ *         "shapes": [[2, 200, 300], [3, 1080, 1920]],
+ *         "defines": [{ "THREAD_GROUP_SIZE_X": 9, "THREAD_GROUP_SIZE_Y": 7 }],
+ *         "iterations": 50 }
+ *     ]
+ *   }
+ *
+ * Shapes are [channels, height, width]. Kernels: "upload" and "download" (whole-array
+ * transfers), "array_sum" (shaders/array_sum.hlsl, float formats) and "hwc_to_chw"
+ * (layout_transform.h). Concurrency is the number of independent instances of the case
+ * per iteration, each on its own arrays: the host backend runs them on that many threads,
+ * the device backend issues them back to back and lets the GPU overlap them; the bytes
+ * the case is credited with scale with it.
+ * Host-only, no D3D dependency (see d3d11_benchmark.h for the device side).
+ */
+struct Benchmark_Case
+{
+    std::string workload;
+    std::string kernel;
+    std::string format;                 // DXGI name without the prefix, "R32_FLOAT"
+    uint32_t dxgi_format = 0;           // DXGI_FORMAT value, stored as a plain number
+    size_t element_size = 0;
+    size_t channels = 0;
+    size_t height = 0;
+    size_t width = 0;
+    std::vector<std::pair<std::string, std::string>> defines;
+    size_t warmup = 3;
+    size_t iterations = 30;
+    size_t concurrency = 1;
+    double outlier_k = 1.5;             // Tukey fence multiplier, 0 keeps every sample
+
+    size_t elements() const
+    {
+        return channels * height * width;
+    }
+    // Value of a define, fallback if it is not set
+    std::string define(const char* name, const char* fallback = "") const;
+    // "workload/kernel/format/CxHxW[/NAME=value...]", for logs
+    std::string label() const;
+};
+
+// Bytes one iteration reads and writes, all instances together
+uint64_t benchmark_case_bytes(const Benchmark_Case& c);
+
+// Formats a workload may name, with their DXGI value and element size; false if unknown
+bool benchmark_format(const std::string& name, uint32_t& dxgi_format, size_t& element_size);
+
+// Workloads expanded into cases; false with a message in error if the description is malformed
+bool parse_benchmark_workload(const Json_Value& root, std::vector<Benchmark_Case>& cases, std::string& error);
+bool load_benchmark_workload(const char* path, std::vector<Benchmark_Case>& cases, std::string& error);
+
+struct Sample_Stats
+{
+    size_t samples = 0;         // Timed samples, warm-up excluded
+    size_t kept = 0;            // Inside the fences
+    size_t outliers = 0;
+    double mean = 0.0;
+    double median = 0.0;
+    double stddev = 0.0;        // Sample standard deviation of the kept samples
+    double min = 0.0;
+    double max = 0.0;
+    double ci_low = 0.0;        // 95% confidence interval on the mean
+    double ci_high = 0.0;
+
+    // Half-width of the interval over the mean, the run's relative uncertainty
+    double ci_relative() const
+    {
+        return mean > 0.0 ? (ci_high - ci_low) * 0.5 / mean : 0.0;
+    }
+};
+
+// Two-sided 95% Student-t critical value for the degrees of freedom
+double student_t_95(size_t degrees_of_freedom);
+// Samples outside [Q1 - k * IQR, Q3 + k * IQR] are rejected before the rest is summarized (k <= 0 keeps all)
+Sample_Stats summarize_samples(const std::vector<double>& samples, double outlier_k);
+
+struct Benchmark_Backend
+{
+    virtual ~Benchmark_Backend() {}
+    virtual const char* name() const = 0;
+    // Allocate and compile what the case needs; false with a reason to skip a case the backend cannot run
+    virtual bool prepare(const Benchmark_Case& c, std::string& reason) = 0;
+    // One iteration of the prepared case in milliseconds, negative on failure
+    virtual double run(const Benchmark_Case& c) = 0;
+    // Free what prepare() allocated
+    virtual void finish_case() {}
+};
+
+struct Benchmark_Result
+{
+    Benchmark_Case c;
+    std::string backend;
+    std::string status;             // "ok", "skipped" (the backend cannot run the case) or "failed"
+    std::string reason;             // Why it is not "ok"
+    std::vector<double> samples;    // Timed iterations in ms, warm-up excluded
+    Sample_Stats stats;
+    double gbs = 0.0;               // benchmark_case_bytes() over the median
+};
+
+Benchmark_Result run_benchmark_case(const Benchmark_Case& c, Benchmark_Backend& backend);
+// Every case in order, with a line per case on stderr when verbose (stdout may carry the results)
+std::vector<Benchmark_Result> run_benchmarks(const std::vector<Benchmark_Case>& cases, Benchmark_Backend& backend, bool verbose = true);
+std::string benchmark_results_json(const std::vector<Benchmark_Result>& results);
+bool save_benchmark_results(const char* path, const std::vector<Benchmark_Result>& results);
+
+/*
+ * CPU backend: arrays are host vectors and the kernels are their host counterparts
+ * (memcpy for transfers, a float add for array_sum, hwc_to_chw), so a workload runs
+ * and is checked on machines without a GPU.
+ */
+class Host_Benchmark_Backend : public Benchmark_Backend
+{
+public:
+    const char* name() const override;
+    bool prepare(const Benchmark_Case& c, std::string& reason) override;
+    double run(const Benchmark_Case& c) override;
+    void finish_case() override;
+private:
+    struct Instance
+    {
+        std::vector<unsigned char> input_0;
+        std::vector<unsigned char> input_1;
+        std::vector<unsigned char> output;
+    };
+    std::vector<Instance> m_instances;
+};
+
+// Command line of the benchmark driver: --workload <json> [--output <json>] [--host] [--device <index>];
+// a bare number is the device index, as the test run takes it
+struct Benchmark_Options
+{
+    std::string workload;
+    std::string output = "benchmark_results.json";  // "-" for stdout
+    bool host = false;      // Run on the CPU backend instead of the device
+    int device_index = 0;
+};
+
+// False with a message in error for unknown or incomplete arguments; workload stays empty without --workload
+bool parse_benchmark_options(int argc, char* argv[], Benchmark_Options& options, std::string& error);
+// Load, run on the backend and write the results; the process exit code
+int run_benchmark_driver(const Benchmark_Options& options, Benchmark_Backend& backend);
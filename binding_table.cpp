@@ -0,0 +1,222 @@
+#include "binding_table.h"
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+
+static const char* kind_register(Binding_Kind kind)
+{
+    return kind == BINDING_SRV ? "t" : kind == BINDING_UAV ? "u" : "b";
+}
+
+bool Binding_Layout::init(const std::vector<Shader_Binding>& __bindings)
+{
+    bindings = __bindings;
+    std::sort(bindings.begin(), bindings.end(), [](const Shader_Binding& a, const Shader_Binding& b) {
+        return a.kind != b.kind ? a.kind < b.kind : a.slot < b.slot;
+    });
+    for (int k = 0; k < BINDING_KIND_COUNT; k++)
+        end[k] = 0;
+
+    for (size_t i = 0; i < bindings.size(); i++) {
+        const Shader_Binding& b = bindings[i];
+        if (b.count == 0 || b.slot + b.count > binding_slot_count[b.kind]) {
+            std::cout << "Failed to build binding layout. " << b.name << " : register(" << kind_register(b.kind) << b.slot
+                << ") with " << b.count << " slots is out of range." << std::endl;
+            bindings.clear();
+            return false;
+        }
+        if (b.slot < end[b.kind]) {
+            std::cout << "Failed to build binding layout. " << b.name << " : register(" << kind_register(b.kind) << b.slot
+                << ") overlaps " << bindings[i - 1].name << "." << std::endl;
+            bindings.clear();
+            return false;
+        }
+        end[b.kind] = b.slot + b.count;
+    }
+    return true;
+}
+
+int Binding_Layout::find(const char* name) const
+{
+    for (size_t i = 0; i < bindings.size(); i++)
+        if (bindings[i].name == name)
+            return (int)i;
+    return -1;
+}
+
+size_t Binding_Layout::slots() const
+{
+    size_t n = 0;
+    for (const Shader_Binding& b : bindings)
+        n += b.count;
+    return n;
+}
+
+bool Binding_Table::init(const void* __shader, const std::vector<Shader_Binding>& bindings)
+{
+    shader = __shader;
+    values.clear();
+    if (!layout.init(bindings))
+        return false;
+    values.resize(layout.slots());
+    return true;
+}
+
+bool Binding_Table::set(const char* name, const Binding_Value& value, unsigned int element)
+{
+    int index = layout.find(name);
+    if (index < 0 || element >= layout.bindings[index].count) {
+        std::cout << "Failed to set binding " << name << "[" << element << "], the shader does not declare it." << std::endl;
+        return false;
+    }
+    size_t first = 0;
+    for (int i = 0; i < index; i++)
+        first += layout.bindings[i].count;
+    values[first + element] = value;
+    return true;
+}
+
+bool Binding_Table::set(Binding_Kind kind, unsigned int slot, const Binding_Value& value)
+{
+    size_t first = 0;
+    for (const Shader_Binding& b : layout.bindings) {
+        if (b.kind == kind && slot >= b.slot && slot < b.slot + b.count) {
+            values[first + slot - b.slot] = value;
+            return true;
+        }
+        first += b.count;
+    }
+    std::cout << "Failed to set binding register(" << kind_register(kind) << slot << "), the shader does not declare it." << std::endl;
+    return false;
+}
+
+bool Binding_Table::complete() const
+{
+    for (const Binding_Value& v : values)
+        if (v.view == nullptr)
+            return false;
+    return true;
+}
+
+// True if resource is bound in values[0, n)
+static bool holds(const Binding_Value* values, unsigned int n, const void* resource)
+{
+    if (resource == nullptr)
+        return false;
+    for (unsigned int i = 0; i < n; i++)
+        if (values[i].resource == resource)
+            return true;
+    return false;
+}
+
+void Binding_State::emit(Binding_Kind kind, const Binding_Value* target, unsigned int n, Binding_Call* calls, size_t& call_count)
+{
+    Binding_Value* bound = m_bound[kind];
+    unsigned int lo = n, hi = 0;
+    for (unsigned int i = 0; i < n; i++)
+        if (target[i] != bound[i]) {
+            lo = lo < i ? lo : i;
+            hi = i + 1;
+            stats.slots_written++;
+        }
+    if (lo >= hi)
+        return;
+
+    // One call over [lo, hi): the unchanged slots in between are rebound to what they already hold
+    Binding_Call& call = calls[call_count];
+    call.kind = kind;
+    call.first = lo;
+    call.count = hi - lo;
+    call.values = m_call_values[call_count];
+    memcpy(m_call_values[call_count], target + lo, call.count * sizeof(Binding_Value));
+    memcpy(bound + lo, target + lo, call.count * sizeof(Binding_Value));
+    call_count++;
+    stats.calls++;
+
+    unsigned int extent = m_extent[kind] > hi ? m_extent[kind] : hi;
+    while (extent > 0 && bound[extent - 1].view == nullptr)
+        extent--;
+    m_extent[kind] = extent;
+}
+
+size_t Binding_State::diff(const Binding_Table& table, Binding_Call* calls, bool& set_shader)
+{
+    stats.applies++;
+    set_shader = table.shader != m_shader;
+    if (set_shader) {
+        m_shader = table.shader;
+        stats.shader_sets++;
+    }
+
+    // Desired state per kind: the shadow with the table's slots overwritten
+    Binding_Value desired[BINDING_KIND_COUNT][128];
+    Binding_Value declared[BINDING_KIND_COUNT][128];   // Just the table's values, packed
+    unsigned int declared_count[BINDING_KIND_COUNT] = {};
+    unsigned int n[BINDING_KIND_COUNT];
+    for (int k = 0; k < BINDING_KIND_COUNT; k++) {
+        n[k] = m_extent[k] > table.layout.end[k] ? m_extent[k] : table.layout.end[k];
+        memcpy(desired[k], m_bound[k], n[k] * sizeof(Binding_Value));
+    }
+    bool is_declared[BINDING_KIND_COUNT][128] = {};
+    size_t v = 0;
+    for (const Shader_Binding& b : table.layout.bindings)
+        for (unsigned int i = 0; i < b.count; i++, v++) {
+            if (m_bound[b.kind][b.slot + i] == table.values[v])
+                stats.slots_skipped++;
+            desired[b.kind][b.slot + i] = table.values[v];
+            declared[b.kind][declared_count[b.kind]++] = table.values[v];
+            is_declared[b.kind][b.slot + i] = true;
+        }
+
+    // Leftover bindings of earlier tables must not hold a resource this table binds the other way
+    for (unsigned int i = 0; i < n[BINDING_SRV]; i++)
+        if (!is_declared[BINDING_SRV][i] && holds(declared[BINDING_UAV], declared_count[BINDING_UAV], desired[BINDING_SRV][i].resource))
+            desired[BINDING_SRV][i] = Binding_Value();
+    for (unsigned int i = 0; i < n[BINDING_UAV]; i++)
+        if (!is_declared[BINDING_UAV][i] && holds(declared[BINDING_SRV], declared_count[BINDING_SRV], desired[BINDING_UAV][i].resource))
+            desired[BINDING_UAV][i] = Binding_Value();
+
+    // SRVs first, except those reading a resource that is still bound as a UAV: hold them back
+    // (nulling the slot if its current SRV is about to become a UAV) until the UAVs have moved
+    Binding_Value first_srv[128];
+    bool deferred = false;
+    for (unsigned int i = 0; i < n[BINDING_SRV]; i++) {
+        const Binding_Value& want = desired[BINDING_SRV][i];
+        if (!holds(m_bound[BINDING_UAV], m_extent[BINDING_UAV], want.resource)) {
+            first_srv[i] = want;
+            continue;
+        }
+        deferred = true;
+        const Binding_Value& now = m_bound[BINDING_SRV][i];
+        first_srv[i] = holds(desired[BINDING_UAV], n[BINDING_UAV], now.resource) ? Binding_Value() : now;
+    }
+
+    size_t call_count = 0;
+    emit(BINDING_SRV, first_srv, n[BINDING_SRV], calls, call_count);
+    emit(BINDING_UAV, desired[BINDING_UAV], n[BINDING_UAV], calls, call_count);
+    if (deferred)
+        emit(BINDING_SRV, desired[BINDING_SRV], n[BINDING_SRV], calls, call_count);
+    emit(BINDING_CBV, desired[BINDING_CBV], n[BINDING_CBV], calls, call_count);
+    return call_count;
+}
+
+size_t Binding_State::clear(Binding_Call* calls)
+{
+    Binding_Value none[128];
+    size_t call_count = 0;
+    for (int k = 0; k < BINDING_KIND_COUNT; k++)
+        emit((Binding_Kind)k, none, m_extent[k], calls, call_count);
+    // Whoever binds next by hand sets its own shader, so the next diff() must set ours again
+    m_shader = nullptr;
+    return call_count;
+}
+
+void Binding_State::reset()
+{
+    for (int k = 0; k < BINDING_KIND_COUNT; k++) {
+        for (unsigned int i = 0; i < m_extent[k]; i++)
+            m_bound[k][i] = Binding_Value();
+        m_extent[k] = 0;
+    }
+    m_shader = nullptr;
+}
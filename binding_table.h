@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+ * Precomputed binding tables for compute dispatches. A shader's register
+ * declarations (from reflection, or written out by hand) form a Binding_Layout;
+ * a Binding_Table assigns a view to every declared slot once, ahead of the
+ * dispatch loop; Binding_State shadows what one context has bound and turns
+ * "make this table current" into the fewest contiguous set calls, skipping slots
+ * that already hold the right view and leaving bindings in place between dispatches.
+ *
+ * Views are opaque pointers here so building and diffing tables needs no device.
+ * The resource behind each view is tracked too, because D3D11 will not bind one
+ * resource for reading and writing at once: binding an SRV of a resource that is
+ * still bound as a UAV (or the reverse) forces the other binding to null. diff()
+ * orders and splits its calls so that never happens, including the ping-pong case
+ * where two resources swap between input and output from one pass to the next.
+ * Host-only, no D3D dependency (see d3d11_binding_table.h for the device side).
+ */
+enum Binding_Kind
+{
+    BINDING_SRV,
+    BINDING_UAV,
+    BINDING_CBV,
+    BINDING_KIND_COUNT
+};
+
+// Compute stage slots per kind (D3D11 SRV slots, D3D11.1 UAV slots, constant buffer slots)
+static const unsigned int binding_slot_count[BINDING_KIND_COUNT] = { 128, 64, 14 };
+
+// One register range declared by a shader, e.g. StructuredBuffer<float> input_partials : register(t1)
+struct Shader_Binding
+{
+    Binding_Kind kind = BINDING_SRV;
+    unsigned int slot = 0;
+    unsigned int count = 1;     // > 1 for resource arrays
+    std::string name;
+};
+
+struct Binding_Value
+{
+    const void* view = nullptr;
+    const void* resource = nullptr;     // Resource behind the view, the buffer itself for constant buffers
+
+    bool operator==(const Binding_Value& other) const { return view == other.view && resource == other.resource; }
+    bool operator!=(const Binding_Value& other) const { return !(*this == other); }
+};
+
+struct Binding_Layout
+{
+    std::vector<Shader_Binding> bindings;   // Sorted by kind, then slot
+    unsigned int end[BINDING_KIND_COUNT] = {};  // One past the highest declared slot of each kind
+
+    // Sort and validate: every range inside the stage's slots, no two ranges overlapping
+    bool init(const std::vector<Shader_Binding>& __bindings);
+    // Index into bindings, -1 if the shader declares no binding of that name
+    int find(const char* name) const;
+    // Declared slots over all bindings
+    size_t slots() const;
+};
+
+struct Binding_Table
+{
+    const void* shader = nullptr;
+    Binding_Layout layout;
+    std::vector<Binding_Value> values;  // One per declared slot, in layout order
+
+    bool init(const void* __shader, const std::vector<Shader_Binding>& bindings);
+    // Assign element of the named binding (element > 0 only for arrays)
+    bool set(const char* name, const Binding_Value& value, unsigned int element = 0);
+    // Assign by register, e.g. (BINDING_UAV, 1) for u1
+    bool set(Binding_Kind kind, unsigned int slot, const Binding_Value& value);
+    // True once every declared slot has a view
+    bool complete() const;
+};
+
+// One CS*Set call: count consecutive slots from first
+struct Binding_Call
+{
+    Binding_Kind kind = BINDING_SRV;
+    unsigned int first = 0;
+    unsigned int count = 0;
+    const Binding_Value* values = nullptr;  // Valid until the next diff() or clear()
+};
+
+struct Binding_Stats
+{
+    size_t applies = 0;
+    size_t calls = 0;           // Set calls emitted, shader changes not included
+    size_t shader_sets = 0;
+    size_t slots_written = 0;   // Slots whose binding changed
+    size_t slots_skipped = 0;   // Declared slots that already held their view
+};
+
+class Binding_State
+{
+public:
+    static const size_t max_calls = 4;  // SRV, UAV, SRV again when resources swap roles, CBV
+
+    Binding_Stats stats;
+
+    // Calls, in issue order, that make table current; updates the shadow. set_shader is true if the shader changed.
+    size_t diff(const Binding_Table& table, Binding_Call* calls, bool& set_shader);
+    // Calls that null every bound slot, to hand the context back to code that binds by hand
+    size_t clear(Binding_Call* calls);
+    // Assume nothing is bound, e.g. after other code bound and unbound by hand
+    void reset();
+    const Binding_Value& bound(Binding_Kind kind, unsigned int slot) const { return m_bound[kind][slot]; }
+    const void* shader() const { return m_shader; }
+private:
+    // Queue a call for the slots of target that differ from the shadow and adopt target
+    void emit(Binding_Kind kind, const Binding_Value* target, unsigned int n, Binding_Call* calls, size_t& call_count);
+
+    const void* m_shader = nullptr;
+    Binding_Value m_bound[BINDING_KIND_COUNT][128];
+    unsigned int m_extent[BINDING_KIND_COUNT] = {};     // One past the highest non-null bound slot
+    Binding_Value m_call_values[max_calls][128];
+};
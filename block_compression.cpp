@@ -0,0 +1,304 @@
+#include "block_compression.h"
+#include "host_parallel.h"
+#include <cmath>
+#include <cstring>
+
+bool Compressed_Layout::init(Compressed_Format __format, size_t __channels, size_t __height, size_t __width,
+    size_t tile_height, size_t tile_width)
+{
+    if (__channels * __height * __width == 0)
+        return false;
+
+    format = __format;
+    channels = __channels;
+    height = __height;
+    width = __width;
+    const bool bc5 = format == COMPRESSED_BC5_UNORM || format == COMPRESSED_BC5_SNORM;
+    slices = bc5 ? (channels + 1) / 2 : channels;
+    blocks_h = (height + bc_block_dim - 1) / bc_block_dim;
+    blocks_w = (width + bc_block_dim - 1) / bc_block_dim;
+    tiles = Tile_Layout();
+    return block_compressed() || tiles.init(channels, height, width, 1, tile_height, tile_width);
+}
+
+// Palette of a BC4 block in code units (0..255 UNORM, -127..127 SNORM). The endpoint order picks the mode:
+// r0 > r1 interpolates 6 values between them, otherwise 4 values plus the two ends of the range.
+static void bc4_palette(int r0, int r1, bool snorm, float palette[8])
+{
+    const bool eight = r0 > r1;
+    if (snorm) {
+        r0 = r0 < -127 ? -127 : r0;
+        r1 = r1 < -127 ? -127 : r1;
+    }
+    palette[0] = (float)r0;
+    palette[1] = (float)r1;
+    if (eight) {
+        for (int i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * r0 + (i - 1) * r1) / 7.0f;
+    }
+    else {
+        for (int i = 2; i < 6; i++)
+            palette[i] = ((6 - i) * r0 + (i - 1) * r1) / 5.0f;
+        palette[6] = snorm ? -127.0f : 0.0f;
+        palette[7] = snorm ? 127.0f : 255.0f;
+    }
+}
+
+// Nearest palette entry per texel, returns the squared error in code units
+static float bc4_fit(const float x[16], int r0, int r1, bool snorm, uint8_t indices[16])
+{
+    float palette[8];
+    bc4_palette(r0, r1, snorm, palette);
+    float total = 0.0f;
+    if (r0 > r1) {
+        // Evenly spaced palette: round the position along r1 -> r0 instead of searching
+        const float steps = 7.0f / (r0 - r1);
+        for (int t = 0; t < 16; t++) {
+            int k = (int)((x[t] - r1) * steps + 0.5f);
+            k = k < 0 ? 0 : k > 7 ? 7 : k;
+            indices[t] = (uint8_t)(k == 0 ? 1 : k == 7 ? 0 : 8 - k);
+            const float d = x[t] - palette[indices[t]];
+            total += d * d;
+        }
+        return total;
+    }
+    for (int t = 0; t < 16; t++) {
+        float best = 1e30f;
+        for (int i = 0; i < 8; i++) {
+            float d = (x[t] - palette[i]) * (x[t] - palette[i]);
+            if (d < best) {
+                best = d;
+                indices[t] = (uint8_t)i;
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+static int round_code(float v, int lo, int hi)
+{
+    int r = (int)std::floor(v + 0.5f);
+    return r < lo ? lo : r > hi ? hi : r;
+}
+
+void bc4_encode_block(const float texels[16], bool snorm, uint8_t block[8])
+{
+    const int lo_code = snorm ? -127 : 0;
+    const int hi_code = snorm ? 127 : 255;
+    float x[16];
+    float lo = 1e30f, hi = -1e30f;
+    for (int t = 0; t < 16; t++) {
+        float v = texels[t] * hi_code;
+        x[t] = v < lo_code ? lo_code : v > hi_code ? hi_code : v;
+        lo = x[t] < lo ? x[t] : lo;
+        hi = x[t] > hi ? x[t] : hi;
+    }
+
+    // Six interpolated values across the block's range
+    int best_r0 = round_code(hi, lo_code, hi_code);
+    int best_r1 = round_code(lo, lo_code, hi_code);
+    uint8_t best_indices[16], indices[16];
+    float best = bc4_fit(x, best_r0, best_r1, snorm, best_indices);
+
+    // Refit the endpoints to the chosen indices by least squares; min/max is rarely optimal once rounded
+    if (best_r0 > best_r1 && best > 0.0f) {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax = 0.0f, bx = 0.0f;
+        for (int t = 0; t < 16; t++) {
+            const int i = best_indices[t];
+            const float a = i == 0 ? 1.0f : i == 1 ? 0.0f : (8 - i) / 7.0f;
+            const float b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            ax += a * x[t];
+            bx += b * x[t];
+        }
+        const float det = aa * bb - ab * ab;
+        if (std::fabs(det) > 1e-6f) {
+            int r0 = round_code((ax * bb - bx * ab) / det, lo_code, hi_code);
+            int r1 = round_code((bx * aa - ax * ab) / det, lo_code, hi_code);
+            float error = r0 > r1 ? bc4_fit(x, r0, r1, snorm, indices) : 1e30f;
+            if (error < best) {
+                best = error;
+                best_r0 = r0;
+                best_r1 = r1;
+                memcpy(best_indices, indices, sizeof(indices));
+            }
+        }
+    }
+
+    // Four values between the inner texels when the block also touches the ends of the range
+    float in_lo = 1e30f, in_hi = -1e30f;
+    bool ends = false;
+    for (int t = 0; t < 16; t++) {
+        if (x[t] <= lo_code + 0.5f || x[t] >= hi_code - 0.5f) {
+            ends = true;
+            continue;
+        }
+        in_lo = x[t] < in_lo ? x[t] : in_lo;
+        in_hi = x[t] > in_hi ? x[t] : in_hi;
+    }
+    if (ends && best > 0.0f) {
+        int r0 = in_lo <= in_hi ? round_code(in_lo, lo_code, hi_code) : lo_code;
+        int r1 = in_lo <= in_hi ? round_code(in_hi, lo_code, hi_code) : lo_code;
+        float error = bc4_fit(x, r0, r1, snorm, indices);
+        if (error < best) {
+            best_r0 = r0;
+            best_r1 = r1;
+            memcpy(best_indices, indices, sizeof(indices));
+        }
+    }
+
+    // SNORM endpoints are stored as two's complement bytes
+    block[0] = (uint8_t)(best_r0 & 0xff);
+    block[1] = (uint8_t)(best_r1 & 0xff);
+    uint64_t bits = 0;
+    for (int t = 0; t < 16; t++)
+        bits |= (uint64_t)best_indices[t] << (3 * t);
+    for (int b = 0; b < 6; b++)
+        block[2 + b] = (uint8_t)(bits >> (8 * b));
+}
+
+void bc4_decode_block(const uint8_t block[8], bool snorm, float texels[16])
+{
+    const int r0 = snorm ? (int)(int8_t)block[0] : (int)block[0];
+    const int r1 = snorm ? (int)(int8_t)block[1] : (int)block[1];
+    float palette[8];
+    bc4_palette(r0, r1, snorm, palette);
+    const float inv_unit = snorm ? 1.0f / 127.0f : 1.0f / 255.0f;
+    uint64_t bits = 0;
+    for (int b = 0; b < 6; b++)
+        bits |= (uint64_t)block[2 + b] << (8 * b);
+    for (int t = 0; t < 16; t++)
+        texels[t] = palette[(bits >> (3 * t)) & 7] * inv_unit;
+}
+
+// Block rows run in parallel: row r is block row r % blocks_h of slice r / blocks_h
+static void compress_blocks(const Compressed_Layout& l, const float* in, uint8_t* data, size_t threads)
+{
+    const size_t parts = l.block_bytes() / 8;
+    parallel_for(l.slices * l.blocks_h, [&](size_t begin, size_t end) {
+        float texels[16];
+        for (size_t r = begin; r < end; r++) {
+            const size_t s = r / l.blocks_h;
+            const size_t by = r % l.blocks_h;
+            for (size_t bx = 0; bx < l.blocks_w; bx++) {
+                uint8_t* block = data + (r * l.blocks_w + bx) * l.block_bytes();
+                for (size_t p = 0; p < parts; p++) {
+                    const size_t c = s * parts + p;
+                    // Edge blocks repeat the last row and column, a BC5 slice without a second channel holds zeros
+                    for (size_t t = 0; t < 16; t++) {
+                        size_t h = by * bc_block_dim + t / bc_block_dim;
+                        size_t w = bx * bc_block_dim + t % bc_block_dim;
+                        h = h < l.height ? h : l.height - 1;
+                        w = w < l.width ? w : l.width - 1;
+                        texels[t] = c < l.channels ? in[(c * l.height + h) * l.width + w] : 0.0f;
+                    }
+                    bc4_encode_block(texels, l.snorm(), block + 8 * p);
+                }
+            }
+        }
+    }, threads);
+}
+
+static void decompress_blocks(const Compressed_Layout& l, const uint8_t* data, float* out, size_t threads)
+{
+    const size_t parts = l.block_bytes() / 8;
+    parallel_for(l.slices * l.blocks_h, [&](size_t begin, size_t end) {
+        float texels[16];
+        for (size_t r = begin; r < end; r++) {
+            const size_t s = r / l.blocks_h;
+            const size_t by = r % l.blocks_h;
+            for (size_t bx = 0; bx < l.blocks_w; bx++) {
+                const uint8_t* block = data + (r * l.blocks_w + bx) * l.block_bytes();
+                for (size_t p = 0; p < parts; p++) {
+                    const size_t c = s * parts + p;
+                    if (c >= l.channels)
+                        continue;
+                    bc4_decode_block(block + 8 * p, l.snorm(), texels);
+                    for (size_t t = 0; t < 16; t++) {
+                        size_t h = by * bc_block_dim + t / bc_block_dim;
+                        size_t w = bx * bc_block_dim + t % bc_block_dim;
+                        if (h < l.height && w < l.width)
+                            out[(c * l.height + h) * l.width + w] = texels[t];
+                    }
+                }
+            }
+        }
+    }, threads);
+}
+
+static void compress_tiles(const Compressed_Layout& l, const float* in, uint8_t* data, float* params, size_t threads)
+{
+    parallel_for(l.tiles.tile_count(), [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++) {
+            const Tile_Extent e = l.tiles.extent(tile);
+            const size_t origin = (e.c0 * l.height + e.h0) * l.width + e.w0;
+            float lo = in[origin], hi = in[origin];
+            for (size_t h = 0; h < e.height; h++)
+                for (size_t w = 0; w < e.width; w++) {
+                    const float v = in[origin + h * l.width + w];
+                    lo = v < lo ? v : lo;
+                    hi = v > hi ? v : hi;
+                }
+            const float scale = hi - lo;
+            const float inv = scale > 0.0f ? 255.0f / scale : 0.0f;
+            params[2 * tile] = scale;
+            params[2 * tile + 1] = lo;
+            for (size_t h = 0; h < e.height; h++)
+                for (size_t w = 0; w < e.width; w++) {
+                    const size_t i = origin + h * l.width + w;
+                    const int q = (int)((in[i] - lo) * inv + 0.5f);
+                    data[i] = (uint8_t)(q > 255 ? 255 : q);
+                }
+        }
+    }, threads);
+}
+
+static void decompress_tiles(const Compressed_Layout& l, const uint8_t* data, const float* params, float* out, size_t threads)
+{
+    parallel_for(l.tiles.tile_count(), [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++) {
+            const Tile_Extent e = l.tiles.extent(tile);
+            const size_t origin = (e.c0 * l.height + e.h0) * l.width + e.w0;
+            const float scale = params[2 * tile];
+            const float offset = params[2 * tile + 1];
+            // Same arithmetic as the shader: UNORM read, then one mad
+            for (size_t h = 0; h < e.height; h++)
+                for (size_t w = 0; w < e.width; w++) {
+                    const size_t i = origin + h * l.width + w;
+                    out[i] = (data[i] / 255.0f) * scale + offset;
+                }
+        }
+    }, threads);
+}
+
+void compress(const Compressed_Layout& layout, const float* in, void* data, float* params, size_t threads)
+{
+    if (layout.block_compressed())
+        compress_blocks(layout, in, (uint8_t*)data, threads);
+    else
+        compress_tiles(layout, in, (uint8_t*)data, params, threads);
+}
+
+void decompress(const Compressed_Layout& layout, const void* data, const float* params, float* out, size_t threads)
+{
+    if (layout.block_compressed())
+        decompress_blocks(layout, (const uint8_t*)data, out, threads);
+    else
+        decompress_tiles(layout, (const uint8_t*)data, params, out, threads);
+}
+
+Compression_Error compression_error(const float* reference, const float* decoded, size_t n)
+{
+    Compression_Error e;
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double d = std::fabs((double)reference[i] - decoded[i]);
+        e.max_abs = d > e.max_abs ? d : e.max_abs;
+        sum += d;
+    }
+    e.mean_abs = n ? sum / n : 0.0;
+    return e;
+}
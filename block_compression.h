@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "tile_layout.h"
+
+/*
+ * Compressed storage for read-mostly arrays. Two families:
+ *  - BC4 / BC5: the hardware block formats. Every 4x4 texels of a slice become one
+ *    8-byte BC4 block (two 8-bit endpoints plus a 3-bit palette index per texel), so
+ *    kernels sample them with no decode code at all. BC5 is two BC4 blocks, holding
+ *    channels 2s and 2s + 1 as the R and G of slice s. 4 bits per value either way.
+ *  - Int8 tiles: every tile_height x tile_width tile of a channel is quantized to
+ *    8-bit codes with its own (scale, offset), value = code / 255 * scale + offset.
+ *    Stored as R8_UNORM plus one float pair per tile, so the kernel applies one mad.
+ * UNORM formats hold [0, 1] and SNORM [-1, 1]; encoding clamps to that range. Int8
+ * tiles take any finite range. Encode and decode run in parallel over block rows or
+ * tiles and give the same bytes for any thread count.
+ * Host-only, no D3D dependency (see d3d11_compressed_texture.h for the device side).
+ */
+enum Compressed_Format
+{
+    COMPRESSED_BC4_UNORM,
+    COMPRESSED_BC4_SNORM,
+    COMPRESSED_BC5_UNORM,
+    COMPRESSED_BC5_SNORM,
+    COMPRESSED_INT8_TILE
+};
+
+static const size_t bc_block_dim = 4;
+
+struct Compressed_Layout
+{
+    Compressed_Format format = COMPRESSED_BC4_UNORM;
+    size_t channels = 0;
+    size_t height = 0;
+    size_t width = 0;
+    size_t slices = 0;          // Texture array slices: channels, or channel pairs for BC5
+    size_t blocks_h = 0;        // 4x4 blocks per slice, edge blocks padded (BC formats)
+    size_t blocks_w = 0;
+    Tile_Layout tiles;          // Quantization tiles, one channel each (int8 tiles)
+
+    // Returns false if any dimension is zero
+    bool init(Compressed_Format __format, size_t __channels, size_t __height, size_t __width,
+        size_t tile_height = 32, size_t tile_width = 32);
+    bool block_compressed() const
+    {
+        return format != COMPRESSED_INT8_TILE;
+    }
+    bool snorm() const
+    {
+        return format == COMPRESSED_BC4_SNORM || format == COMPRESSED_BC5_SNORM;
+    }
+    // Bytes per 4x4 block, 0 for int8 tiles
+    size_t block_bytes() const
+    {
+        return format == COMPRESSED_INT8_TILE ? 0 : (format == COMPRESSED_BC5_UNORM || format == COMPRESSED_BC5_SNORM) ? 16 : 8;
+    }
+    // Encoded texel data: blocks row-major per slice, or one code per element in CHW order
+    size_t data_bytes() const
+    {
+        return block_compressed() ? slices * blocks_h * blocks_w * block_bytes() : channels * height * width;
+    }
+    // (scale, offset) floats, two per tile for int8 tiles
+    size_t param_count() const
+    {
+        return block_compressed() ? 0 : 2 * tiles.tile_count();
+    }
+};
+
+struct Compression_Error
+{
+    double max_abs = 0.0;
+    double mean_abs = 0.0;
+};
+
+// Encode a dense CHW float array into data (data_bytes()) and params (param_count() floats, nullptr for BC)
+void compress(const Compressed_Layout& layout, const float* in, void* data, float* params, size_t threads = 0);
+// Decode back into a dense CHW float array, the exact values a spec-conformant sampler returns
+void decompress(const Compressed_Layout& layout, const void* data, const float* params, float* out, size_t threads = 0);
+// Error of decoded against reference over n values
+Compression_Error compression_error(const float* reference, const float* decoded, size_t n);
+
+// One BC4 block: texels in row-major order inside the 4x4 block
+void bc4_encode_block(const float texels[16], bool snorm, uint8_t block[8]);
+void bc4_decode_block(const uint8_t block[8], bool snorm, float texels[16]);
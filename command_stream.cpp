@@ -0,0 +1,628 @@
+#include "command_stream.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+static const char command_magic[8] = { 'T', 'A', 'B', 'C', 'M', 'D', 'S', '1' };
+static const uint32_t command_version = 1;
+static const size_t command_header_bytes = 32;
+static const size_t command_min_bytes = 8;     // u32 op, u32 id: a release
+
+static Command_Recorder* active_capture = nullptr;
+
+Command_Recorder* command_capture()
+{
+    return active_capture;
+}
+
+void set_command_capture(Command_Recorder* recorder)
+{
+    active_capture = recorder;
+}
+
+void capture_unreplayable_dispatch(const char* site, uint32_t x, uint32_t y, uint32_t z)
+{
+    if (active_capture)
+        active_capture->unreplayable_dispatch(site, x, y, z);
+}
+
+const char* command_op_name(Command_Op op)
+{
+    static const char* names[CMD_OP_COUNT] = { "create array", "release array", "upload", "download", "create shader",
+        "set constants", "dispatch", "unreplayable dispatch" };
+    return op < CMD_OP_COUNT ? names[op] : "unknown";
+}
+
+std::string Command_Shader::define(const char* name, const char* fallback) const
+{
+    for (const std::pair<std::string, std::string>& d : defines)
+        if (d.first == name)
+            return d.second;
+    return fallback;
+}
+
+std::string Command_Shader::key() const
+{
+    return file.empty() ? entry : file + ":" + entry;
+}
+
+static void put_u32(std::string& out, uint32_t v)
+{
+    out.append((const char*)&v, sizeof(v));
+}
+
+static void put_u64(std::string& out, uint64_t v)
+{
+    out.append((const char*)&v, sizeof(v));
+}
+
+static void put_str(std::string& out, const std::string& s)
+{
+    put_u32(out, (uint32_t)s.size());
+    out.append(s);
+}
+
+struct Command_Cursor
+{
+    const unsigned char* p;
+    const unsigned char* end;
+    bool ok = true;
+
+    template<typename T>
+    T get()
+    {
+        T v = T();
+        if (p + sizeof(T) > end) {
+            ok = false;
+            return v;
+        }
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+    bool bytes(void* dst, size_t n)
+    {
+        if (!ok || n > (size_t)(end - p)) {
+            ok = false;
+            return false;
+        }
+        memcpy(dst, p, n);
+        p += n;
+        return true;
+    }
+    std::string str()
+    {
+        const uint32_t n = get<uint32_t>();
+        ok = ok && n <= (size_t)(end - p);
+        std::string s(ok ? n : 0, '\0');
+        bytes(&s[0], s.size());
+        return s;
+    }
+};
+
+static void serialize(const Command& c, std::string& out)
+{
+    put_u32(out, c.op);
+    put_u32(out, c.id);
+    switch (c.op) {
+    case CMD_CREATE_ARRAY:
+        put_u32(out, c.array.format);
+        put_u32(out, c.array.layout);
+        put_u32(out, c.array.element_size);
+        put_u32(out, c.array.block_dim);
+        put_u64(out, c.array.channels);
+        put_u64(out, c.array.height);
+        put_u64(out, c.array.width);
+        break;
+    case CMD_UPLOAD:
+        put_u64(out, c.bytes);
+        put_u32(out, c.payload.empty() ? 0 : 1);
+        out.append((const char*)c.payload.data(), c.payload.size());
+        break;
+    case CMD_DOWNLOAD:
+        put_u64(out, c.bytes);
+        break;
+    case CMD_CREATE_SHADER:
+        put_str(out, c.shader.file);
+        put_str(out, c.shader.entry);
+        put_str(out, c.shader.code);
+        put_u32(out, (uint32_t)c.shader.defines.size());
+        for (const std::pair<std::string, std::string>& d : c.shader.defines) {
+            put_str(out, d.first);
+            put_str(out, d.second);
+        }
+        break;
+    case CMD_SET_CONSTANTS:
+        put_u64(out, c.bytes);
+        out.append((const char*)c.payload.data(), c.payload.size());
+        break;
+    case CMD_DISPATCH:
+        for (int i = 0; i < 3; i++)
+            put_u32(out, c.dispatch.groups[i]);
+        put_u32(out, (uint32_t)c.dispatch.bindings.size());
+        for (const Command_Binding& b : c.dispatch.bindings) {
+            put_u32(out, b.kind);
+            put_u32(out, b.slot);
+            put_u32(out, b.id);
+        }
+        break;
+    case CMD_UNREPLAYABLE_DISPATCH:
+        for (int i = 0; i < 3; i++)
+            put_u32(out, c.dispatch.groups[i]);
+        put_str(out, c.site);
+        break;
+    default:
+        break;
+    }
+}
+
+static bool deserialize(Command_Cursor& in, Command& c)
+{
+    const uint32_t op = in.get<uint32_t>();
+    if (op >= CMD_OP_COUNT)
+        return false;
+    c.op = (Command_Op)op;
+    c.id = in.get<uint32_t>();
+    switch (c.op) {
+    case CMD_CREATE_ARRAY:
+        c.array.format = in.get<uint32_t>();
+        c.array.layout = in.get<uint32_t>();
+        c.array.element_size = in.get<uint32_t>();
+        c.array.block_dim = in.get<uint32_t>();
+        c.array.channels = in.get<uint64_t>();
+        c.array.height = in.get<uint64_t>();
+        c.array.width = in.get<uint64_t>();
+        return in.ok && c.array.block_dim != 0;
+    case CMD_UPLOAD:
+        c.bytes = in.get<uint64_t>();
+        if (in.get<uint32_t>()) {
+            in.ok = in.ok && c.bytes <= (uint64_t)(in.end - in.p);
+            c.payload.resize(in.ok ? (size_t)c.bytes : 0);
+            in.bytes(c.payload.data(), c.payload.size());
+        }
+        return in.ok;
+    case CMD_DOWNLOAD:
+        c.bytes = in.get<uint64_t>();
+        return in.ok;
+    case CMD_CREATE_SHADER: {
+        c.shader.file = in.str();
+        c.shader.entry = in.str();
+        c.shader.code = in.str();
+        const uint32_t n = in.get<uint32_t>();
+        for (uint32_t i = 0; i < n && in.ok; i++) {
+            std::string name = in.str();
+            c.shader.defines.emplace_back(name, in.str());
+        }
+        return in.ok;
+    }
+    case CMD_SET_CONSTANTS:
+        c.bytes = in.get<uint64_t>();
+        if (in.ok && c.bytes <= (uint64_t)(in.end - in.p)) {
+            c.payload.resize((size_t)c.bytes);
+            in.bytes(c.payload.data(), c.payload.size());
+        }
+        else
+            in.ok = false;
+        return in.ok;
+    case CMD_DISPATCH: {
+        for (int i = 0; i < 3; i++)
+            c.dispatch.groups[i] = in.get<uint32_t>();
+        const uint32_t n = in.get<uint32_t>();
+        for (uint32_t i = 0; i < n && in.ok; i++) {
+            Command_Binding b;
+            const uint32_t kind = in.get<uint32_t>();
+            b.kind = kind < BINDING_KIND_COUNT ? (Binding_Kind)kind : BINDING_SRV;
+            b.slot = in.get<uint32_t>();
+            b.id = in.get<uint32_t>();
+            in.ok = in.ok && kind < BINDING_KIND_COUNT;
+            c.dispatch.bindings.push_back(b);
+        }
+        return in.ok;
+    }
+    case CMD_UNREPLAYABLE_DISPATCH:
+        for (int i = 0; i < 3; i++)
+            c.dispatch.groups[i] = in.get<uint32_t>();
+        c.site = in.str();
+        return in.ok;
+    default:
+        return in.ok;
+    }
+}
+
+size_t Command_Stream::serialized_bytes() const
+{
+    std::string body;
+    for (const Command& c : commands)
+        serialize(c, body);
+    return command_header_bytes + body.size();
+}
+
+bool Command_Stream::save(const char* path) const
+{
+    std::string body;
+    for (const Command& c : commands)
+        serialize(c, body);
+
+    std::string header(command_magic, sizeof(command_magic));
+    put_u32(header, command_version);
+    put_u32(header, (uint32_t)commands.size());
+    put_u64(header, body.size());
+    put_u32(header, crc32(body.data(), body.size()));
+    put_u32(header, 0);
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        std::cout << "Failed to open command stream for writing: " << path << std::endl;
+        return false;
+    }
+    const bool ok = fwrite(header.data(), 1, header.size(), file) == header.size() &&
+        fwrite(body.data(), 1, body.size(), file) == body.size();
+    if (fclose(file) != 0 || !ok) {
+        std::cout << "Failed to write command stream: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Command_Stream::load(const char* path)
+{
+    commands.clear();
+    Mapped_File file;
+    if (!file.open_read(path))
+        return false;
+    if (file.size < command_header_bytes || memcmp(file.data, command_magic, sizeof(command_magic)) != 0) {
+        std::cout << "Not a command stream: " << path << std::endl;
+        return false;
+    }
+
+    Command_Cursor header = { file.data + sizeof(command_magic), file.data + command_header_bytes };
+    const uint32_t version = header.get<uint32_t>();
+    const uint32_t count = header.get<uint32_t>();
+    const uint64_t body_bytes = header.get<uint64_t>();
+    const uint32_t body_crc = header.get<uint32_t>();
+    if (version != command_version || body_bytes > file.size - command_header_bytes ||
+        crc32(file.data + command_header_bytes, (size_t)body_bytes) != body_crc) {
+        std::cout << "Command stream is corrupt or from an unsupported version: " << path << std::endl;
+        return false;
+    }
+    // Every command takes at least command_min_bytes, so a larger count cannot be honest; don't allocate for it
+    if (count > body_bytes / command_min_bytes) {
+        std::cout << "Command stream claims " << count << " commands in " << body_bytes << " bytes: " << path << std::endl;
+        return false;
+    }
+
+    Command_Cursor body = { file.data + command_header_bytes, file.data + command_header_bytes + body_bytes };
+    commands.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+        if (!deserialize(body, commands[i])) {
+            std::cout << "Command stream is truncated at command " << i << ": " << path << std::endl;
+            commands.clear();
+            return false;
+        }
+    return true;
+}
+
+void Command_Recorder::init(Command_Backend* __inner, bool __capture_payloads)
+{
+    m_inner = __inner;
+    m_capture_payloads = __capture_payloads;
+    m_next_id = 0;
+    m_ids.clear();
+    stream.commands.clear();
+}
+
+uint32_t Command_Recorder::next_id(const void* key)
+{
+    const uint32_t id = m_next_id++;
+    if (key)
+        m_ids[key] = id;
+    return id;
+}
+
+uint32_t Command_Recorder::find(const void* key) const
+{
+    std::map<const void*, uint32_t>::const_iterator it = m_ids.find(key);
+    return it == m_ids.end() ? command_invalid_id : it->second;
+}
+
+void Command_Recorder::forget(const void* key)
+{
+    m_ids.erase(key);
+}
+
+bool Command_Recorder::execute(const Command& command)
+{
+    stream.commands.push_back(command);
+    if (command.op == CMD_UPLOAD && !m_capture_payloads)
+        stream.commands.back().payload.clear();
+    return m_inner == nullptr || m_inner->execute(command);
+}
+
+void Command_Recorder::finish()
+{
+    if (m_inner)
+        m_inner->finish();
+}
+
+uint32_t Command_Recorder::create_array(const Command_Array& array, const void* key)
+{
+    Command c;
+    c.op = CMD_CREATE_ARRAY;
+    c.id = next_id(key);
+    c.array = array;
+    execute(c);
+    return c.id;
+}
+
+void Command_Recorder::release_array(uint32_t id)
+{
+    Command c;
+    c.op = CMD_RELEASE_ARRAY;
+    c.id = id;
+    execute(c);
+}
+
+void Command_Recorder::upload(uint32_t id, const void* data, uint64_t bytes)
+{
+    Command c;
+    c.op = CMD_UPLOAD;
+    c.id = id;
+    c.bytes = bytes;
+    if (data)
+        c.payload.assign((const unsigned char*)data, (const unsigned char*)data + bytes);
+    execute(c);
+}
+
+void Command_Recorder::download(uint32_t id, uint64_t bytes)
+{
+    Command c;
+    c.op = CMD_DOWNLOAD;
+    c.id = id;
+    c.bytes = bytes;
+    execute(c);
+}
+
+uint32_t Command_Recorder::create_shader(const Command_Shader& shader, const void* key)
+{
+    Command c;
+    c.op = CMD_CREATE_SHADER;
+    c.id = next_id(key);
+    c.shader = shader;
+    execute(c);
+    return c.id;
+}
+
+void Command_Recorder::set_constants(const void* key, const void* data, uint64_t bytes)
+{
+    Command c;
+    c.op = CMD_SET_CONSTANTS;
+    c.id = find(key);
+    if (c.id == command_invalid_id)
+        c.id = next_id(key);
+    c.bytes = bytes;
+    c.payload.assign((const unsigned char*)data, (const unsigned char*)data + bytes);
+    execute(c);
+}
+
+void Command_Recorder::dispatch(uint32_t shader, const Command_Dispatch& dispatch)
+{
+    Command c;
+    c.op = CMD_DISPATCH;
+    c.id = shader;
+    c.dispatch = dispatch;
+    execute(c);
+}
+
+void Command_Recorder::unreplayable_dispatch(const char* site, uint32_t x, uint32_t y, uint32_t z)
+{
+    Command c;
+    c.op = CMD_UNREPLAYABLE_DISPATCH;
+    c.id = command_invalid_id;
+    c.dispatch.groups[0] = x;
+    c.dispatch.groups[1] = y;
+    c.dispatch.groups[2] = z;
+    c.site = site;
+    execute(c);
+}
+
+static uint64_t scale_extent(uint64_t n, double scale, uint64_t multiple)
+{
+    const uint64_t scaled = (uint64_t)std::ceil(n * scale);
+    return scaled == 0 ? multiple : (scaled + multiple - 1) / multiple * multiple;
+}
+
+Command scale_command(const Command& command, double scale)
+{
+    Command c = command;
+    if (scale == 1.0)
+        return c;
+    switch (c.op) {
+    case CMD_CREATE_ARRAY:
+        c.array.height = scale_extent(c.array.height, scale, c.array.block_dim);
+        c.array.width = scale_extent(c.array.width, scale, c.array.block_dim);
+        break;
+    case CMD_DISPATCH:
+        c.dispatch.groups[0] = (uint32_t)scale_extent(c.dispatch.groups[0], scale, 1);
+        c.dispatch.groups[1] = (uint32_t)scale_extent(c.dispatch.groups[1], scale, 1);
+        break;
+    default:
+        break;
+    }
+    return c;
+}
+
+// Uploads and downloads carry the size of the array as it is created in this replay
+static void resize_transfer(Command& c, const std::map<uint32_t, uint64_t>& array_bytes)
+{
+    std::map<uint32_t, uint64_t>::const_iterator it = array_bytes.find(c.id);
+    if (it == array_bytes.end() || it->second == c.bytes)
+        return;
+    if (c.op == CMD_UPLOAD && !c.payload.empty()) {
+        std::vector<unsigned char> tiled((size_t)it->second);
+        for (size_t i = 0; i < tiled.size(); i++)
+            tiled[i] = c.payload[i % c.payload.size()];
+        c.payload.swap(tiled);
+    }
+    c.bytes = it->second;
+}
+
+bool replay_commands(const Command_Stream& stream, Command_Backend& backend, const Replay_Options& options, Replay_Stats& stats)
+{
+    stats = Replay_Stats();
+    // Replaying around a dispatch whose bindings were never captured would time and check the wrong work
+    for (size_t i = 0; i < stream.commands.size(); i++)
+        if (stream.commands[i].op == CMD_UNREPLAYABLE_DISPATCH) {
+            std::cout << "Cannot replay command stream, command " << i << " is a dispatch by " << stream.commands[i].site
+                << " that bypassed D3D11_Binding_State and could not be captured." << std::endl;
+            stats.failures++;
+            return false;
+        }
+    std::map<uint32_t, uint64_t> array_bytes;
+    bool ok = true;
+    auto issue = [&](const Command& c) {
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!backend.execute(c)) {
+            stats.failures++;
+            ok = false;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        stats.op_ms[c.op] += std::chrono::duration<double, std::milli>(end - start).count();
+        stats.executed[c.op]++;
+    };
+
+    // Creates first, once: every object exists before the first loop
+    auto setup_start = std::chrono::high_resolution_clock::now();
+    for (const Command& command : stream.commands)
+        if (command.op == CMD_CREATE_ARRAY || command.op == CMD_CREATE_SHADER) {
+            Command c = scale_command(command, options.scale);
+            if (c.op == CMD_CREATE_ARRAY)
+                array_bytes[c.id] = c.array.data_bytes();
+            issue(c);
+        }
+    backend.finish();
+    stats.setup_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - setup_start).count();
+
+    for (size_t loop = 0; loop < options.loops; loop++) {
+        auto loop_start = std::chrono::high_resolution_clock::now();
+        for (const Command& command : stream.commands) {
+            if (command.op == CMD_CREATE_ARRAY || command.op == CMD_CREATE_SHADER || command.op == CMD_RELEASE_ARRAY)
+                continue;
+            const bool transfer = command.op == CMD_UPLOAD || command.op == CMD_DOWNLOAD;
+            if (transfer && options.strip_transfers) {
+                stats.skipped++;
+                continue;
+            }
+            Command c = scale_command(command, options.scale);
+            if (transfer)
+                resize_transfer(c, array_bytes);
+            if (c.op == CMD_UPLOAD)
+                stats.upload_bytes += c.bytes;
+            else if (c.op == CMD_DOWNLOAD)
+                stats.download_bytes += c.bytes;
+            issue(c);
+        }
+        backend.finish();
+        stats.loop_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loop_start).count());
+    }
+
+    for (const Command& command : stream.commands)
+        if (command.op == CMD_RELEASE_ARRAY)
+            issue(command);
+    return ok;
+}
+
+std::string Replay_Stats::report() const
+{
+    std::ostringstream out;
+    out << "Setup " << setup_ms << " ms";
+    for (size_t i = 0; i < loop_ms.size(); i++)
+        out << ", loop " << i << " " << loop_ms[i] << " ms";
+    out << "\n";
+    for (int op = 0; op < CMD_OP_COUNT; op++)
+        if (executed[op])
+            out << "  " << command_op_name((Command_Op)op) << ": " << executed[op] << " issued in " << op_ms[op] << " ms\n";
+    out << "  " << upload_bytes << " bytes up, " << download_bytes << " bytes down, " << skipped << " transfers stripped, "
+        << failures << " failures\n";
+    return out.str();
+}
+
+void Host_Command_Backend::register_kernel(const char* key, const Host_Command_Kernel& kernel)
+{
+    m_kernels[key] = kernel;
+}
+
+bool Host_Command_Backend::execute(const Command& c)
+{
+    switch (c.op) {
+    case CMD_CREATE_ARRAY: {
+        Host_Command_Array& a = arrays[c.id];
+        a.desc = c.array;
+        a.data.assign((size_t)c.array.data_bytes(), 0);
+        return true;
+    }
+    case CMD_RELEASE_ARRAY:
+        return arrays.erase(c.id) == 1;
+    case CMD_UPLOAD: {
+        std::map<uint32_t, Host_Command_Array>::iterator it = arrays.find(c.id);
+        if (it == arrays.end() || c.bytes > it->second.data.size())
+            return false;
+        if (c.payload.empty())
+            memset(it->second.data.data(), 0, (size_t)c.bytes);
+        else
+            memcpy(it->second.data.data(), c.payload.data(), (size_t)c.bytes);
+        return true;
+    }
+    case CMD_DOWNLOAD: {
+        std::map<uint32_t, Host_Command_Array>::iterator it = arrays.find(c.id);
+        if (it == arrays.end() || c.bytes > it->second.data.size())
+            return false;
+        downloaded.assign(it->second.data.begin(), it->second.data.begin() + (size_t)c.bytes);
+        return true;
+    }
+    case CMD_CREATE_SHADER:
+        shaders[c.id] = c.shader;
+        if (m_kernels.count(c.shader.key()) == 0) {
+            std::cout << "No host kernel registered for " << c.shader.key() << "." << std::endl;
+            return false;
+        }
+        return true;
+    case CMD_SET_CONSTANTS:
+        constants[c.id] = c.payload;
+        return true;
+    case CMD_DISPATCH: {
+        std::map<uint32_t, Command_Shader>::const_iterator shader = shaders.find(c.id);
+        if (shader == shaders.end() || m_kernels.count(shader->second.key()) == 0)
+            return false;
+        Host_Dispatch d;
+        d.shader = &shader->second;
+        d.groups = c.dispatch.groups;
+        for (const Command_Binding& b : c.dispatch.bindings) {
+            if (b.kind == BINDING_CBV) {
+                if (d.cb.size() <= b.slot)
+                    d.cb.resize(b.slot + 1, nullptr);
+                d.cb[b.slot] = constants.count(b.id) ? &constants[b.id] : nullptr;
+                continue;
+            }
+            Host_Command_Array* a = arrays.count(b.id) ? &arrays[b.id] : nullptr;
+            if (b.kind == BINDING_SRV) {
+                if (d.srv.size() <= b.slot)
+                    d.srv.resize(b.slot + 1, nullptr);
+                d.srv[b.slot] = a;
+            }
+            else {
+                if (d.uav.size() <= b.slot)
+                    d.uav.resize(b.slot + 1, nullptr);
+                d.uav[b.slot] = a;
+            }
+        }
+        return m_kernels[shader->second.key()](d);
+    }
+    default:
+        return false;
+    }
+}
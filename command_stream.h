@@ -0,0 +1,233 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "binding_table.h"
+
+/*
+ * Capture and replay of the device work an application issues: array creates,
+ * transfers, shader creations with their defines, constant updates and dispatches,
+ * as a compact binary command stream. Objects are numbered in creation order, so a
+ * stream replays against any Command_Backend: the device (d3d11_command_stream.h) to
+ * time a captured workload without the application around it, or the host backend
+ * below, which runs registered CPU kernels in place of the shaders.
+ *
+ * Capture goes through a Command_Recorder, which appends every command to its stream
+ * and forwards it to an optional inner backend. Installed with set_command_capture(),
+ * it also receives what Texture_As_Buffer, D3D11_Compute_Shader, D3D11_Constant_Buffer
+ * and D3D11_Binding_State::dispatch do on the device. Dispatches bound by hand (scan,
+ * compressed transfer, fused expressions, the stream and pipeline backends, virtual
+ * texture arrays, indirect dispatch) cannot be described; they are recorded as an
+ * unreplayable marker naming where they came from, and replay refuses such a stream.
+ *
+ * File layout (little-endian):
+ *   header   "TABCMDS1", u32 version, u32 command count, u64 body bytes, u32 body crc, u32 pad
+ *   body     per command: u32 op, u32 id, then
+ *            create array:  u32 format, u32 layout, u32 element size, u32 block dim, u64 channels, height, width
+ *            upload:        u64 bytes, u32 has payload, payload
+ *            download:      u64 bytes
+ *            create shader: str file, str entry, str code, u32 define count, (str name, str value) per define
+ *            set constants: u64 bytes, payload
+ *            dispatch:      u32 groups x, y, z, u32 binding count, (u32 kind, u32 slot, u32 id) per binding
+ *            unreplayable:  u32 groups x, y, z, str site
+ *            strings are u32 length and bytes
+ * Host-only, no D3D dependency.
+ */
+enum Command_Op
+{
+    CMD_CREATE_ARRAY,
+    CMD_RELEASE_ARRAY,
+    CMD_UPLOAD,
+    CMD_DOWNLOAD,
+    CMD_CREATE_SHADER,
+    CMD_SET_CONSTANTS,      // Creates the constant buffer on first use
+    CMD_DISPATCH,
+    CMD_UNREPLAYABLE_DISPATCH,  // A dispatch issued outside D3D11_Binding_State, its bindings are unknown
+    CMD_OP_COUNT
+};
+
+static const uint32_t command_invalid_id = 0xffffffffu;
+
+// A Texture_As_Buffer: packed host data is channels x rows x row bytes, rows and columns in blocks of block_dim
+struct Command_Array
+{
+    uint32_t format = 0;        // DXGI_FORMAT value, stored as a plain number
+    uint32_t layout = 0;        // Texture_Layout
+    uint32_t element_size = 0;  // Bytes per element, per channel when interleaved, per block when block-compressed
+    uint32_t block_dim = 1;
+    uint64_t channels = 0;
+    uint64_t height = 0;
+    uint64_t width = 0;
+
+    uint64_t data_bytes() const
+    {
+        return channels * (height / block_dim) * (width / block_dim) * element_size;
+    }
+};
+
+struct Command_Shader
+{
+    std::string file;           // Source path if compiled from a file, for naming only
+    std::string entry;
+    std::string code;           // Full source, so a replay needs no shader files
+    std::vector<std::pair<std::string, std::string>> defines;
+
+    // Value of a define, fallback if it is not set
+    std::string define(const char* name, const char* fallback = "") const;
+    // "file:entry", or the entry point alone for shaders compiled from strings
+    std::string key() const;
+};
+
+struct Command_Binding
+{
+    Binding_Kind kind = BINDING_SRV;
+    uint32_t slot = 0;
+    uint32_t id = command_invalid_id;   // Array for SRVs and UAVs, constant buffer for CBVs
+};
+
+struct Command_Dispatch
+{
+    uint32_t groups[3] = { 1, 1, 1 };
+    std::vector<Command_Binding> bindings;
+};
+
+struct Command
+{
+    Command_Op op = CMD_CREATE_ARRAY;
+    uint32_t id = 0;                        // Array, shader or constant buffer acted on; the shader for a dispatch
+    Command_Array array;                    // CMD_CREATE_ARRAY
+    uint64_t bytes = 0;                     // CMD_UPLOAD, CMD_DOWNLOAD, CMD_SET_CONSTANTS
+    std::vector<unsigned char> payload;     // Constants, and upload data when captured (empty: size only)
+    Command_Shader shader;                  // CMD_CREATE_SHADER
+    Command_Dispatch dispatch;              // CMD_DISPATCH, groups only for CMD_UNREPLAYABLE_DISPATCH
+    std::string site;                       // CMD_UNREPLAYABLE_DISPATCH: what issued it
+};
+
+struct Command_Stream
+{
+    std::vector<Command> commands;
+
+    bool save(const char* path) const;
+    bool load(const char* path);
+    // Bytes save() writes
+    size_t serialized_bytes() const;
+};
+
+const char* command_op_name(Command_Op op);
+
+struct Command_Backend
+{
+    virtual ~Command_Backend() {}
+    virtual bool execute(const Command& command) = 0;
+    // Wait until everything executed so far has completed, for timing
+    virtual void finish() {}
+};
+
+class Command_Recorder : public Command_Backend
+{
+public:
+    Command_Stream stream;
+
+    // inner receives every command after it is recorded, nullptr to only record.
+    // Without payloads, uploads are recorded by size and replay with zeros.
+    void init(Command_Backend* __inner = nullptr, bool __capture_payloads = true);
+
+    // Each returns the id the object has in the stream; key is the device object it stands for, if any
+    uint32_t create_array(const Command_Array& array, const void* key = nullptr);
+    void release_array(uint32_t id);
+    void upload(uint32_t id, const void* data, uint64_t bytes);
+    void download(uint32_t id, uint64_t bytes);
+    uint32_t create_shader(const Command_Shader& shader, const void* key = nullptr);
+    // Constant buffers are numbered by key on their first update
+    void set_constants(const void* key, const void* data, uint64_t bytes);
+    void dispatch(uint32_t shader, const Command_Dispatch& dispatch);
+    // A dispatch whose bindings cannot be captured; groups of 0 when they are not known (indirect)
+    void unreplayable_dispatch(const char* site, uint32_t x, uint32_t y, uint32_t z);
+
+    // Id of a device object seen before, command_invalid_id otherwise
+    uint32_t find(const void* key) const;
+    // Drop a device object whose pointer may be reused
+    void forget(const void* key);
+    bool execute(const Command& command) override;
+    void finish() override;
+private:
+    uint32_t next_id(const void* key);
+
+    Command_Backend* m_inner = nullptr;
+    bool m_capture_payloads = true;
+    uint32_t m_next_id = 0;
+    std::map<const void*, uint32_t> m_ids;
+};
+
+// Recorder the device classes report to, nullptr when nothing is being captured
+Command_Recorder* command_capture();
+void set_command_capture(Command_Recorder* recorder);
+// For dispatches bound by hand: mark the active capture, if any, as not replayable from here on
+void capture_unreplayable_dispatch(const char* site, uint32_t x, uint32_t y, uint32_t z);
+
+struct Replay_Options
+{
+    bool strip_transfers = false;   // Skip uploads and downloads, leaving only the compute
+    size_t loops = 1;               // Run the work commands this many times; creates run once before, releases once after
+    double scale = 1.0;             // Multiply array heights and widths and dispatch groups in x and y.
+                                    // Uploads repeat the captured bytes; constants are replayed unchanged.
+};
+
+struct Replay_Stats
+{
+    size_t executed[CMD_OP_COUNT] = {};
+    size_t skipped = 0;                 // Transfers stripped
+    size_t failures = 0;
+    uint64_t upload_bytes = 0;
+    uint64_t download_bytes = 0;
+    double setup_ms = 0.0;              // Creates, until finished
+    std::vector<double> loop_ms;        // Each loop, until finished
+    double op_ms[CMD_OP_COUNT] = {};    // Time spent issuing each kind of command (not waiting for it)
+
+    // One line per loop and per command kind, for logs
+    std::string report() const;
+};
+
+// The command as replay with this scale issues it
+Command scale_command(const Command& command, double scale);
+// False if any command failed; the rest still run. A stream holding an unreplayable dispatch is refused up front.
+bool replay_commands(const Command_Stream& stream, Command_Backend& backend, const Replay_Options& options, Replay_Stats& stats);
+
+/*
+ * Host backend: arrays are byte vectors and each shader runs the CPU kernel registered
+ * under its key ("shaders/array_sum.hlsl:main"), one call per dispatch with the bound
+ * arrays and constants. Captured workloads can be replayed and checked without a GPU.
+ */
+struct Host_Command_Array
+{
+    Command_Array desc;
+    std::vector<unsigned char> data;
+};
+
+struct Host_Dispatch
+{
+    const Command_Shader* shader = nullptr;
+    const uint32_t* groups = nullptr;
+    std::vector<const Host_Command_Array*> srv;         // By slot, nullptr where nothing is bound
+    std::vector<Host_Command_Array*> uav;
+    std::vector<const std::vector<unsigned char>*> cb;
+};
+
+typedef std::function<bool(const Host_Dispatch&)> Host_Command_Kernel;
+
+struct Host_Command_Backend : Command_Backend
+{
+    std::map<uint32_t, Host_Command_Array> arrays;
+    std::map<uint32_t, Command_Shader> shaders;
+    std::map<uint32_t, std::vector<unsigned char>> constants;
+    std::vector<unsigned char> downloaded;              // Last download
+
+    void register_kernel(const char* key, const Host_Command_Kernel& kernel);
+    bool execute(const Command& command) override;
+private:
+    std::map<std::string, Host_Command_Kernel> m_kernels;
+};
@@ -0,0 +1,235 @@
+#include "compressed_transfer.h"
+#include "metrics.h"
+#include "command_stream.h"
+#include <iostream>
+#include <chrono>
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void D3D11_Compressed_Transfer::init(ID3D11Device* device, DXGI_FORMAT format, size_t max_elements)
+{
+    switch (format) {
+        case DXGI_FORMAT_R16_FLOAT:
+            codec.word_bits = 16;
+            break;
+        case DXGI_FORMAT_R32_FLOAT:
+            codec.word_bits = 32;
+            break;
+        default:
+            std::cout << "Failed to initialize compressed transfer. Only R16_FLOAT and R32_FLOAT are supported." << std::endl;
+            return;
+    }
+    m_format = format;
+    m_max_elements = max_elements;
+
+    const UINT stream_bytes = (UINT)(codec.max_stream_words(max_elements) * sizeof(uint32_t));
+
+    D3D11_BUFFER_DESC desc = {};
+    desc.ByteWidth = stream_bytes;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+    desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+    if (FAILED(device->CreateBuffer(&desc, nullptr, &p_stream))) {
+        std::cout << "Failed to create compressed stream buffer." << std::endl;
+        release();
+        return;
+    }
+
+    D3D11_BUFFER_DESC staging_desc = {};
+    staging_desc.ByteWidth = stream_bytes;
+    staging_desc.Usage = D3D11_USAGE_STAGING;
+    staging_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ | D3D11_CPU_ACCESS_WRITE;
+    if (FAILED(device->CreateBuffer(&staging_desc, nullptr, &p_stream_staging))) {
+        std::cout << "Failed to create compressed stream staging buffer." << std::endl;
+        release();
+        return;
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+    srv_desc.Format = DXGI_FORMAT_R32_TYPELESS;
+    srv_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFEREX;
+    srv_desc.BufferEx.FirstElement = 0;
+    srv_desc.BufferEx.NumElements = stream_bytes / 4;
+    srv_desc.BufferEx.Flags = D3D11_BUFFEREX_SRV_FLAG_RAW;
+    if (FAILED(device->CreateShaderResourceView(p_stream, &srv_desc, &p_stream_srv))) {
+        std::cout << "Failed to create compressed stream SRV." << std::endl;
+        release();
+        return;
+    }
+
+    D3D11_UNORDERED_ACCESS_VIEW_DESC uav_desc = {};
+    uav_desc.Format = DXGI_FORMAT_R32_TYPELESS;
+    uav_desc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+    uav_desc.Buffer.FirstElement = 0;
+    uav_desc.Buffer.NumElements = stream_bytes / 4;
+    uav_desc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+    if (FAILED(device->CreateUnorderedAccessView(p_stream, &uav_desc, &p_stream_uav))) {
+        std::cout << "Failed to create compressed stream UAV." << std::endl;
+        release();
+        return;
+    }
+
+    m_constants.init(device, sizeof(Codec_Constants));
+
+    D3D_SHADER_MACRO defines[2] = {{ "WORD_BITS", codec.word_bits == 16 ? "16" : "32" }, { nullptr, nullptr }};
+    m_decode.init_from_file(device, "shaders/transfer_codec.hlsl", "decode_main", defines);
+    m_encode_blocks.init_from_file(device, "shaders/transfer_codec.hlsl", "encode_blocks_main", defines);
+    m_encode_offsets.init_from_file(device, "shaders/transfer_codec.hlsl", "encode_offsets_main", defines);
+    m_encode_pack.init_from_file(device, "shaders/transfer_codec.hlsl", "encode_pack_main", defines);
+}
+
+bool D3D11_Compressed_Transfer::check(Texture_As_Buffer& tab)
+{
+    if (p_stream_uav == nullptr || m_decode.shader == nullptr || m_encode_blocks.shader == nullptr ||
+        m_encode_offsets.shader == nullptr || m_encode_pack.shader == nullptr) {
+        std::cout << "Compressed transfer not initialized, run init() first." << std::endl;
+        return false;
+    }
+    if (tab.p_texture == nullptr || tab.element_size * 8 != codec.word_bits) {
+        std::cout << "Compressed transfer format does not match texture." << std::endl;
+        return false;
+    }
+    if (tab.layout != TEXTURE_PLANAR) {
+        std::cout << "Compressed transfer needs a planar texture, one channel per array slice." << std::endl;
+        return false;
+    }
+    if (tab.channels * tab.height * tab.width > m_max_elements) {
+        std::cout << "Texture is larger than the compressed transfer was initialized for." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+UINT D3D11_Compressed_Transfer::set_constants(ID3D11DeviceContext* context, Texture_As_Buffer& tab)
+{
+    const size_t count = tab.channels * tab.height * tab.width;
+    const UINT blocks = (UINT)Delta_Codec::block_count(count);
+    Codec_Constants constants = {};
+    constants.count = (UINT)count;
+    constants.width = (UINT)tab.width;
+    constants.height = (UINT)tab.height;
+    constants.block_count = blocks;
+    constants.groups_x = blocks < D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION ? blocks : D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION;
+    m_constants.to_gpu(context, &constants);
+    context->CSSetConstantBuffers(0, 1, &m_constants.p_buffer);
+    return constants.groups_x;
+}
+
+void D3D11_Compressed_Transfer::to_gpu(ID3D11DeviceContext* context, Texture_As_Buffer& tab, const void* src)
+{
+    if (!check(tab))
+        return;
+
+    const size_t count = tab.channels * tab.height * tab.width;
+    last_stats = Transfer_Codec_Stats();
+    codec.encode(src, count, m_host_stream, &last_stats);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    // Upload only the used part of the stream buffer
+    D3D11_BOX box = { 0, 0, 0, (UINT)(m_host_stream.size() * sizeof(uint32_t)), 1, 1 };
+    context->UpdateSubresource(p_stream, 0, &box, m_host_stream.data(), 0, 0);
+
+    const UINT blocks = (UINT)Delta_Codec::block_count(count);
+    const UINT groups_x = set_constants(context, tab);
+    context->CSSetShader(m_decode.shader, nullptr, 0);
+    context->CSSetShaderResources(0, 1, &p_stream_srv);
+    context->CSSetUnorderedAccessViews(0, 1, &tab.p_texture_uav, nullptr);
+    context->Dispatch(groups_x, (blocks + groups_x - 1) / groups_x, 1);
+    count_dispatch(groups_x, (blocks + groups_x - 1) / groups_x, 1);
+    capture_unreplayable_dispatch("D3D11_Compressed_Transfer::to_gpu", groups_x, (blocks + groups_x - 1) / groups_x, 1);
+
+    ID3D11UnorderedAccessView* nullUAV[1] = { nullptr };
+    context->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
+    ID3D11ShaderResourceView* nullSRV[1] = { nullptr };
+    context->CSSetShaderResources(0, 1, nullSRV);
+    context->Flush();
+    last_stats.transfer_ms = elapsed_ms(start);
+}
+
+bool D3D11_Compressed_Transfer::to_cpu(ID3D11DeviceContext* context, Texture_As_Buffer& tab, void* dst)
+{
+    if (!check(tab))
+        return false;
+
+    const size_t count = tab.channels * tab.height * tab.width;
+    const UINT blocks = (UINT)Delta_Codec::block_count(count);
+    last_stats = Transfer_Codec_Stats();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Payload is built with InterlockedOr, start from zero
+    const UINT zero[4] = { 0, 0, 0, 0 };
+    context->ClearUnorderedAccessViewUint(p_stream_uav, zero);
+
+    const UINT groups_x = set_constants(context, tab);
+    const UINT groups_y = (blocks + groups_x - 1) / groups_x;
+    context->CSSetShaderResources(1, 1, &tab.p_texture_srv);
+    context->CSSetUnorderedAccessViews(1, 1, &p_stream_uav, nullptr);
+    context->CSSetShader(m_encode_blocks.shader, nullptr, 0);
+    context->Dispatch(groups_x, groups_y, 1);
+    count_dispatch(groups_x, groups_y, 1);
+    capture_unreplayable_dispatch("D3D11_Compressed_Transfer::to_cpu", groups_x, groups_y, 1);
+    context->CSSetShader(m_encode_offsets.shader, nullptr, 0);
+    context->Dispatch(1, 1, 1);
+    count_dispatch(1, 1, 1);
+    capture_unreplayable_dispatch("D3D11_Compressed_Transfer::to_cpu", 1, 1, 1);
+    context->CSSetShader(m_encode_pack.shader, nullptr, 0);
+    context->Dispatch(groups_x, groups_y, 1);
+    count_dispatch(groups_x, groups_y, 1);
+    capture_unreplayable_dispatch("D3D11_Compressed_Transfer::to_cpu", groups_x, groups_y, 1);
+
+    ID3D11UnorderedAccessView* nullUAV[1] = { nullptr };
+    context->CSSetUnorderedAccessViews(1, 1, nullUAV, nullptr);
+    ID3D11ShaderResourceView* nullSRV[1] = { nullptr };
+    context->CSSetShaderResources(1, 1, nullSRV);
+
+    // Read the payload size first, then only the used part of the stream
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    D3D11_BOX size_box = { 0, 0, 0, 4, 1, 1 };
+    context->CopySubresourceRegion(p_stream_staging, 0, 0, 0, 0, p_stream, 0, &size_box);
+    if (FAILED(context->Map(p_stream_staging, 0, D3D11_MAP_READ, 0, &mapped))) {
+        std::cout << "Cannot fetch data to cpu, failed to map stream staging buffer." << std::endl;
+        return false;
+    }
+    const size_t stream_words = Delta_Codec::header_words(count) + *(const uint32_t*)mapped.pData;
+    context->Unmap(p_stream_staging, 0);
+    if (stream_words > codec.max_stream_words(count)) {
+        std::cout << "Cannot fetch data to cpu, device stream is corrupt." << std::endl;
+        return false;
+    }
+
+    D3D11_BOX stream_box = { 0, 0, 0, (UINT)(stream_words * sizeof(uint32_t)), 1, 1 };
+    context->CopySubresourceRegion(p_stream_staging, 0, 0, 0, 0, p_stream, 0, &stream_box);
+    if (FAILED(context->Map(p_stream_staging, 0, D3D11_MAP_READ, 0, &mapped))) {
+        std::cout << "Cannot fetch data to cpu, failed to map stream staging buffer." << std::endl;
+        return false;
+    }
+    last_stats.transfer_ms = elapsed_ms(start);
+    bool ok = codec.decode((const uint32_t*)mapped.pData, stream_words, count, dst, &last_stats);
+    context->Unmap(p_stream_staging, 0);
+    return ok;
+}
+
+void D3D11_Compressed_Transfer::release()
+{
+    if (p_stream_srv)
+        p_stream_srv->Release();
+    if (p_stream_uav)
+        p_stream_uav->Release();
+    if (p_stream)
+        p_stream->Release();
+    if (p_stream_staging)
+        p_stream_staging->Release();
+    m_constants.release();
+    m_decode.release();
+    m_encode_blocks.release();
+    m_encode_offsets.release();
+    m_encode_pack.release();
+
+    p_stream_srv = nullptr;
+    p_stream_uav = nullptr;
+    p_stream = nullptr;
+    p_stream_staging = nullptr;
+}
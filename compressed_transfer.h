@@ -0,0 +1,56 @@
+#pragma once
+#include <d3d11.h>
+#include <vector>
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+#include "transfer_codec.h"
+
+/* 
+ * Compressed transfers for R16_FLOAT / R32_FLOAT Texture_As_Buffer objects.
+ * to_gpu() encodes on the host and uploads only the Delta_Codec stream, which a
+ * compute shader decodes straight into the texture array. to_cpu() encodes on
+ * the device and reads back only the compressed stream.
+ */
+struct D3D11_Compressed_Transfer
+{
+    Delta_Codec codec;
+    Transfer_Codec_Stats last_stats;    // Stats of the most recent transfer
+
+    // Init for arrays of up to max_elements texels of format (R16_FLOAT or R32_FLOAT)
+    void init(ID3D11Device* device, DXGI_FORMAT format, size_t max_elements);
+    // Encode src (dense CHW, same layout as Texture_As_Buffer::to_gpu) and decode into tab on device
+    void to_gpu(ID3D11DeviceContext* context, Texture_As_Buffer& tab, const void* src);
+    // Encode tab on device, read back the stream and decode into dst
+    bool to_cpu(ID3D11DeviceContext* context, Texture_As_Buffer& tab, void* dst);
+    void release();
+    ~D3D11_Compressed_Transfer()
+    {
+        release();
+    }
+private:
+    struct Codec_Constants
+    {
+        UINT count;
+        UINT width;
+        UINT height;
+        UINT block_count;
+        UINT groups_x;
+        UINT align_padding[3];
+    };
+
+    DXGI_FORMAT m_format = DXGI_FORMAT_UNKNOWN;
+    size_t m_max_elements = 0;
+    ID3D11Buffer* p_stream = nullptr;
+    ID3D11Buffer* p_stream_staging = nullptr;
+    ID3D11ShaderResourceView* p_stream_srv = nullptr;
+    ID3D11UnorderedAccessView* p_stream_uav = nullptr;
+    D3D11_Constant_Buffer m_constants;
+    D3D11_Compute_Shader m_decode;
+    D3D11_Compute_Shader m_encode_blocks;
+    D3D11_Compute_Shader m_encode_offsets;
+    D3D11_Compute_Shader m_encode_pack;
+    std::vector<uint32_t> m_host_stream;
+
+    bool check(Texture_As_Buffer& tab);
+    UINT set_constants(ID3D11DeviceContext* context, Texture_As_Buffer& tab);
+};
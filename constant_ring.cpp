@@ -0,0 +1,66 @@
+#include "constant_ring.h"
+#include <iostream>
+
+bool Constant_Ring_Allocator::init(size_t __capacity)
+{
+    m_capacity = __capacity / alignment * alignment;
+    m_head = 0;
+    m_used = 0;
+    m_open_bytes = 0;
+    batches.clear();
+    if (m_capacity == 0) {
+        std::cout << "Failed to initialize constant ring. Capacity must be at least " << alignment << " bytes." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Constant_Ring_Allocator::allocate(size_t bytes, Ring_Slice& slice)
+{
+    bytes = (bytes + alignment - 1) / alignment * alignment;
+    if (bytes == 0 || bytes > m_capacity)
+        return false;
+
+    // Everything free: restart at the front so the whole ring is one contiguous run
+    if (m_used == 0)
+        m_head = 0;
+
+    // Live bytes occupy [tail, head) modulo capacity
+    size_t tail = (m_head + m_capacity - m_used) % m_capacity;
+    size_t skipped = 0;
+    if (m_used > 0 && m_head <= tail) {
+        // Free space is [head, tail)
+        if (m_head + bytes > tail)
+            return false;
+    }
+    else if (m_head + bytes > m_capacity) {
+        // Free space is [head, end) and [0, tail); skip the end if the slice does not fit there
+        if (bytes > tail)
+            return false;
+        skipped = m_capacity - m_head;
+        m_head = 0;
+    }
+
+    slice.offset = m_head;
+    slice.bytes = bytes;
+    m_head = (m_head + bytes) % m_capacity;
+    m_used += skipped + bytes;
+    m_open_bytes += skipped + bytes;
+    return true;
+}
+
+void Constant_Ring_Allocator::end_batch(uint64_t fence)
+{
+    if (m_open_bytes == 0)
+        return;
+    batches.push_back({ fence, m_open_bytes });
+    m_open_bytes = 0;
+}
+
+void Constant_Ring_Allocator::retire(uint64_t completed_fence)
+{
+    while (!batches.empty() && batches.front().fence <= completed_fence) {
+        m_used -= batches.front().bytes;
+        batches.pop_front();
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+/*
+ * Ring suballocator for per-dispatch constants. Slices are aligned to 256 bytes
+ * (16 shader constants, the granularity of CSSetConstantBuffers1 offsets) and are
+ * handed out front to back; a slice that would straddle the end of the ring skips
+ * to the start instead. Allocations are grouped into batches, each closed under a
+ * fence value, and a batch's bytes only come back once retire() sees its fence
+ * completed, so slices still read by in-flight dispatches are never overwritten.
+ * Host-only, no D3D dependency (see d3d11_constant_ring.h).
+ */
+struct Ring_Slice
+{
+    size_t offset = 0;  // Bytes from the start of the ring
+    size_t bytes = 0;   // Rounded up to alignment
+};
+
+class Constant_Ring_Allocator
+{
+public:
+    static const size_t alignment = 256;
+
+    // capacity is rounded down to alignment
+    bool init(size_t __capacity);
+    // False if the ring has no room until older batches retire
+    bool allocate(size_t bytes, Ring_Slice& slice);
+    // Close the allocations made since the last end_batch() under fence
+    void end_batch(uint64_t fence);
+    // Free every closed batch with a fence <= completed_fence
+    void retire(uint64_t completed_fence);
+
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+    // Bytes held by open and closed batches, including space skipped at the wrap
+    size_t used() const
+    {
+        return m_used;
+    }
+    size_t pending_batches() const
+    {
+        return batches.size();
+    }
+    // Fence of the oldest closed batch, 0 if none
+    uint64_t oldest_fence() const
+    {
+        return batches.empty() ? 0 : batches.front().fence;
+    }
+private:
+    struct Batch
+    {
+        uint64_t fence;
+        size_t bytes;
+    };
+
+    size_t m_capacity = 0;
+    size_t m_head = 0;          // Next free byte
+    size_t m_used = 0;
+    size_t m_open_bytes = 0;    // Allocated since the last end_batch()
+    std::deque<Batch> batches;
+};
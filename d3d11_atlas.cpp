@@ -0,0 +1,158 @@
+#include "d3d11_atlas.h"
+#include <iostream>
+
+// Groups per row of a dispatch; tiles past it wrap to further rows
+static const UINT atlas_max_groups_x = D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION;
+
+void D3D11_Texture_Atlas::init(ID3D11Device* device, const Atlas_Packer& __packer, DXGI_FORMAT format)
+{
+    release();
+    m_device = device;
+    m_format = format;
+    packer = &__packer;
+    shadow.init(0);
+}
+
+bool D3D11_Texture_Atlas::sync()
+{
+    while (pages.size() < packer->page_count()) {
+        std::unique_ptr<Texture_As_Buffer> page(new Texture_As_Buffer);
+        page->init(m_device, packer->page_slices(), packer->page_height(), packer->page_width(), m_format);
+        page->init_staging(m_device);
+        if (!page->has_staging()) {
+            std::cout << "Failed to create atlas page " << pages.size() << "." << std::endl;
+            return false;
+        }
+        if (shadow.element_size == 0)
+            shadow.init(page->element_size);
+        pages.push_back(std::move(page));
+    }
+    shadow.sync(*packer);
+    return true;
+}
+
+bool D3D11_Texture_Atlas::write(uint32_t id, const void* chw)
+{
+    if (!packer->live(id) || !sync())
+        return false;
+    shadow.write(*packer, id, chw);
+    return true;
+}
+
+void D3D11_Texture_Atlas::read(uint32_t id, void* chw) const
+{
+    if (packer->live(id))
+        shadow.read(*packer, id, chw);
+}
+
+bool D3D11_Texture_Atlas::upload(ID3D11DeviceContext* context)
+{
+    if (!sync())
+        return false;
+    for (size_t p = 0; p < pages.size(); p++) {
+        const size_t slices = shadow.take_dirty(p);
+        if (slices == 0)
+            continue;
+        Texture_As_Buffer& page = *pages[p];
+        page.to_gpu(context, shadow.pages[p].data(), page.row_pitch(), page.slice_pitch(), slices);
+    }
+    return true;
+}
+
+bool D3D11_Texture_Atlas::download(ID3D11DeviceContext* context)
+{
+    if (!sync())
+        return false;
+    for (size_t p = 0; p < pages.size(); p++) {
+        if (packer->used_slices(p))
+            pages[p]->begin_to_cpu(context);
+    }
+    for (size_t p = 0; p < pages.size(); p++) {
+        const size_t slices = packer->used_slices(p);
+        Texture_As_Buffer& page = *pages[p];
+        if (slices && !page.end_to_cpu(context, shadow.pages[p].data(), page.row_pitch(), page.slice_pitch(), slices))
+            return false;
+    }
+    return true;
+}
+
+void D3D11_Texture_Atlas::release()
+{
+    pages.clear();
+    shadow.init(0);
+    packer = nullptr;
+    m_device = nullptr;
+}
+
+bool D3D11_Atlas_Dispatch::init(ID3D11Device* device, ID3D11DeviceContext* context, const Atlas_Packer& packer, const uint32_t* ids,
+    size_t count, uint32_t tile_width, uint32_t tile_height)
+{
+    release();
+    std::vector<std::vector<Atlas_Tile>> per_page;
+    packer.tiles(ids, count, tile_width, tile_height, per_page);
+    for (size_t p = 0; p < per_page.size(); p++) {
+        const std::vector<Atlas_Tile>& tiles = per_page[p];
+        if (tiles.empty())
+            continue;
+        std::unique_ptr<Page_Tiles> page(new Page_Tiles);
+        page->page = p;
+        page->count = tiles.size();
+        page->tiles.init(device, sizeof(Atlas_Tile), tiles.size());
+        page->constants.init(device, sizeof(Atlas_Constants));
+        if (page->tiles.p_srv == nullptr || page->constants.p_buffer == nullptr) {
+            std::cout << "Failed to create the tile list of atlas page " << p << "." << std::endl;
+            release();
+            return false;
+        }
+        page->tiles.to_gpu(context, tiles.data());
+        Atlas_Constants c = {};
+        c.tile_count = (UINT)tiles.size();
+        c.groups_x = tiles.size() < atlas_max_groups_x ? (UINT)tiles.size() : atlas_max_groups_x;
+        page->constants.to_gpu(context, &c);
+        m_pages.push_back(std::move(page));
+    }
+    return true;
+}
+
+void D3D11_Atlas_Dispatch::dispatch(ID3D11DeviceContext* context, D3D11_Binding_Table& table, const Atlas_Binding* atlases,
+    size_t atlas_count)
+{
+    for (const std::unique_ptr<Page_Tiles>& page : m_pages) {
+        bool bound = true;
+        for (size_t i = 0; i < atlas_count; i++) {
+            const Atlas_Binding& b = atlases[i];
+            if (page->page >= b.atlas->pages.size()) {
+                bound = false;
+                break;
+            }
+            const Texture_As_Buffer& texture = *b.atlas->pages[page->page];
+            if (b.write)
+                table.set_uav(b.name, texture.p_texture_uav);
+            else
+                table.set_srv(b.name, texture.p_texture_srv);
+        }
+        if (!bound) {
+            std::cout << "Atlas page " << page->page << " has no texture, sync() the atlases before dispatching." << std::endl;
+            continue;
+        }
+        table.set_srv("atlas_tiles", page->tiles.p_srv);
+        table.set_cb("Atlas_Constants", page->constants.p_buffer);
+        const UINT groups_x = page->count < atlas_max_groups_x ? (UINT)page->count : atlas_max_groups_x;
+        const UINT groups_y = (UINT)((page->count + groups_x - 1) / groups_x);
+        m_state.dispatch(context, table, groups_x, groups_y, 1);
+    }
+    m_state.clear(context);
+}
+
+size_t D3D11_Atlas_Dispatch::tile_count() const
+{
+    size_t count = 0;
+    for (const std::unique_ptr<Page_Tiles>& page : m_pages)
+        count += page->count;
+    return count;
+}
+
+void D3D11_Atlas_Dispatch::release()
+{
+    m_pages.clear();
+}
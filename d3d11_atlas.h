@@ -0,0 +1,95 @@
+#pragma once
+#include <d3d11.h>
+#include <memory>
+#include <vector>
+#include "atlas.h"
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+#include "d3d11_binding_table.h"
+
+/*
+ * Device side of atlas.h. A D3D11_Texture_Atlas holds one Texture_As_Buffer per page of
+ * a shared Atlas_Packer (single-component formats: each channel rectangle is one slice)
+ * and stages transfers through a host Atlas_Storage: write() and read() only touch the
+ * shadow, upload() sends the dirty leading slices of each page in one copy and download()
+ * fetches every page's used slices, all copies started before the first is waited on.
+ *
+ * D3D11_Atlas_Dispatch is the batched dispatch: the tile list of a batch of arrays is
+ * uploaded once per page as a structured buffer, and each dispatch runs one thread group
+ * per tile over every array of the batch on that page (shaders/atlas.hlsl).
+ *
+ *   packer.init(1024, 1024, 8, 0, 8); ids[i] = packer.allocate(c, h, w); ...
+ *   in.init(device, packer, DXGI_FORMAT_R32_FLOAT); in.write(ids[i], data); in.upload(context);
+ *   batch.init(device, context, packer, ids, count, 8, 8);
+ *   Atlas_Binding b[] = { { "input_0", &in, false }, { "output", &out, true } };
+ *   batch.dispatch(context, table, b, 2); out.download(context); out.read(ids[i], result);
+ */
+struct D3D11_Texture_Atlas
+{
+    const Atlas_Packer* packer = nullptr;
+    Atlas_Storage shadow;
+    std::vector<std::unique_ptr<Texture_As_Buffer>> pages;
+
+    void init(ID3D11Device* device, const Atlas_Packer& __packer, DXGI_FORMAT format);
+    // Create textures for pages the packer opened since the last call; false if one failed
+    bool sync();
+    // Dense CHW host data into the shadow, and back
+    bool write(uint32_t id, const void* chw);
+    void read(uint32_t id, void* chw) const;
+    // Batched transfers of the shadow
+    bool upload(ID3D11DeviceContext* context);
+    bool download(ID3D11DeviceContext* context);
+    void release();
+    ~D3D11_Texture_Atlas()
+    {
+        release();
+    }
+private:
+    ID3D11Device* m_device = nullptr;
+    DXGI_FORMAT m_format = DXGI_FORMAT_UNKNOWN;
+};
+
+// An atlas bound by name to a batched kernel, as a UAV if write
+struct Atlas_Binding
+{
+    const char* name;
+    D3D11_Texture_Atlas* atlas;
+    bool write;
+};
+
+struct D3D11_Atlas_Dispatch
+{
+    // Tile lists of the arrays in ids, tile_width x tile_height matching the kernel's numthreads
+    bool init(ID3D11Device* device, ID3D11DeviceContext* context, const Atlas_Packer& packer, const uint32_t* ids, size_t count,
+        uint32_t tile_width, uint32_t tile_height);
+    // One dispatch per page holding tiles, with the page's textures of every atlas, its tile list
+    // ("atlas_tiles") and Atlas_Constants set into table; the table's other bindings stay as the caller set them
+    void dispatch(ID3D11DeviceContext* context, D3D11_Binding_Table& table, const Atlas_Binding* atlases, size_t atlas_count);
+    size_t tile_count() const;
+    size_t dispatch_count() const
+    {
+        return m_pages.size();
+    }
+    void release();
+    ~D3D11_Atlas_Dispatch()
+    {
+        release();
+    }
+private:
+    struct Atlas_Constants
+    {
+        UINT tile_count;
+        UINT groups_x;
+        UINT align_padding[2];
+    };
+    struct Page_Tiles
+    {
+        size_t page = 0;
+        size_t count = 0;
+        D3D11_Structured_Buffer tiles;
+        D3D11_Constant_Buffer constants;
+    };
+
+    std::vector<std::unique_ptr<Page_Tiles>> m_pages;
+    D3D11_Binding_State m_state;
+};
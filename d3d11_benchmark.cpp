@@ -0,0 +1,181 @@
+#include "d3d11_benchmark.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+void D3D11_Benchmark_Backend::init(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    release();
+    m_device = device;
+    m_context = context;
+    D3D11_QUERY_DESC desc = {};
+    desc.Query = D3D11_QUERY_EVENT;
+    if (FAILED(device->CreateQuery(&desc, &p_event_query))) {
+        std::cout << "Failed to create benchmark event query, transfers are timed without waiting." << std::endl;
+        p_event_query = nullptr;
+    }
+    m_counter.init(device);
+}
+
+const char* D3D11_Benchmark_Backend::name() const
+{
+    return "d3d11";
+}
+
+bool D3D11_Benchmark_Backend::prepare(const Benchmark_Case& c, std::string& reason)
+{
+    if (m_device == nullptr) {
+        reason = "backend not initialized";
+        return false;
+    }
+    const DXGI_FORMAT format = (DXGI_FORMAT)c.dxgi_format;
+    const bool float_format = format == DXGI_FORMAT_R32_FLOAT || format == DXGI_FORMAT_R16_FLOAT || format == DXGI_FORMAT_R8_UNORM
+        || format == DXGI_FORMAT_R16_UNORM;
+    if (c.kernel == "array_sum" && !float_format) {
+        reason = "array_sum reads Texture2DArray<float>, needs a float or unorm format";
+        return false;
+    }
+    if (c.kernel == "hwc_to_chw" && format != DXGI_FORMAT_R32_FLOAT && format != DXGI_FORMAT_R16_FLOAT && format != DXGI_FORMAT_R8_UNORM) {
+        reason = "D3D11_Layout_Transform takes R8_UNORM, R16_FLOAT or R32_FLOAT";
+        return false;
+    }
+
+    m_host.assign(c.elements() * c.element_size, 0);
+    uint32_t seed = 1;
+    for (unsigned char& b : m_host) {
+        seed = seed * 1664525u + 1013904223u;
+        b = (unsigned char)((seed >> 24) & 0x3f);
+    }
+
+    if (c.kernel == "array_sum") {
+        const std::string x = c.define("THREAD_GROUP_SIZE_X", "16");
+        const std::string y = c.define("THREAD_GROUP_SIZE_Y", "16");
+        std::vector<D3D_SHADER_MACRO> defines = { { "THREAD_GROUP_SIZE_X", x.c_str() }, { "THREAD_GROUP_SIZE_Y", y.c_str() } };
+        for (const std::pair<std::string, std::string>& d : c.defines) {
+            if (d.first != "THREAD_GROUP_SIZE_X" && d.first != "THREAD_GROUP_SIZE_Y")
+                defines.push_back({ d.first.c_str(), d.second.c_str() });
+        }
+        defines.push_back({ nullptr, nullptr });
+        m_shader.init_from_file(m_device, "shaders/array_sum.hlsl", "main", defines.data());
+        if (m_shader.shader == nullptr) {
+            reason = "shaders/array_sum.hlsl failed to compile";
+            return false;
+        }
+        const UINT group_x = (UINT)std::atoi(x.c_str());
+        const UINT group_y = (UINT)std::atoi(y.c_str());
+        if (group_x == 0 || group_y == 0) {
+            reason = "thread group size must be positive";
+            return false;
+        }
+        m_groups_x = (UINT)((c.width + group_x - 1) / group_x);
+        m_groups_y = (UINT)((c.height + group_y - 1) / group_y);
+        m_constants.init(m_device, sizeof(Sum_Constants));
+        Sum_Constants constants = { 0, (INT)c.height, (INT)c.width, 0 };
+        m_constants.to_gpu(m_context, &constants);
+    }
+
+    for (size_t n = 0; n < c.concurrency; n++) {
+        std::unique_ptr<Instance> instance(new Instance);
+        instance->output.init(m_device, c.channels, c.height, c.width, format);
+        if (instance->output.p_texture == nullptr) {
+            reason = "failed to create the output texture";
+            return false;
+        }
+        if (c.kernel == "upload" || c.kernel == "download") {
+            instance->output.init_staging(m_device);
+            if (!instance->output.has_staging()) {
+                reason = "failed to create the staging texture";
+                return false;
+            }
+            instance->output.to_gpu(m_context, m_host.data());
+        }
+        else if (c.kernel == "array_sum") {
+            for (Texture_As_Buffer* input : { &instance->input_0, &instance->input_1 }) {
+                input->init(m_device, c.channels, c.height, c.width, format);
+                input->init_staging(m_device);
+                if (!input->has_staging()) {
+                    reason = "failed to create the input textures";
+                    return false;
+                }
+                input->to_gpu(m_context, m_host.data());
+                input->release_staging();
+            }
+            instance->table.init(m_shader);
+            instance->table.set_srv("input_0", instance->input_0.p_texture_srv);
+            instance->table.set_srv("input_1", instance->input_1.p_texture_srv);
+            instance->table.set_uav("output", instance->output.p_texture_uav);
+            instance->table.set_cb("Constant_Buffer", m_constants.p_buffer);
+        }
+        else {
+            instance->transform.init(m_device, m_context, c.channels, c.height, c.width, format);
+            if (instance->transform.p_buffer == nullptr) {
+                reason = "failed to create the layout transform buffer";
+                return false;
+            }
+            instance->transform.upload(m_context, m_host.data());
+        }
+        m_instances.push_back(std::move(instance));
+    }
+    wait_idle();
+    return true;
+}
+
+double D3D11_Benchmark_Backend::run(const Benchmark_Case& c)
+{
+    if (c.kernel == "upload" || c.kernel == "download") {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        for (std::unique_ptr<Instance>& instance : m_instances) {
+            Texture_As_Buffer& tab = instance->output;
+            if (c.kernel == "upload")
+                tab.to_gpu(m_context, m_host.data());
+            else if (!tab.to_cpu(m_context, m_host.data(), tab.row_pitch(), tab.slice_pitch()))
+                return -1.0;
+        }
+        wait_idle();
+        std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>(stop - start).count();
+    }
+
+    bool ok = true;
+    m_counter.counter_start(m_context);
+    for (std::unique_ptr<Instance>& instance : m_instances) {
+        if (c.kernel == "array_sum")
+            m_state.dispatch(m_context, instance->table, m_groups_x, m_groups_y, 1);
+        else
+            ok = instance->transform.to_planar(m_context, instance->output) && ok;
+    }
+    const double ms = m_counter.counter_stop(m_context);
+    return ok ? ms : -1.0;
+}
+
+void D3D11_Benchmark_Backend::finish_case()
+{
+    if (m_context)
+        m_state.clear(m_context);
+    m_instances.clear();
+    m_host.clear();
+    m_shader.release();
+    m_constants.release();
+}
+
+void D3D11_Benchmark_Backend::wait_idle()
+{
+    m_context->Flush();
+    if (p_event_query == nullptr)
+        return;
+    m_context->End(p_event_query);
+    BOOL done = FALSE;
+    while (m_context->GetData(p_event_query, &done, sizeof(done), 0) == S_FALSE) {}
+}
+
+void D3D11_Benchmark_Backend::release()
+{
+    if (m_context)
+        finish_case();
+    m_counter.release();
+    if (p_event_query)
+        p_event_query->Release();
+    p_event_query = nullptr;
+    m_device = nullptr;
+    m_context = nullptr;
+}
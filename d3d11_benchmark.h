@@ -0,0 +1,63 @@
+#pragma once
+#include <d3d11.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "benchmark.h"
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+#include "d3d11_binding_table.h"
+#include "d3d11_layout_transform.h"
+
+/*
+ * Device backend for benchmark.h. Transfers are timed on the host clock until an event
+ * query signals the copies done, since the map and staging copy are what they cost;
+ * array_sum and hwc_to_chw are timed with timestamp queries around the dispatches of all
+ * instances. array_sum compiles shaders/array_sum.hlsl with the case's defines
+ * (THREAD_GROUP_SIZE_X and _Y default to 16); hwc_to_chw runs D3D11_Layout_Transform.
+ */
+class D3D11_Benchmark_Backend : public Benchmark_Backend
+{
+public:
+    void init(ID3D11Device* device, ID3D11DeviceContext* context);
+    const char* name() const override;
+    bool prepare(const Benchmark_Case& c, std::string& reason) override;
+    double run(const Benchmark_Case& c) override;
+    void finish_case() override;
+    void release();
+    ~D3D11_Benchmark_Backend()
+    {
+        release();
+    }
+private:
+    struct Instance
+    {
+        Texture_As_Buffer input_0;
+        Texture_As_Buffer input_1;
+        Texture_As_Buffer output;
+        D3D11_Layout_Transform transform;
+        D3D11_Binding_Table table;
+    };
+    struct Sum_Constants
+    {
+        UINT time_index;
+        INT height;
+        INT width;
+        INT align_padding;
+    };
+
+    // Block until everything issued so far has completed
+    void wait_idle();
+
+    ID3D11Device* m_device = nullptr;
+    ID3D11DeviceContext* m_context = nullptr;
+    ID3D11Query* p_event_query = nullptr;
+    std::vector<std::unique_ptr<Instance>> m_instances;
+    std::vector<unsigned char> m_host;          // Upload source and download destination, one array
+    D3D11_Compute_Shader m_shader;
+    D3D11_Constant_Buffer m_constants;
+    D3D11_Binding_State m_state;
+    D3D11_Performance_Counter m_counter;
+    UINT m_groups_x = 0;
+    UINT m_groups_y = 0;
+};
@@ -0,0 +1,107 @@
+#include "d3d11_binding_table.h"
+#include "metrics.h"
+#include "command_stream.h"
+
+// The view's resource, for read/write hazard tracking; the view keeps it alive
+static Binding_Value view_value(ID3D11View* view)
+{
+    Binding_Value v;
+    v.view = view;
+    if (view) {
+        ID3D11Resource* resource = nullptr;
+        view->GetResource(&resource);
+        v.resource = resource;
+        resource->Release();
+    }
+    return v;
+}
+
+bool D3D11_Binding_Table::init(const D3D11_Compute_Shader& shader)
+{
+    return table.init(shader.shader, shader.bindings);
+}
+
+bool D3D11_Binding_Table::set_srv(const char* name, ID3D11ShaderResourceView* srv, UINT element)
+{
+    return table.set(name, view_value(srv), element);
+}
+
+bool D3D11_Binding_Table::set_uav(const char* name, ID3D11UnorderedAccessView* uav, UINT element)
+{
+    return table.set(name, view_value(uav), element);
+}
+
+bool D3D11_Binding_Table::set_cb(const char* name, ID3D11Buffer* buffer, UINT element)
+{
+    Binding_Value v;
+    v.view = buffer;
+    v.resource = buffer;
+    return table.set(name, v, element);
+}
+
+void D3D11_Binding_State::issue(ID3D11DeviceContext* context, const Binding_Call* calls, size_t count)
+{
+    void* views[128];
+    for (size_t c = 0; c < count; c++) {
+        const Binding_Call& call = calls[c];
+        for (UINT i = 0; i < call.count; i++)
+            views[i] = const_cast<void*>(call.values[i].view);
+        switch (call.kind) {
+        case BINDING_SRV:
+            context->CSSetShaderResources(call.first, call.count, (ID3D11ShaderResourceView* const*)views);
+            break;
+        case BINDING_UAV:
+            context->CSSetUnorderedAccessViews(call.first, call.count, (ID3D11UnorderedAccessView* const*)views, nullptr);
+            break;
+        default:
+            context->CSSetConstantBuffers(call.first, call.count, (ID3D11Buffer* const*)views);
+            break;
+        }
+    }
+}
+
+void D3D11_Binding_State::apply(ID3D11DeviceContext* context, const D3D11_Binding_Table& table)
+{
+    Binding_Call calls[Binding_State::max_calls];
+    bool set_shader;
+    size_t count = state.diff(table.table, calls, set_shader);
+    if (set_shader)
+        context->CSSetShader((ID3D11ComputeShader*)table.table.shader, nullptr, 0);
+    issue(context, calls, count);
+}
+
+// Record a dispatch with every bound slot named by the id its resource has in the capture
+static void capture_dispatch(Command_Recorder& capture, const Binding_Table& table, UINT x, UINT y, UINT z)
+{
+    Command_Dispatch d;
+    d.groups[0] = x;
+    d.groups[1] = y;
+    d.groups[2] = z;
+    size_t v = 0;
+    for (const Shader_Binding& b : table.layout.bindings)
+        for (unsigned int i = 0; i < b.count; i++, v++) {
+            if (table.values[v].view == nullptr)
+                continue;
+            Command_Binding binding;
+            binding.kind = b.kind;
+            binding.slot = b.slot + i;
+            binding.id = capture.find(table.values[v].resource);
+            d.bindings.push_back(binding);
+        }
+    capture.dispatch(capture.find(table.shader), d);
+}
+
+void D3D11_Binding_State::dispatch(ID3D11DeviceContext* context, const D3D11_Binding_Table& table, UINT x, UINT y, UINT z)
+{
+    apply(context, table);
+    context->Dispatch(x, y, z);
+    count_dispatch(x, y, z);
+    if (Command_Recorder* capture = command_capture())
+        capture_dispatch(*capture, table.table, x, y, z);
+}
+
+void D3D11_Binding_State::clear(ID3D11DeviceContext* context)
+{
+    Binding_Call calls[Binding_State::max_calls];
+    issue(context, calls, state.clear(calls));
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <d3d11.h>
+#include "binding_table.h"
+#include "d3d11_helper.h"
+
+/* 
+ * Device side of binding_table.h. A D3D11_Binding_Table is laid out from the
+ * bindings a D3D11_Compute_Shader reflected when it was compiled, so views are
+ * assigned by their names in the HLSL rather than by slot numbers repeated at
+ * every call site. D3D11_Binding_State shadows the compute bindings of one context:
+ * apply() sets the shader if it changed and only the slot ranges that differ, and
+ * leaves them bound for the next dispatch instead of unbinding with null arrays.
+ * clear() nulls whatever is still bound, before handing the context back to code
+ * that binds by hand.
+ *
+ *   table.init(shader); table.set_cb("Constants", cb.p_buffer);
+ *   table.set_srv("input", in.p_texture_srv); table.set_uav("output", out.p_texture_uav);
+ *   state.dispatch(context, table, x, y, z); ... state.clear(context);
+ */
+struct D3D11_Binding_Table
+{
+    Binding_Table table;
+
+    bool init(const D3D11_Compute_Shader& shader);
+    // element > 0 only for resource arrays; a null view leaves the slot unbound
+    bool set_srv(const char* name, ID3D11ShaderResourceView* srv, UINT element = 0);
+    bool set_uav(const char* name, ID3D11UnorderedAccessView* uav, UINT element = 0);
+    bool set_cb(const char* name, ID3D11Buffer* buffer, UINT element = 0);
+};
+
+struct D3D11_Binding_State
+{
+    Binding_State state;
+
+    // Make table current on context
+    void apply(ID3D11DeviceContext* context, const D3D11_Binding_Table& table);
+    void dispatch(ID3D11DeviceContext* context, const D3D11_Binding_Table& table, UINT x, UINT y, UINT z);
+    // Null every slot still bound and forget the shader
+    void clear(ID3D11DeviceContext* context);
+    const Binding_Stats& stats() const
+    {
+        return state.stats;
+    }
+private:
+    void issue(ID3D11DeviceContext* context, const Binding_Call* calls, size_t count);
+};
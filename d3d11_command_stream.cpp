@@ -0,0 +1,134 @@
+#include "d3d11_command_stream.h"
+#include <iostream>
+
+void D3D11_Command_Backend::init(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    release();
+    m_device = device;
+    m_context = context;
+    D3D11_QUERY_DESC desc = {};
+    desc.Query = D3D11_QUERY_EVENT;
+    if (FAILED(device->CreateQuery(&desc, &p_event_query))) {
+        std::cout << "Failed to create replay event query, finish() only flushes." << std::endl;
+        p_event_query = nullptr;
+    }
+}
+
+bool D3D11_Command_Backend::execute(const Command& c)
+{
+    switch (c.op) {
+    case CMD_CREATE_ARRAY: {
+        std::unique_ptr<Texture_As_Buffer> tab(new Texture_As_Buffer);
+        tab->init(m_device, (size_t)c.array.channels, (size_t)c.array.height, (size_t)c.array.width, (DXGI_FORMAT)c.array.format,
+            (Texture_Layout)c.array.layout);
+        tab->init_staging(m_device);
+        if (!tab->has_staging())
+            return false;
+        m_arrays[c.id] = std::move(tab);
+        return true;
+    }
+    case CMD_RELEASE_ARRAY:
+        return m_arrays.erase(c.id) == 1;
+    case CMD_UPLOAD: {
+        std::map<uint32_t, std::unique_ptr<Texture_As_Buffer>>::iterator it = m_arrays.find(c.id);
+        if (it == m_arrays.end())
+            return false;
+        Texture_As_Buffer& tab = *it->second;
+        // Size-only uploads (payloads not captured, or a partial or HWC upload) replay as zeros
+        if (c.payload.size() == tab.channels * tab.slice_pitch())
+            tab.to_gpu(m_context, c.payload.data(), tab.row_pitch(), tab.slice_pitch());
+        else
+            tab.to_gpu(m_context, (unsigned char)0);
+        return true;
+    }
+    case CMD_DOWNLOAD: {
+        std::map<uint32_t, std::unique_ptr<Texture_As_Buffer>>::iterator it = m_arrays.find(c.id);
+        if (it == m_arrays.end())
+            return false;
+        Texture_As_Buffer& tab = *it->second;
+        downloaded.resize(tab.channels * tab.slice_pitch());
+        return tab.to_cpu(m_context, downloaded.data(), tab.row_pitch(), tab.slice_pitch());
+    }
+    case CMD_CREATE_SHADER: {
+        std::vector<D3D_SHADER_MACRO> defines;
+        for (const std::pair<std::string, std::string>& d : c.shader.defines)
+            defines.push_back({ d.first.c_str(), d.second.c_str() });
+        defines.push_back({ nullptr, nullptr });
+        std::unique_ptr<D3D11_Compute_Shader> shader(new D3D11_Compute_Shader);
+        shader->init_from_code_string(m_device, c.shader.code.c_str(), c.shader.entry.c_str(), defines.data());
+        if (shader->shader == nullptr)
+            return false;
+        m_shaders[c.id] = std::move(shader);
+        return true;
+    }
+    case CMD_SET_CONSTANTS: {
+        // Constant buffers are multiples of 16 bytes
+        const size_t bytes = (c.payload.size() + 15) / 16 * 16;
+        std::unique_ptr<D3D11_Constant_Buffer>& cb = m_constants[c.id];
+        if (!cb) {
+            cb.reset(new D3D11_Constant_Buffer);
+            cb->init(m_device, bytes);
+        }
+        if (cb->p_buffer == nullptr)
+            return false;
+        std::vector<unsigned char> padded(bytes, 0);
+        std::copy(c.payload.begin(), c.payload.end(), padded.begin());
+        cb->to_gpu(m_context, padded.data());
+        return true;
+    }
+    case CMD_DISPATCH: {
+        std::map<uint32_t, std::unique_ptr<D3D11_Compute_Shader>>::iterator shader = m_shaders.find(c.id);
+        if (shader == m_shaders.end())
+            return false;
+        D3D11_Binding_Table table;
+        table.init(*shader->second);
+        for (const Command_Binding& b : c.dispatch.bindings) {
+            Binding_Value v;
+            if (b.kind == BINDING_CBV) {
+                if (m_constants.count(b.id) == 0)
+                    continue;
+                v.view = v.resource = m_constants[b.id]->p_buffer;
+            }
+            else {
+                if (m_arrays.count(b.id) == 0)
+                    continue;
+                Texture_As_Buffer& tab = *m_arrays[b.id];
+                v.view = b.kind == BINDING_SRV ? (const void*)tab.p_texture_srv : (const void*)tab.p_texture_uav;
+                v.resource = tab.p_texture;
+            }
+            table.table.set(b.kind, b.slot, v);
+        }
+        m_state.dispatch(m_context, table, c.dispatch.groups[0], c.dispatch.groups[1], c.dispatch.groups[2]);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void D3D11_Command_Backend::finish()
+{
+    if (m_context == nullptr)
+        return;
+    m_state.clear(m_context);
+    m_context->Flush();
+    if (p_event_query == nullptr)
+        return;
+    m_context->End(p_event_query);
+    BOOL done = FALSE;
+    while (m_context->GetData(p_event_query, &done, sizeof(done), 0) == S_FALSE) {}
+}
+
+void D3D11_Command_Backend::release()
+{
+    if (m_context)
+        m_state.clear(m_context);
+    m_arrays.clear();
+    m_shaders.clear();
+    m_constants.clear();
+    if (p_event_query)
+        p_event_query->Release();
+    p_event_query = nullptr;
+    m_device = nullptr;
+    m_context = nullptr;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <d3d11.h>
+#include <map>
+#include <memory>
+#include <vector>
+#include "command_stream.h"
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+#include "d3d11_binding_table.h"
+
+/*
+ * Device backend for command_stream.h: replays a captured stream on a D3D11 device.
+ * Arrays become Texture_As_Buffer with staging, shaders are compiled from the captured
+ * source and defines, constant buffers are sized by their first update, and dispatches
+ * bind through one D3D11_Binding_State. Uninstall any capture before replaying, or
+ * the replay records itself.
+ */
+struct D3D11_Command_Backend : Command_Backend
+{
+    std::vector<unsigned char> downloaded;     // Last download
+
+    void init(ID3D11Device* device, ID3D11DeviceContext* context);
+    bool execute(const Command& command) override;
+    // Waits on an event query
+    void finish() override;
+    void release();
+    ~D3D11_Command_Backend()
+    {
+        release();
+    }
+private:
+    ID3D11Device* m_device = nullptr;
+    ID3D11DeviceContext* m_context = nullptr;
+    ID3D11Query* p_event_query = nullptr;
+    std::map<uint32_t, std::unique_ptr<Texture_As_Buffer>> m_arrays;
+    std::map<uint32_t, std::unique_ptr<D3D11_Compute_Shader>> m_shaders;
+    std::map<uint32_t, std::unique_ptr<D3D11_Constant_Buffer>> m_constants;
+    D3D11_Binding_State m_state;
+};
@@ -0,0 +1,104 @@
+#include "d3d11_compressed_texture.h"
+#include <iostream>
+
+void D3D11_Compressed_Texture_Array::init(ID3D11Device* device, ID3D11DeviceContext* context, Compressed_Format format,
+    size_t channels, size_t height, size_t width, size_t tile_height, size_t tile_width)
+{
+    release();
+    if (!layout.init(format, channels, height, width, tile_height, tile_width)) {
+        std::cout << "Failed to init compressed texture array, dimensions must be non-zero." << std::endl;
+        return;
+    }
+
+    DXGI_FORMAT dxgi_format;
+    switch (format) {
+        case COMPRESSED_BC4_UNORM:
+            dxgi_format = DXGI_FORMAT_BC4_UNORM;
+            break;
+        case COMPRESSED_BC4_SNORM:
+            dxgi_format = DXGI_FORMAT_BC4_SNORM;
+            break;
+        case COMPRESSED_BC5_UNORM:
+            dxgi_format = DXGI_FORMAT_BC5_UNORM;
+            break;
+        case COMPRESSED_BC5_SNORM:
+            dxgi_format = DXGI_FORMAT_BC5_SNORM;
+            break;
+        default:
+            dxgi_format = DXGI_FORMAT_R8_UNORM;
+            break;
+    }
+    if (layout.block_compressed())
+        texture.init(device, layout.slices, layout.blocks_h * bc_block_dim, layout.blocks_w * bc_block_dim, dxgi_format);
+    else
+        texture.init(device, channels, height, width, dxgi_format);
+    if (texture.p_texture == nullptr) {
+        release();
+        return;
+    }
+    texture.init_staging(device);
+    encoded.resize(layout.data_bytes());
+    params.resize(layout.param_count());
+    if (!layout.block_compressed())
+        tile_params.init(device, 2 * sizeof(float), layout.tiles.tile_count());
+
+    Compressed_Constants c = {};
+    c.channels = (UINT)channels;
+    c.height = (UINT)height;
+    c.width = (UINT)width;
+    c.tile_height = (UINT)layout.tiles.tile_height;
+    c.tile_width = (UINT)layout.tiles.tile_width;
+    c.tiles_h = (UINT)layout.tiles.tiles_h;
+    c.tiles_w = (UINT)layout.tiles.tiles_w;
+    m_constants.init(device, sizeof(Compressed_Constants));
+    m_constants.to_gpu(context, &c);
+
+    D3D_SHADER_MACRO defines[2] = { { "COMPRESSED_FORMAT", format_define() }, { nullptr, nullptr } };
+    dense_shader.init_from_file(device, "shaders/compressed.hlsl", "to_dense_main", defines);
+    dense_table.init(dense_shader);
+    set_bindings(dense_table);
+}
+
+bool D3D11_Compressed_Texture_Array::to_gpu(ID3D11DeviceContext* context, const float* dense, size_t threads)
+{
+    if (texture.p_texture == nullptr || dense == nullptr) {
+        std::cout << "Cannot push compressed data to gpu, init() first and pass a dense array." << std::endl;
+        return false;
+    }
+    compress(layout, dense, encoded.data(), params.data(), threads);
+    texture.to_gpu(context, encoded.data());
+    if (!layout.block_compressed())
+        tile_params.to_gpu(context, params.data());
+    return true;
+}
+
+void D3D11_Compressed_Texture_Array::set_bindings(D3D11_Binding_Table& kernel_table) const
+{
+    kernel_table.set_srv("compressed_texture", texture.p_texture_srv);
+    kernel_table.set_cb("Compressed_Constants", m_constants.p_buffer);
+    if (!layout.block_compressed())
+        kernel_table.set_srv("tile_params", tile_params.p_srv);
+}
+
+bool D3D11_Compressed_Texture_Array::to_dense(ID3D11DeviceContext* context, Texture_As_Buffer& out)
+{
+    if (texture.p_texture == nullptr || out.p_texture_uav == nullptr ||
+        out.channels != layout.channels || out.height != layout.height || out.width != layout.width) {
+        std::cout << "Failed to expand compressed array, output " << out.print_shape() << " does not match." << std::endl;
+        return false;
+    }
+    dense_table.set_uav("dense_out", out.p_texture_uav);
+    bindings.dispatch(context, dense_table, (UINT)((layout.width + 15) / 16), (UINT)((layout.height + 15) / 16), (UINT)layout.channels);
+    bindings.clear(context);
+    return true;
+}
+
+void D3D11_Compressed_Texture_Array::release()
+{
+    texture.release();
+    tile_params.release();
+    dense_shader.release();
+    m_constants.release();
+    encoded.clear();
+    params.clear();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <d3d11.h>
+#include <vector>
+#include "block_compression.h"
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+#include "d3d11_binding_table.h"
+
+/* 
+ * Read-only texture array in a compressed storage format (shaders/compressed.hlsl).
+ * BC4/BC5 data lives in a block-compressed Texture_As_Buffer, padded to whole
+ * 4x4 blocks, and the sampler decodes it; int8 tiles live in an R8_UNORM array plus
+ * a structured buffer of per-tile (scale, offset), and compressed_load() applies the
+ * mad. to_gpu() encodes a dense float array on the host (block_compression.h) and
+ * uploads only the encoded bytes.
+ */
+struct D3D11_Compressed_Texture_Array
+{
+    Compressed_Layout layout;
+    Texture_As_Buffer texture;
+    D3D11_Structured_Buffer tile_params;    // Int8 tiles only
+
+    // tile_height / tile_width size the int8 quantization tiles and are ignored for BC formats
+    void init(ID3D11Device* device, ID3D11DeviceContext* context, Compressed_Format format, size_t channels, size_t height, size_t width,
+        size_t tile_height = 32, size_t tile_width = 32);
+    // Encode a dense CHW float array (threads as in parallel_for) and upload it
+    bool to_gpu(ID3D11DeviceContext* context, const float* dense, size_t threads = 0);
+    // Decode on device into a dense array of the logical shape (any format with a UAV)
+    bool to_dense(ID3D11DeviceContext* context, Texture_As_Buffer& out);
+    // Fill the compressed.hlsl bindings (compressed_texture, tile_params, Compressed_Constants) of a kernel's table
+    void set_bindings(D3D11_Binding_Table& kernel_table) const;
+    // COMPRESSED_FORMAT define value for kernels including compressed.hlsl
+    const char* format_define() const
+    {
+        return !layout.block_compressed() ? "2" : layout.block_bytes() == 16 ? "1" : "0";
+    }
+    size_t stored_bytes() const
+    {
+        return layout.data_bytes() + layout.param_count() * sizeof(float);
+    }
+    void release();
+    ~D3D11_Compressed_Texture_Array()
+    {
+        release();
+    }
+private:
+    struct Compressed_Constants
+    {
+        UINT channels;
+        UINT height;
+        UINT width;
+        UINT tile_height;
+        UINT tile_width;
+        UINT tiles_h;
+        UINT tiles_w;
+        UINT align_padding;
+    };
+
+    std::vector<unsigned char> encoded;
+    std::vector<float> params;
+    D3D11_Compute_Shader dense_shader;
+    D3D11_Binding_Table dense_table;
+    D3D11_Binding_State bindings;
+    D3D11_Constant_Buffer m_constants;
+};
@@ -0,0 +1,149 @@
+#include "d3d11_constant_ring.h"
+#include <iostream>
+#include <cstring>
+
+void D3D11_Constant_Ring::init(ID3D11Device* device, ID3D11DeviceContext* context, size_t capacity)
+{
+    release();
+    m_device = device;
+    m_context = context;
+    if (!allocator.init(capacity))
+        return;
+    shadow.resize(allocator.capacity());
+
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+    device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+    if (options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer)
+        context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&p_context1);
+    if (p_context1 == nullptr)
+        std::cout << "Constant buffer offsetting not supported, constant ring falls back to one update per bind." << std::endl;
+
+    D3D11_BUFFER_DESC desc = {};
+    desc.Usage = D3D11_USAGE_DYNAMIC;
+    desc.ByteWidth = (UINT)allocator.capacity();
+    desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    if (FAILED(device->CreateBuffer(&desc, nullptr, &p_buffer))) {
+        std::cout << "Failed to create constant ring buffer." << std::endl;
+        release();
+    }
+}
+
+void D3D11_Constant_Ring::poll(bool wait)
+{
+    while (!fences.empty()) {
+        HRESULT hr;
+        // Flush only when blocking, otherwise the query may never be submitted
+        while ((hr = m_context->GetData(fences.front().second, nullptr, 0, wait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH)) == S_FALSE && wait) {}
+        if (hr != S_OK)
+            break;
+        completed_fence = fences.front().first;
+        free_queries.push_back(fences.front().second);
+        fences.pop_front();
+        wait = false;
+    }
+    allocator.retire(completed_fence);
+}
+
+bool D3D11_Constant_Ring::push(const void* data, size_t bytes, Ring_Slice& slice)
+{
+    if (p_buffer == nullptr)
+        return false;
+    poll(false);
+    while (!allocator.allocate(bytes, slice)) {
+        if (fences.empty()) {
+            std::cout << "Constant ring full, commit() and end_batch() before pushing more than its capacity." << std::endl;
+            return false;
+        }
+        waits++;
+        poll(true);
+    }
+    memcpy(shadow.data() + slice.offset, data, bytes);
+    uncommitted.push_back(slice);
+    return true;
+}
+
+void D3D11_Constant_Ring::commit()
+{
+    if (uncommitted.empty())
+        return;
+    if (p_context1 == nullptr) {
+        uncommitted.clear();
+        return;
+    }
+
+    // Pushed slices never overlap anything in flight, so one NO_OVERWRITE map covers them all
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    if (FAILED(m_context->Map(p_buffer, 0, first_map ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped))) {
+        std::cout << "Failed to map constant ring." << std::endl;
+        return;
+    }
+    for (const Ring_Slice& s : uncommitted)
+        memcpy((unsigned char*)mapped.pData + s.offset, shadow.data() + s.offset, s.bytes);
+    m_context->Unmap(p_buffer, 0);
+    maps++;
+    first_map = false;
+    uncommitted.clear();
+}
+
+void D3D11_Constant_Ring::bind(UINT slot, const Ring_Slice& slice)
+{
+    if (p_context1) {
+        UINT first_constant = (UINT)(slice.offset / 16);
+        UINT num_constants = (UINT)(slice.bytes / 16);
+        p_context1->CSSetConstantBuffers1(slot, 1, &p_buffer, &first_constant, &num_constants);
+        return;
+    }
+
+    if (fallback.p_buffer == nullptr || fallback_bytes < slice.bytes) {
+        fallback.release();
+        fallback.init(m_device, slice.bytes);
+        fallback_bytes = slice.bytes;
+    }
+    // The fallback buffer has a fixed size, copy a full buffer's worth from the shadow
+    std::vector<unsigned char> padded(fallback_bytes, 0);
+    memcpy(padded.data(), shadow.data() + slice.offset, slice.bytes);
+    fallback.to_gpu(m_context, padded.data());
+    maps++;
+    m_context->CSSetConstantBuffers(slot, 1, &fallback.p_buffer);
+}
+
+void D3D11_Constant_Ring::end_batch()
+{
+    if (p_buffer == nullptr)
+        return;
+    D3D11_QUERY_DESC desc = { D3D11_QUERY_EVENT, 0 };
+    ID3D11Query* query = nullptr;
+    if (!free_queries.empty()) {
+        query = free_queries.back();
+        free_queries.pop_back();
+    }
+    else if (FAILED(m_device->CreateQuery(&desc, &query))) {
+        std::cout << "Failed to create constant ring fence." << std::endl;
+        return;
+    }
+    m_context->End(query);
+    fences.push_back({ next_fence, query });
+    allocator.end_batch(next_fence);
+    next_fence++;
+}
+
+void D3D11_Constant_Ring::release()
+{
+    for (auto& f : fences)
+        f.second->Release();
+    fences.clear();
+    for (ID3D11Query* q : free_queries)
+        q->Release();
+    free_queries.clear();
+    if (p_buffer) p_buffer->Release();
+    if (p_context1) p_context1->Release();
+    p_buffer = nullptr;
+    p_context1 = nullptr;
+    fallback.release();
+    fallback_bytes = 0;
+    uncommitted.clear();
+    first_map = true;
+    next_fence = 1;
+    completed_fence = 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <deque>
+#include <vector>
+#include "constant_ring.h"
+#include "d3d11_helper.h"
+
+/* 
+ * One large dynamic constant buffer shared by many dispatches. push() copies a
+ * dispatch's constants into a host shadow of the ring, commit() writes every pushed
+ * slice with a single Map(WRITE_NO_OVERWRITE), and bind() points a slot at a slice
+ * with CSSetConstantBuffers1 first-constant offsets. end_batch() fences the dispatches
+ * issued so far with an event query; their slices are reused once it completes.
+ *
+ *   ring.push(&c0, sizeof(c0), s0); ring.push(&c1, sizeof(c1), s1); ring.commit();
+ *   ring.bind(0, s0); Dispatch(...); ring.bind(0, s1); Dispatch(...); ring.end_batch();
+ *
+ * Without ID3D11DeviceContext1 or the D3D11.1 constant buffer offsetting options,
+ * bind() falls back to one WRITE_DISCARD update of a plain buffer per slice.
+ */
+struct D3D11_Constant_Ring
+{
+    Constant_Ring_Allocator allocator;
+    size_t maps = 0;            // Map calls issued, the number of driver renames/updates
+    size_t waits = 0;           // Times push() had to wait for the GPU to free space
+
+    void init(ID3D11Device* device, ID3D11DeviceContext* context, size_t capacity = 1 << 20);
+    // Stage bytes of constants, blocks on the oldest batch if the ring is full
+    bool push(const void* data, size_t bytes, Ring_Slice& slice);
+    // Write all slices pushed since the last commit with one Map
+    void commit();
+    // Bind a committed slice to constant buffer slot
+    void bind(UINT slot, const Ring_Slice& slice);
+    // Fence the dispatches issued since the last end_batch()
+    void end_batch();
+    bool offsetting() const
+    {
+        return p_context1 != nullptr;
+    }
+    void release();
+    ~D3D11_Constant_Ring()
+    {
+        release();
+    }
+private:
+    void poll(bool wait);
+
+    ID3D11DeviceContext* m_context = nullptr;
+    ID3D11DeviceContext1* p_context1 = nullptr;
+    ID3D11Device* m_device = nullptr;
+    ID3D11Buffer* p_buffer = nullptr;
+    std::vector<unsigned char> shadow;
+    std::vector<Ring_Slice> uncommitted;
+    std::deque<std::pair<uint64_t, ID3D11Query*>> fences;
+    std::vector<ID3D11Query*> free_queries;     // Completed fences, reused by end_batch()
+    uint64_t next_fence = 1;
+    uint64_t completed_fence = 0;
+    bool first_map = true;
+    D3D11_Constant_Buffer fallback;     // Only without offsetting support
+    size_t fallback_bytes = 0;
+};
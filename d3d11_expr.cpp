@@ -0,0 +1,110 @@
+#include "d3d11_expr.h"
+#include "metrics.h"
+#include "command_stream.h"
+#include "format_traits.h"
+#include <iostream>
+
+Expr expr_input(const Texture_As_Buffer& tab)
+{
+    return Expr::device(&tab, tab.channels, tab.height, tab.width);
+}
+
+void D3D11_Expr_Evaluator::init(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    release();
+    m_device = device;
+    m_context = context;
+    constants.init(device, Expr_Plan::max_constants * sizeof(float));
+}
+
+bool D3D11_Expr_Evaluator::eval(const Expr& e, Texture_As_Buffer& out)
+{
+    Expr_Plan plan;
+    if (!plan.compile(e))
+        return false;
+    if (!plan.device) {
+        std::cout << "Failed to evaluate expression on device, its inputs are host arrays." << std::endl;
+        return false;
+    }
+    if (out.channels != plan.channels || out.height != plan.height || out.width != plan.width) {
+        std::cout << "Failed to evaluate expression, output shape " << out.print_shape() << " does not match its inputs." << std::endl;
+        return false;
+    }
+    // Fused kernels index Texture2DArray slices by channel
+    bool planar = out.layout == TEXTURE_PLANAR;
+    for (const Expr_Node* input : plan.inputs)
+        planar = planar && ((const Texture_As_Buffer*)input->source)->layout == TEXTURE_PLANAR;
+    if (!planar) {
+        std::cout << "Failed to evaluate expression on device, inputs and output must be planar textures." << std::endl;
+        return false;
+    }
+
+    // Fused kernels store one scalar per texel; unorm/snorm outputs need a matching RWTexture2DArray
+    // element type, anything else stores float
+    D3D11_TEXTURE2D_DESC desc;
+    out.p_texture->GetDesc(&desc);
+    Format_Info info;
+    if (!format_info(desc.Format, info) || info.components != 1 || info.block_dim != 1) {
+        std::cout << "Failed to evaluate expression on device, the output must have a single-component format." << std::endl;
+        return false;
+    }
+    const char* output_type = "float";
+    if (desc.Format == DXGI_FORMAT_R8_UNORM || desc.Format == DXGI_FORMAT_R16_UNORM)
+        output_type = "unorm float";
+    else if (desc.Format == DXGI_FORMAT_R8_SNORM || desc.Format == DXGI_FORMAT_R16_SNORM)
+        output_type = "snorm float";
+
+    std::string key = plan.signature + output_type + std::to_string(block_x) + "x" + std::to_string(block_y);
+    auto it = kernels.find(key);
+    D3D11_Compute_Shader* shader = nullptr;
+    if (it != kernels.end()) {
+        hits++;
+        shader = it->second;
+    }
+    else {
+        misses++;
+        std::string code = plan.hlsl(output_type, block_x, block_y);
+        shader = new D3D11_Compute_Shader();
+        shader->init_from_code_string(m_device, code.c_str(), "main");
+        if (shader->shader == nullptr) {
+            std::cout << "Failed to compile fused expression kernel:" << std::endl << code << std::endl;
+            delete shader;
+            return false;
+        }
+        kernels[key] = shader;
+    }
+
+    float k[Expr_Plan::max_constants] = {};
+    for (size_t i = 0; i < plan.constants.size(); i++)
+        k[i] = plan.constants[i];
+    constants.to_gpu(m_context, k);
+
+    ID3D11ShaderResourceView* srvs[Expr_Plan::max_inputs] = {};
+    for (size_t i = 0; i < plan.inputs.size(); i++)
+        srvs[i] = ((const Texture_As_Buffer*)plan.inputs[i]->source)->p_texture_srv;
+
+    m_context->CSSetShader(shader->shader, nullptr, 0);
+    m_context->CSSetConstantBuffers(0, 1, &constants.p_buffer);
+    m_context->CSSetShaderResources(0, (UINT)plan.inputs.size(), srvs);
+    m_context->CSSetUnorderedAccessViews(0, 1, &out.p_texture_uav, nullptr);
+    UINT dispatchX = ((UINT)out.width + block_x - 1) / block_x;
+    UINT dispatchY = ((UINT)out.height + block_y - 1) / block_y;
+    m_context->Dispatch(dispatchX, dispatchY, 1);
+    count_dispatch(dispatchX, dispatchY, 1);
+    capture_unreplayable_dispatch("D3D11_Expr_Evaluator::eval", dispatchX, dispatchY, 1);
+    dispatches++;
+
+    ID3D11UnorderedAccessView* nullUAV[1] = { nullptr };
+    m_context->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
+    ID3D11ShaderResourceView* nullSRV[Expr_Plan::max_inputs] = {};
+    m_context->CSSetShaderResources(0, (UINT)plan.inputs.size(), nullSRV);
+    return true;
+}
+
+void D3D11_Expr_Evaluator::release()
+{
+    for (auto& k : kernels)
+        delete k.second;
+    kernels.clear();
+    constants.release();
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <d3d11.h>
+#include <map>
+#include <string>
+#include "expr_graph.h"
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+
+// Leaf of a lazy expression reading a texture array (Texture2DArray<float> view of any float/unorm format)
+Expr expr_input(const Texture_As_Buffer& tab);
+
+/* 
+ * Evaluates lazy expressions on the device: each distinct graph signature is
+ * compiled once into a fused compute shader (see Expr_Plan::hlsl()) and then
+ * reused, so a chain such as (a + b) * k costs one dispatch and no intermediate
+ * textures. Constants go through one constant buffer at b0.
+ */
+struct D3D11_Expr_Evaluator
+{
+    UINT block_x = 16;
+    UINT block_y = 16;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t dispatches = 0;
+
+    void init(ID3D11Device* device, ID3D11DeviceContext* context);
+    // Evaluate into out, which must have the shape of the expression's inputs
+    bool eval(const Expr& e, Texture_As_Buffer& out);
+    size_t cache_size() const
+    {
+        return kernels.size();
+    }
+    void release();
+
+    ~D3D11_Expr_Evaluator()
+    {
+        release();
+    }
+private:
+    ID3D11Device* m_device = nullptr;
+    ID3D11DeviceContext* m_context = nullptr;
+    D3D11_Constant_Buffer constants;
+    std::map<std::string, D3D11_Compute_Shader*> kernels;
+};
@@ -1,8 +1,11 @@
 #include "d3d11_helper.h"
+#include "metrics.h"
+#include "command_stream.h"
 #include <d3dcompiler.h>
 #include <d3d11shader.h>
 #include <iostream>
 #include <fstream>
+#include <cstring>
 
 void D3D11_Device_Resources::init(int device_index)
  {
@@ -87,6 +90,12 @@ void D3D11_Device_Resources::release()
 }
 
 void D3D11_Compute_Shader::init_from_code_string(ID3D11Device* device, const char* shader_code, const char* entry_point, const D3D_SHADER_MACRO* defines)
+{
+    compile(device, shader_code, entry_point, defines, nullptr);
+}
+
+void D3D11_Compute_Shader::compile(ID3D11Device* device, const char* shader_code, const char* entry_point, const D3D_SHADER_MACRO* defines,
+    const char* file_path)
 {   
     if (!shader_code || !entry_point || strlen(shader_code) == 0 || strlen(entry_point) == 0) {
         std::cerr << "Shader code or entry point is empty" << std::endl;
@@ -96,6 +105,7 @@ void D3D11_Compute_Shader::init_from_code_string(ID3D11Device* device, const cha
 
     ID3DBlob* shader_blob;
     ID3DBlob* error_blob;
+    Metrics_Stopwatch compile_time;
     UINT compile_flags = D3DCOMPILE_ENABLE_STRICTNESS;
     if (debug_mode) {
         compile_flags |= D3DCOMPILE_DEBUG;
@@ -122,14 +132,66 @@ void D3D11_Compute_Shader::init_from_code_string(ID3D11Device* device, const cha
         else
             std::cout << "Compile failed. Shader path not found" << std::endl;
 
+        metrics().add(device_metrics().shader_compile_failures);
         shader = nullptr;
         return;
     }
 
     if (FAILED(device->CreateComputeShader(shader_blob->GetBufferPointer(), shader_blob->GetBufferSize(), nullptr, &shader))) {
+        metrics().add(device_metrics().shader_compile_failures);
         shader = nullptr;
+        shader_blob->Release();
         return;
     }
+    metrics().add(device_metrics().shader_compiles);
+    metrics().observe(device_metrics().shader_compile_ms, compile_time.elapsed_us() / 1000.0);
+
+    // Reflect the register declarations for binding tables (samplers are not tracked)
+    bindings.clear();
+    ID3D11ShaderReflection* reflection = nullptr;
+    if (SUCCEEDED(D3DReflect(shader_blob->GetBufferPointer(), shader_blob->GetBufferSize(), IID_ID3D11ShaderReflection, (void**)&reflection))) {
+        D3D11_SHADER_DESC desc;
+        reflection->GetDesc(&desc);
+        for (UINT i = 0; i < desc.BoundResources; i++) {
+            D3D11_SHADER_INPUT_BIND_DESC bind;
+            reflection->GetResourceBindingDesc(i, &bind);
+            Shader_Binding b;
+            switch (bind.Type) {
+            case D3D_SIT_CBUFFER:
+                b.kind = BINDING_CBV;
+                break;
+            case D3D_SIT_TBUFFER:
+            case D3D_SIT_TEXTURE:
+            case D3D_SIT_STRUCTURED:
+            case D3D_SIT_BYTEADDRESS:
+                b.kind = BINDING_SRV;
+                break;
+            case D3D_SIT_SAMPLER:
+                continue;
+            default:
+                b.kind = BINDING_UAV;
+                break;
+            }
+            b.slot = bind.BindPoint;
+            b.count = bind.BindCount;
+            b.name = bind.Name;
+            bindings.push_back(b);
+        }
+        reflection->Release();
+    }
+    else
+        std::cout << "Failed to reflect shader " << entry_point << ", binding tables unavailable." << std::endl;
+    shader_blob->Release();
+
+    if (Command_Recorder* capture = command_capture()) {
+        Command_Shader s;
+        s.file = file_path ? file_path : "";
+        s.entry = entry_point;
+        s.code = shader_code;
+        for (const D3D_SHADER_MACRO* d = defines; d && d->Name; d++)
+            s.defines.emplace_back(d->Name, d->Definition ? d->Definition : "");
+        capture->create_shader(s, shader);
+    }
 }
 
 void D3D11_Compute_Shader::init_from_file(ID3D11Device* device, const char* file_path, const char* entry_point, const D3D_SHADER_MACRO* defines)
@@ -141,13 +203,16 @@ void D3D11_Compute_Shader::init_from_file(ID3D11Device* device, const char* file
         shader = nullptr;
         return;
     }
-    init_from_code_string(device, shader_code.c_str(), entry_point, defines);
+    compile(device, shader_code.c_str(), entry_point, defines, file_path);
 }
 
 void D3D11_Compute_Shader::release()
 {
+    if (shader && command_capture())
+        command_capture()->forget(shader);
     if (shader) shader->Release();
     shader = nullptr;
+    bindings.clear();
 }
 
 void D3D11_Constant_Buffer::init(ID3D11Device* device, size_t bytes)
@@ -172,6 +237,8 @@ void D3D11_Constant_Buffer::init(ID3D11Device* device, size_t bytes)
         p_buffer = nullptr;
         return;
     }
+    metrics().add(device_metrics().allocated_bytes, (int64_t)blob_size);
+    metrics().add(device_metrics().allocations);
 }
 
 void D3D11_Constant_Buffer::to_gpu(ID3D11DeviceContext* context, const void* data)
@@ -183,15 +250,124 @@ void D3D11_Constant_Buffer::to_gpu(ID3D11DeviceContext* context, const void* dat
     }
     memcpy(mapped_resource.pData, data, blob_size);
     context->Unmap(p_buffer, 0);
+    metrics().add(device_metrics().constant_uploads);
+    metrics().add(device_metrics().constant_upload_bytes, (int64_t)blob_size);
+    if (Command_Recorder* capture = command_capture())
+        capture->set_constants(p_buffer, data, blob_size);
 }
 
 void D3D11_Constant_Buffer::release()
 {
+    if (p_buffer) {
+        if (command_capture())
+            command_capture()->forget(p_buffer);
+        p_buffer->Release();
+        metrics().add(device_metrics().allocated_bytes, -(int64_t)blob_size);
+    }
+    p_buffer = nullptr;
+}
+
+void D3D11_Structured_Buffer::init(ID3D11Device* device, size_t __element_size, size_t __count, bool staging)
+{
+    release();
+    element_size = __element_size;
+    count = __count;
+
+    D3D11_BUFFER_DESC desc = {};
+    desc.ByteWidth = (UINT)(element_size * count);
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+    desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    desc.StructureByteStride = (UINT)element_size;
+    if (FAILED(device->CreateBuffer(&desc, nullptr, &p_buffer))) {
+        std::cerr << "Failed to create structured buffer." << std::endl;
+        release();
+        return;
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+    srv_desc.Format = DXGI_FORMAT_UNKNOWN;
+    srv_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+    srv_desc.Buffer.FirstElement = 0;
+    srv_desc.Buffer.NumElements = (UINT)count;
+    D3D11_UNORDERED_ACCESS_VIEW_DESC uav_desc = {};
+    uav_desc.Format = DXGI_FORMAT_UNKNOWN;
+    uav_desc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+    uav_desc.Buffer.FirstElement = 0;
+    uav_desc.Buffer.NumElements = (UINT)count;
+    if (FAILED(device->CreateShaderResourceView(p_buffer, &srv_desc, &p_srv)) ||
+        FAILED(device->CreateUnorderedAccessView(p_buffer, &uav_desc, &p_uav))) {
+        std::cerr << "Failed to create structured buffer views." << std::endl;
+        release();
+        return;
+    }
+
+    if (staging) {
+        D3D11_BUFFER_DESC staging_desc = {};
+        staging_desc.ByteWidth = desc.ByteWidth;
+        staging_desc.Usage = D3D11_USAGE_STAGING;
+        staging_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        if (FAILED(device->CreateBuffer(&staging_desc, nullptr, &p_staging))) {
+            std::cerr << "Failed to create structured staging buffer." << std::endl;
+            release();
+            return;
+        }
+    }
+    metrics().add(device_metrics().allocated_bytes, (int64_t)(element_size * count * (staging ? 2 : 1)));
+    metrics().add(device_metrics().allocations);
+}
+
+void D3D11_Structured_Buffer::to_gpu(ID3D11DeviceContext* context, const void* data, size_t elements)
+{
+    if (elements == 0 || elements > count)
+        elements = count;
+    D3D11_BOX box = { 0, 0, 0, (UINT)(elements * element_size), 1, 1 };
+    context->UpdateSubresource(p_buffer, 0, &box, data, 0, 0);
+    metrics().add(device_metrics().uploads);
+    metrics().add(device_metrics().upload_bytes, (int64_t)(elements * element_size));
+}
+
+bool D3D11_Structured_Buffer::to_cpu(ID3D11DeviceContext* context, void* dst, size_t elements)
+{
+    if (p_staging == nullptr) {
+        std::cerr << "Structured buffer has no staging copy." << std::endl;
+        return false;
+    }
+    if (elements == 0 || elements > count)
+        elements = count;
+    // Only the requested prefix crosses the bus
+    D3D11_BOX box = { 0, 0, 0, (UINT)(elements * element_size), 1, 1 };
+    context->CopySubresourceRegion(p_staging, 0, 0, 0, 0, p_buffer, 0, &box);
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    Metrics_Stopwatch stall;
+    if (FAILED(context->Map(p_staging, 0, D3D11_MAP_READ, 0, &mapped))) {
+        std::cerr << "Failed to map structured staging buffer." << std::endl;
+        return false;
+    }
+    metrics().observe(device_metrics().map_stall_us, stall.elapsed_us());
+    memcpy(dst, mapped.pData, elements * element_size);
+    context->Unmap(p_staging, 0);
+    metrics().add(device_metrics().downloads);
+    metrics().add(device_metrics().download_bytes, (int64_t)(elements * element_size));
+    return true;
+}
+
+void D3D11_Structured_Buffer::release()
+{
+    // Only a fully created buffer was counted
+    if (p_uav)
+        metrics().add(device_metrics().allocated_bytes, -(int64_t)(element_size * count * (p_staging ? 2 : 1)));
+    if (p_uav) p_uav->Release();
+    if (p_srv) p_srv->Release();
     if (p_buffer) p_buffer->Release();
+    if (p_staging) p_staging->Release();
+    p_uav = nullptr;
+    p_srv = nullptr;
     p_buffer = nullptr;
+    p_staging = nullptr;
 }
 
-void D3D11_Performance_Counter::init(ID3D11Device* device)
+void D3D11_Performance_Counter::init(ID3D11Device* device, bool pipeline_statistics)
 {
     D3D11_QUERY_DESC query_desc = {};
     query_desc.Query = D3D11_QUERY_TIMESTAMP;
@@ -221,6 +397,14 @@ void D3D11_Performance_Counter::init(ID3D11Device* device)
         p_disjoint_query = nullptr;
         return;
     }
+
+    // Timing still works without statistics, kernel_metrics() then assumes every launched thread ran
+    D3D11_QUERY_DESC statistics_desc = {};
+    statistics_desc.Query = D3D11_QUERY_PIPELINE_STATISTICS;
+    if (pipeline_statistics && FAILED(device->CreateQuery(&statistics_desc, &p_statistics_query))) {
+        std::cerr << "Failed to create pipeline statistics query." << std::endl;
+        p_statistics_query = nullptr;
+    }
 }
 
 void D3D11_Performance_Counter::counter_start(ID3D11DeviceContext* context)
@@ -237,6 +421,8 @@ void D3D11_Performance_Counter::counter_start(ID3D11DeviceContext* context)
     
     context->Flush();
     context->Begin(p_disjoint_query);
+    if (p_statistics_query)
+        context->Begin(p_statistics_query);
     context->End(p_start_query);
     performance_counter_initialized = true;
 }
@@ -250,6 +436,8 @@ double D3D11_Performance_Counter::counter_stop(ID3D11DeviceContext* context)
 
     context->Flush();
     context->End(p_end_query);
+    if (p_statistics_query)
+        context->End(p_statistics_query);
     context->End(p_disjoint_query);
     performance_counter_initialized = false;
     
@@ -262,10 +450,16 @@ double D3D11_Performance_Counter::counter_stop(ID3D11DeviceContext* context)
     while (context->GetData(p_disjoint_query, &disjoint_data, sizeof(disjoint_data), 0) == S_FALSE) {}
     while (context->GetData(p_start_query, &start_time, sizeof(start_time), 0) == S_FALSE) {}
     while (context->GetData(p_end_query, &end_time, sizeof(end_time), 0) == S_FALSE) {}
+    statistics = D3D11_QUERY_DATA_PIPELINE_STATISTICS();
+    if (p_statistics_query)
+        while (context->GetData(p_statistics_query, &statistics, sizeof(statistics), 0) == S_FALSE) {}
+    last_ms = 0.0;
 
     // Calculate time in milliseconds
     if (!disjoint_data.Disjoint) {
-        return (end_time - start_time) * 1000.0 / disjoint_data.Frequency; // Return time in milliseconds
+        last_ms = (end_time - start_time) * 1000.0 / disjoint_data.Frequency; // Return time in milliseconds
+        metrics().observe(device_metrics().gpu_time_ms, last_ms);
+        return last_ms;
     }
     else {  
         std::cerr << "Timestamp discontinuity detected, results may be invalid." << std::endl;
@@ -280,9 +474,11 @@ void D3D11_Performance_Counter::release()
     if (p_start_query) p_start_query->Release();
     if (p_end_query) p_end_query->Release();
     if (p_disjoint_query) p_disjoint_query->Release();
+    if (p_statistics_query) p_statistics_query->Release();
     p_start_query = nullptr;
     p_end_query = nullptr;
     p_disjoint_query = nullptr;
+    p_statistics_query = nullptr;
 }
 
 
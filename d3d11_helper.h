@@ -2,6 +2,9 @@
 
 #include <d3d11.h>
 #include <string>
+#include <vector>
+#include "binding_table.h"
+#include "kernel_stats.h"
 
 struct D3D11_Device_Resources 
 {
@@ -20,6 +23,7 @@ struct D3D11_Device_Resources
 struct D3D11_Compute_Shader 
 {
     ID3D11ComputeShader* shader = nullptr;
+    std::vector<Shader_Binding> bindings;  // SRV/UAV/constant buffer registers, reflected at compile time
     void init_from_code_string(ID3D11Device* device, const char* shader_code, const char* entry_point, const D3D_SHADER_MACRO* defines = nullptr);
     void init_from_file(ID3D11Device* device, const char* file_path, const char* entry_point, const D3D_SHADER_MACRO* defines = nullptr);
     void release();
@@ -29,6 +33,9 @@ struct D3D11_Compute_Shader
     }
 private:
     bool debug_mode = false; // Sets flag D3DCOMPILE_DEBUG and D3DCOMPILE_SKIP_OPTIMIZATION if true
+
+    // file_path is only used to name the shader in a command capture
+    void compile(ID3D11Device* device, const char* shader_code, const char* entry_point, const D3D_SHADER_MACRO* defines, const char* file_path);
 };
 
 struct D3D11_Constant_Buffer 
@@ -45,11 +52,42 @@ private:
     size_t blob_size;
 };
 
+// StructuredBuffer<T> / RWStructuredBuffer<T> with default views and an optional staging copy for readback
+struct D3D11_Structured_Buffer 
+{
+    ID3D11Buffer* p_buffer = nullptr;
+    ID3D11ShaderResourceView* p_srv = nullptr;
+    ID3D11UnorderedAccessView* p_uav = nullptr;
+    size_t element_size = 0;
+    size_t count = 0;
+    void init(ID3D11Device* device, size_t __element_size, size_t __count, bool staging = false);
+    // Upload the first elements (all if 0) from host memory
+    void to_gpu(ID3D11DeviceContext* context, const void* data, size_t elements = 0);
+    // Copy the first elements (all if 0) back to host memory, needs staging
+    bool to_cpu(ID3D11DeviceContext* context, void* dst, size_t elements = 0);
+    void release();
+    ~D3D11_Structured_Buffer() 
+    {
+        release();
+    }
+private:
+    ID3D11Buffer* p_staging = nullptr;
+};
+
+// GPU timestamps around a region, optionally with the pipeline statistics (CSInvocations) of the same region
 struct D3D11_Performance_Counter
 {
-    void init(ID3D11Device* device);
+    D3D11_QUERY_DATA_PIPELINE_STATISTICS statistics = {};  // Of the last region, zero without pipeline_statistics
+    double last_ms = 0.0;
+
+    void init(ID3D11Device* device, bool pipeline_statistics = false);
     void counter_start(ID3D11DeviceContext* context);
     double counter_stop(ID3D11DeviceContext* context);
+    // Derived metrics of the last region, taken as the dispatch of shape doing work
+    Kernel_Metrics kernel_metrics(const Kernel_Shape& shape, const Kernel_Work& work, const Device_Peaks& peaks = Device_Peaks()) const
+    {
+        return derive_kernel_metrics(shape, work, last_ms, statistics.CSInvocations, peaks);
+    }
     void release();
     ~D3D11_Performance_Counter()
     {
@@ -59,5 +97,6 @@ private:
     ID3D11Query* p_start_query = nullptr;
     ID3D11Query* p_end_query = nullptr;
     ID3D11Query* p_disjoint_query = nullptr;
+    ID3D11Query* p_statistics_query = nullptr;
     bool performance_counter_initialized = false;
 };
@@ -0,0 +1,96 @@
+#include "d3d11_indirect.h"
+#include "metrics.h"
+#include "command_stream.h"
+#include <iostream>
+
+void D3D11_Indirect_Dispatch::init(ID3D11Device* device, size_t __slots)
+{
+    release();
+    slots = __slots;
+
+    D3D11_BUFFER_DESC desc = {};
+    desc.ByteWidth = (UINT)(slots * dispatch_args_bytes);
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+    desc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS | D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+    D3D11_UNORDERED_ACCESS_VIEW_DESC uav_desc = {};
+    uav_desc.Format = DXGI_FORMAT_R32_TYPELESS;
+    uav_desc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+    uav_desc.Buffer.FirstElement = 0;
+    uav_desc.Buffer.NumElements = (UINT)(slots * 3);
+    uav_desc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_RAW;
+    D3D11_BUFFER_DESC staging_desc = {};
+    staging_desc.ByteWidth = desc.ByteWidth;
+    staging_desc.Usage = D3D11_USAGE_STAGING;
+    staging_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    if (FAILED(device->CreateBuffer(&desc, nullptr, &p_args)) ||
+        FAILED(device->CreateUnorderedAccessView(p_args, &uav_desc, &p_args_uav)) ||
+        FAILED(device->CreateBuffer(&staging_desc, nullptr, &p_staging))) {
+        std::cout << "Failed to create indirect argument buffer." << std::endl;
+        release();
+        return;
+    }
+
+    args_shader.init_from_file(device, "shaders/indirect.hlsl", "args_from_count_main");
+    m_constants.init(device, sizeof(Indirect_Constants));
+    args_table.init(args_shader);
+    args_table.set_cb("Indirect_Constants", m_constants.p_buffer);
+    args_table.set_uav("args_out", p_args_uav);
+}
+
+bool D3D11_Indirect_Dispatch::args_from_count(ID3D11DeviceContext* context, const D3D11_Structured_Buffer& count_buffer, UINT items_per_group, size_t slot, UINT count_index)
+{
+    if (p_args == nullptr || slot >= slots || items_per_group == 0 || count_index >= count_buffer.count) {
+        std::cout << "Failed to write dispatch args, init() first and pass a slot below " << slots << " and a count inside the buffer." << std::endl;
+        return false;
+    }
+    Indirect_Constants c = {};
+    c.items_per_group = items_per_group;
+    c.args_offset = byte_offset(slot);
+    c.count_index = count_index;
+    m_constants.to_gpu(context, &c);
+    args_table.set_srv("count_in", count_buffer.p_srv);
+    bindings.dispatch(context, args_table, 1, 1, 1);
+    // The argument buffer cannot be consumed while it is still bound as a UAV
+    bindings.clear(context);
+    return true;
+}
+
+void D3D11_Indirect_Dispatch::dispatch(ID3D11DeviceContext* context, size_t slot)
+{
+    context->DispatchIndirect(p_args, byte_offset(slot));
+    metrics().add(device_metrics().dispatches);
+    // Group counts live on the device, so the marker carries none
+    capture_unreplayable_dispatch("D3D11_Indirect_Dispatch::dispatch", 0, 0, 0);
+}
+
+bool D3D11_Indirect_Dispatch::args_to_cpu(ID3D11DeviceContext* context, size_t slot, Dispatch_Args& args)
+{
+    if (p_args == nullptr || slot >= slots)
+        return false;
+    context->CopyResource(p_staging, p_args);
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    if (FAILED(context->Map(p_staging, 0, D3D11_MAP_READ, 0, &mapped))) {
+        std::cout << "Failed to map indirect argument staging buffer." << std::endl;
+        return false;
+    }
+    const uint32_t* p = (const uint32_t*)((const unsigned char*)mapped.pData + byte_offset(slot));
+    args.x = p[0];
+    args.y = p[1];
+    args.z = p[2];
+    context->Unmap(p_staging, 0);
+    return true;
+}
+
+void D3D11_Indirect_Dispatch::release()
+{
+    if (p_args_uav) p_args_uav->Release();
+    if (p_args) p_args->Release();
+    if (p_staging) p_staging->Release();
+    p_args_uav = nullptr;
+    p_args = nullptr;
+    p_staging = nullptr;
+    slots = 0;
+    args_shader.release();
+    m_constants.release();
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <d3d11.h>
+#include "indirect_dispatch.h"
+#include "d3d11_helper.h"
+#include "d3d11_binding_table.h"
+
+/* 
+ * Device indirect dispatch (shaders/indirect.hlsl). The argument buffer holds
+ * slots of DispatchIndirect arguments and has a raw UAV, so any kernel can write
+ * group counts into it; args_from_count() is the common case, turning an item count
+ * left in a buffer by an earlier pass (e.g. D3D11_Scan::compacted_count) into the
+ * groups that cover it. dispatch() then consumes a slot with DispatchIndirect, and
+ * a compaction followed by processing of the survivors runs without the CPU ever
+ * waiting for the count.
+ *
+ * The consuming kernel reads the count itself to mask its last group, and recovers
+ * its linear group as Gid.y * 65535 + Gid.x (see indirect_dispatch.h).
+ */
+struct D3D11_Indirect_Dispatch
+{
+    ID3D11Buffer* p_args = nullptr;
+    ID3D11UnorderedAccessView* p_args_uav = nullptr;    // Raw, for kernels writing their own arguments
+    size_t slots = 0;
+
+    void init(ID3D11Device* device, size_t __slots = 4);
+    // Write into slot the groups covering count_buffer[count_index] items of items_per_group each
+    bool args_from_count(ID3D11DeviceContext* context, const D3D11_Structured_Buffer& count_buffer, UINT items_per_group, size_t slot, UINT count_index = 0);
+    // DispatchIndirect with the arguments of slot; the caller binds the consuming shader and its views
+    void dispatch(ID3D11DeviceContext* context, size_t slot);
+    // Read back a slot's arguments (stalls, for tests)
+    bool args_to_cpu(ID3D11DeviceContext* context, size_t slot, Dispatch_Args& args);
+    static UINT byte_offset(size_t slot)
+    {
+        return (UINT)(slot * dispatch_args_bytes);
+    }
+    void release();
+    ~D3D11_Indirect_Dispatch()
+    {
+        release();
+    }
+private:
+    struct Indirect_Constants
+    {
+        UINT items_per_group;
+        UINT args_offset;
+        UINT count_index;
+        UINT align_padding;
+    };
+
+    ID3D11Buffer* p_staging = nullptr;
+    D3D11_Compute_Shader args_shader;
+    D3D11_Binding_Table args_table;
+    D3D11_Binding_State bindings;
+    D3D11_Constant_Buffer m_constants;
+};
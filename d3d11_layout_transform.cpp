@@ -0,0 +1,161 @@
+#include "d3d11_layout_transform.h"
+#include <iostream>
+#include <cstring>
+
+void D3D11_Layout_Transform::init(ID3D11Device* device, ID3D11DeviceContext* context, size_t __channels, size_t __height, size_t __width, DXGI_FORMAT __format)
+{
+    release();
+    switch (__format) {
+        case DXGI_FORMAT_R8_UNORM:
+            element_size = 1;
+            break;
+        case DXGI_FORMAT_R16_FLOAT:
+            element_size = 2;
+            break;
+        case DXGI_FORMAT_R32_FLOAT:
+            element_size = 4;
+            break;
+        default:
+            std::cout << "Failed to init layout transform, format must be R8_UNORM, R16_FLOAT or R32_FLOAT." << std::endl;
+            return;
+    }
+    if (__channels * __height * __width == 0) {
+        std::cout << "Failed to init layout transform. Channels, Height, Width must be non-zero." << std::endl;
+        return;
+    }
+    channels = __channels;
+    height = __height;
+    width = __width;
+    format = __format;
+
+    D3D11_BUFFER_DESC desc = {};
+    desc.ByteWidth = (UINT)bytes();
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+    D3D11_BUFFER_DESC staging_desc = {};
+    staging_desc.ByteWidth = desc.ByteWidth;
+    staging_desc.Usage = D3D11_USAGE_STAGING;
+    staging_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+    // Typed views, so the kernels load and store elements in the texture's format
+    D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+    srv_desc.Format = format;
+    srv_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+    srv_desc.Buffer.FirstElement = 0;
+    srv_desc.Buffer.NumElements = (UINT)(channels * height * width);
+    D3D11_UNORDERED_ACCESS_VIEW_DESC uav_desc = {};
+    uav_desc.Format = format;
+    uav_desc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+    uav_desc.Buffer.FirstElement = 0;
+    uav_desc.Buffer.NumElements = srv_desc.Buffer.NumElements;
+    if (FAILED(device->CreateBuffer(&desc, nullptr, &p_buffer)) || FAILED(device->CreateBuffer(&staging_desc, nullptr, &p_staging)) ||
+        FAILED(device->CreateShaderResourceView(p_buffer, &srv_desc, &p_srv)) || FAILED(device->CreateUnorderedAccessView(p_buffer, &uav_desc, &p_uav))) {
+        std::cout << "Failed to create layout transform buffer." << std::endl;
+        release();
+        return;
+    }
+
+    Layout_Constants c = {};
+    c.channels = (UINT)channels;
+    c.height = (UINT)height;
+    c.width = (UINT)width;
+    m_constants.init(device, sizeof(Layout_Constants));
+    m_constants.to_gpu(context, &c);
+
+    D3D_SHADER_MACRO defines[2] = { { "ELEMENT", format == DXGI_FORMAT_R8_UNORM ? "unorm float" : "float" }, { nullptr, nullptr } };
+    planar_shader.init_from_file(device, "shaders/layout_transform.hlsl", "hwc_to_chw_main", defines);
+    hwc_shader.init_from_file(device, "shaders/layout_transform.hlsl", "chw_to_hwc_main", defines);
+    planar_table.init(planar_shader);
+    planar_table.set_srv("hwc_in", p_srv);
+    planar_table.set_cb("Layout_Constants", m_constants.p_buffer);
+    hwc_table.init(hwc_shader);
+    hwc_table.set_uav("hwc_out", p_uav);
+    hwc_table.set_cb("Layout_Constants", m_constants.p_buffer);
+}
+
+bool D3D11_Layout_Transform::matches(const Texture_As_Buffer& texture) const
+{
+    if (p_buffer == nullptr || texture.p_texture == nullptr) {
+        std::cout << "Failed to transform layout, init() the transform and the texture first." << std::endl;
+        return false;
+    }
+    // Same-sized formats differ in how the kernels load and store them (R32_FLOAT vs R8G8B8A8_UNORM), so compare the format itself
+    D3D11_TEXTURE2D_DESC desc;
+    texture.p_texture->GetDesc(&desc);
+    if (texture.layout != TEXTURE_PLANAR || texture.channels != channels || texture.height != height ||
+        texture.width != width || desc.Format != format) {
+        std::cout << "Failed to transform layout, texture " << texture.print_shape() << " does not match." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void D3D11_Layout_Transform::upload(ID3D11DeviceContext* context, const void* hwc)
+{
+    D3D11_BOX box = { 0, 0, 0, (UINT)bytes(), 1, 1 };
+    context->UpdateSubresource(p_buffer, 0, &box, hwc, 0, 0);
+}
+
+bool D3D11_Layout_Transform::to_planar(ID3D11DeviceContext* context, Texture_As_Buffer& texture)
+{
+    if (!matches(texture) || texture.p_texture_uav == nullptr)
+        return false;
+    planar_table.set_uav("chw_out", texture.p_texture_uav);
+    bindings.dispatch(context, planar_table, (UINT)((width + 15) / 16), (UINT)((height + 15) / 16), (UINT)channels);
+    bindings.clear(context);
+    return true;
+}
+
+bool D3D11_Layout_Transform::to_hwc(ID3D11DeviceContext* context, const Texture_As_Buffer& texture)
+{
+    if (!matches(texture))
+        return false;
+    hwc_table.set_srv("chw_in", texture.p_texture_srv);
+    bindings.dispatch(context, hwc_table, (UINT)((width + 15) / 16), (UINT)((height + 15) / 16), (UINT)channels);
+    bindings.clear(context);
+    return true;
+}
+
+bool D3D11_Layout_Transform::download(ID3D11DeviceContext* context, void* hwc)
+{
+    if (p_staging == nullptr || hwc == nullptr)
+        return false;
+    context->CopyResource(p_staging, p_buffer);
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    if (FAILED(context->Map(p_staging, 0, D3D11_MAP_READ, 0, &mapped))) {
+        std::cout << "Failed to map layout transform staging buffer." << std::endl;
+        return false;
+    }
+    memcpy(hwc, mapped.pData, bytes());
+    context->Unmap(p_staging, 0);
+    return true;
+}
+
+bool D3D11_Layout_Transform::hwc_to_gpu(ID3D11DeviceContext* context, const void* hwc, Texture_As_Buffer& texture)
+{
+    if (!matches(texture))
+        return false;
+    upload(context, hwc);
+    return to_planar(context, texture);
+}
+
+bool D3D11_Layout_Transform::hwc_to_cpu(ID3D11DeviceContext* context, const Texture_As_Buffer& texture, void* hwc)
+{
+    return to_hwc(context, texture) && download(context, hwc);
+}
+
+void D3D11_Layout_Transform::release()
+{
+    if (p_srv) p_srv->Release();
+    if (p_uav) p_uav->Release();
+    if (p_buffer) p_buffer->Release();
+    if (p_staging) p_staging->Release();
+    p_srv = nullptr;
+    p_uav = nullptr;
+    p_buffer = nullptr;
+    p_staging = nullptr;
+    format = DXGI_FORMAT_UNKNOWN;
+    planar_shader.release();
+    hwc_shader.release();
+    m_constants.release();
+}
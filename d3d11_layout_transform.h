@@ -0,0 +1,65 @@
+#pragma once
+#include <d3d11.h>
+#include "layout_transform.h"
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+#include "d3d11_binding_table.h"
+
+/* 
+ * Device side of layout_transform.h (shaders/layout_transform.hlsl). HWC data is
+ * uploaded as-is into a typed buffer of the texture's element format and a kernel
+ * rearranges it into the planar texture array, so the host does a plain copy and
+ * the transpose runs at device bandwidth; the reverse direction fills the buffer
+ * from a texture and downloads it as HWC. Single-channel planar textures only
+ * (R8_UNORM, R16_FLOAT, R32_FLOAT); for others use Texture_As_Buffer::to_gpu_hwc().
+ */
+struct D3D11_Layout_Transform
+{
+    ID3D11Buffer* p_buffer = nullptr;       // channels * height * width elements in HWC order
+    ID3D11ShaderResourceView* p_srv = nullptr;
+    ID3D11UnorderedAccessView* p_uav = nullptr;
+    size_t channels = 0;
+    size_t height = 0;
+    size_t width = 0;
+    size_t element_size = 0;
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;   // Element format of the buffer views, textures must match it
+
+    void init(ID3D11Device* device, ID3D11DeviceContext* context, size_t __channels, size_t __height, size_t __width, DXGI_FORMAT __format);
+    // Copy HWC host data into the buffer unchanged
+    void upload(ID3D11DeviceContext* context, const void* hwc);
+    // Buffer -> planar texture of the same shape and format, and back
+    bool to_planar(ID3D11DeviceContext* context, Texture_As_Buffer& texture);
+    bool to_hwc(ID3D11DeviceContext* context, const Texture_As_Buffer& texture);
+    // Read the buffer back as HWC host data
+    bool download(ID3D11DeviceContext* context, void* hwc);
+    // upload() then to_planar(), and to_hwc() then download()
+    bool hwc_to_gpu(ID3D11DeviceContext* context, const void* hwc, Texture_As_Buffer& texture);
+    bool hwc_to_cpu(ID3D11DeviceContext* context, const Texture_As_Buffer& texture, void* hwc);
+    size_t bytes() const
+    {
+        return channels * height * width * element_size;
+    }
+    void release();
+    ~D3D11_Layout_Transform()
+    {
+        release();
+    }
+private:
+    struct Layout_Constants
+    {
+        UINT channels;
+        UINT height;
+        UINT width;
+        UINT align_padding;
+    };
+
+    bool matches(const Texture_As_Buffer& texture) const;
+
+    ID3D11Buffer* p_staging = nullptr;
+    D3D11_Compute_Shader planar_shader;
+    D3D11_Compute_Shader hwc_shader;
+    D3D11_Binding_Table planar_table;
+    D3D11_Binding_Table hwc_table;
+    D3D11_Binding_State bindings;
+    D3D11_Constant_Buffer m_constants;
+};
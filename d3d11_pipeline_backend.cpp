@@ -0,0 +1,166 @@
+#include "d3d11_pipeline_backend.h"
+#include "metrics.h"
+#include "command_stream.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <cstring>
+
+void D3D11_Pipeline_Backend::init(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11ComputeShader* shader, DXGI_FORMAT in_format, DXGI_FORMAT out_format,
+    size_t channels, size_t height, size_t width, UINT block_x, UINT block_y)
+{
+    m_device = device;
+    m_context = context;
+    m_shader = shader;
+    m_in_format = in_format;
+    m_out_format = out_format;
+    m_channels = channels;
+    m_height = height;
+    m_width = width;
+    m_block_x = block_x;
+    m_block_y = block_y;
+}
+
+bool D3D11_Pipeline_Backend::init_slots(size_t slot_count)
+{
+    release();
+    if (m_device == nullptr || m_shader == nullptr) {
+        std::cout << "Cannot allocate pipeline slots, init() backend first." << std::endl;
+        return false;
+    }
+
+    n_slots = slot_count;
+    in_slots = new Texture_As_Buffer[slot_count];
+    out_slots = new Texture_As_Buffer[slot_count];
+    done_queries = new ID3D11Query*[slot_count]();
+    D3D11_QUERY_DESC query_desc = { D3D11_QUERY_EVENT, 0 };
+    for (size_t i = 0; i < slot_count; i++) {
+        in_slots[i].init(m_device, m_channels, m_height, m_width, m_in_format);
+        in_slots[i].init_staging(m_device);
+        out_slots[i].init(m_device, m_channels, m_height, m_width, m_out_format);
+        out_slots[i].init_staging(m_device);
+        HRESULT hr = m_device->CreateQuery(&query_desc, &done_queries[i]);
+        if (in_slots[i].p_texture == nullptr || out_slots[i].p_texture == nullptr || FAILED(hr)) {
+            std::cout << "Failed to allocate pipeline slot " << i << "." << std::endl;
+            release();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool D3D11_Pipeline_Backend::upload(size_t slot, const Pipeline_Item& item)
+{
+    if (item.in_bytes != m_channels * m_height * m_width * in_slots[slot].element_size) {
+        std::cout << "Pipeline item " << item.id << " does not match the slot shape." << std::endl;
+        return false;
+    }
+    // Only map, unmap and the staging copy need the context; the slot's staging texture belongs to this
+    // stage until then, so the rows are copied without the lock while the other stages use the context
+    Texture_As_Buffer& tab = in_slots[slot];
+    std::vector<D3D11_MAPPED_SUBRESOURCE> mapped;
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(context_mutex);
+        ok = tab.map_slices(m_context, D3D11_MAP_WRITE, mapped);
+    }
+    if (!ok) {
+        std::cout << "Failed to map the upload staging of pipeline item " << item.id << "." << std::endl;
+        return false;
+    }
+    const unsigned char* src = (const unsigned char*)item.in;
+    const size_t rows = tab.slice_pitch() / tab.row_pitch();
+    for (size_t c_idx = 0; c_idx < m_channels; c_idx++)
+        for (size_t h_idx = 0; h_idx < rows; h_idx++)
+            memcpy((unsigned char*)mapped[c_idx].pData + h_idx * mapped[c_idx].RowPitch, src + c_idx * tab.slice_pitch() + h_idx * tab.row_pitch(), tab.row_pitch());
+    std::lock_guard<std::mutex> lock(context_mutex);
+    tab.unmap_slices(m_context, D3D11_MAP_WRITE);
+    return true;
+}
+
+bool D3D11_Pipeline_Backend::dispatch(size_t slot, const Pipeline_Item& item)
+{
+    std::lock_guard<std::mutex> lock(context_mutex);
+    m_context->CSSetShader(m_shader, nullptr, 0);
+    m_context->CSSetShaderResources(0, 1, &in_slots[slot].p_texture_srv);
+    m_context->CSSetUnorderedAccessViews(0, 1, &out_slots[slot].p_texture_uav, nullptr);
+    UINT dispatchX = ((UINT)m_width + m_block_x - 1) / m_block_x;
+    UINT dispatchY = ((UINT)m_height + m_block_y - 1) / m_block_y;
+    m_context->Dispatch(dispatchX, dispatchY, 1);
+    count_dispatch(dispatchX, dispatchY, 1);
+    capture_unreplayable_dispatch("D3D11_Pipeline_Backend::dispatch", dispatchX, dispatchY, 1);
+
+    ID3D11UnorderedAccessView* nullUAV[1] = { nullptr };
+    m_context->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
+    ID3D11ShaderResourceView* nullSRV[1] = { nullptr };
+    m_context->CSSetShaderResources(0, 1, nullSRV);
+
+    // Queue the staging copy and mark its completion, readback() waits on the query
+    out_slots[slot].begin_to_cpu(m_context);
+    m_context->End(done_queries[slot]);
+    m_context->Flush();
+    return true;
+}
+
+bool D3D11_Pipeline_Backend::readback(size_t slot, const Pipeline_Item& item)
+{
+    if (item.out_bytes != m_channels * m_height * m_width * out_slots[slot].element_size) {
+        std::cout << "Pipeline item " << item.id << " does not match the slot shape." << std::endl;
+        return false;
+    }
+
+    // Poll without holding the context between attempts
+    while (true) {
+        HRESULT hr;
+        {
+            std::lock_guard<std::mutex> lock(context_mutex);
+            hr = m_context->GetData(done_queries[slot], nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH);
+        }
+        if (hr == S_OK)
+            break;
+        if (FAILED(hr)) {
+            std::cout << "Failed to wait for pipeline item " << item.id << "." << std::endl;
+            return false;
+        }
+        std::this_thread::yield();
+    }
+
+    // As in upload(), the rows are copied out of the mapped staging texture without the lock
+    Texture_As_Buffer& tab = out_slots[slot];
+    std::vector<D3D11_MAPPED_SUBRESOURCE> mapped;
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(context_mutex);
+        ok = tab.map_slices(m_context, D3D11_MAP_READ, mapped);
+    }
+    if (!ok) {
+        std::cout << "Failed to map the readback staging of pipeline item " << item.id << "." << std::endl;
+        return false;
+    }
+    unsigned char* dst = (unsigned char*)item.out;
+    const size_t rows = tab.slice_pitch() / tab.row_pitch();
+    for (size_t c_idx = 0; c_idx < m_channels; c_idx++)
+        for (size_t h_idx = 0; h_idx < rows; h_idx++)
+            memcpy(dst + c_idx * tab.slice_pitch() + h_idx * tab.row_pitch(), (const unsigned char*)mapped[c_idx].pData + h_idx * mapped[c_idx].RowPitch, tab.row_pitch());
+    std::lock_guard<std::mutex> lock(context_mutex);
+    tab.unmap_slices(m_context, D3D11_MAP_READ);
+    return true;
+}
+
+void D3D11_Pipeline_Backend::release()
+{
+    for (size_t i = 0; done_queries && i < n_slots; i++)
+        if (done_queries[i])
+            done_queries[i]->Release();
+    if (done_queries)
+        delete[] done_queries;
+    if (in_slots)
+        delete[] in_slots;
+    if (out_slots)
+        delete[] out_slots;
+
+    done_queries = nullptr;
+    in_slots = nullptr;
+    out_slots = nullptr;
+    n_slots = 0;
+}
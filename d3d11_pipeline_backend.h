@@ -0,0 +1,49 @@
+#pragma once
+#include <d3d11.h>
+#include <mutex>
+#include "pipeline_scheduler.h"
+#include "texture_as_buffer.h"
+
+/* 
+ * Pipeline_Backend over a D3D11 device. Every slot is an input and output
+ * Texture_As_Buffer of one fixed shape plus an event query. The immediate context
+ * is shared by the three stage threads, so each context call is made under a lock;
+ * the host copies into and out of a slot's mapped staging texture run without it.
+ * Readback polls the slot's event query without holding the lock and only maps the
+ * staging copy once the GPU has finished it, so waiting for one item never stalls
+ * the upload or dispatch of the others.
+ * Input texture is bound to t0, output texture to u0; the shader is dispatched over
+ * ceil(width / block_x) x ceil(height / block_y) groups and loops over channels.
+ */
+struct D3D11_Pipeline_Backend : Pipeline_Backend
+{
+    void init(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11ComputeShader* shader, DXGI_FORMAT in_format, DXGI_FORMAT out_format,
+        size_t channels, size_t height, size_t width, UINT block_x, UINT block_y);
+
+    bool init_slots(size_t slot_count) override;
+    bool upload(size_t slot, const Pipeline_Item& item) override;
+    bool dispatch(size_t slot, const Pipeline_Item& item) override;
+    bool readback(size_t slot, const Pipeline_Item& item) override;
+    void release() override;
+
+    ~D3D11_Pipeline_Backend()
+    {
+        release();
+    }
+private:
+    ID3D11Device* m_device = nullptr;
+    ID3D11DeviceContext* m_context = nullptr;
+    ID3D11ComputeShader* m_shader = nullptr;
+    DXGI_FORMAT m_in_format = DXGI_FORMAT_UNKNOWN;
+    DXGI_FORMAT m_out_format = DXGI_FORMAT_UNKNOWN;
+    size_t m_channels = 0;
+    size_t m_height = 0;
+    size_t m_width = 0;
+    UINT m_block_x = 16;
+    UINT m_block_y = 16;
+    Texture_As_Buffer* in_slots = nullptr;
+    Texture_As_Buffer* out_slots = nullptr;
+    ID3D11Query** done_queries = nullptr;
+    size_t n_slots = 0;
+    std::mutex context_mutex;
+};
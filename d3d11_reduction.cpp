@@ -0,0 +1,121 @@
+#include "d3d11_reduction.h"
+#include <iostream>
+#include <string>
+
+void D3D11_Reduction::init(ID3D11Device* device, UINT __group_size)
+{
+    release();
+    if (__group_size < 64 || __group_size > 1024 || (__group_size & (__group_size - 1)) != 0) {
+        std::cout << "Failed to initialize reduction. Group size must be a power of two from 64 to 1024." << std::endl;
+        return;
+    }
+    m_device = device;
+    group_size = __group_size;
+
+    std::string group_size_str = std::to_string(group_size);
+    const char* ops[3] = { "0", "1", "2" };
+    for (int op = 0; op < 3; op++) {
+        D3D_SHADER_MACRO defines[3] = { { "REDUCE_OP", ops[op] }, { "GROUP_SIZE", group_size_str.c_str() }, { nullptr, nullptr } };
+        texture_pass[op].init_from_file(device, "shaders/reduction.hlsl", "reduce_texture_main", defines);
+        partials_pass[op].init_from_file(device, "shaders/reduction.hlsl", "reduce_partials_main", defines);
+    }
+    m_constants.init(device, sizeof(Reduce_Constants));
+    for (int op = 0; op < 3; op++) {
+        texture_table[op].init(texture_pass[op]);
+        texture_table[op].set_cb("Reduce_Constants", m_constants.p_buffer);
+        partials_table[op].init(partials_pass[op]);
+        partials_table[op].set_cb("Reduce_Constants", m_constants.p_buffer);
+    }
+}
+
+bool D3D11_Reduction::reduce(ID3D11DeviceContext* context, const Texture_As_Buffer& in, unsigned int axes, Reduce_Op op, Texture_As_Buffer& out)
+{
+    Reduce_Shape shape;
+    shape.init(in.channels, in.height, in.width, axes);
+    if (m_device == nullptr || (axes & ~(unsigned int)REDUCE_AXIS_ALL) != 0) {
+        std::cout << "Failed to reduce, init() first and pass axes within REDUCE_AXIS_ALL." << std::endl;
+        return false;
+    }
+    if (in.layout != TEXTURE_PLANAR || out.layout != TEXTURE_PLANAR) {
+        std::cout << "Failed to reduce, the reduction kernels read and write planar textures only." << std::endl;
+        return false;
+    }
+    if (out.channels != shape.out_channels() || out.height != shape.out_height() || out.width != shape.out_width()) {
+        std::cout << "Failed to reduce, output shape " << out.print_shape() << " does not match the reduced shape." << std::endl;
+        return false;
+    }
+
+    const size_t per_group = (size_t)group_size * items_per_thread;
+    const size_t out_count = shape.out_count();
+    size_t n = shape.reduced_count();
+    size_t groups_x = (n + per_group - 1) / per_group;
+
+    if (groups_x > D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION) {
+        std::cout << "Failed to reduce, " << n << " values per output is more than one pass can cover." << std::endl;
+        return false;
+    }
+
+    // Even passes write partials[0], odd passes partials[1]; the first pass of each is the largest
+    size_t needed[2] = { out_count * groups_x, out_count * ((groups_x + per_group - 1) / per_group) };
+    for (int i = 0; i < 2 && groups_x > 1; i++)
+        if (partials[i].count < needed[i]) {
+            partials[i].init(m_device, sizeof(float), needed[i]);
+            if (partials[i].p_buffer == nullptr)
+                return false;
+        }
+
+    const int shader_op = op == REDUCE_MEAN ? REDUCE_SUM : op;
+    Reduce_Constants c = {};
+    c.out_count = (UINT)out_count;
+    c.height = (UINT)shape.height;
+    c.width = (UINT)shape.width;
+    c.out_height = (UINT)shape.out_height();
+    c.out_width = (UINT)shape.out_width();
+    c.red_height = (UINT)(shape.height / shape.out_height());
+    c.red_width = (UINT)(shape.width / shape.out_width());
+    c.scale = op == REDUCE_MEAN ? 1.0f / (float)n : 1.0f;
+
+    UINT dispatchY = (UINT)(out_count < max_groups_y ? out_count : max_groups_y);
+    UINT dispatchZ = (UINT)((out_count + max_groups_y - 1) / max_groups_y);
+
+    last_passes = 0;
+    int src = -1;
+    while (true) {
+        c.n = (UINT)n;
+        c.groups_x = (UINT)groups_x;
+        c.final_pass = groups_x == 1;
+        m_constants.to_gpu(context, &c);
+        int dst = src == 0 ? 1 : 0;
+
+        // Bindings stay in place between passes; the table diff swaps the partials between input and output
+        D3D11_Binding_Table& table = src < 0 ? texture_table[shader_op] : partials_table[shader_op];
+        if (src < 0)
+            table.set_srv("input_texture", in.p_texture_srv);
+        else
+            table.set_srv("input_partials", partials[src].p_srv);
+        table.set_uav("output_partials", c.final_pass ? nullptr : partials[dst].p_uav);
+        table.set_uav("output_texture", out.p_texture_uav);
+        bindings.dispatch(context, table, (UINT)groups_x, dispatchY, dispatchZ);
+        last_passes++;
+        if (c.final_pass)
+            break;
+
+        src = dst;
+        n = groups_x;
+        groups_x = (n + per_group - 1) / per_group;
+    }
+    bindings.clear(context);
+    return true;
+}
+
+void D3D11_Reduction::release()
+{
+    for (int op = 0; op < 3; op++) {
+        texture_pass[op].release();
+        partials_pass[op].release();
+    }
+    partials[0].release();
+    partials[1].release();
+    m_constants.release();
+    m_device = nullptr;
+}
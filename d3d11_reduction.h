@@ -0,0 +1,58 @@
+#pragma once
+#include <d3d11.h>
+#include "reduction.h"
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+#include "d3d11_binding_table.h"
+
+/* 
+ * Device reductions over an axis subset of a texture array (shaders/reduction.hlsl).
+ * The first pass reads the texture, each group folding group_size * items_per_thread
+ * values of one output through a groupshared tree; further passes fold the partials
+ * the same way until one group per output remains, which writes the R32_FLOAT output
+ * texture of shape Reduce_Shape::out_*(). For a fixed group size the reduction order,
+ * and so the result, is deterministic.
+ */
+struct D3D11_Reduction
+{
+    static const UINT items_per_thread = 4;     // Matches ITEMS_PER_THREAD in reduction.hlsl
+    static const UINT max_groups_y = 65535;     // Matches MAX_GROUPS_Y in reduction.hlsl
+
+    UINT group_size = 256;
+    size_t last_passes = 0;     // Dispatches issued by the most recent reduce()
+
+    // Compile the sum/min/max shaders for a power-of-two group size (64 to 1024)
+    void init(ID3D11Device* device, UINT __group_size = 256);
+    // Reduce in over shape.axes into out (R32_FLOAT, shape.out_channels() x out_height() x out_width())
+    bool reduce(ID3D11DeviceContext* context, const Texture_As_Buffer& in, unsigned int axes, Reduce_Op op, Texture_As_Buffer& out);
+    void release();
+    ~D3D11_Reduction()
+    {
+        release();
+    }
+private:
+    struct Reduce_Constants
+    {
+        UINT n;
+        UINT out_count;
+        UINT groups_x;
+        UINT final_pass;
+        UINT height;
+        UINT width;
+        UINT out_height;
+        UINT out_width;
+        UINT red_height;
+        UINT red_width;
+        float scale;
+        UINT align_padding;
+    };
+
+    ID3D11Device* m_device = nullptr;
+    D3D11_Compute_Shader texture_pass[3];   // Indexed by REDUCE_SUM, REDUCE_MIN, REDUCE_MAX
+    D3D11_Compute_Shader partials_pass[3];
+    D3D11_Binding_Table texture_table[3];
+    D3D11_Binding_Table partials_table[3];
+    D3D11_Binding_State bindings;
+    D3D11_Structured_Buffer partials[2];    // Ping-pong between passes
+    D3D11_Constant_Buffer m_constants;
+};
@@ -0,0 +1,96 @@
+#include "d3d11_residency.h"
+#include <dxgi1_4.h>
+#include <iostream>
+
+size_t query_video_memory_budget(ID3D11Device* device)
+{
+    IDXGIDevice* dxgi_device = nullptr;
+    IDXGIAdapter* adapter = nullptr;
+    IDXGIAdapter3* adapter3 = nullptr;
+    size_t budget = 0;
+    if (SUCCEEDED(device->QueryInterface(__uuidof(IDXGIDevice), (void**)&dxgi_device)) && SUCCEEDED(dxgi_device->GetAdapter(&adapter)) &&
+        SUCCEEDED(adapter->QueryInterface(__uuidof(IDXGIAdapter3), (void**)&adapter3))) {
+        DXGI_QUERY_VIDEO_MEMORY_INFO info = {};
+        if (SUCCEEDED(adapter3->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info)))
+            budget = (size_t)info.Budget;
+    }
+    if (adapter3) adapter3->Release();
+    if (adapter) adapter->Release();
+    if (dxgi_device) dxgi_device->Release();
+    return budget;
+}
+
+void D3D11_Residency_Manager::init(ID3D11Device* device, ID3D11DeviceContext* context, size_t budget_cap)
+{
+    m_device = device;
+    m_context = context;
+    m_tracked.clear();
+    adapter_budget = query_video_memory_budget(device);
+    size_t budget = adapter_budget;
+    if (budget_cap != 0 && (budget == 0 || budget_cap < budget))
+        budget = budget_cap;
+    if (budget == 0)
+        std::cout << "No video memory budget reported and no cap given, residency is unbounded." << std::endl;
+    manager.init(this, budget == 0 ? (size_t)-1 : budget);
+}
+
+size_t D3D11_Residency_Manager::track(Texture_As_Buffer& texture, const char* name)
+{
+    if (texture.p_texture == nullptr) {
+        std::cout << "Cannot track " << name << ", init() the texture first." << std::endl;
+        return Residency_Manager::invalid_id;
+    }
+    D3D11_TEXTURE2D_DESC desc;
+    texture.p_texture->GetDesc(&desc);
+    Tracked t;
+    t.texture = &texture;
+    t.format = desc.Format;
+    t.staging = texture.has_staging();
+    const size_t rows = texture.slice_pitch() / texture.row_pitch();
+    // An interleaved texel holds four channels, so its rows are four packed channel rows wide (as in texture_bytes())
+    const size_t row_bytes = (texture.layout == TEXTURE_INTERLEAVED ? 4 : 1) * texture.row_pitch();
+    Residency_Footprint footprint = texture_footprint(texture.slices(), rows, row_bytes, t.staging, texture.staging_row_pitch(m_context));
+
+    size_t id = manager.add(name, footprint);
+    if (m_tracked.size() <= id)
+        m_tracked.resize(id + 1);
+    m_tracked[id] = t;
+    return id;
+}
+
+void D3D11_Residency_Manager::untrack(size_t id)
+{
+    if (id >= m_tracked.size())
+        return;
+    manager.remove(id);
+    m_tracked[id] = Tracked();
+}
+
+bool D3D11_Residency_Manager::evict(size_t id)
+{
+    Tracked& t = m_tracked[id];
+    Texture_As_Buffer& tab = *t.texture;
+    if (!tab.has_staging())
+        tab.init_staging(m_device);
+    t.host.resize(tab.channels * tab.slice_pitch());
+    if (!tab.to_cpu(m_context, t.host.data(), tab.row_pitch(), tab.slice_pitch()))
+        return false;
+    tab.release();
+    return true;
+}
+
+bool D3D11_Residency_Manager::restore(size_t id)
+{
+    Tracked& t = m_tracked[id];
+    Texture_As_Buffer& tab = *t.texture;
+    tab.init(m_device, tab.channels, tab.height, tab.width, t.format, tab.layout);
+    tab.init_staging(m_device);
+    if (tab.p_texture == nullptr || !tab.has_staging())
+        return false;
+    tab.to_gpu(m_context, t.host.data());
+    if (!t.staging)
+        tab.release_staging();
+    t.host.clear();
+    t.host.shrink_to_fit();
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <d3d11.h>
+#include <vector>
+#include "residency.h"
+#include "texture_as_buffer.h"
+
+// Local video memory budget the OS grants this process (IDXGIAdapter3::QueryVideoMemoryInfo), 0 if unavailable
+size_t query_video_memory_budget(ID3D11Device* device);
+
+/*
+ * Device side of residency.h for Texture_As_Buffer arrays. track() accounts a
+ * texture with the row pitch the driver actually chose and its staging copy;
+ * eviction reads it back to host memory and releases it, and use() re-creates it
+ * with the same shape, format and layout and uploads the host copy. Views are new
+ * objects after a restore, so binding tables must be set again after use().
+ */
+struct D3D11_Residency_Manager : Residency_Backend
+{
+    Residency_Manager manager;
+    size_t adapter_budget = 0;  // 0 if the adapter does not report one
+
+    // Budget is the adapter budget, capped by budget_cap if non-zero (a cap alone if the adapter reports none)
+    void init(ID3D11Device* device, ID3D11DeviceContext* context, size_t budget_cap = 0);
+    // Start accounting an initialized texture; it must stay alive until untrack()
+    size_t track(Texture_As_Buffer& texture, const char* name);
+    void untrack(size_t id);
+    // Make a tracked texture resident before a kernel touches it
+    bool use(size_t id)
+    {
+        return manager.use(id);
+    }
+    bool evict(size_t id) override;
+    bool restore(size_t id) override;
+private:
+    struct Tracked
+    {
+        Texture_As_Buffer* texture = nullptr;
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+        bool staging = false;
+        std::vector<unsigned char> host;
+    };
+
+    ID3D11Device* m_device = nullptr;
+    ID3D11DeviceContext* m_context = nullptr;
+    std::vector<Tracked> m_tracked;     // Indexed by manager id
+};
@@ -0,0 +1,246 @@
+#include "d3d11_scan.h"
+#include "metrics.h"
+#include "command_stream.h"
+#include <iostream>
+
+void D3D11_Scan::init(ID3D11Device* device)
+{
+    release();
+    m_device = device;
+
+    D3D_SHADER_MACRO uint_defines[2] = { { "SCAN_T", "uint" }, { nullptr, nullptr } };
+    D3D_SHADER_MACRO float_defines[2] = { { "SCAN_T", "float" }, { nullptr, nullptr } };
+    scan_blocks[0].init_from_file(device, "shaders/scan.hlsl", "scan_blocks_main", uint_defines);
+    scan_blocks[1].init_from_file(device, "shaders/scan.hlsl", "scan_blocks_main", float_defines);
+    add_offsets[0].init_from_file(device, "shaders/scan.hlsl", "add_offsets_main", uint_defines);
+    add_offsets[1].init_from_file(device, "shaders/scan.hlsl", "add_offsets_main", float_defines);
+    compact_flags.init_from_file(device, "shaders/scan.hlsl", "compact_flags_main", uint_defines);
+    compact_scatter.init_from_file(device, "shaders/scan.hlsl", "compact_scatter_main", uint_defines);
+    radix_count.init_from_file(device, "shaders/scan.hlsl", "radix_count_main", uint_defines);
+    radix_scatter.init_from_file(device, "shaders/scan.hlsl", "radix_scatter_main", uint_defines);
+    m_constants.init(device, sizeof(Scan_Constants));
+}
+
+bool D3D11_Scan::ensure(D3D11_Structured_Buffer& buffer, size_t count, bool staging)
+{
+    if (buffer.count >= count && buffer.p_buffer != nullptr)
+        return true;
+    buffer.init(m_device, sizeof(uint32_t), count, staging);
+    return buffer.p_buffer != nullptr;
+}
+
+void D3D11_Scan::unbind(ID3D11DeviceContext* context)
+{
+    ID3D11UnorderedAccessView* nullUAV[8] = {};
+    ID3D11ShaderResourceView* nullSRV[5] = {};
+    context->CSSetUnorderedAccessViews(0, 8, nullUAV, nullptr);
+    context->CSSetShaderResources(0, 5, nullSRV);
+}
+
+void D3D11_Scan::scan_level(ID3D11DeviceContext* context, ID3D11ShaderResourceView* in, ID3D11UnorderedAccessView* out, size_t n, Scan_Mode mode, int type, int level)
+{
+    const size_t blocks = (n + scan_block - 1) / scan_block;
+    Scan_Constants c = {};
+    c.n = (UINT)n;
+    c.inclusive = mode == SCAN_INCLUSIVE;
+    c.block_count = (UINT)blocks;
+    m_constants.to_gpu(context, &c);
+
+    ID3D11UnorderedAccessView* uavs[2] = { out, level_sums[level].p_uav };
+    context->CSSetShader(scan_blocks[type].shader, nullptr, 0);
+    context->CSSetConstantBuffers(0, 1, &m_constants.p_buffer);
+    context->CSSetShaderResources(0, 1, &in);
+    context->CSSetUnorderedAccessViews(0, 2, uavs, nullptr);
+    context->Dispatch((UINT)blocks, 1, 1);
+    count_dispatch((UINT)blocks, 1, 1);
+    capture_unreplayable_dispatch("D3D11_Scan::scan_level", (UINT)blocks, 1, 1);
+    unbind(context);
+    if (blocks == 1)
+        return;
+
+    // Exclusive scan of the block totals gives each block's offset
+    scan_level(context, level_sums[level].p_srv, level_scanned[level].p_uav, blocks, SCAN_EXCLUSIVE, type, level + 1);
+
+    m_constants.to_gpu(context, &c);
+    context->CSSetShader(add_offsets[type].shader, nullptr, 0);
+    context->CSSetConstantBuffers(0, 1, &m_constants.p_buffer);
+    context->CSSetShaderResources(1, 1, &level_scanned[level].p_srv);
+    context->CSSetUnorderedAccessViews(0, 1, &out, nullptr);
+    context->Dispatch((UINT)blocks, 1, 1);
+    count_dispatch((UINT)blocks, 1, 1);
+    capture_unreplayable_dispatch("D3D11_Scan::scan_level", (UINT)blocks, 1, 1);
+    unbind(context);
+}
+
+bool D3D11_Scan::scan(ID3D11DeviceContext* context, const D3D11_Structured_Buffer& in, D3D11_Structured_Buffer& out, size_t n, Scan_Mode mode, bool float_values)
+{
+    if (m_device == nullptr || n == 0 || in.count < n || out.count < n) {
+        std::cout << "Failed to scan, init() first and pass buffers of at least n elements." << std::endl;
+        return false;
+    }
+    if ((n + scan_block - 1) / scan_block > D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION) {
+        std::cout << "Failed to scan, " << n << " elements exceed one dispatch." << std::endl;
+        return false;
+    }
+
+    size_t level_n = n;
+    for (int level = 0; level_n > 1; level++) {
+        size_t blocks = (level_n + scan_block - 1) / scan_block;
+        if (level >= max_levels || !ensure(level_sums[level], blocks) || !ensure(level_scanned[level], blocks))
+            return false;
+        level_n = blocks;
+    }
+
+    scan_level(context, in.p_srv, out.p_uav, n, mode, float_values ? 1 : 0, 0);
+    return true;
+}
+
+bool D3D11_Scan::compact(ID3D11DeviceContext* context, const Texture_As_Buffer& in, const Compact_Predicate& pred)
+{
+    const size_t n = in.channels * in.height * in.width;
+    if (m_device == nullptr || n == 0) {
+        std::cout << "Failed to compact, init() first." << std::endl;
+        return false;
+    }
+    if (in.layout != TEXTURE_PLANAR) {
+        std::cout << "Failed to compact, the input must be a planar texture." << std::endl;
+        return false;
+    }
+    if (!ensure(flags, n) || !ensure(offsets, n) || !ensure(compacted_values, n, true) ||
+        !ensure(compacted_indices, n, true) || !ensure(compacted_count, 1, true))
+        return false;
+
+    const size_t groups = (n + scan_group - 1) / scan_group;
+    const UINT groups_x = (UINT)(groups < D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION ? groups : D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION);
+    const UINT groups_y = (UINT)((groups + groups_x - 1) / groups_x);
+    Scan_Constants c = {};
+    c.n = (UINT)n;
+    c.block_count = groups_x;
+    c.compact_op = (UINT)pred.op;
+    c.threshold = pred.threshold;
+    c.height = (UINT)in.height;
+    c.width = (UINT)in.width;
+
+    m_constants.to_gpu(context, &c);
+    context->CSSetShader(compact_flags.shader, nullptr, 0);
+    context->CSSetConstantBuffers(0, 1, &m_constants.p_buffer);
+    context->CSSetShaderResources(2, 1, &in.p_texture_srv);
+    context->CSSetUnorderedAccessViews(0, 1, &flags.p_uav, nullptr);
+    context->Dispatch(groups_x, groups_y, 1);
+    count_dispatch(groups_x, groups_y, 1);
+    capture_unreplayable_dispatch("D3D11_Scan::compact", groups_x, groups_y, 1);
+    unbind(context);
+
+    if (!scan(context, flags, offsets, n, SCAN_EXCLUSIVE))
+        return false;
+
+    ID3D11UnorderedAccessView* uavs[3] = { compacted_values.p_uav, compacted_indices.p_uav, compacted_count.p_uav };
+    m_constants.to_gpu(context, &c);
+    context->CSSetShader(compact_scatter.shader, nullptr, 0);
+    context->CSSetConstantBuffers(0, 1, &m_constants.p_buffer);
+    context->CSSetShaderResources(0, 1, &offsets.p_srv);
+    context->CSSetShaderResources(2, 1, &in.p_texture_srv);
+    context->CSSetUnorderedAccessViews(2, 3, uavs, nullptr);
+    context->Dispatch(groups_x, groups_y, 1);
+    count_dispatch(groups_x, groups_y, 1);
+    capture_unreplayable_dispatch("D3D11_Scan::compact", groups_x, groups_y, 1);
+    unbind(context);
+    return true;
+}
+
+size_t D3D11_Scan::compacted_to_cpu(ID3D11DeviceContext* context, float* values, uint32_t* indices)
+{
+    uint32_t count = 0;
+    if (!compacted_count.to_cpu(context, &count, 1) || count == 0)
+        return 0;
+    if (values)
+        compacted_values.to_cpu(context, values, count);
+    if (indices)
+        compacted_indices.to_cpu(context, indices, count);
+    return count;
+}
+
+bool D3D11_Scan::radix_sort(ID3D11DeviceContext* context, D3D11_Structured_Buffer& keys, D3D11_Structured_Buffer* values, size_t n)
+{
+    const size_t blocks = (n + radix_group - 1) / radix_group;
+    if (m_device == nullptr || n == 0 || keys.count < n || (values && values->count < n)) {
+        std::cout << "Failed to sort, init() first and pass buffers of at least n elements." << std::endl;
+        return false;
+    }
+    if (blocks > D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION) {
+        std::cout << "Failed to sort, " << n << " keys exceed one dispatch." << std::endl;
+        return false;
+    }
+    if (!ensure(keys_tmp, n) || (values && !ensure(values_tmp, n)) ||
+        !ensure(histogram, radix_digits * blocks) || !ensure(histogram_scanned, radix_digits * blocks))
+        return false;
+
+    D3D11_Structured_Buffer* key_buffers[2] = { &keys, &keys_tmp };
+    D3D11_Structured_Buffer* value_buffers[2] = { values, values ? &values_tmp : nullptr };
+    Scan_Constants c = {};
+    c.n = (UINT)n;
+    c.block_count = (UINT)blocks;
+    c.has_values = values != nullptr;
+
+    // 8 passes, so the sorted keys end up back in the caller's buffers
+    for (UINT pass = 0; pass < 8; pass++) {
+        const int src = pass % 2;
+        const int dst = 1 - src;
+        c.shift = pass * 4;
+
+        m_constants.to_gpu(context, &c);
+        context->CSSetShader(radix_count.shader, nullptr, 0);
+        context->CSSetConstantBuffers(0, 1, &m_constants.p_buffer);
+        context->CSSetShaderResources(3, 1, &key_buffers[src]->p_srv);
+        context->CSSetUnorderedAccessViews(7, 1, &histogram.p_uav, nullptr);
+        context->Dispatch((UINT)blocks, 1, 1);
+        count_dispatch((UINT)blocks, 1, 1);
+        capture_unreplayable_dispatch("D3D11_Scan::radix_sort", (UINT)blocks, 1, 1);
+        unbind(context);
+
+        if (!scan(context, histogram, histogram_scanned, radix_digits * blocks, SCAN_EXCLUSIVE))
+            return false;
+
+        ID3D11ShaderResourceView* value_srv = values ? value_buffers[src]->p_srv : nullptr;
+        ID3D11UnorderedAccessView* uavs[2] = { key_buffers[dst]->p_uav, values ? value_buffers[dst]->p_uav : nullptr };
+        m_constants.to_gpu(context, &c);
+        context->CSSetShader(radix_scatter.shader, nullptr, 0);
+        context->CSSetConstantBuffers(0, 1, &m_constants.p_buffer);
+        context->CSSetShaderResources(1, 1, &histogram_scanned.p_srv);
+        context->CSSetShaderResources(3, 1, &key_buffers[src]->p_srv);
+        context->CSSetShaderResources(4, 1, &value_srv);
+        context->CSSetUnorderedAccessViews(5, 2, uavs, nullptr);
+        context->Dispatch((UINT)blocks, 1, 1);
+        count_dispatch((UINT)blocks, 1, 1);
+        capture_unreplayable_dispatch("D3D11_Scan::radix_sort", (UINT)blocks, 1, 1);
+        unbind(context);
+    }
+    return true;
+}
+
+void D3D11_Scan::release()
+{
+    for (int type = 0; type < 2; type++) {
+        scan_blocks[type].release();
+        add_offsets[type].release();
+    }
+    compact_flags.release();
+    compact_scatter.release();
+    radix_count.release();
+    radix_scatter.release();
+    for (int level = 0; level < max_levels; level++) {
+        level_sums[level].release();
+        level_scanned[level].release();
+    }
+    flags.release();
+    offsets.release();
+    keys_tmp.release();
+    values_tmp.release();
+    histogram.release();
+    histogram_scanned.release();
+    compacted_values.release();
+    compacted_indices.release();
+    compacted_count.release();
+    m_constants.release();
+    m_device = nullptr;
+}
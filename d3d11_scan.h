@@ -0,0 +1,79 @@
+#pragma once
+#include <d3d11.h>
+#include <cstdint>
+#include "scan.h"
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+
+/* 
+ * Device prefix scan, stream compaction and radix sort (shaders/scan.hlsl).
+ *  - scan(): each group scans 1024 values in groupshared memory, block totals are
+ *    scanned recursively and added back, so any n up to 64M takes one pass per level.
+ *  - compact(): flags texels passing a predicate, scans the flags and scatters the kept
+ *    values and their linear CHW indices, append-buffer style, in input order.
+ *    compacted_to_cpu() reads back the count and then only the kept elements.
+ *  - radix_sort(): stable key-value sort of uint keys, 4-bit digits in 8 passes, each a
+ *    per-block digit histogram, a scan of the histograms and a ranked scatter.
+ */
+struct D3D11_Scan
+{
+    static const UINT scan_block = 1024;    // SCAN_BLOCK in scan.hlsl
+    static const UINT scan_group = 256;     // SCAN_GROUP
+    static const UINT radix_group = 128;    // RADIX_GROUP
+    static const UINT radix_digits = 16;    // RADIX_DIGITS
+    static const int max_levels = 4;
+
+    D3D11_Structured_Buffer compacted_values;   // float, result of compact()
+    D3D11_Structured_Buffer compacted_indices;  // uint
+    D3D11_Structured_Buffer compacted_count;    // uint[1]
+
+    void init(ID3D11Device* device);
+    // Scan the first n elements of in into out (4-byte uint or float elements, may not alias)
+    bool scan(ID3D11DeviceContext* context, const D3D11_Structured_Buffer& in, D3D11_Structured_Buffer& out, size_t n, Scan_Mode mode, bool float_values = false);
+    // Keep the texels of in passing pred
+    bool compact(ID3D11DeviceContext* context, const Texture_As_Buffer& in, const Compact_Predicate& pred);
+    // Read back the result of compact(), values/indices may be nullptr. Returns the count.
+    size_t compacted_to_cpu(ID3D11DeviceContext* context, float* values, uint32_t* indices);
+    // Sort the first n keys ascending in place, values (may be nullptr) follow their keys
+    bool radix_sort(ID3D11DeviceContext* context, D3D11_Structured_Buffer& keys, D3D11_Structured_Buffer* values, size_t n);
+    void release();
+    ~D3D11_Scan()
+    {
+        release();
+    }
+private:
+    struct Scan_Constants
+    {
+        UINT n;
+        UINT inclusive;
+        UINT block_count;
+        UINT compact_op;
+        float threshold;
+        UINT shift;
+        UINT has_values;
+        UINT height;
+        UINT width;
+        UINT align_padding[3];
+    };
+
+    void scan_level(ID3D11DeviceContext* context, ID3D11ShaderResourceView* in, ID3D11UnorderedAccessView* out, size_t n, Scan_Mode mode, int type, int level);
+    bool ensure(D3D11_Structured_Buffer& buffer, size_t count, bool staging = false);
+    void unbind(ID3D11DeviceContext* context);
+
+    ID3D11Device* m_device = nullptr;
+    D3D11_Compute_Shader scan_blocks[2];    // uint, float
+    D3D11_Compute_Shader add_offsets[2];
+    D3D11_Compute_Shader compact_flags;
+    D3D11_Compute_Shader compact_scatter;
+    D3D11_Compute_Shader radix_count;
+    D3D11_Compute_Shader radix_scatter;
+    D3D11_Structured_Buffer level_sums[max_levels];
+    D3D11_Structured_Buffer level_scanned[max_levels];
+    D3D11_Structured_Buffer flags;
+    D3D11_Structured_Buffer offsets;
+    D3D11_Structured_Buffer keys_tmp;
+    D3D11_Structured_Buffer values_tmp;
+    D3D11_Structured_Buffer histogram;
+    D3D11_Structured_Buffer histogram_scanned;
+    D3D11_Constant_Buffer m_constants;
+};
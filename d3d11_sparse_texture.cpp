@@ -0,0 +1,220 @@
+#include "d3d11_sparse_texture.h"
+#include <iostream>
+
+void D3D11_Sparse_Texture_Array::init(ID3D11Device* device, ID3D11DeviceContext* context, size_t channels, size_t height, size_t width,
+    DXGI_FORMAT format, size_t capacity_pages, bool allow_tiled)
+{
+    release();
+    m_device = device;
+
+    // Pages are the standard 64KB tile shape of the format, so both backings share one page table
+    size_t page_height, page_width;
+    switch (format) {
+        case DXGI_FORMAT_R8_UNORM:
+            element_size = 1;
+            page_height = 256;
+            page_width = 256;
+            break;
+        case DXGI_FORMAT_R16_FLOAT:
+            element_size = 2;
+            page_height = 128;
+            page_width = 256;
+            break;
+        case DXGI_FORMAT_R32_FLOAT:
+            element_size = 4;
+            page_height = 128;
+            page_width = 128;
+            break;
+        default:
+            std::cout << "Failed to init sparse texture array, format must be R8_UNORM, R16_FLOAT or R32_FLOAT." << std::endl;
+            return;
+    }
+    if (channels > D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION || !table.init(channels, height, width, page_height, page_width, capacity_pages))
+        return;
+    packed_page.resize(table.page_bytes(element_size));
+
+    D3D11_FEATURE_DATA_D3D11_OPTIONS1 options = {};
+    device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS1, &options, sizeof(options));
+    if (allow_tiled && options.TiledResourcesTier >= D3D11_TILED_RESOURCES_TIER_2)
+        context->QueryInterface(__uuidof(ID3D11DeviceContext2), (void**)&p_context2);
+
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.MipLevels = 1;
+    desc.Format = format;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    if (p_context2) {
+        desc.Width = (UINT)width;
+        desc.Height = (UINT)height;
+        desc.ArraySize = (UINT)channels;
+        desc.MiscFlags = D3D11_RESOURCE_MISC_TILED;
+        D3D11_BUFFER_DESC pool_desc = {};
+        pool_desc.ByteWidth = (UINT)(capacity_pages * table.page_bytes(element_size));
+        pool_desc.Usage = D3D11_USAGE_DEFAULT;
+        pool_desc.MiscFlags = D3D11_RESOURCE_MISC_TILE_POOL;
+        if (FAILED(device->CreateBuffer(&pool_desc, nullptr, &p_tile_pool))) {
+            std::cout << "Failed to create tile pool of " << capacity_pages << " pages." << std::endl;
+            release();
+            return;
+        }
+    }
+    else {
+        if (capacity_pages > D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION) {
+            std::cout << "Failed to init sparse texture array, the page pool holds at most "
+                << D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION << " pages without tiled resources." << std::endl;
+            release();
+            return;
+        }
+        desc.Width = (UINT)page_width;
+        desc.Height = (UINT)page_height;
+        desc.ArraySize = (UINT)capacity_pages;
+        page_table.init(device, sizeof(uint32_t), table.page_count());
+        page_table.to_gpu(context, table.slots.data());
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+    srv_desc.Format = format;
+    srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+    srv_desc.Texture2DArray.MostDetailedMip = 0;
+    srv_desc.Texture2DArray.MipLevels = 1;
+    srv_desc.Texture2DArray.FirstArraySlice = 0;
+    srv_desc.Texture2DArray.ArraySize = desc.ArraySize;
+    if (FAILED(device->CreateTexture2D(&desc, nullptr, &p_texture)) || FAILED(device->CreateShaderResourceView(p_texture, &srv_desc, &p_srv))) {
+        std::cout << "Failed to create sparse texture array storage." << std::endl;
+        release();
+        return;
+    }
+
+    Sparse_Constants c = {};
+    c.channels = (UINT)channels;
+    c.height = (UINT)height;
+    c.width = (UINT)width;
+    c.page_height = (UINT)page_height;
+    c.page_width = (UINT)page_width;
+    c.pages_h = (UINT)table.layout.tiles_h;
+    c.pages_w = (UINT)table.layout.tiles_w;
+    m_constants.init(device, sizeof(Sparse_Constants));
+    m_constants.to_gpu(context, &c);
+
+    D3D_SHADER_MACRO defines[2] = { { "SPARSE_TILED", tiled() ? "1" : "0" }, { nullptr, nullptr } };
+    dense_shader.init_from_file(device, "shaders/sparse.hlsl", "to_dense_main", defines);
+    dense_table.init(dense_shader);
+    set_bindings(dense_table);
+}
+
+void D3D11_Sparse_Texture_Array::commit(ID3D11DeviceContext* context)
+{
+    std::vector<size_t> changes = table.take_changes();
+    if (changes.empty())
+        return;
+    if (!tiled()) {
+        page_table.to_gpu(context, table.slots.data());
+        return;
+    }
+
+    const size_t n = changes.size();
+    std::vector<D3D11_TILED_RESOURCE_COORDINATE> coordinates(n);
+    std::vector<D3D11_TILE_REGION_SIZE> sizes(n);
+    std::vector<UINT> flags(n), offsets(n), counts(n, 1);
+    for (size_t i = 0; i < n; i++) {
+        const size_t page = changes[i];
+        const Tile_Layout& l = table.layout;
+        coordinates[i].X = (UINT)(page % l.tiles_w);
+        coordinates[i].Y = (UINT)(page / l.tiles_w % l.tiles_h);
+        coordinates[i].Z = 0;
+        coordinates[i].Subresource = (UINT)(page / (l.tiles_w * l.tiles_h));
+        sizes[i] = {};
+        sizes[i].NumTiles = 1;
+        const uint32_t slot = table.slots[page];
+        flags[i] = slot == Sparse_Page_Table::not_resident ? D3D11_TILE_RANGE_NULL : 0;
+        offsets[i] = slot == Sparse_Page_Table::not_resident ? 0 : slot;
+    }
+    if (FAILED(p_context2->UpdateTileMappings(p_texture, (UINT)n, coordinates.data(), sizes.data(), p_tile_pool,
+        (UINT)n, flags.data(), offsets.data(), counts.data(), 0)))
+        std::cout << "Failed to update tile mappings of " << n << " pages." << std::endl;
+}
+
+void D3D11_Sparse_Texture_Array::upload(ID3D11DeviceContext* context, size_t page, const void* packed)
+{
+    const UINT row_pitch = (UINT)(table.page_width * element_size);
+    if (tiled()) {
+        Tile_Extent ext = table.layout.extent(page);
+        D3D11_BOX box = { (UINT)ext.w0, (UINT)ext.h0, 0, (UINT)(ext.w0 + ext.width), (UINT)(ext.h0 + ext.height), 1 };
+        context->UpdateSubresource(p_texture, (UINT)ext.c0, &box, packed, row_pitch, 0);
+    }
+    else {
+        D3D11_BOX box = { 0, 0, 0, (UINT)table.page_width, (UINT)table.page_height, 1 };
+        context->UpdateSubresource(p_texture, table.slots[page], &box, packed, row_pitch, 0);
+    }
+    uploaded_bytes += table.page_bytes(element_size);
+}
+
+bool D3D11_Sparse_Texture_Array::to_gpu(ID3D11DeviceContext* context, const void* dense)
+{
+    if (p_texture == nullptr || !table.map_nonzero(dense, element_size))
+        return false;
+    commit(context);
+    for (size_t page = 0; page < table.page_count(); page++)
+        if (table.slots[page] != Sparse_Page_Table::not_resident) {
+            table.gather_page(dense, page, packed_page.data(), element_size);
+            upload(context, page, packed_page.data());
+        }
+    return true;
+}
+
+bool D3D11_Sparse_Texture_Array::update_page(ID3D11DeviceContext* context, size_t page, const void* packed)
+{
+    if (p_texture == nullptr || page >= table.page_count() || !table.map(page)) {
+        std::cout << "Failed to update sparse page " << page << ", out of range or the pool is full." << std::endl;
+        return false;
+    }
+    commit(context);
+    upload(context, page, packed);
+    return true;
+}
+
+void D3D11_Sparse_Texture_Array::unmap_channel(ID3D11DeviceContext* context, size_t c)
+{
+    if (p_texture == nullptr || c >= table.layout.channels)
+        return;
+    table.unmap_channel(c);
+    commit(context);
+}
+
+void D3D11_Sparse_Texture_Array::set_bindings(D3D11_Binding_Table& kernel_table) const
+{
+    kernel_table.set_srv("sparse_texture", p_srv);
+    kernel_table.set_cb("Sparse_Constants", m_constants.p_buffer);
+    if (!tiled())
+        kernel_table.set_srv("page_table", page_table.p_srv);
+}
+
+bool D3D11_Sparse_Texture_Array::to_dense(ID3D11DeviceContext* context, Texture_As_Buffer& out)
+{
+    const Tile_Layout& l = table.layout;
+    if (p_texture == nullptr || out.channels != l.channels || out.height != l.height || out.width != l.width || out.element_size != element_size) {
+        std::cout << "Failed to expand sparse array, output " << out.print_shape() << " does not match." << std::endl;
+        return false;
+    }
+    dense_table.set_uav("dense_out", out.p_texture_uav);
+    bindings.dispatch(context, dense_table, (UINT)((l.width + 15) / 16), (UINT)((l.height + 15) / 16), (UINT)l.channels);
+    bindings.clear(context);
+    return true;
+}
+
+void D3D11_Sparse_Texture_Array::release()
+{
+    if (p_srv) p_srv->Release();
+    if (p_texture) p_texture->Release();
+    if (p_tile_pool) p_tile_pool->Release();
+    if (p_context2) p_context2->Release();
+    p_srv = nullptr;
+    p_texture = nullptr;
+    p_tile_pool = nullptr;
+    p_context2 = nullptr;
+    page_table.release();
+    dense_shader.release();
+    m_constants.release();
+    uploaded_bytes = 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <d3d11.h>
+#include <d3d11_2.h>
+#include <vector>
+#include "sparse_page_table.h"
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+#include "d3d11_binding_table.h"
+
+/* 
+ * Texture array where only pages holding data are resident (shaders/sparse.hlsl).
+ * Pages are 64KB tiles of one channel (128x128 for 4-byte formats, 256x128 for
+ * 2-byte, 256x256 for 1-byte), tracked by a Sparse_Page_Table over a pool of
+ * capacity pages. Two backings:
+ *  - Tiled: on tiled resources tier 2 the logical array is a tiled texture whose
+ *    pages are mapped onto a tile pool with UpdateTileMappings; unmapped tiles read
+ *    as zero, so kernels read it like any texture array.
+ *  - Indirection: otherwise the pool is a texture array of capacity page-sized slices
+ *    and kernels read through the page table with sparse_load() in sparse.hlsl.
+ * Either way memory is the resident pages plus the table, and to_gpu() uploads only
+ * the resident pages of a dense host array.
+ */
+struct D3D11_Sparse_Texture_Array
+{
+    Sparse_Page_Table table;
+    size_t element_size = 0;
+    size_t uploaded_bytes = 0;      // Bytes sent by to_gpu() and update_page() so far
+    ID3D11ShaderResourceView* p_srv = nullptr;  // The tiled array, or the pool in indirection mode
+
+    // format: single-channel R8_UNORM, R16_FLOAT or R32_FLOAT. allow_tiled = false forces indirection.
+    void init(ID3D11Device* device, ID3D11DeviceContext* context, size_t channels, size_t height, size_t width,
+        DXGI_FORMAT format, size_t capacity_pages, bool allow_tiled = true);
+    bool tiled() const
+    {
+        return p_tile_pool != nullptr;
+    }
+    // Make resident exactly the pages of dense (CHW host array) holding non-zero data and upload them
+    bool to_gpu(ID3D11DeviceContext* context, const void* dense);
+    // Map page if needed and upload one packed page (page_height x page_width elements)
+    bool update_page(ID3D11DeviceContext* context, size_t page, const void* packed);
+    // Drop a channel's pages; it reads as zero afterwards
+    void unmap_channel(ID3D11DeviceContext* context, size_t c);
+    // Expand into a dense array of the same shape and format
+    bool to_dense(ID3D11DeviceContext* context, Texture_As_Buffer& out);
+    // Fill the sparse.hlsl bindings (sparse_texture, page_table, Sparse_Constants) of a kernel's table
+    void set_bindings(D3D11_Binding_Table& kernel_table) const;
+    size_t resident_bytes() const
+    {
+        return table.resident() * table.page_bytes(element_size) + (tiled() ? 0 : table.page_count() * sizeof(uint32_t));
+    }
+    size_t dense_bytes() const
+    {
+        return table.layout.channels * table.layout.height * table.layout.width * element_size;
+    }
+    void release();
+    ~D3D11_Sparse_Texture_Array()
+    {
+        release();
+    }
+private:
+    struct Sparse_Constants
+    {
+        UINT channels;
+        UINT height;
+        UINT width;
+        UINT page_height;
+        UINT page_width;
+        UINT pages_h;
+        UINT pages_w;
+        UINT align_padding;
+    };
+
+    // Push queued mapping changes to the device: one UpdateTileMappings, or one page table upload
+    void commit(ID3D11DeviceContext* context);
+    void upload(ID3D11DeviceContext* context, size_t page, const void* packed);
+
+    ID3D11Device* m_device = nullptr;
+    ID3D11DeviceContext2* p_context2 = nullptr;
+    ID3D11Texture2D* p_texture = nullptr;   // Tiled logical array, or the page pool
+    ID3D11Buffer* p_tile_pool = nullptr;
+    D3D11_Structured_Buffer page_table;
+    std::vector<unsigned char> packed_page;
+    D3D11_Compute_Shader dense_shader;
+    D3D11_Binding_Table dense_table;
+    D3D11_Binding_State bindings;
+    D3D11_Constant_Buffer m_constants;
+};
@@ -0,0 +1,76 @@
+#include "d3d11_stencil.h"
+#include "format_traits.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+bool D3D11_Stencil_Kernel::init(ID3D11Device* device, const Stencil_Footprint& __footprint, Stencil_Form __form, uint32_t __tile_x,
+    uint32_t __tile_y)
+{
+    release();
+    footprint = __footprint;
+    form = __form;
+    tile_x = __tile_x;
+    tile_y = __tile_y;
+    const std::vector<std::pair<std::string, std::string>> values = stencil_defines(footprint, form, tile_x, tile_y);
+    if (values.empty()) {
+        std::cout << "Failed to init stencil kernel, invalid footprint or tile too large for groupshared memory." << std::endl;
+        return false;
+    }
+    std::vector<D3D_SHADER_MACRO> defines;
+    for (const std::pair<std::string, std::string>& d : values)
+        defines.push_back({ d.first.c_str(), d.second.c_str() });
+    defines.push_back({ nullptr, nullptr });
+    m_shader.init_from_file(device, "shaders/stencil.hlsl", "stencil_main", defines.data());
+    if (m_shader.shader == nullptr)
+        return false;
+    m_constants.init(device, sizeof(Stencil_Constants));
+    m_table.init(m_shader);
+    m_table.set_cb("Stencil_Constants", m_constants.p_buffer);
+    return true;
+}
+
+// stencil.hlsl reads and writes one scalar per texel of planar slices
+static bool stencil_texture(const Texture_As_Buffer& tab)
+{
+    if (tab.p_texture == nullptr || tab.layout != TEXTURE_PLANAR)
+        return false;
+    D3D11_TEXTURE2D_DESC desc;
+    tab.p_texture->GetDesc(&desc);
+    Format_Info info;
+    return format_info(desc.Format, info) && info.components == 1 && info.block_dim == 1;
+}
+
+bool D3D11_Stencil_Kernel::dispatch(ID3D11DeviceContext* context, const Texture_As_Buffer& in, Texture_As_Buffer& out)
+{
+    if (m_shader.shader == nullptr || in.channels != out.channels || in.height != out.height || in.width != out.width
+        || out.p_texture_uav == nullptr) {
+        std::cout << "Cannot run stencil kernel, needs init() and an output of the input's shape." << std::endl;
+        return false;
+    }
+    if (!stencil_texture(in) || !stencil_texture(out)) {
+        std::cout << "Cannot run stencil kernel, input and output must be planar single-component textures." << std::endl;
+        return false;
+    }
+    Stencil_Constants c = { (UINT)in.width, (UINT)in.height, (UINT)in.channels, 0 };
+    m_constants.to_gpu(context, &c);
+    m_table.set_srv("stencil_in", in.p_texture_srv);
+    m_table.set_uav("stencil_out", out.p_texture_uav);
+    m_state.dispatch(context, m_table, (UINT)((in.width + tile_x - 1) / tile_x), (UINT)((in.height + tile_y - 1) / tile_y), (UINT)in.channels);
+    m_state.clear(context);
+    return true;
+}
+
+uint64_t D3D11_Stencil_Kernel::bytes_read(const Texture_As_Buffer& in) const
+{
+    const double fetches = stencil_fetches_per_output(footprint, form, tile_x, tile_y);
+    return (uint64_t)(fetches * in.channels * in.height * in.width * in.element_size);
+}
+
+void D3D11_Stencil_Kernel::release()
+{
+    m_shader.release();
+    m_constants.release();
+    m_table = D3D11_Binding_Table();
+    m_state = D3D11_Binding_State();
+}
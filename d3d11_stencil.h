@@ -0,0 +1,43 @@
+#pragma once
+#include <d3d11.h>
+#include "stencil.h"
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+#include "d3d11_binding_table.h"
+
+/*
+ * Device side of stencil.h: shaders/stencil.hlsl compiled for one footprint and form.
+ * Input is any single-component texture read as float, output a float-writable one
+ * of the same shape; every channel is filtered in one dispatch.
+ */
+struct D3D11_Stencil_Kernel
+{
+    Stencil_Footprint footprint;
+    Stencil_Form form = STENCIL_GROUPSHARED;
+    uint32_t tile_x = 16;
+    uint32_t tile_y = 16;
+
+    // False if the footprint is invalid, the tile does not fit groupshared memory or the kernel fails to compile
+    bool init(ID3D11Device* device, const Stencil_Footprint& __footprint, Stencil_Form __form, uint32_t __tile_x = 16, uint32_t __tile_y = 16);
+    bool dispatch(ID3D11DeviceContext* context, const Texture_As_Buffer& in, Texture_As_Buffer& out);
+    // Bytes one dispatch over in fetches from memory under the form's model (Kernel_Work::bytes_read)
+    uint64_t bytes_read(const Texture_As_Buffer& in) const;
+    void release();
+    ~D3D11_Stencil_Kernel()
+    {
+        release();
+    }
+private:
+    struct Stencil_Constants
+    {
+        UINT width;
+        UINT height;
+        UINT channels;
+        UINT align_padding;
+    };
+
+    D3D11_Compute_Shader m_shader;
+    D3D11_Binding_Table m_table;
+    D3D11_Binding_State m_state;
+    D3D11_Constant_Buffer m_constants;
+};
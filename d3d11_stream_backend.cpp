@@ -0,0 +1,112 @@
+#include "d3d11_stream_backend.h"
+#include "metrics.h"
+#include "command_stream.h"
+#include "residency.h"
+#include <iostream>
+
+void D3D11_Stream_Backend::init(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11ComputeShader* shader, DXGI_FORMAT in_format, DXGI_FORMAT out_format,
+    size_t logical_height, size_t logical_width, UINT block_x, UINT block_y)
+{
+    m_device = device;
+    m_context = context;
+    m_shader = shader;
+    m_in_format = in_format;
+    m_out_format = out_format;
+    m_height = logical_height;
+    m_width = logical_width;
+    m_block_x = block_x;
+    m_block_y = block_y;
+}
+
+bool D3D11_Stream_Backend::init_slots(size_t slot_count, const Tile_Extent& max_in, const Tile_Extent& max_out, size_t in_element_size, size_t out_element_size)
+{
+    release();
+    if (m_device == nullptr || m_shader == nullptr) {
+        std::cout << "Cannot allocate stream slots, init() backend first." << std::endl;
+        return false;
+    }
+
+    in_slots = new Texture_As_Buffer[slot_count];
+    out_slots = new Texture_As_Buffer[slot_count];
+    for (size_t i = 0; i < slot_count; i++) {
+        in_slots[i].init(m_device, max_in.channels, max_in.height, max_in.width, m_in_format);
+        in_slots[i].init_staging(m_device);
+        out_slots[i].init(m_device, max_out.channels, max_out.height, max_out.width, m_out_format);
+        out_slots[i].init_staging(m_device);
+        if (in_slots[i].p_texture == nullptr || out_slots[i].p_texture == nullptr) {
+            release();
+            return false;
+        }
+        if (in_slots[i].element_size != in_element_size || out_slots[i].element_size != out_element_size) {
+            std::cout << "Cannot allocate stream slots, element size does not match format." << std::endl;
+            release();
+            return false;
+        }
+        // Both textures and their staging copies, at the pitch the driver gave them
+        for (Texture_As_Buffer* tab : { &in_slots[i], &out_slots[i] })
+            allocated_bytes += texture_footprint(tab->slices(), tab->height, tab->row_pitch(), true, tab->staging_row_pitch(m_context)).total();
+    }
+
+    constants.init(m_device, sizeof(Stream_Tile_Constants));
+    return constants.p_buffer != nullptr;
+}
+
+size_t D3D11_Stream_Backend::slot_bytes(const Tile_Extent& max_in, const Tile_Extent& max_out, size_t in_element_size, size_t out_element_size) const
+{
+    return texture_footprint(max_in.channels, max_in.height, max_in.width * in_element_size, true).total()
+        + texture_footprint(max_out.channels, max_out.height, max_out.width * out_element_size, true).total();
+}
+
+void D3D11_Stream_Backend::upload(size_t slot, const Stream_Tile& tile, const void* host_in)
+{
+    const size_t es = in_slots[slot].element_size;
+    const unsigned char* src = (const unsigned char*)host_in + ((tile.in.c0 * m_height + tile.in.h0) * m_width + tile.in.w0) * es;
+    in_slots[slot].to_gpu(m_context, src, m_width * es, m_height * m_width * es, tile.in.channels, tile.in.height, tile.in.width);
+}
+
+void D3D11_Stream_Backend::compute(size_t slot, const Stream_Tile& tile)
+{
+    Stream_Tile_Constants c = {
+        (UINT)tile.in.h0, (UINT)tile.in.w0, (UINT)tile.out.h0, (UINT)tile.out.w0,
+        (UINT)tile.in.height, (UINT)tile.in.width, (UINT)tile.out.height, (UINT)tile.out.width,
+        (UINT)m_height, (UINT)m_width, (UINT)tile.out.channels, 0 };
+    constants.to_gpu(m_context, &c);
+
+    m_context->CSSetShader(m_shader, nullptr, 0);
+    m_context->CSSetConstantBuffers(0, 1, &constants.p_buffer);
+    m_context->CSSetShaderResources(0, 1, &in_slots[slot].p_texture_srv);
+    m_context->CSSetUnorderedAccessViews(0, 1, &out_slots[slot].p_texture_uav, nullptr);
+    UINT dispatchX = ((UINT)tile.out.width + m_block_x - 1) / m_block_x;
+    UINT dispatchY = ((UINT)tile.out.height + m_block_y - 1) / m_block_y;
+    m_context->Dispatch(dispatchX, dispatchY, 1);
+    count_dispatch(dispatchX, dispatchY, 1);
+    capture_unreplayable_dispatch("D3D11_Stream_Backend::compute", dispatchX, dispatchY, 1);
+
+    ID3D11UnorderedAccessView* nullUAV[1] = { nullptr };
+    m_context->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
+    ID3D11ShaderResourceView* nullSRV[1] = { nullptr };
+    m_context->CSSetShaderResources(0, 1, nullSRV);
+
+    // Queue the readback copy now, readback() maps it one step later
+    out_slots[slot].begin_to_cpu(m_context);
+}
+
+void D3D11_Stream_Backend::readback(size_t slot, const Stream_Tile& tile, void* host_out)
+{
+    const size_t es = out_slots[slot].element_size;
+    unsigned char* dst = (unsigned char*)host_out + ((tile.out.c0 * m_height + tile.out.h0) * m_width + tile.out.w0) * es;
+    out_slots[slot].end_to_cpu(m_context, dst, m_width * es, m_height * m_width * es, tile.out.channels, tile.out.height, tile.out.width);
+}
+
+void D3D11_Stream_Backend::release()
+{
+    if (in_slots)
+        delete[] in_slots;
+    if (out_slots)
+        delete[] out_slots;
+    constants.release();
+
+    in_slots = nullptr;
+    out_slots = nullptr;
+    allocated_bytes = 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <d3d11.h>
+#include "stream_executor.h"
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+
+/* 
+ * Per-tile constants bound to b0 by D3D11_Stream_Backend::compute(), layout matches
+ *   cbuffer Stream_Constants { uint in_h0; uint in_w0; uint out_h0; uint out_w0;
+ *                              uint in_height; uint in_width; uint out_height; uint out_width;
+ *                              uint height; uint width; uint channels; uint align_padding; };
+ * Thread (x, y) handles logical output texel (out_h0 + y, out_w0 + x); logical input
+ * texel (h, w) lives at (w - in_w0, h - in_h0) of the input slot.
+ */
+struct Stream_Tile_Constants
+{
+    UINT in_h0;
+    UINT in_w0;
+    UINT out_h0;
+    UINT out_w0;
+    UINT in_height;
+    UINT in_width;
+    UINT out_height;
+    UINT out_width;
+    UINT height;
+    UINT width;
+    UINT channels;
+    UINT align_padding;
+};
+
+/* 
+ * Stream_Backend over a D3D11 device: each slot is an input and output Texture_As_Buffer,
+ * each with a staging copy, priced with padded rows as texture_footprint() does.
+ * Stages are issued in order on the immediate context; readback maps the staging copy
+ * queued at the end of compute, so the GPU works on the next tile meanwhile.
+ * Input tile is bound to t0, output tile to u0.
+ */
+struct D3D11_Stream_Backend : Stream_Backend
+{
+    void init(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11ComputeShader* shader, DXGI_FORMAT in_format, DXGI_FORMAT out_format,
+        size_t logical_height, size_t logical_width, UINT block_x, UINT block_y);
+
+    bool init_slots(size_t slot_count, const Tile_Extent& max_in, const Tile_Extent& max_out, size_t in_element_size, size_t out_element_size) override;
+    void upload(size_t slot, const Stream_Tile& tile, const void* host_in) override;
+    void compute(size_t slot, const Stream_Tile& tile) override;
+    void readback(size_t slot, const Stream_Tile& tile, void* host_out) override;
+    bool concurrent_stages() const override { return false; }
+    size_t slot_bytes(const Tile_Extent& max_in, const Tile_Extent& max_out, size_t in_element_size, size_t out_element_size) const override;
+    size_t device_bytes() const override { return allocated_bytes; }
+    void release() override;
+
+    ~D3D11_Stream_Backend()
+    {
+        release();
+    }
+private:
+    ID3D11Device* m_device = nullptr;
+    ID3D11DeviceContext* m_context = nullptr;
+    ID3D11ComputeShader* m_shader = nullptr;
+    DXGI_FORMAT m_in_format = DXGI_FORMAT_UNKNOWN;
+    DXGI_FORMAT m_out_format = DXGI_FORMAT_UNKNOWN;
+    size_t m_height = 0;
+    size_t m_width = 0;
+    UINT m_block_x = 16;
+    UINT m_block_y = 16;
+    Texture_As_Buffer* in_slots = nullptr;
+    Texture_As_Buffer* out_slots = nullptr;
+    D3D11_Constant_Buffer constants;
+    size_t allocated_bytes = 0;
+};
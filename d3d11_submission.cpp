@@ -0,0 +1,68 @@
+#include "d3d11_submission.h"
+#include <iostream>
+
+void D3D11_Submission_Backend::init(ID3D11DeviceContext* context)
+{
+    m_context = context;
+    m_pending.clear();
+}
+
+bool D3D11_Submission_Backend::pending(const Submission_Packet* packets, const void* texture) const
+{
+    for (size_t i : m_pending) {
+        if (packets[i].resource == texture)
+            return true;
+    }
+    return false;
+}
+
+void D3D11_Submission_Backend::finish_readbacks(const Submission_Packet* packets, bool* ok)
+{
+    for (size_t i : m_pending) {
+        Texture_As_Buffer* texture = (Texture_As_Buffer*)packets[i].resource;
+        ok[i] = texture->end_to_cpu(m_context, packets[i].dst, texture->row_pitch(), texture->slice_pitch());
+    }
+    m_pending.clear();
+}
+
+void D3D11_Submission_Backend::execute(const Submission_Packet* packets, size_t count, bool* ok)
+{
+    if (m_context == nullptr) {
+        std::cout << "Cannot execute submissions, init() backend first." << std::endl;
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const Submission_Packet& p = packets[i];
+        Texture_As_Buffer* texture = (Texture_As_Buffer*)p.resource;
+        switch (p.op) {
+        case SUBMIT_UPLOAD:
+            if (texture == nullptr || !texture->has_staging() || p.src == nullptr || p.bytes < texture->channels * texture->slice_pitch())
+                break;
+            if (pending(packets, texture))
+                finish_readbacks(packets, ok);
+            texture->to_gpu(m_context, (void*)p.src);
+            ok[i] = true;
+            break;
+        case SUBMIT_READBACK:
+            if (texture == nullptr || !texture->has_staging() || p.dst == nullptr || p.bytes < texture->channels * texture->slice_pitch())
+                break;
+            if (pending(packets, texture))
+                finish_readbacks(packets, ok);
+            texture->begin_to_cpu(m_context);
+            m_pending.push_back(i);
+            break;
+        case SUBMIT_DISPATCH:
+            if (p.resource == nullptr)
+                break;
+            m_state.dispatch(m_context, *(const D3D11_Binding_Table*)p.resource, p.groups[0], p.groups[1], p.groups[2]);
+            ok[i] = true;
+            break;
+        default:
+            ok[i] = true;
+            break;
+        }
+    }
+    finish_readbacks(packets, ok);
+    // Hand the context back with nothing bound, a texture a dispatch wrote may be mapped by the next batch
+    m_state.clear(m_context);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <d3d11.h>
+#include <vector>
+#include "submission_queue.h"
+#include "texture_as_buffer.h"
+#include "d3d11_binding_table.h"
+
+/*
+ * Submission_Backend over a D3D11 context. Only the executor's owner thread calls it, so
+ * no context call takes a lock. Packet resources are a Texture_As_Buffer* (with staging)
+ * for uploads from and readbacks into dense host arrays, where packet.bytes must be at
+ * least channels * slice_pitch(), and a D3D11_Binding_Table* for dispatches over
+ * packet.groups. Readbacks are split: the device->staging copy is queued when the packet
+ * comes up and the map waits until the end of the batch, so a batch with
+ * several readbacks waits on the GPU once instead of once per readback. A texture whose
+ * readback is still pending is resolved first if a later packet of the batch uploads to
+ * or reads back from it again, since both go through its one staging copy.
+ */
+struct D3D11_Submission_Backend : Submission_Backend
+{
+    void init(ID3D11DeviceContext* context);
+    void execute(const Submission_Packet* packets, size_t count, bool* ok) override;
+    const Binding_Stats& binding_stats() const
+    {
+        return m_state.stats();
+    }
+private:
+    // Map the pending readbacks, in packet order
+    void finish_readbacks(const Submission_Packet* packets, bool* ok);
+    bool pending(const Submission_Packet* packets, const void* texture) const;
+
+    ID3D11DeviceContext* m_context = nullptr;
+    D3D11_Binding_State m_state;
+    std::vector<size_t> m_pending;     // Readback packets of the current batch waiting for their map
+};
@@ -0,0 +1,272 @@
+#include "expr_graph.h"
+#include "host_parallel.h"
+#include <iostream>
+#include <cmath>
+#include <unordered_map>
+
+static Expr make_node(Expr_Op op, const Expr& a, const Expr& b = Expr())
+{
+    Expr e;
+    e.node = std::make_shared<Expr_Node>();
+    e.node->op = op;
+    e.node->args[0] = a.node;
+    e.node->args[1] = b.node;
+    return e;
+}
+
+Expr::Expr(float constant)
+{
+    node = std::make_shared<Expr_Node>();
+    node->op = EXPR_CONSTANT;
+    node->value = constant;
+}
+
+Expr Expr::host(const float* data, size_t channels, size_t height, size_t width)
+{
+    Expr e;
+    e.node = std::make_shared<Expr_Node>();
+    e.node->op = EXPR_INPUT;
+    e.node->source = data;
+    e.node->channels = channels;
+    e.node->height = height;
+    e.node->width = width;
+    return e;
+}
+
+Expr Expr::device(const void* texture, size_t channels, size_t height, size_t width)
+{
+    Expr e = host((const float*)texture, channels, height, width);
+    e.node->device_source = true;
+    return e;
+}
+
+Expr operator+(const Expr& a, const Expr& b) { return make_node(EXPR_ADD, a, b); }
+Expr operator-(const Expr& a, const Expr& b) { return make_node(EXPR_SUB, a, b); }
+Expr operator*(const Expr& a, const Expr& b) { return make_node(EXPR_MUL, a, b); }
+Expr operator/(const Expr& a, const Expr& b) { return make_node(EXPR_DIV, a, b); }
+Expr operator-(const Expr& a) { return make_node(EXPR_NEG, a); }
+Expr minimum(const Expr& a, const Expr& b) { return make_node(EXPR_MIN, a, b); }
+Expr maximum(const Expr& a, const Expr& b) { return make_node(EXPR_MAX, a, b); }
+Expr abs(const Expr& a) { return make_node(EXPR_ABS, a); }
+Expr sqrt(const Expr& a) { return make_node(EXPR_SQRT, a); }
+Expr exp(const Expr& a) { return make_node(EXPR_EXP, a); }
+Expr relu(const Expr& a) { return make_node(EXPR_RELU, a); }
+
+static bool is_binary(Expr_Op op)
+{
+    return op >= EXPR_ADD && op <= EXPR_MAX;
+}
+
+bool Expr_Plan::compile(const Expr& root)
+{
+    code.clear();
+    inputs.clear();
+    constants.clear();
+    signature.clear();
+    channels = height = width = 0;
+    if (!root.node) {
+        std::cout << "Failed to compile expression, it is empty." << std::endl;
+        return false;
+    }
+
+    // Iterative post-order walk, each distinct node gets one register. Structurally equal
+    // nodes (same input array, or same operator on the same registers) share one too.
+    std::unordered_map<const Expr_Node*, size_t> registers;
+    std::unordered_map<std::string, size_t> value_numbers;
+    std::vector<std::pair<const Expr_Node*, bool>> stack;
+    stack.push_back({ root.node.get(), false });
+    while (!stack.empty()) {
+        const Expr_Node* n = stack.back().first;
+        bool expanded = stack.back().second;
+        stack.pop_back();
+        if (registers.count(n))
+            continue;
+        if (!expanded) {
+            stack.push_back({ n, true });
+            for (int i = 1; i >= 0; i--)
+                if (n->args[i] && !registers.count(n->args[i].get()))
+                    stack.push_back({ n->args[i].get(), false });
+            continue;
+        }
+
+        std::string value_key;
+        if (n->op == EXPR_INPUT)
+            value_key = "i" + std::to_string((size_t)n->source);
+        else if (n->op != EXPR_CONSTANT && n->args[0] && (!is_binary(n->op) || n->args[1]))
+            value_key = std::to_string(n->op) + "_" + std::to_string(registers[n->args[0].get()]) + "_" +
+                (is_binary(n->op) ? std::to_string(registers[n->args[1].get()]) : "");
+        auto known = value_numbers.find(value_key);
+        if (!value_key.empty() && known != value_numbers.end()) {
+            registers[n] = known->second;
+            continue;
+        }
+
+        Expr_Instr instr;
+        instr.op = n->op;
+        instr.dst = code.size();
+        if (n->op == EXPR_INPUT) {
+            if (inputs.empty()) {
+                channels = n->channels;
+                height = n->height;
+                width = n->width;
+                device = n->device_source;
+            }
+            else if (n->channels != channels || n->height != height || n->width != width || n->device_source != device) {
+                std::cout << "Failed to compile expression, inputs differ in shape or location." << std::endl;
+                return false;
+            }
+            instr.a = inputs.size();
+            inputs.push_back(n);
+            signature += "i" + std::to_string(instr.a);
+        }
+        else if (n->op == EXPR_CONSTANT) {
+            instr.a = constants.size();
+            constants.push_back(n->value);
+            signature += "k" + std::to_string(instr.a);
+        }
+        else {
+            if (!n->args[0] || (is_binary(n->op) && !n->args[1])) {
+                std::cout << "Failed to compile expression, operator is missing an operand." << std::endl;
+                return false;
+            }
+            instr.a = registers[n->args[0].get()];
+            instr.b = is_binary(n->op) ? registers[n->args[1].get()] : 0;
+            signature += "o" + std::to_string(n->op) + "_" + std::to_string(instr.a);
+            if (is_binary(n->op))
+                signature += "_" + std::to_string(instr.b);
+        }
+        signature += ";";
+        if (!value_key.empty())
+            value_numbers[value_key] = code.size();
+        registers[n] = code.size();
+        code.push_back(instr);
+    }
+
+    if (inputs.empty()) {
+        std::cout << "Failed to compile expression, it has no array input." << std::endl;
+        return false;
+    }
+    if (inputs.size() > max_inputs || constants.size() > max_constants) {
+        std::cout << "Failed to compile expression, more than " << max_inputs << " inputs or " << max_constants << " constants." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string Expr_Plan::hlsl(const char* output_type, unsigned int block_x, unsigned int block_y) const
+{
+    static const char* binary[] = { "+", "-", "*", "/" };
+    const char* swizzle = "xyzw";
+    std::string s;
+    s += "cbuffer Expr_Constants : register(b0)\n{\n    float4 k[" + std::to_string(max_constants / 4) + "];\n};\n\n";
+    for (size_t i = 0; i < inputs.size(); i++)
+        s += "Texture2DArray<float> t" + std::to_string(i) + " : register(t" + std::to_string(i) + ");\n";
+    s += "RWTexture2DArray<" + std::string(output_type) + "> output : register(u0);\n\n";
+    s += "[numthreads(" + std::to_string(block_x) + ", " + std::to_string(block_y) + ", 1)]\n";
+    s += "void main(uint3 DTid : SV_DispatchThreadID)\n{\n";
+    s += "    uint width, height, channels;\n    output.GetDimensions(width, height, channels);\n";
+    s += "    if (DTid.x >= width || DTid.y >= height)\n        return;\n\n";
+    s += "    for (uint c = 0; c < channels; c++) {\n        uint3 idx = uint3(DTid.xy, c);\n";
+    for (const Expr_Instr& in : code) {
+        std::string r = "r" + std::to_string(in.dst);
+        std::string a = "r" + std::to_string(in.a);
+        std::string b = "r" + std::to_string(in.b);
+        std::string rhs;
+        switch (in.op) {
+        case EXPR_INPUT: rhs = "t" + std::to_string(in.a) + "[idx]"; break;
+        case EXPR_CONSTANT: rhs = "k[" + std::to_string(in.a / 4) + "]." + swizzle[in.a % 4]; break;
+        case EXPR_ADD: case EXPR_SUB: case EXPR_MUL: case EXPR_DIV: rhs = a + " " + binary[in.op - EXPR_ADD] + " " + b; break;
+        case EXPR_MIN: rhs = "min(" + a + ", " + b + ")"; break;
+        case EXPR_MAX: rhs = "max(" + a + ", " + b + ")"; break;
+        case EXPR_NEG: rhs = "-" + a; break;
+        case EXPR_ABS: rhs = "abs(" + a + ")"; break;
+        case EXPR_SQRT: rhs = "sqrt(" + a + ")"; break;
+        case EXPR_EXP: rhs = "exp(" + a + ")"; break;
+        case EXPR_RELU: rhs = "max(" + a + ", 0.0f)"; break;
+        }
+        s += "        float " + r + " = " + rhs + ";\n";
+    }
+    s += "        output[idx] = r" + std::to_string(code.size() - 1) + ";\n    }\n}\n";
+    return s;
+}
+
+void Expr_Host_Kernel::init(const Expr_Plan& plan)
+{
+    code = plan.code;
+    input_count = plan.inputs.size();
+}
+
+void Expr_Host_Kernel::run(const float* const* inputs, const float* constants, float* out, size_t count, size_t threads) const
+{
+    const size_t blocks = (count + block_elements - 1) / block_elements;
+    parallel_for(blocks, [&](size_t begin, size_t end) {
+        std::vector<float> regs(code.size() * block_elements);
+        for (size_t blk = begin; blk < end; blk++) {
+            const size_t offset = blk * block_elements;
+            const size_t n = offset + block_elements <= count ? block_elements : count - offset;
+            for (const Expr_Instr& in : code) {
+                float* r = regs.data() + in.dst * block_elements;
+                const float* a = regs.data() + in.a * block_elements;
+                const float* b = regs.data() + in.b * block_elements;
+                switch (in.op) {
+                case EXPR_INPUT: { const float* src = inputs[in.a] + offset; for (size_t i = 0; i < n; i++) r[i] = src[i]; break; }
+                case EXPR_CONSTANT: { float k = constants[in.a]; for (size_t i = 0; i < n; i++) r[i] = k; break; }
+                case EXPR_ADD: for (size_t i = 0; i < n; i++) r[i] = a[i] + b[i]; break;
+                case EXPR_SUB: for (size_t i = 0; i < n; i++) r[i] = a[i] - b[i]; break;
+                case EXPR_MUL: for (size_t i = 0; i < n; i++) r[i] = a[i] * b[i]; break;
+                case EXPR_DIV: for (size_t i = 0; i < n; i++) r[i] = a[i] / b[i]; break;
+                case EXPR_MIN: for (size_t i = 0; i < n; i++) r[i] = a[i] < b[i] ? a[i] : b[i]; break;
+                case EXPR_MAX: for (size_t i = 0; i < n; i++) r[i] = a[i] > b[i] ? a[i] : b[i]; break;
+                case EXPR_NEG: for (size_t i = 0; i < n; i++) r[i] = -a[i]; break;
+                case EXPR_ABS: for (size_t i = 0; i < n; i++) r[i] = std::fabs(a[i]); break;
+                case EXPR_SQRT: for (size_t i = 0; i < n; i++) r[i] = std::sqrt(a[i]); break;
+                case EXPR_EXP: for (size_t i = 0; i < n; i++) r[i] = std::exp(a[i]); break;
+                case EXPR_RELU: for (size_t i = 0; i < n; i++) r[i] = a[i] > 0.0f ? a[i] : 0.0f; break;
+                }
+            }
+            const float* result = regs.data() + (code.size() - 1) * block_elements;
+            for (size_t i = 0; i < n; i++)
+                out[offset + i] = result[i];
+        }
+    }, threads);
+}
+
+const Expr_Host_Kernel* Expr_Host_Cache::get(const Expr_Plan& plan)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = kernels.find(plan.signature);
+    if (it != kernels.end()) {
+        hits++;
+        return it->second.get();
+    }
+    misses++;
+    std::unique_ptr<Expr_Host_Kernel> kernel(new Expr_Host_Kernel());
+    kernel->init(plan);
+    const Expr_Host_Kernel* k = kernel.get();
+    kernels[plan.signature] = std::move(kernel);
+    return k;
+}
+
+Expr_Host_Cache& Expr_Host_Cache::instance()
+{
+    static Expr_Host_Cache cache;
+    return cache;
+}
+
+bool Expr::eval(float* out, size_t threads) const
+{
+    Expr_Plan plan;
+    if (!plan.compile(*this))
+        return false;
+    if (plan.device) {
+        std::cout << "Failed to evaluate expression on host, its inputs are device arrays." << std::endl;
+        return false;
+    }
+
+    std::vector<const float*> inputs;
+    for (const Expr_Node* n : plan.inputs)
+        inputs.push_back((const float*)n->source);
+    const Expr_Host_Kernel* kernel = Expr_Host_Cache::instance().get(plan);
+    kernel->run(inputs.data(), plan.constants.data(), out, plan.channels * plan.height * plan.width, threads);
+    return true;
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+/*
+ * Lazy elementwise expressions over (channels, height, width) float arrays.
+ * Building an expression (auto y = a + b * k;) only records a DAG; eval() lowers
+ * the whole DAG into one fused kernel, so intermediate values live in registers
+ * instead of round-tripping through textures. Shared subexpressions are computed
+ * once. Fused kernels are cached by graph signature: the shape of the DAG and the
+ * output type, not the constant values or the arrays bound to it, so re-evaluating
+ * with new k or new inputs reuses the cached kernel.
+ * Host-only, no D3D dependency (see d3d11_expr.h for the device side).
+ */
+enum Expr_Op
+{
+    EXPR_INPUT,
+    EXPR_CONSTANT,
+    EXPR_ADD,
+    EXPR_SUB,
+    EXPR_MUL,
+    EXPR_DIV,
+    EXPR_MIN,
+    EXPR_MAX,
+    EXPR_NEG,
+    EXPR_ABS,
+    EXPR_SQRT,
+    EXPR_EXP,
+    EXPR_RELU
+};
+
+struct Expr_Node
+{
+    Expr_Op op = EXPR_CONSTANT;
+    std::shared_ptr<Expr_Node> args[2];
+    float value = 0.0f;             // EXPR_CONSTANT
+    const void* source = nullptr;   // EXPR_INPUT: host float array or device texture
+    bool device_source = false;
+    size_t channels = 0;
+    size_t height = 0;
+    size_t width = 0;
+};
+
+class Expr
+{
+public:
+    Expr() {}
+    // Scalar constant, broadcast over the array
+    Expr(float constant);
+    // Dense CHW host float array, must outlive eval()
+    static Expr host(const float* data, size_t channels, size_t height, size_t width);
+    // Opaque device array (see expr_input() in d3d11_expr.h)
+    static Expr device(const void* texture, size_t channels, size_t height, size_t width);
+
+    // Evaluate into a dense CHW host float array with the fused CPU kernel
+    bool eval(float* out, size_t threads = 0) const;
+
+    // Hidden friends: only found through an Expr argument, so abs(x), sqrt(x) and exp(x)
+    // on plain numbers keep resolving to the standard functions
+    friend Expr operator+(const Expr& a, const Expr& b);
+    friend Expr operator-(const Expr& a, const Expr& b);
+    friend Expr operator*(const Expr& a, const Expr& b);
+    friend Expr operator/(const Expr& a, const Expr& b);
+    friend Expr operator-(const Expr& a);
+    friend Expr minimum(const Expr& a, const Expr& b);
+    friend Expr maximum(const Expr& a, const Expr& b);
+    friend Expr abs(const Expr& a);
+    friend Expr sqrt(const Expr& a);
+    friend Expr exp(const Expr& a);
+    friend Expr relu(const Expr& a);
+
+    std::shared_ptr<Expr_Node> node;
+};
+
+// One fused step: reg[dst] = op(reg[a], reg[b]); inputs and constants name their slot in `a`
+struct Expr_Instr
+{
+    Expr_Op op = EXPR_CONSTANT;
+    size_t dst = 0;
+    size_t a = 0;
+    size_t b = 0;
+};
+
+/*
+ * A DAG lowered to straight-line code in topological order, one register per
+ * distinct node. Inputs are numbered in order of first use (texture slot t<i>),
+ * constants likewise (k<i>).
+ */
+struct Expr_Plan
+{
+    static const size_t max_inputs = 16;
+    static const size_t max_constants = 64;
+
+    std::vector<Expr_Instr> code;
+    std::vector<const Expr_Node*> inputs;
+    std::vector<float> constants;
+    size_t channels = 0;
+    size_t height = 0;
+    size_t width = 0;
+    bool device = false;
+    std::string signature;
+
+    // Lower the DAG rooted at root, false if inputs disagree in shape or host/device
+    bool compile(const Expr& root);
+    // Fused compute shader: reads t0.. and k[] at b0, writes u0 as RWTexture2DArray<output_type>,
+    // [numthreads(block_x, block_y, 1)] with one thread per (w, h) looping over channels
+    std::string hlsl(const char* output_type, unsigned int block_x, unsigned int block_y) const;
+    size_t register_count() const
+    {
+        return code.size();
+    }
+};
+
+/*
+ * Fused CPU kernel: the plan's code run over blocks of block_elements values, so
+ * every temporary is a small register array that stays in cache.
+ */
+struct Expr_Host_Kernel
+{
+    static const size_t block_elements = 1024;
+
+    std::vector<Expr_Instr> code;
+    size_t input_count = 0;
+
+    void init(const Expr_Plan& plan);
+    void run(const float* const* inputs, const float* constants, float* out, size_t count, size_t threads = 0) const;
+};
+
+// Host kernels by signature, shared by all Expr::eval() calls
+struct Expr_Host_Cache
+{
+    size_t hits = 0;
+    size_t misses = 0;
+
+    const Expr_Host_Kernel* get(const Expr_Plan& plan);
+    size_t size() const
+    {
+        return kernels.size();
+    }
+    static Expr_Host_Cache& instance();
+private:
+    std::map<std::string, std::unique_ptr<Expr_Host_Kernel>> kernels;
+    std::mutex mutex;
+};
@@ -0,0 +1,589 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+/*
+ * Compile-time description of the texture formats Texture_As_Buffer supports.
+ * format_traits<F> gives the storage type of one element (one 4x4 block for BC
+ * formats), its size and component count, and inline pack()/unpack() between the
+ * stored element and float components as a shader sees them. Format_View<F> is a
+ * typed, strided channels x height x width view of texture data, dense host arrays
+ * and padded staging rows alike, with row pointers and an element iterator.
+ * The generic algorithms below (format_generate, format_fill, format_convert,
+ * format_verify) instantiate once per format, so their loops carry no per-element
+ * format branch. The one runtime switch is visit_format(), which maps a DXGI_FORMAT
+ * value to its traits once per call; format_info() is the runtime summary built on it.
+ * Host-only, no D3D dependency: DXGI_FORMAT comes from dxgiformat.h where the SDK
+ * headers exist, otherwise from the subset below with the same values.
+ */
+#if __has_include(<dxgiformat.h>)
+#include <dxgiformat.h>
+#else
+enum DXGI_FORMAT
+{
+    DXGI_FORMAT_UNKNOWN = 0,
+    DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+    DXGI_FORMAT_R16G16B16A16_FLOAT = 10,
+    DXGI_FORMAT_R10G10B10A2_UNORM = 24,
+    DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+    DXGI_FORMAT_R16G16_FLOAT = 34,
+    DXGI_FORMAT_R32_FLOAT = 41,
+    DXGI_FORMAT_R16_FLOAT = 54,
+    DXGI_FORMAT_R8_UNORM = 61,
+    DXGI_FORMAT_BC4_UNORM = 80,
+    DXGI_FORMAT_BC4_SNORM = 81,
+    DXGI_FORMAT_BC5_UNORM = 83,
+    DXGI_FORMAT_BC5_SNORM = 84
+};
+#endif
+
+// IEEE half <-> float, round to nearest even as the hardware converts
+inline float half_to_float(uint16_t h)
+{
+    const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1f;
+    const uint32_t mantissa = h & 0x3ff;
+    if (exponent == 0) {
+        // Zero or subnormal, mantissa * 2^-24
+        const float f = (float)mantissa * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+    const uint32_t bits = exponent == 31 ? sign | 0x7f800000 | mantissa << 13 : sign | (exponent + 112) << 23 | mantissa << 13;
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+inline uint16_t float_to_half(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    const uint32_t magnitude = bits & 0x7fffffff;
+    if (magnitude >= 0x7f800000)
+        return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+    // 65520 and up round past the largest half
+    if (magnitude >= 0x477ff000)
+        return sign | 0x7c00;
+    if (magnitude < 0x38800000) {
+        // Below 2^-14 the half is subnormal, 2^-25 and under round to zero
+        if (magnitude <= 0x33000000)
+            return sign;
+        const uint32_t shift = 126 - (magnitude >> 23);
+        const uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+        uint32_t h = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (h & 1)))
+            h++;
+        return sign | (uint16_t)h;
+    }
+    // Rebias the exponent, a mantissa carry rolls into it
+    uint32_t h = (magnitude - 0x38000000) >> 13;
+    const uint32_t rest = magnitude & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (h & 1)))
+        h++;
+    return sign | (uint16_t)h;
+}
+
+// Float to an n-bit UNORM value: clamped to [0, 1], nearest integer
+inline uint32_t float_to_unorm(float f, uint32_t max_value)
+{
+    f = f > 0.0f ? (f < 1.0f ? f : 1.0f) : 0.0f;
+    return (uint32_t)(f * (float)max_value + 0.5f);
+}
+
+struct Format_Float4
+{
+    float c[4];
+};
+
+struct Format_Block16
+{
+    uint64_t lo;
+    uint64_t hi;
+};
+
+/*
+ * Per format: storage_type (one element, or one block_dim x block_dim block),
+ * components, component_size (bytes of one component when components are separately
+ * addressable, 0 for packed and block formats), block_dim, name and npy_descr (the
+ * .npy dtype of a component, or of the packed element). Element formats add
+ * unpack(element, float[components]) and pack(float[components]).
+ * Formats without a specialization are unsupported.
+ */
+template <DXGI_FORMAT Format>
+struct format_traits;
+
+template <>
+struct format_traits<DXGI_FORMAT_R8_UNORM>
+{
+    typedef uint8_t storage_type;
+    static constexpr size_t components = 1;
+    static constexpr size_t component_size = 1;
+    static constexpr size_t block_dim = 1;
+    static constexpr const char* name = "R8_UNORM";
+    static constexpr const char* npy_descr = "|u1";
+    static void unpack(storage_type e, float* out)
+    {
+        out[0] = (float)e / 255.0f;
+    }
+    static storage_type pack(const float* in)
+    {
+        return (storage_type)float_to_unorm(in[0], 255);
+    }
+};
+
+template <>
+struct format_traits<DXGI_FORMAT_R8G8B8A8_UNORM>
+{
+    typedef uint32_t storage_type;
+    static constexpr size_t components = 4;
+    static constexpr size_t component_size = 1;
+    static constexpr size_t block_dim = 1;
+    static constexpr const char* name = "R8G8B8A8_UNORM";
+    static constexpr const char* npy_descr = "|u1";
+    static void unpack(storage_type e, float* out)
+    {
+        for (size_t k = 0; k < 4; k++)
+            out[k] = (float)(e >> (8 * k) & 0xff) / 255.0f;
+    }
+    static storage_type pack(const float* in)
+    {
+        storage_type e = 0;
+        for (size_t k = 0; k < 4; k++)
+            e |= float_to_unorm(in[k], 255) << (8 * k);
+        return e;
+    }
+};
+
+template <>
+struct format_traits<DXGI_FORMAT_R10G10B10A2_UNORM>
+{
+    typedef uint32_t storage_type;
+    static constexpr size_t components = 4;
+    static constexpr size_t component_size = 0;
+    static constexpr size_t block_dim = 1;
+    static constexpr const char* name = "R10G10B10A2_UNORM";
+    static constexpr const char* npy_descr = "<u4";
+    static void unpack(storage_type e, float* out)
+    {
+        out[0] = (float)(e & 0x3ff) / 1023.0f;
+        out[1] = (float)(e >> 10 & 0x3ff) / 1023.0f;
+        out[2] = (float)(e >> 20 & 0x3ff) / 1023.0f;
+        out[3] = (float)(e >> 30) / 3.0f;
+    }
+    static storage_type pack(const float* in)
+    {
+        return float_to_unorm(in[0], 1023) | float_to_unorm(in[1], 1023) << 10 | float_to_unorm(in[2], 1023) << 20
+            | float_to_unorm(in[3], 3) << 30;
+    }
+};
+
+template <>
+struct format_traits<DXGI_FORMAT_R16_FLOAT>
+{
+    typedef uint16_t storage_type;
+    static constexpr size_t components = 1;
+    static constexpr size_t component_size = 2;
+    static constexpr size_t block_dim = 1;
+    static constexpr const char* name = "R16_FLOAT";
+    static constexpr const char* npy_descr = "<f2";
+    static void unpack(storage_type e, float* out)
+    {
+        out[0] = half_to_float(e);
+    }
+    static storage_type pack(const float* in)
+    {
+        return float_to_half(in[0]);
+    }
+};
+
+template <>
+struct format_traits<DXGI_FORMAT_R16G16_FLOAT>
+{
+    typedef uint32_t storage_type;
+    static constexpr size_t components = 2;
+    static constexpr size_t component_size = 2;
+    static constexpr size_t block_dim = 1;
+    static constexpr const char* name = "R16G16_FLOAT";
+    static constexpr const char* npy_descr = "<f2";
+    static void unpack(storage_type e, float* out)
+    {
+        out[0] = half_to_float((uint16_t)(e & 0xffff));
+        out[1] = half_to_float((uint16_t)(e >> 16));
+    }
+    static storage_type pack(const float* in)
+    {
+        return (storage_type)float_to_half(in[0]) | (storage_type)float_to_half(in[1]) << 16;
+    }
+};
+
+template <>
+struct format_traits<DXGI_FORMAT_R32_FLOAT>
+{
+    typedef float storage_type;
+    static constexpr size_t components = 1;
+    static constexpr size_t component_size = 4;
+    static constexpr size_t block_dim = 1;
+    static constexpr const char* name = "R32_FLOAT";
+    static constexpr const char* npy_descr = "<f4";
+    static void unpack(storage_type e, float* out)
+    {
+        out[0] = e;
+    }
+    static storage_type pack(const float* in)
+    {
+        return in[0];
+    }
+};
+
+template <>
+struct format_traits<DXGI_FORMAT_R16G16B16A16_FLOAT>
+{
+    typedef uint64_t storage_type;
+    static constexpr size_t components = 4;
+    static constexpr size_t component_size = 2;
+    static constexpr size_t block_dim = 1;
+    static constexpr const char* name = "R16G16B16A16_FLOAT";
+    static constexpr const char* npy_descr = "<f2";
+    static void unpack(storage_type e, float* out)
+    {
+        for (size_t k = 0; k < 4; k++)
+            out[k] = half_to_float((uint16_t)(e >> (16 * k) & 0xffff));
+    }
+    static storage_type pack(const float* in)
+    {
+        storage_type e = 0;
+        for (size_t k = 0; k < 4; k++)
+            e |= (storage_type)float_to_half(in[k]) << (16 * k);
+        return e;
+    }
+};
+
+template <>
+struct format_traits<DXGI_FORMAT_R32G32B32A32_FLOAT>
+{
+    typedef Format_Float4 storage_type;
+    static constexpr size_t components = 4;
+    static constexpr size_t component_size = 4;
+    static constexpr size_t block_dim = 1;
+    static constexpr const char* name = "R32G32B32A32_FLOAT";
+    static constexpr const char* npy_descr = "<f4";
+    static void unpack(const storage_type& e, float* out)
+    {
+        for (size_t k = 0; k < 4; k++)
+            out[k] = e.c[k];
+    }
+    static storage_type pack(const float* in)
+    {
+        return storage_type{ { in[0], in[1], in[2], in[3] } };
+    }
+};
+
+// Block-compressed formats describe their 4x4 blocks; decoding is block_compression.h's
+template <>
+struct format_traits<DXGI_FORMAT_BC4_UNORM>
+{
+    typedef uint64_t storage_type;
+    static constexpr size_t components = 1;
+    static constexpr size_t component_size = 0;
+    static constexpr size_t block_dim = 4;
+    static constexpr const char* name = "BC4_UNORM";
+    static constexpr const char* npy_descr = "";
+};
+
+template <>
+struct format_traits<DXGI_FORMAT_BC4_SNORM>
+{
+    typedef uint64_t storage_type;
+    static constexpr size_t components = 1;
+    static constexpr size_t component_size = 0;
+    static constexpr size_t block_dim = 4;
+    static constexpr const char* name = "BC4_SNORM";
+    static constexpr const char* npy_descr = "";
+};
+
+template <>
+struct format_traits<DXGI_FORMAT_BC5_UNORM>
+{
+    typedef Format_Block16 storage_type;
+    static constexpr size_t components = 2;
+    static constexpr size_t component_size = 0;
+    static constexpr size_t block_dim = 4;
+    static constexpr const char* name = "BC5_UNORM";
+    static constexpr const char* npy_descr = "";
+};
+
+template <>
+struct format_traits<DXGI_FORMAT_BC5_SNORM>
+{
+    typedef Format_Block16 storage_type;
+    static constexpr size_t components = 2;
+    static constexpr size_t component_size = 0;
+    static constexpr size_t block_dim = 4;
+    static constexpr const char* name = "BC5_SNORM";
+    static constexpr const char* npy_descr = "";
+};
+
+template <DXGI_FORMAT Format>
+struct Format_Tag
+{
+    static constexpr DXGI_FORMAT format = Format;
+};
+
+// fn(Format_Tag<F>()) for the traits of format; false, without calling fn, if the format is unsupported
+template <class Fn>
+bool visit_format(DXGI_FORMAT format, Fn&& fn)
+{
+    switch (format) {
+        case DXGI_FORMAT_R8_UNORM: fn(Format_Tag<DXGI_FORMAT_R8_UNORM>()); return true;
+        case DXGI_FORMAT_R8G8B8A8_UNORM: fn(Format_Tag<DXGI_FORMAT_R8G8B8A8_UNORM>()); return true;
+        case DXGI_FORMAT_R10G10B10A2_UNORM: fn(Format_Tag<DXGI_FORMAT_R10G10B10A2_UNORM>()); return true;
+        case DXGI_FORMAT_R16_FLOAT: fn(Format_Tag<DXGI_FORMAT_R16_FLOAT>()); return true;
+        case DXGI_FORMAT_R16G16_FLOAT: fn(Format_Tag<DXGI_FORMAT_R16G16_FLOAT>()); return true;
+        case DXGI_FORMAT_R32_FLOAT: fn(Format_Tag<DXGI_FORMAT_R32_FLOAT>()); return true;
+        case DXGI_FORMAT_R16G16B16A16_FLOAT: fn(Format_Tag<DXGI_FORMAT_R16G16B16A16_FLOAT>()); return true;
+        case DXGI_FORMAT_R32G32B32A32_FLOAT: fn(Format_Tag<DXGI_FORMAT_R32G32B32A32_FLOAT>()); return true;
+        case DXGI_FORMAT_BC4_UNORM: fn(Format_Tag<DXGI_FORMAT_BC4_UNORM>()); return true;
+        case DXGI_FORMAT_BC4_SNORM: fn(Format_Tag<DXGI_FORMAT_BC4_SNORM>()); return true;
+        case DXGI_FORMAT_BC5_UNORM: fn(Format_Tag<DXGI_FORMAT_BC5_UNORM>()); return true;
+        case DXGI_FORMAT_BC5_SNORM: fn(Format_Tag<DXGI_FORMAT_BC5_SNORM>()); return true;
+        default: return false;
+    }
+}
+
+// Runtime summary of format_traits, for code that only holds a DXGI_FORMAT value
+struct Format_Info
+{
+    const char* name = "";
+    size_t element_size = 0;    // Bytes per element, or per 4x4 block for block-compressed formats
+    size_t components = 0;
+    size_t component_size = 0;
+    size_t block_dim = 1;
+    const char* npy_descr = "";
+};
+
+template <DXGI_FORMAT Format>
+Format_Info make_format_info()
+{
+    typedef format_traits<Format> traits;
+    Format_Info info;
+    info.name = traits::name;
+    info.element_size = sizeof(typename traits::storage_type);
+    info.components = traits::components;
+    info.component_size = traits::component_size;
+    info.block_dim = traits::block_dim;
+    info.npy_descr = traits::npy_descr;
+    return info;
+}
+
+inline bool format_info(DXGI_FORMAT format, Format_Info& info)
+{
+    return visit_format(format, [&](auto tag) {
+        info = make_format_info<decltype(tag)::format>();
+    });
+}
+
+/*
+ * Typed view of channels x height x width elements of Format: channel c starts
+ * slice_pitch bytes after channel c - 1, row h row_pitch bytes after row h - 1,
+ * so it covers dense host arrays and mapped staging textures with padded rows.
+ * For block-compressed formats the elements are blocks.
+ */
+template <DXGI_FORMAT Format>
+struct Format_View
+{
+    typedef format_traits<Format> traits;
+    typedef typename traits::storage_type storage_type;
+
+    unsigned char* data = nullptr;
+    size_t channels = 0;
+    size_t height = 0;
+    size_t width = 0;
+    size_t row_pitch = 0;
+    size_t slice_pitch = 0;
+
+    Format_View() {}
+    // Dense array
+    Format_View(void* __data, size_t __channels, size_t __height, size_t __width)
+        : Format_View(__data, __channels, __height, __width, __width * sizeof(storage_type), __height * __width * sizeof(storage_type)) {}
+    Format_View(void* __data, size_t __channels, size_t __height, size_t __width, size_t __row_pitch, size_t __slice_pitch)
+        : data((unsigned char*)__data), channels(__channels), height(__height), width(__width), row_pitch(__row_pitch), slice_pitch(__slice_pitch) {}
+
+    size_t size() const
+    {
+        return channels * height * width;
+    }
+    storage_type* row(size_t c, size_t h) const
+    {
+        return (storage_type*)(data + c * slice_pitch + h * row_pitch);
+    }
+    storage_type& at(size_t c, size_t h, size_t w) const
+    {
+        return row(c, h)[w];
+    }
+    void load(size_t c, size_t h, size_t w, float* out) const
+    {
+        traits::unpack(at(c, h, w), out);
+    }
+    void store(size_t c, size_t h, size_t w, const float* in) const
+    {
+        at(c, h, w) = traits::pack(in);
+    }
+
+    // Every element in channel, row, column order, stepping over row and slice padding
+    class iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef storage_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef storage_type* pointer;
+        typedef storage_type& reference;
+
+        iterator() {}
+        iterator(const Format_View* __view, size_t __row) : m_view(__view), m_row(__row)
+        {
+            enter_row();
+        }
+        reference operator*() const
+        {
+            return *m_p;
+        }
+        pointer operator->() const
+        {
+            return m_p;
+        }
+        iterator& operator++()
+        {
+            if (++m_p == m_row_end) {
+                m_row++;
+                enter_row();
+            }
+            return *this;
+        }
+        iterator operator++(int)
+        {
+            iterator before = *this;
+            ++*this;
+            return before;
+        }
+        bool operator==(const iterator& other) const
+        {
+            return m_p == other.m_p;
+        }
+        bool operator!=(const iterator& other) const
+        {
+            return m_p != other.m_p;
+        }
+    private:
+        void enter_row()
+        {
+            if (m_view == nullptr || m_view->width == 0 || m_row >= m_view->channels * m_view->height) {
+                m_p = m_row_end = nullptr;
+                return;
+            }
+            m_p = m_view->row(m_row / m_view->height, m_row % m_view->height);
+            m_row_end = m_p + m_view->width;
+        }
+
+        const Format_View* m_view = nullptr;
+        size_t m_row = 0;
+        storage_type* m_p = nullptr;
+        storage_type* m_row_end = nullptr;
+    };
+
+    iterator begin() const
+    {
+        return iterator(this, 0);
+    }
+    iterator end() const
+    {
+        return iterator();
+    }
+};
+
+// Every element from fn(c, h, w, float* components)
+template <DXGI_FORMAT Format, class Fn>
+void format_generate(const Format_View<Format>& view, Fn fn)
+{
+    typedef format_traits<Format> traits;
+    float value[4] = {};
+    for (size_t c = 0; c < view.channels; c++)
+        for (size_t h = 0; h < view.height; h++) {
+            typename traits::storage_type* row = view.row(c, h);
+            for (size_t w = 0; w < view.width; w++) {
+                fn(c, h, w, value);
+                row[w] = traits::pack(value);
+            }
+        }
+}
+
+// Every element set to value (components floats), packed once
+template <DXGI_FORMAT Format>
+void format_fill(const Format_View<Format>& view, const float* value)
+{
+    const typename format_traits<Format>::storage_type e = format_traits<Format>::pack(value);
+    for (size_t c = 0; c < view.channels; c++)
+        for (size_t h = 0; h < view.height; h++) {
+            typename format_traits<Format>::storage_type* row = view.row(c, h);
+            for (size_t w = 0; w < view.width; w++)
+                row[w] = e;
+        }
+}
+
+// dst = src element by element through float; components dst has beyond src read (0, 0, 0, 1).
+// False if the shapes differ.
+template <DXGI_FORMAT Src, DXGI_FORMAT Dst>
+bool format_convert(const Format_View<Src>& src, const Format_View<Dst>& dst)
+{
+    if (src.channels != dst.channels || src.height != dst.height || src.width != dst.width)
+        return false;
+    for (size_t c = 0; c < src.channels; c++)
+        for (size_t h = 0; h < src.height; h++) {
+            const typename format_traits<Src>::storage_type* in = src.row(c, h);
+            typename format_traits<Dst>::storage_type* out = dst.row(c, h);
+            for (size_t w = 0; w < src.width; w++) {
+                float value[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+                format_traits<Src>::unpack(in[w], value);
+                out[w] = format_traits<Dst>::pack(value);
+            }
+        }
+    return true;
+}
+
+struct Format_Error
+{
+    size_t mismatches = 0;      // Elements with a component off by more than the tolerance
+    double sum = 0.0;           // Absolute error summed over every component
+    double max = 0.0;
+};
+
+// Unpacked elements against fn(c, h, w, float* expected components)
+template <DXGI_FORMAT Format, class Fn>
+Format_Error format_verify(const Format_View<Format>& view, Fn expected, float tolerance)
+{
+    typedef format_traits<Format> traits;
+    Format_Error error;
+    float value[4] = {}, reference[4] = {};
+    for (size_t c = 0; c < view.channels; c++)
+        for (size_t h = 0; h < view.height; h++) {
+            const typename traits::storage_type* row = view.row(c, h);
+            for (size_t w = 0; w < view.width; w++) {
+                traits::unpack(row[w], value);
+                expected(c, h, w, reference);
+                bool mismatch = false;
+                for (size_t k = 0; k < traits::components; k++) {
+                    const float d = value[k] > reference[k] ? value[k] - reference[k] : reference[k] - value[k];
+                    error.sum += d;
+                    error.max = d > error.max ? d : error.max;
+                    mismatch |= !(d <= tolerance);
+                }
+                error.mismatches += mismatch;
+            }
+        }
+    return error;
+}
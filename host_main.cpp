@@ -0,0 +1,52 @@
+#include "test_host.h"
+#include "benchmark.h"
+#include <iostream>
+
+// Host-only tests, built on every platform (see main.cpp for the D3D11 tests)
+void run_host_tests()
+{
+    run_tile_layout_test();
+    run_stream_executor_host_test();
+    run_transfer_codec_host_test();
+    run_mapped_file_host_test();
+    run_snapshot_host_test();
+    run_pipeline_scheduler_host_test();
+    run_expr_graph_host_test();
+    run_reduction_host_test();
+    run_scan_host_test();
+    run_constant_ring_host_test();
+    run_binding_table_host_test();
+    run_indirect_dispatch_host_test();
+    run_sparse_texture_host_test();
+    run_compressed_texture_host_test();
+    run_layout_transform_host_test();
+    run_residency_host_test();
+    run_metrics_host_test();
+    run_stencil_host_test();
+    run_kernel_stats_host_test();
+    run_command_stream_host_test();
+    run_benchmark_host_test();
+    run_atlas_host_test();
+    run_format_traits_test();
+    run_submission_queue_host_test();
+}
+
+int main(int argc, char* argv[])
+{
+    Benchmark_Options options;
+    std::string error;
+    if (!parse_benchmark_options(argc, argv, options, error)) {
+        std::cerr << error << std::endl;
+        std::cerr << "Usage: D3D11_Storage_Test_Host" << std::endl;
+        std::cerr << "       D3D11_Storage_Test_Host --workload <file.json> [--output <results.json> | -] [--host]" << std::endl;
+        return 2;
+    }
+    // There is no device here, so every workload runs on the CPU backend and --device is ignored
+    if (!options.workload.empty()) {
+        Host_Benchmark_Backend backend;
+        return run_benchmark_driver(options, backend);
+    }
+
+    run_host_tests();
+    return 0;
+}
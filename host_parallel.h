@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Split [0, count) into contiguous ranges and run fn(begin, end) on up to `threads` threads (0 = hardware concurrency)
+template<typename F>
+void parallel_for(size_t count, F fn, size_t threads = 0)
+{
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+    if (threads > count)
+        threads = count;
+    if (threads <= 1) {
+        if (count > 0)
+            fn((size_t)0, count);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    size_t chunk = (count + threads - 1) / threads;
+    for (size_t begin = chunk; begin < count; begin += chunk) {
+        size_t end = begin + chunk < count ? begin + chunk : count;
+        workers.emplace_back(fn, begin, end);
+    }
+    fn((size_t)0, chunk < count ? chunk : count);
+    for (auto& w : workers)
+        w.join();
+}
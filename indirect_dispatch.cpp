@@ -0,0 +1,73 @@
+#include "indirect_dispatch.h"
+#include "host_parallel.h"
+#include <iostream>
+
+Dispatch_Args dispatch_args_for_count(uint64_t count, uint32_t items_per_group)
+{
+    Dispatch_Args args;
+    uint64_t groups = (count + items_per_group - 1) / items_per_group;
+    args.x = (uint32_t)(groups < max_groups_per_dimension ? groups : max_groups_per_dimension);
+    args.y = groups == 0 ? 1 : (uint32_t)((groups + args.x - 1) / args.x);
+    args.z = 1;
+    return args;
+}
+
+void Host_Indirect_Buffer::init(size_t slots)
+{
+    words.assign(slots * 3, 0);
+}
+
+bool Host_Indirect_Buffer::write(size_t byte_offset, const Dispatch_Args& args)
+{
+    if (byte_offset % 4 != 0 || byte_offset + dispatch_args_bytes > words.size() * 4) {
+        std::cout << "Failed to write dispatch args at byte " << byte_offset << ", offset unaligned or past the buffer." << std::endl;
+        return false;
+    }
+    uint32_t* p = words.data() + byte_offset / 4;
+    p[0] = args.x;
+    p[1] = args.y;
+    p[2] = args.z;
+    return true;
+}
+
+bool Host_Indirect_Buffer::read(size_t byte_offset, Dispatch_Args& args) const
+{
+    if (byte_offset % 4 != 0 || byte_offset + dispatch_args_bytes > words.size() * 4) {
+        std::cout << "Failed to read dispatch args at byte " << byte_offset << ", offset unaligned or past the buffer." << std::endl;
+        return false;
+    }
+    const uint32_t* p = words.data() + byte_offset / 4;
+    args.x = p[0];
+    args.y = p[1];
+    args.z = p[2];
+    return true;
+}
+
+bool host_dispatch(const Dispatch_Args& args, const Host_Group_Kernel& kernel, size_t threads)
+{
+    // The device drops a dispatch over the limit; report it instead of running a different one
+    if (args.x > max_groups_per_dimension || args.y > max_groups_per_dimension || args.z > max_groups_per_dimension) {
+        std::cout << "Failed to dispatch (" << args.x << ", " << args.y << ", " << args.z << ") groups, a dimension exceeds "
+            << max_groups_per_dimension << "." << std::endl;
+        return false;
+    }
+    const size_t groups = (size_t)args.x * args.y * args.z;
+    parallel_for(groups, [&](size_t begin, size_t end) {
+        for (size_t g = begin; g < end; g++) {
+            Host_Group_Id id;
+            id.x = (uint32_t)(g % args.x);
+            id.y = (uint32_t)(g / args.x % args.y);
+            id.z = (uint32_t)(g / ((size_t)args.x * args.y));
+            kernel(id, args);
+        }
+    }, threads);
+    return true;
+}
+
+bool host_dispatch_indirect(const Host_Indirect_Buffer& buffer, size_t byte_offset, const Host_Group_Kernel& kernel, size_t threads)
+{
+    Dispatch_Args args;
+    if (!buffer.read(byte_offset, args))
+        return false;
+    return host_dispatch(args, kernel, threads);
+}
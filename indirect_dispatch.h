@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+ * Indirect dispatch: group counts produced by an earlier kernel and consumed by a
+ * later dispatch without the CPU reading them. Arguments use the D3D11
+ * DispatchIndirect layout, three uints (x, y, z) at a 4-byte aligned byte offset,
+ * so one buffer holds several argument slots.
+ *
+ * Work sizes above max_groups_per_dimension groups fold into y; a consumer recovers
+ * its linear group as y * max_groups_per_dimension + x, which holds for every args
+ * value dispatch_args_for_count() produces.
+ *
+ * The host side emulates the whole path for testing without a device:
+ * Host_Indirect_Buffer stands in for the argument buffer and host_dispatch_indirect()
+ * runs a group kernel over the groups the stored arguments name, in parallel.
+ * Host-only, no D3D dependency (see d3d11_indirect.h for the device side).
+ */
+struct Dispatch_Args
+{
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t z = 0;
+};
+
+static const uint32_t max_groups_per_dimension = 65535;     // D3D11_CS_DISPATCH_MAX_THREAD_GROUPS_PER_DIMENSION
+static const size_t dispatch_args_bytes = 3 * sizeof(uint32_t);
+
+// Groups covering count items of items_per_group each; (0, 1, 1) for no items
+Dispatch_Args dispatch_args_for_count(uint64_t count, uint32_t items_per_group);
+
+struct Host_Group_Id
+{
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t z = 0;
+
+    uint64_t linear() const
+    {
+        return ((uint64_t)z * max_groups_per_dimension + y) * max_groups_per_dimension + x;
+    }
+};
+
+// Stands in for a DRAWINDIRECT_ARGS buffer: slots of three uints written by host kernels
+struct Host_Indirect_Buffer
+{
+    std::vector<uint32_t> words;
+
+    void init(size_t slots);
+    size_t slots() const
+    {
+        return words.size() / 3;
+    }
+    // Write args at byte_offset (4-byte aligned, like the device buffer)
+    bool write(size_t byte_offset, const Dispatch_Args& args);
+    bool read(size_t byte_offset, Dispatch_Args& args) const;
+};
+
+// Body of one thread group, called with its group id and the args of the dispatch
+typedef std::function<void(const Host_Group_Id&, const Dispatch_Args&)> Host_Group_Kernel;
+
+// Run every group of args, groups in parallel (threads = 0 uses all cores). False if a dimension exceeds the limit.
+bool host_dispatch(const Dispatch_Args& args, const Host_Group_Kernel& kernel, size_t threads = 0);
+// DispatchIndirect on the host: read the args at byte_offset, then host_dispatch()
+bool host_dispatch_indirect(const Host_Indirect_Buffer& buffer, size_t byte_offset, const Host_Group_Kernel& kernel, size_t threads = 0);
@@ -0,0 +1,380 @@
+#include "json.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// Nesting deeper than this is rejected rather than recursed into
+static const size_t json_max_depth = 256;
+
+struct Json_Parser
+{
+    const std::string& text;
+    size_t pos = 0;
+    std::string error;
+
+    Json_Parser(const std::string& __text) : text(__text) {}
+
+    bool fail(const char* message)
+    {
+        if (!error.empty())
+            return false;
+        size_t line = 1, column = 1;
+        for (size_t i = 0; i < pos && i < text.size(); i++) {
+            if (text[i] == '\n') {
+                line++;
+                column = 1;
+            }
+            else {
+                column++;
+            }
+        }
+        error = std::to_string(line) + ":" + std::to_string(column) + ": " + message;
+        return false;
+    }
+
+    void skip_space()
+    {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r'))
+            pos++;
+    }
+
+    bool literal(const char* word)
+    {
+        for (size_t i = 0; word[i]; i++, pos++) {
+            if (pos >= text.size() || text[pos] != word[i])
+                return fail("invalid literal");
+        }
+        return true;
+    }
+
+    bool hex4(unsigned& code)
+    {
+        code = 0;
+        for (int i = 0; i < 4; i++, pos++) {
+            if (pos >= text.size())
+                return fail("truncated \\u escape");
+            const char c = text[pos];
+            code <<= 4;
+            if (c >= '0' && c <= '9')
+                code |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                code |= c - 'A' + 10;
+            else
+                return fail("invalid \\u escape");
+        }
+        return true;
+    }
+
+    static void append_utf8(std::string& out, unsigned code)
+    {
+        if (code < 0x80) {
+            out += (char)code;
+        }
+        else if (code < 0x800) {
+            out += (char)(0xc0 | (code >> 6));
+            out += (char)(0x80 | (code & 0x3f));
+        }
+        else if (code < 0x10000) {
+            out += (char)(0xe0 | (code >> 12));
+            out += (char)(0x80 | ((code >> 6) & 0x3f));
+            out += (char)(0x80 | (code & 0x3f));
+        }
+        else {
+            out += (char)(0xf0 | (code >> 18));
+            out += (char)(0x80 | ((code >> 12) & 0x3f));
+            out += (char)(0x80 | ((code >> 6) & 0x3f));
+            out += (char)(0x80 | (code & 0x3f));
+        }
+    }
+
+    bool string(std::string& out)
+    {
+        pos++;  // Opening quote
+        while (true) {
+            if (pos >= text.size())
+                return fail("unterminated string");
+            const char c = text[pos++];
+            if (c == '"')
+                return true;
+            if ((unsigned char)c < 0x20)
+                return fail("control character in string");
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size())
+                return fail("unterminated string");
+            const char e = text[pos++];
+            switch (e) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned code;
+                if (!hex4(code))
+                    return false;
+                // A high surrogate must be followed by an escaped low one
+                if (code >= 0xd800 && code < 0xdc00) {
+                    unsigned low;
+                    if (pos + 1 >= text.size() || text[pos] != '\\' || text[pos + 1] != 'u')
+                        return fail("unpaired surrogate");
+                    pos += 2;
+                    if (!hex4(low))
+                        return false;
+                    if (low < 0xdc00 || low >= 0xe000)
+                        return fail("unpaired surrogate");
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                else if (code >= 0xdc00 && code < 0xe000) {
+                    return fail("unpaired surrogate");
+                }
+                append_utf8(out, code);
+                break;
+            }
+            default:
+                pos--;
+                return fail("invalid escape");
+            }
+        }
+    }
+
+    static bool digit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    bool number(double& out)
+    {
+        const size_t begin = pos;
+        if (text[pos] == '-')
+            pos++;
+        if (pos >= text.size() || !digit(text[pos]))
+            return fail("invalid number");
+        if (text[pos] == '0')
+            pos++;
+        else
+            while (pos < text.size() && digit(text[pos]))
+                pos++;
+        if (pos < text.size() && text[pos] == '.') {
+            pos++;
+            if (pos >= text.size() || !digit(text[pos]))
+                return fail("invalid number");
+            while (pos < text.size() && digit(text[pos]))
+                pos++;
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            pos++;
+            if (pos < text.size() && (text[pos] == '+' || text[pos] == '-'))
+                pos++;
+            if (pos >= text.size() || !digit(text[pos]))
+                return fail("invalid number");
+            while (pos < text.size() && digit(text[pos]))
+                pos++;
+        }
+        // The grammar is checked above, strtod only converts ("C" locale digits and '.')
+        out = std::strtod(text.substr(begin, pos - begin).c_str(), nullptr);
+        return true;
+    }
+
+    bool value(Json_Value& out, size_t depth)
+    {
+        if (depth > json_max_depth)
+            return fail("nesting too deep");
+        skip_space();
+        if (pos >= text.size())
+            return fail("unexpected end of input");
+        const char c = text[pos];
+        if (c == '{') {
+            out.type = JSON_OBJECT;
+            pos++;
+            skip_space();
+            if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                return true;
+            }
+            while (true) {
+                skip_space();
+                if (pos >= text.size() || text[pos] != '"')
+                    return fail("expected member name");
+                std::pair<std::string, Json_Value> member;
+                if (!string(member.first))
+                    return false;
+                skip_space();
+                if (pos >= text.size() || text[pos] != ':')
+                    return fail("expected ':'");
+                pos++;
+                if (!value(member.second, depth + 1))
+                    return false;
+                out.object.push_back(std::move(member));
+                skip_space();
+                if (pos < text.size() && text[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                if (pos < text.size() && text[pos] == '}') {
+                    pos++;
+                    return true;
+                }
+                return fail("expected ',' or '}'");
+            }
+        }
+        if (c == '[') {
+            out.type = JSON_ARRAY;
+            pos++;
+            skip_space();
+            if (pos < text.size() && text[pos] == ']') {
+                pos++;
+                return true;
+            }
+            while (true) {
+                out.array.emplace_back();
+                if (!value(out.array.back(), depth + 1))
+                    return false;
+                skip_space();
+                if (pos < text.size() && text[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                if (pos < text.size() && text[pos] == ']') {
+                    pos++;
+                    return true;
+                }
+                return fail("expected ',' or ']'");
+            }
+        }
+        if (c == '"') {
+            out.type = JSON_STRING;
+            return string(out.string);
+        }
+        if (c == 't') {
+            out.type = JSON_BOOL;
+            out.boolean = true;
+            return literal("true");
+        }
+        if (c == 'f') {
+            out.type = JSON_BOOL;
+            return literal("false");
+        }
+        if (c == 'n') {
+            out.type = JSON_NULL;
+            return literal("null");
+        }
+        if (c == '-' || digit(c)) {
+            out.type = JSON_NUMBER;
+            return number(out.number);
+        }
+        return fail("unexpected character");
+    }
+};
+
+const Json_Value* Json_Value::find(const char* key) const
+{
+    if (type != JSON_OBJECT)
+        return nullptr;
+    for (size_t i = object.size(); i-- > 0;) {
+        if (object[i].first == key)
+            return &object[i].second;
+    }
+    return nullptr;
+}
+
+double Json_Value::get_number(const char* key, double fallback) const
+{
+    const Json_Value* v = find(key);
+    return v && v->type == JSON_NUMBER ? v->number : fallback;
+}
+
+std::string Json_Value::get_string(const char* key, const char* fallback) const
+{
+    const Json_Value* v = find(key);
+    return v && v->type == JSON_STRING ? v->string : std::string(fallback);
+}
+
+bool Json_Value::get_bool(const char* key, bool fallback) const
+{
+    const Json_Value* v = find(key);
+    return v && v->type == JSON_BOOL ? v->boolean : fallback;
+}
+
+std::string Json_Value::as_text() const
+{
+    switch (type) {
+    case JSON_STRING:
+        return string;
+    case JSON_BOOL:
+        return boolean ? "true" : "false";
+    case JSON_NUMBER: {
+        if (number == std::floor(number) && std::fabs(number) < 1e15)
+            return std::to_string((long long)number);
+        std::ostringstream out;
+        out.precision(17);
+        out << number;
+        return out.str();
+    }
+    default:
+        return "";
+    }
+}
+
+bool json_parse(const std::string& text, Json_Value& out, std::string& error)
+{
+    Json_Parser parser(text);
+    out = Json_Value();
+    if (parser.value(out, 0)) {
+        parser.skip_space();
+        if (parser.pos == text.size())
+            return true;
+        parser.fail("trailing content");
+    }
+    error = parser.error;
+    return false;
+}
+
+bool json_parse_file(const char* path, Json_Value& out, std::string& error)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    if (!json_parse(text.str(), out, error)) {
+        error = std::string(path) + ":" + error;
+        return false;
+    }
+    return true;
+}
+
+std::string json_quote(const std::string& s)
+{
+    std::string out = "\"";
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)c);
+                out += escaped;
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    return out + "\"";
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Minimal JSON reader for configuration files (benchmark workloads): the full grammar,
+ * objects kept in file order, numbers as doubles, \u escapes decoded to UTF-8 (surrogate
+ * pairs included). Errors report the line and column. Writers in this repo emit their
+ * JSON directly; json_quote() escapes strings for them.
+ * Host-only, no D3D dependency.
+ */
+enum Json_Type
+{
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+};
+
+struct Json_Value
+{
+    Json_Type type = JSON_NULL;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<Json_Value> array;
+    std::vector<std::pair<std::string, Json_Value>> object;
+
+    // Member of an object, nullptr if absent or not an object (the last one wins for duplicate keys)
+    const Json_Value* find(const char* key) const;
+    // Typed lookups with a fallback for absent members or a different type
+    double get_number(const char* key, double fallback) const;
+    std::string get_string(const char* key, const char* fallback) const;
+    bool get_bool(const char* key, bool fallback) const;
+    // Strings as-is, numbers without a trailing ".0", booleans as "true"/"false"; "" otherwise
+    std::string as_text() const;
+};
+
+// False with "line:column: message" in error on malformed input; trailing content other than whitespace is an error
+bool json_parse(const std::string& text, Json_Value& out, std::string& error);
+bool json_parse_file(const char* path, Json_Value& out, std::string& error);
+// s as a JSON string literal, quotes included
+std::string json_quote(const std::string& s);
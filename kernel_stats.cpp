@@ -0,0 +1,89 @@
+#include "kernel_stats.h"
+#include <iomanip>
+#include <sstream>
+
+Kernel_Shape Kernel_Shape::cover(uint32_t group_x, uint32_t group_y, uint32_t group_z, uint64_t extent_x, uint64_t extent_y, uint64_t extent_z)
+{
+    Kernel_Shape s;
+    s.group_x = group_x;
+    s.group_y = group_y;
+    s.group_z = group_z;
+    s.groups_x = (uint32_t)((extent_x + group_x - 1) / group_x);
+    s.groups_y = (uint32_t)((extent_y + group_y - 1) / group_y);
+    s.groups_z = (uint32_t)((extent_z + group_z - 1) / group_z);
+    s.extent_x = extent_x;
+    s.extent_y = extent_y;
+    s.extent_z = extent_z;
+    return s;
+}
+
+// Threads of one axis that fall inside the extent, the launch clipped to it
+static uint64_t covered(uint64_t groups, uint64_t group, uint64_t extent)
+{
+    return groups * group < extent ? groups * group : extent;
+}
+
+Kernel_Metrics derive_kernel_metrics(const Kernel_Shape& shape, const Kernel_Work& work, double ms, uint64_t invocations,
+    const Device_Peaks& peaks)
+{
+    Kernel_Metrics m;
+    m.ms = ms;
+    const double bytes = (double)(work.bytes_read + work.bytes_written);
+    if (ms > 0.0) {
+        m.gbs = bytes / (ms * 1e6);
+        m.gops = work.ops / (ms * 1e6);
+    }
+    m.intensity = bytes > 0.0 ? work.ops / bytes : 0.0;
+
+    const uint64_t launched = shape.launched_threads();
+    m.invocations = invocations ? invocations : launched;
+    m.invocations_per_element = work.elements ? (double)m.invocations / work.elements : 0.0;
+
+    // Edge groups run their lanes past the extent, and a group that is not a multiple of the
+    // SIMD width leaves the tail of its last wave idle in every group
+    const uint64_t inside = covered(shape.groups_x, shape.group_x, shape.extent_x) * covered(shape.groups_y, shape.group_y, shape.extent_y)
+        * covered(shape.groups_z, shape.group_z, shape.extent_z);
+    const uint64_t simd = peaks.simd_width ? peaks.simd_width : 1;
+    const uint64_t wave_lanes = (shape.group_size() + simd - 1) / simd * simd;
+    m.extent_utilization = launched ? (double)inside / launched : 0.0;
+    m.wave_utilization = wave_lanes ? (double)shape.group_size() / wave_lanes : 0.0;
+    m.lane_utilization = m.extent_utilization * m.wave_utilization;
+
+    // Roofline: below the ridge point (gops / bandwidth ops per byte) bandwidth caps the kernel
+    if (peaks.bandwidth_gbs <= 0.0 || ms <= 0.0)
+        return m;
+    const bool compute_side = peaks.gops > 0.0 && m.intensity > peaks.gops / peaks.bandwidth_gbs;
+    m.roof_gbs = compute_side ? peaks.gops / m.intensity : peaks.bandwidth_gbs;
+    m.roof_fraction = m.gbs / m.roof_gbs;
+    if (m.roof_fraction < kernel_bound_threshold)
+        m.bound = KERNEL_BOUND_LATENCY;
+    else
+        m.bound = compute_side ? KERNEL_BOUND_COMPUTE : KERNEL_BOUND_MEMORY;
+    return m;
+}
+
+const char* kernel_bound_name(Kernel_Bound bound)
+{
+    switch (bound) {
+    case KERNEL_BOUND_MEMORY:
+        return "memory";
+    case KERNEL_BOUND_COMPUTE:
+        return "compute";
+    case KERNEL_BOUND_LATENCY:
+        return "latency";
+    default:
+        return "unknown";
+    }
+}
+
+std::string format_kernel_metrics(const char* name, const Kernel_Metrics& m)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3) << name << ": " << m.ms << " ms, " << std::setprecision(1) << m.gbs << " GB/s, "
+        << m.gops << " Gops, " << std::setprecision(2) << m.invocations_per_element << " invocations/element, lanes "
+        << std::setprecision(1) << 100.0 * m.lane_utilization << "% (extent " << 100.0 * m.extent_utilization << "%, waves "
+        << 100.0 * m.wave_utilization << "%), " << kernel_bound_name(m.bound) << " bound";
+    if (m.roof_gbs > 0.0)
+        out << " at " << 100.0 * m.roof_fraction << "% of roof";
+    return out.str();
+}
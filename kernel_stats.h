@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Derived metrics for one timed dispatch: achieved bandwidth and throughput
+ * from the bytes and operations the caller declares the kernel touches, how
+ * many launched lanes land inside the extent (partial edge groups, and groups
+ * that do not fill whole SIMD waves), invocations per element from the pipeline
+ * statistics, and a roofline classification against the device peaks.
+ * Host-only, no D3D dependency (see D3D11_Performance_Counter for the measurements).
+ */
+
+// Launch geometry: numthreads, the group counts passed to Dispatch, and the thread extent that does work
+struct Kernel_Shape
+{
+    uint32_t group_x = 1, group_y = 1, group_z = 1;
+    uint32_t groups_x = 1, groups_y = 1, groups_z = 1;
+    uint64_t extent_x = 1, extent_y = 1, extent_z = 1;
+
+    // Groups covering an extent with one thread per point
+    static Kernel_Shape cover(uint32_t group_x, uint32_t group_y, uint32_t group_z, uint64_t extent_x, uint64_t extent_y, uint64_t extent_z);
+    uint64_t group_size() const
+    {
+        return (uint64_t)group_x * group_y * group_z;
+    }
+    uint64_t groups() const
+    {
+        return (uint64_t)groups_x * groups_y * groups_z;
+    }
+    uint64_t launched_threads() const
+    {
+        return groups() * group_size();
+    }
+    uint64_t extent_threads() const
+    {
+        return extent_x * extent_y * extent_z;
+    }
+};
+
+// What the kernel is declared to do over the whole dispatch
+struct Kernel_Work
+{
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+    uint64_t ops = 0;           // Arithmetic operations, 0 if not worth counting
+    uint64_t elements = 0;      // Output elements, the unit for invocations per element
+};
+
+struct Device_Peaks
+{
+    double bandwidth_gbs = 0.0;     // Memory bandwidth, 0 if unknown
+    double gops = 0.0;              // Arithmetic throughput, 0 if unknown
+    uint32_t simd_width = 32;       // Lanes per wave the hardware schedules a group in
+};
+
+enum Kernel_Bound
+{
+    KERNEL_BOUND_UNKNOWN,   // No peaks to compare against
+    KERNEL_BOUND_MEMORY,    // Left of the ridge point and near the bandwidth roof
+    KERNEL_BOUND_COMPUTE,   // Right of the ridge point and near the compute roof
+    KERNEL_BOUND_LATENCY    // Well below the roof that applies: launch overhead, occupancy or dependencies
+};
+
+// Fraction of the applicable roof a kernel must reach to be called memory or compute bound
+static const double kernel_bound_threshold = 0.5;
+
+struct Kernel_Metrics
+{
+    double ms = 0.0;
+    double gbs = 0.0;                       // (bytes_read + bytes_written) / time
+    double gops = 0.0;
+    double intensity = 0.0;                 // Operations per byte
+    uint64_t invocations = 0;               // CSInvocations, the launched threads if not measured
+    double invocations_per_element = 0.0;
+    double extent_utilization = 0.0;        // Threads inside the extent / threads launched
+    double wave_utilization = 0.0;          // Group size / lanes of the waves it occupies
+    double lane_utilization = 0.0;          // Both: lanes doing work / lanes scheduled
+    double roof_gbs = 0.0;                  // Attainable at this intensity, min(bandwidth, gops / intensity)
+    double roof_fraction = 0.0;             // Achieved / attainable, 0 without peaks
+    Kernel_Bound bound = KERNEL_BOUND_UNKNOWN;
+};
+
+// invocations is the measured CSInvocations, 0 if the pipeline statistics are not available
+Kernel_Metrics derive_kernel_metrics(const Kernel_Shape& shape, const Kernel_Work& work, double ms, uint64_t invocations,
+    const Device_Peaks& peaks);
+const char* kernel_bound_name(Kernel_Bound bound);
+// One line for logs
+std::string format_kernel_metrics(const char* name, const Kernel_Metrics& m);
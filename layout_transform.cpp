@@ -0,0 +1,119 @@
+#include "layout_transform.h"
+#include "host_parallel.h"
+#include <cstdint>
+#include <vector>
+
+// Pixels per block: a block of up to 16 channels of 4-byte elements is 16KB, inside L1
+static const size_t transform_block_pixels = 256;
+// Channels per pass for channel counts without a fixed-stride kernel
+static const size_t transform_block_channels = 16;
+
+template<typename T, size_t C>
+static void gather_fixed(const T* src, T* const* dst, size_t w0, size_t w1)
+{
+    for (size_t c = 0; c < C; c++) {
+        T* plane = dst[c];
+        for (size_t w = w0; w < w1; w++)
+            plane[w] = src[w * C + c];
+    }
+}
+
+template<typename T, size_t C>
+static void scatter_fixed(const T* const* src, T* dst, size_t w0, size_t w1)
+{
+    for (size_t w = w0; w < w1; w++)
+        for (size_t c = 0; c < C; c++)
+            dst[w * C + c] = src[c][w];
+}
+
+template<typename T>
+static void gather_row(const T* src, T* const* dst, size_t channels, size_t width)
+{
+    for (size_t w0 = 0; w0 < width; w0 += transform_block_pixels) {
+        const size_t w1 = w0 + transform_block_pixels < width ? w0 + transform_block_pixels : width;
+        switch (channels) {
+            case 1: gather_fixed<T, 1>(src, dst, w0, w1); break;
+            case 2: gather_fixed<T, 2>(src, dst, w0, w1); break;
+            case 3: gather_fixed<T, 3>(src, dst, w0, w1); break;
+            case 4: gather_fixed<T, 4>(src, dst, w0, w1); break;
+            default:
+                for (size_t c0 = 0; c0 < channels; c0 += transform_block_channels) {
+                    const size_t c1 = c0 + transform_block_channels < channels ? c0 + transform_block_channels : channels;
+                    for (size_t c = c0; c < c1; c++) {
+                        T* plane = dst[c];
+                        for (size_t w = w0; w < w1; w++)
+                            plane[w] = src[w * channels + c];
+                    }
+                }
+                break;
+        }
+    }
+}
+
+template<typename T>
+static void scatter_row(const T* const* src, T* dst, size_t channels, size_t width)
+{
+    for (size_t w0 = 0; w0 < width; w0 += transform_block_pixels) {
+        const size_t w1 = w0 + transform_block_pixels < width ? w0 + transform_block_pixels : width;
+        switch (channels) {
+            case 1: scatter_fixed<T, 1>(src, dst, w0, w1); break;
+            case 2: scatter_fixed<T, 2>(src, dst, w0, w1); break;
+            case 3: scatter_fixed<T, 3>(src, dst, w0, w1); break;
+            case 4: scatter_fixed<T, 4>(src, dst, w0, w1); break;
+            default:
+                for (size_t c0 = 0; c0 < channels; c0 += transform_block_channels) {
+                    const size_t c1 = c0 + transform_block_channels < channels ? c0 + transform_block_channels : channels;
+                    for (size_t c = c0; c < c1; c++) {
+                        const T* plane = src[c];
+                        for (size_t w = w0; w < w1; w++)
+                            dst[w * channels + c] = plane[w];
+                    }
+                }
+                break;
+        }
+    }
+}
+
+void hwc_row_to_planes(const void* src_row, void* const* dst_rows, size_t channels, size_t width, size_t element_size)
+{
+    switch (element_size) {
+        case 1: gather_row((const uint8_t*)src_row, (uint8_t* const*)dst_rows, channels, width); break;
+        case 2: gather_row((const uint16_t*)src_row, (uint16_t* const*)dst_rows, channels, width); break;
+        default: gather_row((const uint32_t*)src_row, (uint32_t* const*)dst_rows, channels, width); break;
+    }
+}
+
+void planes_to_hwc_row(const void* const* src_rows, void* dst_row, size_t channels, size_t width, size_t element_size)
+{
+    switch (element_size) {
+        case 1: scatter_row((const uint8_t* const*)src_rows, (uint8_t*)dst_row, channels, width); break;
+        case 2: scatter_row((const uint16_t* const*)src_rows, (uint16_t*)dst_row, channels, width); break;
+        default: scatter_row((const uint32_t* const*)src_rows, (uint32_t*)dst_row, channels, width); break;
+    }
+}
+
+void hwc_to_chw(const void* src, void* dst, size_t channels, size_t height, size_t width, size_t element_size, size_t threads)
+{
+    const size_t row_bytes = width * element_size;
+    parallel_for(height, [&](size_t begin, size_t end) {
+        std::vector<void*> rows(channels);
+        for (size_t h = begin; h < end; h++) {
+            for (size_t c = 0; c < channels; c++)
+                rows[c] = (unsigned char*)dst + (c * height + h) * row_bytes;
+            hwc_row_to_planes((const unsigned char*)src + h * channels * row_bytes, rows.data(), channels, width, element_size);
+        }
+    }, threads);
+}
+
+void chw_to_hwc(const void* src, void* dst, size_t channels, size_t height, size_t width, size_t element_size, size_t threads)
+{
+    const size_t row_bytes = width * element_size;
+    parallel_for(height, [&](size_t begin, size_t end) {
+        std::vector<const void*> rows(channels);
+        for (size_t h = begin; h < end; h++) {
+            for (size_t c = 0; c < channels; c++)
+                rows[c] = (const unsigned char*)src + (c * height + h) * row_bytes;
+            planes_to_hwc_row(rows.data(), (unsigned char*)dst + h * channels * row_bytes, channels, width, element_size);
+        }
+    }, threads);
+}
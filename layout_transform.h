@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+
+/*
+ * Layout transforms between HWC (channels interleaved per pixel, as cameras,
+ * decoders and most host producers emit them) and CHW (one plane per channel,
+ * as Texture_As_Buffer stores them). The row kernels turn one HWC row into the
+ * same row of every plane, so transfers can write straight into mapped rows; the
+ * array versions run them in parallel over rows. Rows are cut into blocks that
+ * stay in L1, and the common channel counts 1 to 4 get fixed-stride loops the
+ * compiler vectorizes. Element sizes 1, 2 and 4 bytes.
+ * Host-only, no D3D dependency (see d3d11_layout_transform.h for the device side).
+ */
+
+// One HWC row of width pixels -> row of each of the channels planes (dst_rows[c])
+void hwc_row_to_planes(const void* src_row, void* const* dst_rows, size_t channels, size_t width, size_t element_size);
+// Rows of the channels planes (src_rows[c]) -> one HWC row
+void planes_to_hwc_row(const void* const* src_rows, void* dst_row, size_t channels, size_t width, size_t element_size);
+
+// Whole arrays, dense in both layouts; threads as in parallel_for
+void hwc_to_chw(const void* src, void* dst, size_t channels, size_t height, size_t width, size_t element_size, size_t threads = 0);
+void chw_to_hwc(const void* src, void* dst, size_t channels, size_t height, size_t width, size_t element_size, size_t threads = 0);
@@ -1,4 +1,6 @@
 #include "d3d11_helper.h"
+#include "d3d11_benchmark.h"
+#include "benchmark.h"
 #include "test.h"
 #include <iostream>
 
@@ -14,17 +16,66 @@ bool run_compute_shader(int deviceIndex = 0)
     run_write_test(d3d_resources.device, d3d_resources.context);
     run_read_test(d3d_resources.device, d3d_resources.context);
     run_shader_compile_test(d3d_resources.device, d3d_resources.context);
+    run_virtual_texture_array_test(d3d_resources.device, d3d_resources.context);
+    run_stream_executor_test(d3d_resources.device, d3d_resources.context);
+    run_transfer_codec_test(d3d_resources.device, d3d_resources.context);
+    run_mapped_file_test(d3d_resources.device, d3d_resources.context);
+    run_snapshot_test(d3d_resources.device, d3d_resources.context);
+    run_pipeline_scheduler_test(d3d_resources.device, d3d_resources.context);
+    run_expr_graph_test(d3d_resources.device, d3d_resources.context);
+    run_reduction_test(d3d_resources.device, d3d_resources.context);
+    run_scan_test(d3d_resources.device, d3d_resources.context);
+    run_constant_ring_test(d3d_resources.device, d3d_resources.context);
+    run_binding_table_test(d3d_resources.device, d3d_resources.context);
+    run_indirect_dispatch_test(d3d_resources.device, d3d_resources.context);
+    run_sparse_texture_test(d3d_resources.device, d3d_resources.context);
+    run_compressed_texture_test(d3d_resources.device, d3d_resources.context);
+    run_interleaved_layout_test(d3d_resources.device, d3d_resources.context);
+    run_layout_transform_test(d3d_resources.device, d3d_resources.context);
+    run_residency_test(d3d_resources.device, d3d_resources.context);
+    run_metrics_test(d3d_resources.device, d3d_resources.context);
+    run_kernel_stats_test(d3d_resources.device, d3d_resources.context);
+    run_command_stream_test(d3d_resources.device, d3d_resources.context);
+    run_benchmark_test(d3d_resources.device, d3d_resources.context);
+    run_atlas_test(d3d_resources.device, d3d_resources.context);
+    run_stencil_test(d3d_resources.device, d3d_resources.context);
+    run_submission_queue_test(d3d_resources.device, d3d_resources.context);
     return true;
 }
 
+// Workload on the CPU backend with --host, otherwise on the selected device
+int run_benchmark(const Benchmark_Options& options)
+{
+    if (options.host) {
+        Host_Benchmark_Backend backend;
+        return run_benchmark_driver(options, backend);
+    }
+
+    D3D11_Device_Resources d3d_resources;
+    d3d_resources.init(options.device_index);
+    if (d3d_resources.device == nullptr || d3d_resources.context == nullptr) {
+        return 1;
+    }
+    D3D11_Benchmark_Backend backend;
+    backend.init(d3d_resources.device, d3d_resources.context);
+    return run_benchmark_driver(options, backend);
+}
+
 int main(int argc, char* argv[])
 {
-    int deviceIndex = 0;
-    if (argc > 1) {
-        deviceIndex = std::atoi(argv[1]);
+    Benchmark_Options options;
+    std::string error;
+    if (!parse_benchmark_options(argc, argv, options, error)) {
+        std::cerr << error << std::endl;
+        std::cerr << "Usage: D3D11_Storage_Test [device_index]" << std::endl;
+        std::cerr << "       D3D11_Storage_Test --workload <file.json> [--output <results.json> | -] [--device <index>] [--host]" << std::endl;
+        return 2;
+    }
+    if (!options.workload.empty()) {
+        return run_benchmark(options);
     }
 
-    if (!run_compute_shader(deviceIndex)) {
+    if (!run_compute_shader(options.device_index)) {
         std::cerr << "Compute shader execution failed!" << std::endl;
         return 1;
     }
@@ -0,0 +1,273 @@
+#include "mapped_file.h"
+#include "host_parallel.h"
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool Mapped_File::open_read(const char* path)
+{
+    release();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cout << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+    file_handle = file;
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    size = (size_t)file_size.QuadPart;
+    if (size == 0)
+        return true;
+    mapping_handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle)
+        data = (unsigned char*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+#else
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Failed to open file: " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    size = (size_t)st.st_size;
+    if (size == 0)
+        return true;
+    void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    data = p == MAP_FAILED ? nullptr : (unsigned char*)p;
+#endif
+    if (data == nullptr) {
+        std::cout << "Failed to map file: " << path << std::endl;
+        release();
+        return false;
+    }
+    return true;
+}
+
+bool Mapped_File::create(const char* path, size_t bytes)
+{
+    release();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cout << "Failed to create file: " << path << std::endl;
+        return false;
+    }
+    file_handle = file;
+    size = bytes;
+    if (size == 0)
+        return true;
+    mapping_handle = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)((unsigned long long)bytes >> 32), (DWORD)(bytes & 0xffffffff), nullptr);
+    if (mapping_handle)
+        data = (unsigned char*)MapViewOfFile(mapping_handle, FILE_MAP_WRITE, 0, 0, 0);
+#else
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cout << "Failed to create file: " << path << std::endl;
+        return false;
+    }
+    size = bytes;
+    if (size == 0)
+        return true;
+    if (ftruncate(fd, (off_t)bytes) != 0) {
+        std::cout << "Failed to resize file: " << path << std::endl;
+        release();
+        return false;
+    }
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    data = p == MAP_FAILED ? nullptr : (unsigned char*)p;
+#endif
+    if (data == nullptr) {
+        std::cout << "Failed to map file: " << path << std::endl;
+        release();
+        return false;
+    }
+    return true;
+}
+
+void Mapped_File::advise_sequential()
+{
+#ifndef _WIN32
+    if (data) {
+        madvise(data, size, MADV_SEQUENTIAL);
+        madvise(data, size, MADV_WILLNEED);
+    }
+#endif
+}
+
+void Mapped_File::prefault(size_t threads)
+{
+    if (data == nullptr)
+        return;
+
+    const size_t page = 4096;
+    const size_t pages = (size + page - 1) / page;
+    const volatile unsigned char* p = data;
+    parallel_for(pages, [p](size_t begin, size_t end) {
+        unsigned char sink = 0;
+        for (size_t i = begin; i < end; i++)
+            sink ^= p[i * page];
+        (void)sink;
+    }, threads);
+}
+
+bool Mapped_File::flush()
+{
+    if (data == nullptr)
+        return true;
+#ifdef _WIN32
+    return FlushViewOfFile(data, 0) != 0;
+#else
+    return msync(data, size, MS_SYNC) == 0;
+#endif
+}
+
+void Mapped_File::release()
+{
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping_handle)
+        CloseHandle(mapping_handle);
+    if (file_handle)
+        CloseHandle(file_handle);
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    if (data)
+        munmap(data, size);
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+size_t Npy_Header::item_size() const
+{
+    return descr.size() >= 3 ? (size_t)atoi(descr.c_str() + 2) : 0;
+}
+
+size_t Npy_Header::data_bytes() const
+{
+    size_t n = item_size();
+    for (size_t d : shape)
+        n *= d;
+    return n;
+}
+
+// Value text following 'key': in a Python dict literal
+static std::string dict_value(const std::string& dict, const char* key)
+{
+    size_t k = dict.find(std::string("'") + key + "'");
+    if (k == std::string::npos)
+        return "";
+    size_t colon = dict.find(':', k);
+    if (colon == std::string::npos)
+        return "";
+    size_t begin = dict.find_first_not_of(' ', colon + 1);
+    if (begin == std::string::npos)
+        return "";
+    size_t end;
+    if (dict[begin] == '\'')
+        end = dict.find('\'', begin + 1) + 1;
+    else if (dict[begin] == '(')
+        end = dict.find(')', begin) + 1;
+    else
+        end = dict.find_first_of(",}", begin);
+    return end == std::string::npos || end == 0 ? "" : dict.substr(begin, end - begin);
+}
+
+bool Npy_Header::parse(const unsigned char* file, size_t file_size)
+{
+    if (file_size < 10 || memcmp(file, "\x93NUMPY", 6) != 0) {
+        std::cout << "Not a .npy file." << std::endl;
+        return false;
+    }
+
+    const unsigned char major = file[6];
+    size_t header_len, prefix;
+    if (major == 1) {
+        header_len = file[8] | (file[9] << 8);
+        prefix = 10;
+    }
+    else if (file_size >= 12) {
+        header_len = file[8] | (file[9] << 8) | (file[10] << 16) | ((size_t)file[11] << 24);
+        prefix = 12;
+    }
+    else
+        return false;
+    if (prefix + header_len > file_size) {
+        std::cout << "Truncated .npy header." << std::endl;
+        return false;
+    }
+
+    std::string dict((const char*)file + prefix, header_len);
+    std::string d = dict_value(dict, "descr");
+    std::string f = dict_value(dict, "fortran_order");
+    std::string s = dict_value(dict, "shape");
+    if (d.size() < 5 || s.empty()) {
+        std::cout << "Malformed .npy header." << std::endl;
+        return false;
+    }
+    descr = d.substr(1, d.size() - 2);
+    fortran_order = f == "True";
+
+    shape.clear();
+    for (size_t i = 1; i < s.size();) {
+        size_t next = s.find_first_of(",)", i);
+        std::string dim = s.substr(i, next - i);
+        if (dim.find_first_not_of(' ') != std::string::npos)
+            shape.push_back((size_t)strtoull(dim.c_str(), nullptr, 10));
+        i = next + 1;
+    }
+    data_offset = prefix + header_len;
+
+    if (descr[0] == '>' || fortran_order || item_size() == 0) {
+        std::cout << "Unsupported .npy layout: " << descr << (fortran_order ? " (Fortran order)" : "") << std::endl;
+        return false;
+    }
+    if (data_offset + data_bytes() > file_size) {
+        std::cout << "Truncated .npy data." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string Npy_Header::format()
+{
+    std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (";
+    for (size_t i = 0; i < shape.size(); i++)
+        dict += std::to_string(shape[i]) + (shape.size() == 1 || i + 1 < shape.size() ? "," : "") + (i + 1 < shape.size() ? " " : "");
+    dict += "), }";
+
+    // Version 1.0 header padded with spaces so the data starts 64-byte aligned
+    size_t total = 10 + dict.size() + 1;
+    total = (total + 63) / 64 * 64;
+    dict.append(total - 10 - dict.size() - 1, ' ');
+    dict += '\n';
+
+    std::string header = "\x93NUMPY";
+    header += (char)1;
+    header += (char)0;
+    header += (char)(dict.size() & 0xff);
+    header += (char)(dict.size() >> 8);
+    header += dict;
+    data_offset = header.size();
+    return header;
+}
+
+bool is_npy_path(const char* path)
+{
+    size_t n = strlen(path);
+    return n >= 4 && strcmp(path + n - 4, ".npy") == 0;
+}
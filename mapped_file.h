@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+ * Read-only or read-write memory mapping of a whole file (mmap on POSIX,
+ * file mapping objects on Windows). Host-only, no D3D dependency.
+ */
+struct Mapped_File
+{
+    unsigned char* data = nullptr;
+    size_t size = 0;
+
+    // Map an existing file read-only
+    bool open_read(const char* path);
+    // Create (or truncate) a file of the given size and map it read-write
+    bool create(const char* path, size_t bytes);
+    // Hint that the mapping will be read once front to back
+    void advise_sequential();
+    // Touch every page on `threads` threads (0 = hardware concurrency) so the copy that follows does not fault
+    void prefault(size_t threads = 0);
+    // Write dirty pages back to the file
+    bool flush();
+    void release();
+    ~Mapped_File()
+    {
+        release();
+    }
+private:
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+/*
+ * Header of a NumPy .npy file (format version 1.0 / 2.0). Only little-endian or
+ * byte-sized C-order data is accepted.
+ */
+struct Npy_Header
+{
+    std::string descr;              // e.g. "<f4", "<f2", "|u1"
+    bool fortran_order = false;
+    std::vector<size_t> shape;
+    size_t data_offset = 0;         // Byte offset of the array data in the file
+
+    size_t item_size() const;
+    size_t data_bytes() const;
+    // Parse the header at the start of a file, returns false if it is not a usable .npy
+    bool parse(const unsigned char* file, size_t file_size);
+    // Serialized header (magic, version, dict, padding) for descr and shape; sets data_offset
+    std::string format();
+};
+
+// True if the path ends in ".npy"
+bool is_npy_path(const char* path);
@@ -0,0 +1,278 @@
+#include "metrics.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+static std::atomic<uint64_t> next_registry_serial(1);
+
+// Last registry and shard this thread recorded into; a thread mostly records into metrics()
+struct Shard_Cache
+{
+    uint64_t serial = 0;
+    void* shard = nullptr;
+};
+static thread_local Shard_Cache shard_cache;
+
+static double bits_to_double(uint64_t bits)
+{
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+static uint64_t double_to_bits(double d)
+{
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+static const char* kind_name(Metric_Kind kind)
+{
+    return kind == METRIC_COUNTER ? "counter" : kind == METRIC_GAUGE ? "gauge" : "histogram";
+}
+
+double Metric_Snapshot::upper_bound(size_t i) const
+{
+    return i + 1 >= buckets.size() ? std::numeric_limits<double>::infinity() : std::ldexp(first_bound, (int)i);
+}
+
+Metrics_Registry::Metrics_Registry()
+    : m_serial(next_registry_serial.fetch_add(1)), m_enabled(true)
+{
+}
+
+size_t Metrics_Registry::add_metric(const char* name, const char* help, Metric_Kind kind, double first_bound)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const Metric& m : m_metrics)
+        if (m.name == name) {
+            if (m.kind == kind)
+                return m.id;
+            std::cout << "Failed to register metric " << name << ", it is already a " << kind_name(m.kind) << "." << std::endl;
+            return invalid_id;
+        }
+
+    Metric m;
+    m.name = name;
+    m.help = help;
+    m.kind = kind;
+    m.first_bound = first_bound;
+    if (kind == METRIC_HISTOGRAM) {
+        if (m_histograms == metrics_max_histograms || !(first_bound > 0.0)) {
+            std::cout << "Failed to register histogram " << name << ", registry full or first bound not positive." << std::endl;
+            return invalid_id;
+        }
+        m.id = m_histograms++;
+        m_first_bound[m.id] = first_bound;
+    }
+    else {
+        if (m_series == metrics_max_series) {
+            std::cout << "Failed to register metric " << name << ", registry full." << std::endl;
+            return invalid_id;
+        }
+        m.id = m_series++;
+    }
+    m_metrics.push_back(m);
+    return m.id;
+}
+
+size_t Metrics_Registry::counter(const char* name, const char* help)
+{
+    return add_metric(name, help, METRIC_COUNTER, 0.0);
+}
+
+size_t Metrics_Registry::gauge(const char* name, const char* help)
+{
+    return add_metric(name, help, METRIC_GAUGE, 0.0);
+}
+
+size_t Metrics_Registry::histogram(const char* name, const char* help, double first_bound)
+{
+    return add_metric(name, help, METRIC_HISTOGRAM, first_bound);
+}
+
+Metrics_Registry::Shard* Metrics_Registry::find_shard()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::thread::id self = std::this_thread::get_id();
+    for (const std::unique_ptr<Shard>& s : m_shards)
+        if (s->owner == self)
+            return s.get();
+
+    // Shards outlive their threads so totals never drop; a new thread with a reused id continues one
+    std::unique_ptr<Shard> s(new Shard);
+    s->owner = self;
+    for (size_t i = 0; i < metrics_max_series; i++)
+        s->values[i].store(0, std::memory_order_relaxed);
+    for (size_t h = 0; h < metrics_max_histograms; h++) {
+        for (size_t b = 0; b <= metrics_histogram_buckets; b++)
+            s->buckets[h][b].store(0, std::memory_order_relaxed);
+        s->sums[h].store(double_to_bits(0.0), std::memory_order_relaxed);
+    }
+    m_shards.push_back(std::move(s));
+    return m_shards.back().get();
+}
+
+Metrics_Registry::Shard* Metrics_Registry::shard()
+{
+    if (shard_cache.serial != m_serial) {
+        shard_cache.shard = find_shard();
+        shard_cache.serial = m_serial;
+    }
+    return (Shard*)shard_cache.shard;
+}
+
+void Metrics_Registry::observe(size_t id, double value)
+{
+    if (id >= metrics_max_histograms || !m_enabled.load(std::memory_order_relaxed))
+        return;
+
+    // Smallest i with value <= first_bound * 2^i; NaN and anything past the last bound go to +Inf
+    size_t bucket = metrics_histogram_buckets;
+    const double ratio = value / m_first_bound[id];
+    if (ratio <= 1.0)
+        bucket = 0;
+    else if (ratio <= std::ldexp(1.0, (int)metrics_histogram_buckets - 1)) {
+        int e;
+        const double m = std::frexp(ratio, &e);
+        bucket = m == 0.5 ? e - 1 : e;
+    }
+
+    Shard* s = shard();
+    std::atomic<uint64_t>& b = s->buckets[id][bucket];
+    b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic<uint64_t>& sum = s->sums[id];
+    sum.store(double_to_bits(bits_to_double(sum.load(std::memory_order_relaxed)) + value), std::memory_order_relaxed);
+}
+
+std::vector<Metric_Snapshot> Metrics_Registry::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Metric_Snapshot> out(m_metrics.size());
+    for (size_t i = 0; i < m_metrics.size(); i++) {
+        const Metric& m = m_metrics[i];
+        Metric_Snapshot& o = out[i];
+        o.name = m.name;
+        o.help = m.help;
+        o.kind = m.kind;
+        o.first_bound = m.first_bound;
+        if (m.kind != METRIC_HISTOGRAM) {
+            for (const std::unique_ptr<Shard>& s : m_shards)
+                o.value += s->values[m.id].load(std::memory_order_relaxed);
+            continue;
+        }
+        o.buckets.assign(metrics_histogram_buckets + 1, 0);
+        for (const std::unique_ptr<Shard>& s : m_shards) {
+            for (size_t b = 0; b <= metrics_histogram_buckets; b++)
+                o.buckets[b] += s->buckets[m.id][b].load(std::memory_order_relaxed);
+            o.sum += bits_to_double(s->sums[m.id].load(std::memory_order_relaxed));
+        }
+        for (uint64_t c : o.buckets)
+            o.count += c;
+    }
+    return out;
+}
+
+bool Metrics_Registry::find(const char* name, Metric_Snapshot& out) const
+{
+    for (const Metric_Snapshot& m : snapshot())
+        if (m.name == name) {
+            out = m;
+            return true;
+        }
+    return false;
+}
+
+// 17 significant digits round-trip any double
+static std::string number(double v)
+{
+    std::ostringstream s;
+    s.precision(17);
+    s << v;
+    return s.str();
+}
+
+std::string Metrics_Registry::to_prometheus() const
+{
+    std::ostringstream out;
+    for (const Metric_Snapshot& m : snapshot()) {
+        out << "# HELP " << m.name << " " << m.help << "\n";
+        out << "# TYPE " << m.name << " " << kind_name(m.kind) << "\n";
+        if (m.kind != METRIC_HISTOGRAM) {
+            out << m.name << " " << m.value << "\n";
+            continue;
+        }
+        // Buckets are cumulative in the exposition format
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < m.buckets.size(); b++) {
+            cumulative += m.buckets[b];
+            const std::string le = b + 1 == m.buckets.size() ? "+Inf" : number(m.upper_bound(b));
+            out << m.name << "_bucket{le=\"" << le << "\"} " << cumulative << "\n";
+        }
+        out << m.name << "_sum " << number(m.sum) << "\n";
+        out << m.name << "_count " << m.count << "\n";
+    }
+    return out.str();
+}
+
+std::string Metrics_Registry::to_json() const
+{
+    std::ostringstream out;
+    const std::vector<Metric_Snapshot> all = snapshot();
+    out << "{\"metrics\":[";
+    for (size_t i = 0; i < all.size(); i++) {
+        const Metric_Snapshot& m = all[i];
+        out << (i ? "," : "") << "\n{\"name\":\"" << m.name << "\",\"type\":\"" << kind_name(m.kind) << "\"";
+        if (m.kind != METRIC_HISTOGRAM) {
+            out << ",\"value\":" << m.value << "}";
+            continue;
+        }
+        out << ",\"count\":" << m.count << ",\"sum\":" << number(m.sum) << ",\"buckets\":[";
+        // Empty buckets are left out; "le" is null for +Inf, which JSON cannot spell
+        bool first = true;
+        for (size_t b = 0; b < m.buckets.size(); b++) {
+            if (m.buckets[b] == 0)
+                continue;
+            out << (first ? "" : ",") << "{\"le\":" << (b + 1 == m.buckets.size() ? "null" : number(m.upper_bound(b)))
+                << ",\"count\":" << m.buckets[b] << "}";
+            first = false;
+        }
+        out << "]}";
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+Metrics_Registry& metrics()
+{
+    static Metrics_Registry registry;
+    return registry;
+}
+
+const Device_Metrics& device_metrics()
+{
+    static const Device_Metrics ids = [] {
+        Metrics_Registry& r = metrics();
+        Device_Metrics m;
+        m.upload_bytes = r.counter("d3d11_upload_bytes_total", "Bytes copied from host to device");
+        m.uploads = r.counter("d3d11_uploads_total", "Host to device copies");
+        m.download_bytes = r.counter("d3d11_download_bytes_total", "Bytes copied from device to host");
+        m.downloads = r.counter("d3d11_downloads_total", "Device to host copies");
+        m.map_stall_us = r.histogram("d3d11_map_stall_microseconds", "Time spent in Map on staging resources", 1.0);
+        m.dispatches = r.counter("d3d11_dispatches_total", "Direct compute dispatches");
+        m.dispatch_groups = r.counter("d3d11_dispatch_groups_total", "Thread groups launched by direct dispatches");
+        m.shader_compiles = r.counter("d3d11_shader_compiles_total", "Compute shaders compiled");
+        m.shader_compile_failures = r.counter("d3d11_shader_compile_failures_total", "Compute shaders that failed to compile");
+        m.shader_compile_ms = r.histogram("d3d11_shader_compile_milliseconds", "Compute shader compile and create time", 0.25);
+        m.constant_uploads = r.counter("d3d11_constant_uploads_total", "Constant buffer updates");
+        m.constant_upload_bytes = r.counter("d3d11_constant_upload_bytes_total", "Bytes written to constant buffers");
+        m.allocated_bytes = r.gauge("d3d11_allocated_bytes", "Device and staging bytes held by textures and buffers");
+        m.allocations = r.counter("d3d11_allocations_total", "Textures and buffers created");
+        m.gpu_time_ms = r.histogram("d3d11_gpu_time_milliseconds", "GPU intervals measured with timestamp queries", 0.01);
+        return m;
+    }();
+    return ids;
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Process-wide metrics: counters, gauges and histograms, exported on demand as
+ * Prometheus text or a JSON snapshot. Metrics are registered once by name and
+ * then recorded by id. Every thread records into its own shard of relaxed
+ * atomics that only it writes, so recording is a plain load and store with no
+ * lock and no shared cache line; snapshots sum the shards. Histogram buckets
+ * are powers of two above a first bound chosen per metric.
+ * Host-only, no D3D dependency; the device classes record into metrics() through
+ * the ids in device_metrics().
+ */
+enum Metric_Kind
+{
+    METRIC_COUNTER,     // Monotonic total
+    METRIC_GAUGE,       // Value that goes up and down, e.g. bytes allocated
+    METRIC_HISTOGRAM
+};
+
+static const size_t metrics_max_series = 128;       // Counters and gauges
+static const size_t metrics_max_histograms = 32;
+static const size_t metrics_histogram_buckets = 24; // Finite buckets, first_bound * 2^i, plus +Inf
+
+struct Metric_Snapshot
+{
+    std::string name;
+    std::string help;
+    Metric_Kind kind = METRIC_COUNTER;
+    int64_t value = 0;                  // Counters and gauges
+    double first_bound = 0.0;           // Histograms: upper bound of bucket 0
+    std::vector<uint64_t> buckets;      // Histograms: per-bucket counts, the last one +Inf
+    uint64_t count = 0;
+    double sum = 0.0;
+
+    // Upper bound of bucket i, infinity for the last
+    double upper_bound(size_t i) const;
+};
+
+class Metrics_Registry
+{
+public:
+    static const size_t invalid_id = (size_t)-1;
+
+    Metrics_Registry();
+    // Register a metric, or return the id it already has. invalid_id if the registry is full
+    // or the name is taken by another kind; recording to invalid_id does nothing.
+    size_t counter(const char* name, const char* help);
+    size_t gauge(const char* name, const char* help);
+    size_t histogram(const char* name, const char* help, double first_bound);
+
+    // Record from any thread
+    void add(size_t id, int64_t value = 1)
+    {
+        if (id >= metrics_max_series || !m_enabled.load(std::memory_order_relaxed))
+            return;
+        std::atomic<int64_t>& v = shard()->values[id];
+        v.store(v.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    void observe(size_t id, double value);
+    // Recording off costs one relaxed load per call
+    void set_enabled(bool enabled)
+    {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    // Current totals over all threads, in registration order
+    std::vector<Metric_Snapshot> snapshot() const;
+    // Prometheus text exposition format, version 0.0.4
+    std::string to_prometheus() const;
+    std::string to_json() const;
+    // Totals of one metric by name, false if it is not registered
+    bool find(const char* name, Metric_Snapshot& out) const;
+
+private:
+    struct Shard
+    {
+        std::thread::id owner;
+        std::atomic<int64_t> values[metrics_max_series];
+        std::atomic<uint64_t> buckets[metrics_max_histograms][metrics_histogram_buckets + 1];
+        std::atomic<uint64_t> sums[metrics_max_histograms];     // double bits
+    };
+    struct Metric
+    {
+        std::string name;
+        std::string help;
+        Metric_Kind kind = METRIC_COUNTER;
+        size_t id = 0;                  // Index into values, or into buckets for histograms
+        double first_bound = 0.0;
+    };
+
+    // The calling thread's shard, created on its first record
+    Shard* shard();
+    Shard* find_shard();
+    size_t add_metric(const char* name, const char* help, Metric_Kind kind, double first_bound);
+
+    const uint64_t m_serial;            // Identifies this registry in the per-thread shard cache
+    std::atomic<bool> m_enabled;
+    mutable std::mutex m_mutex;         // Guards registration and the shard list, never recording
+    std::vector<Metric> m_metrics;
+    size_t m_series = 0;
+    size_t m_histograms = 0;
+    double m_first_bound[metrics_max_histograms] = {};
+    std::vector<std::unique_ptr<Shard>> m_shards;
+};
+
+// The registry the library records into
+Metrics_Registry& metrics();
+
+// Ids of the metrics the device classes record
+struct Device_Metrics
+{
+    size_t upload_bytes;        // Host -> device through staging or UpdateSubresource
+    size_t uploads;
+    size_t download_bytes;      // Device -> host through staging
+    size_t downloads;
+    size_t map_stall_us;        // Time inside Map on staging copies, the wait for the GPU included
+    size_t dispatches;
+    size_t dispatch_groups;     // Thread groups over all direct dispatches
+    size_t shader_compiles;
+    size_t shader_compile_failures;
+    size_t shader_compile_ms;
+    size_t constant_uploads;
+    size_t constant_upload_bytes;
+    size_t allocated_bytes;     // Device and staging memory held by textures and buffers
+    size_t allocations;
+    size_t gpu_time_ms;         // Intervals measured by D3D11_Performance_Counter
+};
+
+const Device_Metrics& device_metrics();
+
+// Count one direct dispatch of x * y * z groups
+inline void count_dispatch(uint64_t x, uint64_t y, uint64_t z)
+{
+    const Device_Metrics& m = device_metrics();
+    metrics().add(m.dispatches);
+    metrics().add(m.dispatch_groups, (int64_t)(x * y * z));
+}
+
+// Wall time since construction, for timing host-side waits
+struct Metrics_Stopwatch
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    double elapsed_us() const
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+};
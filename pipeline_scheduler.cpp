@@ -0,0 +1,235 @@
+#include "pipeline_scheduler.h"
+#include <iostream>
+#include <cstring>
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+bool Pipeline_Scheduler::start(Pipeline_Backend* backend, size_t slot_count, size_t queue_depth, Completion on_complete)
+{
+    finish();
+    if (backend == nullptr || slot_count == 0) {
+        std::cout << "Failed to start pipeline. Backend and slot count must be non-zero." << std::endl;
+        return false;
+    }
+    if (!backend->init_slots(slot_count)) {
+        std::cout << "Failed to start pipeline, backend failed to allocate slots." << std::endl;
+        return false;
+    }
+
+    p_backend = backend;
+    completion = on_complete;
+    stats = Pipeline_Stats();
+    failed = 0;
+    submit_queue.init(queue_depth);
+    dispatch_queue.init(queue_depth);
+    readback_queue.init(queue_depth);
+    free_slots.init(slot_count);
+    for (size_t i = 0; i < slot_count; i++)
+        free_slots.push(i);
+
+    start_time = std::chrono::high_resolution_clock::now();
+    running = true;
+    upload_thread = std::thread(&Pipeline_Scheduler::upload_loop, this);
+    dispatch_thread = std::thread(&Pipeline_Scheduler::dispatch_loop, this);
+    readback_thread = std::thread(&Pipeline_Scheduler::readback_loop, this);
+    return true;
+}
+
+bool Pipeline_Scheduler::submit(const Pipeline_Item& item)
+{
+    if (!running)
+        return false;
+    double wait_ms = 0.0;
+    bool ok = submit_queue.push(item, &wait_ms);
+    std::lock_guard<std::mutex> lock(submit_mutex);
+    stats.submit_blocked_ms += wait_ms;
+    return ok;
+}
+
+bool Pipeline_Scheduler::try_submit(const Pipeline_Item& item)
+{
+    return running && submit_queue.try_push(item);
+}
+
+Pipeline_Stats Pipeline_Scheduler::finish()
+{
+    if (!running)
+        return stats;
+
+    // Close front to back so every stage drains what is already queued
+    submit_queue.close();
+    upload_thread.join();
+    dispatch_queue.close();
+    dispatch_thread.join();
+    readback_queue.close();
+    readback_thread.join();
+    free_slots.close();
+
+    stats.wall_ms = elapsed_ms(start_time);
+    stats.upload.queue_high_water = submit_queue.depth_high_water();
+    stats.dispatch.queue_high_water = dispatch_queue.depth_high_water();
+    stats.readback.queue_high_water = readback_queue.depth_high_water();
+    p_backend->release();
+    p_backend = nullptr;
+    running = false;
+    return stats;
+}
+
+void Pipeline_Scheduler::upload_loop()
+{
+    Pipeline_Item item;
+    while (submit_queue.pop(item, &stats.upload.starved_ms)) {
+        Job job;
+        job.item = item;
+        // No free slot means dispatch/readback are behind, wait for one to retire
+        free_slots.pop(job.slot, &stats.upload.blocked_ms);
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        job.ok = p_backend->upload(job.slot, item);
+        stats.upload.busy_ms += elapsed_ms(t0);
+        stats.upload.items++;
+        stats.bytes_uploaded += item.in_bytes;
+
+        dispatch_queue.push(job, &stats.upload.blocked_ms);
+    }
+}
+
+void Pipeline_Scheduler::dispatch_loop()
+{
+    Job job;
+    while (dispatch_queue.pop(job, &stats.dispatch.starved_ms)) {
+        // A failed item still flows through so its slot gets recycled
+        if (job.ok) {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            job.ok = p_backend->dispatch(job.slot, job.item);
+            stats.dispatch.busy_ms += elapsed_ms(t0);
+        }
+        stats.dispatch.items++;
+        readback_queue.push(job, &stats.dispatch.blocked_ms);
+    }
+}
+
+void Pipeline_Scheduler::readback_loop()
+{
+    Job job;
+    while (readback_queue.pop(job, &stats.readback.starved_ms)) {
+        if (job.ok) {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            job.ok = p_backend->readback(job.slot, job.item);
+            stats.readback.busy_ms += elapsed_ms(t0);
+            stats.bytes_readback += job.item.out_bytes;
+        }
+        stats.readback.items++;
+        stats.items++;
+        free_slots.push(job.slot);
+
+        if (!job.ok)
+            failed++;
+        if (completion)
+            completion(job.item, job.ok);
+    }
+}
+
+void Latency_Pipeline_Backend::init(size_t __slot_bytes, double __upload_ms, double __dispatch_ms, double __readback_ms, Kernel __kernel)
+{
+    slot_bytes = __slot_bytes;
+    upload_ms = __upload_ms;
+    dispatch_ms = __dispatch_ms;
+    readback_ms = __readback_ms;
+    kernel = __kernel;
+}
+
+bool Latency_Pipeline_Backend::init_slots(size_t slot_count)
+{
+    release();
+    if (slot_bytes == 0) {
+        std::cout << "Cannot allocate pipeline slots, init() backend first." << std::endl;
+        return false;
+    }
+
+    n_slots = slot_count;
+    in_slots = new unsigned char*[slot_count];
+    out_slots = new unsigned char*[slot_count];
+    slot_state = new std::atomic<int>[slot_count];
+    for (size_t i = 0; i < slot_count; i++) {
+        in_slots[i] = new unsigned char[slot_bytes];
+        out_slots[i] = new unsigned char[slot_bytes];
+        slot_state[i] = 0;
+    }
+    active = 0;
+    max_active = 0;
+    violations = 0;
+    return true;
+}
+
+// Slot states: 0 free, 1 uploaded, 2 dispatched
+void Latency_Pipeline_Backend::enter(size_t slot, int expected_state)
+{
+    if (slot_state[slot].load() != expected_state)
+        violations++;
+    size_t now = ++active;
+    size_t prev = max_active.load();
+    while (now > prev && !max_active.compare_exchange_weak(prev, now)) {}
+}
+
+void Latency_Pipeline_Backend::leave(size_t slot, int next_state)
+{
+    slot_state[slot] = next_state;
+    active--;
+}
+
+bool Latency_Pipeline_Backend::upload(size_t slot, const Pipeline_Item& item)
+{
+    if (slot >= n_slots || item.in_bytes > slot_bytes)
+        return false;
+    enter(slot, 0);
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(upload_ms));
+    memcpy(in_slots[slot], item.in, item.in_bytes);
+    leave(slot, 1);
+    return true;
+}
+
+bool Latency_Pipeline_Backend::dispatch(size_t slot, const Pipeline_Item& item)
+{
+    enter(slot, 1);
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(dispatch_ms));
+    if (kernel)
+        kernel(item, in_slots[slot], out_slots[slot]);
+    else
+        memcpy(out_slots[slot], in_slots[slot], item.in_bytes < item.out_bytes ? item.in_bytes : item.out_bytes);
+    leave(slot, 2);
+    return true;
+}
+
+bool Latency_Pipeline_Backend::readback(size_t slot, const Pipeline_Item& item)
+{
+    if (item.out_bytes > slot_bytes)
+        return false;
+    enter(slot, 2);
+    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(readback_ms));
+    memcpy(item.out, out_slots[slot], item.out_bytes);
+    leave(slot, 0);
+    return true;
+}
+
+void Latency_Pipeline_Backend::release()
+{
+    for (size_t i = 0; i < n_slots; i++) {
+        delete[] in_slots[i];
+        delete[] out_slots[i];
+    }
+    if (in_slots)
+        delete[] in_slots;
+    if (out_slots)
+        delete[] out_slots;
+    if (slot_state)
+        delete[] slot_state;
+
+    in_slots = nullptr;
+    out_slots = nullptr;
+    slot_state = nullptr;
+    n_slots = 0;
+}
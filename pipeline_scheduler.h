@@ -0,0 +1,272 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+/*
+ * Overlapped upload -> dispatch -> readback pipeline over a stream of independent
+ * work items. Each stage runs on its own thread and hands items to the next one
+ * through a bounded queue; a fixed pool of backend slots (one set of device
+ * resources each) limits how many items are resident at once. A full queue or an
+ * empty slot pool blocks the producer, so submit() applies backpressure instead of
+ * growing memory. Host-only, no D3D dependency (see d3d11_pipeline_backend.h).
+ */
+
+// One unit of work: the backend reads in_bytes from in and writes out_bytes to out
+struct Pipeline_Item
+{
+    size_t id = 0;
+    const void* in = nullptr;
+    size_t in_bytes = 0;
+    void* out = nullptr;
+    size_t out_bytes = 0;
+};
+
+/*
+ * Fixed-capacity FIFO shared between two threads. push() blocks while full and
+ * pop() blocks while empty; close() wakes both and makes pop() fail once drained.
+ * Time spent blocked is added to *wait_ms when given.
+ */
+template<typename T>
+class Bounded_Queue
+{
+public:
+    void init(size_t __capacity)
+    {
+        capacity = __capacity > 0 ? __capacity : 1;
+        items.clear();
+        closed = false;
+        max_depth = 0;
+    }
+
+    bool push(const T& item, double* wait_ms = nullptr)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (items.size() >= capacity && !closed) {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            not_full.wait(lock, [this]() { return items.size() < capacity || closed; });
+            if (wait_ms)
+                *wait_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+        }
+        if (closed)
+            return false;
+        items.push_back(item);
+        max_depth = items.size() > max_depth ? items.size() : max_depth;
+        not_empty.notify_one();
+        return true;
+    }
+
+    // Non-blocking push, false if full or closed
+    bool try_push(const T& item)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.size() >= capacity || closed)
+            return false;
+        items.push_back(item);
+        max_depth = items.size() > max_depth ? items.size() : max_depth;
+        not_empty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item, double* wait_ms = nullptr)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (items.empty() && !closed) {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            not_empty.wait(lock, [this]() { return !items.empty() || closed; });
+            if (wait_ms)
+                *wait_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+        }
+        if (items.empty())
+            return false;
+        item = items.front();
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+
+    size_t depth_high_water() const
+    {
+        return max_depth;
+    }
+private:
+    std::deque<T> items;
+    size_t capacity = 1;
+    size_t max_depth = 0;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+};
+
+struct Pipeline_Stage_Stats
+{
+    size_t items = 0;
+    double busy_ms = 0.0;       // Inside the backend call
+    double starved_ms = 0.0;    // Waiting for an item from the previous stage
+    double blocked_ms = 0.0;    // Waiting for room downstream (or a free slot for upload)
+    size_t queue_high_water = 0;    // Deepest the stage's input queue got
+
+    // Fraction of the wall time the stage was doing work
+    double utilization(double wall_ms) const
+    {
+        return wall_ms > 0.0 ? busy_ms / wall_ms : 0.0;
+    }
+};
+
+struct Pipeline_Stats
+{
+    Pipeline_Stage_Stats upload;
+    Pipeline_Stage_Stats dispatch;
+    Pipeline_Stage_Stats readback;
+    size_t items = 0;
+    size_t bytes_uploaded = 0;
+    size_t bytes_readback = 0;
+    double submit_blocked_ms = 0.0;     // Backpressure seen by the producer
+    double wall_ms = 0.0;
+
+    // Wall time of a perfectly overlapped pipeline, i.e. the slowest stage
+    double bound_ms() const
+    {
+        double b = upload.busy_ms > dispatch.busy_ms ? upload.busy_ms : dispatch.busy_ms;
+        return b > readback.busy_ms ? b : readback.busy_ms;
+    }
+    // Wall time if the three stages ran back to back
+    double serial_ms() const
+    {
+        return upload.busy_ms + dispatch.busy_ms + readback.busy_ms;
+    }
+};
+
+/*
+ * Device side of the pipeline. Stage calls for different slots arrive from
+ * different threads at the same time; a slot is only reused after its readback
+ * returned, so a backend only has to serialize access to shared state (e.g. a
+ * device context), never to a slot.
+ */
+struct Pipeline_Backend
+{
+    virtual ~Pipeline_Backend() {}
+    // Allocate slot_count slots able to hold one item each
+    virtual bool init_slots(size_t slot_count) = 0;
+    virtual bool upload(size_t slot, const Pipeline_Item& item) = 0;
+    virtual bool dispatch(size_t slot, const Pipeline_Item& item) = 0;
+    virtual bool readback(size_t slot, const Pipeline_Item& item) = 0;
+    virtual void release() = 0;
+};
+
+class Pipeline_Scheduler
+{
+public:
+    typedef std::function<void(const Pipeline_Item& item, bool ok)> Completion;
+
+    // Start the stage threads. queue_depth bounds each inter-stage queue and the submit queue.
+    bool start(Pipeline_Backend* backend, size_t slot_count = 3, size_t queue_depth = 2, Completion on_complete = nullptr);
+    // Queue an item, blocks while the pipeline is full
+    bool submit(const Pipeline_Item& item);
+    // Queue an item without blocking, false if the pipeline is full
+    bool try_submit(const Pipeline_Item& item);
+    // Drain all submitted items, stop the threads and release the backend slots
+    Pipeline_Stats finish();
+    // Items whose backend calls reported failure since start()
+    size_t failures() const
+    {
+        return failed.load();
+    }
+
+    ~Pipeline_Scheduler()
+    {
+        finish();
+    }
+private:
+    struct Job
+    {
+        Pipeline_Item item;
+        size_t slot = 0;
+        bool ok = true;
+    };
+
+    void upload_loop();
+    void dispatch_loop();
+    void readback_loop();
+
+    Pipeline_Backend* p_backend = nullptr;
+    Completion completion;
+    Bounded_Queue<Pipeline_Item> submit_queue;
+    Bounded_Queue<Job> dispatch_queue;
+    Bounded_Queue<Job> readback_queue;
+    Bounded_Queue<size_t> free_slots;
+    std::thread upload_thread;
+    std::thread dispatch_thread;
+    std::thread readback_thread;
+    std::chrono::high_resolution_clock::time_point start_time;
+    std::atomic<size_t> failed{ 0 };
+    std::mutex submit_mutex;
+    Pipeline_Stats stats;
+    std::atomic<bool> running{ false };     // Read by producers in submit() while finish() clears it
+};
+
+/*
+ * Backend that stands in for a device with fixed per-stage latencies. Each stage
+ * sleeps for its latency (like waiting on a copy or compute engine) and moves the
+ * bytes with memcpy; an optional kernel transforms the slot in place during
+ * dispatch. It also records the most stages ever active at once and any slot
+ * used out of upload -> dispatch -> readback order, so tests can verify overlap
+ * and slot ownership.
+ */
+struct Latency_Pipeline_Backend : Pipeline_Backend
+{
+    typedef std::function<void(const Pipeline_Item& item, const void* in, void* out)> Kernel;
+
+    double upload_ms = 1.0;
+    double dispatch_ms = 1.0;
+    double readback_ms = 1.0;
+    size_t slot_bytes = 0;
+    Kernel kernel;
+
+    void init(size_t __slot_bytes, double __upload_ms, double __dispatch_ms, double __readback_ms, Kernel __kernel = nullptr);
+
+    bool init_slots(size_t slot_count) override;
+    bool upload(size_t slot, const Pipeline_Item& item) override;
+    bool dispatch(size_t slot, const Pipeline_Item& item) override;
+    bool readback(size_t slot, const Pipeline_Item& item) override;
+    void release() override;
+
+    size_t max_concurrent_stages() const
+    {
+        return max_active.load();
+    }
+    size_t order_violations() const
+    {
+        return violations.load();
+    }
+
+    ~Latency_Pipeline_Backend()
+    {
+        release();
+    }
+private:
+    void enter(size_t slot, int expected_state);
+    void leave(size_t slot, int next_state);
+
+    unsigned char** in_slots = nullptr;
+    unsigned char** out_slots = nullptr;
+    std::atomic<int>* slot_state = nullptr;
+    size_t n_slots = 0;
+    std::atomic<size_t> active{ 0 };
+    std::atomic<size_t> max_active{ 0 };
+    std::atomic<size_t> violations{ 0 };
+};
@@ -0,0 +1,135 @@
+#include "reduction.h"
+#include "host_parallel.h"
+#include <iostream>
+#include <limits>
+#include <vector>
+
+struct Sum_Op
+{
+    static float identity() { return 0.0f; }
+    static float apply(float a, float b) { return a + b; }
+};
+
+struct Min_Op
+{
+    static float identity() { return std::numeric_limits<float>::infinity(); }
+    static float apply(float a, float b) { return b < a ? b : a; }
+};
+
+struct Max_Op
+{
+    static float identity() { return -std::numeric_limits<float>::infinity(); }
+    static float apply(float a, float b) { return b > a ? b : a; }
+};
+
+// True if the reduced values of one output are evenly spaced in memory (every axis subset but C + W)
+static bool uniform_stride(const Reduce_Shape& shape, size_t& stride)
+{
+    size_t dims[3] = { shape.width / shape.out_width(), shape.height / shape.out_height(), shape.channels / shape.out_channels() };
+    size_t strides[3] = { 1, shape.width, shape.height * shape.width };
+    size_t next = 0;
+    stride = 0;
+    for (size_t i = 0; i < 3; i++) {
+        if (dims[i] == 1)
+            continue;
+        if (stride == 0)
+            stride = strides[i];
+        else if (strides[i] != next)
+            return false;
+        next = strides[i] * dims[i];
+    }
+    if (stride == 0)
+        stride = 1;
+    return true;
+}
+
+// Up to reduce_leaf_elements values with 8 independent accumulators (vectorizable), combined pairwise
+template<typename Op>
+static float reduce_leaf(const float* p, size_t stride, size_t n)
+{
+    float acc[8];
+    for (size_t k = 0; k < 8; k++)
+        acc[k] = Op::identity();
+    size_t i = 0;
+    if (stride == 1) {
+        for (; i + 8 <= n; i += 8)
+            for (size_t k = 0; k < 8; k++)
+                acc[k] = Op::apply(acc[k], p[i + k]);
+    }
+    else {
+        for (; i + 8 <= n; i += 8)
+            for (size_t k = 0; k < 8; k++)
+                acc[k] = Op::apply(acc[k], p[(i + k) * stride]);
+    }
+    for (; i < n; i++)
+        acc[i % 8] = Op::apply(acc[i % 8], p[i * stride]);
+    return Op::apply(Op::apply(Op::apply(acc[0], acc[1]), Op::apply(acc[2], acc[3])),
+        Op::apply(Op::apply(acc[4], acc[5]), Op::apply(acc[6], acc[7])));
+}
+
+// Pairwise over values [j0, j0 + n) of output o, split on leaf boundaries
+template<typename Op>
+static float reduce_range(const float* in, const Reduce_Shape& shape, bool uniform, size_t stride, size_t o, size_t j0, size_t n)
+{
+    if (n <= reduce_leaf_elements) {
+        if (uniform)
+            return reduce_leaf<Op>(in + shape.offset(o, j0), stride, n);
+        float gathered[reduce_leaf_elements];
+        for (size_t j = 0; j < n; j++)
+            gathered[j] = in[shape.offset(o, j0 + j)];
+        return reduce_leaf<Op>(gathered, 1, n);
+    }
+    size_t leaves = (n + reduce_leaf_elements - 1) / reduce_leaf_elements;
+    size_t half = (leaves + 1) / 2 * reduce_leaf_elements;
+    return Op::apply(reduce_range<Op>(in, shape, uniform, stride, o, j0, half),
+        reduce_range<Op>(in, shape, uniform, stride, o, j0 + half, n - half));
+}
+
+template<typename Op>
+static float combine_pairwise(const float* v, size_t n)
+{
+    if (n == 1)
+        return v[0];
+    size_t half = (n + 1) / 2;
+    return Op::apply(combine_pairwise<Op>(v, half), combine_pairwise<Op>(v + half, n - half));
+}
+
+template<typename Op>
+static void reduce_all(const float* in, const Reduce_Shape& shape, float* out, float scale, size_t threads)
+{
+    size_t stride;
+    const bool uniform = uniform_stride(shape, stride);
+    const size_t n = shape.reduced_count();
+    const size_t out_count = shape.out_count();
+    const size_t chunks = (n + reduce_chunk_elements - 1) / reduce_chunk_elements;
+
+    // One task per (output, chunk); thread count only decides who computes which partial
+    std::vector<float> partials(out_count * chunks);
+    parallel_for(out_count * chunks, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            size_t o = t / chunks;
+            size_t j0 = (t % chunks) * reduce_chunk_elements;
+            size_t len = j0 + reduce_chunk_elements <= n ? reduce_chunk_elements : n - j0;
+            partials[t] = reduce_range<Op>(in, shape, uniform, stride, o, j0, len);
+        }
+    }, threads);
+
+    for (size_t o = 0; o < out_count; o++)
+        out[o] = combine_pairwise<Op>(partials.data() + o * chunks, chunks) * scale;
+}
+
+bool reduce(const float* in, const Reduce_Shape& shape, Reduce_Op op, float* out, size_t threads)
+{
+    if (shape.channels * shape.height * shape.width == 0 || (shape.axes & ~(unsigned int)REDUCE_AXIS_ALL) != 0) {
+        std::cout << "Failed to reduce. Shape must be non-zero and axes a subset of REDUCE_AXIS_ALL." << std::endl;
+        return false;
+    }
+
+    switch (op) {
+    case REDUCE_SUM: reduce_all<Sum_Op>(in, shape, out, 1.0f, threads); break;
+    case REDUCE_MEAN: reduce_all<Sum_Op>(in, shape, out, 1.0f / (float)shape.reduced_count(), threads); break;
+    case REDUCE_MIN: reduce_all<Min_Op>(in, shape, out, 1.0f, threads); break;
+    case REDUCE_MAX: reduce_all<Max_Op>(in, shape, out, 1.0f, threads); break;
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+
+/*
+ * Reductions (sum/min/max/mean) of a dense (channels, height, width) float array
+ * over any subset of its axes: per channel is REDUCE_AXIS_H | REDUCE_AXIS_W, per row
+ * is REDUCE_AXIS_W, global is REDUCE_AXIS_ALL. Reduced axes become size 1 in the
+ * output, which keeps CHW order.
+ *
+ * The host implementation sums in a fixed pairwise tree: runs of leaf_elements
+ * values are reduced with 8 interleaved accumulators, chunks of chunk_elements
+ * values are combined pairwise, and chunk partials are combined pairwise again.
+ * The tree depends only on the shape, never on the thread count, so results are
+ * bitwise reproducible. Host-only, no D3D dependency (see d3d11_reduction.h).
+ */
+enum Reduce_Op
+{
+    REDUCE_SUM,
+    REDUCE_MIN,
+    REDUCE_MAX,
+    REDUCE_MEAN
+};
+
+enum Reduce_Axis
+{
+    REDUCE_AXIS_C = 1,
+    REDUCE_AXIS_H = 2,
+    REDUCE_AXIS_W = 4,
+    REDUCE_AXIS_ALL = 7
+};
+
+struct Reduce_Shape
+{
+    size_t channels = 0;
+    size_t height = 0;
+    size_t width = 0;
+    unsigned int axes = 0;
+
+    void init(size_t __channels, size_t __height, size_t __width, unsigned int __axes)
+    {
+        channels = __channels;
+        height = __height;
+        width = __width;
+        axes = __axes;
+    }
+
+    // Output extent, 1 along reduced axes
+    size_t out_channels() const { return (axes & REDUCE_AXIS_C) ? 1 : channels; }
+    size_t out_height() const { return (axes & REDUCE_AXIS_H) ? 1 : height; }
+    size_t out_width() const { return (axes & REDUCE_AXIS_W) ? 1 : width; }
+    size_t out_count() const { return out_channels() * out_height() * out_width(); }
+    // Values folded into each output
+    size_t reduced_count() const { return channels * height * width / out_count(); }
+
+    // Offset in the input of value j (CHW order over the reduced axes) of output o
+    size_t offset(size_t o, size_t j) const
+    {
+        size_t rw = width / out_width(), rh = height / out_height();
+        size_t ow = o % out_width(), oh = (o / out_width()) % out_height(), oc = o / (out_width() * out_height());
+        size_t jw = j % rw, jh = (j / rw) % rh, jc = j / (rw * rh);
+        return ((oc + jc) * height + oh + jh) * width + ow + jw;
+    }
+};
+
+static const size_t reduce_leaf_elements = 256;
+static const size_t reduce_chunk_elements = 65536;
+
+// Reduce in (dense CHW) into out (dense CHW of shape.out_*()), threads = 0 uses all cores
+bool reduce(const float* in, const Reduce_Shape& shape, Reduce_Op op, float* out, size_t threads = 0);
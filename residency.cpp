@@ -0,0 +1,204 @@
+#include "residency.h"
+#include <iostream>
+#include <sstream>
+
+static size_t align_up(size_t bytes, size_t alignment)
+{
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+Residency_Footprint texture_footprint(size_t slices, size_t rows, size_t row_bytes, bool staging, size_t row_pitch)
+{
+    Residency_Footprint f;
+    const size_t pitch = row_pitch ? row_pitch : align_up(row_bytes, residency_row_alignment);
+    f.logical_bytes = slices * rows * row_bytes;
+    f.device_bytes = align_up(slices * rows * pitch, residency_allocation_granularity);
+    f.staging_bytes = staging ? f.device_bytes : 0;
+    return f;
+}
+
+void Residency_Manager::init(Residency_Backend* __backend, size_t __budget)
+{
+    m_backend = __backend;
+    m_budget = __budget;
+    m_used = 0;
+    m_peak = 0;
+    m_clock = 0;
+    m_entries.clear();
+    m_counters = Residency_Stats();
+}
+
+void Residency_Manager::set_budget(size_t __budget)
+{
+    m_budget = __budget;
+    if (m_used > m_budget && !make_room(0, invalid_id))
+        std::cout << "Residency budget " << m_budget << " is below the pinned allocations (" << m_used << " bytes)." << std::endl;
+}
+
+bool Residency_Manager::evict(size_t id)
+{
+    Entry& e = m_entries[id];
+    if (!m_backend->evict(id)) {
+        std::cout << "Failed to evict " << e.name << "." << std::endl;
+        return false;
+    }
+    e.resident = false;
+    m_used -= e.footprint.total();
+    m_counters.evictions++;
+    m_counters.evicted_bytes += e.footprint.logical_bytes;
+    return true;
+}
+
+bool Residency_Manager::make_room(size_t bytes, size_t keep)
+{
+    while (m_used + bytes > m_budget) {
+        // Linear scan for the oldest use: a manager tracks arrays, not thousands of small buffers
+        size_t victim = invalid_id;
+        for (size_t id = 0; id < m_entries.size(); id++) {
+            const Entry& e = m_entries[id];
+            if (e.live && e.resident && !e.pinned && id != keep && (victim == invalid_id || e.last_use < m_entries[victim].last_use))
+                victim = id;
+        }
+        if (victim == invalid_id || !evict(victim))
+            return false;
+    }
+    return true;
+}
+
+size_t Residency_Manager::add(const char* name, const Residency_Footprint& footprint)
+{
+    Entry e;
+    e.name = name;
+    e.footprint = footprint;
+    e.last_use = ++m_clock;
+    e.live = true;
+    e.resident = true;
+    m_entries.push_back(e);
+    const size_t id = m_entries.size() - 1;
+
+    // The owner has already allocated it, so it is counted even if nothing can make room
+    if (!make_room(footprint.total(), id)) {
+        std::cout << "Residency budget exceeded by " << name << " (" << footprint.total() << " bytes)." << std::endl;
+        m_counters.failures++;
+    }
+    m_used += footprint.total();
+    m_peak = m_used > m_peak ? m_used : m_peak;
+    return id;
+}
+
+void Residency_Manager::remove(size_t id)
+{
+    if (id >= m_entries.size() || !m_entries[id].live)
+        return;
+    Entry& e = m_entries[id];
+    if (e.resident)
+        m_used -= e.footprint.total();
+    e.live = false;
+    e.resident = false;
+}
+
+bool Residency_Manager::use(size_t id)
+{
+    if (id >= m_entries.size() || !m_entries[id].live)
+        return false;
+    Entry& e = m_entries[id];
+    e.last_use = ++m_clock;
+    if (e.resident)
+        return true;
+
+    if (!make_room(e.footprint.total(), id)) {
+        m_counters.failures++;
+        return false;
+    }
+    if (!m_backend->restore(id)) {
+        std::cout << "Failed to restore " << e.name << "." << std::endl;
+        m_counters.failures++;
+        return false;
+    }
+    e.resident = true;
+    m_used += e.footprint.total();
+    m_peak = m_used > m_peak ? m_used : m_peak;
+    m_counters.restores++;
+    m_counters.restored_bytes += e.footprint.logical_bytes;
+    return true;
+}
+
+void Residency_Manager::pin(size_t id, bool pinned)
+{
+    if (id < m_entries.size())
+        m_entries[id].pinned = pinned;
+}
+
+bool Residency_Manager::resident(size_t id) const
+{
+    return id < m_entries.size() && m_entries[id].live && m_entries[id].resident;
+}
+
+Residency_Stats Residency_Manager::stats() const
+{
+    Residency_Stats s = m_counters;
+    s.budget = m_budget;
+    s.used = m_used;
+    s.peak = m_peak;
+    for (const Entry& e : m_entries) {
+        if (!e.live)
+            continue;
+        if (!e.resident) {
+            s.evicted++;
+            s.host += e.footprint.logical_bytes;
+            continue;
+        }
+        s.resident++;
+        s.logical += e.footprint.logical_bytes;
+        s.padding += e.footprint.device_bytes - e.footprint.logical_bytes;
+        s.staging += e.footprint.staging_bytes;
+    }
+    return s;
+}
+
+std::string Residency_Manager::report() const
+{
+    std::ostringstream out;
+    for (size_t id = 0; id < m_entries.size(); id++) {
+        const Entry& e = m_entries[id];
+        if (!e.live)
+            continue;
+        out << e.name << ": " << (e.resident ? "resident" : "evicted") << (e.pinned ? ", pinned" : "") << ", data "
+            << e.footprint.logical_bytes / 1024 << " KB, device " << e.footprint.device_bytes / 1024 << " KB, staging "
+            << e.footprint.staging_bytes / 1024 << " KB\n";
+    }
+    Residency_Stats s = stats();
+    out << "Used " << s.used / 1024 << " of " << s.budget / 1024 << " KB (peak " << s.peak / 1024 << " KB), waste "
+        << (s.padding + s.staging) / 1024 << " KB (padding " << s.padding / 1024 << " KB, staging " << s.staging / 1024
+        << " KB), " << s.evictions << " evictions, " << s.restores << " restores\n";
+    return out.str();
+}
+
+void Host_Residency_Backend::attach(size_t id, const std::vector<unsigned char>& data)
+{
+    if (device.size() <= id) {
+        device.resize(id + 1);
+        host.resize(id + 1);
+    }
+    device[id] = data;
+}
+
+bool Host_Residency_Backend::evict(size_t id)
+{
+    if (id >= device.size())
+        return false;
+    host[id].swap(device[id]);
+    device[id].clear();
+    device[id].shrink_to_fit();
+    return true;
+}
+
+bool Host_Residency_Backend::restore(size_t id)
+{
+    if (id >= host.size())
+        return false;
+    device[id].swap(host[id]);
+    host[id].clear();
+    host[id].shrink_to_fit();
+    return true;
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Device memory residency: every tracked allocation is accounted at what it
+ * really costs (rows padded to the pitch alignment, the resource rounded to the
+ * allocation granularity, plus its staging duplicate) against a budget. When an
+ * allocation does not fit, the least recently used unpinned ones are evicted to
+ * host memory through a Residency_Backend, and use() restores an evicted one on
+ * demand. Over-subscription thus turns into explicit, counted copies instead of
+ * silent driver paging.
+ * Host-only, no D3D dependency (see d3d11_residency.h for the device side).
+ */
+static const size_t residency_row_alignment = 256;
+static const size_t residency_allocation_granularity = 65536;
+
+struct Residency_Footprint
+{
+    size_t logical_bytes = 0;   // Bytes of data
+    size_t device_bytes = 0;    // Bytes allocated on the device, padding included
+    size_t staging_bytes = 0;   // Staging duplicate, 0 if there is none
+
+    size_t total() const
+    {
+        return device_bytes + staging_bytes;
+    }
+    // Allocated but not holding data: padding plus the staging duplicate
+    size_t waste() const
+    {
+        return total() - logical_bytes;
+    }
+};
+
+// Footprint of slices x rows x row_bytes of data. row_pitch is the pitch the driver reported
+// (e.g. from mapping the staging copy), 0 to assume rows padded to residency_row_alignment.
+Residency_Footprint texture_footprint(size_t slices, size_t rows, size_t row_bytes, bool staging, size_t row_pitch = 0);
+
+// Moves allocations between device and host memory for the manager
+struct Residency_Backend
+{
+    virtual ~Residency_Backend() {}
+    // Copy allocation id to host memory and free its device memory (staging included)
+    virtual bool evict(size_t id) = 0;
+    // Reallocate id on the device and copy its host copy back
+    virtual bool restore(size_t id) = 0;
+};
+
+struct Residency_Stats
+{
+    size_t budget = 0;
+    size_t used = 0;            // Footprint of the resident allocations
+    size_t peak = 0;
+    size_t logical = 0;         // Data bytes of the resident allocations
+    size_t padding = 0;         // Device bytes beyond the data
+    size_t staging = 0;         // Staging duplicates
+    size_t host = 0;            // Host bytes holding evicted allocations
+    size_t resident = 0;
+    size_t evicted = 0;
+    size_t evictions = 0;
+    size_t restores = 0;
+    size_t evicted_bytes = 0;   // Data bytes copied out and back in
+    size_t restored_bytes = 0;
+    size_t failures = 0;        // use() or add() calls that could not fit within the budget
+};
+
+class Residency_Manager
+{
+public:
+    static const size_t invalid_id = (size_t)-1;
+
+    void init(Residency_Backend* __backend, size_t __budget);
+    // Lower or raise the budget, evicting down to it
+    void set_budget(size_t __budget);
+    // Account a new allocation, resident as created; evicts others to make room. Returns its id.
+    size_t add(const char* name, const Residency_Footprint& footprint);
+    // Stop accounting id (freed by its owner, resident or not)
+    void remove(size_t id);
+    // Mark id used now, restoring it first if evicted. False if it cannot be made resident within the budget.
+    bool use(size_t id);
+    // Pinned allocations are never evicted
+    void pin(size_t id, bool pinned);
+    bool resident(size_t id) const;
+    const Residency_Footprint& footprint(size_t id) const
+    {
+        return m_entries[id].footprint;
+    }
+    Residency_Stats stats() const;
+    // One line per tracked allocation and the totals, for logs
+    std::string report() const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        Residency_Footprint footprint;
+        uint64_t last_use = 0;
+        bool live = false;
+        bool resident = false;
+        bool pinned = false;
+    };
+
+    // Evict least recently used allocations (never keep) until bytes more fit. False if they cannot.
+    bool make_room(size_t bytes, size_t keep);
+    bool evict(size_t id);
+
+    Residency_Backend* m_backend = nullptr;
+    size_t m_budget = 0;
+    size_t m_used = 0;
+    size_t m_peak = 0;
+    uint64_t m_clock = 0;
+    std::vector<Entry> m_entries;       // Indexed by id
+    Residency_Stats m_counters;         // Event counters; sizes are summed in stats()
+};
+
+/*
+ * Host-memory backend: "device" allocations are heap buffers, so residency can be
+ * exercised with a simulated budget and no GPU. Eviction moves a buffer to the host
+ * side and restore moves it back.
+ */
+struct Host_Residency_Backend : Residency_Backend
+{
+    std::vector<std::vector<unsigned char>> device;    // Indexed by id, empty while evicted
+    std::vector<std::vector<unsigned char>> host;
+
+    // Give id its device buffer
+    void attach(size_t id, const std::vector<unsigned char>& data);
+    bool evict(size_t id) override;
+    bool restore(size_t id) override;
+};
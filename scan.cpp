@@ -0,0 +1,168 @@
+#include "scan.h"
+#include "host_parallel.h"
+#include <vector>
+#include <cstring>
+
+static size_t chunk_count(size_t n)
+{
+    return (n + scan_chunk_elements - 1) / scan_chunk_elements;
+}
+
+template<typename T>
+static T scan_blocked(const T* in, T* out, size_t n, Scan_Mode mode, size_t threads)
+{
+    const size_t chunks = chunk_count(n);
+    if (chunks == 0)
+        return T(0);
+
+    // 1. Total of each chunk
+    std::vector<T> totals(chunks);
+    parallel_for(chunks, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            size_t j1 = (c + 1) * scan_chunk_elements < n ? (c + 1) * scan_chunk_elements : n;
+            T sum = T(0);
+            for (size_t j = c * scan_chunk_elements; j < j1; j++)
+                sum += in[j];
+            totals[c] = sum;
+        }
+    }, threads);
+
+    // 2. Exclusive scan of the chunk totals
+    T running = T(0);
+    for (size_t c = 0; c < chunks; c++) {
+        T t = totals[c];
+        totals[c] = running;
+        running += t;
+    }
+
+    // 3. Scan each chunk from its offset
+    parallel_for(chunks, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            size_t j1 = (c + 1) * scan_chunk_elements < n ? (c + 1) * scan_chunk_elements : n;
+            T sum = totals[c];
+            if (mode == SCAN_EXCLUSIVE)
+                for (size_t j = c * scan_chunk_elements; j < j1; j++) {
+                    T v = in[j];
+                    out[j] = sum;
+                    sum += v;
+                }
+            else
+                for (size_t j = c * scan_chunk_elements; j < j1; j++) {
+                    sum += in[j];
+                    out[j] = sum;
+                }
+        }
+    }, threads);
+    return running;
+}
+
+uint32_t scan(const uint32_t* in, uint32_t* out, size_t n, Scan_Mode mode, size_t threads)
+{
+    return scan_blocked(in, out, n, mode, threads);
+}
+
+float scan(const float* in, float* out, size_t n, Scan_Mode mode, size_t threads)
+{
+    return scan_blocked(in, out, n, mode, threads);
+}
+
+size_t compact(const float* in, size_t n, const Compact_Predicate& pred, float* out_values, uint32_t* out_indices, size_t threads)
+{
+    const size_t chunks = chunk_count(n);
+    std::vector<uint32_t> offsets(chunks);
+    parallel_for(chunks, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            size_t j1 = (c + 1) * scan_chunk_elements < n ? (c + 1) * scan_chunk_elements : n;
+            uint32_t kept = 0;
+            for (size_t j = c * scan_chunk_elements; j < j1; j++)
+                kept += pred.test(in[j]);
+            offsets[c] = kept;
+        }
+    }, threads);
+
+    size_t total = scan(offsets.data(), offsets.data(), chunks, SCAN_EXCLUSIVE, 1);
+
+    parallel_for(chunks, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            size_t j1 = (c + 1) * scan_chunk_elements < n ? (c + 1) * scan_chunk_elements : n;
+            size_t o = offsets[c];
+            for (size_t j = c * scan_chunk_elements; j < j1; j++)
+                if (pred.test(in[j])) {
+                    if (out_values)
+                        out_values[o] = in[j];
+                    if (out_indices)
+                        out_indices[o] = (uint32_t)j;
+                    o++;
+                }
+        }
+    }, threads);
+    return total;
+}
+
+void radix_sort(uint32_t* keys, uint32_t* values, size_t n, size_t threads)
+{
+    const size_t radix = 256;
+    const size_t chunks = chunk_count(n);
+    if (chunks == 0)
+        return;
+
+    std::vector<uint32_t> key_tmp(n);
+    std::vector<uint32_t> value_tmp(values ? n : 0);
+    std::vector<uint32_t> offsets(radix * chunks);
+    uint32_t* src_k = keys;
+    uint32_t* dst_k = key_tmp.data();
+    uint32_t* src_v = values;
+    uint32_t* dst_v = value_tmp.data();
+
+    for (unsigned int shift = 0; shift < 32; shift += 8) {
+        // Digit histogram per chunk, stored digit-major so one scan yields every (digit, chunk) offset
+        parallel_for(chunks, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; c++) {
+                uint32_t hist[256] = {};
+                size_t j1 = (c + 1) * scan_chunk_elements < n ? (c + 1) * scan_chunk_elements : n;
+                for (size_t j = c * scan_chunk_elements; j < j1; j++)
+                    hist[(src_k[j] >> shift) & 0xff]++;
+                for (size_t d = 0; d < radix; d++)
+                    offsets[d * chunks + c] = hist[d];
+            }
+        }, threads);
+
+        // All keys share this digit: the pass would be an identity permutation
+        bool skip = false;
+        for (size_t d = 0; d < radix && !skip; d++) {
+            size_t count = 0;
+            for (size_t c = 0; c < chunks; c++)
+                count += offsets[d * chunks + c];
+            skip = count == n;
+        }
+        if (skip)
+            continue;
+
+        scan(offsets.data(), offsets.data(), offsets.size(), SCAN_EXCLUSIVE, 1);
+
+        parallel_for(chunks, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; c++) {
+                uint32_t next[256];
+                for (size_t d = 0; d < radix; d++)
+                    next[d] = offsets[d * chunks + c];
+                size_t j1 = (c + 1) * scan_chunk_elements < n ? (c + 1) * scan_chunk_elements : n;
+                for (size_t j = c * scan_chunk_elements; j < j1; j++) {
+                    uint32_t o = next[(src_k[j] >> shift) & 0xff]++;
+                    dst_k[o] = src_k[j];
+                    if (src_v)
+                        dst_v[o] = src_v[j];
+                }
+            }
+        }, threads);
+
+        std::swap(src_k, dst_k);
+        std::swap(src_v, dst_v);
+    }
+
+    // Odd number of executed passes leaves the result in the temporaries
+    if (src_k != keys) {
+        memcpy(keys, src_k, n * sizeof(uint32_t));
+        if (values)
+            memcpy(values, src_v, n * sizeof(uint32_t));
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Data-parallel building blocks on the host: prefix scan, stream compaction and
+ * key-value radix sort. All three are blocked: the input is cut into chunks of
+ * scan_chunk_elements, chunks are processed in parallel, and a short serial pass
+ * over per-chunk totals links them. The chunking depends only on n, so float scans
+ * are reproducible for any thread count and the sort is stable.
+ * Host-only, no D3D dependency (see d3d11_scan.h for the device side).
+ */
+enum Scan_Mode
+{
+    SCAN_EXCLUSIVE,     // out[i] = in[0] + ... + in[i - 1]
+    SCAN_INCLUSIVE      // out[i] = in[0] + ... + in[i]
+};
+
+enum Compact_Op
+{
+    COMPACT_GREATER,
+    COMPACT_LESS,
+    COMPACT_NOT_EQUAL
+};
+
+// Keeps values v with (v > threshold), (v < threshold) or (v != threshold)
+struct Compact_Predicate
+{
+    Compact_Op op = COMPACT_NOT_EQUAL;
+    float threshold = 0.0f;
+
+    bool test(float v) const
+    {
+        return op == COMPACT_GREATER ? v > threshold : op == COMPACT_LESS ? v < threshold : v != threshold;
+    }
+};
+
+static const size_t scan_chunk_elements = 65536;
+
+// Scan n values (in and out may alias), returns the total of all n values
+uint32_t scan(const uint32_t* in, uint32_t* out, size_t n, Scan_Mode mode, size_t threads = 0);
+float scan(const float* in, float* out, size_t n, Scan_Mode mode, size_t threads = 0);
+
+// Copy the values passing pred, in input order, to out_values and their positions to out_indices
+// (either may be nullptr). Returns the number kept.
+size_t compact(const float* in, size_t n, const Compact_Predicate& pred, float* out_values, uint32_t* out_indices, size_t threads = 0);
+
+// Stable LSD sort of keys ascending, values (may be nullptr) follow their keys
+void radix_sort(uint32_t* keys, uint32_t* values, size_t n, size_t threads = 0);
+
+// Order-preserving float <-> uint32 mapping, so float keys can be radix sorted
+inline uint32_t float_to_sort_key(float f)
+{
+    union { float f; uint32_t u; } v;
+    v.f = f;
+    return (v.u & 0x80000000u) ? ~v.u : (v.u | 0x80000000u);
+}
+
+inline float sort_key_to_float(uint32_t k)
+{
+    union { float f; uint32_t u; } v;
+    v.u = (k & 0x80000000u) ? (k & 0x7fffffffu) : ~k;
+    return v.f;
+}
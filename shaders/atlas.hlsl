@@ -0,0 +1,60 @@
+// Batched dispatch over arrays packed in atlas pages (see d3d11_atlas.h).
+// One thread group per Atlas_Tile; ATLAS_TILE_X and ATLAS_TILE_Y must match the tile size the list was built with.
+#ifndef ATLAS_TILE_X
+#define ATLAS_TILE_X 8
+#endif
+#ifndef ATLAS_TILE_Y
+#define ATLAS_TILE_Y 8
+#endif
+
+struct Atlas_Tile
+{
+    uint x;         // Block origin in the page
+    uint y;
+    uint slice;
+    uint array;     // Position of the array in the batch
+    uint channel;
+    uint h0;        // Block origin in the logical array
+    uint w0;
+    uint extent;    // Block width | height << 16
+};
+
+cbuffer Atlas_Constants : register(b0)
+{
+    uint tile_count;
+    uint groups_x;
+    uint2 align_padding;
+};
+
+StructuredBuffer<Atlas_Tile> atlas_tiles : register(t0);
+
+// The tile of this group, false for groups past the end of the list and threads outside the block
+bool atlas_element(uint3 group, uint3 thread, out Atlas_Tile tile, out uint3 texel)
+{
+    tile = (Atlas_Tile)0;
+    texel = uint3(0, 0, 0);
+    uint t = group.y * groups_x + group.x;
+    if (t >= tile_count)
+        return false;
+    tile = atlas_tiles[t];
+    if (thread.x >= (tile.extent & 0xffff) || thread.y >= (tile.extent >> 16))
+        return false;
+    texel = uint3(tile.x + thread.x, tile.y + thread.y, tile.slice);
+    return true;
+}
+
+// Example kernel: output = input_0 + input_1 + bias of the array, for every array of the batch
+Texture2DArray<float> input_0 : register(t1);
+Texture2DArray<float> input_1 : register(t2);
+StructuredBuffer<float> array_bias : register(t3);
+RWTexture2DArray<float> output : register(u0);
+
+[numthreads(ATLAS_TILE_X, ATLAS_TILE_Y, 1)]
+void sum_main(uint3 group : SV_GroupID, uint3 thread : SV_GroupThreadID)
+{
+    Atlas_Tile tile;
+    uint3 texel;
+    if (!atlas_element(group, thread, tile, texel))
+        return;
+    output[texel] = input_0[texel] + input_1[texel] + array_bias[tile.array];
+}
@@ -0,0 +1,50 @@
+// Compressed texture arrays (see d3d11_compressed_texture.h).
+// Defines: COMPRESSED_FORMAT (0: BC4, one channel per slice,
+//          1: BC5, channels 2s and 2s + 1 in R and G of slice s,
+//          2: int8 tiles, R8_UNORM codes with a (scale, offset) pair per tile in tile_params).
+// The sampler decodes BC4/BC5 and the UNORM codes; UNORM or SNORM comes from the view format.
+#ifndef COMPRESSED_FORMAT
+#define COMPRESSED_FORMAT 0
+#endif
+
+cbuffer Compressed_Constants : register(b0)
+{
+    uint channels;
+    uint height;
+    uint width;
+    uint tile_height;
+    uint tile_width;
+    uint tiles_h;       // Quantization tiles per channel along h and w
+    uint tiles_w;
+    uint align_padding;
+};
+
+#if COMPRESSED_FORMAT == 1
+Texture2DArray<float2> compressed_texture : register(t0);
+#else
+Texture2DArray<float> compressed_texture : register(t0);
+#endif
+StructuredBuffer<float2> tile_params : register(t1);
+RWTexture2DArray<float> dense_out : register(u0);
+
+// Element (c, h, w) of the logical array
+float compressed_load(uint c, uint h, uint w)
+{
+#if COMPRESSED_FORMAT == 1
+    float2 rg = compressed_texture[uint3(w, h, c / 2)];
+    return (c & 1) ? rg.y : rg.x;
+#elif COMPRESSED_FORMAT == 2
+    float2 p = tile_params[(c * tiles_h + h / tile_height) * tiles_w + w / tile_width];
+    return compressed_texture[uint3(w, h, c)] * p.x + p.y;
+#else
+    return compressed_texture[uint3(w, h, c)];
+#endif
+}
+
+[numthreads(16, 16, 1)]
+void to_dense_main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= width || DTid.y >= height)
+        return;
+    dense_out[DTid] = compressed_load(DTid.z, DTid.y, DTid.x);
+}
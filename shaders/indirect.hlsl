@@ -0,0 +1,24 @@
+// Dispatch arguments written on the GPU (see d3d11_indirect.h).
+#define MAX_GROUPS 65535
+
+cbuffer Indirect_Constants : register(b0)
+{
+    uint items_per_group;
+    uint args_offset;       // Byte offset of the (x, y, z) slot in args_out
+    uint count_index;       // Element of count_in holding the item count
+    uint align_padding;
+};
+
+StructuredBuffer<uint> count_in : register(t0);
+RWByteAddressBuffer args_out : register(u0);
+
+// Same folding as dispatch_args_for_count(): x up to MAX_GROUPS, the rest in y, (0, 1, 1) for no items
+[numthreads(1, 1, 1)]
+void args_from_count_main()
+{
+    uint count = count_in[count_index];
+    uint groups = count / items_per_group + (count % items_per_group != 0 ? 1 : 0);
+    uint x = min(groups, MAX_GROUPS);
+    uint y = groups == 0 ? 1 : (groups + x - 1) / x;
+    args_out.Store3(args_offset, uint3(x, y, 1));
+}
@@ -0,0 +1,36 @@
+// HWC <-> CHW layout transforms (see d3d11_layout_transform.h).
+// Defines: ELEMENT (element type matching the view formats: unorm float for R8_UNORM, float otherwise).
+#ifndef ELEMENT
+#define ELEMENT float
+#endif
+
+cbuffer Layout_Constants : register(b0)
+{
+    uint channels;
+    uint height;
+    uint width;
+    uint align_padding;
+};
+
+Buffer<ELEMENT> hwc_in : register(t0);
+Texture2DArray<ELEMENT> chw_in : register(t1);
+RWTexture2DArray<ELEMENT> chw_out : register(u0);
+RWBuffer<ELEMENT> hwc_out : register(u1);
+
+// One thread per element, z is the channel: every group writes (or reads) whole rows of one plane,
+// and the neighbouring channels of a pixel are fetched by the groups of the next z through the cache
+[numthreads(16, 16, 1)]
+void hwc_to_chw_main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= width || DTid.y >= height)
+        return;
+    chw_out[DTid] = hwc_in[(DTid.y * width + DTid.x) * channels + DTid.z];
+}
+
+[numthreads(16, 16, 1)]
+void chw_to_hwc_main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= width || DTid.y >= height)
+        return;
+    hwc_out[(DTid.y * width + DTid.x) * channels + DTid.z] = chw_in[DTid];
+}
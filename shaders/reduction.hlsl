@@ -0,0 +1,116 @@
+// Hierarchical reduction of a Texture2DArray over an axis subset (see reduction.h / d3d11_reduction.h).
+// Defines: REDUCE_OP (0 sum, 1 min, 2 max), GROUP_SIZE (power of two, at most 1024).
+// Each group folds GROUP_SIZE * ITEMS_PER_THREAD values of one output with a groupshared tree;
+// passes repeat over the partials until one group per output is left, which writes the result.
+#define ITEMS_PER_THREAD 4
+#define MAX_GROUPS_Y 65535
+
+cbuffer Reduce_Constants : register(b0)
+{
+    uint n;             // Values per output read by this pass
+    uint out_count;
+    uint groups_x;      // Groups per output in this pass
+    uint final_pass;    // 1: write output_texture, 0: write output_partials
+    uint height;
+    uint width;
+    uint out_height;
+    uint out_width;
+    uint red_height;    // Extent of the reduced axes (1 along kept axes)
+    uint red_width;
+    float scale;
+    uint align_padding;
+};
+
+Texture2DArray<float> input_texture : register(t0);
+StructuredBuffer<float> input_partials : register(t1);
+RWStructuredBuffer<float> output_partials : register(u0);
+RWTexture2DArray<float> output_texture : register(u1);
+
+groupshared float shared_values[GROUP_SIZE];
+
+float identity()
+{
+#if REDUCE_OP == 0
+    return 0.0f;
+#elif REDUCE_OP == 1
+    return asfloat(0x7f800000);
+#else
+    return asfloat(0xff800000);
+#endif
+}
+
+float combine(float a, float b)
+{
+#if REDUCE_OP == 0
+    return a + b;
+#elif REDUCE_OP == 1
+    return b < a ? b : a;
+#else
+    return b > a ? b : a;
+#endif
+}
+
+uint3 output_coords(uint o)
+{
+    return uint3(o % out_width, (o / out_width) % out_height, o / (out_width * out_height));
+}
+
+// Value j (CHW order over the reduced axes) of output o
+float load_texture(uint o, uint j)
+{
+    uint3 oc = output_coords(o);
+    uint3 jc = uint3(j % red_width, (j / red_width) % red_height, j / (red_width * red_height));
+    return input_texture[oc + jc];
+}
+
+void group_reduce(uint tid, float v, uint o, uint gx, bool valid)
+{
+    shared_values[tid] = v;
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint s = GROUP_SIZE / 2; s > 0; s >>= 1) {
+        if (tid < s)
+            shared_values[tid] = combine(shared_values[tid], shared_values[tid + s]);
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (tid == 0 && valid) {
+        if (final_pass)
+            output_texture[output_coords(o)] = shared_values[0] * scale;
+        else
+            output_partials[o * groups_x + gx] = shared_values[0];
+    }
+}
+
+[numthreads(GROUP_SIZE, 1, 1)]
+void reduce_texture_main(uint3 Gid : SV_GroupID, uint tid : SV_GroupIndex)
+{
+    // Groups past the last output still reach the barriers, they just never write
+    uint o = Gid.z * MAX_GROUPS_Y + Gid.y;
+    bool valid = o < out_count;
+
+    float v = identity();
+    uint j = Gid.x * GROUP_SIZE * ITEMS_PER_THREAD + tid;
+    [unroll]
+    for (uint k = 0; k < ITEMS_PER_THREAD; k++, j += GROUP_SIZE)
+        if (valid && j < n)
+            v = combine(v, load_texture(o, j));
+    group_reduce(tid, v, o, Gid.x, valid);
+}
+
+[numthreads(GROUP_SIZE, 1, 1)]
+void reduce_partials_main(uint3 Gid : SV_GroupID, uint tid : SV_GroupIndex)
+{
+    // Groups past the last output still reach the barriers, they just never write
+    uint o = Gid.z * MAX_GROUPS_Y + Gid.y;
+    bool valid = o < out_count;
+
+    float v = identity();
+    uint j = Gid.x * GROUP_SIZE * ITEMS_PER_THREAD + tid;
+    [unroll]
+    for (uint k = 0; k < ITEMS_PER_THREAD; k++, j += GROUP_SIZE)
+        if (valid && j < n)
+            v = combine(v, input_partials[o * n + j]);
+    group_reduce(tid, v, o, Gid.x, valid);
+}
@@ -0,0 +1,182 @@
+// Prefix scan, stream compaction and radix sort (see d3d11_scan.h).
+// Defines: SCAN_T (uint or float, element type of the scan entry points).
+#ifndef SCAN_T
+#define SCAN_T uint
+#endif
+#define SCAN_GROUP 256
+#define SCAN_ITEMS 4
+#define SCAN_BLOCK (SCAN_GROUP * SCAN_ITEMS)
+#define RADIX_GROUP 128
+#define RADIX_DIGITS 16
+
+cbuffer Scan_Constants : register(b0)
+{
+    uint n;
+    uint inclusive;
+    uint block_count;   // Groups along x (radix: blocks)
+    uint compact_op;    // 0 greater, 1 less, 2 not equal
+    float threshold;
+    uint shift;         // Radix digit shift
+    uint has_values;
+    uint height;        // Texture extent for compaction
+    uint width;
+    uint3 align_padding;
+};
+
+StructuredBuffer<SCAN_T> scan_in : register(t0);
+StructuredBuffer<SCAN_T> block_offsets : register(t1);
+Texture2DArray<float> input_texture : register(t2);
+StructuredBuffer<uint> keys_in : register(t3);
+StructuredBuffer<uint> values_in : register(t4);
+
+RWStructuredBuffer<SCAN_T> scan_out : register(u0);
+RWStructuredBuffer<SCAN_T> block_sums : register(u1);
+RWStructuredBuffer<float> compact_values : register(u2);
+RWStructuredBuffer<uint> compact_indices : register(u3);
+RWStructuredBuffer<uint> compact_count : register(u4);
+RWStructuredBuffer<uint> keys_out : register(u5);
+RWStructuredBuffer<uint> values_out : register(u6);
+RWStructuredBuffer<uint> histogram : register(u7);
+
+groupshared SCAN_T shared_scan[SCAN_GROUP];
+groupshared uint4 shared_digits[RADIX_GROUP];
+groupshared uint shared_counts[RADIX_DIGITS];
+
+// Inclusive scan of one value per thread across the group (Hillis-Steele)
+SCAN_T group_inclusive_scan(uint tid, SCAN_T v)
+{
+    shared_scan[tid] = v;
+    GroupMemoryBarrierWithGroupSync();
+    [unroll]
+    for (uint s = 1; s < SCAN_GROUP; s <<= 1) {
+        SCAN_T add = tid >= s ? shared_scan[tid - s] : (SCAN_T)0;
+        GroupMemoryBarrierWithGroupSync();
+        shared_scan[tid] += add;
+        GroupMemoryBarrierWithGroupSync();
+    }
+    return shared_scan[tid];
+}
+
+// Each group scans SCAN_BLOCK values and writes its total to block_sums
+[numthreads(SCAN_GROUP, 1, 1)]
+void scan_blocks_main(uint3 Gid : SV_GroupID, uint tid : SV_GroupIndex)
+{
+    uint base = Gid.x * SCAN_BLOCK + tid * SCAN_ITEMS;
+    SCAN_T v[SCAN_ITEMS];
+    SCAN_T sum = (SCAN_T)0;
+    [unroll]
+    for (uint k = 0; k < SCAN_ITEMS; k++) {
+        v[k] = base + k < n ? scan_in[base + k] : (SCAN_T)0;
+        sum += v[k];
+    }
+
+    SCAN_T total = group_inclusive_scan(tid, sum);
+    SCAN_T running = tid > 0 ? shared_scan[tid - 1] : (SCAN_T)0;
+    [unroll]
+    for (uint k = 0; k < SCAN_ITEMS; k++) {
+        SCAN_T before = running;
+        running += v[k];
+        if (base + k < n)
+            scan_out[base + k] = inclusive ? running : before;
+    }
+    if (tid == SCAN_GROUP - 1)
+        block_sums[Gid.x] = total;
+}
+
+// Add the scanned total of all previous blocks
+[numthreads(SCAN_GROUP, 1, 1)]
+void add_offsets_main(uint3 Gid : SV_GroupID, uint tid : SV_GroupIndex)
+{
+    SCAN_T offset = block_offsets[Gid.x];
+    uint base = Gid.x * SCAN_BLOCK + tid * SCAN_ITEMS;
+    [unroll]
+    for (uint k = 0; k < SCAN_ITEMS; k++)
+        if (base + k < n)
+            scan_out[base + k] += offset;
+}
+
+bool keep(float v)
+{
+    return compact_op == 0 ? v > threshold : compact_op == 1 ? v < threshold : v != threshold;
+}
+
+float load_linear(uint i)
+{
+    return input_texture[uint3(i % width, (i / width) % height, i / (width * height))];
+}
+
+// 1 for every texel passing the predicate, linear CHW order
+[numthreads(SCAN_GROUP, 1, 1)]
+void compact_flags_main(uint3 Gid : SV_GroupID, uint tid : SV_GroupIndex)
+{
+    uint i = (Gid.y * block_count + Gid.x) * SCAN_GROUP + tid;
+    if (i < n)
+        scan_out[i] = keep(load_linear(i)) ? 1 : 0;
+}
+
+// scan_in holds the exclusive scan of the flags, i.e. each kept texel's output slot
+[numthreads(SCAN_GROUP, 1, 1)]
+void compact_scatter_main(uint3 Gid : SV_GroupID, uint tid : SV_GroupIndex)
+{
+    uint i = (Gid.y * block_count + Gid.x) * SCAN_GROUP + tid;
+    if (i >= n)
+        return;
+    float v = load_linear(i);
+    bool kept = keep(v);
+    if (kept) {
+        compact_values[scan_in[i]] = v;
+        compact_indices[scan_in[i]] = i;
+    }
+    if (i == n - 1)
+        compact_count[0] = scan_in[i] + (kept ? 1 : 0);
+}
+
+// Digit histogram of each block, stored digit-major: histogram[digit * block_count + block]
+[numthreads(RADIX_GROUP, 1, 1)]
+void radix_count_main(uint3 Gid : SV_GroupID, uint tid : SV_GroupIndex)
+{
+    if (tid < RADIX_DIGITS)
+        shared_counts[tid] = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    uint i = Gid.x * RADIX_GROUP + tid;
+    if (i < n)
+        InterlockedAdd(shared_counts[(keys_in[i] >> shift) & (RADIX_DIGITS - 1)], 1);
+    GroupMemoryBarrierWithGroupSync();
+
+    if (tid < RADIX_DIGITS)
+        histogram[tid * block_count + Gid.x] = shared_counts[tid];
+}
+
+// block_offsets holds the exclusive scan of the histogram. The rank of a key among the
+// keys of its block with the same digit comes from one scan over 16 packed 8-bit counters.
+[numthreads(RADIX_GROUP, 1, 1)]
+void radix_scatter_main(uint3 Gid : SV_GroupID, uint tid : SV_GroupIndex)
+{
+    uint i = Gid.x * RADIX_GROUP + tid;
+    bool valid = i < n;
+    uint key = valid ? keys_in[i] : 0;
+    uint digit = (key >> shift) & (RADIX_DIGITS - 1);
+    uint4 one_hot = uint4(0, 0, 0, 0);
+    if (valid)
+        one_hot[digit / 4] = 1u << ((digit % 4) * 8);
+
+    shared_digits[tid] = one_hot;
+    GroupMemoryBarrierWithGroupSync();
+    [unroll]
+    for (uint s = 1; s < RADIX_GROUP; s <<= 1) {
+        uint4 add = tid >= s ? shared_digits[tid - s] : uint4(0, 0, 0, 0);
+        GroupMemoryBarrierWithGroupSync();
+        shared_digits[tid] += add;
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (valid) {
+        uint4 before = shared_digits[tid] - one_hot;
+        uint rank = (before[digit / 4] >> ((digit % 4) * 8)) & 0xff;
+        uint dst = block_offsets[digit * block_count + Gid.x] + rank;
+        keys_out[dst] = key;
+        if (has_values)
+            values_out[dst] = values_in[i];
+    }
+}
@@ -0,0 +1,43 @@
+// Sparse texture arrays (see d3d11_sparse_texture.h).
+// Defines: SPARSE_TILED (1: sparse_texture is the logical array on tiled resources,
+//          0: sparse_texture is the page pool, one page per slice, addressed through page_table).
+#ifndef SPARSE_TILED
+#define SPARSE_TILED 0
+#endif
+#define NOT_RESIDENT 0xffffffff
+
+cbuffer Sparse_Constants : register(b0)
+{
+    uint channels;
+    uint height;
+    uint width;
+    uint page_height;
+    uint page_width;
+    uint pages_h;       // Pages per channel along h and w
+    uint pages_w;
+    uint align_padding;
+};
+
+Texture2DArray<float> sparse_texture : register(t0);
+StructuredBuffer<uint> page_table : register(t1);
+RWTexture2DArray<float> dense_out : register(u0);
+
+// Element (c, h, w) of the logical array, zero where no page is resident
+float sparse_load(uint c, uint h, uint w)
+{
+#if SPARSE_TILED
+    // Tier 2 tiled resources read unmapped tiles as zero
+    return sparse_texture[uint3(w, h, c)];
+#else
+    uint slot = page_table[(c * pages_h + h / page_height) * pages_w + w / page_width];
+    return slot == NOT_RESIDENT ? 0.0f : sparse_texture[uint3(w % page_width, h % page_height, slot)];
+#endif
+}
+
+[numthreads(16, 16, 1)]
+void to_dense_main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= width || DTid.y >= height)
+        return;
+    dense_out[DTid] = sparse_load(DTid.z, DTid.y, DTid.x);
+}
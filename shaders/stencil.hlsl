@@ -0,0 +1,66 @@
+// Stencil kernel template (see stencil.h), one group per TILE_X x TILE_Y block of one channel (SV_GroupID.z).
+// Defines: TILE_X, TILE_Y; HALO_LEFT, HALO_RIGHT, HALO_UP, HALO_DOWN (how far taps reach);
+//          STENCIL_TAPS, a list of TAP(dx, dy, weight); STENCIL_BOUNDARY (0 clamp, 1 wrap, 2 zero);
+//          STENCIL_GROUPSHARED (1: taps read a groupshared copy of the block and its halo, 0: taps fetch from the texture).
+#ifndef STENCIL_GROUPSHARED
+#define STENCIL_GROUPSHARED 1
+#endif
+
+cbuffer Stencil_Constants : register(b0)
+{
+    uint width;
+    uint height;
+    uint channels;
+    uint align_padding;
+};
+
+Texture2DArray<float> stencil_in : register(t0);
+RWTexture2DArray<float> stencil_out : register(u0);
+
+// Element (x, y) of channel c under the boundary rule
+float stencil_fetch(int x, int y, uint c)
+{
+#if STENCIL_BOUNDARY == 0
+    x = clamp(x, 0, (int)width - 1);
+    y = clamp(y, 0, (int)height - 1);
+#elif STENCIL_BOUNDARY == 1
+    x = (x % (int)width + (int)width) % (int)width;
+    y = (y % (int)height + (int)height) % (int)height;
+#else
+    if (x < 0 || y < 0 || x >= (int)width || y >= (int)height)
+        return 0.0f;
+#endif
+    return stencil_in[int3(x, y, c)];
+}
+
+#if STENCIL_GROUPSHARED
+#define SHARED_W (TILE_X + HALO_LEFT + HALO_RIGHT)
+#define SHARED_H (TILE_Y + HALO_UP + HALO_DOWN)
+groupshared float shared_tile[SHARED_H * SHARED_W];
+#define TAP(dx, dy, weight) acc += (weight) * shared_tile[(thread.y + HALO_UP + (dy)) * SHARED_W + thread.x + HALO_LEFT + (dx)];
+#else
+#define TAP(dx, dy, weight) acc += (weight) * stencil_fetch(x + (dx), y + (dy), c);
+#endif
+
+[numthreads(TILE_X, TILE_Y, 1)]
+void stencil_main(uint3 group : SV_GroupID, uint3 thread : SV_GroupThreadID, uint index : SV_GroupIndex)
+{
+    const uint c = group.z;
+    const int x0 = (int)(group.x * TILE_X);
+    const int y0 = (int)(group.y * TILE_Y);
+    const int x = x0 + (int)thread.x;
+    const int y = y0 + (int)thread.y;
+
+#if STENCIL_GROUPSHARED
+    // The whole group loads block and halo, edge groups included, before any thread returns
+    for (uint i = index; i < SHARED_W * SHARED_H; i += TILE_X * TILE_Y)
+        shared_tile[i] = stencil_fetch(x0 - HALO_LEFT + (int)(i % SHARED_W), y0 - HALO_UP + (int)(i / SHARED_W), c);
+    GroupMemoryBarrierWithGroupSync();
+#endif
+
+    if (x >= (int)width || y >= (int)height)
+        return;
+    float acc = 0.0f;
+    STENCIL_TAPS
+    stencil_out[int3(x, y, c)] = acc;
+}
@@ -0,0 +1,176 @@
+// Device side of Delta_Codec (transfer_codec.h), same stream layout.
+// WORD_BITS must be defined as 16 (R16_FLOAT arrays) or 32 (R32_FLOAT arrays).
+#define BLOCK_SIZE 256
+#define SCAN_SIZE 1024
+#define WORD_MASK (WORD_BITS == 32 ? 0xffffffff : ((1u << WORD_BITS) - 1))
+
+cbuffer Codec_Constants : register(b0)
+{
+    uint count;
+    uint width;
+    uint height;
+    uint block_count;
+    uint groups_x;
+    uint3 align_padding;
+};
+
+ByteAddressBuffer stream_in : register(t0);
+Texture2DArray<float> texture_in : register(t1);
+
+RWTexture2DArray<float> texture_out : register(u0);
+RWByteAddressBuffer stream_out : register(u1);
+
+groupshared uint gs_values[SCAN_SIZE];
+groupshared uint gs_bits;
+
+uint3 texel(uint idx)
+{
+    return uint3(idx % width, (idx / width) % height, idx / (width * height));
+}
+
+uint zigzag(uint d)
+{
+    int s = ((int)(d << (32 - WORD_BITS))) >> (32 - WORD_BITS);
+    return ((uint)(s << 1) ^ (uint)(s >> 31)) & WORD_MASK;
+}
+
+uint unzigzag(uint z)
+{
+    return ((z >> 1) ^ (0u - (z & 1))) & WORD_MASK;
+}
+
+uint payload_words(uint bits)
+{
+    return ((BLOCK_SIZE - 1) * bits + 31) / 32;
+}
+
+uint load_word(uint idx)
+{
+    float v = texture_in[texel(idx)];
+    return WORD_BITS == 16 ? f32tof16(v) : asuint(v);
+}
+
+// Inclusive Hillis-Steele scan over gs_values[0, n)
+void scan(uint gi, uint n)
+{
+    for (uint stride = 1; stride < n; stride <<= 1) {
+        uint add = gi >= stride ? gs_values[gi - stride] : 0;
+        GroupMemoryBarrierWithGroupSync();
+        gs_values[gi] += add;
+        GroupMemoryBarrierWithGroupSync();
+    }
+}
+
+// One group per block: unpack deltas, prefix-sum them and write texels
+[numthreads(BLOCK_SIZE, 1, 1)]
+void decode_main(uint3 gid : SV_GroupID, uint gi : SV_GroupIndex)
+{
+    uint block = gid.y * groups_x + gid.x;
+    if (block >= block_count)
+        return;
+
+    uint entry = (1 + 3 * block) * 4;
+    uint base = stream_in.Load(entry);
+    uint offset = stream_in.Load(entry + 4);
+    uint bits = stream_in.Load(entry + 8);
+
+    uint z = 0;
+    if (gi > 0 && bits > 0) {
+        uint payload = 1 + 3 * block_count + offset;
+        uint bit_offset = (gi - 1) * bits;
+        uint shift = bit_offset & 31;
+        uint addr = (payload + (bit_offset >> 5)) * 4;
+        z = stream_in.Load(addr) >> shift;
+        if (shift + bits > 32)
+            z |= stream_in.Load(addr + 4) << (32 - shift);
+        if (bits < 32)
+            z &= (1u << bits) - 1;
+    }
+    gs_values[gi] = gi == 0 ? base : unzigzag(z);
+    GroupMemoryBarrierWithGroupSync();
+    scan(gi, BLOCK_SIZE);
+
+    uint idx = block * BLOCK_SIZE + gi;
+    if (idx >= count)
+        return;
+    uint value = gs_values[gi] & WORD_MASK;
+    texture_out[texel(idx)] = WORD_BITS == 16 ? f16tof32(value) : asfloat(value);
+}
+
+// Encode pass 1, one group per block: base value and bit width
+[numthreads(BLOCK_SIZE, 1, 1)]
+void encode_blocks_main(uint3 gid : SV_GroupID, uint gi : SV_GroupIndex)
+{
+    uint block = gid.y * groups_x + gid.x;
+    if (block >= block_count)
+        return;
+
+    if (gi == 0)
+        gs_bits = 0;
+    uint idx = block * BLOCK_SIZE + gi;
+    uint v = idx < count ? load_word(idx) : 0;
+    gs_values[gi] = v;
+    GroupMemoryBarrierWithGroupSync();
+
+    uint z = (gi > 0 && idx < count) ? zigzag(v - gs_values[gi - 1]) : 0;
+    InterlockedMax(gs_bits, z == 0 ? 0 : firstbithigh(z) + 1);
+    GroupMemoryBarrierWithGroupSync();
+
+    if (gi == 0) {
+        uint entry = (1 + 3 * block) * 4;
+        stream_out.Store(entry, v);
+        stream_out.Store(entry + 8, gs_bits);
+    }
+}
+
+// Encode pass 2, single group: exclusive scan of payload sizes into block offsets
+[numthreads(SCAN_SIZE, 1, 1)]
+void encode_offsets_main(uint gi : SV_GroupIndex)
+{
+    uint per_thread = (block_count + SCAN_SIZE - 1) / SCAN_SIZE;
+    uint first = gi * per_thread;
+    uint last = min(first + per_thread, block_count);
+
+    uint sum = 0;
+    for (uint b = first; b < last; b++)
+        sum += payload_words(stream_out.Load((1 + 3 * b) * 4 + 8));
+    gs_values[gi] = sum;
+    GroupMemoryBarrierWithGroupSync();
+    scan(gi, SCAN_SIZE);
+
+    uint offset = gs_values[gi] - sum;
+    for (uint b = first; b < last; b++) {
+        stream_out.Store((1 + 3 * b) * 4 + 4, offset);
+        offset += payload_words(stream_out.Load((1 + 3 * b) * 4 + 8));
+    }
+    if (gi == SCAN_SIZE - 1)
+        stream_out.Store(0, gs_values[gi]);
+}
+
+// Encode pass 3, one group per block: OR each delta into the zeroed payload
+[numthreads(BLOCK_SIZE, 1, 1)]
+void encode_pack_main(uint3 gid : SV_GroupID, uint gi : SV_GroupIndex)
+{
+    uint block = gid.y * groups_x + gid.x;
+    if (block >= block_count)
+        return;
+
+    uint idx = block * BLOCK_SIZE + gi;
+    uint v = idx < count ? load_word(idx) : 0;
+    gs_values[gi] = v;
+    GroupMemoryBarrierWithGroupSync();
+
+    uint entry = (1 + 3 * block) * 4;
+    uint bits = stream_out.Load(entry + 8);
+    if (gi == 0 || idx >= count || bits == 0)
+        return;
+
+    uint z = zigzag(v - gs_values[gi - 1]);
+    uint payload = 1 + 3 * block_count + stream_out.Load(entry + 4);
+    uint bit_offset = (gi - 1) * bits;
+    uint shift = bit_offset & 31;
+    uint addr = (payload + (bit_offset >> 5)) * 4;
+    stream_out.InterlockedOr(addr, z << shift);
+    if (shift + bits > 32)
+        stream_out.InterlockedOr(addr + 4, z >> (32 - shift));
+}
@@ -0,0 +1,365 @@
+#include "snapshot.h"
+#include "transfer_codec.h"
+#include "host_parallel.h"
+#include <iostream>
+#include <cstring>
+#include <atomic>
+
+static const char snapshot_magic[8] = { 'T', 'A', 'B', 'S', 'N', 'A', 'P', '1' };
+static const uint32_t snapshot_version = 1;
+static const size_t snapshot_header_bytes = 40;
+
+struct Crc32_Table
+{
+    uint32_t entries[256];
+    Crc32_Table()
+    {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+    }
+};
+
+uint32_t crc32(const void* data, size_t bytes, uint32_t crc)
+{
+    static const Crc32_Table table;
+    crc = ~crc;
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < bytes; i++)
+        crc = table.entries[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void put_u32(std::string& out, uint32_t v)
+{
+    out.append((const char*)&v, sizeof(v));
+}
+
+static void put_u64(std::string& out, uint64_t v)
+{
+    out.append((const char*)&v, sizeof(v));
+}
+
+struct Snapshot_Cursor
+{
+    const unsigned char* p;
+    const unsigned char* end;
+    bool ok = true;
+
+    template<typename T>
+    T get()
+    {
+        T v = T();
+        if (p + sizeof(T) > end) {
+            ok = false;
+            return v;
+        }
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+};
+
+bool Snapshot_Writer::open(const char* path)
+{
+    file = fopen(path, "wb");
+    if (file == nullptr) {
+        std::cout << "Failed to create snapshot: " << path << std::endl;
+        return false;
+    }
+
+    // Header is patched in close()
+    char header[snapshot_header_bytes] = {};
+    fwrite(header, 1, sizeof(header), file);
+    offset = snapshot_header_bytes;
+    arrays.clear();
+    return true;
+}
+
+int Snapshot_Writer::add_array(const char* name, uint32_t format, size_t element_size, size_t channels, size_t height, size_t width, size_t tile_height)
+{
+    if (file == nullptr || channels * height * width * element_size == 0) {
+        std::cout << "Cannot add snapshot array, open() first and use a non-zero shape." << std::endl;
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    Snapshot_Array_Info info;
+    info.name = name;
+    info.format = format;
+    info.element_size = element_size;
+    info.channels = channels;
+    info.height = height;
+    info.width = width;
+    info.tile_height = (tile_height == 0 || tile_height > height) ? height : tile_height;
+    info.chunks.resize(channels * info.tiles_per_channel());
+    arrays.push_back(info);
+    return (int)arrays.size() - 1;
+}
+
+bool Snapshot_Writer::write_chunk(int array, size_t channel, size_t tile, const void* data)
+{
+    // Copy the shape under the lock, add_array() may grow the vector concurrently
+    Snapshot_Array_Info info;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (file == nullptr || array < 0 || array >= (int)arrays.size()) {
+            std::cout << "Cannot write snapshot chunk, invalid array." << std::endl;
+            return false;
+        }
+        info.element_size = arrays[array].element_size;
+        info.height = arrays[array].height;
+        info.width = arrays[array].width;
+        info.tile_height = arrays[array].tile_height;
+        info.channels = arrays[array].channels;
+    }
+    if (channel >= info.channels || tile >= info.tiles_per_channel()) {
+        std::cout << "Cannot write snapshot chunk, channel or tile out of range." << std::endl;
+        return false;
+    }
+
+    Snapshot_Chunk chunk;
+    chunk.raw_bytes = info.tile_rows(tile) * info.width * info.element_size;
+    chunk.crc = crc32(data, (size_t)chunk.raw_bytes);
+
+    const void* stored = data;
+    std::vector<uint32_t> stream;
+    if (compress && (info.element_size == 1 || info.element_size == 2 || info.element_size == 4)) {
+        Delta_Codec codec;
+        codec.word_bits = info.element_size * 8;
+        codec.threads = 1;
+        codec.encode(data, (size_t)chunk.raw_bytes / info.element_size, stream);
+        if (stream.size() * sizeof(uint32_t) < chunk.raw_bytes) {
+            stored = stream.data();
+            chunk.codec = 1;
+        }
+    }
+    chunk.stored_bytes = chunk.codec ? stream.size() * sizeof(uint32_t) : chunk.raw_bytes;
+
+    std::lock_guard<std::mutex> guard(lock);
+    // Keep chunks 8-byte aligned so compressed streams can be decoded in place from the mapping
+    static const char padding[8] = {};
+    size_t pad = (size_t)((8 - offset % 8) % 8);
+    chunk.offset = offset + pad;
+    if (fwrite(padding, 1, pad, file) != pad || fwrite(stored, 1, (size_t)chunk.stored_bytes, file) != chunk.stored_bytes) {
+        std::cout << "Failed to write snapshot chunk." << std::endl;
+        return false;
+    }
+    offset = chunk.offset + chunk.stored_bytes;
+    arrays[array].chunks[info.chunk_index(channel, tile)] = chunk;
+    return true;
+}
+
+bool Snapshot_Writer::write_array(int array, const void* data, size_t threads)
+{
+    Snapshot_Array_Info info;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (array < 0 || array >= (int)arrays.size())
+            return false;
+        info.element_size = arrays[array].element_size;
+        info.channels = arrays[array].channels;
+        info.height = arrays[array].height;
+        info.width = arrays[array].width;
+        info.tile_height = arrays[array].tile_height;
+    }
+
+    const size_t tiles = info.tiles_per_channel();
+    const size_t row_bytes = info.width * info.element_size;
+    std::atomic<bool> ok(true);
+    parallel_for(info.channels * tiles, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            size_t channel = i / tiles;
+            size_t tile = i % tiles;
+            const unsigned char* src = (const unsigned char*)data + (channel * info.height + tile * info.tile_height) * row_bytes;
+            if (!write_chunk(array, channel, tile, src))
+                ok = false;
+        }
+    }, threads);
+    return ok;
+}
+
+bool Snapshot_Writer::close()
+{
+    if (file == nullptr)
+        return false;
+
+    std::string index;
+    for (const Snapshot_Array_Info& info : arrays) {
+        put_u32(index, (uint32_t)info.name.size());
+        index += info.name;
+        put_u32(index, info.format);
+        put_u32(index, (uint32_t)info.element_size);
+        put_u64(index, info.channels);
+        put_u64(index, info.height);
+        put_u64(index, info.width);
+        put_u64(index, info.tile_height);
+        for (const Snapshot_Chunk& chunk : info.chunks) {
+            put_u64(index, chunk.offset);
+            put_u64(index, chunk.stored_bytes);
+            put_u64(index, chunk.raw_bytes);
+            put_u32(index, chunk.codec);
+            put_u32(index, chunk.crc);
+        }
+    }
+    bool ok = fwrite(index.data(), 1, index.size(), file) == index.size();
+
+    std::string header(snapshot_magic, sizeof(snapshot_magic));
+    put_u32(header, snapshot_version);
+    put_u32(header, (uint32_t)arrays.size());
+    put_u64(header, offset);
+    put_u64(header, index.size());
+    put_u32(header, crc32(index.data(), index.size()));
+    put_u32(header, 0);
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(header.data(), 1, header.size(), file) == header.size();
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    if (!ok)
+        std::cout << "Failed to finalize snapshot." << std::endl;
+    return ok;
+}
+
+bool Snapshot_Reader::open(const char* path)
+{
+    release();
+    if (!file.open_read(path))
+        return false;
+
+    Snapshot_Cursor header = { file.data, file.data + file.size };
+    if (file.size < snapshot_header_bytes || memcmp(file.data, snapshot_magic, sizeof(snapshot_magic)) != 0) {
+        std::cout << "Not a snapshot file: " << path << std::endl;
+        release();
+        return false;
+    }
+    header.p += sizeof(snapshot_magic);
+    uint32_t version = header.get<uint32_t>();
+    uint32_t count = header.get<uint32_t>();
+    uint64_t index_offset = header.get<uint64_t>();
+    uint64_t index_bytes = header.get<uint64_t>();
+    uint32_t index_crc = header.get<uint32_t>();
+    if (version != snapshot_version || index_offset + index_bytes > file.size ||
+        crc32(file.data + index_offset, (size_t)index_bytes) != index_crc) {
+        std::cout << "Snapshot index is corrupt or from an unsupported version: " << path << std::endl;
+        release();
+        return false;
+    }
+
+    Snapshot_Cursor cursor = { file.data + index_offset, file.data + index_offset + index_bytes };
+    for (uint32_t a = 0; a < count && cursor.ok; a++) {
+        Snapshot_Array_Info info;
+        uint32_t name_bytes = cursor.get<uint32_t>();
+        if (cursor.p + name_bytes > cursor.end)
+            break;
+        info.name.assign((const char*)cursor.p, name_bytes);
+        cursor.p += name_bytes;
+        info.format = cursor.get<uint32_t>();
+        info.element_size = cursor.get<uint32_t>();
+        info.channels = (size_t)cursor.get<uint64_t>();
+        info.height = (size_t)cursor.get<uint64_t>();
+        info.width = (size_t)cursor.get<uint64_t>();
+        info.tile_height = (size_t)cursor.get<uint64_t>();
+        if (!cursor.ok || info.tile_height == 0)
+            break;
+        info.chunks.resize(info.channels * info.tiles_per_channel());
+        for (Snapshot_Chunk& chunk : info.chunks) {
+            chunk.offset = cursor.get<uint64_t>();
+            chunk.stored_bytes = cursor.get<uint64_t>();
+            chunk.raw_bytes = cursor.get<uint64_t>();
+            chunk.codec = cursor.get<uint32_t>();
+            chunk.crc = cursor.get<uint32_t>();
+        }
+        arrays.push_back(info);
+    }
+
+    if (!cursor.ok || arrays.size() != count) {
+        std::cout << "Snapshot index is truncated: " << path << std::endl;
+        release();
+        return false;
+    }
+    return true;
+}
+
+int Snapshot_Reader::find(const char* name) const
+{
+    for (size_t i = 0; i < arrays.size(); i++)
+        if (arrays[i].name == name)
+            return (int)i;
+    return -1;
+}
+
+bool Snapshot_Reader::read_chunk(int array, size_t channel, size_t tile, void* dst) const
+{
+    if (array < 0 || array >= (int)arrays.size()) {
+        std::cout << "Cannot read snapshot chunk, invalid array." << std::endl;
+        return false;
+    }
+    const Snapshot_Array_Info& info = arrays[array];
+    if (channel >= info.channels || tile >= info.tiles_per_channel()) {
+        std::cout << "Cannot read snapshot chunk, channel or tile out of range." << std::endl;
+        return false;
+    }
+
+    const Snapshot_Chunk& chunk = info.chunks[info.chunk_index(channel, tile)];
+    if (chunk.raw_bytes != info.tile_rows(tile) * info.width * info.element_size || chunk.offset + chunk.stored_bytes > file.size) {
+        std::cout << "Snapshot chunk " << channel << "/" << tile << " of " << info.name << " is missing or truncated." << std::endl;
+        return false;
+    }
+
+    const unsigned char* src = file.data + chunk.offset;
+    if (chunk.codec == 1) {
+        Delta_Codec codec;
+        codec.word_bits = info.element_size * 8;
+        codec.threads = 1;
+        if (!codec.decode((const uint32_t*)src, (size_t)chunk.stored_bytes / sizeof(uint32_t), (size_t)chunk.raw_bytes / info.element_size, dst))
+            return false;
+    }
+    else
+        memcpy(dst, src, (size_t)chunk.raw_bytes);
+
+    if (crc32(dst, (size_t)chunk.raw_bytes) != chunk.crc) {
+        std::cout << "Snapshot chunk " << channel << "/" << tile << " of " << info.name << " failed its checksum." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Snapshot_Reader::read_channel(int array, size_t channel, void* dst) const
+{
+    if (array < 0 || array >= (int)arrays.size())
+        return false;
+
+    const Snapshot_Array_Info& info = arrays[array];
+    for (size_t tile = 0; tile < info.tiles_per_channel(); tile++)
+        if (!read_chunk(array, channel, tile, (unsigned char*)dst + tile * info.tile_height * info.width * info.element_size))
+            return false;
+    return true;
+}
+
+bool Snapshot_Reader::read_array(int array, void* dst, size_t threads) const
+{
+    if (array < 0 || array >= (int)arrays.size())
+        return false;
+
+    const Snapshot_Array_Info& info = arrays[array];
+    const size_t tiles = info.tiles_per_channel();
+    const size_t row_bytes = info.width * info.element_size;
+    std::atomic<bool> ok(true);
+    parallel_for(info.channels * tiles, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            size_t channel = i / tiles;
+            size_t tile = i % tiles;
+            if (!read_chunk(array, channel, tile, (unsigned char*)dst + (channel * info.height + tile * info.tile_height) * row_bytes))
+                ok = false;
+        }
+    }, threads);
+    return ok;
+}
+
+void Snapshot_Reader::release()
+{
+    file.release();
+    arrays.clear();
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mutex>
+#include "mapped_file.h"
+
+/*
+ * Chunked, indexed checkpoint container for many arrays of mixed formats.
+ * Each (channel, row band) of an array is an independent chunk, optionally
+ * Delta_Codec compressed and CRC32 checked, so a single channel or tile can be
+ * restored without reading the rest of the file. Host-only, no D3D dependency.
+ *
+ * File layout (little-endian):
+ *   header   "TABSNAP1", u32 version, u32 array count, u64 index offset, u64 index bytes, u32 index crc, u32 pad
+ *   chunks   in the order they were written (possibly by several threads)
+ *   index    per array: u32 name length, name, u32 format, u32 element size, u64 channels, height, width, tile height,
+ *            then per chunk (channel major): u64 offset, u64 stored bytes, u64 raw bytes, u32 codec, u32 crc
+ */
+struct Snapshot_Chunk
+{
+    uint64_t offset = 0;
+    uint64_t stored_bytes = 0;
+    uint64_t raw_bytes = 0;
+    uint32_t codec = 0;         // 0 = raw, 1 = Delta_Codec
+    uint32_t crc = 0;           // CRC32 of the raw bytes
+};
+
+struct Snapshot_Array_Info
+{
+    std::string name;
+    uint32_t format = 0;        // DXGI_FORMAT value, stored as a plain number
+    size_t element_size = 0;
+    size_t channels = 0;
+    size_t height = 0;
+    size_t width = 0;
+    size_t tile_height = 0;     // Rows per chunk
+    std::vector<Snapshot_Chunk> chunks;
+
+    size_t tiles_per_channel() const
+    {
+        return (height + tile_height - 1) / tile_height;
+    }
+    size_t chunk_index(size_t channel, size_t tile) const
+    {
+        return channel * tiles_per_channel() + tile;
+    }
+    // Rows covered by a tile (the last one may be short)
+    size_t tile_rows(size_t tile) const
+    {
+        return tile * tile_height + tile_height <= height ? tile_height : height - tile * tile_height;
+    }
+};
+
+struct Snapshot_Writer
+{
+    bool compress = true;
+
+    bool open(const char* path);
+    // Register an array; tile_height = 0 stores one chunk per channel. Returns the array id or -1
+    int add_array(const char* name, uint32_t format, size_t element_size, size_t channels, size_t height, size_t width, size_t tile_height = 0);
+    // Write one dense chunk (tile_rows x width elements). Thread-safe, encoding runs outside the file lock
+    bool write_chunk(int array, size_t channel, size_t tile, const void* data);
+    // Write a dense CHW array, chunks encoded on `threads` threads (0 = hardware concurrency)
+    bool write_array(int array, const void* data, size_t threads = 0);
+    // Write the index and patch the header; the file is unusable until closed
+    bool close();
+    ~Snapshot_Writer()
+    {
+        if (file)
+            close();
+    }
+private:
+    FILE* file = nullptr;
+    uint64_t offset = 0;
+    std::vector<Snapshot_Array_Info> arrays;
+    std::mutex lock;
+};
+
+struct Snapshot_Reader
+{
+    // Map the file and read the index only
+    bool open(const char* path);
+    size_t array_count() const
+    {
+        return arrays.size();
+    }
+    const Snapshot_Array_Info& info(int array) const
+    {
+        return arrays[array];
+    }
+    // Array id by name or -1
+    int find(const char* name) const;
+    // Read and verify one dense chunk (tile_rows x width elements)
+    bool read_chunk(int array, size_t channel, size_t tile, void* dst) const;
+    // Read one dense channel (height x width elements)
+    bool read_channel(int array, size_t channel, void* dst) const;
+    // Read a dense CHW array, chunks decoded on `threads` threads (0 = hardware concurrency)
+    bool read_array(int array, void* dst, size_t threads = 0) const;
+    void release();
+private:
+    Mapped_File file;
+    std::vector<Snapshot_Array_Info> arrays;
+};
+
+uint32_t crc32(const void* data, size_t bytes, uint32_t crc = 0);
@@ -0,0 +1,147 @@
+#include "sparse_page_table.h"
+#include <iostream>
+#include <cstring>
+
+bool Sparse_Page_Table::init(size_t channels, size_t height, size_t width, size_t __page_height, size_t __page_width, size_t capacity)
+{
+    slots.clear();
+    free_slots.clear();
+    changes.clear();
+    is_changed.clear();
+    m_capacity = 0;
+    if (!layout.init(channels, height, width, 1, __page_height, __page_width)) {
+        std::cout << "Failed to init page table, shape and page size must be non-zero." << std::endl;
+        return false;
+    }
+    page_height = __page_height;
+    page_width = __page_width;
+    m_capacity = capacity;
+    slots.assign(layout.tile_count(), (uint32_t)not_resident);
+    is_changed.assign(layout.tile_count(), false);
+    free_slots.resize(capacity);
+    for (size_t i = 0; i < capacity; i++)
+        free_slots[i] = (uint32_t)(capacity - 1 - i);
+    return true;
+}
+
+void Sparse_Page_Table::changed(size_t page)
+{
+    if (!is_changed[page]) {
+        is_changed[page] = true;
+        changes.push_back(page);
+    }
+}
+
+bool Sparse_Page_Table::map(size_t page)
+{
+    if (slots[page] != not_resident)
+        return true;
+    if (free_slots.empty())
+        return false;
+    slots[page] = free_slots.back();
+    free_slots.pop_back();
+    changed(page);
+    return true;
+}
+
+void Sparse_Page_Table::unmap(size_t page)
+{
+    if (slots[page] == not_resident)
+        return;
+    free_slots.push_back(slots[page]);
+    slots[page] = not_resident;
+    changed(page);
+}
+
+bool Sparse_Page_Table::map_region(size_t c0, size_t h0, size_t w0, size_t channels, size_t height, size_t width)
+{
+    if (channels * height * width == 0)
+        return true;
+    const size_t th0 = h0 / layout.tile_height, th1 = (h0 + height - 1) / layout.tile_height;
+    const size_t tw0 = w0 / layout.tile_width, tw1 = (w0 + width - 1) / layout.tile_width;
+    for (size_t c = c0; c < c0 + channels; c++)
+        for (size_t th = th0; th <= th1; th++)
+            for (size_t tw = tw0; tw <= tw1; tw++)
+                if (!map(layout.tile_index(c, th, tw)))
+                    return false;
+    return true;
+}
+
+void Sparse_Page_Table::unmap_channel(size_t c)
+{
+    for (size_t th = 0; th < layout.tiles_h; th++)
+        for (size_t tw = 0; tw < layout.tiles_w; tw++)
+            unmap(layout.tile_index(c, th, tw));
+}
+
+bool Sparse_Page_Table::map_nonzero(const void* dense, size_t element_size)
+{
+    const unsigned char* src = (const unsigned char*)dense;
+    std::vector<bool> wanted(page_count(), false);
+    size_t needed = 0;
+    for (size_t page = 0; page < page_count(); page++) {
+        Tile_Extent ext = layout.extent(page);
+        const size_t row_bytes = ext.width * element_size;
+        for (size_t h = 0; h < ext.height && !wanted[page]; h++) {
+            const unsigned char* row = src + layout.host_offset(ext, element_size) + h * layout.width * element_size;
+            // Word-at-a-time scan for the common all-zero row
+            size_t i = 0;
+            for (; i + 8 <= row_bytes; i += 8) {
+                uint64_t v;
+                memcpy(&v, row + i, 8);
+                if (v != 0)
+                    break;
+            }
+            for (; i < row_bytes && row[i] == 0; i++) {}
+            wanted[page] = i < row_bytes;
+        }
+        needed += wanted[page];
+    }
+    if (needed > m_capacity) {
+        std::cout << "Failed to map " << needed << " non-zero pages into a pool of " << m_capacity << "." << std::endl;
+        return false;
+    }
+    // Unmap first so freed slots are available to the pages mapped next
+    for (size_t page = 0; page < page_count(); page++)
+        if (!wanted[page])
+            unmap(page);
+    for (size_t page = 0; page < page_count(); page++)
+        if (wanted[page])
+            map(page);
+    return true;
+}
+
+std::vector<size_t> Sparse_Page_Table::take_changes()
+{
+    std::vector<size_t> out;
+    out.swap(changes);
+    for (size_t page : out)
+        is_changed[page] = false;
+    return out;
+}
+
+void Sparse_Page_Table::gather_page(const void* dense, size_t page, void* packed, size_t element_size) const
+{
+    Tile_Extent ext = layout.extent(page);
+    const unsigned char* src = (const unsigned char*)dense + layout.host_offset(ext, element_size);
+    unsigned char* dst = (unsigned char*)packed;
+    const size_t row_bytes = ext.width * element_size;
+    const size_t page_row_bytes = page_width * element_size;
+    for (size_t h = 0; h < page_height; h++) {
+        if (h < ext.height) {
+            memcpy(dst + h * page_row_bytes, src + h * layout.width * element_size, row_bytes);
+            memset(dst + h * page_row_bytes + row_bytes, 0, page_row_bytes - row_bytes);
+        }
+        else
+            memset(dst + h * page_row_bytes, 0, page_row_bytes);
+    }
+}
+
+void Sparse_Page_Table::scatter_page(const void* packed, size_t page, void* dense, size_t element_size) const
+{
+    Tile_Extent ext = layout.extent(page);
+    const unsigned char* src = (const unsigned char*)packed;
+    unsigned char* dst = (unsigned char*)dense + layout.host_offset(ext, element_size);
+    for (size_t h = 0; h < ext.height; h++)
+        memcpy(dst + h * layout.width * element_size, src + h * page_width * element_size, ext.width * element_size);
+}
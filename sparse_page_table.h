@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "tile_layout.h"
+
+/*
+ * Residency bookkeeping for sparse (channels, height, width) arrays. The array is
+ * cut into pages of one channel by page_height x page_width (the tiles of a
+ * Tile_Layout with tile_channels = 1); a page is either mapped to one slot of a
+ * fixed pool of physical pages or not resident, in which case it reads as zero.
+ * Memory and transfers scale with the resident pages instead of the full array.
+ *
+ * slots is the page table itself, one uint per page holding its pool slot or
+ * not_resident, laid out page-linear so the device can upload it as-is for shader
+ * indirection. Mapping changes are queued until take_changes(), so the device side
+ * applies them in one batch (one tile-mapping update or one table upload).
+ * Host-only, no D3D dependency (see d3d11_sparse_texture.h for the device side).
+ */
+struct Sparse_Page_Table
+{
+    static const uint32_t not_resident = 0xffffffffu;
+
+    Tile_Layout layout;             // One tile per page
+    size_t page_height = 0;         // Physical page extent; pages on the bottom/right edge use less of it
+    size_t page_width = 0;
+    std::vector<uint32_t> slots;    // Per page, pool slot or not_resident
+
+    bool init(size_t channels, size_t height, size_t width, size_t __page_height, size_t __page_width, size_t capacity);
+    size_t page_count() const
+    {
+        return slots.size();
+    }
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+    size_t resident() const
+    {
+        return m_capacity - free_slots.size();
+    }
+    size_t page_index(size_t c, size_t h, size_t w) const
+    {
+        return layout.locate(c, h, w).tile;
+    }
+
+    // Map page to a free slot (no-op if resident). False if the pool is full.
+    bool map(size_t page);
+    void unmap(size_t page);
+    // Map every page overlapping the block at (c0, h0, w0). False if the pool ran out; pages mapped so far stay.
+    bool map_region(size_t c0, size_t h0, size_t w0, size_t channels, size_t height, size_t width);
+    void unmap_channel(size_t c);
+    // Map exactly the pages of a dense CHW host array holding a non-zero element, unmap the rest.
+    // Returns false if the pool is too small for them.
+    bool map_nonzero(const void* dense, size_t element_size);
+    // Pages whose mapping changed since the last call, each once
+    std::vector<size_t> take_changes();
+
+    size_t page_bytes(size_t element_size) const
+    {
+        return page_height * page_width * element_size;
+    }
+    // Copy page between dense CHW host layout and a packed page_height x page_width page (edge pages zero padded)
+    void gather_page(const void* dense, size_t page, void* packed, size_t element_size) const;
+    void scatter_page(const void* packed, size_t page, void* dense, size_t element_size) const;
+private:
+    void changed(size_t page);
+
+    size_t m_capacity = 0;
+    std::vector<uint32_t> free_slots;   // Popped from the back, lowest slot first
+    std::vector<size_t> changes;
+    std::vector<bool> is_changed;
+};
@@ -0,0 +1,197 @@
+#include "stencil.h"
+#include "host_parallel.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+Stencil_Footprint Stencil_Footprint::box(int radius, Stencil_Boundary boundary)
+{
+    Stencil_Footprint f;
+    f.boundary = boundary;
+    const float weight = 1.0f / (float)((2 * radius + 1) * (2 * radius + 1));
+    for (int dy = -radius; dy <= radius; dy++)
+        for (int dx = -radius; dx <= radius; dx++)
+            f.taps.push_back({ dx, dy, weight });
+    return f;
+}
+
+Stencil_Footprint Stencil_Footprint::cross(int radius, Stencil_Boundary boundary)
+{
+    Stencil_Footprint f;
+    f.boundary = boundary;
+    const float weight = 1.0f / (float)(4 * radius + 1);
+    for (int dy = -radius; dy <= radius; dy++)
+        f.taps.push_back({ 0, dy, weight });
+    for (int dx = -radius; dx <= radius; dx++) {
+        if (dx != 0)
+            f.taps.push_back({ dx, 0, weight });
+    }
+    return f;
+}
+
+Stencil_Footprint Stencil_Footprint::quad(Stencil_Boundary boundary)
+{
+    Stencil_Footprint f;
+    f.boundary = boundary;
+    f.taps = { { 0, 0, 1.0f }, { 1, 0, 1.0f }, { 0, 1, 1.0f }, { 1, 1, 1.0f } };
+    return f;
+}
+
+int Stencil_Footprint::reach_left() const
+{
+    int reach = 0;
+    for (const Stencil_Tap& t : taps)
+        reach = -t.dx > reach ? -t.dx : reach;
+    return reach;
+}
+
+int Stencil_Footprint::reach_right() const
+{
+    int reach = 0;
+    for (const Stencil_Tap& t : taps)
+        reach = t.dx > reach ? t.dx : reach;
+    return reach;
+}
+
+int Stencil_Footprint::reach_up() const
+{
+    int reach = 0;
+    for (const Stencil_Tap& t : taps)
+        reach = -t.dy > reach ? -t.dy : reach;
+    return reach;
+}
+
+int Stencil_Footprint::reach_down() const
+{
+    int reach = 0;
+    for (const Stencil_Tap& t : taps)
+        reach = t.dy > reach ? t.dy : reach;
+    return reach;
+}
+
+bool Stencil_Footprint::valid() const
+{
+    return !taps.empty() && reach_left() <= stencil_max_reach && reach_right() <= stencil_max_reach && reach_up() <= stencil_max_reach
+        && reach_down() <= stencil_max_reach;
+}
+
+size_t stencil_shared_bytes(const Stencil_Footprint& footprint, uint32_t tile_x, uint32_t tile_y)
+{
+    const size_t w = tile_x + footprint.reach_left() + footprint.reach_right();
+    const size_t h = tile_y + footprint.reach_up() + footprint.reach_down();
+    return w * h * sizeof(float);
+}
+
+double stencil_fetches_per_output(const Stencil_Footprint& footprint, Stencil_Form form, uint32_t tile_x, uint32_t tile_y)
+{
+    if (form == STENCIL_DIRECT)
+        return (double)footprint.taps.size();
+    return (double)(stencil_shared_bytes(footprint, tile_x, tile_y) / sizeof(float)) / ((double)tile_x * tile_y);
+}
+
+std::vector<std::pair<std::string, std::string>> stencil_defines(const Stencil_Footprint& footprint, Stencil_Form form,
+    uint32_t tile_x, uint32_t tile_y)
+{
+    std::vector<std::pair<std::string, std::string>> defines;
+    if (!footprint.valid() || tile_x == 0 || tile_y == 0 || tile_x * tile_y > 1024
+        || (form == STENCIL_GROUPSHARED && stencil_shared_bytes(footprint, tile_x, tile_y) > stencil_max_shared_bytes))
+        return defines;
+
+    // Weights printed with enough digits to round-trip, so the device applies the host's floats
+    std::string taps;
+    for (const Stencil_Tap& t : footprint.taps) {
+        char tap[64];
+        snprintf(tap, sizeof(tap), "TAP(%d, %d, %.9g) ", t.dx, t.dy, t.weight);
+        taps += tap;
+    }
+    defines.push_back({ "TILE_X", std::to_string(tile_x) });
+    defines.push_back({ "TILE_Y", std::to_string(tile_y) });
+    defines.push_back({ "HALO_LEFT", std::to_string(footprint.reach_left()) });
+    defines.push_back({ "HALO_RIGHT", std::to_string(footprint.reach_right()) });
+    defines.push_back({ "HALO_UP", std::to_string(footprint.reach_up()) });
+    defines.push_back({ "HALO_DOWN", std::to_string(footprint.reach_down()) });
+    defines.push_back({ "STENCIL_BOUNDARY", std::to_string((int)footprint.boundary) });
+    defines.push_back({ "STENCIL_GROUPSHARED", form == STENCIL_GROUPSHARED ? "1" : "0" });
+    defines.push_back({ "STENCIL_TAPS", taps });
+    return defines;
+}
+
+// Index of coordinate i on an axis of n elements under the boundary rule, -1 for a zero read
+static long resolve(long i, long n, Stencil_Boundary boundary)
+{
+    if (i >= 0 && i < n)
+        return i;
+    if (boundary == STENCIL_CLAMP)
+        return i < 0 ? 0 : n - 1;
+    if (boundary == STENCIL_WRAP)
+        return (i % n + n) % n;
+    return -1;
+}
+
+void stencil_reference(const float* src, float* dst, size_t channels, size_t height, size_t width, const Stencil_Footprint& footprint)
+{
+    for (size_t c = 0; c < channels; c++) {
+        const float* plane = src + c * height * width;
+        for (size_t h = 0; h < height; h++)
+            for (size_t w = 0; w < width; w++) {
+                float acc = 0.0f;
+                for (const Stencil_Tap& t : footprint.taps) {
+                    const long y = resolve((long)h + t.dy, (long)height, footprint.boundary);
+                    const long x = resolve((long)w + t.dx, (long)width, footprint.boundary);
+                    acc += t.weight * (y < 0 || x < 0 ? 0.0f : plane[y * width + x]);
+                }
+                dst[(c * height + h) * width + w] = acc;
+            }
+    }
+}
+
+void stencil_blocked(const float* src, float* dst, size_t channels, size_t height, size_t width, const Stencil_Footprint& footprint,
+    size_t block_height, size_t block_width, size_t threads)
+{
+    if (block_height == 0 || block_width == 0)
+        return;
+    const long left = footprint.reach_left(), up = footprint.reach_up();
+    const size_t halo_w = left + footprint.reach_right();
+    const size_t halo_h = up + footprint.reach_down();
+    const size_t blocks_h = (height + block_height - 1) / block_height;
+    const size_t blocks_w = (width + block_width - 1) / block_width;
+
+    parallel_for(channels * blocks_h * blocks_w, [&](size_t begin, size_t end) {
+        // Block plus halo, boundary already resolved, and one output row
+        std::vector<float> local((block_height + halo_h) * (block_width + halo_w));
+        std::vector<float> acc(block_width);
+        for (size_t b = begin; b < end; b++) {
+            const size_t c = b / (blocks_h * blocks_w);
+            const size_t h0 = (b / blocks_w) % blocks_h * block_height;
+            const size_t w0 = b % blocks_w * block_width;
+            const size_t bh = h0 + block_height < height ? block_height : height - h0;
+            const size_t bw = w0 + block_width < width ? block_width : width - w0;
+            const size_t lw = bw + halo_w;
+            const float* plane = src + c * height * width;
+
+            for (size_t ly = 0; ly < bh + halo_h; ly++) {
+                const long y = resolve((long)(h0 + ly) - up, (long)height, footprint.boundary);
+                float* row = local.data() + ly * lw;
+                const long x0 = (long)w0 - left;
+                if (y >= 0 && x0 >= 0 && x0 + (long)lw <= (long)width) {
+                    memcpy(row, plane + y * width + x0, lw * sizeof(float));
+                    continue;
+                }
+                for (size_t lx = 0; lx < lw; lx++) {
+                    const long x = resolve((long)(w0 + lx) - left, (long)width, footprint.boundary);
+                    row[lx] = y < 0 || x < 0 ? 0.0f : plane[y * width + x];
+                }
+            }
+            for (size_t ly = 0; ly < bh; ly++) {
+                std::fill(acc.begin(), acc.begin() + bw, 0.0f);
+                // Tap by tap over the whole row, contiguous loads the compiler can vectorize
+                for (const Stencil_Tap& t : footprint.taps) {
+                    const float* in = local.data() + (ly + up + t.dy) * lw + left + t.dx;
+                    for (size_t x = 0; x < bw; x++)
+                        acc[x] += t.weight * in[x];
+                }
+                memcpy(dst + (c * height + h0 + ly) * width + w0, acc.data(), bw * sizeof(float));
+            }
+        }
+    }, threads);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Stencil kernels from a declared footprint: a list of taps (dx, dy, weight) summed
+ * around every element of each channel, with a boundary rule for taps that fall off
+ * the array. shaders/stencil.hlsl is the template; stencil_defines() turns a footprint
+ * into its defines, with the taps unrolled. Two forms:
+ *  - Direct: every thread fetches each of its taps from the texture, so neighbouring
+ *    threads fetch overlapping texels again (taps fetches per output).
+ *  - Groupshared: the group loads its tile plus the halo the footprint reaches into
+ *    groupshared memory once, cooperatively, and serves every tap from there
+ *    ((tile + halo) / tile fetches per output).
+ * The CPU side mirrors the tiled form: stencil_blocked() copies a block plus halo into
+ * a small buffer that stays in cache and runs the taps over whole rows of it.
+ * Host-only, no D3D dependency (see d3d11_stencil.h for the device side).
+ */
+struct Stencil_Tap
+{
+    int dx;
+    int dy;
+    float weight;
+};
+
+enum Stencil_Boundary
+{
+    STENCIL_CLAMP,      // Off-array taps read the nearest edge element
+    STENCIL_WRAP,       // Periodic
+    STENCIL_ZERO        // Off-array taps read zero
+};
+
+enum Stencil_Form
+{
+    STENCIL_DIRECT,
+    STENCIL_GROUPSHARED
+};
+
+// Largest offset a tap may have in any direction
+static const int stencil_max_reach = 16;
+// D3D11 groupshared limit per group
+static const size_t stencil_max_shared_bytes = 32768;
+
+struct Stencil_Footprint
+{
+    std::vector<Stencil_Tap> taps;
+    Stencil_Boundary boundary = STENCIL_CLAMP;
+
+    // (2 * radius + 1)^2 box average
+    static Stencil_Footprint box(int radius, Stencil_Boundary boundary = STENCIL_CLAMP);
+    // Centre and the 4 * radius elements along the axes, equal weights summing to 1
+    static Stencil_Footprint cross(int radius, Stencil_Boundary boundary = STENCIL_CLAMP);
+    // 2x2 sum of an element and its right, lower and lower-right neighbours, the read kernel's taps
+    static Stencil_Footprint quad(Stencil_Boundary boundary = STENCIL_WRAP);
+
+    // How far taps reach left, right, up and down (the halo), 0 if none do
+    int reach_left() const;
+    int reach_right() const;
+    int reach_up() const;
+    int reach_down() const;
+    // Non-empty, taps within stencil_max_reach
+    bool valid() const;
+};
+
+// Bytes of groupshared memory the tiled form needs for a tile_x x tile_y group
+size_t stencil_shared_bytes(const Stencil_Footprint& footprint, uint32_t tile_x, uint32_t tile_y);
+// Texels each form fetches from memory per output element, interior groups
+double stencil_fetches_per_output(const Stencil_Footprint& footprint, Stencil_Form form, uint32_t tile_x, uint32_t tile_y);
+// Defines for shaders/stencil.hlsl; empty if the footprint is invalid or the tile does not fit groupshared memory
+std::vector<std::pair<std::string, std::string>> stencil_defines(const Stencil_Footprint& footprint, Stencil_Form form,
+    uint32_t tile_x, uint32_t tile_y);
+
+// dst = footprint applied to src, both dense CHW float arrays; one element at a time
+void stencil_reference(const float* src, float* dst, size_t channels, size_t height, size_t width, const Stencil_Footprint& footprint);
+// Same result computed per block_height x block_width block (plus halo) on up to threads threads (0 = all cores)
+void stencil_blocked(const float* src, float* dst, size_t channels, size_t height, size_t width, const Stencil_Footprint& footprint,
+    size_t block_height = 32, size_t block_width = 256, size_t threads = 0);
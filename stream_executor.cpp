@@ -0,0 +1,270 @@
+#include "stream_executor.h"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <vector>
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// The stages meet here after every step, so a slot is never in two stages at once
+class Step_Barrier
+{
+public:
+    explicit Step_Barrier(size_t __count) : m_count(__count) {}
+
+    void arrive_and_wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const size_t generation = m_generation;
+        if (++m_arrived == m_count) {
+            m_arrived = 0;
+            m_generation++;
+            m_stepped.notify_all();
+            return;
+        }
+        m_stepped.wait(lock, [&]() { return m_generation != generation; });
+    }
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_stepped;
+    size_t m_count = 0;
+    size_t m_arrived = 0;
+    size_t m_generation = 0;
+};
+
+size_t Stream_Backend::slot_bytes(const Tile_Extent& max_in, const Tile_Extent& max_out, size_t in_element_size, size_t out_element_size) const
+{
+    return max_in.channels * max_in.height * max_in.width * in_element_size + max_out.channels * max_out.height * max_out.width * out_element_size;
+}
+
+size_t Stream_Executor::slot_bytes(size_t tile_channels, size_t tile_height, size_t tile_width) const
+{
+    Tile_Extent out;
+    out.channels = tile_channels;
+    out.height = tile_height;
+    out.width = tile_width;
+    Tile_Extent in = out;
+    in.height = tile_height + footprint.halo_top + footprint.halo_bottom;
+    in.width = tile_width + footprint.halo_left + footprint.halo_right;
+    in.height = in.height < height ? in.height : height;
+    in.width = in.width < width ? in.width : width;
+    if (sizing_backend)
+        return sizing_backend->slot_bytes(in, out, in_element_size, out_element_size);
+    return in.channels * in.height * in.width * in_element_size + out.channels * out.height * out.width * out_element_size;
+}
+
+bool Stream_Executor::init(size_t __channels, size_t __height, size_t __width, size_t __in_element_size, size_t __out_element_size,
+    const Stream_Footprint& __footprint, size_t memory_cap, const Stream_Backend* __backend)
+{
+    sizing_backend = __backend;
+    channels = __channels;
+    height = __height;
+    width = __width;
+    in_element_size = __in_element_size;
+    out_element_size = __out_element_size;
+    footprint = __footprint;
+
+    if (channels * height * width * in_element_size * out_element_size == 0) {
+        std::cout << "Failed to initialize stream. Shape and element sizes must be non-zero." << std::endl;
+        return false;
+    }
+
+    // Shrink channels, then width, and take as many rows as fit in the cap
+    for (size_t tile_channels = channels; tile_channels > 0; tile_channels /= 2)
+        for (size_t tile_width = width; tile_width > 0; tile_width /= 2) {
+            size_t tile_height = 0;
+            while (tile_height < height && slot_count * slot_bytes(tile_channels, tile_height + 1, tile_width) <= memory_cap)
+                tile_height++;
+            if (tile_height > 0) {
+                layout.init(channels, height, width, tile_channels, tile_height, tile_width);
+                return true;
+            }
+        }
+
+    std::cout << "Failed to initialize stream. Memory cap of " << memory_cap << " bytes is too small for a single texel tile." << std::endl;
+    return false;
+}
+
+Stream_Tile Stream_Executor::tile(size_t index) const
+{
+    Stream_Tile t;
+    t.index = index;
+    t.out = layout.extent(index);
+    t.in = t.out;
+
+    size_t h0 = t.out.h0 > footprint.halo_top ? t.out.h0 - footprint.halo_top : 0;
+    size_t h1 = t.out.h0 + t.out.height + footprint.halo_bottom;
+    size_t w0 = t.out.w0 > footprint.halo_left ? t.out.w0 - footprint.halo_left : 0;
+    size_t w1 = t.out.w0 + t.out.width + footprint.halo_right;
+    h1 = h1 < height ? h1 : height;
+    w1 = w1 < width ? w1 : width;
+    t.in.h0 = h0;
+    t.in.w0 = w0;
+    t.in.height = h1 - h0;
+    t.in.width = w1 - w0;
+    return t;
+}
+
+Stream_Stats Stream_Executor::run(Stream_Backend* backend, const void* host_in, void* host_out)
+{
+    Stream_Stats stats;
+    if (layout.tile_count() == 0 || backend == nullptr) {
+        std::cout << "Cannot run stream, init() first." << std::endl;
+        return stats;
+    }
+
+    // Largest tiles are the interior ones, tile 0 has the full size in every axis
+    Tile_Extent max_out = layout.extent(0);
+    Tile_Extent max_in = max_out;
+    max_in.height = max_out.height + footprint.halo_top + footprint.halo_bottom;
+    max_in.width = max_out.width + footprint.halo_left + footprint.halo_right;
+    max_in.height = max_in.height < height ? max_in.height : height;
+    max_in.width = max_in.width < width ? max_in.width : width;
+    if (!backend->init_slots(slot_count, max_in, max_out, in_element_size, out_element_size)) {
+        std::cout << "Cannot run stream, backend failed to allocate slots." << std::endl;
+        return stats;
+    }
+    stats.device_bytes = backend->device_bytes();
+
+    const size_t n = layout.tile_count();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Step s uploads tile s, computes tile s - 1 and reads back tile s - 2
+    auto upload = [&](size_t s) {
+        if (s >= n)
+            return;
+        Stream_Tile t = tile(s);
+        auto t0 = std::chrono::high_resolution_clock::now();
+        backend->upload(s % slot_count, t, host_in);
+        stats.upload_ms += elapsed_ms(t0);
+        stats.bytes_uploaded += t.in.channels * t.in.height * t.in.width * in_element_size;
+    };
+    auto compute = [&](size_t s) {
+        if (s < 1 || s - 1 >= n)
+            return;
+        auto t0 = std::chrono::high_resolution_clock::now();
+        backend->compute((s - 1) % slot_count, tile(s - 1));
+        stats.compute_ms += elapsed_ms(t0);
+    };
+    auto readback = [&](size_t s) {
+        if (s < 2)
+            return;
+        Stream_Tile t = tile(s - 2);
+        auto t0 = std::chrono::high_resolution_clock::now();
+        backend->readback((s - 2) % slot_count, t, host_out);
+        stats.readback_ms += elapsed_ms(t0);
+        stats.bytes_readback += t.out.channels * t.out.height * t.out.width * out_element_size;
+    };
+
+    const bool concurrent = backend->concurrent_stages();
+    Step_Barrier steps(3);
+    std::vector<std::thread> stage_threads;
+    if (concurrent) {
+        const std::function<void(size_t)> stages[2] = { upload, readback };
+        for (const std::function<void(size_t)>& stage : stages)
+            stage_threads.emplace_back([&steps, stage, n]() {
+                for (size_t s = 0; s < n + 2; s++) {
+                    stage(s);
+                    steps.arrive_and_wait();
+                }
+            });
+    }
+    for (size_t s = 0; s < n + 2; s++) {
+        if (concurrent) {
+            compute(s);
+            steps.arrive_and_wait();
+        }
+        else {
+            // Single device context: issue in order, the backend overlaps through its queue
+            upload(s);
+            compute(s);
+            readback(s);
+        }
+    }
+    for (std::thread& t : stage_threads)
+        t.join();
+
+    stats.wall_ms = elapsed_ms(start);
+    stats.tiles = n;
+    backend->release();
+    return stats;
+}
+
+void copy_region_to_block(const void* array, size_t height, size_t width, size_t element_size, const Tile_Extent& region, void* block)
+{
+    const size_t row_bytes = region.width * element_size;
+    for (size_t c_idx = 0; c_idx < region.channels; c_idx++)
+        for (size_t h_idx = 0; h_idx < region.height; h_idx++)
+            memcpy((unsigned char*)block + (c_idx * region.height + h_idx) * row_bytes,
+                (const unsigned char*)array + (((region.c0 + c_idx) * height + region.h0 + h_idx) * width + region.w0) * element_size, row_bytes);
+}
+
+void copy_block_to_region(const void* block, size_t height, size_t width, size_t element_size, const Tile_Extent& region, void* array)
+{
+    const size_t row_bytes = region.width * element_size;
+    for (size_t c_idx = 0; c_idx < region.channels; c_idx++)
+        for (size_t h_idx = 0; h_idx < region.height; h_idx++)
+            memcpy((unsigned char*)array + (((region.c0 + c_idx) * height + region.h0 + h_idx) * width + region.w0) * element_size,
+                (const unsigned char*)block + (c_idx * region.height + h_idx) * row_bytes, row_bytes);
+}
+
+void Host_Stream_Backend::init(Kernel __kernel, size_t __logical_height, size_t __logical_width)
+{
+    kernel = __kernel;
+    logical_height = __logical_height;
+    logical_width = __logical_width;
+}
+
+bool Host_Stream_Backend::init_slots(size_t slot_count, const Tile_Extent& max_in, const Tile_Extent& max_out, size_t in_element_size, size_t out_element_size)
+{
+    release();
+    n_slots = slot_count;
+    in_es = in_element_size;
+    out_es = out_element_size;
+    in_slots = new unsigned char*[n_slots];
+    out_slots = new unsigned char*[n_slots];
+    for (size_t i = 0; i < n_slots; i++) {
+        in_slots[i] = new unsigned char[max_in.channels * max_in.height * max_in.width * in_es];
+        out_slots[i] = new unsigned char[max_out.channels * max_out.height * max_out.width * out_es];
+        allocated_bytes += max_in.channels * max_in.height * max_in.width * in_es + max_out.channels * max_out.height * max_out.width * out_es;
+    }
+    return true;
+}
+
+void Host_Stream_Backend::upload(size_t slot, const Stream_Tile& tile, const void* host_in)
+{
+    copy_region_to_block(host_in, logical_height, logical_width, in_es, tile.in, in_slots[slot]);
+}
+
+void Host_Stream_Backend::compute(size_t slot, const Stream_Tile& tile)
+{
+    kernel(tile, in_slots[slot], out_slots[slot]);
+}
+
+void Host_Stream_Backend::readback(size_t slot, const Stream_Tile& tile, void* host_out)
+{
+    copy_block_to_region(out_slots[slot], logical_height, logical_width, out_es, tile.out, host_out);
+}
+
+void Host_Stream_Backend::release()
+{
+    for (size_t i = 0; i < n_slots; i++) {
+        delete[] in_slots[i];
+        delete[] out_slots[i];
+    }
+    if (in_slots)
+        delete[] in_slots;
+    if (out_slots)
+        delete[] out_slots;
+
+    in_slots = nullptr;
+    out_slots = nullptr;
+    n_slots = 0;
+    allocated_bytes = 0;
+}
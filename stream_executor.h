@@ -0,0 +1,145 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include "tile_layout.h"
+
+/*
+ * Out-of-core streaming over a logical (channels, height, width) array that
+ * does not fit in device memory. The output is walked in tiles; each tile reads
+ * an input region grown by the kernel's halo (clamped at the array border).
+ * Upload of tile N+1, compute of tile N and readback of tile N-1 are in flight
+ * together, so only three tile slots are ever resident on the device. With a
+ * backend whose stages may run concurrently, upload and readback each get one
+ * thread for the whole run, meeting the compute stage after every step.
+ * Host-only, no D3D dependency (see d3d11_stream_backend.h for the device side).
+ */
+
+// Extra input rows/columns a kernel reads around each output texel,
+// e.g. taps at (h, w), (h, w + 1), (h + 1, w), (h + 1, w + 1) need halo_bottom = halo_right = 1
+struct Stream_Footprint
+{
+    size_t halo_top = 0;
+    size_t halo_bottom = 0;
+    size_t halo_left = 0;
+    size_t halo_right = 0;
+};
+
+struct Stream_Tile
+{
+    size_t index = 0;
+    Tile_Extent out;    // Output region written by this tile
+    Tile_Extent in;     // Input region read by this tile (out + halo, clamped)
+};
+
+struct Stream_Stats
+{
+    size_t tiles = 0;
+    size_t bytes_uploaded = 0;
+    size_t bytes_readback = 0;
+    size_t device_bytes = 0;    // Bytes held by the resident slots
+    double upload_ms = 0.0;     // Time spent inside each stage, summed over tiles
+    double compute_ms = 0.0;
+    double readback_ms = 0.0;
+    double wall_ms = 0.0;
+
+    // Wall time of a perfectly overlapped pipeline, i.e. the slowest stage
+    double bound_ms() const
+    {
+        double b = upload_ms > compute_ms ? upload_ms : compute_ms;
+        return b > readback_ms ? b : readback_ms;
+    }
+};
+
+/*
+ * Device side of the stream. Slots are reused round-robin; stage calls for
+ * different slots may run concurrently when concurrent_stages() is true.
+ */
+struct Stream_Backend
+{
+    virtual ~Stream_Backend() {}
+    // Allocate slot_count slots able to hold the largest input and output tile
+    virtual bool init_slots(size_t slot_count, const Tile_Extent& max_in, const Tile_Extent& max_out, size_t in_element_size, size_t out_element_size) = 0;
+    // Copy tile.in from the dense logical host input into a slot
+    virtual void upload(size_t slot, const Stream_Tile& tile, const void* host_in) = 0;
+    // Run the kernel on a resident slot
+    virtual void compute(size_t slot, const Stream_Tile& tile) = 0;
+    // Copy tile.out from a slot into the dense logical host output
+    virtual void readback(size_t slot, const Stream_Tile& tile, void* host_out) = 0;
+    // True if upload/compute/readback of different slots may be called from different threads
+    virtual bool concurrent_stages() const = 0;
+    // Bytes one slot holding max_in and max_out tiles costs, staging copies and row padding included;
+    // what the executor sizes tiles against its cap with. Dense tile bytes by default.
+    virtual size_t slot_bytes(const Tile_Extent& max_in, const Tile_Extent& max_out, size_t in_element_size, size_t out_element_size) const;
+    // Bytes currently allocated for slots, staging copies included
+    virtual size_t device_bytes() const = 0;
+    virtual void release() = 0;
+};
+
+struct Stream_Executor
+{
+    static const size_t slot_count = 3;
+
+    size_t channels = 0;
+    size_t height = 0;
+    size_t width = 0;
+    size_t in_element_size = 0;
+    size_t out_element_size = 0;
+    Stream_Footprint footprint;
+    Tile_Layout layout;         // Output tiling
+    const Stream_Backend* sizing_backend = nullptr;    // Prices the slots while sizing tiles, nullptr for dense tile bytes
+
+    // Pick the largest tiles (full width and channels first) whose slots fit in memory_cap bytes as
+    // __backend allocates them; run() should then be given the same backend
+    bool init(size_t __channels, size_t __height, size_t __width, size_t __in_element_size, size_t __out_element_size,
+        const Stream_Footprint& __footprint, size_t memory_cap, const Stream_Backend* __backend = nullptr);
+    // Stream host_in through the backend into host_out (both dense logical CHW)
+    Stream_Stats run(Stream_Backend* backend, const void* host_in, void* host_out);
+
+    size_t tile_count() const
+    {
+        return layout.tile_count();
+    }
+    Stream_Tile tile(size_t index) const;
+    // Device bytes needed by one slot for the given output tile shape
+    size_t slot_bytes(size_t tile_channels, size_t tile_height, size_t tile_width) const;
+};
+
+/*
+ * Host-memory backend: slots are heap buffers standing in for device memory and
+ * compute runs a CPU kernel. kernel(tile, in, out) gets the dense tile.in input
+ * block and writes the dense tile.out output block.
+ */
+struct Host_Stream_Backend : Stream_Backend
+{
+    typedef std::function<void(const Stream_Tile& tile, const void* in, void* out)> Kernel;
+
+    Kernel kernel;
+    size_t logical_height = 0;
+    size_t logical_width = 0;
+
+    void init(Kernel __kernel, size_t __logical_height, size_t __logical_width);
+
+    bool init_slots(size_t slot_count, const Tile_Extent& max_in, const Tile_Extent& max_out, size_t in_element_size, size_t out_element_size) override;
+    void upload(size_t slot, const Stream_Tile& tile, const void* host_in) override;
+    void compute(size_t slot, const Stream_Tile& tile) override;
+    void readback(size_t slot, const Stream_Tile& tile, void* host_out) override;
+    bool concurrent_stages() const override { return true; }
+    size_t device_bytes() const override { return allocated_bytes; }
+    void release() override;
+
+    ~Host_Stream_Backend()
+    {
+        release();
+    }
+private:
+    unsigned char** in_slots = nullptr;
+    unsigned char** out_slots = nullptr;
+    size_t n_slots = 0;
+    size_t in_es = 0;
+    size_t out_es = 0;
+    size_t allocated_bytes = 0;
+};
+
+// Copy a region between a dense logical CHW array and a dense block of the region's shape
+void copy_region_to_block(const void* array, size_t height, size_t width, size_t element_size, const Tile_Extent& region, void* block);
+void copy_block_to_region(const void* block, size_t height, size_t width, size_t element_size, const Tile_Extent& region, void* array);
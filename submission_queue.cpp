@@ -0,0 +1,193 @@
+#include "submission_queue.h"
+#include <cstring>
+#include <iostream>
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+bool Submission_Executor::start(Submission_Backend* backend, size_t capacity, size_t max_batch)
+{
+    stop();
+    if (backend == nullptr || capacity == 0 || max_batch == 0) {
+        std::cout << "Failed to start submission executor. Backend, capacity and batch size must be non-zero." << std::endl;
+        return false;
+    }
+
+    p_backend = backend;
+    m_queue.init(capacity);
+    m_max_batch = max_batch;
+    m_stats = Submission_Stats();
+    m_full_retries = 0;
+    m_stopping = false;
+    m_sleeping = false;
+    m_start_time = std::chrono::high_resolution_clock::now();
+    m_owner = std::thread(&Submission_Executor::owner_loop, this);
+    return true;
+}
+
+bool Submission_Executor::submit(const Submission_Packet& packet)
+{
+    // A push either claims its cell before stop() closes the tail, and the owner drains it, or is refused
+    while (!m_queue.try_push(packet)) {
+        if (m_queue.closed())
+            return false;
+        m_full_retries.fetch_add(1, std::memory_order_relaxed);
+        std::this_thread::yield();
+    }
+    wake();
+    return true;
+}
+
+bool Submission_Executor::try_submit(const Submission_Packet& packet)
+{
+    if (!m_queue.try_push(packet))
+        return false;
+    wake();
+    return true;
+}
+
+std::future<bool> Submission_Executor::submit_future(const Submission_Packet& packet)
+{
+    std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> result = promise->get_future();
+    Submission_Packet p = packet;
+    std::function<void(bool)> inner = packet.on_complete;
+    p.on_complete = [promise, inner](bool ok) {
+        if (inner)
+            inner(ok);
+        promise->set_value(ok);
+    };
+    if (!submit(p))
+        promise->set_value(false);
+    return result;
+}
+
+bool Submission_Executor::drain()
+{
+    Submission_Packet fence;
+    fence.op = SUBMIT_FENCE;
+    return submit_future(fence).get();
+}
+
+Submission_Stats Submission_Executor::stop()
+{
+    if (!m_owner.joinable())
+        return m_stats;
+
+    m_queue.close();
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_owner.join();
+
+    m_stats.full_retries = m_full_retries.load();
+    m_stats.wall_ms = elapsed_ms(m_start_time);
+    p_backend = nullptr;
+    return m_stats;
+}
+
+void Submission_Executor::wake()
+{
+    // Pairs with the fence in idle(): either the owner sees the pushed packet before it sleeps,
+    // or this sees m_sleeping and notifies
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_wake.notify_one();
+    }
+}
+
+void Submission_Executor::idle()
+{
+    // Under load the next packet is usually moments away, so spin a little before paying for a sleep and a wake
+    for (int i = 0; i < 64; i++) {
+        if (!m_queue.empty() || m_stopping.load())
+            return;
+        std::this_thread::yield();
+    }
+    m_sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_queue.empty()) {
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        if (!m_stopping && m_queue.empty()) {
+            m_stats.owner_sleeps++;
+            m_wake.wait(lock, [this]() { return !m_queue.empty() || m_stopping.load(); });
+        }
+    }
+    m_sleeping.store(false, std::memory_order_relaxed);
+}
+
+void Submission_Executor::owner_loop()
+{
+    std::vector<Submission_Packet> batch;
+    batch.reserve(m_max_batch);
+    std::unique_ptr<bool[]> ok(new bool[m_max_batch]);
+    Submission_Packet packet;
+    while (true) {
+        batch.clear();
+        while (batch.size() < m_max_batch && m_queue.try_pop(packet))
+            batch.push_back(std::move(packet));
+        if (batch.empty()) {
+            // Once stopping is set the tail is closed, so the queue only has the cells claimed before that left
+            if (m_stopping.load() && m_queue.drained())
+                break;
+            idle();
+            continue;
+        }
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < batch.size(); i++)
+            ok[i] = false;
+        p_backend->execute(batch.data(), batch.size(), ok.get());
+        for (size_t i = 0; i < batch.size(); i++) {
+            m_stats.failures += ok[i] ? 0 : 1;
+            if (batch[i].on_complete)
+                batch[i].on_complete(ok[i]);
+        }
+        m_stats.busy_ms += elapsed_ms(t0);
+        m_stats.packets += batch.size();
+        m_stats.batches++;
+        m_stats.max_batch = batch.size() > m_stats.max_batch ? batch.size() : m_stats.max_batch;
+    }
+}
+
+void Host_Submission_Backend::init(Kernel __kernel)
+{
+    m_kernel = __kernel;
+    m_calls = 0;
+    m_overlaps = 0;
+}
+
+void Host_Submission_Backend::execute(const Submission_Packet* packets, size_t count, bool* ok)
+{
+    if (m_inside.fetch_add(1) != 0)
+        m_overlaps++;
+    m_calls++;
+    for (size_t i = 0; i < count; i++) {
+        const Submission_Packet& p = packets[i];
+        std::vector<unsigned char>* buffer = (std::vector<unsigned char>*)p.resource;
+        switch (p.op) {
+        case SUBMIT_UPLOAD:
+            ok[i] = buffer != nullptr && p.src != nullptr && p.bytes <= buffer->size();
+            if (ok[i])
+                memcpy(buffer->data(), p.src, p.bytes);
+            break;
+        case SUBMIT_READBACK:
+            ok[i] = buffer != nullptr && p.dst != nullptr && p.bytes <= buffer->size();
+            if (ok[i])
+                memcpy(p.dst, buffer->data(), p.bytes);
+            break;
+        case SUBMIT_DISPATCH:
+            ok[i] = m_kernel ? m_kernel(p) : false;
+            break;
+        default:
+            ok[i] = true;
+            break;
+        }
+    }
+    m_inside--;
+}
@@ -0,0 +1,255 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * One owner thread for a device context that must not be used by two threads at once.
+ * Worker threads do not lock the context; they push work packets (uploads, dispatches,
+ * readbacks) into a bounded lock-free multi-producer single-consumer queue and return.
+ * The owner thread pops whatever has queued up, up to max_batch packets, hands the batch
+ * to the backend in one call and then runs the packets' completions in queue order.
+ * Submitting costs a producer one compare-and-swap on the queue tail and a fence, plus a
+ * notify only when the owner has gone to sleep on an empty queue, so producers never wait
+ * for each other's device work. Whether the executor accepts packets is a bit of the tail
+ * itself, so stopping needs no count of producers in flight.
+ * Host-only, no D3D dependency (see d3d11_submission.h).
+ */
+
+/*
+ * Bounded array queue for many producers and one consumer. Every cell carries a sequence
+ * number saying whose turn it is: producers claim a position with one CAS on the tail,
+ * write the item and publish it by advancing the cell's sequence; the consumer owns the
+ * head outright. try_push() fails when the queue is full. try_pop() fails when it is empty,
+ * or when the producer of the next cell has claimed it but not yet published it (the item
+ * shows up on a later try_pop()). Head and tail sit on separate cache lines. close() sets
+ * the tail's top bit, which fails every later push in the same CAS that claims a cell; the
+ * queue starts closed until init().
+ */
+template<typename T>
+class Mpsc_Queue
+{
+public:
+    // capacity is rounded up to a power of two
+    void init(size_t capacity)
+    {
+        size_t n = 2;
+        while (n < capacity)
+            n <<= 1;
+        m_cells.reset(new Cell[n]);
+        m_mask = n - 1;
+        for (size_t i = 0; i < n; i++)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_head = 0;
+    }
+
+    // Any thread; false when the queue is full or closed
+    bool try_push(const T& item)
+    {
+        size_t pos = m_tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            if (pos & closed_bit)
+                return false;
+            cell = &m_cells[pos & m_mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->item = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only
+    bool try_pop(T& item)
+    {
+        Cell& cell = m_cells[m_head & m_mask];
+        if (cell.sequence.load(std::memory_order_acquire) != m_head + 1)
+            return false;
+        item = std::move(cell.item);
+        cell.item = T();
+        cell.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+        m_head++;
+        return true;
+    }
+
+    // Consumer thread only: nothing published at the head
+    bool empty() const
+    {
+        return m_cells[m_head & m_mask].sequence.load(std::memory_order_acquire) != m_head + 1;
+    }
+
+    // Any thread: fail every later push. Pushes that already claimed a cell still publish it.
+    void close()
+    {
+        m_tail.fetch_or(closed_bit, std::memory_order_acq_rel);
+    }
+    bool closed() const
+    {
+        return (m_tail.load(std::memory_order_acquire) & closed_bit) != 0;
+    }
+    // Consumer thread only, once closed: every cell claimed before close() has been popped
+    bool drained() const
+    {
+        return m_head == (m_tail.load(std::memory_order_acquire) & ~closed_bit);
+    }
+    size_t capacity() const
+    {
+        return m_mask + 1;
+    }
+private:
+    static const size_t closed_bit = (size_t)1 << (sizeof(size_t) * 8 - 1);
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_tail{ closed_bit };
+    alignas(64) size_t m_head = 0;
+};
+
+enum Submission_Op
+{
+    SUBMIT_UPLOAD,      // src -> resource
+    SUBMIT_DISPATCH,    // Run resource (the backend's kernel description) over groups
+    SUBMIT_READBACK,    // resource -> dst
+    SUBMIT_FENCE        // No work, completes once everything queued before it has
+};
+
+// What a resource pointer refers to is up to the backend (a texture, a binding table, ...)
+struct Submission_Packet
+{
+    Submission_Op op = SUBMIT_FENCE;
+    void* resource = nullptr;
+    const void* src = nullptr;
+    void* dst = nullptr;
+    size_t bytes = 0;
+    uint32_t groups[3] = { 1, 1, 1 };
+    // Runs on the owner thread after the packet's batch; keep it short and never wait on the executor from it
+    std::function<void(bool ok)> on_complete;
+};
+
+/*
+ * Device side of the executor. execute() is only ever called from the owner thread, one
+ * batch at a time, and reports each packet's result in ok[i]. Packets of a batch must
+ * take effect in order, but a backend is free to defer waiting on the device until the
+ * end of the batch.
+ */
+struct Submission_Backend
+{
+    virtual ~Submission_Backend() {}
+    virtual void execute(const Submission_Packet* packets, size_t count, bool* ok) = 0;
+};
+
+struct Submission_Stats
+{
+    size_t packets = 0;
+    size_t batches = 0;
+    size_t max_batch = 0;       // Largest batch handed to the backend
+    size_t failures = 0;        // Packets the backend reported failed
+    size_t full_retries = 0;    // Pushes that found the queue full and were retried
+    size_t owner_sleeps = 0;    // Times the owner blocked on an empty queue
+    double busy_ms = 0.0;       // Owner time inside the backend and completions
+    double wall_ms = 0.0;
+
+    double mean_batch() const
+    {
+        return batches ? (double)packets / batches : 0.0;
+    }
+};
+
+class Submission_Executor
+{
+public:
+    // Start the owner thread over backend. capacity bounds the queue (rounded up to a power of two).
+    bool start(Submission_Backend* backend, size_t capacity = 1024, size_t max_batch = 64);
+    // Queue a packet; spins (yielding) while the queue is full. False once stop() has begun.
+    bool submit(const Submission_Packet& packet);
+    // Queue a packet without waiting, false if the queue is full or stopping
+    bool try_submit(const Submission_Packet& packet);
+    // Queue a packet and get its result as a future; packet.on_complete still runs first.
+    // An executor that is not accepting yields a ready future holding false.
+    std::future<bool> submit_future(const Submission_Packet& packet);
+    // Wait until everything queued before the call has completed
+    bool drain();
+    // Stop accepting, run everything already queued and join the owner thread
+    Submission_Stats stop();
+    bool running() const
+    {
+        return !m_queue.closed();
+    }
+
+    ~Submission_Executor()
+    {
+        stop();
+    }
+private:
+    void owner_loop();
+    // Owner: wait for a packet or for stop, spinning briefly before sleeping
+    void idle();
+    // Producer: wake the owner if it is asleep
+    void wake();
+
+    Submission_Backend* p_backend = nullptr;
+    Mpsc_Queue<Submission_Packet> m_queue;
+    size_t m_max_batch = 64;
+    Submission_Stats m_stats;
+    std::chrono::high_resolution_clock::time_point m_start_time;
+    std::thread m_owner;
+
+    std::atomic<bool> m_stopping{ false };
+    std::atomic<size_t> m_full_retries{ 0 };
+    std::atomic<bool> m_sleeping{ false };
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+};
+
+/*
+ * Backend on host memory, for tests and for measuring the executor itself. Resources are
+ * std::vector<unsigned char> buffers: uploads copy packet.bytes from src, readbacks copy
+ * packet.bytes to dst and dispatches call kernel(packet). It counts execute() calls that
+ * overlap another one, which a device context would not survive.
+ */
+struct Host_Submission_Backend : Submission_Backend
+{
+    typedef std::function<bool(const Submission_Packet& packet)> Kernel;
+
+    void init(Kernel __kernel = nullptr);
+    void execute(const Submission_Packet* packets, size_t count, bool* ok) override;
+    size_t calls() const
+    {
+        return m_calls.load();
+    }
+    size_t overlapping_calls() const
+    {
+        return m_overlaps.load();
+    }
+private:
+    Kernel m_kernel;
+    std::atomic<int> m_inside{ 0 };
+    std::atomic<size_t> m_calls{ 0 };
+    std::atomic<size_t> m_overlaps{ 0 };
+};
@@ -1,26 +1,55 @@
 #include "test.h"
+#include "test_host.h"
 #include "texture_as_buffer.h"
 #include "d3d11_helper.h"
+#include "virtual_texture_array.h"
+#include "stream_executor.h"
+#include "d3d11_stream_backend.h"
+#include "compressed_transfer.h"
+#include "mapped_file.h"
+#include "texture_snapshot.h"
+#include "d3d11_pipeline_backend.h"
+#include "d3d11_expr.h"
+#include "d3d11_reduction.h"
+#include "d3d11_scan.h"
+#include "d3d11_constant_ring.h"
+#include "d3d11_binding_table.h"
+#include "d3d11_indirect.h"
+#include "d3d11_sparse_texture.h"
+#include "d3d11_compressed_texture.h"
+#include "d3d11_layout_transform.h"
+#include "d3d11_residency.h"
+#include "metrics.h"
+#include "d3d11_command_stream.h"
+#include "d3d11_benchmark.h"
+#include "d3d11_atlas.h"
+#include "d3d11_stencil.h"
+#include "format_traits.h"
+#include "d3d11_submission.h"
 #include <iostream>
 #include <DirectXPackedVector.h>
 #include <cmath>
 #include <string>
-
-class Texture_As_Buffer_Write_Tester
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+// Per-format part of the write test: the kernel writing element index = (c * height + h) * width + w,
+// the components it should leave there, and how the error is judged: over the compared components the
+// kernel writes, averaged per component (mean) or summed, against tolerance
+template <DXGI_FORMAT Format>
+struct Write_Case;
+
+template <>
+struct Write_Case<DXGI_FORMAT_R8_UNORM>
 {
-public:
-    void init(ID3D11Device* device, DXGI_FORMAT __test_fmt)
-    {   
-        m_device = device;
-        m_width = 503;
-        m_height = 250;
-        size_t channels = 3;
-        m_test_fmt = __test_fmt;
-
-        m_tab.init(device, channels, m_height, m_width, m_test_fmt);
-        m_tab.init_staging(device);
-
-        const char* shader_code_r8_unorm = R"(
+    static constexpr const char* shader = R"(
             RWTexture2DArray<unorm float> out_texture : register(u0);
 
             [numthreads(16, 16, 1)]
@@ -45,8 +74,19 @@ public:
                 }
             }
         )";
+    static constexpr size_t compared = 1;
+    static constexpr bool mean = false;
+    static constexpr float tolerance = 0.0f;
+    static void expected(size_t index, float* out)
+    {
+        out[0] = (float)(index % 256) / 255.0f;
+    }
+};
 
-        const char* shader_code_r8g8b8a8_unorm = R"(
+template <>
+struct Write_Case<DXGI_FORMAT_R8G8B8A8_UNORM>
+{
+    static constexpr const char* shader = R"(
             RWTexture2DArray<unorm float4> out_texture : register(u0);
 
             [numthreads(16, 16, 1)]
@@ -71,8 +111,20 @@ public:
                 }
             }
         )";
+    static constexpr size_t compared = 4;
+    static constexpr bool mean = false;
+    static constexpr float tolerance = 0.0f;
+    static void expected(size_t index, float* out)
+    {
+        for (size_t k = 0; k < 4; k++)
+            out[k] = (float)(index % 252 + k) / 255.0f;
+    }
+};
 
-        const char* shader_code_r32_float = R"(
+template <>
+struct Write_Case<DXGI_FORMAT_R32_FLOAT>
+{
+    static constexpr const char* shader = R"(
             RWTexture2DArray<float> out_texture : register(u0);
 
             [numthreads(16, 16, 1)]
@@ -97,8 +149,19 @@ public:
                 }
             }
         )";
+    static constexpr size_t compared = 1;
+    static constexpr bool mean = false;
+    static constexpr float tolerance = 1e-5f;
+    static void expected(size_t index, float* out)
+    {
+        out[0] = (index % 256) * (1.0f + 1.0f / 255.0f);
+    }
+};
 
-        const char* shader_code_r16_float = R"(
+template <>
+struct Write_Case<DXGI_FORMAT_R16_FLOAT>
+{
+    static constexpr const char* shader = R"(
             RWTexture2DArray<half> out_texture : register(u0);
 
             [numthreads(16, 16, 1)]
@@ -123,8 +186,20 @@ public:
                 }
             }
         )";
+    static constexpr size_t compared = 1;
+    static constexpr bool mean = true;
+    static constexpr float tolerance = 5e-3f;
+    static void expected(size_t index, float* out)
+    {
+        const float value = (index % 256) * (0.1f + 1.0f / 255.0f);
+        out[0] = half_to_float(float_to_half(value));
+    }
+};
 
-        const char* shader_code_r16g16_float = R"(
+template <>
+struct Write_Case<DXGI_FORMAT_R16G16_FLOAT>
+{
+    static constexpr const char* shader = R"(
             RWTexture2DArray<half2> out_texture : register(u0);
 
             [numthreads(16, 16, 1)]
@@ -149,8 +224,20 @@ public:
                 }
             }
         )";
+    static constexpr size_t compared = 2;
+    static constexpr bool mean = true;
+    static constexpr float tolerance = 5e-3f;
+    static void expected(size_t index, float* out)
+    {
+        out[0] = half_to_float(float_to_half((index % 256) * 0.1f));
+        out[1] = half_to_float(float_to_half((index % 256) * 0.05f));
+    }
+};
 
-        const char* shader_code_r10g10b10a2_unorm = R"(
+template <>
+struct Write_Case<DXGI_FORMAT_R10G10B10A2_UNORM>
+{
+    static constexpr const char* shader = R"(
             RWTexture2DArray<unorm float4> out_texture : register(u0);
 
             [numthreads(16, 16, 1)]
@@ -175,31 +262,33 @@ public:
                 }
             }
         )";
+    static constexpr size_t compared = 3;
+    static constexpr bool mean = true;
+    static constexpr float tolerance = 5e-4f;
+    static void expected(size_t index, float* out)
+    {
+        const size_t tmp = index % 256;
+        out[0] = std::min(1.0f, tmp / 255.0f);
+        out[1] = std::min(1.0f, (tmp + 23) / 255.0f);
+        out[2] = std::min(1.0f, (tmp + 53) / 255.0f);
+        out[3] = 0.0f;
+    }
+};
 
-        switch (m_test_fmt)
-        {
-            case DXGI_FORMAT_R32_FLOAT:
-                m_compute_shader.init_from_code_string(device, shader_code_r32_float, "test_main");
-                break;
-            case DXGI_FORMAT_R8_UNORM:
-                m_compute_shader.init_from_code_string(device, shader_code_r8_unorm, "test_main");
-                break;
-            case DXGI_FORMAT_R8G8B8A8_UNORM:
-                m_compute_shader.init_from_code_string(device, shader_code_r8g8b8a8_unorm, "test_main");
-                break;
-            case DXGI_FORMAT_R16_FLOAT:
-                m_compute_shader.init_from_code_string(device, shader_code_r16_float, "test_main");
-                break;
-            case DXGI_FORMAT_R16G16_FLOAT:
-                m_compute_shader.init_from_code_string(device, shader_code_r16g16_float, "test_main");
-                break;
-            case DXGI_FORMAT_R10G10B10A2_UNORM:
-                m_compute_shader.init_from_code_string(device, shader_code_r10g10b10a2_unorm, "test_main");
-                break;
-            default:
-                std::cout << "Undefined test format." << std::endl;
-                break;
-        }       
+template <DXGI_FORMAT Format>
+class Texture_As_Buffer_Write_Tester
+{
+public:
+    void init(ID3D11Device* device)
+    {   
+        m_device = device;
+        m_width = 503;
+        m_height = 250;
+        size_t channels = 3;
+
+        m_tab.init(device, channels, m_height, m_width, Format);
+        m_tab.init_staging(device);
+        m_compute_shader.init_from_code_string(device, Write_Case<Format>::shader, "test_main");
     }
 
     void execute(ID3D11DeviceContext* context)
@@ -219,32 +308,17 @@ public:
 
     void test(ID3D11DeviceContext* context)
     {
-        void *data = m_tab.to_cpu(context);
-       
-        switch (m_test_fmt)
-        {
-        case DXGI_FORMAT_R32_FLOAT:
-            test_r32_float(data);
-            break;
-        case DXGI_FORMAT_R8_UNORM:
-            test_r8_unorm(data);
-            break;
-        case DXGI_FORMAT_R8G8B8A8_UNORM:
-            test_r8g8b8a8_unorm(data);
-            break;
-        case DXGI_FORMAT_R16_FLOAT:
-            test_r16_float(data);
-            break;
-        case DXGI_FORMAT_R16G16_FLOAT:
-            test_r16g16_float(data);
-            break;
-        case DXGI_FORMAT_R10G10B10A2_UNORM:
-            test_r10g10b10a2_unorm(data);
-            break;
-        default:
-            std::cout << "Undefined test format." << std::endl;
-            break;
-        }
+        typedef Write_Case<Format> Case;
+        Format_View<Format> data(m_tab.to_cpu(context), m_tab.channels, m_tab.height, m_tab.width);
+        const Format_Error e = format_verify(data, [&](size_t c, size_t h, size_t w, float* out) {
+            Case::expected((c * m_tab.height + h) * m_tab.width + w, out);
+        }, 0.0f);
+        const double error = Case::mean ? e.sum / (data.size() * Case::compared) : e.sum;
+
+        if (error <= Case::tolerance)
+            std::cout << "Test " << format_traits<Format>::name << " passed!" << std::endl;
+        else
+            std::cout << "Test " << format_traits<Format>::name << " failed! Error: " << error << std::endl;
     }
 
     void release()
@@ -259,195 +333,38 @@ private:
     Texture_As_Buffer m_tab;
     unsigned int m_width = 0;
     unsigned int m_height = 0;
-    DXGI_FORMAT m_test_fmt;
-
-    void test_r8_unorm(const void* data)
-    {   
-        float error = 0;
-        for (UINT c_idx = 0; c_idx < m_tab.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab.width; w_idx++) {
-                    unsigned int input = (unsigned int)((uint8_t*)data)[m_tab.width * m_tab.height * c_idx + m_tab.width * h_idx + w_idx];
-                    unsigned int expected = (c_idx * m_tab.height * m_tab.width + h_idx * m_tab.width + w_idx) % 256;
-                    error += abs((int)input - (int)expected);
-                }
-
-        if (error == 0.0f)
-            std::cout << "Test R8_UNORM passed!" << std::endl;
-        else
-            std::cout << "Test R8_UNORM failed! Error: " << error << std::endl;
-    }
-
-    void test_r8g8b8a8_unorm(const void* data)
-    {   
-        float error = 0;
-        for (UINT c_idx = 0; c_idx < m_tab.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab.width; w_idx++) {
-                    unsigned int input_rpr = ((unsigned int*)data)[m_tab.width * m_tab.height * c_idx + m_tab.width * h_idx + w_idx];
-                    unsigned int expected = (c_idx * m_tab.height * m_tab.width + h_idx * m_tab.width + w_idx) % 252;
-                    unsigned int input_0 = input_rpr & 0xff;
-                    unsigned int input_1 = (input_rpr >> 8) & 0xff;
-                    unsigned int input_2 = (input_rpr >> 16) & 0xff;
-                    unsigned int input_3 = (input_rpr >> 24) & 0xff;
-                    error += abs((int)input_0 - (int)expected);
-                    error += abs((int)input_1 - (int)(expected + 1));
-                    error += abs((int)input_2 - (int)(expected + 2));
-                    error += abs((int)input_3 - (int)(expected + 3));
-                }
-
-        if (error == 0.0f)
-            std::cout << "Test R8G8B8A8_UNORM passed!" << std::endl;
-        else
-            std::cout << "Test R8G8B8A8_UNORM failed! Error: " << error << std::endl;
-    }
-
-    void test_r32_float(const void* data)
-    {
-        float error = 0;
-        for (UINT c_idx = 0; c_idx < m_tab.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab.width; w_idx++) {
-                    float input = ((float *)data)[m_tab.width * m_tab.height * c_idx + m_tab.width * h_idx + w_idx];
-                    float expected = ((c_idx * m_tab.height * m_tab.width + h_idx * m_tab.width + w_idx) % 256) * (1.0f + 1.0f / 255.0f);
-                    error += abs(input - expected);
-                }
-        
-        if (error < 1e-5f)
-            std::cout << "Test R32_FLOAT passed!" << std::endl;
-        else
-            std::cout << "Test R32_FLOAT failed! Error: " << error << std::endl;
-    }
-
-    void test_r16_float(const void* data)
-    {
-        float error = 0;
-        for (UINT c_idx = 0; c_idx < m_tab.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab.width; w_idx++) {
-                    uint16_t input_rpr = ((uint16_t*)data)[m_tab.width * m_tab.height * c_idx + m_tab.width * h_idx + w_idx];
-                    float input = DirectX::PackedVector::XMConvertHalfToFloat(input_rpr);
-                    float expected = DirectX::PackedVector::XMConvertHalfToFloat(DirectX::PackedVector::XMConvertFloatToHalf(((c_idx * m_tab.height * m_tab.width + h_idx * m_tab.width + w_idx) % 256) * (0.1f + 1.0f / 255.0f)));
-                    error += abs(input - expected);
-                }
-        
-        error /= (m_tab.channels * m_tab.height * m_tab.width);
-
-        if (error < 5e-3f)
-            std::cout << "Test R16_FLOAT passed!" << std::endl;
-        else
-            std::cout << "Test R16_FLOAT failed! Error: " << error << std::endl;
-    }
-
-    void test_r16g16_float(const void* data)
-    {
-        float error = 0;
-                
-        struct H2
-        {
-            UINT16 r;
-            UINT16 g;
-        };
-              
-        for (UINT c_idx = 0; c_idx < m_tab.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab.width; w_idx++) {
-                    H2 input_rpr = ((H2 *)data)[m_tab.width * m_tab.height * c_idx + m_tab.width * h_idx + w_idx];
-                    float input_r = DirectX::PackedVector::XMConvertHalfToFloat(input_rpr.r);
-                    float input_g = DirectX::PackedVector::XMConvertHalfToFloat(input_rpr.g);
-                    float expected_f_r = ((c_idx * m_tab.height * m_tab.width + h_idx * m_tab.width + w_idx) % 256) * 0.1f;
-                    float expected_f_g = ((c_idx * m_tab.height * m_tab.width + h_idx * m_tab.width + w_idx) % 256) * 0.05f;
-                    float expected_r = DirectX::PackedVector::XMConvertHalfToFloat(DirectX::PackedVector::XMConvertFloatToHalf(expected_f_r));
-                    float expected_g = DirectX::PackedVector::XMConvertHalfToFloat(DirectX::PackedVector::XMConvertFloatToHalf(expected_f_g));
-                    error += abs(input_r - expected_r);
-                    error += abs(input_g - expected_g);
-                }
-
-        error /= (m_tab.channels * m_tab.height * m_tab.width * 2);
-
-        if (error < 5e-3f)
-            std::cout << "Test R16G16_FLOAT passed!" << std::endl;
-        else
-            std::cout << "Test R16G16_FLOAT failed! Error: " << error << std::endl;
-    }
-    
-    void test_r10g10b10a2_unorm(const void* data)
-    {
-        float error = 0;
-        for (UINT c_idx = 0; c_idx < m_tab.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab.width; w_idx++) {
-                    unsigned int input_repr = ((unsigned int*)data)[m_tab.width * m_tab.height * c_idx + m_tab.width * h_idx + w_idx];
-                    unsigned int tmp = ((c_idx * m_tab.height * m_tab.width + h_idx * m_tab.width + w_idx) % 256);
-                    float input_r = (input_repr & 0x3FF) / 1023.0f;
-                    float input_g = ((input_repr >> 10) & 0x3FF) / 1023.0f;
-                    float input_b = ((input_repr >> 20) & 0x3FF) / 1023.0f;
-                    error += abs(input_r - max(0.0f, min(1.0f, tmp / 255.0f)));
-                    error += abs(input_g - max(0.0f, min(1.0f, (tmp + 23) / 255.0f)));
-                    error += abs(input_b - max(0.0f, min(1.0f, (tmp + 53) / 255.0f)));
-                }
-
-        error /= (m_tab.channels * m_tab.height * m_tab.width * 3);
-
-        if (error < 5e-4f)
-            std::cerr << "Test R10G10B10A2_UNORM passed!" << std::endl;
-        else
-            std::cerr << "Test R10G10B10A2_UNORM failed! Error: " << error << std::endl;
-    }
 };
 
-void run_write_test(ID3D11Device* device, ID3D11DeviceContext* context)
-{   
-    std::cerr << "Running write test..." << std::endl;
-    Texture_As_Buffer_Write_Tester tester;
-    tester.init(device, DXGI_FORMAT_R8_UNORM);
-    tester.execute(context);
-    tester.test(context);
-    tester.release();
-
-    tester.init(device, DXGI_FORMAT_R8G8B8A8_UNORM);
-    tester.execute(context);
-    tester.test(context);
-    tester.release();
-
-    tester.init(device, DXGI_FORMAT_R32_FLOAT);
-    tester.execute(context);
-    tester.test(context);
-    tester.release();
-
-    tester.init(device, DXGI_FORMAT_R16_FLOAT); 
-    tester.execute(context);    
-    tester.test(context);
-    tester.release();
-
-    tester.init(device, DXGI_FORMAT_R16G16_FLOAT);
-    tester.execute(context);    
-    tester.test(context);
-    tester.release();
-
-    tester.init(device, DXGI_FORMAT_R10G10B10A2_UNORM);
+template <DXGI_FORMAT Format>
+static void run_write_case(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    Texture_As_Buffer_Write_Tester<Format> tester;
+    tester.init(device);
     tester.execute(context);
     tester.test(context);
     tester.release();
 }
 
-class Texture_As_Buffer_Read_Tester
-{
-public:
-    void init(ID3D11Device* device, DXGI_FORMAT __test_fmt)
-    {   
-        m_device = device;
-        m_width = 503;
-        m_height = 250;
-        size_t channels = 3;
-        m_test_fmt = __test_fmt;
+void run_write_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{   
+    std::cerr << "Running write test..." << std::endl;
+    run_write_case<DXGI_FORMAT_R8_UNORM>(device, context);
+    run_write_case<DXGI_FORMAT_R8G8B8A8_UNORM>(device, context);
+    run_write_case<DXGI_FORMAT_R32_FLOAT>(device, context);
+    run_write_case<DXGI_FORMAT_R16_FLOAT>(device, context);
+    run_write_case<DXGI_FORMAT_R16G16_FLOAT>(device, context);
+    run_write_case<DXGI_FORMAT_R10G10B10A2_UNORM>(device, context);
+}
 
-        m_tab_in.init(device, channels, m_height, m_width, m_test_fmt);
-        m_tab_in.init_staging(device);
-        m_tab_out.init(device, channels, m_height, m_width, DXGI_FORMAT_R32_FLOAT);
-        m_tab_out.init_staging(device);
+// Per-format part of the read test: the kernel summing the components of four gathered elements,
+// and the components of the input element (c, h, w)
+template <DXGI_FORMAT Format>
+struct Read_Case;
 
-        const char* shader_code_r8_unorm = R"(
+template <>
+struct Read_Case<DXGI_FORMAT_R8_UNORM>
+{
+    static constexpr const char* shader = R"(
         Texture2DArray<unorm float> in_texture : register(t0);
         RWTexture2DArray<float> out_texture : register(u0);
 
@@ -481,8 +398,16 @@ public:
             }
         }
         )";
+    static void reference(size_t c, size_t h, size_t w, float* out)
+    {
+        out[0] = (float)((c ^ h ^ w) % 255) / 255.0f;
+    }
+};
 
-        const char* shader_code_r8g8b8a8_unorm = R"(
+template <>
+struct Read_Case<DXGI_FORMAT_R8G8B8A8_UNORM>
+{
+    static constexpr const char* shader = R"(
             Texture2DArray<unorm float4> in_texture : register(t0);
             RWTexture2DArray<float> out_texture : register(u0);
     
@@ -517,8 +442,17 @@ public:
                 }
             }
             )";
+    static void reference(size_t c, size_t h, size_t w, float* out)
+    {
+        for (size_t k = 0; k < 4; k++)
+            out[k] = (float)((c ^ h ^ w) % 252 + k) / 255.0f;
+    }
+};
 
-        const char* shader_code_r32_float = R"(
+template <>
+struct Read_Case<DXGI_FORMAT_R32_FLOAT>
+{
+    static constexpr const char* shader = R"(
         Texture2DArray<float> in_texture : register(t0);
         RWTexture2DArray<float> out_texture : register(u0);
 
@@ -552,8 +486,16 @@ public:
             }
         }
         )";
+    static void reference(size_t c, size_t h, size_t w, float* out)
+    {
+        out[0] = 1.2f + (c ^ h ^ w);
+    }
+};
 
-        const char* shader_code_r16_float = R"(
+template <>
+struct Read_Case<DXGI_FORMAT_R16_FLOAT>
+{
+    static constexpr const char* shader = R"(
         Texture2DArray<half> in_texture : register(t0);
         RWTexture2DArray<float> out_texture : register(u0);
 
@@ -587,8 +529,16 @@ public:
             }
         }
         )";
+    static void reference(size_t c, size_t h, size_t w, float* out)
+    {
+        out[0] = 1.2f + (c ^ h ^ w);
+    }
+};
 
-        const char* shader_code_r16g16_float = R"(
+template <>
+struct Read_Case<DXGI_FORMAT_R16G16_FLOAT>
+{
+    static constexpr const char* shader = R"(
         Texture2DArray<half2> in_texture : register(t0);
         RWTexture2DArray<float> out_texture : register(u0);
 
@@ -623,8 +573,17 @@ public:
             }
         }
         )";
+    static void reference(size_t c, size_t h, size_t w, float* out)
+    {
+        out[0] = 1.2f + (c ^ h ^ w);
+        out[1] = 2.8f + (c ^ h ^ w);
+    }
+};
 
-        const char* shader_code_r10g10b10a2_unorm = R"(
+template <>
+struct Read_Case<DXGI_FORMAT_R10G10B10A2_UNORM>
+{
+    static constexpr const char* shader = R"(
         Texture2DArray<unorm float4> in_texture : register(t0);
         RWTexture2DArray<float> out_texture : register(u0);
 
@@ -659,60 +618,62 @@ public:
             }
         }
         )";
+    static void reference(size_t c, size_t h, size_t w, float* out)
+    {
+        const uint32_t bits = (uint32_t)(((c << 30) ^ (h << 20) ^ (w << 10) ^ (w + h)) | 1);
+        format_traits<DXGI_FORMAT_R10G10B10A2_UNORM>::unpack(bits, out);
+    }
+};
 
-        switch (m_test_fmt)
-        {
-            case DXGI_FORMAT_R32_FLOAT:
-                m_compute_shader.init_from_code_string(device, shader_code_r32_float, "test_main");
-                break;
-            case DXGI_FORMAT_R8_UNORM:
-                m_compute_shader.init_from_code_string(device, shader_code_r8_unorm, "test_main");
-                break;
-            case DXGI_FORMAT_R8G8B8A8_UNORM:
-                m_compute_shader.init_from_code_string(device, shader_code_r8g8b8a8_unorm, "test_main");
-                break;
-            case DXGI_FORMAT_R16_FLOAT:
-                m_compute_shader.init_from_code_string(device, shader_code_r16_float, "test_main");
-                break;
-            case DXGI_FORMAT_R16G16_FLOAT:
-                m_compute_shader.init_from_code_string(device, shader_code_r16g16_float, "test_main");
-                break;
-            case DXGI_FORMAT_R10G10B10A2_UNORM:
-                m_compute_shader.init_from_code_string(device, shader_code_r10g10b10a2_unorm, "test_main");
-                break;
-            default:
-                std::cout << "Undefined test format." << std::endl;
-                break;
-        }       
+template <DXGI_FORMAT Format>
+class Texture_As_Buffer_Read_Tester
+{
+public:
+    void init(ID3D11Device* device)
+    {   
+        m_device = device;
+        m_width = 503;
+        m_height = 250;
+        size_t channels = 3;
 
+        m_tab_in.init(device, channels, m_height, m_width, Format);
+        m_tab_in.init_staging(device);
+        m_tab_out.init(device, channels, m_height, m_width, DXGI_FORMAT_R32_FLOAT);
+        m_tab_out.init_staging(device);
+        m_compute_shader.init_from_code_string(device, Read_Case<Format>::shader, "test_main");
     }
    
     void test(ID3D11DeviceContext* context)
     {       
-          switch (m_test_fmt)
-        {
-            case DXGI_FORMAT_R32_FLOAT:
-                test_r32_float(context);
-                break;
-            case DXGI_FORMAT_R8_UNORM:
-                test_r8_unorm(context);
-                break;
-            case DXGI_FORMAT_R8G8B8A8_UNORM:
-                test_r8g8b8a8_unorm(context);
-                break;
-            case DXGI_FORMAT_R16_FLOAT:
-                test_r16_float(context);
-                break;
-            case DXGI_FORMAT_R16G16_FLOAT:
-                test_r16g16_float(context);
-                break;
-            case DXGI_FORMAT_R10G10B10A2_UNORM:
-                test_r10g10b10a2_unorm(context);
-                break;
-            default:
-                std::cout << "Undefined test format." << std::endl;
-                break;
-        }       
+        typedef format_traits<Format> traits;
+        std::vector<typename traits::storage_type> ref_data(m_tab_in.channels * m_tab_in.height * m_tab_in.width);
+        Format_View<Format> ref(ref_data.data(), m_tab_in.channels, m_tab_in.height, m_tab_in.width);
+        format_generate(ref, Read_Case<Format>::reference);
+
+        m_tab_in.to_gpu(context, ref_data.data());
+        execute(context);
+        Format_View<DXGI_FORMAT_R32_FLOAT> data(m_tab_out.to_cpu(context), m_tab_out.channels, m_tab_out.height, m_tab_out.width);
+        const Format_Error e = format_verify(data, [&](size_t c_idx, size_t h_idx, size_t w_idx, float* out) {
+            const size_t h_idx_in = (h_idx + w_idx ^ h_idx) % m_tab_in.height;
+            const size_t w_idx_in = (w_idx + w_idx ^ h_idx) % m_tab_in.width;
+            const size_t h_idx_in_n = (h_idx + w_idx ^ h_idx + 1) % m_tab_in.height;
+            const size_t w_idx_in_n = (w_idx + w_idx ^ h_idx + 1) % m_tab_in.width;
+            const size_t taps[4][2] = { { h_idx_in, w_idx_in }, { h_idx_in, w_idx_in_n }, { h_idx_in_n, w_idx_in }, { h_idx_in_n, w_idx_in_n } };
+            float sum = 0.0f;
+            for (const size_t* t : taps) {
+                float value[4];
+                ref.load(c_idx, t[0], t[1], value);
+                for (size_t k = 0; k < traits::components; k++)
+                    sum += value[k];
+            }
+            out[0] = sum;
+        }, 0.0f);
+        const double error = e.sum / data.size();
+
+        if (error < 1e-5f)
+            std::cout << "Test " << traits::name << " passed!" << std::endl;
+        else
+            std::cout << "Test " << traits::name << " failed! Error: " << error << std::endl;
     }
 
     void release()
@@ -728,27 +689,6 @@ private:
     Texture_As_Buffer m_tab_out;
     unsigned int m_width = 0;
     unsigned int m_height = 0;
-    DXGI_FORMAT m_test_fmt;
-
-    struct F2
-    {
-        float r;
-        float g;
-    };
-
-    struct H2
-    {
-        UINT16 r;
-        UINT16 g;
-    };
-
-    struct F4
-    {
-        float r;
-        float g;
-        float b;
-        float a;
-    };
 
     void execute(ID3D11DeviceContext* context)
     {
@@ -768,397 +708,2146 @@ private:
         ID3D11UnorderedAccessView* nullUAV[1] = { nullptr };
         context->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
     }
- 
-    void test_r32_float(ID3D11DeviceContext* context)
-    {   
-        unsigned char *ref_data = new unsigned char[m_tab_in.width * m_tab_in.height * m_tab_in.channels * m_tab_in.element_size];
-        for (UINT c_idx = 0; c_idx < m_tab_in.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_in.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_in.width; w_idx++) {
-                    ((float *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx + w_idx] = 1.2f + (c_idx ^ h_idx ^ w_idx);
-                }
+};
 
-        m_tab_in.to_gpu(context, ref_data);
-        execute(context);
-        void *data = m_tab_out.to_cpu(context);
-        float error = 0;
-        for (UINT c_idx = 0; c_idx < m_tab_in.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_in.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_in.width; w_idx++) {
-                    UINT h_idx_in = (h_idx + w_idx ^ h_idx) % m_tab_in.height;
-                    UINT w_idx_in = (w_idx + w_idx ^ h_idx) % m_tab_in.width;
-                    UINT h_idx_in_n = (h_idx + w_idx ^ h_idx + 1) % m_tab_in.height;
-                    UINT w_idx_in_n = (w_idx + w_idx ^ h_idx + 1) % m_tab_in.width;
-                    float expected_0 = ((float *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in + w_idx_in];
-                    float expected_1 = ((float *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in + w_idx_in_n];
-                    float expected_2 = ((float *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in_n + w_idx_in];
-                    float expected_3 = ((float *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in_n + w_idx_in_n];
-                    float input = ((float *)data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx + w_idx];
-                    error += abs(input - (expected_0 + expected_1 + expected_2 + expected_3));
-                }
+template <DXGI_FORMAT Format>
+static void run_read_case(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    Texture_As_Buffer_Read_Tester<Format> tester;
+    tester.init(device);
+    tester.test(context);
+    tester.release();
+}
 
-        error /= (m_tab_in.channels * m_tab_in.height * m_tab_in.width);
+void run_read_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running read test..." << std::endl;
+    run_read_case<DXGI_FORMAT_R32_FLOAT>(device, context);
+    run_read_case<DXGI_FORMAT_R8_UNORM>(device, context);
+    run_read_case<DXGI_FORMAT_R8G8B8A8_UNORM>(device, context);
+    run_read_case<DXGI_FORMAT_R16_FLOAT>(device, context);
+    run_read_case<DXGI_FORMAT_R16G16_FLOAT>(device, context);
+    run_read_case<DXGI_FORMAT_R10G10B10A2_UNORM>(device, context);
+}
 
-        if (error < 1e-5f)
-            std::cout << "Test R32_FLOAT passed!" << std::endl;
-        else
-            std::cout << "Test R32_FLOAT failed! Error: " << error << std::endl;
+class Shader_Compile_Tester
+{
+public:
+    void init(ID3D11Device* device, ID3D11DeviceContext* context) 
+    {   
+        D3D_SHADER_MACRO defines[4] = {{ "THREAD_GROUP_SIZE_X", p_block_dim_x }, { "THREAD_GROUP_SIZE_Y", p_block_dim_y }, { nullptr, nullptr }};
+        m_compute_shader.init_from_file(device, "shaders/array_sum.hlsl", "main", defines);
+
+        m_tab_in0.init(device, 2, 200, 300, DXGI_FORMAT_R32_FLOAT); m_tab_in0.init_staging(device);
+        m_tab_in1.init(device, 2, 200, 300, DXGI_FORMAT_R32_FLOAT); m_tab_in1.init_staging(device);
+        m_tab_out.init(device, 2, 200, 300, DXGI_FORMAT_R32_FLOAT); m_tab_out.init_staging(device);
+        
+        cast_float_to_int f2i;
+        f2i.f = 1.0f;
+        m_tab_in0.to_gpu(context, f2i.i);
+        f2i.f = 2.0f;
+        m_tab_in1.to_gpu(context, f2i.i);
+        m_tab_out.to_gpu(context, (unsigned char) 0);
 
-         delete[] ((unsigned char*)ref_data);
+        m_constant_buffer.init(device, sizeof(Constant_Buffer));
     }
 
-    void test_r8_unorm(ID3D11DeviceContext* context)
+    void execute(ID3D11DeviceContext* context) 
     {   
-        unsigned char *ref_data = new unsigned char[m_tab_in.width * m_tab_in.height * m_tab_in.channels * m_tab_in.element_size];
-        for (UINT c_idx = 0; c_idx < m_tab_in.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_in.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_in.width; w_idx++)
-                    ref_data[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx + w_idx] = (c_idx ^ h_idx ^ w_idx) % 255;
-                
-
-        m_tab_in.to_gpu(context, ref_data);
-        execute(context);
-        void *data = m_tab_out.to_cpu(context);
-        float error = 0;
-        for (UINT c_idx = 0; c_idx < m_tab_in.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_in.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_in.width; w_idx++) {
-                    UINT h_idx_in = (h_idx + w_idx ^ h_idx) % m_tab_in.height;
-                    UINT w_idx_in = (w_idx + w_idx ^ h_idx) % m_tab_in.width;
-                    UINT h_idx_in_n = (h_idx + w_idx ^ h_idx + 1) % m_tab_in.height;
-                    UINT w_idx_in_n = (w_idx + w_idx ^ h_idx + 1) % m_tab_in.width;
-                    float expected_0 = ref_data[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in + w_idx_in] / 255.0f;
-                    float expected_1 = ref_data[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in + w_idx_in_n] / 255.0f;
-                    float expected_2 = ref_data[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in_n + w_idx_in] / 255.0f;
-                    float expected_3 = ref_data[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in_n + w_idx_in_n] / 255.0f;
-                    float input = ((float *)data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx + w_idx];
-                    error += abs(input - (expected_0 + expected_1 + expected_2 + expected_3));
-                }
+        constant_buffer.time_index = 2;
+        constant_buffer.height = 200;
+        constant_buffer.width = 300;
+        constant_buffer.align_padding = 0;
+        m_constant_buffer.to_gpu(context, &constant_buffer);
 
-        error /= (m_tab_in.channels * m_tab_in.height * m_tab_in.width);
+        context->CSSetShader(m_compute_shader.shader, nullptr, 0);
+        context->CSSetConstantBuffers(0, 1, &m_constant_buffer.p_buffer);
+        context->CSSetShaderResources(0, 1, &m_tab_in0.p_texture_srv);   
+        context->CSSetShaderResources(1, 1, &m_tab_in1.p_texture_srv);
+        context->CSSetUnorderedAccessViews(0, 1, &m_tab_out.p_texture_uav, nullptr);
 
-        if (error < 1e-5f)
-            std::cout << "Test R8_UNORM passed!" << std::endl;
-        else
-            std::cout << "Test R8_UNORM failed! Error: " << error << std::endl;
+        UINT dispatchX = ((UINT)m_tab_out.width + block_dim_x - 1) / block_dim_x;
+        UINT dispatchY = ((UINT)m_tab_out.height + block_dim_y - 1) / block_dim_y;
+        context->Dispatch(dispatchX, dispatchY, 1);
 
-         delete[] ((unsigned char*)ref_data);
+        ID3D11UnorderedAccessView* nullUAV[1] = { nullptr };
+        context->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
     }
 
-    F4 rgba8_to_float4(UINT u)
+    void test(ID3D11DeviceContext* context)
     {
-        return F4{
-            (float)(u >> 0 & 0xff) / 255.0f,
-            (float)(u >> 8 & 0xff) / 255.0f,
-            (float)(u >> 16 & 0xff) / 255.0f,
-            (float)(u >> 24) / 255.0f};
-    }
-
-    void test_r8g8b8a8_unorm(ID3D11DeviceContext* context)
-    {   
-        unsigned char *ref_data = new unsigned char[m_tab_in.width * m_tab_in.height * m_tab_in.channels * m_tab_in.element_size];
-        for (UINT c_idx = 0; c_idx < m_tab_in.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_in.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_in.width; w_idx++) {
-                    unsigned int input = (c_idx ^ h_idx ^ w_idx) % 252;
-                    ((unsigned int *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx + w_idx] = input | ((input + 1) << 8) | ((input + 2) << 16) | ((input + 3) << 24);
-                }
-                
-
-        m_tab_in.to_gpu(context, ref_data);
         execute(context);
         void *data = m_tab_out.to_cpu(context);
+        float *data_float = (float *)data;
         float error = 0;
-        for (UINT c_idx = 0; c_idx < m_tab_in.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_in.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_in.width; w_idx++) {
-                    UINT h_idx_in = (h_idx + w_idx ^ h_idx) % m_tab_in.height;
-                    UINT w_idx_in = (w_idx + w_idx ^ h_idx) % m_tab_in.width;
-                    UINT h_idx_in_n = (h_idx + w_idx ^ h_idx + 1) % m_tab_in.height;
-                    UINT w_idx_in_n = (w_idx + w_idx ^ h_idx + 1) % m_tab_in.width;
-                    F4 expected_0 =  rgba8_to_float4(((unsigned int *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in + w_idx_in]);
-                    F4 expected_1 = rgba8_to_float4(((unsigned int *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in + w_idx_in_n]);
-                    F4 expected_2 = rgba8_to_float4(((unsigned int *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in_n + w_idx_in]);
-                    F4 expected_3 = rgba8_to_float4(((unsigned int *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in_n + w_idx_in_n]);
-                    float input = ((float *)data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx + w_idx];
-                    error += abs(input - ((expected_0.r + expected_1.r + expected_2.r + expected_3.r) + (expected_0.g + expected_1.g + expected_2.g + expected_3.g) + (expected_0.b + expected_1.b + expected_2.b + expected_3.b) + (expected_0.a + expected_1.a + expected_2.a + expected_3.a)));
+        for (UINT c_idx = 0; c_idx < m_tab_out.channels; c_idx++)
+            for (UINT h_idx = 0; h_idx < m_tab_out.height; h_idx++)
+                for (UINT w_idx = 0; w_idx < m_tab_out.width; w_idx++) {
+                    float expected = 3 + (float)block_dim_x + (float)block_dim_y + 2 + 200 + 300;
+                    float input = data_float[m_tab_out.width * m_tab_out.height * c_idx + m_tab_out.width * h_idx + w_idx];
+                    error += abs(input - expected);
                 }
-
-        error /= (m_tab_in.channels * m_tab_in.height * m_tab_in.width);
-
-        if (error < 1e-5f)
-            std::cout << "Test R8G8B8A8_UNORM passed!" << std::endl;
+        if (error == 0.0f)
+            std::cout << "Shader compile test passed!" << std::endl;
         else
-            std::cout << "Test R8G8B8A8_UNORM failed! Error: " << error << std::endl;
-
-         delete[] ((unsigned char*)ref_data);
+            std::cout << "Shader compile test failed! Error: " << error << std::endl;
     }
 
+    void release() 
+    {
+        m_tab_in0.release();
+        m_tab_in1.release();
+        m_tab_out.release();
+        m_constant_buffer.release();
+        m_compute_shader.release();
+    }
 
-    void test_r16_float(ID3D11DeviceContext* context)
-    {   
-        unsigned char *ref_data = new unsigned char[m_tab_in.width * m_tab_in.height * m_tab_in.channels * m_tab_in.element_size];
-        for (UINT c_idx = 0; c_idx < m_tab_in.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_in.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_in.width; w_idx++) {
-                    ((uint16_t *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx + w_idx] = DirectX::PackedVector::XMConvertFloatToHalf(1.2f + (c_idx ^ h_idx ^ w_idx));
-                }
+private:
+    D3D11_Compute_Shader m_compute_shader;
+    D3D11_Constant_Buffer m_constant_buffer;
+    Texture_As_Buffer m_tab_in0;
+    Texture_As_Buffer m_tab_in1;
+    Texture_As_Buffer m_tab_out;
+    const char* p_block_dim_x = "9";
+    const char* p_block_dim_y = "7";
+    
+    const UINT block_dim_x = atoi(p_block_dim_x);
+    const UINT block_dim_y = atoi(p_block_dim_y);
 
-        m_tab_in.to_gpu(context, ref_data);
-        execute(context);
-        void *data = m_tab_out.to_cpu(context);
-        float error = 0;
-        for (UINT c_idx = 0; c_idx < m_tab_in.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_in.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_in.width; w_idx++) {
-                    UINT h_idx_in = (h_idx + w_idx ^ h_idx) % m_tab_in.height;
-                    UINT w_idx_in = (w_idx + w_idx ^ h_idx) % m_tab_in.width;
-                    UINT h_idx_in_n = (h_idx + w_idx ^ h_idx + 1) % m_tab_in.height;
-                    UINT w_idx_in_n = (w_idx + w_idx ^ h_idx + 1) % m_tab_in.width;
-                    float expected_0 = DirectX::PackedVector::XMConvertHalfToFloat(((uint16_t *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in + w_idx_in]);
-                    float expected_1 = DirectX::PackedVector::XMConvertHalfToFloat(((uint16_t *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in + w_idx_in_n]);
-                    float expected_2 = DirectX::PackedVector::XMConvertHalfToFloat(((uint16_t *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in_n + w_idx_in]);
-                    float expected_3 = DirectX::PackedVector::XMConvertHalfToFloat(((uint16_t *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in_n + w_idx_in_n]);
-                    float input = ((float *)data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx + w_idx];
-                    error += abs(input - (expected_0 + expected_1 + expected_2 + expected_3));
-                }
+    union cast_float_to_int
+    {
+        float f;
+        unsigned int i;
+    };
 
-        error /= (m_tab_in.channels * m_tab_in.height * m_tab_in.width);
+    struct Constant_Buffer
+    {
+        unsigned int time_index;
+        int height;
+        int width;
+        int align_padding;
+    } constant_buffer;
+};
 
-        if (error < 1e-5f)
-            std::cout << "Test R16_FLOAT passed!" << std::endl;
-        else
-            std::cout << "Test R16_FLOAT failed! Error: " << error << std::endl;
+void run_shader_compile_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running shader compile test..." << std::endl;
+    Shader_Compile_Tester tester;
+    tester.init(device, context);
+    tester.test(context);
+    tester.release();
+}
 
-         delete[] ((unsigned char*)ref_data);
-    }
 
-    F2 half2_to_float2(H2 h2)
+class Virtual_Texture_Array_Tester
+{
+public:
+    void init(ID3D11Device* device)
     {
-        return F2{DirectX::PackedVector::XMConvertHalfToFloat(h2.r), DirectX::PackedVector::XMConvertHalfToFloat(h2.g)};
-    }
+        // Artificially small tile limits so a modest array spans many physical textures
+        m_vta_in.init(device, 5, 300, 503, DXGI_FORMAT_R32_FLOAT, 2, 128, 128);
+        m_vta_in.init_staging(device);
+        m_vta_out.init(device, 5, 300, 503, DXGI_FORMAT_R32_FLOAT, 2, 128, 128);
+        m_vta_out.init_staging(device);
+
+        const char* shader_code = R"(
+            cbuffer Tile_Constants : register(b1)
+            {
+                uint tile_c0;
+                uint tile_h0;
+                uint tile_w0;
+                uint tile_pad;
+            };
 
-    void test_r16g16_float(ID3D11DeviceContext* context)
-    {       
-        unsigned char *ref_data = new unsigned char[m_tab_in.width * m_tab_in.height * m_tab_in.channels * m_tab_in.element_size];
-        for (UINT c_idx = 0; c_idx < m_tab_in.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_in.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_in.width; w_idx++) {
-                    H2 h2;
-                    h2.r = DirectX::PackedVector::XMConvertFloatToHalf(1.2f + (c_idx ^ h_idx ^ w_idx));
-                    h2.g = DirectX::PackedVector::XMConvertFloatToHalf(2.8f + (c_idx ^ h_idx ^ w_idx));
-                    ((H2 *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx + w_idx] = h2;
-                }
+            Texture2DArray<float> in_texture : register(t0);
+            RWTexture2DArray<float> out_texture : register(u0);
 
-        m_tab_in.to_gpu(context, ref_data);
-        execute(context);
-        void *data = m_tab_out.to_cpu(context);
-        float error = 0;
-        for (UINT c_idx = 0; c_idx < m_tab_in.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_in.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_in.width; w_idx++) {
-                    UINT h_idx_in = (h_idx + w_idx ^ h_idx) % m_tab_in.height;
-                    UINT w_idx_in = (w_idx + w_idx ^ h_idx) % m_tab_in.width;
-                    UINT h_idx_in_n = (h_idx + w_idx ^ h_idx + 1) % m_tab_in.height;
-                    UINT w_idx_in_n = (w_idx + w_idx ^ h_idx + 1) % m_tab_in.width;
-                    F2 expected_0 = half2_to_float2(((H2 *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in + w_idx_in]);
-                    F2 expected_1 = half2_to_float2(((H2 *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in + w_idx_in_n]);
-                    F2 expected_2 = half2_to_float2(((H2 *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in_n + w_idx_in]);
-                    F2 expected_3 = half2_to_float2(((H2 *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in_n + w_idx_in_n]);
-                    float input = ((float *)data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx + w_idx];
-                    error += abs(input - (expected_0.r + expected_1.r + expected_2.r + expected_3.r + expected_0.g + expected_1.g + expected_2.g + expected_3.g));
-                }
+            [numthreads(16, 16, 1)]
+            void test_main(uint3 DTid : SV_DispatchThreadID)
+            {
+                int w_idx = DTid.x;
+                int h_idx = DTid.y;
 
-        error /= (m_tab_in.channels * m_tab_in.height * m_tab_in.width);
+                int width;
+                int height;
+                int channels;
 
-        if (error < 1e-5f)
-            std::cout << "Test R16G16_FLOAT passed!" << std::endl;
-        else
-            std::cout << "Test R16G16_FLOAT failed! Error: " << error << std::endl;
+                out_texture.GetDimensions(width, height, channels);
+            
+                if (w_idx >= width || h_idx >= height)
+                    return;
+                
+                for (int c = 0; c < channels; c++) {
+                    int3 idx = int3(w_idx, h_idx, c);
+                    out_texture[idx] = in_texture[idx] + (tile_c0 + c) * 100000.0f + (tile_h0 + h_idx) * 1000.0f + (tile_w0 + w_idx);
+                }
+            }
+        )";
 
-         delete[] ((unsigned char*)ref_data);
+        m_compute_shader.init_from_code_string(device, shader_code, "test_main");
     }
-    
-    F4 rgb10a2_to_float4(UINT u)
+
+    void test(ID3D11DeviceContext* context)
     {
-        return F4{
-            (float)(u >> 0 & 0x3ff) / 1023.0f,
-            (float)(u >> 10 & 0x3ff) / 1023.0f,
-            (float)(u >> 20 & 0x3ff) / 1023.0f,
-            (float)(u >> 30) / 3.0f};
-    }
-    
-    void test_r10g10b10a2_unorm(ID3D11DeviceContext* context)
-    {   
-        unsigned char *ref_data = new unsigned char[m_tab_in.width * m_tab_in.height * m_tab_in.channels * m_tab_in.element_size];
-        for (UINT c_idx = 0; c_idx < m_tab_in.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_in.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_in.width; w_idx++)
-                    ((UINT *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx + w_idx] = ((c_idx << 30) ^ (h_idx << 20) ^ (w_idx << 10) ^ (w_idx + h_idx)) | 1;
-                
-        m_tab_in.to_gpu(context, ref_data);
-        execute(context);
-        void *data = m_tab_out.to_cpu(context);
+        const Tile_Layout& layout = m_vta_in.layout;
+        float *ref_data = new float[layout.channels * layout.height * layout.width];
+        for (size_t i = 0; i < layout.channels * layout.height * layout.width; i++)
+            ref_data[i] = (float)(i % 256);
+
+        m_vta_in.to_gpu(context, ref_data);
+        Virtual_Texture_Array* inputs[1] = { &m_vta_in };
+        m_vta_out.dispatch(context, m_compute_shader.shader, inputs, 1, 16, 16);
+        float *data = (float *)m_vta_out.to_cpu(context);
+
         float error = 0;
-        for (UINT c_idx = 0; c_idx < m_tab_in.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_in.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_in.width; w_idx++) {
-                    UINT h_idx_in = (h_idx + w_idx ^ h_idx) % m_tab_in.height;
-                    UINT w_idx_in = (w_idx + w_idx ^ h_idx) % m_tab_in.width;
-                    UINT h_idx_in_n = (h_idx + w_idx ^ h_idx + 1) % m_tab_in.height;
-                    UINT w_idx_in_n = (w_idx + w_idx ^ h_idx + 1) % m_tab_in.width;
-                    F4 expected_0 = rgb10a2_to_float4(((UINT *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in + w_idx_in]);
-                    F4 expected_1 = rgb10a2_to_float4(((UINT *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in + w_idx_in_n]);
-                    F4 expected_2 = rgb10a2_to_float4(((UINT *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in_n + w_idx_in]);
-                    F4 expected_3 = rgb10a2_to_float4(((UINT *)ref_data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx_in_n + w_idx_in_n]);
-                    float input = ((float *)data)[m_tab_in.width * m_tab_in.height * c_idx + m_tab_in.width * h_idx + w_idx];
-                    error += abs(input - (expected_0.r + expected_1.r + expected_2.r + expected_3.r + expected_0.g + expected_1.g + expected_2.g + expected_3.g + expected_0.b + expected_1.b + expected_2.b + expected_3.b + expected_0.a + expected_1.a + expected_2.a + expected_3.a));
+        for (size_t c_idx = 0; c_idx < layout.channels; c_idx++)
+            for (size_t h_idx = 0; h_idx < layout.height; h_idx++)
+                for (size_t w_idx = 0; w_idx < layout.width; w_idx++) {
+                    size_t i = (c_idx * layout.height + h_idx) * layout.width + w_idx;
+                    float expected = ref_data[i] + c_idx * 100000.0f + h_idx * 1000.0f + w_idx;
+                    error += abs(data[i] - expected);
                 }
 
-        error /= (m_tab_in.channels * m_tab_in.height * m_tab_in.width);
-
-        if (error < 1e-5f)
-            std::cout << "Test R10G10B10A2_UNORM passed!" << std::endl;
+        if (error == 0.0f)
+            std::cout << "Virtual texture array test passed!" << std::endl;
         else
-            std::cout << "Test R10G10B10A2_UNORM failed! Error: " << error << std::endl;
+            std::cout << "Virtual texture array test failed! Error: " << error << std::endl;
+        delete[] ref_data;
+    }
 
-         delete[] ((unsigned char*)ref_data);
+    void release()
+    {
+        m_vta_in.release();
+        m_vta_out.release();
+        m_compute_shader.release();
     }
+
+private:
+    D3D11_Compute_Shader m_compute_shader;
+    Virtual_Texture_Array m_vta_in;
+    Virtual_Texture_Array m_vta_out;
 };
 
-void run_read_test(ID3D11Device* device, ID3D11DeviceContext* context)
+void run_virtual_texture_array_test(ID3D11Device* device, ID3D11DeviceContext* context)
 {
-    std::cerr << "Running read test..." << std::endl;
-    Texture_As_Buffer_Read_Tester tester;
-    tester.init(device, DXGI_FORMAT_R32_FLOAT);
+    std::cerr << "Running virtual texture array test..." << std::endl;
+    Virtual_Texture_Array_Tester tester;
+    tester.init(device);
     tester.test(context);
     tester.release();
+}
 
-    tester.init(device, DXGI_FORMAT_R8_UNORM);
-    tester.test(context);
-    tester.release();
+class Stream_Executor_Tester : public Stream_Executor_Host_Tester
+{
+public:
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        const char* shader_code = R"(
+            cbuffer Stream_Constants : register(b0)
+            {
+                uint in_h0;
+                uint in_w0;
+                uint out_h0;
+                uint out_w0;
+                uint in_height;
+                uint in_width;
+                uint out_height;
+                uint out_width;
+                uint height;
+                uint width;
+                uint channels;
+                uint align_padding;
+            };
+
+            Texture2DArray<float> in_texture : register(t0);
+            RWTexture2DArray<float> out_texture : register(u0);
 
-    tester.init(device, DXGI_FORMAT_R8G8B8A8_UNORM);
-    tester.test(context);
-    tester.release();
+            [numthreads(16, 16, 1)]
+            void test_main(uint3 DTid : SV_DispatchThreadID)
+            {
+                if (DTid.x >= out_width || DTid.y >= out_height)
+                    return;
 
-    tester.init(device, DXGI_FORMAT_R16_FLOAT);
-    tester.test(context);
-    tester.release();
+                uint h_idx = out_h0 + DTid.y;
+                uint w_idx = out_w0 + DTid.x;
+                uint h_n = min(h_idx + 1, height - 1);
+                uint w_n = min(w_idx + 1, width - 1);
+
+                for (uint c = 0; c < channels; c++) {
+                    float input_0 = in_texture[int3(w_idx - in_w0, h_idx - in_h0, c)];
+                    float input_1 = in_texture[int3(w_n - in_w0, h_idx - in_h0, c)];
+                    float input_2 = in_texture[int3(w_idx - in_w0, h_n - in_h0, c)];
+                    float input_3 = in_texture[int3(w_n - in_w0, h_n - in_h0, c)];
+                    out_texture[int3(DTid.x, DTid.y, c)] = input_0 + input_1 + input_2 + input_3;
+                }
+            }
+        )";
 
-    tester.init(device, DXGI_FORMAT_R16G16_FLOAT);
-    tester.test(context);
-    tester.release();
+        D3D11_Compute_Shader compute_shader;
+        compute_shader.init_from_code_string(device, shader_code, "test_main");
 
-    tester.init(device, DXGI_FORMAT_R10G10B10A2_UNORM);
-    tester.test(context);
+        // Tiles are sized as the backend allocates them, staging copies and padded rows included
+        D3D11_Stream_Backend backend;
+        backend.init(device, context, compute_shader.shader, DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_R32_FLOAT, m_height, m_width, 16, 16);
+        Stream_Executor executor;
+        if (!executor.init(m_channels, m_height, m_width, sizeof(float), sizeof(float), m_footprint, m_memory_cap, &backend)) {
+            std::cout << "Stream executor device test failed! Could not plan tiles." << std::endl;
+            return;
+        }
+        Stream_Stats stats = executor.run(&backend, m_input, m_output);
+        report("device", stats);
+        compute_shader.release();
+    }
+};
+
+void run_stream_executor_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running stream executor test..." << std::endl;
+    Stream_Executor_Tester tester;
+    tester.init(3, 2000, 503, 1 << 20);
+    tester.test_device(device, context);
     tester.release();
 }
 
-class Shader_Compile_Tester
+class Transfer_Codec_Tester : public Transfer_Codec_Host_Tester
 {
 public:
-    void init(ID3D11Device* device, ID3D11DeviceContext* context) 
-    {   
-        D3D_SHADER_MACRO defines[4] = {{ "THREAD_GROUP_SIZE_X", p_block_dim_x }, { "THREAD_GROUP_SIZE_Y", p_block_dim_y }, { nullptr, nullptr }};
-        m_compute_shader.init_from_file(device, "shaders/array_sum.hlsl", "main", defines);
-
-        m_tab_in0.init(device, 2, 200, 300, DXGI_FORMAT_R32_FLOAT); m_tab_in0.init_staging(device);
-        m_tab_in1.init(device, 2, 200, 300, DXGI_FORMAT_R32_FLOAT); m_tab_in1.init_staging(device);
-        m_tab_out.init(device, 2, 200, 300, DXGI_FORMAT_R32_FLOAT); m_tab_out.init_staging(device);
-        
-        cast_float_to_int f2i;
-        f2i.f = 1.0f;
-        m_tab_in0.to_gpu(context, f2i.i);
-        f2i.f = 2.0f;
-        m_tab_in1.to_gpu(context, f2i.i);
-        m_tab_out.to_gpu(context, (unsigned char) 0);
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context, DXGI_FORMAT format)
+    {
+        const size_t channels = 3, height = 250, width = 503;
+        const size_t count = channels * height * width;
+        const size_t word_bits = format == DXGI_FORMAT_R16_FLOAT ? 16 : 32;
+
+        Texture_As_Buffer tab;
+        tab.init(device, channels, height, width, format);
+        tab.init_staging(device);
+        D3D11_Compressed_Transfer transfer;
+        transfer.init(device, format, count);
+
+        std::vector<uint32_t> src(count);
+        std::vector<unsigned char> packed(count * tab.element_size);
+        std::vector<unsigned char> decoded(count * tab.element_size);
+        std::string name = format == DXGI_FORMAT_R16_FLOAT ? "R16_FLOAT" : "R32_FLOAT";
+
+        // Compressed upload, plain readback
+        fill(src.data(), count, word_bits, true, 1);
+        pack(src.data(), count, word_bits, packed.data());
+        transfer.to_gpu(context, tab, packed.data());
+        Transfer_Codec_Stats upload_stats = transfer.last_stats;
+        void* data = tab.to_cpu(context);
+        size_t error = memcmp(data, packed.data(), packed.size()) != 0;
+
+        // Plain upload, compressed readback
+        fill(src.data(), count, word_bits, true, 2);
+        pack(src.data(), count, word_bits, packed.data());
+        tab.to_gpu(context, packed.data());
+        error += !transfer.to_cpu(context, tab, decoded.data());
+        error += memcmp(decoded.data(), packed.data(), packed.size()) != 0;
+        Transfer_Codec_Stats readback_stats = transfer.last_stats;
+
+        std::cout << "Compressed " << name << ": upload ratio " << upload_stats.ratio() << " in " << upload_stats.encode_ms + upload_stats.transfer_ms
+            << " ms, readback ratio " << readback_stats.ratio() << " in " << readback_stats.transfer_ms + readback_stats.decode_ms << " ms" << std::endl;
+        if (error == 0)
+            std::cout << "Compressed transfer " << name << " test passed!" << std::endl;
+        else
+            std::cout << "Compressed transfer " << name << " test failed! Error: " << error << std::endl;
 
-        m_constant_buffer.init(device, sizeof(Constant_Buffer));
+        transfer.release();
+        tab.release();
     }
+};
 
-    void execute(ID3D11DeviceContext* context) 
-    {   
-        constant_buffer.time_index = 2;
-        constant_buffer.height = 200;
-        constant_buffer.width = 300;
-        constant_buffer.align_padding = 0;
-        m_constant_buffer.to_gpu(context, &constant_buffer);
+void run_transfer_codec_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running transfer codec test..." << std::endl;
+    Transfer_Codec_Tester tester;
+    tester.test_device(device, context, DXGI_FORMAT_R16_FLOAT);
+    tester.test_device(device, context, DXGI_FORMAT_R32_FLOAT);
+}
 
-        context->CSSetShader(m_compute_shader.shader, nullptr, 0);
-        context->CSSetConstantBuffers(0, 1, &m_constant_buffer.p_buffer);
-        context->CSSetShaderResources(0, 1, &m_tab_in0.p_texture_srv);   
-        context->CSSetShaderResources(1, 1, &m_tab_in1.p_texture_srv);
-        context->CSSetUnorderedAccessViews(0, 1, &m_tab_out.p_texture_uav, nullptr);
+class Mapped_File_Tester : public Mapped_File_Host_Tester
+{
+public:
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context, DXGI_FORMAT format, const char* path)
+    {
+        Texture_As_Buffer tab_out;
+        Texture_As_Buffer tab_in;
+        tab_out.init(device, 3, 250, 503, format);
+        tab_out.init_staging(device);
+        tab_in.init(device, 3, 250, 503, format);
+        tab_in.init_staging(device);
+
+        const size_t bytes = tab_out.channels * tab_out.height * tab_out.width * tab_out.element_size;
+        std::vector<unsigned char> ref_data(bytes);
+        for (size_t i = 0; i < bytes; i++)
+            ref_data[i] = (unsigned char)((i * 13) % 61);
+        tab_out.to_gpu(context, ref_data.data());
+
+        size_t error = !tab_out.save_file(context, path);
+        error += !tab_in.load_file(context, path);
+        void* data = tab_in.to_cpu(context);
+        error += data == nullptr || memcmp(data, ref_data.data(), bytes) != 0;
+        if (is_npy_path(path) && tab_out.element_size == 4) {
+            // Same byte size, other dtype: a .npy must not load into it
+            Texture_As_Buffer tab_other;
+            tab_other.init(device, 3, 250, 503, format == DXGI_FORMAT_R32_FLOAT ? DXGI_FORMAT_R16G16_FLOAT : DXGI_FORMAT_R32_FLOAT);
+            tab_other.init_staging(device);
+            error += tab_other.load_file(context, path);
+            tab_other.release();
+        }
+        std::remove(path);
 
-        UINT dispatchX = ((UINT)m_tab_out.width + block_dim_x - 1) / block_dim_x;
-        UINT dispatchY = ((UINT)m_tab_out.height + block_dim_y - 1) / block_dim_y;
-        context->Dispatch(dispatchX, dispatchY, 1);
+        if (error == 0)
+            std::cout << "Mapped file " << path << " test passed!" << std::endl;
+        else
+            std::cout << "Mapped file " << path << " test failed! Error: " << error << std::endl;
 
-        ID3D11UnorderedAccessView* nullUAV[1] = { nullptr };
-        context->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
+        tab_out.release();
+        tab_in.release();
     }
+};
 
-    void test(ID3D11DeviceContext* context)
+void run_mapped_file_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running mapped file test..." << std::endl;
+    Mapped_File_Tester tester;
+    tester.test_device(device, context, DXGI_FORMAT_R32_FLOAT, "mapped_file_test.npy");
+    tester.test_device(device, context, DXGI_FORMAT_R16G16_FLOAT, "mapped_file_test.npy");
+    tester.test_device(device, context, DXGI_FORMAT_R8_UNORM, "mapped_file_test.raw");
+}
+
+class Snapshot_Tester : public Snapshot_Host_Tester
+{
+public:
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context, const char* path)
     {
-        execute(context);
-        void *data = m_tab_out.to_cpu(context);
-        float *data_float = (float *)data;
-        float error = 0;
-        for (UINT c_idx = 0; c_idx < m_tab_out.channels; c_idx++)
-            for (UINT h_idx = 0; h_idx < m_tab_out.height; h_idx++)
-                for (UINT w_idx = 0; w_idx < m_tab_out.width; w_idx++) {
-                    float expected = 3 + (float)block_dim_x + (float)block_dim_y + 2 + 200 + 300;
-                    float input = data_float[m_tab_out.width * m_tab_out.height * c_idx + m_tab_out.width * h_idx + w_idx];
-                    error += abs(input - expected);
+        Texture_As_Buffer tab;
+        tab.init(device, 3, 250, 503, DXGI_FORMAT_R32_FLOAT);
+        tab.init_staging(device);
+        const size_t count = tab.channels * tab.height * tab.width;
+
+        std::vector<float> saved(count);
+        for (size_t i = 0; i < count; i++)
+            saved[i] = (float)(i % 1000) * 0.5f;
+        tab.to_gpu(context, saved.data());
+
+        size_t error = 0;
+        Snapshot_Writer writer;
+        error += !writer.open(path);
+        error += !save_snapshot(context, writer, "tab", tab, 64);
+        error += !writer.close();
+
+        // Overwrite, then restore channel 1 / rows [64, 128) only
+        cast_float_to_int f2i;
+        f2i.f = -1.0f;
+        tab.to_gpu(context, f2i.i);
+        Snapshot_Reader reader;
+        error += !reader.open(path);
+        error += !load_snapshot_tile(context, reader, "tab", tab, 1, 1);
+
+        float* data = (float*)tab.to_cpu(context);
+        for (size_t c_idx = 0; c_idx < tab.channels; c_idx++)
+            for (size_t h_idx = 0; h_idx < tab.height; h_idx++)
+                for (size_t w_idx = 0; w_idx < tab.width; w_idx++) {
+                    size_t i = (c_idx * tab.height + h_idx) * tab.width + w_idx;
+                    bool restored = c_idx == 1 && h_idx >= 64 && h_idx < 128;
+                    error += data[i] != (restored ? saved[i] : -1.0f);
                 }
-        if (error == 0.0f)
-            std::cout << "Shader compile test passed!" << std::endl;
+
+        error += !load_snapshot(context, reader, "tab", tab);
+        data = (float*)tab.to_cpu(context);
+        error += memcmp(data, saved.data(), count * sizeof(float)) != 0;
+        reader.release();
+        std::remove(path);
+
+        if (error == 0)
+            std::cout << "Snapshot device test passed!" << std::endl;
         else
-            std::cout << "Shader compile test failed! Error: " << error << std::endl;
+            std::cout << "Snapshot device test failed! Error: " << error << std::endl;
+        tab.release();
     }
 
-    void release() 
+    // BC4 texture: rows and chunks are in 4x4 blocks (64 x 128 blocks of 8 bytes per channel)
+    void test_device_block(ID3D11Device* device, ID3D11DeviceContext* context, const char* path)
     {
-        m_tab_in0.release();
-        m_tab_in1.release();
-        m_tab_out.release();
-        m_constant_buffer.release();
-        m_compute_shader.release();
-    }
+        Texture_As_Buffer tab;
+        tab.init(device, 3, 256, 512, DXGI_FORMAT_BC4_UNORM);
+        tab.init_staging(device);
+        const size_t bytes = tab.channels * tab.slice_pitch();
+
+        // Any bytes are a valid BC4 block, the copies never decode them
+        std::vector<unsigned char> saved(bytes);
+        for (size_t i = 0; i < bytes; i++)
+            saved[i] = (unsigned char)((i * 2654435761u) >> 13);
+        tab.to_gpu(context, saved.data());
+
+        size_t error = 0;
+        Snapshot_Writer writer;
+        error += !writer.open(path);
+        error += !save_snapshot(context, writer, "bc4", tab, 16);
+        error += !writer.close();
+
+        // Overwrite, then restore channel 1 / block rows [16, 32) (texel rows [64, 128)) only
+        tab.to_gpu(context, 0xffffffffu);
+        Snapshot_Reader reader;
+        error += !reader.open(path);
+        error += reader.info(0).height != 64 || reader.info(0).width != 128;
+        error += !load_snapshot_tile(context, reader, "bc4", tab, 1, 1);
+
+        const unsigned char* data = (const unsigned char*)tab.to_cpu(context);
+        for (size_t c_idx = 0; c_idx < tab.channels; c_idx++)
+            for (size_t row = 0; row < 64; row++) {
+                size_t offset = c_idx * tab.slice_pitch() + row * tab.row_pitch();
+                bool restored = c_idx == 1 && row >= 16 && row < 32;
+                for (size_t i = 0; i < tab.row_pitch(); i++)
+                    error += data[offset + i] != (restored ? saved[offset + i] : 0xff);
+            }
 
-private:
-    D3D11_Compute_Shader m_compute_shader;
-    D3D11_Constant_Buffer m_constant_buffer;
-    Texture_As_Buffer m_tab_in0;
-    Texture_As_Buffer m_tab_in1;
-    Texture_As_Buffer m_tab_out;
-    const char* p_block_dim_x = "9";
-    const char* p_block_dim_y = "7";
-    
-    const UINT block_dim_x = atoi(p_block_dim_x);
-    const UINT block_dim_y = atoi(p_block_dim_y);
+        error += !load_snapshot(context, reader, "bc4", tab);
+        data = (const unsigned char*)tab.to_cpu(context);
+        error += memcmp(data, saved.data(), bytes) != 0;
+        reader.release();
+        std::remove(path);
 
+        if (error == 0)
+            std::cout << "Snapshot block-compressed device test passed!" << std::endl;
+        else
+            std::cout << "Snapshot block-compressed device test failed! Error: " << error << std::endl;
+        tab.release();
+    }
+private:
     union cast_float_to_int
     {
         float f;
         unsigned int i;
     };
-
-    struct Constant_Buffer
-    {
-        unsigned int time_index;
-        int height;
-        int width;
-        int align_padding;
-    } constant_buffer;
 };
 
-void run_shader_compile_test(ID3D11Device* device, ID3D11DeviceContext* context)
+void run_snapshot_test(ID3D11Device* device, ID3D11DeviceContext* context)
 {
-    std::cerr << "Running shader compile test..." << std::endl;
-    Shader_Compile_Tester tester;
-    tester.init(device, context);
-    tester.test(context);
-    tester.release();
+    std::cerr << "Running snapshot test..." << std::endl;
+    Snapshot_Tester tester;
+    tester.test_device(device, context, "snapshot_test.tabsnap");
+    tester.test_device_block(device, context, "snapshot_test.tabsnap");
+}
+
+class Pipeline_Scheduler_Tester : public Pipeline_Scheduler_Host_Tester
+{
+public:
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        const char* shader_code = R"(
+            Texture2DArray<float> in_texture : register(t0);
+            RWTexture2DArray<float> out_texture : register(u0);
+
+            [numthreads(16, 16, 1)]
+            void test_main(uint3 DTid : SV_DispatchThreadID)
+            {
+                uint width;
+                uint height;
+                uint channels;
+                out_texture.GetDimensions(width, height, channels);
+                if (DTid.x >= width || DTid.y >= height)
+                    return;
+
+                for (uint c = 0; c < channels; c++)
+                    out_texture[uint3(DTid.xy, c)] = in_texture[uint3(DTid.xy, c)] * 2.0f + 1.0f;
+            }
+        )";
+        D3D11_Compute_Shader shader;
+        shader.init_from_code_string(device, shader_code, "test_main");
+
+        for (size_t i = 0; i < m_outputs.size(); i++)
+            m_outputs[i].assign(m_item_elements, 0.0f);
+
+        D3D11_Pipeline_Backend backend;
+        backend.init(device, context, shader.shader, DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_R32_FLOAT, m_channels, m_height, m_width, 16, 16);
+        Pipeline_Scheduler scheduler;
+        if (!scheduler.start(&backend, 3, 2)) {
+            std::cout << "Pipeline scheduler device test failed! Could not start." << std::endl;
+            return;
+        }
+        for (size_t i = 0; i < m_inputs.size(); i++)
+            scheduler.submit(item(i));
+        Pipeline_Stats stats = scheduler.finish();
+        report("device", stats, verify() + scheduler.failures());
+    }
+};
+
+void run_pipeline_scheduler_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running pipeline scheduler test..." << std::endl;
+    Pipeline_Scheduler_Tester tester;
+    tester.init(48, 3, 128, 128);
+    tester.test_device(device, context);
+}
+
+class Expr_Graph_Tester : public Expr_Graph_Host_Tester
+{
+public:
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        Texture_As_Buffer tabs[4];
+        for (size_t k = 0; k < 4; k++) {
+            tabs[k].init(device, m_channels, m_height, m_width, DXGI_FORMAT_R32_FLOAT);
+            tabs[k].init_staging(device);
+            if (k < 3)
+                tabs[k].to_gpu(context, m_inputs[k].data());
+        }
+        Expr a = expr_input(tabs[0]);
+        Expr b = expr_input(tabs[1]);
+        Expr c = expr_input(tabs[2]);
+
+        D3D11_Expr_Evaluator evaluator;
+        evaluator.init(device, context);
+        size_t error = 0;
+        for (float k : { 0.5f, 3.0f }) {
+            Expr t = a + b;
+            error += !evaluator.eval(relu(t * k - c) + sqrt(abs(a)) * t, tabs[3]);
+            float* out = (float*)tabs[3].to_cpu(context);
+            for (size_t i = 0; i < m_count; i++)
+                error += std::fabs(out[i] - reference(i, k)) > 1e-4f;
+        }
+        error += evaluator.dispatches != 2 || evaluator.misses != 1 || evaluator.hits != 1;
+
+        if (error == 0)
+            std::cout << "Expression graph device test passed! " << evaluator.dispatches << " dispatches, " << evaluator.cache_size() << " cached kernel" << std::endl;
+        else
+            std::cout << "Expression graph device test failed! Error: " << error << std::endl;
+    }
+};
+
+void run_expr_graph_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running expression graph test..." << std::endl;
+    Expr_Graph_Tester tester;
+    tester.init(3, 250, 503);
+    tester.test_device(device, context);
+}
+
+class Reduction_Tester : public Reduction_Host_Tester
+{
+public:
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        Texture_As_Buffer tab;
+        tab.init(device, m_channels, m_height, m_width, DXGI_FORMAT_R32_FLOAT);
+        tab.init_staging(device);
+        tab.to_gpu(context, m_input.data());
+
+        size_t error = 0;
+        for (UINT group_size : { 64u, 256u, 1024u }) {
+            D3D11_Reduction reduction;
+            reduction.init(device, group_size);
+            for (unsigned int axes = 1; axes <= REDUCE_AXIS_ALL; axes++)
+                for (int op = REDUCE_SUM; op <= REDUCE_MEAN; op++) {
+                    Reduce_Shape shape;
+                    shape.init(m_channels, m_height, m_width, axes);
+                    Texture_As_Buffer out;
+                    out.init(device, shape.out_channels(), shape.out_height(), shape.out_width(), DXGI_FORMAT_R32_FLOAT);
+                    out.init_staging(device);
+                    error += !reduction.reduce(context, tab, axes, (Reduce_Op)op, out);
+
+                    std::vector<float> expected(shape.out_count());
+                    reduce(m_input.data(), shape, (Reduce_Op)op, expected.data());
+                    error += memcmp(out.to_cpu(context), expected.data(), expected.size() * sizeof(float)) != 0;
+                }
+        }
+
+        // Four channels per texel do not fit the planar kernels, they must be refused
+        D3D11_Reduction reduction;
+        reduction.init(device, 256);
+        Texture_As_Buffer interleaved;
+        interleaved.init(device, m_channels, m_height, m_width, DXGI_FORMAT_R32G32B32A32_FLOAT, TEXTURE_INTERLEAVED);
+        Texture_As_Buffer total;
+        total.init(device, 1, 1, 1, DXGI_FORMAT_R32_FLOAT);
+        error += reduction.reduce(context, interleaved, REDUCE_AXIS_ALL, REDUCE_SUM, total);
+        interleaved.release();
+        total.release();
+
+        if (error == 0)
+            std::cout << "Reduction device test passed! All group sizes match the host" << std::endl;
+        else
+            std::cout << "Reduction device test failed! Error: " << error << std::endl;
+        tab.release();
+    }
+
+    // Global and per-channel sums (contiguous runs): serial host loop vs pairwise host vs device
+    void benchmark(ID3D11Device* device, ID3D11DeviceContext* context, size_t channels, size_t height, size_t width)
+    {
+        const size_t count = channels * height * width;
+        std::vector<float> data(count);
+        for (size_t i = 0; i < count; i++)
+            data[i] = (float)(i % 255) / 255.0f;
+        const double gb = count * sizeof(float) / 1e9;
+
+        for (unsigned int axes : { (unsigned int)REDUCE_AXIS_ALL, (unsigned int)(REDUCE_AXIS_H | REDUCE_AXIS_W) }) {
+            Reduce_Shape shape;
+            shape.init(channels, height, width, axes);
+            std::vector<float> out(shape.out_count());
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t o = 0; o < shape.out_count(); o++) {
+                float sum = 0.0f;
+                const float* p = data.data() + o * shape.reduced_count();
+                for (size_t j = 0; j < shape.reduced_count(); j++)
+                    sum += p[j];
+                out[o] = sum;
+            }
+            double serial_ms = elapsed_ms(start);
+
+            start = std::chrono::high_resolution_clock::now();
+            reduce(data.data(), shape, REDUCE_SUM, out.data());
+            double host_ms = elapsed_ms(start);
+
+            Texture_As_Buffer tab, tab_out;
+            tab.init(device, channels, height, width, DXGI_FORMAT_R32_FLOAT);
+            tab.init_staging(device);
+            tab.to_gpu(context, data.data());
+            tab_out.init(device, shape.out_channels(), shape.out_height(), shape.out_width(), DXGI_FORMAT_R32_FLOAT);
+            D3D11_Reduction reduction;
+            reduction.init(device, 256);
+            D3D11_Performance_Counter counter;
+            counter.init(device);
+            reduction.reduce(context, tab, axes, REDUCE_SUM, tab_out);    // Warm up
+            counter.counter_start(context);
+            reduction.reduce(context, tab, axes, REDUCE_SUM, tab_out);
+            double device_ms = counter.counter_stop(context);
+
+            std::cout << "Reduction benchmark " << (axes == REDUCE_AXIS_ALL ? "global" : "per channel") << " sum of " << count << " values:"
+                << " serial loop " << gb / (serial_ms / 1000.0) << " GB/s, pairwise host " << gb / (host_ms / 1000.0) << " GB/s, device "
+                << gb / (device_ms / 1000.0) << " GB/s (" << reduction.last_passes << " passes)" << std::endl;
+        }
+    }
+private:
+    double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+};
+
+void run_reduction_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running reduction test..." << std::endl;
+    Reduction_Tester tester;
+    tester.init(3, 250, 503);
+    tester.test_device(device, context);
+    tester.benchmark(device, context, 16, 1024, 1024);
+}
+
+class Scan_Tester : public Scan_Host_Tester
+{
+public:
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        D3D11_Scan scanner;
+        scanner.init(device);
+        size_t error = 0;
+
+        // uint scan, exact
+        std::vector<uint32_t> small(m_count), expected(m_count), result(m_count);
+        for (size_t i = 0; i < m_count; i++)
+            small[i] = m_uint[i] & 0xff;
+        D3D11_Structured_Buffer in, out;
+        in.init(device, sizeof(uint32_t), m_count, true);
+        out.init(device, sizeof(uint32_t), m_count, true);
+        in.to_gpu(context, small.data());
+        for (Scan_Mode mode : { SCAN_EXCLUSIVE, SCAN_INCLUSIVE }) {
+            scan(small.data(), expected.data(), m_count, mode);
+            error += !scanner.scan(context, in, out, m_count, mode);
+            out.to_cpu(context, result.data());
+            error += result != expected;
+        }
+
+        // float scan, differs from the host only in summation order
+        std::vector<float> f_expected(m_count), f_result(m_count);
+        scan(m_float.data(), f_expected.data(), m_count, SCAN_INCLUSIVE);
+        in.to_gpu(context, m_float.data());
+        error += !scanner.scan(context, in, out, m_count, SCAN_INCLUSIVE, true);
+        out.to_cpu(context, f_result.data());
+        for (size_t i = 0; i < m_count; i++)
+            error += std::fabs(f_result[i] - f_expected[i]) > 1e-3f * (1.0f + std::fabs(f_expected[i]));
+
+        // Compaction straight from a texture, only the kept texels come back
+        Texture_As_Buffer tab;
+        size_t width = 1000;
+        tab.init(device, 1, m_count / width, width, DXGI_FORMAT_R32_FLOAT);
+        tab.to_gpu(context, m_float.data());
+        const size_t texels = tab.height * tab.width;
+        Compact_Predicate pred;
+        pred.op = COMPACT_LESS;
+        pred.threshold = -9.5f;
+        std::vector<float> values(texels), device_values(texels);
+        std::vector<uint32_t> indices(texels), device_indices(texels);
+        size_t kept = compact(m_float.data(), texels, pred, values.data(), indices.data());
+        error += !scanner.compact(context, tab, pred);
+        size_t device_kept = scanner.compacted_to_cpu(context, device_values.data(), device_indices.data());
+        error += device_kept != kept;
+        error += memcmp(values.data(), device_values.data(), kept * sizeof(float)) != 0;
+        error += memcmp(indices.data(), device_indices.data(), kept * sizeof(uint32_t)) != 0;
+
+        // Key-value sort against the host sort
+        std::vector<uint32_t> keys(m_uint), payload(m_count), device_keys(m_count), device_payload(m_count);
+        for (size_t i = 0; i < m_count; i++)
+            payload[i] = (uint32_t)i;
+        D3D11_Structured_Buffer key_buffer, value_buffer;
+        key_buffer.init(device, sizeof(uint32_t), m_count, true);
+        value_buffer.init(device, sizeof(uint32_t), m_count, true);
+        key_buffer.to_gpu(context, keys.data());
+        value_buffer.to_gpu(context, payload.data());
+        D3D11_Performance_Counter counter;
+        counter.init(device);
+        counter.counter_start(context);
+        error += !scanner.radix_sort(context, key_buffer, &value_buffer, m_count);
+        double sort_ms = counter.counter_stop(context);
+        radix_sort(keys.data(), payload.data(), m_count);
+        key_buffer.to_cpu(context, device_keys.data());
+        value_buffer.to_cpu(context, device_payload.data());
+        error += device_keys != keys || device_payload != payload;
+
+        if (error == 0)
+            std::cout << "Scan device test passed! Compaction read back " << kept * 8 + 4 << " of " << texels * 4 << " bytes, sort of "
+                << m_count << " pairs " << sort_ms << " ms" << std::endl;
+        else
+            std::cout << "Scan device test failed! Error: " << error << std::endl;
+        tab.release();
+    }
+};
+
+void run_scan_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running scan test..." << std::endl;
+    Scan_Tester tester;
+    tester.init(3000000);
+    tester.test_device(device, context);
+}
+
+class Constant_Ring_Tester : public Constant_Ring_Host_Tester
+{
+public:
+    // Many tiny dispatches, each accumulating its own time_index: per-update discard vs the ring
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context, UINT dispatches)
+    {
+        const char* shader_code = R"(
+            cbuffer Constant_Buffer : register(b0)
+            {
+                uint time_index;
+                uint3 align_padding;
+            };
+            RWTexture2DArray<float> output : register(u0);
+
+            [numthreads(16, 16, 1)]
+            void test_main(uint3 DTid : SV_DispatchThreadID)
+            {
+                output[uint3(DTid.xy, 0)] += time_index;
+            }
+        )";
+        D3D11_Compute_Shader shader;
+        shader.init_from_code_string(device, shader_code, "test_main");
+        Texture_As_Buffer tab;
+        tab.init(device, 1, 16, 16, DXGI_FORMAT_R32_FLOAT);
+        tab.init_staging(device);
+        UINT constants[4] = { 0, 0, 0, 0 };
+        const float expected = (float)dispatches * (float)(dispatches - 1) / 2.0f;
+        size_t error = 0;
+
+        // Baseline: one WRITE_DISCARD map per dispatch
+        D3D11_Constant_Buffer buffer;
+        buffer.init(device, sizeof(constants));
+        tab.to_gpu(context, (unsigned char)0);
+        context->CSSetShader(shader.shader, nullptr, 0);
+        context->CSSetUnorderedAccessViews(0, 1, &tab.p_texture_uav, nullptr);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (UINT i = 0; i < dispatches; i++) {
+            constants[0] = i;
+            buffer.to_gpu(context, constants);
+            context->CSSetConstantBuffers(0, 1, &buffer.p_buffer);
+            context->Dispatch(1, 1, 1);
+        }
+        float* data = (float*)tab.to_cpu(context);
+        double discard_ms = elapsed_ms(start);
+        error += data[0] != expected;
+
+        // Ring: one map per batch of 256 dispatches, small enough that batches wrap and retire
+        D3D11_Constant_Ring ring;
+        ring.init(device, context, 64 * 1024);
+        tab.to_gpu(context, (unsigned char)0);
+        context->CSSetShader(shader.shader, nullptr, 0);
+        context->CSSetUnorderedAccessViews(0, 1, &tab.p_texture_uav, nullptr);
+        start = std::chrono::high_resolution_clock::now();
+        std::vector<Ring_Slice> slices(256);
+        for (UINT first = 0; first < dispatches; first += 256) {
+            UINT count = dispatches - first < 256 ? dispatches - first : 256;
+            for (UINT i = 0; i < count; i++) {
+                constants[0] = first + i;
+                error += !ring.push(constants, sizeof(constants), slices[i]);
+            }
+            ring.commit();
+            for (UINT i = 0; i < count; i++) {
+                ring.bind(0, slices[i]);
+                context->Dispatch(1, 1, 1);
+            }
+            ring.end_batch();
+        }
+        data = (float*)tab.to_cpu(context);
+        double ring_ms = elapsed_ms(start);
+        error += data[0] != expected;
+
+        ID3D11UnorderedAccessView* nullUAV[1] = { nullptr };
+        context->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
+        if (error == 0)
+            std::cout << "Constant ring device test passed! " << dispatches << " dispatches: discard " << discard_ms << " ms (" << dispatches
+                << " maps), ring " << ring_ms << " ms (" << ring.maps << " maps, " << ring.waits << " waits"
+                << (ring.offsetting() ? "" : ", fallback") << ")" << std::endl;
+        else
+            std::cout << "Constant ring device test failed! Error: " << error << std::endl;
+        tab.release();
+    }
+private:
+    double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+};
+
+void run_constant_ring_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running constant ring test..." << std::endl;
+    Constant_Ring_Tester tester;
+    tester.test_device(device, context, 4000);
+}
+
+class Binding_Table_Tester : public Binding_Table_Host_Tester
+{
+public:
+    // Reflection of a real shader, then per-dispatch CPU cost of hand-coded binding vs a binding table
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context, UINT dispatches)
+    {
+        const char* shader_code = R"(
+            cbuffer Step_Constants : register(b0)
+            {
+                float scale;
+                float3 align_padding;
+            };
+            Texture2DArray<float> input_0 : register(t0);
+            StructuredBuffer<float> input_1 : register(t2);
+            RWTexture2DArray<float> output : register(u0);
+
+            [numthreads(16, 16, 1)]
+            void test_main(uint3 DTid : SV_DispatchThreadID)
+            {
+                output[uint3(DTid.xy, 0)] = input_0[uint3(DTid.xy, 0)] * scale + input_1[DTid.x];
+            }
+        )";
+        D3D11_Compute_Shader shader;
+        shader.init_from_code_string(device, shader_code, "test_main");
+        size_t error = 0;
+        D3D11_Binding_Table table;
+        error += !table.init(shader) || table.table.layout.slots() != 4;
+        int t2 = table.table.layout.find("input_1");
+        error += t2 < 0 || table.table.layout.bindings[t2].kind != BINDING_SRV || table.table.layout.bindings[t2].slot != 2;
+
+        // Ping-pong between two textures, as a multi-pass kernel would
+        Texture_As_Buffer tab[2];
+        for (int i = 0; i < 2; i++) {
+            tab[i].init(device, 1, 16, 16, DXGI_FORMAT_R32_FLOAT);
+            tab[i].init_staging(device);
+        }
+        D3D11_Structured_Buffer bias;
+        bias.init(device, sizeof(float), 16);
+        std::vector<float> ones(16, 1.0f);
+        bias.to_gpu(context, ones.data());
+        D3D11_Constant_Buffer constants;
+        constants.init(device, 16);
+        float c[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+        constants.to_gpu(context, c);
+
+        // Hand-coded, as the execute() functions above: bind every slot, dispatch, unbind
+        tab[0].to_gpu(context, (unsigned char)0);
+        ID3D11UnorderedAccessView* nullUAV[1] = { nullptr };
+        ID3D11ShaderResourceView* nullSRV[3] = { nullptr, nullptr, nullptr };
+        auto start = std::chrono::high_resolution_clock::now();
+        for (UINT i = 0; i < dispatches; i++) {
+            context->CSSetShader(shader.shader, nullptr, 0);
+            context->CSSetConstantBuffers(0, 1, &constants.p_buffer);
+            context->CSSetShaderResources(0, 1, &tab[i % 2].p_texture_srv);
+            context->CSSetShaderResources(2, 1, &bias.p_srv);
+            context->CSSetUnorderedAccessViews(0, 1, &tab[1 - i % 2].p_texture_uav, nullptr);
+            context->Dispatch(1, 1, 1);
+            context->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
+            context->CSSetShaderResources(0, 3, nullSRV);
+        }
+        float* data = (float*)tab[dispatches % 2].to_cpu(context);
+        double manual_ms = elapsed_ms(start);
+        error += data[0] != (float)dispatches;
+
+        // Binding table: only the swapped views are rebound
+        tab[0].to_gpu(context, (unsigned char)0);
+        D3D11_Binding_State state;
+        table.set_cb("Step_Constants", constants.p_buffer);
+        table.set_srv("input_1", bias.p_srv);
+        start = std::chrono::high_resolution_clock::now();
+        for (UINT i = 0; i < dispatches; i++) {
+            table.set_srv("input_0", tab[i % 2].p_texture_srv);
+            table.set_uav("output", tab[1 - i % 2].p_texture_uav);
+            state.dispatch(context, table, 1, 1, 1);
+        }
+        state.clear(context);
+        data = (float*)tab[dispatches % 2].to_cpu(context);
+        double table_ms = elapsed_ms(start);
+        error += data[0] != (float)dispatches;
+
+        if (error == 0)
+            std::cout << "Binding table device test passed! " << dispatches << " dispatches: hand-coded " << manual_ms << " ms ("
+                << dispatches * 7 << " calls), table " << table_ms << " ms (" << state.stats().calls + state.stats().shader_sets << " calls)" << std::endl;
+        else
+            std::cout << "Binding table device test failed! Error: " << error << std::endl;
+        tab[0].release();
+        tab[1].release();
+    }
+private:
+    double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+};
+
+void run_binding_table_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running binding table test..." << std::endl;
+    Binding_Table_Tester tester;
+    tester.test_device(device, context, 2000);
+}
+
+class Indirect_Dispatch_Tester : public Indirect_Dispatch_Host_Tester
+{
+public:
+    // Compaction then processing of the survivors: reading the count back first vs DispatchIndirect
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context, int repeats)
+    {
+        const char* shader_code = R"(
+            StructuredBuffer<uint> item_count : register(t0);
+            RWStructuredBuffer<float> items : register(u0);
+
+            [numthreads(256, 1, 1)]
+            void square_main(uint3 Gid : SV_GroupID, uint tid : SV_GroupIndex)
+            {
+                uint i = (Gid.y * 65535 + Gid.x) * 256 + tid;
+                if (i < item_count[0])
+                    items[i] = items[i] * items[i];
+            }
+        )";
+        D3D11_Compute_Shader shader;
+        shader.init_from_code_string(device, shader_code, "square_main");
+        D3D11_Scan scanner;
+        scanner.init(device);
+        D3D11_Indirect_Dispatch indirect;
+        indirect.init(device);
+        Texture_As_Buffer tab;
+        tab.init(device, 1, m_height, m_width, DXGI_FORMAT_R32_FLOAT);
+        tab.to_gpu(context, m_values.data());
+
+        Compact_Predicate pred;
+        pred.op = COMPACT_GREATER;
+        pred.threshold = 5.0f;
+        std::vector<float> expected;
+        for (float v : m_values)
+            if (pred.test(v))
+                expected.push_back(v * v);
+        std::vector<float> result(m_values.size());
+        size_t error = 0;
+        D3D11_Binding_Table table;
+        table.init(shader);
+        D3D11_Binding_State bindings;
+
+        // Baseline: the CPU waits for the count to size the second dispatch
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repeats; r++) {
+            scanner.compact(context, tab, pred);
+            uint32_t count = 0;
+            scanner.compacted_count.to_cpu(context, &count, 1);
+            Dispatch_Args a = dispatch_args_for_count(count, 256);
+            table.set_srv("item_count", scanner.compacted_count.p_srv);
+            table.set_uav("items", scanner.compacted_values.p_uav);
+            bindings.dispatch(context, table, a.x, a.y, a.z);
+            bindings.clear(context);
+        }
+        size_t kept = scanner.compacted_to_cpu(context, result.data(), nullptr);
+        double readback_ms = elapsed_ms(start);
+        error += check(result, kept, expected);
+
+        // Indirect: the count never leaves the GPU until the final readback
+        start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repeats; r++) {
+            scanner.compact(context, tab, pred);
+            indirect.args_from_count(context, scanner.compacted_count, 256, 0);
+            table.set_srv("item_count", scanner.compacted_count.p_srv);
+            table.set_uav("items", scanner.compacted_values.p_uav);
+            bindings.apply(context, table);
+            indirect.dispatch(context, 0);
+            bindings.clear(context);
+        }
+        kept = scanner.compacted_to_cpu(context, result.data(), nullptr);
+        double indirect_ms = elapsed_ms(start);
+        error += check(result, kept, expected);
+        Dispatch_Args a;
+        error += !indirect.args_to_cpu(context, 0, a) || a.x != dispatch_args_for_count(expected.size(), 256).x;
+
+        if (error == 0)
+            std::cout << "Indirect dispatch device test passed! " << repeats << " x compact + process " << expected.size() << " values: count readback "
+                << readback_ms << " ms, indirect " << indirect_ms << " ms" << std::endl;
+        else
+            std::cout << "Indirect dispatch device test failed! Error: " << error << std::endl;
+        tab.release();
+    }
+private:
+    size_t check(const std::vector<float>& result, size_t kept, const std::vector<float>& expected)
+    {
+        size_t error = kept != expected.size();
+        for (size_t i = 0; i < kept && i < expected.size(); i++)
+            error += result[i] != expected[i];
+        return error;
+    }
+
+    double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+};
+
+void run_indirect_dispatch_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running indirect dispatch test..." << std::endl;
+    Indirect_Dispatch_Tester tester;
+    tester.init(1024, 1024);
+    tester.test_device(device, context, 20);
+}
+
+class Sparse_Texture_Tester : public Sparse_Texture_Host_Tester
+{
+public:
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        Texture_As_Buffer dense;
+        dense.init(device, m_channels, m_height, m_width, DXGI_FORMAT_R32_FLOAT);
+        dense.init_staging(device);
+        for (int allow_tiled = 1; allow_tiled >= 0; allow_tiled--) {
+            D3D11_Sparse_Texture_Array sparse;
+            sparse.init(device, context, m_channels, m_height, m_width, DXGI_FORMAT_R32_FLOAT, 64, allow_tiled != 0);
+            if (allow_tiled && !sparse.tiled()) {
+                std::cout << "Sparse texture device test: tiled resources tier 2 not supported, indirection only." << std::endl;
+                continue;
+            }
+            size_t error = 0;
+            error += !sparse.to_gpu(context, m_dense.data());
+            error += !sparse.to_dense(context, dense);
+            float* data = (float*)dense.to_cpu(context);
+            for (size_t i = 0; i < m_dense.size(); i++)
+                error += data[i] != m_dense[i];
+
+            // Dropping a channel leaves zeros behind
+            sparse.unmap_channel(context, 3);
+            error += !sparse.to_dense(context, dense);
+            data = (float*)dense.to_cpu(context);
+            for (size_t i = 0; i < m_dense.size(); i++)
+                error += data[i] != (i / (m_height * m_width) == 3 ? 0.0f : m_dense[i]);
+
+            if (error == 0)
+                std::cout << "Sparse texture device test passed! " << (sparse.tiled() ? "Tiled" : "Indirection") << ": resident "
+                    << sparse.resident_bytes() / 1024 << " KB, uploaded " << sparse.uploaded_bytes / 1024 << " KB, dense "
+                    << sparse.dense_bytes() / 1024 << " KB" << std::endl;
+            else
+                std::cout << "Sparse texture device test failed! Error: " << error << std::endl;
+        }
+        dense.release();
+    }
+};
+
+void run_sparse_texture_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running sparse texture test..." << std::endl;
+    Sparse_Texture_Tester tester;
+    tester.init(64, 300, 200);
+    tester.test_device(device, context);
+}
+
+class Compressed_Texture_Tester : public Compressed_Texture_Host_Tester
+{
+public:
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        Texture_As_Buffer dense;
+        dense.init(device, m_channels, m_height, m_width, DXGI_FORMAT_R32_FLOAT);
+        dense.init_staging(device);
+        for (int f = COMPRESSED_BC4_UNORM; f <= COMPRESSED_INT8_TILE; f++) {
+            size_t error = 0;
+            D3D11_Compressed_Texture_Array compressed;
+            compressed.init(device, context, (Compressed_Format)f, m_channels, m_height, m_width);
+            const Compressed_Layout& layout = compressed.layout;
+            std::vector<float> src = source(layout);
+            error += !compressed.to_gpu(context, src.data());
+
+            // Stored bytes are exactly the host encoding (block rows for BC formats)
+            std::vector<unsigned char> data(layout.data_bytes());
+            std::vector<float> params(layout.param_count()), host(src.size());
+            compress(layout, src.data(), data.data(), params.data());
+            const unsigned char* stored = (const unsigned char*)compressed.texture.to_cpu(context);
+            error += stored == nullptr || memcmp(stored, data.data(), data.size()) != 0;
+
+            // The sampler has to agree with the host decoder up to one 8-bit step of interpolation precision
+            decompress(layout, data.data(), params.data(), host.data());
+            error += !compressed.to_dense(context, dense);
+            const float* device_out = (const float*)dense.to_cpu(context);
+            Compression_Error e = compression_error(host.data(), device_out, host.size());
+            error += e.max_abs > 1.0 / 255.0;
+
+            if (error == 0)
+                std::cout << "Compressed texture device test passed! " << format_name(layout.format) << ": stored "
+                    << compressed.stored_bytes() / 1024 << " KB of " << src.size() * sizeof(float) / 1024 << " KB, max error vs host decoder "
+                    << e.max_abs << std::endl;
+            else
+                std::cout << "Compressed texture device test failed! " << format_name(layout.format) << " Error: " << error << std::endl;
+        }
+        dense.release();
+    }
+
+    // Expanding a large array is bound by reading the compressed storage
+    void benchmark(ID3D11Device* device, ID3D11DeviceContext* context, size_t channels, size_t height, size_t width)
+    {
+        std::vector<float> src(channels * height * width);
+        uint32_t state = 11u;
+        for (float& v : src) {
+            state = state * 1664525u + 1013904223u;
+            v = (float)(state >> 8) / 16777216.0f;
+        }
+        Texture_As_Buffer dense;
+        dense.init(device, channels, height, width, DXGI_FORMAT_R32_FLOAT);
+        D3D11_Performance_Counter counter;
+        counter.init(device);
+        for (int f = COMPRESSED_BC4_UNORM; f <= COMPRESSED_INT8_TILE; f++) {
+            if (f == COMPRESSED_BC4_SNORM || f == COMPRESSED_BC5_SNORM)
+                continue;
+            D3D11_Compressed_Texture_Array compressed;
+            compressed.init(device, context, (Compressed_Format)f, channels, height, width);
+            compressed.to_gpu(context, src.data());
+            compressed.to_dense(context, dense);  // Warm up
+            counter.counter_start(context);
+            compressed.to_dense(context, dense);
+            double ms = counter.counter_stop(context);
+            std::cout << "Compressed texture benchmark " << format_name(compressed.layout.format) << ": " << ms << " ms, "
+                << compressed.stored_bytes() / (ms * 1e6) << " GB/s stored, " << src.size() * sizeof(float) / (ms * 1e6)
+                << " GB/s as float" << std::endl;
+        }
+        dense.release();
+    }
+};
+
+void run_compressed_texture_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running compressed texture test..." << std::endl;
+    Compressed_Texture_Tester tester;
+    // Same shape as the read test: 503 columns leave a partial block at the right edge
+    tester.init(3, 250, 503);
+    tester.test_device(device, context);
+    tester.benchmark(device, context, 16, 1024, 1024);
+}
+
+class Interleaved_Layout_Tester
+{
+public:
+    void init(ID3D11Device* device)
+    {
+        m_device = device;
+        const char* shader_code = R"(
+        Texture2DArray<SCALAR> in_planar : register(t0);
+        RWTexture2DArray<SCALAR> out_planar : register(u0);
+        Texture2DArray<VECTOR> in_interleaved : register(t1);
+        RWTexture2DArray<VECTOR> out_interleaved : register(u1);
+
+        // One scalar load and store per channel slice
+        [numthreads(16, 16, 1)]
+        void planar_main(uint3 DTid : SV_DispatchThreadID)
+        {
+            uint width, height, slices;
+            out_planar.GetDimensions(width, height, slices);
+            if (DTid.x >= width || DTid.y >= height)
+                return;
+            for (uint c = 0; c < slices; c++)
+                out_planar[uint3(DTid.xy, c)] = in_planar[uint3(DTid.xy, c)] * 0.5f + 0.25f;
+        }
+
+        // One vector load and store per group of four channels
+        [numthreads(16, 16, 1)]
+        void interleaved_main(uint3 DTid : SV_DispatchThreadID)
+        {
+            uint width, height, slices;
+            out_interleaved.GetDimensions(width, height, slices);
+            if (DTid.x >= width || DTid.y >= height)
+                return;
+            for (uint g = 0; g < slices; g++)
+                out_interleaved[uint3(DTid.xy, g)] = in_interleaved[uint3(DTid.xy, g)] * 0.5f + 0.25f;
+        }
+        )";
+
+        const Format_Pair pairs[3] = {
+            { DXGI_FORMAT_R8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, "unorm float", "unorm float4", "8-bit" },
+            { DXGI_FORMAT_R16_FLOAT, DXGI_FORMAT_R16G16B16A16_FLOAT, "float", "float4", "16-bit" },
+            { DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT, "float", "float4", "32-bit" }
+        };
+        for (int i = 0; i < 3; i++) {
+            m_pairs[i] = pairs[i];
+            D3D_SHADER_MACRO defines[3] = { { "SCALAR", pairs[i].scalar }, { "VECTOR", pairs[i].vector }, { nullptr, nullptr } };
+            m_planar_shader[i].init_from_code_string(device, shader_code, "planar_main", defines);
+            m_interleaved_shader[i].init_from_code_string(device, shader_code, "interleaved_main", defines);
+            m_planar_table[i].init(m_planar_shader[i]);
+            m_interleaved_table[i].init(m_interleaved_shader[i]);
+        }
+    }
+
+    // 6 channels leave the second group half empty
+    void test(ID3D11DeviceContext* context, size_t channels, size_t height, size_t width)
+    {
+        for (int i = 0; i < 3; i++) {
+            size_t error = 0;
+            Texture_As_Buffer planar_in, planar_out, interleaved_in, interleaved_out;
+            init_pair(i, channels, height, width, planar_in, planar_out, interleaved_in, interleaved_out);
+            std::vector<unsigned char> data = make_data(planar_in.element_size, channels * height * width);
+
+            // Transfers interleave and deinterleave, so the host sees the same planar array either way
+            interleaved_in.to_gpu(context, data.data());
+            const unsigned char* back = (const unsigned char*)interleaved_in.to_cpu(context);
+            error += back == nullptr || memcmp(back, data.data(), data.size()) != 0;
+            error += interleaved_in.slices() != (channels + 3) / 4 || interleaved_in.element_size != planar_in.element_size;
+
+            // Both kernels compute the same thing, channel c of the interleaved texture is component c % 4 of slice c / 4
+            planar_in.to_gpu(context, data.data());
+            run(context, i, planar_in, planar_out, interleaved_in, interleaved_out);
+            std::vector<unsigned char> expected(data.size());
+            error += !planar_out.to_cpu(context, expected.data(), planar_out.row_pitch(), planar_out.slice_pitch());
+            back = (const unsigned char*)interleaved_out.to_cpu(context);
+            error += back == nullptr || memcmp(back, expected.data(), expected.size()) != 0;
+
+            if (error == 0)
+                std::cout << "Interleaved layout test passed! " << m_pairs[i].name << " " << channels << " channels in "
+                    << interleaved_in.slices() << " slices" << std::endl;
+            else
+                std::cout << "Interleaved layout test failed! " << m_pairs[i].name << " Error: " << error << std::endl;
+        }
+    }
+
+    void benchmark(ID3D11DeviceContext* context, size_t channels, size_t height, size_t width)
+    {
+        D3D11_Performance_Counter counter;
+        counter.init(m_device);
+        for (int i = 0; i < 3; i++) {
+            Texture_As_Buffer planar_in, planar_out, interleaved_in, interleaved_out;
+            init_pair(i, channels, height, width, planar_in, planar_out, interleaved_in, interleaved_out);
+            std::vector<unsigned char> data = make_data(planar_in.element_size, channels * height * width);
+            const double gb = 2.0 * data.size() / 1e9;     // Read once, written once
+
+            auto start = std::chrono::high_resolution_clock::now();
+            planar_in.to_gpu(context, data.data());
+            double planar_upload_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            start = std::chrono::high_resolution_clock::now();
+            interleaved_in.to_gpu(context, data.data());
+            double interleaved_upload_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            const UINT gx = (UINT)((width + 15) / 16), gy = (UINT)((height + 15) / 16);
+            run(context, i, planar_in, planar_out, interleaved_in, interleaved_out);  // Warm up
+            counter.counter_start(context);
+            m_bindings.dispatch(context, m_planar_table[i], gx, gy, 1);
+            double planar_ms = counter.counter_stop(context);
+            counter.counter_start(context);
+            m_bindings.dispatch(context, m_interleaved_table[i], gx, gy, 1);
+            double interleaved_ms = counter.counter_stop(context);
+            m_bindings.clear(context);
+
+            std::cout << "Interleaved layout benchmark " << m_pairs[i].name << " " << channels << "x" << height << "x" << width
+                << ": planar " << gb / (planar_ms / 1000.0) << " GB/s, interleaved " << gb / (interleaved_ms / 1000.0)
+                << " GB/s; upload planar " << planar_upload_ms << " ms, interleaved " << interleaved_upload_ms << " ms" << std::endl;
+        }
+    }
+
+private:
+    struct Format_Pair
+    {
+        DXGI_FORMAT planar;
+        DXGI_FORMAT interleaved;
+        const char* scalar;
+        const char* vector;
+        const char* name;
+    };
+
+    void init_pair(int i, size_t channels, size_t height, size_t width, Texture_As_Buffer& planar_in, Texture_As_Buffer& planar_out,
+        Texture_As_Buffer& interleaved_in, Texture_As_Buffer& interleaved_out)
+    {
+        planar_in.init(m_device, channels, height, width, m_pairs[i].planar);
+        planar_out.init(m_device, channels, height, width, m_pairs[i].planar);
+        interleaved_in.init(m_device, channels, height, width, m_pairs[i].interleaved, TEXTURE_INTERLEAVED);
+        interleaved_out.init(m_device, channels, height, width, m_pairs[i].interleaved, TEXTURE_INTERLEAVED);
+        planar_in.init_staging(m_device);
+        planar_out.init_staging(m_device);
+        interleaved_in.init_staging(m_device);
+        interleaved_out.init_staging(m_device);
+        m_planar_table[i].set_srv("in_planar", planar_in.p_texture_srv);
+        m_planar_table[i].set_uav("out_planar", planar_out.p_texture_uav);
+        m_interleaved_table[i].set_srv("in_interleaved", interleaved_in.p_texture_srv);
+        m_interleaved_table[i].set_uav("out_interleaved", interleaved_out.p_texture_uav);
+    }
+
+    void run(ID3D11DeviceContext* context, int i, Texture_As_Buffer& planar_in, Texture_As_Buffer& planar_out,
+        Texture_As_Buffer& interleaved_in, Texture_As_Buffer& interleaved_out)
+    {
+        const UINT gx = (UINT)((planar_in.width + 15) / 16), gy = (UINT)((planar_in.height + 15) / 16);
+        m_bindings.dispatch(context, m_planar_table[i], gx, gy, 1);
+        m_bindings.dispatch(context, m_interleaved_table[i], gx, gy, 1);
+        m_bindings.clear(context);
+    }
+
+    // Values in [0, 1) in the element format: 8-bit unorm, half or float
+    static std::vector<unsigned char> make_data(size_t element_size, size_t count)
+    {
+        std::vector<unsigned char> data(count * element_size);
+        uint32_t state = 5u;
+        for (size_t i = 0; i < count; i++) {
+            state = state * 1664525u + 1013904223u;
+            float v = (float)(state >> 8) / 16777216.0f;
+            if (element_size == 1)
+                data[i] = (unsigned char)(state >> 24);
+            else if (element_size == 2)
+                ((DirectX::PackedVector::HALF*)data.data())[i] = DirectX::PackedVector::XMConvertFloatToHalf(v);
+            else
+                ((float*)data.data())[i] = v;
+        }
+        return data;
+    }
+
+    ID3D11Device* m_device = nullptr;
+    Format_Pair m_pairs[3] = {};
+    D3D11_Compute_Shader m_planar_shader[3];
+    D3D11_Compute_Shader m_interleaved_shader[3];
+    D3D11_Binding_Table m_planar_table[3];
+    D3D11_Binding_Table m_interleaved_table[3];
+    D3D11_Binding_State m_bindings;
+};
+
+void run_interleaved_layout_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running interleaved layout test..." << std::endl;
+    Interleaved_Layout_Tester tester;
+    tester.init(device);
+    tester.test(context, 6, 250, 503);
+    tester.benchmark(context, 16, 1024, 1024);
+}
+
+class Layout_Transform_Tester : public Layout_Transform_Host_Tester
+{
+public:
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context, size_t channels, size_t height, size_t width)
+    {
+        const DXGI_FORMAT formats[3] = { DXGI_FORMAT_R8_UNORM, DXGI_FORMAT_R16_FLOAT, DXGI_FORMAT_R32_FLOAT };
+        for (DXGI_FORMAT format : formats) {
+            size_t error = 0;
+            Texture_As_Buffer tab;
+            tab.init(device, channels, height, width, format);
+            tab.init_staging(device);
+            std::vector<unsigned char> hwc = make_data(tab.element_size, channels * height * width);
+            std::vector<unsigned char> expected = naive_hwc_to_chw(hwc, channels, height, width, tab.element_size);
+            std::vector<unsigned char> back(hwc.size());
+
+            // Host transpose fused into the staging copy
+            tab.to_gpu_hwc(context, hwc.data());
+            const unsigned char* planar = (const unsigned char*)tab.to_cpu(context);
+            error += planar == nullptr || memcmp(planar, expected.data(), expected.size()) != 0;
+            error += !tab.to_cpu_hwc(context, back.data()) || back != hwc;
+
+            // Device transpose: HWC goes up as-is
+            D3D11_Layout_Transform transform;
+            transform.init(device, context, channels, height, width, format);
+            tab.to_gpu(context, (unsigned char)0);
+            error += !transform.hwc_to_gpu(context, hwc.data(), tab);
+            planar = (const unsigned char*)tab.to_cpu(context);
+            error += planar == nullptr || memcmp(planar, expected.data(), expected.size()) != 0;
+            std::fill(back.begin(), back.end(), 0);
+            error += !transform.hwc_to_cpu(context, tab, back.data()) || back != hwc;
+
+            // A texture of the same element size but another format must be refused
+            if (format == DXGI_FORMAT_R32_FLOAT) {
+                Texture_As_Buffer other;
+                other.init(device, channels, height, width, DXGI_FORMAT_R8G8B8A8_UNORM);
+                error += transform.hwc_to_gpu(context, hwc.data(), other);
+                other.release();
+            }
+
+            if (error == 0)
+                std::cout << "Layout transform device test passed! " << tab.element_size * 8 << "-bit" << std::endl;
+            else
+                std::cout << "Layout transform device test failed! " << tab.element_size * 8 << "-bit Error: " << error << std::endl;
+        }
+    }
+
+    // Upload of one HWC image three ways: host transpose then planar upload, transpose fused into the staging
+    // copy, and a plain upload transposed on device. The readback mirrors it.
+    void benchmark_device(ID3D11Device* device, ID3D11DeviceContext* context, size_t channels, size_t height, size_t width)
+    {
+        Texture_As_Buffer tab;
+        tab.init(device, channels, height, width, DXGI_FORMAT_R32_FLOAT);
+        tab.init_staging(device);
+        D3D11_Layout_Transform transform;
+        transform.init(device, context, channels, height, width, DXGI_FORMAT_R32_FLOAT);
+        D3D11_Performance_Counter counter;
+        counter.init(device);
+        std::vector<unsigned char> hwc = make_data(4, channels * height * width), chw(hwc.size());
+        const double gb = hwc.size() / 1e9;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        hwc_to_chw(hwc.data(), chw.data(), channels, height, width, 4);
+        tab.to_gpu(context, chw.data());
+        tab.to_cpu(context);
+        double separate_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        start = std::chrono::high_resolution_clock::now();
+        tab.to_gpu_hwc(context, hwc.data());
+        tab.to_cpu(context);
+        double fused_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        start = std::chrono::high_resolution_clock::now();
+        transform.hwc_to_gpu(context, hwc.data(), tab);
+        tab.to_cpu(context);
+        double device_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        transform.to_planar(context, tab);  // Warm up
+        counter.counter_start(context);
+        transform.to_planar(context, tab);
+        double to_planar_ms = counter.counter_stop(context);
+        counter.counter_start(context);
+        transform.to_hwc(context, tab);
+        double to_hwc_ms = counter.counter_stop(context);
+
+        start = std::chrono::high_resolution_clock::now();
+        tab.to_cpu_hwc(context, hwc.data());
+        double fused_back_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        start = std::chrono::high_resolution_clock::now();
+        transform.hwc_to_cpu(context, tab, hwc.data());
+        double device_back_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        std::cout << "Layout transform device benchmark " << channels << "x" << height << "x" << width << " 32-bit: upload + readback"
+            << " host transpose " << separate_ms << " ms, fused " << fused_ms << " ms, device " << device_ms << " ms; kernels HWC->CHW "
+            << gb / (to_planar_ms / 1000.0) << " GB/s, CHW->HWC " << gb / (to_hwc_ms / 1000.0) << " GB/s; HWC readback fused "
+            << fused_back_ms << " ms, device " << device_back_ms << " ms" << std::endl;
+    }
+};
+
+void run_layout_transform_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running layout transform test..." << std::endl;
+    Layout_Transform_Tester tester;
+    tester.test_device(device, context, 3, 250, 503);
+    tester.benchmark_device(device, context, 3, 2160, 3840);
+}
+
+class Residency_Tester : public Residency_Host_Tester
+{
+public:
+    // Six arrays under a cap of three: each use() brings its array back with its data intact
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        size_t error = 0;
+        std::vector<Texture_As_Buffer> textures(6);
+        for (size_t i = 0; i < textures.size(); i++) {
+            textures[i].init(device, 4, 500, 503, DXGI_FORMAT_R32_FLOAT);
+            textures[i].init_staging(device);
+            textures[i].to_gpu(context, (unsigned int)(i + 1));
+        }
+        Residency_Footprint f = texture_footprint(4, 500, 503 * sizeof(float), true, textures[0].staging_row_pitch(context));
+
+        D3D11_Residency_Manager residency;
+        residency.init(device, context, 3 * f.total());
+        std::vector<size_t> ids;
+        for (size_t i = 0; i < textures.size(); i++)
+            ids.push_back(residency.track(textures[i], ("texture " + std::to_string(i)).c_str()));
+        error += residency.manager.stats().resident != 3;
+
+        for (int round = 0; round < 2; round++)
+            for (size_t i = 0; i < textures.size(); i++) {
+                error += !residency.use(ids[i]);
+                const unsigned int* data = (const unsigned int*)textures[i].to_cpu(context);
+                error += data == nullptr || data[0] != i + 1 || data[4 * 500 * 503 - 1] != i + 1;
+            }
+        Residency_Stats s = residency.manager.stats();
+        error += s.used > s.budget || s.staging != 3 * f.staging_bytes;
+
+        if (error == 0)
+            std::cout << "Residency device test passed! Adapter budget " << residency.adapter_budget / (1024 * 1024) << " MB\n"
+                << residency.manager.report();
+        else
+            std::cout << "Residency device test failed! Error: " << error << std::endl;
+        for (size_t id : ids)
+            residency.untrack(id);
+    }
+};
+
+void run_residency_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running residency test..." << std::endl;
+    Residency_Tester tester;
+    tester.test_device(device, context);
+}
+
+class Metrics_Tester : public Metrics_Host_Tester
+{
+public:
+    // The library's own transfers, compiles and timings show up in metrics()
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        size_t error = 0;
+        const int64_t uploads = value("d3d11_uploads_total"), upload_bytes = value("d3d11_upload_bytes_total");
+        const int64_t download_bytes = value("d3d11_download_bytes_total"), allocated = value("d3d11_allocated_bytes");
+        const int64_t compiles = value("d3d11_shader_compiles_total"), constant_bytes = value("d3d11_constant_upload_bytes_total");
+        const int64_t dispatches = value("d3d11_dispatches_total"), groups = value("d3d11_dispatch_groups_total");
+        Metric_Snapshot stalls_before, gpu_before;
+        metrics().find("d3d11_map_stall_microseconds", stalls_before);
+        metrics().find("d3d11_gpu_time_milliseconds", gpu_before);
+
+        {
+            Texture_As_Buffer tab;
+            tab.init(device, 3, 256, 256, DXGI_FORMAT_R32_FLOAT);
+            tab.init_staging(device);
+            error += value("d3d11_allocated_bytes") - allocated != 2 * 3 * 256 * 256 * 4;
+
+            D3D11_Compute_Shader shader;
+            shader.init_from_code_string(device,
+                "cbuffer params : register(b0) { float scale; float3 pad; };\n"
+                "RWTexture2DArray<float> output : register(u0);\n"
+                "[numthreads(8, 8, 1)] void main(uint3 id : SV_DispatchThreadID) { output[id] = output[id] * scale; }\n", "main");
+            D3D11_Constant_Buffer params;
+            params.init(device, 16);
+            const float scale[4] = { 2.0f, 0.0f, 0.0f, 0.0f };
+            params.to_gpu(context, scale);
+
+            D3D11_Binding_Table table;
+            table.init(shader);
+            table.set_uav("output", tab.p_texture_uav);
+            table.set_cb("params", params.p_buffer);
+            D3D11_Binding_State state;
+            D3D11_Performance_Counter counter;
+            counter.init(device);
+            tab.to_gpu(context, (unsigned int)0x3f800000);
+            counter.counter_start(context);
+            state.dispatch(context, table, 256 / 8, 256 / 8, 3);
+            counter.counter_stop(context);
+            state.clear(context);
+            const float* data = (const float*)tab.to_cpu(context);
+            error += data == nullptr || data[0] != 2.0f;
+
+            error += value("d3d11_uploads_total") - uploads != 1 || value("d3d11_upload_bytes_total") - upload_bytes != 3 * 256 * 256 * 4;
+            error += value("d3d11_download_bytes_total") - download_bytes != 3 * 256 * 256 * 4;
+            error += value("d3d11_shader_compiles_total") - compiles != 1 || value("d3d11_constant_upload_bytes_total") - constant_bytes != 16;
+            error += value("d3d11_dispatches_total") - dispatches != 1 || value("d3d11_dispatch_groups_total") - groups != 32 * 32 * 3;
+        }
+        // Everything created above has been released
+        error += value("d3d11_allocated_bytes") != allocated;
+        Metric_Snapshot stalls, gpu;
+        metrics().find("d3d11_map_stall_microseconds", stalls);
+        metrics().find("d3d11_gpu_time_milliseconds", gpu);
+        error += stalls.count - stalls_before.count != 6 || gpu.count - gpu_before.count != 1;
+
+        if (error == 0)
+            std::cout << "Metrics device test passed! Snapshot:\n" << metrics().to_json();
+        else
+            std::cout << "Metrics device test failed! Error: " << error << std::endl;
+    }
+};
+
+void run_metrics_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running metrics test..." << std::endl;
+    Metrics_Tester tester;
+    tester.test_device(device, context);
+}
+
+class Kernel_Stats_Tester : public Kernel_Stats_Host_Tester
+{
+public:
+    // array_sum with two group shapes; the bandwidth roof is what a CopyResource of the same bytes achieves
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context, size_t channels, size_t height, size_t width)
+    {
+        size_t error = 0;
+        Texture_As_Buffer in0, in1, out, copy;
+        in0.init(device, channels, height, width, DXGI_FORMAT_R32_FLOAT);
+        in1.init(device, channels, height, width, DXGI_FORMAT_R32_FLOAT);
+        out.init(device, channels, height, width, DXGI_FORMAT_R32_FLOAT);
+        copy.init(device, channels, height, width, DXGI_FORMAT_R32_FLOAT);
+        const uint64_t bytes = channels * height * width * sizeof(float);
+
+        D3D11_Performance_Counter counter;
+        counter.init(device, true);
+        double copy_ms = 1e30;
+        for (int i = 0; i < 5; i++) {
+            counter.counter_start(context);
+            context->CopyResource(copy.p_texture, in0.p_texture);
+            double ms = counter.counter_stop(context);
+            copy_ms = ms > 0.0 && ms < copy_ms ? ms : copy_ms;
+        }
+        Device_Peaks peaks;
+        peaks.bandwidth_gbs = 2 * bytes / (copy_ms * 1e6);
+
+        D3D11_Constant_Buffer params;
+        params.init(device, 16);
+        const int constants[4] = { 0, (int)height, (int)width, 0 };
+        params.to_gpu(context, constants);
+        Kernel_Work work;
+        work.bytes_read = 2 * bytes;
+        work.bytes_written = bytes;
+        work.ops = 2 * bytes / sizeof(float);
+        work.elements = bytes / sizeof(float);
+
+        std::cout << "Kernel stats device test, copy roof " << peaks.bandwidth_gbs << " GB/s" << std::endl;
+        const char* shapes[2][2] = { { "9", "7" }, { "16", "16" } };
+        for (auto& shape : shapes) {
+            D3D_SHADER_MACRO defines[] = { { "THREAD_GROUP_SIZE_X", shape[0] }, { "THREAD_GROUP_SIZE_Y", shape[1] }, { nullptr, nullptr } };
+            D3D11_Compute_Shader shader;
+            shader.init_from_file(device, "shaders/array_sum.hlsl", "main", defines);
+            D3D11_Binding_Table table;
+            table.init(shader);
+            table.set_srv("input_0", in0.p_texture_srv);
+            table.set_srv("input_1", in1.p_texture_srv);
+            table.set_uav("output", out.p_texture_uav);
+            table.set_cb("Constant_Buffer", params.p_buffer);
+            D3D11_Binding_State state;
+
+            // One thread per pixel, looping over the channels
+            Kernel_Shape k = Kernel_Shape::cover(atoi(shape[0]), atoi(shape[1]), 1, width, height, 1);
+            counter.counter_start(context);
+            state.dispatch(context, table, k.groups_x, k.groups_y, 1);
+            counter.counter_stop(context);
+            state.clear(context);
+
+            Kernel_Metrics m = counter.kernel_metrics(k, work, peaks);
+            error += counter.statistics.CSInvocations != k.launched_threads();
+            std::cout << format_kernel_metrics((std::string("array_sum ") + shape[0] + "x" + shape[1]).c_str(), m) << std::endl;
+        }
+
+        if (error == 0)
+            std::cout << "Kernel stats device test passed!" << std::endl;
+        else
+            std::cout << "Kernel stats device test failed! Error: " << error << std::endl;
+    }
+};
+
+void run_kernel_stats_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running kernel stats test..." << std::endl;
+    Kernel_Stats_Tester tester;
+    tester.test_device(device, context, 2, 1080, 1920);
+}
+
+class Command_Stream_Tester : public Command_Stream_Host_Tester
+{
+public:
+    // A real array_sum run captured from the device classes, replayed on the device and on the host
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context, size_t channels, size_t height, size_t width)
+    {
+        size_t error = 0;
+        Command_Recorder recorder;
+        recorder.init();
+        set_command_capture(&recorder);
+        std::vector<unsigned char> result(channels * height * width * sizeof(float));
+        {
+            D3D_SHADER_MACRO defines[] = { { "THREAD_GROUP_SIZE_X", "9" }, { "THREAD_GROUP_SIZE_Y", "7" }, { nullptr, nullptr } };
+            D3D11_Compute_Shader shader;
+            shader.init_from_file(device, "shaders/array_sum.hlsl", "main", defines);
+            Texture_As_Buffer in0, in1, out;
+            in0.init(device, channels, height, width, DXGI_FORMAT_R32_FLOAT);
+            in0.init_staging(device);
+            in1.init(device, channels, height, width, DXGI_FORMAT_R32_FLOAT);
+            in1.init_staging(device);
+            out.init(device, channels, height, width, DXGI_FORMAT_R32_FLOAT);
+            out.init_staging(device);
+            in0.to_gpu(context, float_bits(1.0f));
+            in1.to_gpu(context, float_bits(2.0f));
+            D3D11_Constant_Buffer params;
+            params.init(device, 16);
+            const int constants[4] = { 2, (int)height, (int)width, 0 };
+            params.to_gpu(context, constants);
+
+            D3D11_Binding_Table table;
+            table.init(shader);
+            table.set_srv("input_0", in0.p_texture_srv);
+            table.set_srv("input_1", in1.p_texture_srv);
+            table.set_uav("output", out.p_texture_uav);
+            table.set_cb("Constant_Buffer", params.p_buffer);
+            D3D11_Binding_State state;
+            state.dispatch(context, table, (UINT)(width + 8) / 9, (UINT)(height + 6) / 7, 1);
+            state.clear(context);
+            error += !out.to_cpu(context, result.data(), out.row_pitch(), out.slice_pitch());
+        }
+        set_command_capture(nullptr);
+
+        size_t ops[CMD_OP_COUNT] = {};
+        for (const Command& c : recorder.stream.commands)
+            ops[c.op]++;
+        error += ops[CMD_CREATE_ARRAY] != 3 || ops[CMD_RELEASE_ARRAY] != 3 || ops[CMD_UPLOAD] != 2 || ops[CMD_DOWNLOAD] != 1;
+        error += ops[CMD_CREATE_SHADER] != 1 || ops[CMD_SET_CONSTANTS] != 1 || ops[CMD_DISPATCH] != 1;
+        error += !holds(result, channels * height * width, expected(1.0f, 2.0f, height, width));
+
+        Replay_Stats stats;
+        Replay_Options options;
+        D3D11_Command_Backend gpu;
+        gpu.init(device, context);
+        error += !replay_commands(recorder.stream, gpu, options, stats) || gpu.downloaded != result;
+        Host_Command_Backend host;
+        host.register_kernel("shaders/array_sum.hlsl:main", host_array_sum);
+        error += !replay_commands(recorder.stream, host, options, stats) || host.downloaded != result;
+
+        options.strip_transfers = true;
+        options.loops = 10;
+        replay_commands(recorder.stream, gpu, options, stats);
+        std::cout << "Device replay without transfers, 10 loops: " << stats.report();
+
+        if (error == 0)
+            std::cout << "Command stream device test passed!" << std::endl;
+        else
+            std::cout << "Command stream device test failed! Error: " << error << std::endl;
+    }
+private:
+    static unsigned int float_bits(float f)
+    {
+        unsigned int bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+};
+
+void run_command_stream_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running command stream test..." << std::endl;
+    Command_Stream_Tester tester;
+    tester.test_device(device, context, 2, 200, 300);
+}
+
+class Benchmark_Tester : public Benchmark_Host_Tester
+{
+public:
+    // The shipped default workload, shortened, on the device
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        size_t error = 0;
+        std::vector<Benchmark_Case> cases;
+        std::string message;
+        if (!load_benchmark_workload("workloads/default.json", cases, message)) {
+            std::cout << "Benchmark device test failed! " << message << std::endl;
+            return;
+        }
+        for (Benchmark_Case& c : cases) {
+            c.warmup = 1;
+            c.iterations = 5;
+        }
+        D3D11_Benchmark_Backend backend;
+        backend.init(device, context);
+        std::vector<Benchmark_Result> results = run_benchmarks(cases, backend);
+        for (const Benchmark_Result& r : results)
+            error += r.status != "ok" || r.samples.size() != 5;
+
+        if (error == 0)
+            std::cout << "Benchmark device test passed!" << std::endl;
+        else
+            std::cout << "Benchmark device test failed! Error: " << error << std::endl;
+    }
+};
+
+void run_benchmark_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running benchmark test..." << std::endl;
+    Benchmark_Tester tester;
+    tester.test_device(device, context);
+}
+
+class Atlas_Tester : public Atlas_Host_Tester
+{
+public:
+    // The same sum on the device: one texture set and one dispatch per page against one per array
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        size_t error = 0;
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        Atlas_Packer packer;
+        packer.init(1024, 1024, 4, 0, 8);
+        std::vector<uint32_t> ids = allocate(packer);
+        D3D11_Texture_Atlas in_0, in_1, out;
+        in_0.init(device, packer, DXGI_FORMAT_R32_FLOAT);
+        in_1.init(device, packer, DXGI_FORMAT_R32_FLOAT);
+        out.init(device, packer, DXGI_FORMAT_R32_FLOAT);
+        for (size_t i = 0; i < ids.size(); i++) {
+            error += !in_0.write(ids[i], m_data[i].data());
+            error += !in_1.write(ids[i], m_data[i].data());
+        }
+        error += !out.sync() || !in_0.upload(context) || !in_1.upload(context);
+
+        D3D11_Structured_Buffer bias;
+        bias.init(device, sizeof(float), m_bias.size());
+        bias.to_gpu(context, m_bias.data());
+        D3D_SHADER_MACRO defines[] = { { "ATLAS_TILE_X", "8" }, { "ATLAS_TILE_Y", "8" }, { nullptr, nullptr } };
+        D3D11_Compute_Shader shader;
+        shader.init_from_file(device, "shaders/atlas.hlsl", "sum_main", defines);
+        D3D11_Binding_Table table;
+        table.init(shader);
+        table.set_srv("array_bias", bias.p_srv);
+        D3D11_Atlas_Dispatch batch;
+        error += !batch.init(device, context, packer, ids.data(), ids.size(), 8, 8);
+        const Atlas_Binding bindings[] = { { "input_0", &in_0, false }, { "input_1", &in_1, false }, { "output", &out, true } };
+        batch.dispatch(context, table, bindings, 3);
+        error += !out.download(context);
+        std::vector<float> result;
+        for (size_t i = 0; i < ids.size(); i++) {
+            result.resize(m_data[i].size());
+            out.read(ids[i], result.data());
+            for (size_t k = 0; k < result.size(); k++)
+                error += result[k] != m_data[i][k] + m_data[i][k] + m_bias[i];
+        }
+        std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+        const double atlas_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+
+        // One texture set, transfer and dispatch per array
+        start = std::chrono::high_resolution_clock::now();
+        D3D_SHADER_MACRO sum_defines[] = { { "THREAD_GROUP_SIZE_X", "8" }, { "THREAD_GROUP_SIZE_Y", "8" }, { nullptr, nullptr } };
+        D3D11_Compute_Shader sum;
+        sum.init_from_file(device, "shaders/array_sum.hlsl", "main", sum_defines);
+        D3D11_Constant_Buffer params;
+        params.init(device, 4 * sizeof(int));
+        const int constants[4] = {};
+        params.to_gpu(context, constants);
+        D3D11_Binding_State state;
+        for (size_t i = 0; i < ids.size(); i++) {
+            const std::vector<size_t>& s = m_shapes[i];
+            Texture_As_Buffer a, b, c;
+            for (Texture_As_Buffer* t : { &a, &b, &c }) {
+                t->init(device, s[0], s[1], s[2], DXGI_FORMAT_R32_FLOAT);
+                t->init_staging(device);
+            }
+            a.to_gpu(context, (void*)m_data[i].data());
+            b.to_gpu(context, (void*)m_data[i].data());
+            D3D11_Binding_Table per_array;
+            per_array.init(sum);
+            per_array.set_srv("input_0", a.p_texture_srv);
+            per_array.set_srv("input_1", b.p_texture_srv);
+            per_array.set_uav("output", c.p_texture_uav);
+            per_array.set_cb("Constant_Buffer", params.p_buffer);
+            state.dispatch(context, per_array, (UINT)(s[2] + 7) / 8, (UINT)(s[1] + 7) / 8, 1);
+            state.clear(context);
+            c.to_cpu(context);
+        }
+        stop = std::chrono::high_resolution_clock::now();
+        const double per_array_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+        std::cout << ids.size() << " arrays: atlas " << atlas_ms << " ms (" << packer.page_count() << " pages, " << batch.tile_count()
+            << " tiles in " << batch.dispatch_count() << " dispatches), per array " << per_array_ms << " ms" << std::endl;
+
+        if (error == 0)
+            std::cout << "Atlas device test passed!" << std::endl;
+        else
+            std::cout << "Atlas device test failed! Error: " << error << std::endl;
+    }
+};
+
+void run_atlas_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running atlas test..." << std::endl;
+    Atlas_Tester tester;
+    tester.init(3000);
+    tester.test_device(device, context);
+}
+
+class Stencil_Tester : public Stencil_Host_Tester
+{
+public:
+    // Both forms of every footprint against the host, and their bandwidth
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context)
+    {
+        size_t error = 0;
+        Texture_As_Buffer in, out;
+        in.init(device, m_channels, m_height, m_width, DXGI_FORMAT_R32_FLOAT);
+        out.init(device, m_channels, m_height, m_width, DXGI_FORMAT_R32_FLOAT);
+        out.init_staging(device);
+        in.to_gpu(context, (void*)m_data.data());
+        std::vector<float> expected(m_data.size()), result(m_data.size());
+        D3D11_Performance_Counter counter;
+        counter.init(device);
+        const double gb = (double)m_data.size() * sizeof(float) * 2 / 1e9;
+        for (size_t i = 0; i < m_footprints.size(); i++) {
+            stencil_blocked(m_data.data(), expected.data(), m_channels, m_height, m_width, m_footprints[i]);
+            double ms[2] = {};
+            for (Stencil_Form form : { STENCIL_DIRECT, STENCIL_GROUPSHARED }) {
+                D3D11_Stencil_Kernel kernel;
+                if (!kernel.init(device, m_footprints[i], form)) {
+                    error++;
+                    continue;
+                }
+                kernel.dispatch(context, in, out);     // Warm up
+                counter.counter_start(context);
+                error += !kernel.dispatch(context, in, out);
+                ms[form] = counter.counter_stop(context);
+                error += !out.to_cpu(context, result.data(), out.row_pitch(), out.slice_pitch());
+                error += mismatches(expected, result, 1e-4f);
+            }
+            std::cout << "Stencil " << m_names[i] << " on device: direct " << ms[STENCIL_DIRECT] << " ms ("
+                << gb / (ms[STENCIL_DIRECT] / 1000.0) << " GB/s, " << stencil_fetches_per_output(m_footprints[i], STENCIL_DIRECT, 16, 16)
+                << " fetches per output), groupshared " << ms[STENCIL_GROUPSHARED] << " ms (" << gb / (ms[STENCIL_GROUPSHARED] / 1000.0)
+                << " GB/s, " << stencil_fetches_per_output(m_footprints[i], STENCIL_GROUPSHARED, 16, 16) << " fetches per output)" << std::endl;
+        }
+
+        // The shader reads one scalar per texel: interleaved and multi-component textures are refused
+        D3D11_Stencil_Kernel kernel;
+        error += !kernel.init(device, m_footprints[0], STENCIL_DIRECT);
+        Texture_As_Buffer interleaved, pairs;
+        interleaved.init(device, m_channels, m_height, m_width, DXGI_FORMAT_R32G32B32A32_FLOAT, TEXTURE_INTERLEAVED);
+        pairs.init(device, m_channels, m_height, m_width, DXGI_FORMAT_R16G16_FLOAT);
+        error += kernel.dispatch(context, interleaved, out) || kernel.dispatch(context, in, pairs);
+
+        if (error == 0)
+            std::cout << "Stencil device test passed!" << std::endl;
+        else
+            std::cout << "Stencil device test failed! Error: " << error << std::endl;
+    }
+};
+
+void run_stencil_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running stencil test..." << std::endl;
+    Stencil_Tester tester;
+    tester.init(3, 1080, 1920);
+    tester.test_device(device, context);
+}
+
+class Submission_Queue_Tester : public Submission_Queue_Host_Tester
+{
+public:
+    void test_device(ID3D11Device* device, ID3D11DeviceContext* context, size_t workers, size_t iterations, size_t height, size_t width)
+    {
+        const char* shader_code = R"(
+            Texture2DArray<float> in_texture : register(t0);
+            RWTexture2DArray<float> out_texture : register(u0);
+
+            [numthreads(16, 16, 1)]
+            void test_main(uint3 DTid : SV_DispatchThreadID)
+            {
+                uint width;
+                uint height;
+                uint channels;
+                out_texture.GetDimensions(width, height, channels);
+                if (DTid.x >= width || DTid.y >= height)
+                    return;
+                out_texture[uint3(DTid.xy, 0)] = in_texture[uint3(DTid.xy, 0)] * 2.0f + 1.0f;
+            }
+        )";
+        D3D11_Compute_Shader shader;
+        shader.init_from_code_string(device, shader_code, "test_main");
+        std::vector<Texture_As_Buffer> in(workers), out(workers);
+        std::vector<D3D11_Binding_Table> tables(workers);
+        size_t error = 0;
+        for (size_t t = 0; t < workers; t++) {
+            in[t].init(device, 1, height, width, DXGI_FORMAT_R32_FLOAT);
+            in[t].init_staging(device);
+            out[t].init(device, 1, height, width, DXGI_FORMAT_R32_FLOAT);
+            out[t].init_staging(device);
+            error += !tables[t].init(shader) || !tables[t].set_srv("in_texture", in[t].p_texture_srv)
+                || !tables[t].set_uav("out_texture", out[t].p_texture_uav);
+        }
+        const UINT groups_x = ((UINT)width + 15) / 16;
+        const UINT groups_y = ((UINT)height + 15) / 16;
+
+        // Workers each run upload -> dispatch -> readback and wait for their result, through the owner thread
+        D3D11_Submission_Backend backend;
+        backend.init(context);
+        Submission_Executor executor;
+        executor.start(&backend);
+        std::atomic<size_t> wrong{ 0 };
+        auto start = std::chrono::high_resolution_clock::now();
+        run_workers(workers, iterations, height * width, wrong, [&](size_t t, const float* src, float* dst) {
+            Submission_Packet p;
+            p.op = SUBMIT_UPLOAD;
+            p.resource = &in[t];
+            p.src = src;
+            p.bytes = height * width * sizeof(float);
+            executor.submit(p);
+            p.op = SUBMIT_DISPATCH;
+            p.resource = &tables[t];
+            p.groups[0] = groups_x;
+            p.groups[1] = groups_y;
+            executor.submit(p);
+            p.op = SUBMIT_READBACK;
+            p.resource = &out[t];
+            p.dst = dst;
+            return executor.submit_future(p).get();
+        });
+        Submission_Stats stats = executor.stop();
+        const double queue_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        error += wrong.load() + stats.failures;
+        wrong = 0;
+
+        // Host arrays shorter than the texture are refused rather than read or written past
+        std::vector<float> short_array(height * width - 1);
+        Submission_Executor refusing;
+        refusing.start(&backend);
+        Submission_Packet p;
+        p.op = SUBMIT_UPLOAD;
+        p.resource = &in[0];
+        p.src = short_array.data();
+        p.bytes = short_array.size() * sizeof(float);
+        error += refusing.submit_future(p).get();
+        p.op = SUBMIT_READBACK;
+        p.resource = &out[0];
+        p.dst = short_array.data();
+        error += refusing.submit_future(p).get();
+        error += refusing.stop().failures != 2;
+
+        // The same work with every worker locking the context itself
+        std::mutex context_mutex;
+        D3D11_Binding_State state;
+        start = std::chrono::high_resolution_clock::now();
+        run_workers(workers, iterations, height * width, wrong, [&](size_t t, const float* src, float* dst) {
+            std::lock_guard<std::mutex> lock(context_mutex);
+            in[t].to_gpu(context, (void*)src);
+            state.dispatch(context, tables[t], groups_x, groups_y, 1);
+            state.clear(context);
+            return out[t].to_cpu(context, dst, out[t].row_pitch(), out[t].slice_pitch());
+        });
+        const double mutex_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        error += wrong.load();
+
+        if (error == 0)
+            std::cout << "Submission queue device test passed! " << workers << " workers x " << iterations << " round trips: owner thread "
+                << queue_ms << " ms (" << stats.batches << " batches, mean " << stats.mean_batch() << "), global mutex " << mutex_ms << " ms" << std::endl;
+        else
+            std::cout << "Submission queue device test failed! Error: " << error << std::endl;
+        for (size_t t = 0; t < workers; t++) {
+            in[t].release();
+            out[t].release();
+        }
+    }
+private:
+    // workers threads, each running iterations round trips of its own input through fn and checking out = in * 2 + 1
+    static void run_workers(size_t workers, size_t iterations, size_t elements, std::atomic<size_t>& wrong,
+        const std::function<bool(size_t, const float*, float*)>& fn)
+    {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < workers; t++) {
+            threads.emplace_back([&, t]() {
+                std::vector<float> src(elements), dst(elements);
+                for (size_t i = 0; i < iterations; i++) {
+                    for (size_t j = 0; j < elements; j++)
+                        src[j] = (float)((t * 131 + i * 17 + j) % 1021);
+                    wrong += !fn(t, src.data(), dst.data());
+                    for (size_t j = 0; j < elements; j++)
+                        wrong += dst[j] != src[j] * 2.0f + 1.0f;
+                }
+            });
+        }
+        for (std::thread& th : threads)
+            th.join();
+    }
+};
+
+void run_submission_queue_test(ID3D11Device* device, ID3D11DeviceContext* context)
+{
+    std::cerr << "Running submission queue test..." << std::endl;
+    Submission_Queue_Tester tester;
+    tester.test_device(device, context, 4, 64, 256, 256);
 }
\ No newline at end of file
@@ -4,4 +4,28 @@
 void run_write_test(ID3D11Device* device, ID3D11DeviceContext* context);
 void run_read_test(ID3D11Device* device, ID3D11DeviceContext* context);
 void run_shader_compile_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_virtual_texture_array_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_stream_executor_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_transfer_codec_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_mapped_file_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_snapshot_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_pipeline_scheduler_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_expr_graph_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_reduction_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_scan_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_constant_ring_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_binding_table_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_indirect_dispatch_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_sparse_texture_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_compressed_texture_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_interleaved_layout_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_layout_transform_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_residency_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_metrics_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_kernel_stats_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_command_stream_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_benchmark_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_atlas_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_stencil_test(ID3D11Device* device, ID3D11DeviceContext* context);
+void run_submission_queue_test(ID3D11Device* device, ID3D11DeviceContext* context);
 
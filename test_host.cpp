@@ -0,0 +1,199 @@
+#include "test_host.h"
+
+void run_tile_layout_test()
+{
+    std::cerr << "Running tile layout test..." << std::endl;
+    Tile_Layout_Tester tester;
+    tester.test(3, 250, 503, 2048, 16384, 16384);
+    tester.test(5, 300, 503, 2, 128, 128);
+    tester.test(7, 64, 64, 3, 64, 17);
+    tester.test(1, 1, 1, 1, 1, 1);
+    // Byte cap: rows of a slice, then columns of a row
+    tester.test(5, 300, 503, 2048, 16384, 16384, 4, 64 << 10);
+    tester.test(3, 7, 5000, 2048, 16384, 16384, 2, 4096);
+}
+
+void run_stream_executor_host_test()
+{
+    std::cerr << "Running stream executor host test..." << std::endl;
+    Stream_Executor_Host_Tester tester;
+    tester.init(3, 2000, 503, 1 << 20);
+    tester.test_host();
+    tester.release();
+}
+
+void run_transfer_codec_host_test()
+{
+    std::cerr << "Running transfer codec host test..." << std::endl;
+    Transfer_Codec_Host_Tester tester;
+    const size_t counts[5] = { 1, 255, 257, 100003, 1 << 24 };
+    const size_t word_bits[3] = { 8, 16, 32 };
+    for (size_t w = 0; w < 3; w++)
+        for (size_t n = 0; n < 5; n++) {
+            tester.test_host(word_bits[w], counts[n], true);
+            tester.test_host(word_bits[w], counts[n], false);
+        }
+}
+
+void run_mapped_file_host_test()
+{
+    std::cerr << "Running mapped file host test..." << std::endl;
+    Mapped_File_Host_Tester tester;
+    tester.test_npy_header();
+    tester.benchmark(256 << 20);
+}
+
+void run_snapshot_host_test()
+{
+    std::cerr << "Running snapshot host test..." << std::endl;
+    Snapshot_Host_Tester tester;
+    tester.test_host("snapshot_test.tabsnap");
+}
+
+void run_pipeline_scheduler_host_test()
+{
+    std::cerr << "Running pipeline scheduler host test..." << std::endl;
+    Pipeline_Scheduler_Host_Tester tester;
+    tester.init(48, 3, 128, 128);
+    tester.test_host();
+}
+
+void run_expr_graph_host_test()
+{
+    std::cerr << "Running expression graph host test..." << std::endl;
+    Expr_Graph_Host_Tester tester;
+    tester.init(3, 250, 503);
+    tester.test_host();
+}
+
+void run_reduction_host_test()
+{
+    std::cerr << "Running reduction host test..." << std::endl;
+    Reduction_Host_Tester tester;
+    tester.init(3, 250, 503);
+    tester.test_host();
+}
+
+void run_scan_host_test()
+{
+    std::cerr << "Running scan host test..." << std::endl;
+    Scan_Host_Tester tester;
+    tester.init(3000000);
+    tester.test_host();
+    tester.benchmark_host();
+}
+
+void run_constant_ring_host_test()
+{
+    std::cerr << "Running constant ring host test..." << std::endl;
+    Constant_Ring_Host_Tester tester;
+    tester.test_host();
+}
+
+void run_binding_table_host_test()
+{
+    std::cerr << "Running binding table host test..." << std::endl;
+    Binding_Table_Host_Tester tester;
+    tester.test_host();
+}
+
+void run_indirect_dispatch_host_test()
+{
+    std::cerr << "Running indirect dispatch host test..." << std::endl;
+    Indirect_Dispatch_Host_Tester tester;
+    tester.init(1024, 1024);
+    tester.test_host();
+}
+
+void run_sparse_texture_host_test()
+{
+    std::cerr << "Running sparse texture host test..." << std::endl;
+    Sparse_Texture_Host_Tester tester;
+    tester.init(64, 300, 200);
+    tester.test_host();
+}
+
+void run_compressed_texture_host_test()
+{
+    std::cerr << "Running compressed texture host test..." << std::endl;
+    Compressed_Texture_Host_Tester tester;
+    tester.init(3, 250, 503);
+    tester.test_host();
+}
+
+void run_layout_transform_host_test()
+{
+    std::cerr << "Running layout transform host test..." << std::endl;
+    Layout_Transform_Host_Tester tester;
+    tester.test_host();
+    tester.benchmark_host(3, 2160, 3840);
+}
+
+void run_residency_host_test()
+{
+    std::cerr << "Running residency host test..." << std::endl;
+    Residency_Host_Tester tester;
+    tester.test_host();
+}
+
+void run_metrics_host_test()
+{
+    std::cerr << "Running metrics host test..." << std::endl;
+    Metrics_Host_Tester tester;
+    tester.test_host(8, 1000000);
+    tester.benchmark_host(1, 10000000);
+    tester.benchmark_host(8, 10000000);
+}
+
+void run_stencil_host_test()
+{
+    std::cerr << "Running stencil host test..." << std::endl;
+    Stencil_Host_Tester tester;
+    tester.init(3, 1080, 1920);
+    tester.test_host();
+}
+
+void run_kernel_stats_host_test()
+{
+    std::cerr << "Running kernel stats host test..." << std::endl;
+    Kernel_Stats_Host_Tester tester;
+    tester.test_host();
+}
+
+void run_command_stream_host_test()
+{
+    std::cerr << "Running command stream host test..." << std::endl;
+    Command_Stream_Host_Tester tester;
+    tester.test_host(2, 200, 300);
+}
+
+void run_benchmark_host_test()
+{
+    std::cerr << "Running benchmark host test..." << std::endl;
+    Benchmark_Host_Tester tester;
+    tester.test_host();
+}
+
+void run_atlas_host_test()
+{
+    std::cerr << "Running atlas host test..." << std::endl;
+    Atlas_Host_Tester tester;
+    tester.init(3000);
+    tester.test_host();
+}
+
+void run_format_traits_test()
+{
+    std::cerr << "Running format traits test..." << std::endl;
+    Format_Traits_Tester tester;
+    tester.test_host();
+    tester.benchmark(3, 1080, 1920);
+}
+
+void run_submission_queue_host_test()
+{
+    std::cerr << "Running submission queue host test..." << std::endl;
+    Submission_Queue_Host_Tester tester;
+    tester.test_host();
+    tester.benchmark(10000, 2000.0, 250.0);
+}
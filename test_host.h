@@ -0,0 +1,2488 @@
+#pragma once
+#include "tile_layout.h"
+#include "stream_executor.h"
+#include "transfer_codec.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+#include "pipeline_scheduler.h"
+#include "expr_graph.h"
+#include "reduction.h"
+#include "scan.h"
+#include "constant_ring.h"
+#include "binding_table.h"
+#include "indirect_dispatch.h"
+#include "sparse_page_table.h"
+#include "block_compression.h"
+#include "layout_transform.h"
+#include "residency.h"
+#include "metrics.h"
+#include "stencil.h"
+#include "format_traits.h"
+#include "kernel_stats.h"
+#include "command_stream.h"
+#include "json.h"
+#include "benchmark.h"
+#include "atlas.h"
+#include "submission_queue.h"
+#include <iostream>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+/*
+ * Testers for the host-only core. Each X_Host_Tester owns the fixture (inputs, reference
+ * results, helpers) and the host checks; test.cpp derives X_Tester from it and adds the
+ * device checks, so both runs share one fixture. Host-only, no D3D dependency, built into
+ * the portable host test target as well as the D3D11 one (see test.h for the device tests).
+ */
+
+class Tile_Layout_Tester
+{
+public:
+    void test(size_t channels, size_t height, size_t width, size_t max_c, size_t max_h, size_t max_w, size_t element_size = 0, size_t max_bytes = 0)
+    {
+        Tile_Layout layout;
+        if (!layout.init(channels, height, width, max_c, max_h, max_w, element_size, max_bytes)) {
+            std::cout << "Tile layout test failed! Could not init layout." << std::endl;
+            return;
+        }
+
+        size_t error = 0;
+        // Every logical coordinate must land inside the tile it is translated to
+        for (size_t c_idx = 0; c_idx < channels; c_idx++)
+            for (size_t h_idx = 0; h_idx < height; h_idx++)
+                for (size_t w_idx = 0; w_idx < width; w_idx++) {
+                    Tile_Address addr = layout.locate(c_idx, h_idx, w_idx);
+                    Tile_Extent ext = layout.extent(addr.tile);
+                    error += addr.tile >= layout.tile_count();
+                    error += (ext.c0 + addr.c != c_idx) || addr.c >= ext.channels;
+                    error += (ext.h0 + addr.h != h_idx) || addr.h >= ext.height;
+                    error += (ext.w0 + addr.w != w_idx) || addr.w >= ext.width;
+                }
+
+        // Tiles must cover the logical array exactly once and respect the limits
+        size_t volume = 0;
+        for (size_t t = 0; t < layout.tile_count(); t++) {
+            Tile_Extent ext = layout.extent(t);
+            volume += ext.channels * ext.height * ext.width;
+            error += ext.channels > max_c || ext.height > max_h || ext.width > max_w;
+            error += max_bytes != 0 && ext.channels * ext.height * ext.width * element_size > max_bytes;
+            error += layout.locate(ext.c0, ext.h0, ext.w0).tile != t;
+        }
+        error += volume != channels * height * width;
+
+        if (error == 0)
+            std::cout << "Tile layout test passed! (" << layout.tile_count() << " tiles)" << std::endl;
+        else
+            std::cout << "Tile layout test failed! Error: " << error << std::endl;
+    }
+};
+
+class Stream_Executor_Host_Tester
+{
+public:
+    void init(size_t channels, size_t height, size_t width, size_t memory_cap)
+    {
+        m_channels = channels;
+        m_height = height;
+        m_width = width;
+        m_memory_cap = memory_cap;
+
+        // Kernel reads (h, w), (h, w + 1), (h + 1, w), (h + 1, w + 1) clamped to the border
+        m_footprint.halo_bottom = 1;
+        m_footprint.halo_right = 1;
+
+        m_input = new float[channels * height * width];
+        m_reference = new float[channels * height * width];
+        m_output = new float[channels * height * width];
+        for (size_t i = 0; i < channels * height * width; i++)
+            m_input[i] = (float)((i * 7) % 251);
+
+        for (size_t c_idx = 0; c_idx < channels; c_idx++)
+            for (size_t h_idx = 0; h_idx < height; h_idx++)
+                for (size_t w_idx = 0; w_idx < width; w_idx++) {
+                    size_t h_n = std::min(h_idx + 1, height - 1);
+                    size_t w_n = std::min(w_idx + 1, width - 1);
+                    const float* slice = m_input + c_idx * height * width;
+                    m_reference[(c_idx * height + h_idx) * width + w_idx] =
+                        slice[h_idx * width + w_idx] + slice[h_idx * width + w_n] + slice[h_n * width + w_idx] + slice[h_n * width + w_n];
+                }
+    }
+
+    void test_host()
+    {
+        Stream_Executor executor;
+        if (!executor.init(m_channels, m_height, m_width, sizeof(float), sizeof(float), m_footprint, m_memory_cap)) {
+            std::cout << "Stream executor host test failed! Could not plan tiles." << std::endl;
+            return;
+        }
+
+        size_t height = m_height;
+        size_t width = m_width;
+        Host_Stream_Backend backend;
+        backend.init([height, width](const Stream_Tile& tile, const void* in, void* out) {
+            const float* in_f = (const float*)in;
+            float* out_f = (float*)out;
+            for (size_t c_idx = 0; c_idx < tile.out.channels; c_idx++)
+                for (size_t y = 0; y < tile.out.height; y++)
+                    for (size_t x = 0; x < tile.out.width; x++) {
+                        size_t h_idx = tile.out.h0 + y;
+                        size_t w_idx = tile.out.w0 + x;
+                        size_t h_n = std::min(h_idx + 1, height - 1);
+                        size_t w_n = std::min(w_idx + 1, width - 1);
+                        const float* slice = in_f + c_idx * tile.in.height * tile.in.width;
+                        out_f[(c_idx * tile.out.height + y) * tile.out.width + x] =
+                            slice[(h_idx - tile.in.h0) * tile.in.width + (w_idx - tile.in.w0)] +
+                            slice[(h_idx - tile.in.h0) * tile.in.width + (w_n - tile.in.w0)] +
+                            slice[(h_n - tile.in.h0) * tile.in.width + (w_idx - tile.in.w0)] +
+                            slice[(h_n - tile.in.h0) * tile.in.width + (w_n - tile.in.w0)];
+                    }
+        }, m_height, m_width);
+
+        Stream_Stats stats = executor.run(&backend, m_input, m_output);
+        report("host", stats);
+
+        // A backend that pays twice per slot (a staging copy each) gets tiles half the size under the same cap
+        Staged_Host_Backend staged;
+        Stream_Executor priced;
+        const Tile_Extent tile = executor.layout.extent(0);
+        if (!priced.init(m_channels, m_height, m_width, sizeof(float), sizeof(float), m_footprint, m_memory_cap, &staged)
+            || Stream_Executor::slot_count * priced.slot_bytes(priced.layout.tile_channels, priced.layout.tile_height, priced.layout.tile_width) > m_memory_cap
+            || priced.layout.tile_count() <= executor.layout.tile_count() || priced.slot_bytes(tile.channels, tile.height, tile.width) <= m_memory_cap / 3)
+            std::cout << "Stream executor host test failed! Tiles were not sized by the backend's slot bytes." << std::endl;
+    }
+
+    void release()
+    {
+        delete[] m_input;
+        delete[] m_reference;
+        delete[] m_output;
+        m_input = nullptr;
+        m_reference = nullptr;
+        m_output = nullptr;
+    }
+protected:
+    size_t m_channels = 0;
+    size_t m_height = 0;
+    size_t m_width = 0;
+    size_t m_memory_cap = 0;
+    Stream_Footprint m_footprint;
+    float* m_input = nullptr;
+    float* m_reference = nullptr;
+    float* m_output = nullptr;
+
+    struct Staged_Host_Backend : Host_Stream_Backend
+    {
+        size_t slot_bytes(const Tile_Extent& max_in, const Tile_Extent& max_out, size_t in_element_size, size_t out_element_size) const override
+        {
+            return 2 * Host_Stream_Backend::slot_bytes(max_in, max_out, in_element_size, out_element_size);
+        }
+    };
+
+    void report(const char* name, const Stream_Stats& stats)
+    {
+        float error = 0;
+        for (size_t i = 0; i < m_channels * m_height * m_width; i++)
+            error += std::fabs(m_output[i] - m_reference[i]);
+
+        double total_mb = (stats.bytes_uploaded + stats.bytes_readback) / (1024.0 * 1024.0);
+        std::cout << "Stream " << name << ": " << stats.tiles << " tiles, " << stats.device_bytes << " of " << m_memory_cap << " bytes resident, "
+            << total_mb * 1000.0 / stats.wall_ms << " MB/s (bound " << total_mb * 1000.0 / stats.bound_ms() << " MB/s)" << std::endl;
+
+        if (error == 0.0f && stats.device_bytes <= m_memory_cap && stats.tiles > 1)
+            std::cout << "Stream executor " << name << " test passed!" << std::endl;
+        else
+            std::cout << "Stream executor " << name << " test failed! Error: " << error << std::endl;
+    }
+};
+
+class Transfer_Codec_Host_Tester
+{
+public:
+    void test_host(size_t word_bits, size_t count, bool smooth)
+    {
+        std::vector<uint32_t> src(count);
+        fill(src.data(), count, word_bits, smooth, 0);
+        std::vector<unsigned char> packed(count * word_bits / 8);
+        pack(src.data(), count, word_bits, packed.data());
+
+        Delta_Codec codec;
+        codec.word_bits = word_bits;
+        Transfer_Codec_Stats stats;
+        std::vector<uint32_t> stream;
+        codec.encode(packed.data(), count, stream, &stats);
+        std::vector<unsigned char> decoded(count * word_bits / 8 + 1);
+        bool ok = codec.decode(stream.data(), stream.size(), count, decoded.data(), &stats);
+
+        size_t error = ok ? 0 : 1;
+        for (size_t i = 0; i < packed.size(); i++)
+            error += packed[i] != decoded[i];
+
+        std::string name = "Codec " + std::to_string(word_bits) + "-bit " + (smooth ? "smooth" : "random") + " x" + std::to_string(count);
+        if (count >= 1 << 20)
+            std::cout << name << ": ratio " << stats.ratio() << ", encode " << stats.encode_mb_per_s() << " MB/s, decode " << stats.decode_mb_per_s() << " MB/s" << std::endl;
+        if (error == 0)
+            std::cout << name << " test passed!" << std::endl;
+        else
+            std::cout << name << " test failed! Error: " << error << std::endl;
+    }
+protected:
+    // Smooth data is the bit pattern of a slowly varying positive float (half or single)
+    void fill(uint32_t* dst, size_t count, size_t word_bits, bool smooth, uint32_t seed)
+    {
+        uint32_t state = 2463534242u + seed;
+        for (size_t i = 0; i < count; i++) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            if (!smooth)
+                dst[i] = word_bits == 32 ? state : state & ((1u << word_bits) - 1);
+            else if (word_bits == 32) {
+                float f = 2.0f + sinf(i * 0.001f + seed);
+                memcpy(&dst[i], &f, sizeof(f));
+            }
+            else if (word_bits == 16)
+                dst[i] = 0x4000 + (uint32_t)(200.0f * (1.0f + sinf(i * 0.001f + seed)));
+            else
+                dst[i] = (uint32_t)(127.0f * (1.0f + sinf(i * 0.01f + seed)));
+        }
+    }
+
+    void pack(const uint32_t* src, size_t count, size_t word_bits, unsigned char* dst)
+    {
+        for (size_t i = 0; i < count; i++)
+            memcpy(dst + i * word_bits / 8, &src[i], word_bits / 8);
+    }
+};
+
+class Mapped_File_Host_Tester
+{
+public:
+    void test_npy_header()
+    {
+        size_t error = 0;
+        const std::vector<size_t> shapes[3] = { { 7 }, { 3, 250, 503 }, { 2, 200, 300, 4 } };
+        for (size_t i = 0; i < 3; i++) {
+            Npy_Header header;
+            header.descr = "<f4";
+            header.shape = shapes[i];
+            std::string bytes = header.format();
+            error += header.data_offset % 64 != 0;
+            bytes.append(header.data_bytes(), '\0');
+
+            Npy_Header parsed;
+            error += !parsed.parse((const unsigned char*)bytes.data(), bytes.size());
+            error += parsed.descr != "<f4" || parsed.shape != shapes[i] || parsed.data_offset != header.data_offset;
+        }
+
+        if (error == 0)
+            std::cout << "Npy header test passed!" << std::endl;
+        else
+            std::cout << "Npy header test failed! Error: " << error << std::endl;
+    }
+
+    void benchmark(size_t bytes)
+    {
+        const char* path = "mapped_file_test.bin";
+        {
+            Mapped_File file;
+            if (!file.create(path, bytes)) {
+                std::cout << "Mapped file benchmark failed! Could not create file." << std::endl;
+                return;
+            }
+            for (size_t i = 0; i < bytes; i++)
+                file.data[i] = (unsigned char)(i * 31);
+        }
+
+        std::vector<unsigned char> dst(bytes);
+        size_t error = 0;
+
+        // Baseline: read into a heap buffer, then copy to the destination (as staging would)
+        auto start = std::chrono::high_resolution_clock::now();
+        {
+            std::ifstream in(path, std::ios::binary);
+            std::vector<unsigned char> heap(bytes);
+            in.read((char*)heap.data(), bytes);
+            memcpy(dst.data(), heap.data(), bytes);
+        }
+        double stream_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        error += dst[bytes - 1] != (unsigned char)((bytes - 1) * 31);
+
+        // Mapped: copy straight from the mapping
+        memset(dst.data(), 0, bytes);
+        start = std::chrono::high_resolution_clock::now();
+        {
+            Mapped_File file;
+            file.open_read(path);
+            file.advise_sequential();
+            file.prefault();
+            memcpy(dst.data(), file.data, bytes);
+        }
+        double mapped_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        for (size_t i = 0; i < bytes; i += 4099)
+            error += dst[i] != (unsigned char)(i * 31);
+
+        std::remove(path);
+        double mb = bytes / (1024.0 * 1024.0);
+        std::cout << "File read " << mb << " MB: ifstream + copy " << mb * 1000.0 / stream_ms << " MB/s, mmap " << mb * 1000.0 / mapped_ms << " MB/s" << std::endl;
+        if (error == 0)
+            std::cout << "Mapped file benchmark passed!" << std::endl;
+        else
+            std::cout << "Mapped file benchmark failed! Error: " << error << std::endl;
+    }
+};
+
+class Snapshot_Host_Tester
+{
+public:
+    void test_host(const char* path)
+    {
+        const size_t shapes[3][4] = { { 3, 250, 503, 64 }, { 2, 100, 100, 0 }, { 5, 33, 17, 8 } };
+        const size_t element_sizes[3] = { 4, 1, 2 };
+        const unsigned int formats[3] = { DXGI_FORMAT_R32_FLOAT, DXGI_FORMAT_R8_UNORM, DXGI_FORMAT_R16_FLOAT };
+        std::vector<unsigned char> arrays[3];
+        for (size_t a = 0; a < 3; a++) {
+            arrays[a].resize(shapes[a][0] * shapes[a][1] * shapes[a][2] * element_sizes[a]);
+            for (size_t i = 0; i < arrays[a].size(); i++)
+                arrays[a][i] = a == 1 ? (unsigned char)(i * 2654435761u >> 13) : (unsigned char)((i / 97) & 0xf);
+        }
+
+        size_t error = 0;
+        Snapshot_Writer writer;
+        error += !writer.open(path);
+        int ids[3];
+        for (size_t a = 0; a < 3; a++)
+            ids[a] = writer.add_array(("array_" + std::to_string(a)).c_str(), formats[a], element_sizes[a], shapes[a][0], shapes[a][1], shapes[a][2], shapes[a][3]);
+        // Two arrays written concurrently from separate threads, each with its own worker pool
+        std::thread other([&]() { writer.write_array(ids[0], arrays[0].data()); });
+        error += !writer.write_array(ids[1], arrays[1].data());
+        other.join();
+        error += !writer.write_array(ids[2], arrays[2].data(), 1);
+        error += !writer.close();
+
+        Snapshot_Reader reader;
+        error += !reader.open(path);
+        error += reader.array_count() != 3;
+        for (size_t a = 0; a < 3 && error == 0; a++) {
+            int id = reader.find(("array_" + std::to_string(a)).c_str());
+            std::vector<unsigned char> data(arrays[a].size());
+            error += !reader.read_array(id, data.data());
+            error += data != arrays[a];
+
+            // Random access: last channel only
+            const Snapshot_Array_Info& info = reader.info(id);
+            size_t channel_bytes = info.height * info.width * info.element_size;
+            std::vector<unsigned char> channel(channel_bytes);
+            error += !reader.read_channel(id, info.channels - 1, channel.data());
+            error += memcmp(channel.data(), arrays[a].data() + (info.channels - 1) * channel_bytes, channel_bytes) != 0;
+        }
+        reader.release();
+
+        // Corrupt one byte of array_0's first chunk, its checksum must catch it. The two threads'
+        // chunks interleave in the file, so look the chunk up rather than assuming it comes first.
+        error += !reader.open(path);
+        const size_t corrupt = (size_t)reader.info(0).chunks[0].offset + 8;
+        reader.release();
+        {
+            Mapped_File file;
+            file.open_read(path);
+            std::vector<unsigned char> copy(file.data, file.data + file.size);
+            file.release();
+            copy[corrupt] ^= 0x5a;
+            FILE* f = fopen(path, "wb");
+            fwrite(copy.data(), 1, copy.size(), f);
+            fclose(f);
+        }
+        error += !reader.open(path);
+        std::vector<unsigned char> chunk(reader.info(0).tile_height * reader.info(0).width * 4);
+        error += reader.read_chunk(0, 0, 0, chunk.data());
+        error += !reader.read_chunk(0, 0, 1, chunk.data());
+        reader.release();
+        std::remove(path);
+
+        if (error == 0)
+            std::cout << "Snapshot host test passed!" << std::endl;
+        else
+            std::cout << "Snapshot host test failed! Error: " << error << std::endl;
+    }
+};
+
+class Pipeline_Scheduler_Host_Tester
+{
+public:
+    void init(size_t item_count, size_t channels, size_t height, size_t width)
+    {
+        m_item_elements = channels * height * width;
+        m_channels = channels;
+        m_height = height;
+        m_width = width;
+        m_inputs.resize(item_count);
+        m_outputs.resize(item_count);
+        for (size_t i = 0; i < item_count; i++) {
+            m_inputs[i].resize(m_item_elements);
+            m_outputs[i].assign(m_item_elements, 0.0f);
+            for (size_t j = 0; j < m_item_elements; j++)
+                m_inputs[i][j] = (float)((i * 31 + j * 7) % 509);
+        }
+    }
+
+    void test_host()
+    {
+        // Dispatch is the slowest stage, so the pipeline should run at about its pace
+        Latency_Pipeline_Backend backend;
+        backend.init(m_item_elements * sizeof(float), 2.0, 3.0, 2.0, [](const Pipeline_Item& item, const void* in, void* out) {
+            const float* in_f = (const float*)in;
+            float* out_f = (float*)out;
+            for (size_t j = 0; j < item.out_bytes / sizeof(float); j++)
+                out_f[j] = in_f[j] * 2.0f + 1.0f;
+        });
+
+        Pipeline_Scheduler scheduler;
+        size_t completed = 0;
+        scheduler.start(&backend, 3, 2, [&completed](const Pipeline_Item&, bool ok) { completed += ok; });
+        for (size_t i = 0; i < m_inputs.size(); i++)
+            scheduler.submit(item(i));
+        Pipeline_Stats stats = scheduler.finish();
+
+        size_t error = verify();
+        error += completed != m_inputs.size();
+        error += scheduler.failures();
+        error += backend.order_violations();
+        error += backend.max_concurrent_stages() < 2;
+        error += stats.wall_ms > 0.8 * stats.serial_ms();
+        report("host", stats, error);
+        std::cout << "    max concurrent stages " << backend.max_concurrent_stages() << std::endl;
+
+        // Backpressure: with one slot and a very slow dispatch the producer must block
+        // (submit) or be turned away (try_submit) instead of queueing without bound
+        backend.init(m_item_elements * sizeof(float), 0.1, 10.0, 0.1);
+        scheduler.start(&backend, 1, 1);
+        size_t rejected = 0;
+        for (size_t i = 0; i < 8; i++)
+            while (!scheduler.try_submit(item(i)))
+                rejected++, std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        for (size_t i = 8; i < m_inputs.size() && i < 16; i++)
+            scheduler.submit(item(i));
+        stats = scheduler.finish();
+        error = (rejected == 0) + (stats.submit_blocked_ms <= 0.0) + backend.order_violations();
+        error += stats.upload.queue_high_water > 1 || stats.dispatch.queue_high_water > 1 || stats.readback.queue_high_water > 1;
+        if (error == 0)
+            std::cout << "Pipeline scheduler backpressure test passed! Rejected " << rejected << ", producer blocked " << stats.submit_blocked_ms << " ms" << std::endl;
+        else
+            std::cout << "Pipeline scheduler backpressure test failed! Error: " << error << std::endl;
+    }
+protected:
+    Pipeline_Item item(size_t i)
+    {
+        Pipeline_Item it;
+        it.id = i;
+        it.in = m_inputs[i].data();
+        it.in_bytes = m_item_elements * sizeof(float);
+        it.out = m_outputs[i].data();
+        it.out_bytes = m_item_elements * sizeof(float);
+        return it;
+    }
+
+    size_t verify()
+    {
+        size_t error = 0;
+        for (size_t i = 0; i < m_inputs.size(); i++)
+            for (size_t j = 0; j < m_item_elements; j++)
+                error += m_outputs[i][j] != m_inputs[i][j] * 2.0f + 1.0f;
+        return error;
+    }
+
+    void report(const char* name, const Pipeline_Stats& stats, size_t error)
+    {
+        if (error == 0)
+            std::cout << "Pipeline scheduler " << name << " test passed! " << stats.items << " items in " << stats.wall_ms << " ms"
+                << " (serial " << stats.serial_ms() << " ms, bound " << stats.bound_ms() << " ms)" << std::endl;
+        else
+            std::cout << "Pipeline scheduler " << name << " test failed! Error: " << error << std::endl;
+        const Pipeline_Stage_Stats* stages[3] = { &stats.upload, &stats.dispatch, &stats.readback };
+        const char* names[3] = { "upload", "dispatch", "readback" };
+        for (size_t s = 0; s < 3; s++)
+            std::cout << "    " << names[s] << ": utilization " << stages[s]->utilization(stats.wall_ms) * 100.0 << "%, starved "
+                << stages[s]->starved_ms << " ms, blocked " << stages[s]->blocked_ms << " ms" << std::endl;
+    }
+
+    size_t m_item_elements = 0;
+    size_t m_channels = 0;
+    size_t m_height = 0;
+    size_t m_width = 0;
+    std::vector<std::vector<float>> m_inputs;
+    std::vector<std::vector<float>> m_outputs;
+};
+
+class Expr_Graph_Host_Tester
+{
+public:
+    void init(size_t channels, size_t height, size_t width)
+    {
+        m_channels = channels;
+        m_height = height;
+        m_width = width;
+        m_count = channels * height * width;
+        for (size_t k = 0; k < 3; k++) {
+            m_inputs[k].resize(m_count);
+            for (size_t i = 0; i < m_count; i++)
+                m_inputs[k][i] = (float)((i * (k + 3) + k * 17) % 97) / 8.0f - 4.0f;
+        }
+    }
+
+    void test_host()
+    {
+        Expr a = Expr::host(m_inputs[0].data(), m_channels, m_height, m_width);
+        Expr b = Expr::host(m_inputs[1].data(), m_channels, m_height, m_width);
+        Expr c = Expr::host(m_inputs[2].data(), m_channels, m_height, m_width);
+
+        Expr_Host_Cache& cache = Expr_Host_Cache::instance();
+        size_t misses = cache.misses;
+        size_t error = 0;
+        std::vector<float> out(m_count);
+        for (float k : { 0.5f, 3.0f }) {
+            // Shared subexpression t is computed once inside the fused kernel
+            Expr t = a + b;
+            Expr y = relu(t * k - c) + sqrt(abs(a)) * t;
+            error += !y.eval(out.data());
+            for (size_t i = 0; i < m_count; i++)
+                error += std::fabs(out[i] - reference(i, k)) > 1e-4f;
+        }
+        // Same graph with new constants is one compile, one cache hit
+        error += cache.misses - misses != 1;
+
+        Expr_Plan plan;
+        plan.compile(relu((a + b) * 0.5f - c) + sqrt(abs(a)) * (a + b));
+        if (error == 0)
+            std::cout << "Expression graph host test passed! " << plan.register_count() << " nodes fused into one kernel" << std::endl;
+        else
+            std::cout << "Expression graph host test failed! Error: " << error << std::endl;
+
+        // Fused vs one pass (and one intermediate array) per operator
+        std::vector<float> tmp[6];
+        for (auto& v : tmp)
+            v.resize(m_count);
+        auto host = [this](const std::vector<float>& v) { return Expr::host(v.data(), m_channels, m_height, m_width); };
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int iter = 0; iter < 10; iter++)
+            (relu((a + b) * 0.5f - c) + sqrt(abs(a)) * (a + b)).eval(out.data());
+        double fused_ms = elapsed_ms(start) / 10.0;
+        start = std::chrono::high_resolution_clock::now();
+        for (int iter = 0; iter < 10; iter++) {
+            (a + b).eval(tmp[0].data());
+            (host(tmp[0]) * 0.5f - c).eval(tmp[1].data());
+            relu(host(tmp[1])).eval(tmp[2].data());
+            abs(a).eval(tmp[3].data());
+            sqrt(host(tmp[3])).eval(tmp[4].data());
+            (host(tmp[4]) * host(tmp[0])).eval(tmp[5].data());
+            (host(tmp[2]) + host(tmp[5])).eval(out.data());
+        }
+        double unfused_ms = elapsed_ms(start) / 10.0;
+        std::cout << "    fused " << fused_ms << " ms, unfused " << unfused_ms << " ms" << std::endl;
+    }
+protected:
+    float reference(size_t i, float k)
+    {
+        float t = m_inputs[0][i] + m_inputs[1][i];
+        float r = t * k - m_inputs[2][i];
+        return (r > 0.0f ? r : 0.0f) + std::sqrt(std::fabs(m_inputs[0][i])) * t;
+    }
+
+    double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    size_t m_channels = 0;
+    size_t m_height = 0;
+    size_t m_width = 0;
+    size_t m_count = 0;
+    std::vector<float> m_inputs[3];
+};
+
+class Reduction_Host_Tester
+{
+public:
+    void init(size_t channels, size_t height, size_t width)
+    {
+        m_channels = channels;
+        m_height = height;
+        m_width = width;
+        // Small integers, so every summation order is exact and results can be compared bitwise
+        m_input.resize(channels * height * width);
+        for (size_t i = 0; i < m_input.size(); i++)
+            m_input[i] = (float)((i * 7919) % 13) - 6.0f;
+    }
+
+    void test_host()
+    {
+        size_t error = 0;
+        for (unsigned int axes = 1; axes <= REDUCE_AXIS_ALL; axes++)
+            for (int op = REDUCE_SUM; op <= REDUCE_MEAN; op++) {
+                Reduce_Shape shape;
+                shape.init(m_channels, m_height, m_width, axes);
+                std::vector<float> out(shape.out_count());
+                error += !reduce(m_input.data(), shape, (Reduce_Op)op, out.data());
+                std::vector<float> expected = reference(shape, (Reduce_Op)op);
+                error += out != expected;
+            }
+
+        // Non-integer data: the result must not depend on the thread count
+        std::vector<float> noisy(m_input.size());
+        for (size_t i = 0; i < noisy.size(); i++)
+            noisy[i] = std::sin((float)i) * 1000.0f;
+        Reduce_Shape shape;
+        shape.init(m_channels, m_height, m_width, REDUCE_AXIS_ALL);
+        float sums[3];
+        for (size_t t = 0; t < 3; t++)
+            reduce(noisy.data(), shape, REDUCE_SUM, &sums[t], t * 3 + 1);
+        error += sums[0] != sums[1] || sums[0] != sums[2];
+
+        if (error == 0)
+            std::cout << "Reduction host test passed!" << std::endl;
+        else
+            std::cout << "Reduction host test failed! Error: " << error << std::endl;
+    }
+protected:
+    std::vector<float> reference(const Reduce_Shape& shape, Reduce_Op op)
+    {
+        std::vector<float> out(shape.out_count());
+        for (size_t o = 0; o < shape.out_count(); o++) {
+            double acc = op == REDUCE_MIN ? 1e30 : op == REDUCE_MAX ? -1e30 : 0.0;
+            for (size_t j = 0; j < shape.reduced_count(); j++) {
+                double v = m_input[shape.offset(o, j)];
+                acc = op == REDUCE_MIN ? (v < acc ? v : acc) : op == REDUCE_MAX ? (v > acc ? v : acc) : acc + v;
+            }
+            out[o] = op == REDUCE_MEAN ? (float)acc * (1.0f / (float)shape.reduced_count()) : (float)acc;
+        }
+        return out;
+    }
+
+    size_t m_channels = 0;
+    size_t m_height = 0;
+    size_t m_width = 0;
+    std::vector<float> m_input;
+};
+
+class Scan_Host_Tester
+{
+public:
+    void init(size_t count)
+    {
+        m_count = count;
+        m_uint.resize(count);
+        m_float.resize(count);
+        uint32_t state = 12345u;
+        for (size_t i = 0; i < count; i++) {
+            state = state * 1664525u + 1013904223u;
+            m_uint[i] = state;
+            m_float[i] = (float)((state >> 8) % 2001) / 100.0f - 10.0f;
+        }
+    }
+
+    void test_host()
+    {
+        size_t error = 0;
+
+        // Scan against a serial loop, small values so the uint total cannot wrap
+        std::vector<uint32_t> small(m_count), scanned(m_count);
+        for (size_t i = 0; i < m_count; i++)
+            small[i] = m_uint[i] & 0xff;
+        for (Scan_Mode mode : { SCAN_EXCLUSIVE, SCAN_INCLUSIVE }) {
+            uint32_t total = scan(small.data(), scanned.data(), m_count, mode);
+            uint32_t running = 0;
+            for (size_t i = 0; i < m_count; i++) {
+                if (mode == SCAN_INCLUSIVE)
+                    running += small[i];
+                error += scanned[i] != running;
+                if (mode == SCAN_EXCLUSIVE)
+                    running += small[i];
+            }
+            error += total != running;
+        }
+        std::vector<float> f1(m_count), f2(m_count);
+        scan(m_float.data(), f1.data(), m_count, SCAN_INCLUSIVE, 1);
+        scan(m_float.data(), f2.data(), m_count, SCAN_INCLUSIVE, 4);
+        error += f1 != f2;
+
+        // Compaction against a serial filter
+        Compact_Predicate pred;
+        pred.op = COMPACT_GREATER;
+        pred.threshold = 9.0f;
+        std::vector<float> values(m_count);
+        std::vector<uint32_t> indices(m_count);
+        size_t kept = compact(m_float.data(), m_count, pred, values.data(), indices.data());
+        size_t expected = 0;
+        for (size_t i = 0; i < m_count; i++)
+            if (m_float[i] > 9.0f) {
+                error += expected >= kept || values[expected] != m_float[i] || indices[expected] != i;
+                expected++;
+            }
+        error += kept != expected;
+
+        // Key-value sort against std::stable_sort, float keys through the order-preserving mapping
+        std::vector<uint32_t> keys(m_count), payload(m_count);
+        std::vector<std::pair<uint32_t, uint32_t>> reference(m_count);
+        for (size_t i = 0; i < m_count; i++) {
+            keys[i] = float_to_sort_key(m_float[i]);
+            payload[i] = (uint32_t)i;
+            reference[i] = { keys[i], (uint32_t)i };
+        }
+        radix_sort(keys.data(), payload.data(), m_count);
+        std::stable_sort(reference.begin(), reference.end(), [](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) { return a.first < b.first; });
+        for (size_t i = 0; i < m_count; i++)
+            error += keys[i] != reference[i].first || payload[i] != reference[i].second;
+        error += sort_key_to_float(keys[0]) != -10.0f;
+
+        if (error == 0)
+            std::cout << "Scan host test passed! Kept " << kept << " of " << m_count << std::endl;
+        else
+            std::cout << "Scan host test failed! Error: " << error << std::endl;
+    }
+
+    void benchmark_host()
+    {
+        std::vector<uint32_t> out(m_count);
+        auto start = std::chrono::high_resolution_clock::now();
+        uint32_t running = 0;
+        for (size_t i = 0; i < m_count; i++) {
+            out[i] = running;
+            running += m_uint[i];
+        }
+        double serial_scan_ms = elapsed_ms(start);
+        start = std::chrono::high_resolution_clock::now();
+        scan(m_uint.data(), out.data(), m_count, SCAN_EXCLUSIVE);
+        double scan_ms = elapsed_ms(start);
+
+        std::vector<uint32_t> keys(m_uint), std_keys(m_uint);
+        start = std::chrono::high_resolution_clock::now();
+        std::sort(std_keys.begin(), std_keys.end());
+        double std_sort_ms = elapsed_ms(start);
+        start = std::chrono::high_resolution_clock::now();
+        radix_sort(keys.data(), nullptr, m_count);
+        double radix_ms = elapsed_ms(start);
+
+        std::cout << "Scan host benchmark, " << m_count << " elements: serial scan " << serial_scan_ms << " ms, blocked scan " << scan_ms
+            << " ms, std::sort " << std_sort_ms << " ms, radix sort " << radix_ms << " ms" << std::endl;
+    }
+protected:
+    double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    size_t m_count = 0;
+    std::vector<uint32_t> m_uint;
+    std::vector<float> m_float;
+};
+
+class Constant_Ring_Host_Tester
+{
+public:
+    void test_host()
+    {
+        size_t error = 0;
+        Constant_Ring_Allocator ring;
+        Ring_Slice s;
+
+        // Wrap: a slice that does not fit before the end skips to the front
+        ring.init(1024);
+        ring.allocate(400, s);
+        error += s.offset != 0 || s.bytes != 512;
+        ring.end_batch(1);
+        ring.allocate(200, s);
+        error += s.offset != 512;
+        ring.end_batch(2);
+        error += ring.allocate(512, s);     // Only [768, 1024) free until batch 1 retires
+        ring.retire(1);
+        error += !ring.allocate(512, s) || s.offset != 0 || ring.used() != 1024;
+        ring.retire(2);
+        error += ring.used() != 768;     // The skipped [768, 1024) is held until the new slice retires
+
+        // Random batches retired with a lag: live slices must never overlap
+        ring.init(8 * 1024);
+        struct Live { size_t offset, bytes; uint64_t fence; };
+        std::vector<Live> live;
+        uint32_t state = 7u;
+        uint64_t fence = 0;
+        size_t allocations = 0;
+        size_t full = 0;
+        for (int step = 0; step < 20000; step++) {
+            state = state * 1664525u + 1013904223u;
+            size_t bytes = 16 + (state >> 8) % 1000;
+            if (ring.allocate(bytes, s)) {
+                allocations++;
+                error += s.offset % Constant_Ring_Allocator::alignment != 0 || s.offset + s.bytes > ring.capacity();
+                for (const Live& l : live)
+                    error += s.offset < l.offset + l.bytes && l.offset < s.offset + s.bytes;
+                live.push_back({ s.offset, s.bytes, fence + 1 });
+            }
+            else
+                full++;
+            if ((state >> 4) % 8 == 0)
+                ring.end_batch(++fence);
+            // The "GPU" completes fences a few batches behind
+            if (fence > 3) {
+                ring.retire(fence - 3);
+                live.erase(std::remove_if(live.begin(), live.end(), [&](const Live& l) { return l.fence <= fence - 3; }), live.end());
+            }
+        }
+
+        error += full == 0;
+        if (error == 0)
+            std::cout << "Constant ring host test passed! " << allocations << " slices, " << full << " refused while full" << std::endl;
+        else
+            std::cout << "Constant ring host test failed! Error: " << error << std::endl;
+    }
+};
+
+class Binding_Table_Host_Tester
+{
+public:
+    // Layouts and diffs from synthetic reflection, checked against a model of the D3D11 runtime
+    void test_host()
+    {
+        size_t error = 0;
+        std::vector<Shader_Binding> reflected = {
+            { BINDING_UAV, 1, 1, "output_texture" },
+            { BINDING_SRV, 1, 1, "input_partials" },
+            { BINDING_CBV, 0, 1, "Reduce_Constants" },
+            { BINDING_UAV, 0, 1, "output_partials" },
+        };
+        Binding_Layout layout;
+        error += !layout.init(reflected) || layout.slots() != 4 || layout.bindings[0].name != "input_partials";
+        error += layout.end[BINDING_SRV] != 2 || layout.end[BINDING_UAV] != 2 || layout.find("output_partials") != 1;
+        error += layout.init({ { BINDING_SRV, 0, 4, "a" }, { BINDING_SRV, 3, 1, "b" } });  // Overlap
+        error += layout.init({ { BINDING_UAV, 63, 2, "a" } });                             // Past the last slot
+
+        // Ping-pong: the partials swap between t1 and u0 every pass
+        int res[5];
+        Binding_Table table;
+        table.init(&res[0], reflected);
+        table.set("Reduce_Constants", value(&res[1]));
+        table.set("output_texture", value(&res[2], 1));
+        Binding_State state;
+        Runtime runtime;
+        bool set_shader;
+        Binding_Call calls[Binding_State::max_calls];
+        size_t pass_calls[4];
+        for (int pass = 0; pass < 4; pass++) {
+            table.set(BINDING_SRV, 1, value(&res[3 + pass % 2]));
+            table.set(BINDING_UAV, 0, value(&res[4 - pass % 2], 1));
+            size_t count = state.diff(table, calls, set_shader);
+            error += runtime.issue(calls, count);
+            error += !runtime.matches(state) || set_shader != (pass == 0);
+            pass_calls[pass] = count;
+        }
+        // Same table again binds nothing
+        error += state.diff(table, calls, set_shader) != 0 || set_shader;
+        error += pass_calls[0] != 3 || pass_calls[1] != 3 || pass_calls[2] != 3;
+
+        // Random tables over a pool of resources, each with one SRV and one UAV view
+        uint32_t seed = 11u;
+        const size_t steps = 20000;
+        size_t naive_calls = 0;
+        state.reset();
+        runtime = Runtime();
+        Binding_Table shaders[3];
+        for (int s = 0; s < 3; s++) {
+            std::vector<Shader_Binding> b = { { BINDING_CBV, 0, 1, "c" } };
+            for (unsigned int t = 0; t < 6; t++)
+                if ((t + s) % 3 != 0)
+                    b.push_back({ BINDING_SRV, t, 1, "t" + std::to_string(t) });
+            for (unsigned int u = 0; u < 3; u++)
+                if ((u + s) % 2 == 0)
+                    b.push_back({ BINDING_UAV, u, 1, "u" + std::to_string(u) });
+            b.push_back({ BINDING_SRV, 8, 2, "pair" });
+            shaders[s].init(&res[s], b);
+        }
+        int pool[12];
+        for (size_t step = 0; step < steps; step++) {
+            Binding_Table& t = shaders[next(seed) % 3];
+            // Distinct resources per table, so no resource is both read and written by one dispatch
+            int order[12];
+            for (int i = 0; i < 12; i++)
+                order[i] = i;
+            for (int i = 11; i > 0; i--)
+                std::swap(order[i], order[next(seed) % (i + 1)]);
+            int used = 0;
+            size_t v = 0;
+            for (const Shader_Binding& b : t.layout.bindings)
+                for (unsigned int i = 0; i < b.count; i++, v++)
+                    t.values[v] = b.kind == BINDING_CBV ? value(&res[1]) : value(&pool[order[used++]], b.kind == BINDING_UAV);
+            size_t count = state.diff(t, calls, set_shader);
+            error += runtime.issue(calls, count);
+            error += !runtime.matches(state);
+            // Declared slots hold the table's views
+            v = 0;
+            for (const Shader_Binding& b : t.layout.bindings)
+                for (unsigned int i = 0; i < b.count; i++, v++)
+                    error += runtime.bound[b.kind][b.slot + i] != t.values[v];
+            // Hand-written: the shader, one set call per binding, then null the SRVs and UAVs again
+            naive_calls += t.layout.bindings.size() + 3;
+        }
+        size_t count = state.clear(calls);
+        error += runtime.issue(calls, count);
+        for (int k = 0; k < BINDING_KIND_COUNT; k++)
+            for (unsigned int i = 0; i < 128; i++)
+                error += runtime.bound[k][i].view != nullptr;
+
+        if (error == 0)
+            std::cout << "Binding table host test passed! Ping-pong " << pass_calls[1] << " calls per pass, random tables "
+                << state.stats.calls << " set calls vs " << naive_calls << " hand-written, " << state.stats.slots_skipped
+                << " of " << state.stats.slots_skipped + state.stats.slots_written << " slot writes skipped" << std::endl;
+        else
+            std::cout << "Binding table host test failed! Error: " << error << std::endl;
+    }
+protected:
+    // The runtime's view of the bindings: a resource bound for read and write at once is an error here
+    struct Runtime
+    {
+        Binding_Value bound[BINDING_KIND_COUNT][128];
+
+        size_t issue(const Binding_Call* calls, size_t count)
+        {
+            size_t hazards = 0;
+            for (size_t c = 0; c < count; c++) {
+                const Binding_Call& call = calls[c];
+                for (unsigned int i = 0; i < call.count; i++)
+                    bound[call.kind][call.first + i] = call.values[i];
+                for (unsigned int s = 0; s < 16; s++)
+                    for (unsigned int u = 0; u < 8; u++)
+                        hazards += bound[BINDING_SRV][s].resource != nullptr && bound[BINDING_SRV][s].resource == bound[BINDING_UAV][u].resource;
+            }
+            return hazards;
+        }
+
+        bool matches(const Binding_State& state) const
+        {
+            for (int k = 0; k < BINDING_KIND_COUNT; k++)
+                for (unsigned int i = 0; i < binding_slot_count[k]; i++)
+                    if (bound[k][i] != state.bound((Binding_Kind)k, i))
+                        return false;
+            return true;
+        }
+    };
+
+    // A view of resource r: SRV views are r itself, UAV views one byte in
+    static Binding_Value value(int* r, int uav = 0)
+    {
+        Binding_Value v;
+        v.view = (const char*)r + uav;
+        v.resource = r;
+        return v;
+    }
+
+    static uint32_t next(uint32_t& seed)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 8;
+    }
+};
+
+class Indirect_Dispatch_Host_Tester
+{
+public:
+    void init(size_t width, size_t height)
+    {
+        m_width = width;
+        m_height = height;
+        m_values.resize(width * height);
+        uint32_t state = 4242u;
+        for (size_t i = 0; i < m_values.size(); i++) {
+            state = state * 1664525u + 1013904223u;
+            m_values[i] = (float)((state >> 8) % 2001) / 100.0f - 10.0f;
+        }
+    }
+
+    // Argument folding, coverage, and compaction -> args -> processing run entirely through the host emulation
+    void test_host()
+    {
+        size_t error = 0;
+        Dispatch_Args a = dispatch_args_for_count(0, 256);
+        error += a.x != 0 || a.y != 1 || a.z != 1;
+        a = dispatch_args_for_count(1, 256);
+        error += a.x != 1 || a.y != 1;
+        a = dispatch_args_for_count((uint64_t)max_groups_per_dimension * 256, 256);
+        error += a.x != max_groups_per_dimension || a.y != 1;
+        a = dispatch_args_for_count((uint64_t)max_groups_per_dimension * 256 + 1, 256);
+        error += a.x != max_groups_per_dimension || a.y != 2;
+        a.x = max_groups_per_dimension + 1;
+        error += host_dispatch(a, [](const Host_Group_Id&, const Dispatch_Args&) {});
+
+        // Every item covered exactly once by linear group * items + thread, including folded y
+        const uint64_t counts[4] = { 1, 255, 257, (uint64_t)max_groups_per_dimension * 64 + 3 };
+        for (uint64_t count : counts) {
+            std::vector<uint8_t> hits((size_t)count);
+            a = dispatch_args_for_count(count, 64);
+            host_dispatch(a, [&](const Host_Group_Id& g, const Dispatch_Args&) {
+                for (uint64_t t = 0; t < 64; t++) {
+                    uint64_t i = g.linear() * 64 + t;
+                    if (i < count)
+                        hits[(size_t)i]++;
+                }
+            });
+            for (uint8_t h : hits)
+                error += h != 1;
+        }
+
+        // Stage 1 compacts and leaves its count, stage 2 turns it into args, stage 3 consumes them
+        Compact_Predicate pred;
+        pred.op = COMPACT_GREATER;
+        pred.threshold = 5.0f;
+        std::vector<float> values(m_values.size());
+        uint32_t count = (uint32_t)compact(m_values.data(), m_values.size(), pred, values.data(), nullptr);
+        Host_Indirect_Buffer args;
+        args.init(2);
+        host_dispatch({ 1, 1, 1 }, [&](const Host_Group_Id&, const Dispatch_Args&) {
+            args.write(dispatch_args_bytes, dispatch_args_for_count(count, 256));
+        });
+        error += !host_dispatch_indirect(args, dispatch_args_bytes, [&](const Host_Group_Id& g, const Dispatch_Args&) {
+            for (uint32_t t = 0; t < 256; t++) {
+                uint64_t i = g.linear() * 256 + t;
+                if (i < count)
+                    values[(size_t)i] *= values[(size_t)i];
+            }
+        });
+        size_t k = 0;
+        for (float v : m_values)
+            if (pred.test(v))
+                error += values[k++] != v * v;
+        error += k != count || args.write(5, a) || args.read(2 * dispatch_args_bytes, a);
+
+        if (error == 0)
+            std::cout << "Indirect dispatch host test passed! " << count << " of " << m_values.size() << " values processed through emulated args" << std::endl;
+        else
+            std::cout << "Indirect dispatch host test failed! Error: " << error << std::endl;
+    }
+protected:
+    size_t m_width = 0;
+    size_t m_height = 0;
+    std::vector<float> m_values;
+};
+
+class Sparse_Texture_Host_Tester
+{
+public:
+    // 64 channels of which only a few hold data, one of those in a single small patch
+    void init(size_t channels, size_t height, size_t width)
+    {
+        m_channels = channels;
+        m_height = height;
+        m_width = width;
+        m_dense.assign(channels * height * width, 0.0f);
+        uint32_t state = 99u;
+        for (size_t c = 3; c < channels; c += 16)
+            for (size_t i = 0; i < height * width; i++) {
+                state = state * 1664525u + 1013904223u;
+                m_dense[c * height * width + i] = (float)((state >> 8) % 1000) / 10.0f + 1.0f;
+            }
+        for (size_t h = 130; h < 140; h++)
+            for (size_t w = 5; w < 9; w++)
+                m_dense[(8 * height + h) * width + w] = 7.0f;
+    }
+
+    void test_host()
+    {
+        size_t error = 0;
+        Sparse_Page_Table table;
+        table.init(m_channels, m_height, m_width, 128, 128, 40);
+        const size_t pages_per_channel = table.layout.tiles_h * table.layout.tiles_w;
+        error += table.page_count() != m_channels * pages_per_channel;
+
+        // Pool exhaustion and slot reuse
+        for (size_t p = 0; p < 40; p++)
+            error += !table.map(p) || table.slots[p] != p;
+        error += table.map(40) || table.resident() != 40;
+        table.unmap(7);
+        error += !table.map(40) || table.slots[40] != 7 || table.slots[7] != Sparse_Page_Table::not_resident;
+        table.map(40);
+        error += table.take_changes().size() != 41 || !table.take_changes().empty();
+        for (size_t p = 0; p < table.page_count(); p++)
+            table.unmap(p);
+        error += table.resident() != 0;
+
+        // A block spanning page boundaries maps exactly the pages it overlaps
+        error += !table.map_region(2, 100, 120, 2, 60, 20) || table.resident() != 2 * 2 * 2;
+        error += table.slots[table.page_index(3, 159, 139)] == Sparse_Page_Table::not_resident;
+        table.unmap_channel(2);
+        table.unmap_channel(3);
+
+        // Non-zero pages only; gathering them back reproduces the dense array
+        error += !table.map_nonzero(m_dense.data(), sizeof(float));
+        const size_t active = (m_channels - 3 + 15) / 16;
+        error += table.resident() != active * pages_per_channel + 1;
+        std::vector<float> page(128 * 128), rebuilt(m_dense.size(), 0.0f);
+        for (size_t p = 0; p < table.page_count(); p++)
+            if (table.slots[p] != Sparse_Page_Table::not_resident) {
+                table.gather_page(m_dense.data(), p, page.data(), sizeof(float));
+                table.scatter_page(page.data(), p, rebuilt.data(), sizeof(float));
+            }
+        error += rebuilt != m_dense;
+        Sparse_Page_Table small;
+        small.init(m_channels, m_height, m_width, 128, 128, 4);
+        error += small.map_nonzero(m_dense.data(), sizeof(float));
+
+        if (error == 0)
+            std::cout << "Sparse texture host test passed! " << table.resident() << " of " << table.page_count() << " pages resident" << std::endl;
+        else
+            std::cout << "Sparse texture host test failed! Error: " << error << std::endl;
+    }
+protected:
+    size_t m_channels = 0;
+    size_t m_height = 0;
+    size_t m_width = 0;
+    std::vector<float> m_dense;
+};
+
+class Compressed_Texture_Host_Tester
+{
+public:
+    // Smooth field in [0, 1] with a little noise, the kind of read-mostly input these formats are for
+    void init(size_t channels, size_t height, size_t width)
+    {
+        m_channels = channels;
+        m_height = height;
+        m_width = width;
+        m_dense.resize(channels * height * width);
+        uint32_t state = 7u;
+        for (size_t c = 0; c < channels; c++)
+            for (size_t h = 0; h < height; h++)
+                for (size_t w = 0; w < width; w++) {
+                    state = state * 1664525u + 1013904223u;
+                    float noise = (float)(state >> 8) / 16777216.0f;
+                    m_dense[(c * height + h) * width + w] = 0.5f + 0.4f * sinf(h * 0.05f + c) * cosf(w * 0.03f) + 0.05f * noise;
+                }
+    }
+
+    void test_host()
+    {
+        size_t error = 0;
+
+        // Hand-built blocks decode to the spec palettes: 8 values, 6 values plus 0 and 1, SNORM endpoints
+        float texels[16];
+        uint8_t eight[8] = { 255, 0 }, six[8] = { 51, 204 }, snorm[8] = { 0x81, 127 };
+        set_indices(eight);
+        set_indices(six);
+        set_indices(snorm);
+        bc4_decode_block(eight, false, texels);
+        error += texels[0] != 1.0f || texels[1] != 0.0f || fabsf(texels[2] - 6.0f / 7.0f) > 1e-6f || fabsf(texels[7] - 1.0f / 7.0f) > 1e-6f;
+        bc4_decode_block(six, false, texels);
+        error += fabsf(texels[2] - 0.32f) > 1e-6f || fabsf(texels[5] - 0.68f) > 1e-6f || texels[6] != 0.0f || texels[7] != 1.0f;
+        bc4_decode_block(snorm, true, texels);
+        error += texels[0] != -1.0f || texels[1] != 1.0f || texels[6] != -1.0f || texels[7] != 1.0f;
+
+        // A block touching both ends of the range keeps them exact in the 6-value mode
+        for (int t = 0; t < 16; t++)
+            texels[t] = t < 4 ? 0.0f : t < 8 ? 1.0f : 0.3f + 0.01f * t;
+        uint8_t block[8];
+        float decoded[16];
+        bc4_encode_block(texels, false, block);
+        bc4_decode_block(block, false, decoded);
+        for (int t = 0; t < 8; t++)
+            error += decoded[t] != texels[t];
+
+        for (int f = COMPRESSED_BC4_UNORM; f <= COMPRESSED_INT8_TILE; f++) {
+            Compressed_Layout layout;
+            layout.init((Compressed_Format)f, m_channels, m_height, m_width);
+            std::vector<float> src = source(layout);
+            std::vector<unsigned char> data(layout.data_bytes()), serial(layout.data_bytes());
+            std::vector<float> params(layout.param_count()), serial_params(layout.param_count()), out(src.size());
+
+            // Same bytes for any thread count
+            auto start = std::chrono::high_resolution_clock::now();
+            compress(layout, src.data(), data.data(), params.data());
+            double encode_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            compress(layout, src.data(), serial.data(), serial_params.data(), 1);
+            error += data != serial || params != serial_params;
+            decompress(layout, data.data(), params.data(), out.data());
+            Compression_Error e = compression_error(src.data(), out.data(), src.size());
+
+            // Lossy against the source: block formats stay within two 8-bit code steps on this data,
+            // int8 tiles within half a code step of each tile's own range
+            if (layout.block_compressed())
+                error += e.max_abs > 2.0 / (layout.snorm() ? 127.0 : 255.0);
+            else
+                for (size_t i = 0; i < src.size(); i++) {
+                    size_t tile = layout.tiles.locate(i / (m_height * m_width), i / m_width % m_height, i % m_width).tile;
+                    error += fabsf(out[i] - src[i]) > params[2 * tile] / 510.0f + 1e-6f;
+                }
+
+            std::cout << "Compressed format " << format_name(layout.format) << ": " << (double)src.size() * sizeof(float) / (layout.data_bytes() + params.size() * sizeof(float))
+                << "x smaller, max error " << e.max_abs << ", mean error " << e.mean_abs << ", encode "
+                << src.size() * sizeof(float) / (encode_ms * 1000.0) << " MB/s" << std::endl;
+        }
+
+        if (error == 0)
+            std::cout << "Compressed texture host test passed!" << std::endl;
+        else
+            std::cout << "Compressed texture host test failed! Error: " << error << std::endl;
+    }
+protected:
+    // Texel t of the block gets index t % 8
+    static void set_indices(uint8_t block[8])
+    {
+        uint64_t bits = 0;
+        for (int t = 0; t < 16; t++)
+            bits |= (uint64_t)(t % 8) << (3 * t);
+        for (int b = 0; b < 6; b++)
+            block[2 + b] = (uint8_t)(bits >> (8 * b));
+    }
+
+    // The test field, mapped to [-1, 1] for SNORM formats
+    std::vector<float> source(const Compressed_Layout& layout) const
+    {
+        std::vector<float> src = m_dense;
+        if (layout.snorm())
+            for (float& v : src)
+                v = 2.0f * v - 1.0f;
+        return src;
+    }
+
+    static const char* format_name(Compressed_Format format)
+    {
+        switch (format) {
+            case COMPRESSED_BC4_UNORM: return "BC4_UNORM";
+            case COMPRESSED_BC4_SNORM: return "BC4_SNORM";
+            case COMPRESSED_BC5_UNORM: return "BC5_UNORM";
+            case COMPRESSED_BC5_SNORM: return "BC5_SNORM";
+            default: return "INT8_TILE";
+        }
+    }
+
+    size_t m_channels = 0;
+    size_t m_height = 0;
+    size_t m_width = 0;
+    std::vector<float> m_dense;
+};
+
+class Layout_Transform_Host_Tester
+{
+public:
+    void test_host()
+    {
+        size_t error = 0;
+        const size_t channel_counts[5] = { 1, 3, 4, 7, 20 };
+        for (size_t element_size = 1; element_size <= 4; element_size *= 2)
+            for (size_t channels : channel_counts) {
+                // 300 columns cross a transform block boundary
+                const size_t height = 37, width = 300;
+                std::vector<unsigned char> hwc = make_data(element_size, channels * height * width);
+                std::vector<unsigned char> expected = naive_hwc_to_chw(hwc, channels, height, width, element_size);
+                std::vector<unsigned char> chw(hwc.size()), serial(hwc.size()), back(hwc.size());
+                hwc_to_chw(hwc.data(), chw.data(), channels, height, width, element_size);
+                hwc_to_chw(hwc.data(), serial.data(), channels, height, width, element_size, 1);
+                chw_to_hwc(chw.data(), back.data(), channels, height, width, element_size);
+                error += chw != expected || serial != expected || back != hwc;
+            }
+
+        if (error == 0)
+            std::cout << "Layout transform host test passed!" << std::endl;
+        else
+            std::cout << "Layout transform host test failed! Error: " << error << std::endl;
+    }
+
+    // Scalar per-element loops (what upload code did before) against the blocked transforms
+    void benchmark_host(size_t channels, size_t height, size_t width)
+    {
+        for (size_t element_size = 1; element_size <= 4; element_size *= 4) {
+            std::vector<unsigned char> hwc = make_data(element_size, channels * height * width), chw(hwc.size()), back(hwc.size());
+            const double gb = hwc.size() / 1e9;
+
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<unsigned char> naive = naive_hwc_to_chw(hwc, channels, height, width, element_size);
+            double naive_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            start = std::chrono::high_resolution_clock::now();
+            hwc_to_chw(hwc.data(), chw.data(), channels, height, width, element_size, 1);
+            double blocked_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            start = std::chrono::high_resolution_clock::now();
+            hwc_to_chw(hwc.data(), chw.data(), channels, height, width, element_size);
+            double parallel_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            start = std::chrono::high_resolution_clock::now();
+            chw_to_hwc(chw.data(), back.data(), channels, height, width, element_size);
+            double back_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            std::cout << "Layout transform host benchmark " << channels << "x" << height << "x" << width << " " << element_size * 8
+                << "-bit: HWC->CHW scalar " << gb / (naive_ms / 1000.0) << " GB/s, blocked " << gb / (blocked_ms / 1000.0)
+                << " GB/s, blocked parallel " << gb / (parallel_ms / 1000.0) << " GB/s; CHW->HWC blocked parallel "
+                << gb / (back_ms / 1000.0) << " GB/s" << std::endl;
+        }
+    }
+protected:
+    // Values in [0, 1) in the element format (8-bit unorm, half or float), so typed device loads and stores keep every bit
+    static std::vector<unsigned char> make_data(size_t element_size, size_t count)
+    {
+        std::vector<unsigned char> data(count * element_size);
+        uint32_t state = 17u;
+        for (size_t i = 0; i < count; i++) {
+            state = state * 1664525u + 1013904223u;
+            float v = (float)(state >> 8) / 16777216.0f;
+            if (element_size == 1)
+                data[i] = (unsigned char)(state >> 24);
+            else if (element_size == 2)
+                ((uint16_t*)data.data())[i] = float_to_half(v);
+            else
+                ((float*)data.data())[i] = v;
+        }
+        return data;
+    }
+
+    static std::vector<unsigned char> naive_hwc_to_chw(const std::vector<unsigned char>& hwc, size_t channels, size_t height, size_t width, size_t element_size)
+    {
+        std::vector<unsigned char> chw(hwc.size());
+        for (size_t c = 0; c < channels; c++)
+            for (size_t h = 0; h < height; h++)
+                for (size_t w = 0; w < width; w++)
+                    memcpy(&chw[((c * height + h) * width + w) * element_size], &hwc[((h * width + w) * channels + c) * element_size], element_size);
+        return chw;
+    }
+};
+
+class Residency_Host_Tester
+{
+public:
+    void test_host()
+    {
+        size_t error = 0;
+
+        // 503 floats pad to 2048-byte rows and the allocation rounds up to 64KB; staging doubles it
+        Residency_Footprint padded = texture_footprint(3, 250, 503 * sizeof(float), true);
+        error += padded.logical_bytes != 3 * 250 * 503 * sizeof(float) || padded.device_bytes != 24 * 65536 || padded.staging_bytes != padded.device_bytes;
+        error += texture_footprint(1, 4, 100, false, 128).device_bytes != 65536;
+
+        // Five 1MB arrays under a budget of three
+        const size_t array_bytes = 1 << 20;
+        Residency_Footprint one;
+        one.logical_bytes = array_bytes;
+        one.device_bytes = array_bytes;
+        Host_Residency_Backend backend;
+        Residency_Manager manager;
+        manager.init(&backend, 3 * array_bytes);
+        size_t ids[5];
+        for (size_t i = 0; i < 5; i++) {
+            ids[i] = manager.add(("array " + std::to_string(i)).c_str(), one);
+            backend.attach(ids[i], std::vector<unsigned char>(array_bytes, (unsigned char)(i + 1)));
+        }
+        error += resident_set(manager, ids) != "..xxx";
+
+        // Restoring the oldest evicts the least recently used resident one
+        error += !manager.use(ids[0]) || resident_set(manager, ids) != "x..xx" || !holds(backend, ids[0], 1);
+        // Pinned arrays are skipped
+        manager.pin(ids[3], true);
+        error += !manager.use(ids[1]) || resident_set(manager, ids) != "xx.x.";
+        manager.set_budget(2 * array_bytes);
+        error += resident_set(manager, ids) != ".x.x.";
+
+        // Thrash the four unpinned arrays through one free slot; contents survive every round trip
+        for (int round = 0; round < 3; round++)
+            for (size_t i : { 0, 1, 2, 4 })
+                error += !manager.use(ids[i]) || !holds(backend, ids[i], (unsigned char)(i + 1));
+        Residency_Stats s = manager.stats();
+        error += s.used != 2 * array_bytes || s.resident != 2 || s.evicted != 3 || s.host != 3 * array_bytes;
+        error += s.restores != 14 || s.evictions != s.restores + 3;
+
+        // An array larger than the budget cannot be made resident next to the pinned one
+        Residency_Footprint big = one;
+        big.device_bytes = big.logical_bytes = 2 * array_bytes;
+        size_t big_id = manager.add("big", big);
+        error += manager.stats().failures != 1;
+        manager.remove(big_id);
+        manager.remove(ids[3]);
+        error += manager.stats().used != 0 || manager.use(ids[3]);
+
+        if (error == 0)
+            std::cout << "Residency host test passed! " << s.evictions << " evictions, " << s.restores << " restores" << std::endl;
+        else
+            std::cout << "Residency host test failed! Error: " << error << std::endl;
+    }
+protected:
+    // "x" for resident, "." for evicted
+    static std::string resident_set(const Residency_Manager& manager, const size_t* ids)
+    {
+        std::string s;
+        for (size_t i = 0; i < 5; i++)
+            s += manager.resident(ids[i]) ? "x" : ".";
+        return s;
+    }
+
+    static bool holds(const Host_Residency_Backend& backend, size_t id, unsigned char value)
+    {
+        const std::vector<unsigned char>& data = backend.device[id];
+        return !data.empty() && data.front() == value && data.back() == value;
+    }
+};
+
+class Metrics_Host_Tester
+{
+public:
+    void test_host(size_t threads, size_t adds_per_thread)
+    {
+        size_t error = 0;
+        Metrics_Registry registry;
+        const size_t ops = registry.counter("test_ops_total", "Operations");
+        const size_t live = registry.gauge("test_live_items", "Items alive");
+        const size_t latency = registry.histogram("test_latency_microseconds", "Latency", 1.0);
+        error += registry.counter("test_ops_total", "Operations") != ops;
+        error += registry.gauge("test_ops_total", "Operations") != Metrics_Registry::invalid_id;
+
+        // Every thread counts into its own shard; the totals are exact
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++)
+            workers.emplace_back([&, t] {
+                for (size_t i = 0; i < adds_per_thread; i++)
+                    registry.add(ops);
+                registry.add(live, t % 2 ? -1 : 2);
+            });
+        for (std::thread& w : workers)
+            w.join();
+        Metric_Snapshot s;
+        error += !registry.find("test_ops_total", s) || s.value != (int64_t)(threads * adds_per_thread);
+        error += !registry.find("test_live_items", s) || s.value != (int64_t)(threads / 2 + threads % 2);
+
+        // Buckets are (0, 1], (1, 2], (2, 4], ... and +Inf
+        for (double v : { 0.5, 1.0, 1.5, 2.0, 3.0, 1e12 })
+            registry.observe(latency, v);
+        error += !registry.find("test_latency_microseconds", s) || s.count != 6 || s.sum != 0.5 + 1.0 + 1.5 + 2.0 + 3.0 + 1e12;
+        error += s.buckets[0] != 2 || s.buckets[1] != 2 || s.buckets[2] != 1 || s.buckets.back() != 1;
+
+        registry.set_enabled(false);
+        registry.add(ops, 1000);
+        error += !registry.find("test_ops_total", s) || s.value != (int64_t)(threads * adds_per_thread);
+        registry.set_enabled(true);
+
+        const std::string prometheus = registry.to_prometheus();
+        const std::string json = registry.to_json();
+        error += prometheus.find("# TYPE test_ops_total counter\ntest_ops_total " + std::to_string(threads * adds_per_thread) + "\n") == std::string::npos;
+        error += prometheus.find("test_latency_microseconds_bucket{le=\"2\"} 4\n") == std::string::npos;
+        error += prometheus.find("test_latency_microseconds_bucket{le=\"+Inf\"} 6\n") == std::string::npos;
+        error += json.find("\"name\":\"test_live_items\",\"type\":\"gauge\"") == std::string::npos;
+        error += json.find("{\"le\":null,\"count\":1}") == std::string::npos;
+
+        if (error == 0)
+            std::cout << "Metrics host test passed!" << std::endl;
+        else
+            std::cout << "Metrics host test failed! Error: " << error << std::endl;
+    }
+
+    // Recording cost per call, against every thread incrementing one shared atomic
+    void benchmark_host(size_t threads, size_t adds_per_thread)
+    {
+        Metrics_Registry registry;
+        const size_t ops = registry.counter("bench_ops_total", "Operations");
+        const size_t latency = registry.histogram("bench_latency_microseconds", "Latency", 1.0);
+        std::atomic<int64_t> shared(0);
+
+        auto run = [&](const std::function<void(size_t)>& body) {
+            std::vector<std::thread> workers;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t t = 0; t < threads; t++)
+                workers.emplace_back(body, t);
+            for (std::thread& w : workers)
+                w.join();
+            auto end = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration<double, std::nano>(end - start).count() / adds_per_thread;
+        };
+        const double sharded = run([&](size_t) {
+            for (size_t i = 0; i < adds_per_thread; i++)
+                registry.add(ops);
+        });
+        const double contended = run([&](size_t) {
+            for (size_t i = 0; i < adds_per_thread; i++)
+                shared.fetch_add(1, std::memory_order_relaxed);
+        });
+        const double observed = run([&](size_t t) {
+            for (size_t i = 0; i < adds_per_thread; i++)
+                registry.observe(latency, (double)((i + t) & 1023));
+        });
+
+        Metric_Snapshot s;
+        const bool exact = registry.find("bench_ops_total", s) && s.value == shared.load();
+        std::cout << "Metrics benchmark, " << threads << " threads: add " << sharded << " ns, shared atomic " << contended
+            << " ns, observe " << observed << " ns per call per thread" << (exact ? "" : " (totals differ!)") << std::endl;
+    }
+protected:
+    static int64_t value(const char* name)
+    {
+        Metric_Snapshot s;
+        return metrics().find(name, s) ? s.value : 0;
+    }
+};
+
+class Stencil_Host_Tester
+{
+public:
+    void init(size_t channels, size_t height, size_t width)
+    {
+        m_channels = channels;
+        m_height = height;
+        m_width = width;
+        m_data.resize(channels * height * width);
+        uint32_t state = 7;
+        for (float& v : m_data) {
+            state = state * 1664525u + 1013904223u;
+            v = (float)(state >> 8) / (float)(1u << 24);
+        }
+        m_footprints = { Stencil_Footprint::box(1), Stencil_Footprint::box(2, STENCIL_ZERO), Stencil_Footprint::cross(3, STENCIL_WRAP),
+            Stencil_Footprint::quad() };
+        m_names = { "box 3x3 clamp", "box 5x5 zero", "cross 3 wrap", "quad 2x2 wrap" };
+    }
+
+    // The blocked form against the element-at-a-time reference, odd sizes so blocks are cut at every edge
+    void test_host()
+    {
+        size_t error = 0;
+        const size_t c = 2, h = 37, w = 301;
+        std::vector<float> expected(c * h * w), result(c * h * w);
+        for (const Stencil_Footprint& f : m_footprints) {
+            stencil_reference(m_data.data(), expected.data(), c, h, w, f);
+            for (size_t block : { 1, 7, 64 }) {
+                stencil_blocked(m_data.data(), result.data(), c, h, w, f, block, block * 4, 3);
+                error += mismatches(expected, result);
+            }
+        }
+        // Wrap around an axis shorter than the footprint's reach
+        Stencil_Footprint wide = Stencil_Footprint::box(4, STENCIL_WRAP);
+        expected.resize(3 * 5);
+        result.resize(3 * 5);
+        stencil_reference(m_data.data(), expected.data(), 1, 3, 5, wide);
+        stencil_blocked(m_data.data(), result.data(), 1, 3, 5, wide);
+        error += mismatches(expected, result);
+
+        // Defines, and the footprints and tiles that cannot be generated
+        std::vector<std::pair<std::string, std::string>> defines = stencil_defines(Stencil_Footprint::quad(), STENCIL_GROUPSHARED, 16, 16);
+        error += defines.size() != 9 || defines[2].second != "0" || defines[3].second != "1" || defines[6].second != "1"
+            || defines[8].second != "TAP(0, 0, 1) TAP(1, 0, 1) TAP(0, 1, 1) TAP(1, 1, 1) ";
+        error += !stencil_defines(Stencil_Footprint::box(17), STENCIL_DIRECT, 16, 16).empty();
+        error += !stencil_defines(Stencil_Footprint(), STENCIL_DIRECT, 16, 16).empty();
+        error += !stencil_defines(Stencil_Footprint::box(1), STENCIL_DIRECT, 64, 32).empty();
+        error += !stencil_defines(Stencil_Footprint::box(16), STENCIL_GROUPSHARED, 256, 4).empty();
+        error += stencil_defines(Stencil_Footprint::box(16), STENCIL_DIRECT, 256, 4).empty();
+        error += stencil_fetches_per_output(Stencil_Footprint::box(1), STENCIL_DIRECT, 16, 16) != 9.0;
+        error += stencil_fetches_per_output(Stencil_Footprint::box(1), STENCIL_GROUPSHARED, 16, 16) != 18.0 * 18.0 / 256.0;
+
+        // Full-size timing
+        expected.resize(m_data.size());
+        result.resize(m_data.size());
+        for (size_t i = 0; i < m_footprints.size(); i++) {
+            std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+            stencil_reference(m_data.data(), expected.data(), m_channels, m_height, m_width, m_footprints[i]);
+            std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+            const double reference_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+            start = std::chrono::high_resolution_clock::now();
+            stencil_blocked(m_data.data(), result.data(), m_channels, m_height, m_width, m_footprints[i]);
+            stop = std::chrono::high_resolution_clock::now();
+            const double blocked_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+            error += mismatches(expected, result);
+            std::cout << "Stencil " << m_names[i] << " on host: reference " << reference_ms << " ms, blocked " << blocked_ms << " ms" << std::endl;
+        }
+
+        if (error == 0)
+            std::cout << "Stencil host test passed!" << std::endl;
+        else
+            std::cout << "Stencil host test failed! Error: " << error << std::endl;
+    }
+protected:
+    static size_t mismatches(const std::vector<float>& expected, const std::vector<float>& result, float tolerance = 1e-5f)
+    {
+        size_t error = 0;
+        for (size_t k = 0; k < expected.size(); k++)
+            error += std::fabs(expected[k] - result[k]) > tolerance;
+        return error;
+    }
+
+    size_t m_channels = 0;
+    size_t m_height = 0;
+    size_t m_width = 0;
+    std::vector<float> m_data;
+    std::vector<Stencil_Footprint> m_footprints;
+    std::vector<std::string> m_names;
+};
+
+class Kernel_Stats_Host_Tester
+{
+public:
+    void test_host()
+    {
+        size_t error = 0;
+
+        // array_sum's 9x7 groups over 300x200: 34x29 groups, 62118 lanes launched for 60000 pixels,
+        // and each 63-thread group fills two 32-lane waves
+        Kernel_Shape odd = Kernel_Shape::cover(9, 7, 1, 300, 200, 1);
+        error += odd.groups_x != 34 || odd.groups_y != 29 || odd.launched_threads() != 62118;
+        Kernel_Work work;
+        work.bytes_read = 2 * 2 * 60000 * sizeof(float);
+        work.bytes_written = 2 * 60000 * sizeof(float);
+        work.ops = 8 * 2 * 60000;
+        work.elements = 2 * 60000;
+        Device_Peaks peaks;
+        peaks.bandwidth_gbs = 100.0;
+        peaks.gops = 1000.0;
+        Kernel_Metrics m = derive_kernel_metrics(odd, work, 0.1, 62118, peaks);
+        error += !near(m.gbs, 14.4) || !near(m.gops, 9.6) || !near(m.invocations_per_element, 62118.0 / 120000.0);
+        error += !near(m.extent_utilization, 60000.0 / 62118.0) || !near(m.wave_utilization, 63.0 / 64.0);
+        error += !near(m.lane_utilization, 60000.0 / 62118.0 * 63.0 / 64.0);
+        // 0.67 ops per byte is left of the ridge (10): 14.4 of 100 GB/s is latency bound, 72 is memory bound
+        error += m.bound != KERNEL_BOUND_LATENCY || !near(m.roof_gbs, 100.0) || !near(m.roof_fraction, 0.144);
+        error += derive_kernel_metrics(odd, work, 0.02, 62118, peaks).bound != KERNEL_BOUND_MEMORY;
+
+        // 16x16 groups fill whole waves but overhang more: 19x13 groups
+        Kernel_Metrics square = derive_kernel_metrics(Kernel_Shape::cover(16, 16, 1, 300, 200, 1), work, 0.1, 0, peaks);
+        error += square.invocations != 19 * 13 * 256 || square.wave_utilization != 1.0 || !near(square.extent_utilization, 60000.0 / 63232.0);
+
+        // 40 ops per byte is right of the ridge: the roof is 1000 Gops, 25 GB/s at that intensity
+        work.ops = 40 * (work.bytes_read + work.bytes_written);
+        Kernel_Metrics heavy = derive_kernel_metrics(odd, work, 0.072, 0, peaks);
+        error += heavy.bound != KERNEL_BOUND_COMPUTE || !near(heavy.roof_gbs, 25.0) || !near(heavy.roof_fraction, 0.8);
+        error += derive_kernel_metrics(odd, work, 0.1, 0, Device_Peaks()).bound != KERNEL_BOUND_UNKNOWN;
+
+        if (error == 0)
+            std::cout << "Kernel stats host test passed! " << format_kernel_metrics("array_sum 9x7", m) << std::endl;
+        else
+            std::cout << "Kernel stats host test failed! Error: " << error << std::endl;
+    }
+protected:
+    static bool near(double a, double b)
+    {
+        return std::abs(a - b) <= 1e-9 * std::abs(b) + 1e-12;
+    }
+};
+
+class Command_Stream_Host_Tester
+{
+public:
+    // array_sum captured against the host backend, then replayed from the file as is, without transfers, looped and scaled
+    void test_host(size_t channels, size_t height, size_t width)
+    {
+        size_t error = 0;
+        const char* path = "command_stream_test.bin";
+        Host_Command_Backend live;
+        live.register_kernel("shaders/array_sum.hlsl:main", host_array_sum);
+        Command_Recorder recorder;
+        recorder.init(&live);
+        const uint32_t out = capture_array_sum(recorder, channels, height, width);
+        error += !holds(live.downloaded, channels * height * width, expected(1.0f, 2.0f, height, width));
+
+        Command_Recorder sizes_only;
+        sizes_only.init(nullptr, false);
+        capture_array_sum(sizes_only, channels, height, width);
+        Command_Stream loaded;
+        error += !recorder.stream.save(path) || !loaded.load(path) || loaded.commands.size() != recorder.stream.commands.size();
+        error += loaded.serialized_bytes() != recorder.stream.serialized_bytes();
+
+        Replay_Stats stats;
+        Replay_Options options;
+        Host_Command_Backend replayed;
+        replayed.register_kernel("shaders/array_sum.hlsl:main", host_array_sum);
+        error += !replay_commands(loaded, replayed, options, stats) || replayed.downloaded != live.downloaded;
+
+        options.strip_transfers = true;
+        options.loops = 3;
+        Host_Command_Backend stripped;
+        stripped.register_kernel("shaders/array_sum.hlsl:main", host_array_sum);
+        error += !replay_commands(loaded, stripped, options, stats) || stats.executed[CMD_DISPATCH] != 3 || stats.skipped != 3 * 3;
+        // Releases ran, so look at the output through a loop without them
+        Command_Stream kept = loaded;
+        kept.commands.pop_back();
+        kept.commands.pop_back();
+        kept.commands.pop_back();
+        error += !replay_commands(kept, stripped, options, stats) || !stripped.downloaded.empty();
+        error += !holds(stripped.arrays[out].data, channels * height * width, expected(0.0f, 0.0f, height, width));
+        std::cout << "Replay without transfers, 3 loops: " << stats.report();
+
+        options = Replay_Options();
+        options.scale = 2.0;
+        Host_Command_Backend scaled;
+        scaled.register_kernel("shaders/array_sum.hlsl:main", host_array_sum);
+        error += !replay_commands(loaded, scaled, options, stats) || !holds(scaled.downloaded, channels * 4 * height * width, expected(1.0f, 2.0f, 2 * height, 2 * width));
+
+        // A hand-bound dispatch leaves a marker that survives the file and makes replay refuse the stream
+        Command_Recorder marked;
+        marked.init();
+        set_command_capture(&marked);
+        capture_array_sum(marked, channels, height, width);
+        capture_unreplayable_dispatch("Command_Stream_Tester", 4, 2, 1);
+        set_command_capture(nullptr);
+        capture_unreplayable_dispatch("Command_Stream_Tester", 4, 2, 1);
+        Command_Stream marked_loaded;
+        error += !marked.stream.save(path) || !marked_loaded.load(path) || marked_loaded.commands.size() != loaded.commands.size() + 1;
+        error += marked_loaded.commands.back().op != CMD_UNREPLAYABLE_DISPATCH || marked_loaded.commands.back().site != "Command_Stream_Tester";
+        Host_Command_Backend refused;
+        refused.register_kernel("shaders/array_sum.hlsl:main", host_array_sum);
+        error += replay_commands(marked_loaded, refused, Replay_Options(), stats) || stats.failures != 1 || !refused.arrays.empty();
+
+        // A header claiming more commands than the body can hold is refused before anything is allocated
+        Command_Stream forged;
+        error += !recorder.stream.save(path) || !forge_count(path, 0x40000000u) || forged.load(path);
+
+        if (error == 0)
+            std::cout << "Command stream host test passed! " << loaded.commands.size() << " commands, " << recorder.stream.serialized_bytes()
+                << " bytes with payloads, " << sizes_only.stream.serialized_bytes() << " without" << std::endl;
+        else
+            std::cout << "Command stream host test failed! Error: " << error << std::endl;
+        std::remove(path);
+    }
+protected:
+    // array_sum.hlsl on the host; the texture's own dimensions shadow the constant buffer's, as in the shader
+    static bool host_array_sum(const Host_Dispatch& d)
+    {
+        if (d.srv.size() < 2 || !d.srv[0] || !d.srv[1] || d.uav.empty() || !d.uav[0] || d.cb.empty() || !d.cb[0])
+            return false;
+        const float* in0 = (const float*)d.srv[0]->data.data();
+        const float* in1 = (const float*)d.srv[1]->data.data();
+        float* out = (float*)d.uav[0]->data.data();
+        const size_t gx = atoi(d.shader->define("THREAD_GROUP_SIZE_X", "1").c_str());
+        const size_t gy = atoi(d.shader->define("THREAD_GROUP_SIZE_Y", "1").c_str());
+        const unsigned int time_index = *(const unsigned int*)d.cb[0]->data();
+        const Command_Array& a = d.srv[0]->desc;
+        const size_t rows = d.groups[1] * gy < a.height ? d.groups[1] * gy : (size_t)a.height;
+        const size_t cols = d.groups[0] * gx < a.width ? d.groups[0] * gx : (size_t)a.width;
+        for (size_t c = 0; c < a.channels; c++)
+            for (size_t h = 0; h < rows; h++)
+                for (size_t w = 0; w < cols; w++) {
+                    const size_t i = (c * a.height + h) * a.width + w;
+                    out[i] = in0[i] + in1[i] + (float)gx + (float)gy + (float)time_index + (float)a.height + (float)a.width;
+                }
+        return true;
+    }
+
+    // Two inputs of 1 and 2, 9x7 groups, time index 2; returns the output array's id
+    static uint32_t capture_array_sum(Command_Recorder& recorder, size_t channels, size_t height, size_t width)
+    {
+        Command_Array a;
+        a.format = 41;  // DXGI_FORMAT_R32_FLOAT
+        a.element_size = sizeof(float);
+        a.channels = channels;
+        a.height = height;
+        a.width = width;
+        const uint32_t in0 = recorder.create_array(a), in1 = recorder.create_array(a), out = recorder.create_array(a);
+        std::vector<float> ones(channels * height * width, 1.0f), twos(ones.size(), 2.0f);
+        recorder.upload(in0, ones.data(), a.data_bytes());
+        recorder.upload(in1, twos.data(), a.data_bytes());
+
+        Command_Shader s;
+        s.file = "shaders/array_sum.hlsl";
+        s.entry = "main";
+        s.defines = { { "THREAD_GROUP_SIZE_X", "9" }, { "THREAD_GROUP_SIZE_Y", "7" } };
+        const uint32_t shader = recorder.create_shader(s);
+        const int constants[4] = { 2, (int)height, (int)width, 0 };
+        recorder.set_constants(constants, constants, sizeof(constants));
+
+        Command_Dispatch d;
+        d.groups[0] = (uint32_t)(width + 8) / 9;
+        d.groups[1] = (uint32_t)(height + 6) / 7;
+        d.bindings = { { BINDING_SRV, 0, in0 }, { BINDING_SRV, 1, in1 }, { BINDING_UAV, 0, out }, { BINDING_CBV, 0, recorder.find(constants) } };
+        recorder.dispatch(shader, d);
+        recorder.download(out, a.data_bytes());
+        recorder.release_array(in0);
+        recorder.release_array(in1);
+        recorder.release_array(out);
+        return out;
+    }
+
+    static float expected(float a, float b, size_t height, size_t width)
+    {
+        return a + b + 9.0f + 7.0f + 2.0f + (float)height + (float)width;
+    }
+
+    static bool holds(const std::vector<unsigned char>& data, size_t count, float value)
+    {
+        if (data.size() != count * sizeof(float))
+            return false;
+        const float* f = (const float*)data.data();
+        for (size_t i = 0; i < count; i++)
+            if (f[i] != value)
+                return false;
+        return true;
+    }
+
+    // Overwrite the command count after the magic and version; the body crc does not cover it
+    static bool forge_count(const char* path, uint32_t count)
+    {
+        FILE* file = fopen(path, "r+b");
+        if (file == nullptr)
+            return false;
+        const bool ok = fseek(file, 12, SEEK_SET) == 0 && fwrite(&count, sizeof(count), 1, file) == 1;
+        fclose(file);
+        return ok;
+    }
+};
+
+class Benchmark_Host_Tester
+{
+public:
+    // JSON reader, sample statistics and workload expansion, then a small workload on the CPU backend
+    void test_host()
+    {
+        size_t error = 0;
+        Json_Value v;
+        std::string message;
+        error += !json_parse("{ \"a\": [1, -2.5e1, true, null], \"s\": \"x\\n\\u00e9\\ud83d\\ude00\", \"o\": { \"k\": 7 }, \"a\": 3 }", v, message);
+        error += v.get_number("a", 0.0) != 3.0 || v.object.size() != 4 || v.object[0].second.array.size() != 4;
+        error += v.object[0].second.array[1].number != -25.0 || v.object[0].second.array[3].type != JSON_NULL;
+        error += v.get_string("s", "") != "x\n\xc3\xa9\xf0\x9f\x98\x80" || v.find("o")->get_number("k", 0.0) != 7.0;
+        error += json_quote("a\"b\\\n\x01") != "\"a\\\"b\\\\\\n\\u0001\"";
+        const char* malformed[] = { "[1, 2,]", "{\"a\" 1}", "[1", "{} x", "\"\\ud83d\"", "01", "tru", "" };
+        for (const char* text : malformed) {
+            message.clear();
+            error += json_parse(text, v, message) || message.empty();
+        }
+        json_parse("{\n  \"a\": ]\n}", v, message);
+        error += message.compare(0, 4, "2:8:") != 0;
+
+        // 1..10 and a spike: the spike is fenced off, the rest has mean 5.5 and sample stddev sqrt(55 / 6)
+        std::vector<double> samples = { 4, 9, 1, 7, 1000, 2, 10, 5, 3, 8, 6 };
+        Sample_Stats s = summarize_samples(samples, 1.5);
+        const double sd = std::sqrt(55.0 / 6.0);
+        error += s.samples != 11 || s.kept != 10 || s.outliers != 1 || s.max != 10.0 || s.median != 5.5;
+        error += !near(s.mean, 5.5) || !near(s.stddev, sd) || !near(s.ci_high - s.mean, 2.262 * sd / std::sqrt(10.0));
+        error += summarize_samples(samples, 0.0).kept != 11;
+        error += std::abs(student_t_95(200) - 1.9719) > 0.001 || std::abs(student_t_95(31) - 2.0395) > 0.001;
+
+        const char* workload =
+            "{ \"defaults\": { \"warmup\": 2, \"iterations\": 10 },"
+            "  \"workloads\": ["
+            "    { \"name\": \"sum\", \"kernel\": \"array_sum\", \"formats\": [\"R32_FLOAT\", \"R8_UNORM\"], \"shapes\": [[2, 64, 96], [1, 33, 17]],"
+            "      \"defines\": [{ \"THREAD_GROUP_SIZE_X\": 9, \"THREAD_GROUP_SIZE_Y\": 7 }, { \"THREAD_GROUP_SIZE_X\": 16, \"THREAD_GROUP_SIZE_Y\": 16 }] },"
+            "    { \"kernel\": \"upload\", \"formats\": [\"R16_FLOAT\"], \"shapes\": [[3, 250, 503]], \"concurrency\": 4 },"
+            "    { \"kernel\": \"hwc_to_chw\", \"formats\": [\"R8_UNORM\"], \"shapes\": [[3, 128, 128]], \"iterations\": 20 }"
+            "  ] }";
+        std::vector<Benchmark_Case> cases;
+        error += !json_parse(workload, v, message) || !parse_benchmark_workload(v, cases, message) || cases.size() != 2 * 2 * 2 + 1 + 1;
+        if (cases.size() == 10) {
+            error += cases[0].define("THREAD_GROUP_SIZE_X") != "9" || cases[1].define("THREAD_GROUP_SIZE_Y") != "16";
+            error += cases[8].workload != "upload" || cases[8].warmup != 2 || cases[8].concurrency != 4 || cases[9].iterations != 20;
+            error += benchmark_case_bytes(cases[8]) != 4ull * 3 * 250 * 503 * 2;
+        }
+        Json_Value bad;
+        json_parse("{ \"workloads\": [{ \"kernel\": \"fft\", \"formats\": [\"R32_FLOAT\"], \"shapes\": [[1, 1, 1]] }] }", bad, message);
+        error += parse_benchmark_workload(bad, cases, message);
+        std::cout << "Rejected workload: " << message << std::endl;
+        parse_benchmark_workload(v, cases, message);
+
+        // R8_UNORM array_sum has no host kernel and is skipped, the rest runs
+        Host_Benchmark_Backend host;
+        std::vector<Benchmark_Result> results = run_benchmarks(cases, host);
+        for (const Benchmark_Result& r : results) {
+            const bool skip = r.c.kernel == "array_sum" && r.c.format == "R8_UNORM";
+            error += r.status != (skip ? "skipped" : "ok");
+            error += !skip && (r.samples.size() != r.c.iterations || r.stats.kept == 0 || r.gbs <= 0.0);
+        }
+        Json_Value written;
+        error += !json_parse(benchmark_results_json(results), written, message) || written.find("results")->array.size() != results.size();
+
+        if (error == 0)
+            std::cout << "Benchmark host test passed!" << std::endl;
+        else
+            std::cout << "Benchmark host test failed! Error: " << error << std::endl;
+    }
+protected:
+    static bool near(double a, double b)
+    {
+        return std::abs(a - b) <= 1e-9 * std::abs(b) + 1e-12;
+    }
+};
+
+class Atlas_Host_Tester
+{
+public:
+    // count arrays of 1-3 channels and 1-48 x 1-48 elements with random float data and a bias each
+    void init(size_t count)
+    {
+        m_shapes.clear();
+        m_data.clear();
+        m_bias.clear();
+        uint32_t state = 47u;
+        auto next = [&state](uint32_t n) {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) % n;
+        };
+        for (size_t i = 0; i < count; i++) {
+            const size_t shape[3] = { 1 + next(3), 1 + next(48), 1 + next(48) };
+            m_shapes.push_back({ shape[0], shape[1], shape[2] });
+            std::vector<float> data(shape[0] * shape[1] * shape[2]);
+            for (float& v : data)
+                v = (float)next(1000) / 8.0f;
+            m_data.push_back(data);
+            m_bias.push_back((float)i);
+        }
+    }
+
+    // Packing without overlaps, every element in exactly one tile, and the tile list run on the host
+    void test_host()
+    {
+        size_t error = 0;
+        Atlas_Packer packer;
+        packer.init(256, 256, 4, 0, 8);
+        std::vector<uint32_t> ids = allocate(packer);
+        error += ids.size() != m_shapes.size() || !disjoint(packer);
+        std::cout << "Atlas host test, " << ids.size() << " arrays in " << packer.page_count() << " pages of 4x256x256, "
+            << (int)(1000.0 * packer.occupancy()) / 10.0 << "% occupied" << std::endl;
+
+        // Freed space is reused once a slice empties, and a failed allocation leaves nothing behind
+        Atlas_Packer churn;
+        churn.init(64, 64, 2, 1, 1);
+        const uint32_t a = churn.allocate(2, 64, 64);
+        error += a == atlas_invalid_id || churn.allocate(1, 1, 1) != atlas_invalid_id || churn.allocate(1, 65, 1) != atlas_invalid_id;
+        churn.release(a);
+        const uint32_t b = churn.allocate(1, 40, 40), c = churn.allocate(5, 30, 30);
+        error += b == atlas_invalid_id || c != atlas_invalid_id || churn.live_arrays() != 1 || churn.used_slices(0) != 1;
+        error += churn.allocate(2, 24, 64) == atlas_invalid_id || !disjoint(churn);
+
+        // A failed allocation restores the skylines it raised and drops the pages it opened
+        Atlas_Packer undo;
+        undo.init(8, 8, 1, 1, 1);
+        error += undo.allocate(1, 4, 4) == atlas_invalid_id || undo.allocate(2, 4, 8) != atlas_invalid_id;
+        error += undo.allocate(1, 4, 4) == atlas_invalid_id || !disjoint(undo);
+        undo.init(8, 8, 1, 2, 1);
+        error += undo.allocate(1, 4, 4) == atlas_invalid_id || undo.allocate(2, 8, 8) != atlas_invalid_id || undo.page_count() != 1;
+        error += undo.allocate(1, 4, 4) == atlas_invalid_id || undo.page_count() != 1;
+
+        // Tiles cover each element once
+        std::vector<std::vector<Atlas_Tile>> per_page;
+        packer.tiles(ids.data(), ids.size(), 8, 8, per_page);
+        std::vector<std::vector<unsigned char>> seen(ids.size());
+        for (size_t i = 0; i < ids.size(); i++)
+            seen[i].assign(m_data[i].size(), 0);
+        for (const std::vector<Atlas_Tile>& tiles : per_page)
+            run_atlas_tiles(tiles, [&](const Atlas_Tile& t, uint32_t dx, uint32_t dy) {
+                const std::vector<size_t>& s = m_shapes[t.array];
+                seen[t.array][(t.channel * s[1] + t.h0 + dy) * s[2] + t.w0 + dx]++;
+            }, 1);
+        for (const std::vector<unsigned char>& s : seen)
+            for (unsigned char n : s)
+                error += n != 1;
+
+        // Batched sum on host storage, the same tile list the device dispatches
+        Atlas_Storage in_0, in_1, out;
+        in_0.init(sizeof(float));
+        in_1.init(sizeof(float));
+        out.init(sizeof(float));
+        out.sync(packer);
+        for (size_t i = 0; i < ids.size(); i++) {
+            in_0.write(packer, ids[i], m_data[i].data());
+            in_1.write(packer, ids[i], m_data[i].data());
+        }
+        error += in_0.take_dirty(0) == 0 || in_0.take_dirty(0) != 0;
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        for (size_t p = 0; p < per_page.size(); p++)
+            run_atlas_tiles(per_page[p], [&](const Atlas_Tile& t, uint32_t dx, uint32_t dy) {
+                const size_t x = t.x + dx, y = t.y + dy;
+                *(float*)out.element(packer, p, t.slice, y, x) = *(float*)in_0.element(packer, p, t.slice, y, x)
+                    + *(float*)in_1.element(packer, p, t.slice, y, x) + m_bias[t.array];
+            });
+        std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+        error += mismatches(packer, ids, out);
+        std::cout << "Batched host sum over " << ids.size() << " arrays: "
+            << std::chrono::duration<double, std::milli>(stop - start).count() << " ms" << std::endl;
+
+        if (error == 0)
+            std::cout << "Atlas host test passed!" << std::endl;
+        else
+            std::cout << "Atlas host test failed! Error: " << error << std::endl;
+    }
+protected:
+    std::vector<uint32_t> allocate(Atlas_Packer& packer) const
+    {
+        std::vector<uint32_t> ids;
+        for (const std::vector<size_t>& s : m_shapes) {
+            const uint32_t id = packer.allocate(s[0], s[1], s[2]);
+            if (id == atlas_invalid_id)
+                break;
+            ids.push_back(id);
+        }
+        return ids;
+    }
+
+    // Every live rectangle inside its page and no texel claimed twice
+    static bool disjoint(const Atlas_Packer& packer)
+    {
+        const size_t pw = packer.page_width(), ph = packer.page_height(), slices = packer.page_slices();
+        std::vector<std::vector<unsigned char>> claimed(packer.page_count(), std::vector<unsigned char>(slices * ph * pw, 0));
+        for (uint32_t id = 0; id < packer.array_count(); id++) {
+            if (!packer.live(id))
+                continue;
+            for (const Atlas_Rect& r : packer.rects(id)) {
+                if (r.page >= packer.page_count() || r.slice >= slices || r.x + packer.width(id) > pw || r.y + packer.height(id) > ph)
+                    return false;
+                for (size_t y = 0; y < packer.height(id); y++)
+                    for (size_t x = 0; x < packer.width(id); x++)
+                        if (claimed[r.page][(r.slice * ph + r.y + y) * pw + r.x + x]++)
+                            return false;
+            }
+        }
+        return true;
+    }
+
+    size_t mismatches(const Atlas_Packer& packer, const std::vector<uint32_t>& ids, const Atlas_Storage& out) const
+    {
+        size_t error = 0;
+        std::vector<float> result;
+        for (size_t i = 0; i < ids.size(); i++) {
+            result.resize(m_data[i].size());
+            out.read(packer, ids[i], result.data());
+            for (size_t k = 0; k < result.size(); k++)
+                error += result[k] != m_data[i][k] + m_data[i][k] + m_bias[i];
+        }
+        return error;
+    }
+
+    std::vector<std::vector<size_t>> m_shapes;
+    std::vector<std::vector<float>> m_data;
+    std::vector<float> m_bias;
+};
+
+class Format_Traits_Tester
+{
+public:
+    void test_host()
+    {
+        size_t error = 0;
+        error += test_half();
+        error += test_info();
+
+        // pack(unpack(e)) keeps every stored element of the 8-bit and packed formats, unpack(pack(v)) every half
+        error += round_trip<DXGI_FORMAT_R8_UNORM>(0xff);
+        error += round_trip<DXGI_FORMAT_R8G8B8A8_UNORM>(0xffffffffu);
+        error += round_trip<DXGI_FORMAT_R10G10B10A2_UNORM>(0xffffffffu);
+        error += round_trip<DXGI_FORMAT_R16G16_FLOAT>(0x7bff7bffu);
+        float in[4] = { -0.5f, 0.25f, 1.5f, 1.0f }, out[4];
+        format_traits<DXGI_FORMAT_R8G8B8A8_UNORM>::unpack(format_traits<DXGI_FORMAT_R8G8B8A8_UNORM>::pack(in), out);
+        error += out[0] != 0.0f || out[1] != 64.0f / 255.0f || out[2] != 1.0f || out[3] != 1.0f;
+        format_traits<DXGI_FORMAT_R32G32B32A32_FLOAT>::unpack(format_traits<DXGI_FORMAT_R32G32B32A32_FLOAT>::pack(in), out);
+        error += memcmp(in, out, sizeof(in)) != 0;
+
+        error += test_view();
+        error += test_algorithms();
+
+        if (error == 0)
+            std::cout << "Format traits host test passed!" << std::endl;
+        else
+            std::cout << "Format traits host test failed! Error: " << error << std::endl;
+    }
+
+    // Conversion to float of a channels x height x width texture, decoded through a format switch per element
+    // against the typed conversion instantiated for the format
+    void benchmark(size_t channels, size_t height, size_t width)
+    {
+        const size_t count = channels * height * width;
+        std::vector<uint8_t> bytes(count);
+        std::vector<uint16_t> halves(count);
+        uint32_t state = 3u;
+        for (size_t i = 0; i < count; i++) {
+            state = state * 1664525u + 1013904223u;
+            bytes[i] = (uint8_t)(state >> 24);
+            halves[i] = float_to_half((float)(state >> 8) / 16777216.0f);
+        }
+        benchmark_convert(Format_View<DXGI_FORMAT_R8_UNORM>(bytes.data(), channels, height, width));
+        benchmark_convert(Format_View<DXGI_FORMAT_R16_FLOAT>(halves.data(), channels, height, width));
+    }
+
+private:
+    size_t test_half()
+    {
+        size_t error = 0;
+        // Every half but NaNs survives half -> float -> half
+        for (uint32_t h = 0; h < 0x10000; h++) {
+            if ((h & 0x7c00) == 0x7c00 && (h & 0x3ff))
+                continue;
+            error += float_to_half(half_to_float((uint16_t)h)) != h;
+        }
+        error += half_to_float(0x3c00) != 1.0f || half_to_float(0xc000) != -2.0f || half_to_float(0x0001) != 1.0f / 16777216.0f;
+        error += float_to_half(65504.0f) != 0x7bff || float_to_half(65519.0f) != 0x7bff || float_to_half(65520.0f) != 0x7c00;
+        error += float_to_half(1e-8f) != 0 || float_to_half(-1e-8f) != 0x8000;
+        error += (float_to_half(std::nanf("")) & 0x7fff) <= 0x7c00;
+        // Ties go to the even neighbour: 1 + 2^-11 is halfway between 0x3c00 and 0x3c01, 1 + 3 * 2^-11 between 0x3c01 and 0x3c02
+        error += float_to_half(1.0f + 1.0f / 2048.0f) != 0x3c00 || float_to_half(1.0f + 3.0f / 2048.0f) != 0x3c02;
+
+        // Any other float converts to the nearer of the two halves around it
+        uint32_t state = 11u;
+        for (size_t i = 0; i < 100000; i++) {
+            state = state * 1664525u + 1013904223u;
+            const float f = std::ldexp((float)(state >> 8) / 16777216.0f, (int)(state % 40) - 26);
+            const uint16_t h = float_to_half(f);
+            const float d = std::fabs(half_to_float(h) - f);
+            error += h > 0 && std::fabs(half_to_float(h - 1) - f) < d;
+            error += h < 0x7bff && std::fabs(half_to_float(h + 1) - f) < d;
+        }
+        return error;
+    }
+
+    size_t test_info()
+    {
+        const struct { DXGI_FORMAT format; size_t element_size, components, block_dim; } expected[] = {
+            { DXGI_FORMAT_R8_UNORM, 1, 1, 1 }, { DXGI_FORMAT_R8G8B8A8_UNORM, 4, 4, 1 }, { DXGI_FORMAT_R10G10B10A2_UNORM, 4, 4, 1 },
+            { DXGI_FORMAT_R16_FLOAT, 2, 1, 1 }, { DXGI_FORMAT_R16G16_FLOAT, 4, 2, 1 }, { DXGI_FORMAT_R32_FLOAT, 4, 1, 1 },
+            { DXGI_FORMAT_R16G16B16A16_FLOAT, 8, 4, 1 }, { DXGI_FORMAT_R32G32B32A32_FLOAT, 16, 4, 1 }, { DXGI_FORMAT_BC4_UNORM, 8, 1, 4 },
+            { DXGI_FORMAT_BC4_SNORM, 8, 1, 4 }, { DXGI_FORMAT_BC5_UNORM, 16, 2, 4 }, { DXGI_FORMAT_BC5_SNORM, 16, 2, 4 } };
+        size_t error = 0;
+        for (const auto& e : expected) {
+            Format_Info info;
+            error += !format_info(e.format, info);
+            error += info.element_size != e.element_size || info.components != e.components || info.block_dim != e.block_dim;
+        }
+        Format_Info info;
+        error += format_info(DXGI_FORMAT_UNKNOWN, info);
+        return error;
+    }
+
+    // Every stored pattern up to limit (sampled past 2^16) unpacks and packs back unchanged
+    template <DXGI_FORMAT Format>
+    static size_t round_trip(uint32_t limit)
+    {
+        typedef format_traits<Format> traits;
+        size_t error = 0;
+        float value[4];
+        const uint32_t step = limit > 0xffff ? limit / 0xffff : 1;
+        for (uint64_t e = 0; e <= limit; e += step) {
+            // Skip the half NaN and infinity encodings, which do not round-trip bit for bit
+            if (Format == DXGI_FORMAT_R16G16_FLOAT && (((e & 0x7c00) == 0x7c00) || ((e >> 16 & 0x7c00) == 0x7c00)))
+                continue;
+            traits::unpack((typename traits::storage_type)e, value);
+            error += traits::pack(value) != (typename traits::storage_type)e;
+        }
+        return error;
+    }
+
+    // A strided view touches its elements only, in channel, row, column order
+    size_t test_view()
+    {
+        size_t error = 0;
+        const size_t channels = 3, height = 5, width = 7, row_pitch = 9 * sizeof(float), slice_pitch = 6 * row_pitch;
+        std::vector<float> storage(channels * slice_pitch / sizeof(float), -1.0f);
+        Format_View<DXGI_FORMAT_R32_FLOAT> view(storage.data(), channels, height, width, row_pitch, slice_pitch);
+        float next = 0.0f;
+        for (float& v : view)
+            v = next++;
+        error += next != (float)view.size();
+        for (size_t c = 0; c < channels; c++)
+            for (size_t h = 0; h < 6; h++)
+                for (size_t w = 0; w < 9; w++) {
+                    const float v = storage[(c * slice_pitch + h * row_pitch) / sizeof(float) + w];
+                    error += h < height && w < width ? v != (float)((c * height + h) * width + w) : v != -1.0f;
+                }
+        error += std::count_if(view.begin(), view.end(), [](float v) { return v < 0.0f; }) != 0;
+        Format_View<DXGI_FORMAT_R32_FLOAT> empty;
+        error += empty.begin() != empty.end();
+        return error;
+    }
+
+    size_t test_algorithms()
+    {
+        size_t error = 0;
+        const size_t channels = 2, height = 31, width = 17, count = channels * height * width;
+
+        // float -> half -> float rounds like float_to_half, the missing components of a wider format read (0, 0, 0, 1)
+        std::vector<float> source(count), back(count);
+        Format_View<DXGI_FORMAT_R32_FLOAT> src(source.data(), channels, height, width);
+        format_generate(src, [](size_t c, size_t h, size_t w, float* out) {
+            out[0] = 0.01f * (float)((c * 31 + h) * 17 + w) - 3.0f;
+        });
+        std::vector<uint16_t> halves(count);
+        Format_View<DXGI_FORMAT_R16_FLOAT> half(halves.data(), channels, height, width);
+        error += !format_convert(src, half);
+        error += !format_convert(half, Format_View<DXGI_FORMAT_R32_FLOAT>(back.data(), channels, height, width));
+        for (size_t i = 0; i < count; i++)
+            error += back[i] != half_to_float(float_to_half(source[i]));
+        std::vector<Format_Float4> wide(count);
+        error += !format_convert(half, Format_View<DXGI_FORMAT_R32G32B32A32_FLOAT>(wide.data(), channels, height, width));
+        error += wide[5].c[0] != back[5] || wide[5].c[1] != 0.0f || wide[5].c[2] != 0.0f || wide[5].c[3] != 1.0f;
+        error += format_convert(src, Format_View<DXGI_FORMAT_R16_FLOAT>(halves.data(), channels, height, width - 1));
+
+        // Fill, then verify finds exactly the element changed afterwards
+        std::vector<uint32_t> texels(count);
+        Format_View<DXGI_FORMAT_R10G10B10A2_UNORM> rgb10(texels.data(), channels, height, width);
+        const float value[4] = { 0.25f, 0.5f, 1.0f, 1.0f };
+        format_fill(rgb10, value);
+        auto expect = [](size_t, size_t, size_t, float* out) {
+            out[0] = 0.25f;
+            out[1] = 0.5f;
+            out[2] = 1.0f;
+            out[3] = 1.0f;
+        };
+        Format_Error e = format_verify(rgb10, expect, 0.5f / 1023.0f);
+        error += e.mismatches != 0;
+        rgb10.at(1, 30, 16) = 0;
+        e = format_verify(rgb10, expect, 0.5f / 1023.0f);
+        error += e.mismatches != 1 || e.max != 1.0f;
+        return error;
+    }
+
+    template <DXGI_FORMAT Format>
+    static void benchmark_convert(const Format_View<Format>& src)
+    {
+        const size_t count = src.size();
+        std::vector<float> switched(count), typed(count);
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        volatile DXGI_FORMAT format = Format;
+        const DXGI_FORMAT runtime_format = format;
+        for (size_t i = 0; i < count; i++)
+            switched[i] = unpack_switch(runtime_format, src.data, i);
+        std::chrono::high_resolution_clock::time_point stop = std::chrono::high_resolution_clock::now();
+        const double switch_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        format_convert(src, Format_View<DXGI_FORMAT_R32_FLOAT>(typed.data(), src.channels, src.height, src.width));
+        stop = std::chrono::high_resolution_clock::now();
+        const double typed_ms = std::chrono::duration<double, std::milli>(stop - start).count();
+
+        std::cout << "Format conversion of " << count << " " << format_traits<Format>::name << " elements to float: switch per element "
+            << switch_ms << " ms, typed " << typed_ms << " ms" << (switched == typed ? "" : " (results differ!)") << std::endl;
+    }
+
+    // The shape of the code the traits replace: the format decided again for every element
+    static float unpack_switch(DXGI_FORMAT format, const void* data, size_t i)
+    {
+        switch (format) {
+            case DXGI_FORMAT_R8_UNORM:
+                return ((const uint8_t*)data)[i] / 255.0f;
+            case DXGI_FORMAT_R16_FLOAT:
+                return half_to_float(((const uint16_t*)data)[i]);
+            case DXGI_FORMAT_R32_FLOAT:
+                return ((const float*)data)[i];
+            default:
+                return 0.0f;
+        }
+    }
+};
+
+class Submission_Queue_Host_Tester
+{
+public:
+    void test_host()
+    {
+        size_t error = test_queue();
+
+        // Every producer uploads its own buffer, dispatches +1 over it and reads it back; uploads and
+        // dispatches are fire-and-forget, the readback is waited on through a future
+        Host_Submission_Backend backend;
+        backend.init([](const Submission_Packet& p) {
+            std::vector<unsigned char>& buffer = *(std::vector<unsigned char>*)p.resource;
+            for (unsigned char& b : buffer)
+                b++;
+            return true;
+        });
+        Submission_Executor executor;
+        executor.start(&backend, 64, 16);
+        const size_t producers = 8;
+        const size_t iterations = 200;
+        const size_t bytes = 4096;
+        std::vector<std::vector<unsigned char>> buffers(producers, std::vector<unsigned char>(bytes));
+        std::atomic<size_t> completed{ 0 };
+        std::atomic<size_t> wrong{ 0 };
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < producers; t++) {
+            threads.emplace_back([&, t]() {
+                std::vector<unsigned char> src(bytes), dst(bytes);
+                for (size_t i = 0; i < iterations; i++) {
+                    for (size_t j = 0; j < bytes; j++)
+                        src[j] = (unsigned char)(t * 31 + i * 7 + j);
+                    Submission_Packet p;
+                    p.resource = &buffers[t];
+                    p.bytes = bytes;
+                    p.on_complete = [&completed](bool ok) { completed += ok; };
+                    p.op = SUBMIT_UPLOAD;
+                    p.src = src.data();
+                    executor.submit(p);
+                    p.op = SUBMIT_DISPATCH;
+                    executor.submit(p);
+                    p.op = SUBMIT_READBACK;
+                    p.dst = dst.data();
+                    wrong += !executor.submit_future(p).get();
+                    for (size_t j = 0; j < bytes; j++)
+                        wrong += dst[j] != (unsigned char)(src[j] + 1);
+                }
+            });
+        }
+        for (std::thread& th : threads)
+            th.join();
+
+        // A packet the backend cannot run fails without disturbing the rest
+        Submission_Packet bad;
+        bad.op = SUBMIT_UPLOAD;
+        error += executor.submit_future(bad).get();
+        error += !executor.drain();
+        Submission_Stats stats = executor.stop();
+        error += wrong.load() + (completed.load() != producers * iterations * 3);
+        error += stats.packets != producers * iterations * 3 + 2 || stats.failures != 1;
+        error += backend.overlapping_calls() != 0 || backend.calls() != stats.batches;
+        // Refused once stopped, futures included
+        error += executor.submit(bad) || executor.submit_future(bad).get();
+        if (error == 0)
+            std::cout << "Submission queue host test passed! " << stats.packets << " packets from " << producers << " threads in "
+                << stats.batches << " batches (mean " << stats.mean_batch() << ", max " << stats.max_batch << "), owner slept "
+                << stats.owner_sleeps << " times, " << stats.full_retries << " full retries" << std::endl;
+        else
+            std::cout << "Submission queue host test failed! Error: " << error << std::endl;
+    }
+
+    // Workers that prepare a packet (producer_ns of host work) and submit it for kernel_ns of device work,
+    // through the queue and through a global mutex around the backend, at increasing thread counts.
+    // A median queue submit that is not cheaper than the median locked one, which holds the device work, fails.
+    void benchmark(size_t packets_per_thread, double producer_ns, double kernel_ns)
+    {
+        Host_Submission_Backend backend;
+        backend.init([kernel_ns](const Submission_Packet&) {
+            spin_ns(kernel_ns);
+            return true;
+        });
+        std::cout << "Submission of " << packets_per_thread << " packets per thread (" << producer_ns << " ns host work, "
+            << kernel_ns << " ns device work each):" << std::endl;
+        for (size_t thread_count : { 1, 2, 4, 8 }) {
+            std::mutex context_mutex;
+            Result locked = run_producers(thread_count, packets_per_thread, producer_ns, [&](const Submission_Packet& p) {
+                bool ok;
+                std::lock_guard<std::mutex> lock(context_mutex);
+                backend.execute(&p, 1, &ok);
+            }, nullptr);
+
+            Submission_Executor executor;
+            executor.start(&backend, 1024, 64);
+            Result queued = run_producers(thread_count, packets_per_thread, producer_ns, [&](const Submission_Packet& p) {
+                executor.submit(p);
+            }, &executor);
+            Submission_Stats stats = executor.stop();
+
+            std::cout << "    " << thread_count << " threads: mutex " << locked.mpackets_per_s << " Mpackets/s, submit mean "
+                << locked.mean_us << " us, p50 " << locked.p50_us << " us, p99 " << locked.p99_us << " us | queue "
+                << queued.mpackets_per_s << " Mpackets/s, submit mean " << queued.mean_us << " us, p50 " << queued.p50_us
+                << " us, p99 " << queued.p99_us << " us, mean batch " << stats.mean_batch() << " | queue/mutex p50 "
+                << queued.p50_us / locked.p50_us << ", mean " << queued.mean_us / locked.mean_us << std::endl;
+            if (queued.p50_us >= locked.p50_us) {
+                std::cout << "Submission queue benchmark failed! Median submit at " << thread_count << " threads took " << queued.p50_us
+                    << " us through the queue against " << locked.p50_us << " us through the mutex." << std::endl;
+            }
+        }
+    }
+protected:
+    struct Result
+    {
+        double mpackets_per_s = 0.0;
+        double mean_us = 0.0;       // Time inside the submitting call, per packet
+        double p50_us = 0.0;
+        double p99_us = 0.0;
+    };
+
+    static void spin_ns(double ns)
+    {
+        const auto until = std::chrono::high_resolution_clock::now() + std::chrono::nanoseconds((long long)ns);
+        while (std::chrono::high_resolution_clock::now() < until)
+            ;
+    }
+
+    // Producers from several threads into one consumer: nothing lost or duplicated, each producer's items in order,
+    // and the bounded queue reports full instead of growing
+    static size_t test_queue()
+    {
+        size_t error = 0;
+        Mpsc_Queue<uint64_t> queue;
+        queue.init(5);
+        error += queue.capacity() != 8;
+        uint64_t v = 0;
+        for (uint64_t i = 0; i < 8; i++)
+            error += !queue.try_push(i);
+        error += queue.try_push(8);
+        for (uint64_t i = 0; i < 8; i++)
+            error += !queue.try_pop(v) || v != i;
+        error += queue.try_pop(v) || !queue.empty();
+        // Closing fails later pushes but keeps what was already queued
+        error += !queue.try_push(9) || queue.closed();
+        queue.close();
+        error += queue.try_push(10) || !queue.closed() || queue.drained();
+        error += !queue.try_pop(v) || v != 9 || !queue.drained();
+
+        const size_t producers = 4;
+        const uint64_t per_producer = 200000;
+        queue.init(256);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < producers; t++) {
+            threads.emplace_back([&queue, t, per_producer]() {
+                for (uint64_t i = 0; i < per_producer; i++)
+                    while (!queue.try_push((uint64_t)t << 32 | i))
+                        std::this_thread::yield();
+            });
+        }
+        std::vector<uint64_t> next(producers, 0);
+        for (size_t received = 0; received < producers * per_producer;) {
+            if (!queue.try_pop(v))
+                continue;
+            const size_t t = (size_t)(v >> 32);
+            error += t >= producers || (v & 0xffffffffu) != next[t]++;
+            received++;
+        }
+        for (std::thread& th : threads)
+            th.join();
+        error += !queue.empty();
+        return error;
+    }
+
+    static Result run_producers(size_t thread_count, size_t packets_per_thread, double producer_ns,
+        const std::function<void(const Submission_Packet&)>& submit, Submission_Executor* executor)
+    {
+        std::vector<std::vector<double>> latency_us(thread_count, std::vector<double>(packets_per_thread));
+        std::vector<std::thread> threads;
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (size_t t = 0; t < thread_count; t++) {
+            threads.emplace_back([&, t]() {
+                Submission_Packet p;
+                p.op = SUBMIT_DISPATCH;
+                for (size_t i = 0; i < packets_per_thread; i++) {
+                    spin_ns(producer_ns);
+                    const auto t0 = std::chrono::high_resolution_clock::now();
+                    submit(p);
+                    latency_us[t][i] = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - t0).count();
+                }
+            });
+        }
+        for (std::thread& th : threads)
+            th.join();
+        if (executor)
+            executor->drain();
+        const double wall_us = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+
+        std::vector<double> all;
+        for (const std::vector<double>& l : latency_us)
+            all.insert(all.end(), l.begin(), l.end());
+        std::sort(all.begin(), all.end());
+        Result r;
+        for (double l : all)
+            r.mean_us += l;
+        r.mean_us /= all.size();
+        r.p50_us = all[all.size() / 2];
+        r.p99_us = all[all.size() * 99 / 100];
+        r.mpackets_per_s = all.size() / wall_us;
+        return r;
+    }
+};
+
+void run_tile_layout_test();
+void run_stream_executor_host_test();
+void run_transfer_codec_host_test();
+void run_mapped_file_host_test();
+void run_snapshot_host_test();
+void run_pipeline_scheduler_host_test();
+void run_expr_graph_host_test();
+void run_reduction_host_test();
+void run_scan_host_test();
+void run_constant_ring_host_test();
+void run_binding_table_host_test();
+void run_indirect_dispatch_host_test();
+void run_sparse_texture_host_test();
+void run_compressed_texture_host_test();
+void run_layout_transform_host_test();
+void run_residency_host_test();
+void run_metrics_host_test();
+void run_stencil_host_test();
+void run_kernel_stats_host_test();
+void run_command_stream_host_test();
+void run_benchmark_host_test();
+void run_atlas_host_test();
+void run_format_traits_test();
+void run_submission_queue_host_test();
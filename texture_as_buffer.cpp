@@ -1,7 +1,27 @@
 #include "texture_as_buffer.h"
+#include "mapped_file.h"
+#include "layout_transform.h"
+#include "host_parallel.h"
+#include "metrics.h"
+#include "command_stream.h"
+#include "format_traits.h"
 #include <iostream>
 
-void Texture_As_Buffer::init(ID3D11Device* device, size_t __channels, size_t __height, size_t __width, DXGI_FORMAT format)
+// Report a transfer of the texture behind key to the installed capture, if it knows the texture
+static void capture_transfer(const void* key, Command_Op op, const void* data, uint64_t bytes)
+{
+    Command_Recorder* capture = command_capture();
+    const uint32_t id = capture ? capture->find(key) : command_invalid_id;
+    if (id == command_invalid_id)
+        return;
+    if (op == CMD_UPLOAD)
+        capture->upload(id, data, bytes);
+    else
+        capture->download(id, bytes);
+}
+
+void Texture_As_Buffer::init(ID3D11Device* device, size_t __channels, size_t __height, size_t __width, DXGI_FORMAT format,
+    Texture_Layout __layout)
 {   
     if (__channels * __height * __width == 0) {
         std::cout << "Failed to initialize. Channels, Height, Width must be non-zero." << std::endl;
@@ -14,32 +34,38 @@ void Texture_As_Buffer::init(ID3D11Device* device, size_t __channels, size_t __h
     height = __height;
     width = __width;
     channels = __channels;
+    layout = __layout;
+    block_dim = 1;
+
+    Format_Info info;
+    if (!format_info(format, info)) {
+        std::cout << "Failed to initialize. Unrecoginzed format." << std::endl;
+        p_texture = nullptr;
+        p_texture_uav = nullptr;
+        p_texture_srv = nullptr;
+        return;
+    }
+    element_size = info.element_size;
+    block_dim = info.block_dim;
 
-    switch (format) {
-        case DXGI_FORMAT_R8_UNORM:
-            element_size = 1;
-            break;
-        case DXGI_FORMAT_R8G8B8A8_UNORM:
-            element_size = 4;
-            break;
-        case DXGI_FORMAT_R10G10B10A2_UNORM:
-            element_size = 4;
-            break;
-        case DXGI_FORMAT_R16_FLOAT:
-            element_size = 2;
-            break;
-        case DXGI_FORMAT_R16G16_FLOAT:
-            element_size = 4;
-            break;
-        case DXGI_FORMAT_R32_FLOAT:
-            element_size = 4;
-            break;
-        default:
-            std::cout << "Failed to initialize. Unrecoginzed format." << std::endl;
+    if (height % block_dim != 0 || width % block_dim != 0) {
+        std::cout << "Failed to initialize. Block-compressed textures need Height, Width in multiples of " << block_dim << "." << std::endl;
+        p_texture = nullptr;
+        p_texture_uav = nullptr;
+        p_texture_srv = nullptr;
+        return;
+    }
+    const bool block_compressed = block_dim > 1;
+
+    if (layout == TEXTURE_INTERLEAVED) {
+        if (info.components != 4 || info.component_size == 0) {
+            std::cout << "Failed to initialize. Interleaved layout needs a four-component format." << std::endl;
             p_texture = nullptr;
             p_texture_uav = nullptr;
             p_texture_srv = nullptr;
             return;
+        }
+        element_size /= 4;
     }
     
     // Create the texture
@@ -47,11 +73,11 @@ void Texture_As_Buffer::init(ID3D11Device* device, size_t __channels, size_t __h
     tex_desc.Width = (UINT)width;
     tex_desc.Height = (UINT)height;
     tex_desc.MipLevels = 1;
-    tex_desc.ArraySize = (UINT)channels;
+    tex_desc.ArraySize = (UINT)slices();
     tex_desc.Format = format;
     tex_desc.SampleDesc.Count = 1;
     tex_desc.Usage = D3D11_USAGE_DEFAULT;
-    tex_desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+    tex_desc.BindFlags = block_compressed ? D3D11_BIND_SHADER_RESOURCE : D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
     tex_desc.CPUAccessFlags = 0;
     
     if (FAILED(device->CreateTexture2D(&tex_desc, nullptr, &p_texture))) {
@@ -62,14 +88,15 @@ void Texture_As_Buffer::init(ID3D11Device* device, size_t __channels, size_t __h
         return;
     }
 
+    // Hardware decodes block-compressed formats on read only
     D3D11_UNORDERED_ACCESS_VIEW_DESC uav_desc = {};
     uav_desc.Format = format;
     uav_desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2DARRAY;
     uav_desc.Texture2DArray.MipSlice = 0;
     uav_desc.Texture2DArray.FirstArraySlice = 0;
-    uav_desc.Texture2DArray.ArraySize = (UINT)channels;
+    uav_desc.Texture2DArray.ArraySize = (UINT)slices();
                             
-    if (FAILED(device->CreateUnorderedAccessView(p_texture, &uav_desc, &p_texture_uav))) {
+    if (!block_compressed && FAILED(device->CreateUnorderedAccessView(p_texture, &uav_desc, &p_texture_uav))) {
         std::cout << "Failed to create texture UAV." << std::endl;
         p_texture = nullptr;
         p_texture_uav = nullptr;
@@ -82,7 +109,7 @@ void Texture_As_Buffer::init(ID3D11Device* device, size_t __channels, size_t __h
     srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
     srv_desc.Texture2DArray.MipLevels = 1;
     srv_desc.Texture2DArray.FirstArraySlice = 0;
-    srv_desc.Texture2DArray.ArraySize = (UINT)channels;
+    srv_desc.Texture2DArray.ArraySize = (UINT)slices();
     
     if (FAILED(device->CreateShaderResourceView(p_texture, &srv_desc, &p_texture_srv))) {
         std::cout << "Failed to create texture SRV." << std::endl;
@@ -92,6 +119,19 @@ void Texture_As_Buffer::init(ID3D11Device* device, size_t __channels, size_t __h
         return;
     }
 
+    metrics().add(device_metrics().allocated_bytes, (int64_t)texture_bytes());
+    metrics().add(device_metrics().allocations);
+    if (Command_Recorder* capture = command_capture()) {
+        Command_Array a;
+        a.format = (uint32_t)format;
+        a.layout = (uint32_t)layout;
+        a.element_size = (uint32_t)element_size;
+        a.block_dim = (uint32_t)block_dim;
+        a.channels = channels;
+        a.height = height;
+        a.width = width;
+        capture->create_array(a, p_texture);
+    }
     std::cout << "Created texture of shape: " << print_shape() << std::endl;
 }
 
@@ -115,92 +155,335 @@ void Texture_As_Buffer::init_staging(ID3D11Device* device)
         p_texture_staging = nullptr;
         return;
     }
+    metrics().add(device_metrics().allocated_bytes, (int64_t)texture_bytes());
+    metrics().add(device_metrics().allocations);
     
-    data = new unsigned char[channels * height * width * element_size];
+    data = new unsigned char[channels * slice_pitch()];
+}
+
+// Rows of an interleaved slice <-> the planar rows of its (up to) four channels; absent channels are written as zero
+template<typename T>
+static void interleave_row(T* texels, const unsigned char* const planes[4], size_t n_planes, size_t count)
+{
+    for (size_t k = 0; k < 4; k++) {
+        const T* plane = (const T*)planes[k];
+        if (k < n_planes)
+            for (size_t i = 0; i < count; i++)
+                texels[4 * i + k] = plane[i];
+        else
+            for (size_t i = 0; i < count; i++)
+                texels[4 * i + k] = T(0);
+    }
+}
+
+template<typename T>
+static void deinterleave_row(const T* texels, unsigned char* const planes[4], size_t n_planes, size_t count)
+{
+    for (size_t k = 0; k < n_planes; k++) {
+        T* plane = (T*)planes[k];
+        for (size_t i = 0; i < count; i++)
+            plane[i] = texels[4 * i + k];
+    }
+}
+
+// Copy n_rows interleaved rows of slice s from or to the planar host array (one channel every slice_pitch bytes)
+static void interleave_slice(unsigned char* texels, size_t texel_row_pitch, unsigned char* host, size_t row_pitch, size_t slice_pitch,
+    size_t s, size_t n_channels, size_t n_rows, size_t count, size_t element_size, bool to_texels)
+{
+    const size_t n_planes = n_channels - 4 * s < 4 ? n_channels - 4 * s : 4;
+    for (size_t h_idx = 0; h_idx < n_rows; h_idx++) {
+        unsigned char* planes[4] = {};
+        for (size_t k = 0; k < n_planes; k++)
+            planes[k] = host + (4 * s + k) * slice_pitch + h_idx * row_pitch;
+        unsigned char* row = texels + h_idx * texel_row_pitch;
+        switch (element_size) {
+            case 1:
+                to_texels ? interleave_row((uint8_t*)row, planes, n_planes, count) : deinterleave_row((const uint8_t*)row, planes, n_planes, count);
+                break;
+            case 2:
+                to_texels ? interleave_row((uint16_t*)row, planes, n_planes, count) : deinterleave_row((const uint16_t*)row, planes, n_planes, count);
+                break;
+            default:
+                to_texels ? interleave_row((uint32_t*)row, planes, n_planes, count) : deinterleave_row((const uint32_t*)row, planes, n_planes, count);
+                break;
+        }
+    }
+}
+
+void Texture_As_Buffer::release_staging()
+{
+    if (p_texture_staging) {
+        p_texture_staging->Release();
+        metrics().add(device_metrics().allocated_bytes, -(int64_t)texture_bytes());
+    }
+    if (data)
+        delete[] ((unsigned char*)data);
+    p_texture_staging = nullptr;
+    data = nullptr;
+}
+
+size_t Texture_As_Buffer::staging_row_pitch(ID3D11DeviceContext* context)
+{
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    if (p_texture_staging == nullptr || FAILED(context->Map(p_texture_staging, 0, D3D11_MAP_READ, 0, &mapped)))
+        return 0;
+    context->Unmap(p_texture_staging, 0);
+    return mapped.RowPitch;
 }
 
 void* Texture_As_Buffer::to_cpu(ID3D11DeviceContext* context)
 {   
-    if (p_texture_staging == nullptr) {
-        std::cout << "Cannot fetch data to cpu, init_staging() first." << std::endl;
+    if (!to_cpu(context, data, row_pitch(), slice_pitch()))
         return nullptr;
-    }
+    
+    return data;
+}
+
+bool Texture_As_Buffer::to_cpu(ID3D11DeviceContext* context, void *dst, size_t dst_row_pitch, size_t dst_slice_pitch)
+{   
+    begin_to_cpu(context);
+    return end_to_cpu(context, dst, dst_row_pitch, dst_slice_pitch);
+}
+
+void Texture_As_Buffer::begin_to_cpu(ID3D11DeviceContext* context)
+{
+    if (p_texture_staging == nullptr)
+        return;
 
     context->Flush();
     context->CopyResource(p_texture_staging, p_texture);
     context->Flush();
-    
-    // Get the texture description to determine size
-    D3D11_TEXTURE2D_DESC desc;
-    p_texture_staging->GetDesc(&desc);
+}
 
-    // Map the staging buffer
-    D3D11_MAPPED_SUBRESOURCE mapped;
-    if (FAILED(context->Map(p_texture_staging, 0, D3D11_MAP_READ, 0, &mapped))) {
-        std::cout << "Cannot fetch data to cpu, failed to map staging buffer." << std::endl;
-        return nullptr;
+bool Texture_As_Buffer::end_to_cpu(ID3D11DeviceContext* context, void *dst, size_t dst_row_pitch, size_t dst_slice_pitch,
+    size_t copy_channels, size_t copy_height, size_t copy_width)
+{   
+    if (p_texture_staging == nullptr) {
+        std::cout << "Cannot fetch data to cpu, init_staging() first." << std::endl;
+        return false;
     }
+
+    if (dst == nullptr) {
+        std::cout << "Cannot fetch data to cpu, destination is nullptr." << std::endl;
+        return false;
+    }
+
+    const size_t n_channels = (copy_channels == 0 || copy_channels > channels) ? channels : copy_channels;
+    // Rows and columns of blocks for block-compressed formats
+    const size_t n_rows = (((copy_height == 0 || copy_height > height) ? height : copy_height) + block_dim - 1) / block_dim;
+    const size_t row_bytes = (((copy_width == 0 || copy_width > width) ? width : copy_width) + block_dim - 1) / block_dim * element_size;
     
-    // Copy data row by row (handling pitch)
-    const unsigned char* src = static_cast<const unsigned char*>(mapped.pData);
-    const size_t src_row_pitch = mapped.RowPitch;
-    unsigned char* dst = (unsigned char*)data;
-    const size_t dst_row_pitch = desc.Width * element_size;
-            
-    for (UINT row = 0; row < desc.Height * channels; row++)
-        memcpy(dst + row * dst_row_pitch, src + row * src_row_pitch, dst_row_pitch);
-            
-    // Unmap the staging buffer
-    context->Unmap(p_texture_staging, 0);
+    // Each array slice is its own subresource (MipLevels = 1)
+    const size_t n_slices = layout == TEXTURE_INTERLEAVED ? (n_channels + 3) / 4 : n_channels;
+    for (size_t c_idx = 0; c_idx < n_slices; c_idx++) {
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        Metrics_Stopwatch stall;
+        if (FAILED(context->Map(p_texture_staging, (UINT)c_idx, D3D11_MAP_READ, 0, &mapped))) {
+            std::cout << "Cannot fetch data to cpu, failed to map staging buffer." << std::endl;
+            return false;
+        }
+        metrics().observe(device_metrics().map_stall_us, stall.elapsed_us());
+
+        if (layout == TEXTURE_INTERLEAVED) {
+            interleave_slice((unsigned char*)mapped.pData, mapped.RowPitch, (unsigned char*)dst, dst_row_pitch, dst_slice_pitch,
+                c_idx, n_channels, n_rows, row_bytes / element_size, element_size, false);
+            context->Unmap(p_texture_staging, (UINT)c_idx);
+            continue;
+        }
+
+        // Copy data row by row (handling pitch)
+        const unsigned char* src = static_cast<const unsigned char*>(mapped.pData);
+        unsigned char* dst_slice = (unsigned char*)dst + c_idx * dst_slice_pitch;
+        for (size_t h_idx = 0; h_idx < n_rows; h_idx++)
+            memcpy(dst_slice + h_idx * dst_row_pitch, src + h_idx * mapped.RowPitch, row_bytes);
+
+        context->Unmap(p_texture_staging, (UINT)c_idx);
+    }
+    metrics().add(device_metrics().downloads);
+    metrics().add(device_metrics().download_bytes, (int64_t)(n_channels * n_rows * row_bytes));
+    capture_transfer(p_texture, CMD_DOWNLOAD, nullptr, n_channels * n_rows * row_bytes);
     
-    return data;
+    return true;
 }
 
 void Texture_As_Buffer::to_gpu(ID3D11DeviceContext* context, void *data)
+{
+    to_gpu(context, data, row_pitch(), slice_pitch());
+}
+
+void Texture_As_Buffer::to_gpu(ID3D11DeviceContext* context, const void *src, size_t src_row_pitch, size_t src_slice_pitch,
+    size_t copy_channels, size_t copy_height, size_t copy_width)
 {
     if (p_texture_staging == nullptr) {
         std::cout << "Cannot push data to gpu, init_staging() first." << std::endl;
         return;
     }
 
-    if (data == nullptr) {
+    if (src == nullptr) {
         std::cout << "Cannot push data to gpu, data is nullptr." << std::endl;
         return;
     }
     
-    // Get the texture description to determine size
-    D3D11_TEXTURE2D_DESC desc;
-    p_texture_staging->GetDesc(&desc);
+    const size_t n_channels = (copy_channels == 0 || copy_channels > channels) ? channels : copy_channels;
+    // Rows and columns of blocks for block-compressed formats
+    const size_t n_rows = (((copy_height == 0 || copy_height > height) ? height : copy_height) + block_dim - 1) / block_dim;
+    const size_t row_bytes = (((copy_width == 0 || copy_width > width) ? width : copy_width) + block_dim - 1) / block_dim * element_size;
+    
+    // Each array slice is its own subresource (MipLevels = 1)
+    const size_t n_slices = layout == TEXTURE_INTERLEAVED ? (n_channels + 3) / 4 : n_channels;
+    for (size_t c_idx = 0; c_idx < n_slices; c_idx++) {
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        Metrics_Stopwatch stall;
+        if (FAILED(context->Map(p_texture_staging, (UINT)c_idx, D3D11_MAP_WRITE, 0, &mapped))) {
+            std::cout << "Cannot push data to gpu, failed to map staging buffer." << std::endl;
+            return;
+        }
+        metrics().observe(device_metrics().map_stall_us, stall.elapsed_us());
 
-    // Map the staging buffer
-    D3D11_MAPPED_SUBRESOURCE mapped;
-    if (FAILED(context->Map(p_texture_staging, 0, D3D11_MAP_READ, 0, &mapped))) {
-        std::cout << "Cannot fetch data to cpu, failed to map staging buffer." << std::endl;
+        if (layout == TEXTURE_INTERLEAVED) {
+            interleave_slice((unsigned char*)mapped.pData, mapped.RowPitch, (unsigned char*)src, src_row_pitch, src_slice_pitch,
+                c_idx, n_channels, n_rows, row_bytes / element_size, element_size, true);
+            context->Unmap(p_texture_staging, (UINT)c_idx);
+            continue;
+        }
+
+        // Copy data row by row (handling pitch)
+        unsigned char* dst = static_cast<unsigned char*>(mapped.pData);
+        const unsigned char* src_slice = (const unsigned char*)src + c_idx * src_slice_pitch;
+        for (size_t h_idx = 0; h_idx < n_rows; h_idx++)
+            memcpy(dst + h_idx * mapped.RowPitch, src_slice + h_idx * src_row_pitch, row_bytes);
+
+        context->Unmap(p_texture_staging, (UINT)c_idx);
+    }
+    metrics().add(device_metrics().uploads);
+    metrics().add(device_metrics().upload_bytes, (int64_t)(n_channels * n_rows * row_bytes));
+    // The data goes into the capture only when it is the whole array, packed
+    const bool packed = n_channels == channels && n_rows * block_dim == height && row_bytes == row_pitch() &&
+        src_row_pitch == row_pitch() && src_slice_pitch == slice_pitch();
+    capture_transfer(p_texture, CMD_UPLOAD, packed ? src : nullptr, n_channels * n_rows * row_bytes);
+
+    context->Flush();
+    context->CopyResource(p_texture, p_texture_staging);
+    context->Flush();
+}
+
+bool Texture_As_Buffer::map_slices(ID3D11DeviceContext* context, D3D11_MAP map_type, std::vector<D3D11_MAPPED_SUBRESOURCE>& mapped)
+{
+    mapped.assign(slices(), D3D11_MAPPED_SUBRESOURCE());
+    Metrics_Stopwatch stall;
+    for (size_t c_idx = 0; c_idx < mapped.size(); c_idx++)
+        if (FAILED(context->Map(p_texture_staging, (UINT)c_idx, map_type, 0, &mapped[c_idx]))) {
+            for (size_t i = 0; i < c_idx; i++)
+                context->Unmap(p_texture_staging, (UINT)i);
+            return false;
+        }
+    metrics().observe(device_metrics().map_stall_us, stall.elapsed_us());
+    return true;
+}
+
+void Texture_As_Buffer::unmap_slices(ID3D11DeviceContext* context, D3D11_MAP map_type)
+{
+    for (size_t c_idx = 0; c_idx < slices(); c_idx++)
+        context->Unmap(p_texture_staging, (UINT)c_idx);
+    if (map_type != D3D11_MAP_WRITE) {
+        metrics().add(device_metrics().downloads);
+        metrics().add(device_metrics().download_bytes, (int64_t)(channels * slice_pitch()));
+        capture_transfer(p_texture, CMD_DOWNLOAD, nullptr, channels * slice_pitch());
         return;
     }
-    
-    // Copy data row by row (handling pitch)
-    unsigned char* dst = static_cast<unsigned char*>(mapped.pData);
-    const size_t dst_row_pitch = mapped.RowPitch;
-    const unsigned char* src = (const unsigned char*)data;
-    const size_t src_row_pitch = desc.Width * element_size;
-    
-    for (UINT row = 0; row < desc.Height * channels; row++)
-        memcpy(dst + row * dst_row_pitch, src + row * src_row_pitch, src_row_pitch);
-            
-    // Unmap the staging buffer
-    context->Unmap(p_texture_staging, 0);
+    metrics().add(device_metrics().uploads);
+    metrics().add(device_metrics().upload_bytes, (int64_t)(channels * slice_pitch()));
+    capture_transfer(p_texture, CMD_UPLOAD, nullptr, channels * slice_pitch());
 
     context->Flush();
     context->CopyResource(p_texture, p_texture_staging);
     context->Flush();
 }
 
+void Texture_As_Buffer::to_gpu_hwc(ID3D11DeviceContext* context, const void *src, size_t threads)
+{
+    if (p_texture_staging == nullptr || src == nullptr) {
+        std::cout << "Cannot push HWC data to gpu, init_staging() first and pass a host array." << std::endl;
+        return;
+    }
+
+    if (element_size != 1 && element_size != 2 && element_size != 4) {
+        std::cout << "Cannot push HWC data to gpu, elements must be 1, 2 or 4 bytes." << std::endl;
+        return;
+    }
+
+    // Interleaved textures take the planar path through a host transpose
+    if (layout == TEXTURE_INTERLEAVED) {
+        std::vector<unsigned char> planar(channels * slice_pitch());
+        hwc_to_chw(src, planar.data(), channels, height, width, element_size, threads);
+        to_gpu(context, planar.data());
+        return;
+    }
+
+    std::vector<D3D11_MAPPED_SUBRESOURCE> mapped;
+    if (!map_slices(context, D3D11_MAP_WRITE, mapped)) {
+        std::cout << "Cannot push data to gpu, failed to map staging buffer." << std::endl;
+        return;
+    }
+
+    // Each HWC row lands in the same row of every slice
+    parallel_for(height, [&](size_t begin, size_t end) {
+        std::vector<void*> rows(channels);
+        for (size_t h_idx = begin; h_idx < end; h_idx++) {
+            for (size_t c_idx = 0; c_idx < channels; c_idx++)
+                rows[c_idx] = (unsigned char*)mapped[c_idx].pData + h_idx * mapped[c_idx].RowPitch;
+            hwc_row_to_planes((const unsigned char*)src + h_idx * channels * row_pitch(), rows.data(), channels, width, element_size);
+        }
+    }, threads);
+
+    unmap_slices(context, D3D11_MAP_WRITE);
+}
+
+bool Texture_As_Buffer::to_cpu_hwc(ID3D11DeviceContext* context, void *dst, size_t threads)
+{
+    if (p_texture_staging == nullptr || dst == nullptr) {
+        std::cout << "Cannot fetch HWC data to cpu, init_staging() first and pass a host array." << std::endl;
+        return false;
+    }
+
+    if (element_size != 1 && element_size != 2 && element_size != 4) {
+        std::cout << "Cannot fetch HWC data to cpu, elements must be 1, 2 or 4 bytes." << std::endl;
+        return false;
+    }
+
+    if (layout == TEXTURE_INTERLEAVED) {
+        std::vector<unsigned char> planar(channels * slice_pitch());
+        if (!to_cpu(context, planar.data(), row_pitch(), slice_pitch()))
+            return false;
+        chw_to_hwc(planar.data(), dst, channels, height, width, element_size, threads);
+        return true;
+    }
+
+    begin_to_cpu(context);
+    std::vector<D3D11_MAPPED_SUBRESOURCE> mapped;
+    if (!map_slices(context, D3D11_MAP_READ, mapped)) {
+        std::cout << "Cannot fetch data to cpu, failed to map staging buffer." << std::endl;
+        return false;
+    }
+
+    parallel_for(height, [&](size_t begin, size_t end) {
+        std::vector<const void*> rows(channels);
+        for (size_t h_idx = begin; h_idx < end; h_idx++) {
+            for (size_t c_idx = 0; c_idx < channels; c_idx++)
+                rows[c_idx] = (const unsigned char*)mapped[c_idx].pData + h_idx * mapped[c_idx].RowPitch;
+            planes_to_hwc_row(rows.data(), (unsigned char*)dst + h_idx * channels * row_pitch(), channels, width, element_size);
+        }
+    }, threads);
+
+    unmap_slices(context, D3D11_MAP_READ);
+    return true;
+}
+
 void Texture_As_Buffer::to_gpu(ID3D11DeviceContext* context, unsigned char clear_val)
 {
     // Prepare the initialization data
-    unsigned char *init_data = new unsigned char[channels * height * width * element_size];
-    for (int i = 0; i < channels * height * width * element_size; i++)
+    unsigned char *init_data = new unsigned char[channels * slice_pitch()];
+    for (int i = 0; i < channels * slice_pitch(); i++)
         init_data[i] = clear_val;
 
     to_gpu(context, init_data);
@@ -210,24 +493,125 @@ void Texture_As_Buffer::to_gpu(ID3D11DeviceContext* context, unsigned char clear
 void Texture_As_Buffer::to_gpu(ID3D11DeviceContext* context, unsigned int clear_val)
 {
     // Prepare the initialization data
-    unsigned int *init_data = new unsigned int[(channels * height * width * element_size + 3) / 4];
-    for (int i = 0; i < (channels * height * width * element_size + 3) / 4; i++)
+    unsigned int *init_data = new unsigned int[(channels * slice_pitch() + 3) / 4];
+    for (int i = 0; i < (channels * slice_pitch() + 3) / 4; i++)
         init_data[i] = clear_val;
 
     to_gpu(context, init_data);
     delete[] init_data;
 }
 
+// .npy dtype and trailing dimension for a texture format
+static bool npy_descr(DXGI_FORMAT format, std::string& descr, size_t& components)
+{
+    Format_Info info;
+    if (!format_info(format, info) || info.npy_descr[0] == 0)
+        return false;
+    descr = info.npy_descr;
+    components = info.component_size ? info.components : 1;
+    return true;
+}
+
+// .npy dtype and shape of a texture, as save_file() writes them and load_file() expects them
+static bool npy_header(const Texture_As_Buffer& tab, Npy_Header& header)
+{
+    D3D11_TEXTURE2D_DESC desc;
+    tab.p_texture->GetDesc(&desc);
+    size_t components;
+    if (!npy_descr(desc.Format, header.descr, components))
+        return false;
+    // Interleaved textures transfer as planar channels
+    header.shape = { tab.channels, tab.height, tab.width };
+    if (components > 1 && tab.layout == TEXTURE_PLANAR)
+        header.shape.push_back(components);
+    return true;
+}
+
+bool Texture_As_Buffer::load_file(ID3D11DeviceContext* context, const char* path, size_t prefault_threads)
+{
+    if (p_texture_staging == nullptr) {
+        std::cout << "Cannot load file, init_staging() first." << std::endl;
+        return false;
+    }
+
+    Mapped_File file;
+    if (!file.open_read(path))
+        return false;
+
+    const size_t bytes = channels * slice_pitch();
+    size_t offset = 0;
+    if (file.size >= 6 && memcmp(file.data, "\x93NUMPY", 6) == 0) {
+        Npy_Header header;
+        if (!header.parse(file.data, file.size))
+            return false;
+        Npy_Header expected;
+        if (!npy_header(*this, expected)) {
+            std::cout << "Cannot load file, no .npy dtype for texture format." << std::endl;
+            return false;
+        }
+        if (header.descr != expected.descr || header.shape != expected.shape || header.data_bytes() != bytes) {
+            std::cout << "Cannot load file, .npy array " << header.descr << " does not match texture " << expected.descr << " of shape: " << print_shape() << std::endl;
+            return false;
+        }
+        offset = header.data_offset;
+    }
+    else if (file.size != bytes) {
+        std::cout << "Cannot load file, raw size " << file.size << " does not match texture size " << bytes << std::endl;
+        return false;
+    }
+
+    file.advise_sequential();
+    file.prefault(prefault_threads);
+    to_gpu(context, file.data + offset, row_pitch(), slice_pitch());
+    return true;
+}
+
+bool Texture_As_Buffer::save_file(ID3D11DeviceContext* context, const char* path)
+{
+    if (p_texture_staging == nullptr) {
+        std::cout << "Cannot save file, init_staging() first." << std::endl;
+        return false;
+    }
+
+    const size_t bytes = channels * slice_pitch();
+    std::string header_bytes;
+    if (is_npy_path(path)) {
+        Npy_Header header;
+        if (!npy_header(*this, header)) {
+            std::cout << "Cannot save file, no .npy dtype for texture format." << std::endl;
+            return false;
+        }
+        header_bytes = header.format();
+    }
+
+    Mapped_File file;
+    if (!file.create(path, header_bytes.size() + bytes))
+        return false;
+    memcpy(file.data, header_bytes.data(), header_bytes.size());
+    if (!to_cpu(context, file.data + header_bytes.size(), row_pitch(), slice_pitch()))
+        return false;
+    return file.flush();
+}
+
 void Texture_As_Buffer::release()
 {   
     if (p_texture_uav)
         p_texture_uav->Release();
     if (p_texture_srv)
         p_texture_srv->Release();
-    if (p_texture)
+    if (p_texture) {
+        Command_Recorder* capture = command_capture();
+        if (capture && capture->find(p_texture) != command_invalid_id) {
+            capture->release_array(capture->find(p_texture));
+            capture->forget(p_texture);
+        }
         p_texture->Release();
-    if (p_texture_staging)
+        metrics().add(device_metrics().allocated_bytes, -(int64_t)texture_bytes());
+    }
+    if (p_texture_staging) {
         p_texture_staging->Release();
+        metrics().add(device_metrics().allocated_bytes, -(int64_t)texture_bytes());
+    }
     if (data)
         delete[] ((unsigned char*)data);
 
@@ -1,25 +1,46 @@
 #pragma once
 #include <d3d11.h>
 #include <string>
+#include <vector>
 
 /* 
  * Interface for TextureArray and RWTextureArray 
  */
+enum Texture_Layout
+{
+    TEXTURE_PLANAR,         // One array slice per channel
+    TEXTURE_INTERLEAVED     // Four channels per RGBA texel, one array slice per group of four channels
+};
+
 struct Texture_As_Buffer
 {   
     size_t channels = 0;
     size_t height = 0;
     size_t width = 0;
-    size_t element_size = 0;
+    size_t element_size = 0;            // Bytes per element (per channel when interleaved), or per 4x4 block for block-compressed formats
+    Texture_Layout layout = TEXTURE_PLANAR;
     ID3D11Texture2D* p_texture = nullptr;
-    // Default views (same format as texture)
+    // Default views (same format as texture). Block-compressed formats are read-only and have no UAV.
     ID3D11UnorderedAccessView *p_texture_uav = nullptr;
     ID3D11ShaderResourceView *p_texture_srv = nullptr;
         
-    // Init texture and default views
-    void init(ID3D11Device* device, size_t __channels, size_t __height, size_t __width, DXGI_FORMAT format = DXGI_FORMAT_R8_UNORM);
+    // Init texture and default views. BC4/BC5 formats need height and width in multiples of 4
+    // (see block_compression.h); their raw byte streams are rows of 4x4 blocks.
+    // TEXTURE_INTERLEAVED takes a four-component format (R8G8B8A8_UNORM, R16G16B16A16_FLOAT, R32G32B32A32_FLOAT):
+    // channel c is component c % 4 of slice c / 4, kernels load float4 per texel instead of looping over slices.
+    // Transfers still take planar host arrays and interleave on the way.
+    void init(ID3D11Device* device, size_t __channels, size_t __height, size_t __width, DXGI_FORMAT format = DXGI_FORMAT_R8_UNORM,
+        Texture_Layout __layout = TEXTURE_PLANAR);
     // Init staging textures for host->device and device->host transfer
     void init_staging(ID3D11Device* device);
+    bool has_staging() const
+    {
+        return p_texture_staging != nullptr;
+    }
+    // Free the staging texture and host buffer (e.g. once a read-only input is uploaded), the texture stays
+    void release_staging();
+    // Row pitch the driver gave the staging texture (maps slice 0), 0 without staging
+    size_t staging_row_pitch(ID3D11DeviceContext* context);
     // Fetch data from device and return host pointer
     void* to_cpu(ID3D11DeviceContext* context);
     // Clear device memory per 8-bit (same as memset)
@@ -28,10 +49,45 @@ struct Texture_As_Buffer
     void to_gpu(ID3D11DeviceContext* context, unsigned int clear_val);
     // Update device memory with raw byte stream
     void to_gpu(ID3D11DeviceContext* context, void *data);
+    // Update device memory from a strided host array (pitches in bytes, e.g. a sub-block of a larger array).
+    // Only the leading copy_channels x copy_height x copy_width block is written, 0 means the full extent.
+    void to_gpu(ID3D11DeviceContext* context, const void *src, size_t src_row_pitch, size_t src_slice_pitch,
+        size_t copy_channels = 0, size_t copy_height = 0, size_t copy_width = 0);
+    // Update device memory from a channel-interleaved HWC host array, transposed while it is copied into the staging rows
+    // (1, 2 and 4-byte elements)
+    void to_gpu_hwc(ID3D11DeviceContext* context, const void *src, size_t threads = 0);
+    // Fetch data from device into a channel-interleaved HWC host array
+    bool to_cpu_hwc(ID3D11DeviceContext* context, void *dst, size_t threads = 0);
+    // Fetch data from device into a strided host array (pitches in bytes)
+    bool to_cpu(ID3D11DeviceContext* context, void *dst, size_t dst_row_pitch, size_t dst_slice_pitch);
+    // Split form of to_cpu(): queue the device->staging copy, then later map and copy out
+    // (leading block only, 0 means the full extent) so the host can overlap other work in between
+    void begin_to_cpu(ID3D11DeviceContext* context);
+    bool end_to_cpu(ID3D11DeviceContext* context, void *dst, size_t dst_row_pitch, size_t dst_slice_pitch,
+        size_t copy_channels = 0, size_t copy_height = 0, size_t copy_width = 0);
+    // Update device memory straight from a memory-mapped raw or .npy file (no intermediate heap copy)
+    bool load_file(ID3D11DeviceContext* context, const char* path, size_t prefault_threads = 0);
+    // Fetch data from device straight into a memory-mapped file, written as .npy if the path ends in .npy
+    bool save_file(ID3D11DeviceContext* context, const char* path);
     // Release all memory
     void release();
 
-    std::string print_shape()
+    // Array slices of the texture
+    size_t slices() const
+    {
+        return layout == TEXTURE_INTERLEAVED ? (channels + 3) / 4 : channels;
+    }
+    // Bytes of one packed host row of elements (of blocks for block-compressed formats) and of one channel
+    size_t row_pitch() const
+    {
+        return width / block_dim * element_size;
+    }
+    size_t slice_pitch() const
+    {
+        return height / block_dim * row_pitch();
+    }
+
+    std::string print_shape() const
     {
        return std::to_string(channels) + " " + std::to_string(height) + " " + std::to_string(width);
     }
@@ -41,7 +97,19 @@ struct Texture_As_Buffer
     {
         release();
     }
+    // Map every slice of the staging texture at once (mapped[s] is slice s), false if any map fails. Between
+    // map_slices() and unmap_slices() the rows are plain memory, so a caller sharing the context between threads
+    // only needs its lock around these two calls (and begin_to_cpu() before a read).
+    bool map_slices(ID3D11DeviceContext* context, D3D11_MAP map_type, std::vector<D3D11_MAPPED_SUBRESOURCE>& mapped);
+    // Unmap them and count the transfer; after D3D11_MAP_WRITE the staging copy is also copied into the texture
+    void unmap_slices(ID3D11DeviceContext* context, D3D11_MAP map_type);
 private:
     ID3D11Texture2D* p_texture_staging = nullptr;
+    size_t block_dim = 1;       // 4 for block-compressed formats
+    // Data bytes of the texture (and of its staging copy), as accounted in d3d11_allocated_bytes
+    size_t texture_bytes() const
+    {
+        return slices() * (layout == TEXTURE_INTERLEAVED ? 4 : 1) * slice_pitch();
+    }
     void* data = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "texture_snapshot.h"
+#include <iostream>
+#include <vector>
+
+// Snapshot arrays hold the texture's host layout: for block-compressed formats the
+// elements are 4x4 blocks, so rows and columns count blocks (see row_pitch())
+static size_t snapshot_rows(const Texture_As_Buffer& tab)
+{
+    return tab.slice_pitch() / tab.row_pitch();
+}
+
+static size_t snapshot_columns(const Texture_As_Buffer& tab)
+{
+    return tab.row_pitch() / tab.element_size;
+}
+
+static int find_matching(const Snapshot_Reader& reader, const char* name, Texture_As_Buffer& tab)
+{
+    int array = reader.find(name);
+    if (array < 0) {
+        std::cout << "Snapshot has no array named " << name << std::endl;
+        return -1;
+    }
+
+    const Snapshot_Array_Info& info = reader.info(array);
+    D3D11_TEXTURE2D_DESC desc;
+    tab.p_texture->GetDesc(&desc);
+    if (info.channels != tab.channels || info.height != snapshot_rows(tab) || info.width != snapshot_columns(tab) ||
+        info.element_size != tab.element_size || info.format != (uint32_t)desc.Format) {
+        std::cout << "Snapshot array " << name << " does not match texture of shape: " << tab.print_shape() << std::endl;
+        return -1;
+    }
+    return array;
+}
+
+bool save_snapshot(ID3D11DeviceContext* context, Snapshot_Writer& writer, const char* name, Texture_As_Buffer& tab, size_t tile_height)
+{
+    if (tab.p_texture == nullptr) {
+        std::cout << "Cannot save snapshot, init() texture first." << std::endl;
+        return false;
+    }
+
+    D3D11_TEXTURE2D_DESC desc;
+    tab.p_texture->GetDesc(&desc);
+    int array = writer.add_array(name, (uint32_t)desc.Format, tab.element_size, tab.channels, snapshot_rows(tab), snapshot_columns(tab), tile_height);
+    void* data = tab.to_cpu(context);
+    return array >= 0 && data != nullptr && writer.write_array(array, data);
+}
+
+bool load_snapshot(ID3D11DeviceContext* context, const Snapshot_Reader& reader, const char* name, Texture_As_Buffer& tab)
+{
+    if (tab.p_texture == nullptr) {
+        std::cout << "Cannot load snapshot, init() texture first." << std::endl;
+        return false;
+    }
+
+    int array = find_matching(reader, name, tab);
+    if (array < 0)
+        return false;
+
+    std::vector<unsigned char> data(tab.channels * tab.slice_pitch());
+    if (!reader.read_array(array, data.data()))
+        return false;
+    tab.to_gpu(context, data.data());
+    return true;
+}
+
+bool load_snapshot_tile(ID3D11DeviceContext* context, const Snapshot_Reader& reader, const char* name, Texture_As_Buffer& tab, size_t channel, size_t tile)
+{
+    if (tab.p_texture == nullptr) {
+        std::cout << "Cannot load snapshot, init() texture first." << std::endl;
+        return false;
+    }
+
+    int array = find_matching(reader, name, tab);
+    if (array < 0)
+        return false;
+
+    if (tab.layout != TEXTURE_PLANAR) {
+        std::cout << "Cannot load snapshot tile into an interleaved texture, channels do not map to subresources." << std::endl;
+        return false;
+    }
+
+    const Snapshot_Array_Info& info = reader.info(array);
+    if (channel >= info.channels || tile >= info.tiles_per_channel()) {
+        std::cout << "Cannot load snapshot tile, channel or tile out of range." << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> data(info.tile_rows(tile) * tab.row_pitch());
+    if (!reader.read_chunk(array, channel, tile, data.data()))
+        return false;
+
+    // Array slice c with a single mip is subresource c; the box is in texels, the pitch per row of blocks
+    const size_t block_dim = tab.height / snapshot_rows(tab);
+    const UINT top = (UINT)(tile * info.tile_height * block_dim);
+    D3D11_BOX box = { 0, top, 0, (UINT)tab.width, top + (UINT)(info.tile_rows(tile) * block_dim), 1 };
+    context->UpdateSubresource(tab.p_texture, (UINT)channel, &box, data.data(), (UINT)tab.row_pitch(), 0);
+    return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <d3d11.h>
+#include "texture_as_buffer.h"
+#include "snapshot.h"
+
+// Checkpoint tab under name with tile_height rows per chunk (0 = one chunk per channel). Block-compressed
+// textures are stored as rows of blocks, so tile_height counts block rows for them.
+bool save_snapshot(ID3D11DeviceContext* context, Snapshot_Writer& writer, const char* name, Texture_As_Buffer& tab, size_t tile_height = 0);
+// Restore a whole array, shape and format must match
+bool load_snapshot(ID3D11DeviceContext* context, const Snapshot_Reader& reader, const char* name, Texture_As_Buffer& tab);
+// Restore a single chunk (channel, row band) straight into its subresource, other chunks are not read
+bool load_snapshot_tile(ID3D11DeviceContext* context, const Snapshot_Reader& reader, const char* name, Texture_As_Buffer& tab, size_t channel, size_t tile);
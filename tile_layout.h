@@ -0,0 +1,108 @@
+#pragma once
+#include <cstddef>
+
+/*
+ * Splits a logical (channels, height, width) array into a regular grid of tiles,
+ * each at most (tile_channels, tile_height, tile_width) and, given an element size,
+ * at most max_tile_bytes. Only the last tile along each axis may be smaller.
+ * Host-only, no D3D dependency.
+ */
+struct Tile_Extent
+{
+    size_t c0 = 0, h0 = 0, w0 = 0;              // Logical origin of the tile
+    size_t channels = 0, height = 0, width = 0; // Size of the tile
+};
+
+struct Tile_Address
+{
+    size_t tile = 0;                // Linear tile index
+    size_t c = 0, h = 0, w = 0;     // Coordinates inside the tile
+};
+
+struct Tile_Layout
+{
+    size_t channels = 0;
+    size_t height = 0;
+    size_t width = 0;
+    size_t tile_channels = 0;
+    size_t tile_height = 0;
+    size_t tile_width = 0;
+    size_t tiles_c = 0;
+    size_t tiles_h = 0;
+    size_t tiles_w = 0;
+
+    // Returns false if any dimension or limit is zero, or a single element exceeds max_tile_bytes.
+    // max_tile_bytes = 0 (or element_size = 0) leaves the tile size uncapped.
+    bool init(size_t __channels, size_t __height, size_t __width, size_t max_tile_channels, size_t max_tile_height, size_t max_tile_width,
+        size_t element_size = 0, size_t max_tile_bytes = 0)
+    {
+        if (__channels * __height * __width == 0 || max_tile_channels * max_tile_height * max_tile_width == 0)
+            return false;
+        if (element_size != 0 && max_tile_bytes != 0 && element_size > max_tile_bytes)
+            return false;
+
+        channels = __channels;
+        height = __height;
+        width = __width;
+        tile_channels = channels < max_tile_channels ? channels : max_tile_channels;
+        tile_height = height < max_tile_height ? height : max_tile_height;
+        tile_width = width < max_tile_width ? width : max_tile_width;
+        if (element_size != 0 && max_tile_bytes != 0) {
+            // Give up channels first, then rows, then columns, so tiles keep whole rows and slices where they can
+            if (tile_width * element_size > max_tile_bytes)
+                tile_width = max_tile_bytes / element_size;
+            const size_t row_bytes = tile_width * element_size;
+            if (tile_height * row_bytes > max_tile_bytes)
+                tile_height = max_tile_bytes / row_bytes;
+            const size_t slice_bytes = tile_height * row_bytes;
+            if (tile_channels * slice_bytes > max_tile_bytes)
+                tile_channels = max_tile_bytes / slice_bytes;
+        }
+        tiles_c = (channels + tile_channels - 1) / tile_channels;
+        tiles_h = (height + tile_height - 1) / tile_height;
+        tiles_w = (width + tile_width - 1) / tile_width;
+        return true;
+    }
+
+    size_t tile_count() const
+    {
+        return tiles_c * tiles_h * tiles_w;
+    }
+
+    size_t tile_index(size_t tc, size_t th, size_t tw) const
+    {
+        return (tc * tiles_h + th) * tiles_w + tw;
+    }
+
+    // Logical (c, h, w) -> tile and in-tile coordinates
+    Tile_Address locate(size_t c, size_t h, size_t w) const
+    {
+        Tile_Address addr;
+        addr.tile = tile_index(c / tile_channels, h / tile_height, w / tile_width);
+        addr.c = c % tile_channels;
+        addr.h = h % tile_height;
+        addr.w = w % tile_width;
+        return addr;
+    }
+
+    Tile_Extent extent(size_t tile) const
+    {
+        Tile_Extent ext;
+        size_t tw = tile % tiles_w;
+        size_t th = (tile / tiles_w) % tiles_h;
+        size_t tc = tile / (tiles_w * tiles_h);
+        ext.c0 = tc * tile_channels;
+        ext.h0 = th * tile_height;
+        ext.w0 = tw * tile_width;
+        ext.channels = (ext.c0 + tile_channels <= channels) ? tile_channels : channels - ext.c0;
+        ext.height = (ext.h0 + tile_height <= height) ? tile_height : height - ext.h0;
+        ext.width = (ext.w0 + tile_width <= width) ? tile_width : width - ext.w0;
+        return ext;
+    }
+
+    // Byte offset of a tile's origin inside a dense logical CHW host array
+    size_t host_offset(const Tile_Extent& ext, size_t element_size) const
+    {
+        return ((ext.c0 * height + ext.h0) * width + ext.w0) * element_size;
+    }
+};
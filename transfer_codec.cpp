@@ -0,0 +1,179 @@
+#include "transfer_codec.h"
+#include "host_parallel.h"
+#include <iostream>
+#include <chrono>
+
+static uint32_t word_mask(size_t word_bits)
+{
+    return word_bits == 32 ? 0xffffffffu : ((1u << word_bits) - 1);
+}
+
+// Signed difference of two word_bits words, zigzag encoded
+static inline uint32_t zigzag(uint32_t d, size_t word_bits)
+{
+    int32_t s = (int32_t)(d << (32 - word_bits)) >> (32 - word_bits);
+    return ((uint32_t)s << 1 ^ (uint32_t)(s >> 31)) & word_mask(word_bits);
+}
+
+static inline uint32_t unzigzag(uint32_t z, size_t word_bits)
+{
+    return ((z >> 1) ^ (0u - (z & 1))) & word_mask(word_bits);
+}
+
+static uint32_t bit_width(uint32_t z)
+{
+    uint32_t bits = 0;
+    while (z) {
+        bits++;
+        z >>= 1;
+    }
+    return bits;
+}
+
+// Per-block kernels, instantiated once per word type so the inner loops carry no format switch
+template<typename T>
+static void encode_block_header(const T* src, size_t first, size_t last, uint32_t* entry)
+{
+    const size_t wb = sizeof(T) * 8;
+    // Widest zigzag value has the same bit width as the OR of all of them
+    uint32_t any = 0;
+    for (size_t i = first + 1; i < last; i++)
+        any |= zigzag((uint32_t)src[i] - (uint32_t)src[i - 1], wb);
+    entry[0] = src[first];
+    entry[2] = bit_width(any);
+}
+
+template<typename T>
+static void encode_block_payload(const T* src, size_t first, size_t last, uint32_t bits, uint32_t* dst)
+{
+    const size_t wb = sizeof(T) * 8;
+    size_t bit_offset = 0;
+    for (size_t i = first + 1; i < last; i++, bit_offset += bits) {
+        uint32_t z = zigzag((uint32_t)src[i] - (uint32_t)src[i - 1], wb);
+        size_t shift = bit_offset & 31;
+        dst[bit_offset >> 5] |= z << shift;
+        if (shift + bits > 32)
+            dst[(bit_offset >> 5) + 1] |= z >> (32 - shift);
+    }
+}
+
+template<typename T>
+static void decode_block(const uint32_t* src, uint32_t base, uint32_t bits, size_t first, size_t last, T* dst)
+{
+    const size_t wb = sizeof(T) * 8;
+    const uint32_t mask = bits == 32 ? 0xffffffffu : ((1u << bits) - 1);
+    uint32_t v = base;
+    dst[first] = (T)v;
+    if (bits == 0) {
+        for (size_t i = first + 1; i < last; i++)
+            dst[i] = (T)v;
+        return;
+    }
+    size_t bit_offset = 0;
+    for (size_t i = first + 1; i < last; i++, bit_offset += bits) {
+        size_t shift = bit_offset & 31;
+        uint32_t z = src[bit_offset >> 5] >> shift;
+        if (shift + bits > 32)
+            z |= src[(bit_offset >> 5) + 1] << (32 - shift);
+        v += unzigzag(z & mask, wb);
+        dst[i] = (T)v;
+    }
+}
+
+void Delta_Codec::encode(const void* src, size_t count, std::vector<uint32_t>& stream, Transfer_Codec_Stats* stats) const
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    const size_t blocks = block_count(count);
+    const size_t header = header_words(count);
+    stream.assign(header, 0);
+    // Pass 1: base value and bit width per block
+    parallel_for(blocks, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; b++) {
+            size_t first = b * block_size;
+            size_t last = first + block_size < count ? first + block_size : count;
+            uint32_t* entry = &stream[1 + 3 * b];
+            if (word_bits == 8)
+                encode_block_header((const uint8_t*)src, first, last, entry);
+            else if (word_bits == 16)
+                encode_block_header((const uint16_t*)src, first, last, entry);
+            else
+                encode_block_header((const uint32_t*)src, first, last, entry);
+        }
+    }, threads);
+
+    // Pass 2: payload offsets
+    uint32_t offset = 0;
+    for (size_t b = 0; b < blocks; b++) {
+        stream[1 + 3 * b + 1] = offset;
+        offset += (uint32_t)payload_words(stream[1 + 3 * b + 2]);
+    }
+    stream[0] = offset;
+    stream.resize(header + offset, 0);
+
+    // Pass 3: pack deltas, every block owns whole payload words
+    uint32_t* payload = stream.data() + header;
+    parallel_for(blocks, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; b++) {
+            const uint32_t bits = stream[1 + 3 * b + 2];
+            if (bits == 0)
+                continue;
+            uint32_t* dst = payload + stream[1 + 3 * b + 1];
+            size_t first = b * block_size;
+            size_t last = first + block_size < count ? first + block_size : count;
+            if (word_bits == 8)
+                encode_block_payload((const uint8_t*)src, first, last, bits, dst);
+            else if (word_bits == 16)
+                encode_block_payload((const uint16_t*)src, first, last, bits, dst);
+            else
+                encode_block_payload((const uint32_t*)src, first, last, bits, dst);
+        }
+    }, threads);
+
+    if (stats) {
+        stats->raw_bytes = count * word_bits / 8;
+        stats->compressed_bytes = stream.size() * sizeof(uint32_t);
+        stats->encode_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+}
+
+bool Delta_Codec::decode(const uint32_t* stream, size_t stream_words, size_t count, void* dst, Transfer_Codec_Stats* stats) const
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    const size_t blocks = block_count(count);
+    const size_t header = header_words(count);
+    if (stream_words < header || stream_words < header + stream[0]) {
+        std::cout << "Cannot decode, stream is truncated." << std::endl;
+        return false;
+    }
+
+    // Validate block table before touching the payload
+    for (size_t b = 0; b < blocks; b++) {
+        uint32_t bits = stream[1 + 3 * b + 2];
+        if (bits > word_bits || (size_t)stream[1 + 3 * b + 1] + payload_words(bits) > stream[0]) {
+            std::cout << "Cannot decode, block table is corrupt." << std::endl;
+            return false;
+        }
+    }
+
+    const uint32_t* payload = stream + header;
+    parallel_for(blocks, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; b++) {
+            const uint32_t* entry = stream + 1 + 3 * b;
+            size_t first = b * block_size;
+            size_t last = first + block_size < count ? first + block_size : count;
+            if (word_bits == 8)
+                decode_block(payload + entry[1], entry[0], entry[2], first, last, (uint8_t*)dst);
+            else if (word_bits == 16)
+                decode_block(payload + entry[1], entry[0], entry[2], first, last, (uint16_t*)dst);
+            else
+                decode_block(payload + entry[1], entry[0], entry[2], first, last, (uint32_t*)dst);
+        }
+    }, threads);
+
+    if (stats) {
+        stats->raw_bytes = count * word_bits / 8;
+        stats->compressed_bytes = (header + stream[0]) * sizeof(uint32_t);
+        stats->decode_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+    return true;
+}
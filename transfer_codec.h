@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Delta + bit-packing codec for host<->device transfers of smooth-valued arrays.
+ * Data is a stream of `count` words of word_bits (8, 16 or 32) bits, split into
+ * blocks of block_size words. Within a block each word is stored as the zigzag
+ * encoded difference to its predecessor, packed with the block's maximum bit width.
+ * Blocks are independent so encode/decode run one block per thread (host) or one
+ * thread group per block (shaders/transfer_codec.hlsl, which uses the same layout).
+ *
+ * Stream layout (uint32 words):
+ *   [0]                          payload word count
+ *   [1 + 3 * b + 0]              first word of block b
+ *   [1 + 3 * b + 1]              payload offset of block b (words, from payload start)
+ *   [1 + 3 * b + 2]              bit width of block b
+ *   [1 + 3 * block_count ...]    payload, ceil((block_size - 1) * bits / 32) words per block
+ */
+struct Transfer_Codec_Stats
+{
+    size_t raw_bytes = 0;
+    size_t compressed_bytes = 0;
+    double encode_ms = 0.0;
+    double transfer_ms = 0.0;
+    double decode_ms = 0.0;
+
+    double ratio() const
+    {
+        return compressed_bytes ? (double)raw_bytes / compressed_bytes : 0.0;
+    }
+    // Raw bytes per second through the encoder / decoder
+    double encode_mb_per_s() const
+    {
+        return encode_ms > 0.0 ? raw_bytes / (1024.0 * 1024.0) * 1000.0 / encode_ms : 0.0;
+    }
+    double decode_mb_per_s() const
+    {
+        return decode_ms > 0.0 ? raw_bytes / (1024.0 * 1024.0) * 1000.0 / decode_ms : 0.0;
+    }
+};
+
+struct Delta_Codec
+{
+    static const size_t block_size = 256;
+
+    size_t word_bits = 32;
+    size_t threads = 0;     // 0 = hardware concurrency
+
+    static size_t block_count(size_t count)
+    {
+        return (count + block_size - 1) / block_size;
+    }
+    static size_t header_words(size_t count)
+    {
+        return 1 + 3 * block_count(count);
+    }
+    static size_t payload_words(size_t bits)
+    {
+        return ((block_size - 1) * bits + 31) / 32;
+    }
+    // Upper bound of the stream size for count words
+    size_t max_stream_words(size_t count) const
+    {
+        return header_words(count) + block_count(count) * payload_words(word_bits);
+    }
+
+    // Encode count words from src into stream (resized to the exact stream length)
+    void encode(const void* src, size_t count, std::vector<uint32_t>& stream, Transfer_Codec_Stats* stats = nullptr) const;
+    // Decode count words into dst, returns false if the stream is malformed
+    bool decode(const uint32_t* stream, size_t stream_words, size_t count, void* dst, Transfer_Codec_Stats* stats = nullptr) const;
+};
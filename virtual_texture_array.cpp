@@ -0,0 +1,146 @@
+#include "virtual_texture_array.h"
+#include "metrics.h"
+#include "command_stream.h"
+#include "format_traits.h"
+#include <iostream>
+
+void Virtual_Texture_Array::init(ID3D11Device* device, size_t __channels, size_t __height, size_t __width, DXGI_FORMAT format,
+    size_t max_tile_channels, size_t max_tile_height, size_t max_tile_width, size_t max_tile_bytes)
+{
+    Format_Info info;
+    if (!format_info(format, info)) {
+        std::cout << "Failed to initialize. Unsupported format " << format << "." << std::endl;
+        return;
+    }
+    // Tiles are written through UAVs, which block-compressed textures do not have
+    if (info.block_dim != 1) {
+        std::cout << "Failed to initialize. Block-compressed format " << info.name << " cannot back a virtual texture array." << std::endl;
+        return;
+    }
+    if (!layout.init(__channels, __height, __width, max_tile_channels, max_tile_height, max_tile_width, info.element_size, max_tile_bytes)) {
+        std::cout << "Failed to initialize. Channels, Height, Width and tile limits must be non-zero." << std::endl;
+        return;
+    }
+
+    tiles = new Texture_As_Buffer[layout.tile_count()];
+    for (size_t t = 0; t < layout.tile_count(); t++) {
+        Tile_Extent ext = layout.extent(t);
+        tiles[t].init(device, ext.channels, ext.height, ext.width, format);
+        if (tiles[t].p_texture_uav == nullptr || tiles[t].p_texture_srv == nullptr) {
+            std::cout << "Failed to create tile " << t << " of virtual texture array." << std::endl;
+            release();
+            return;
+        }
+    }
+    element_size = tiles[0].element_size;
+
+    tile_constants.init(device, sizeof(Virtual_Tile_Constants));
+    if (tile_constants.p_buffer == nullptr) {
+        release();
+        return;
+    }
+
+    std::cout << "Created virtual texture array of shape: " << print_shape() << std::endl;
+}
+
+void Virtual_Texture_Array::init_staging(ID3D11Device* device)
+{
+    if (tiles == nullptr) {
+        std::cout << "Cannot create staging textures, init() virtual texture array first." << std::endl;
+        return;
+    }
+
+    for (size_t t = 0; t < layout.tile_count(); t++)
+        tiles[t].init_staging(device);
+
+    data = new unsigned char[layout.channels * layout.height * layout.width * element_size];
+}
+
+void* Virtual_Texture_Array::to_cpu(ID3D11DeviceContext* context)
+{
+    if (data == nullptr) {
+        std::cout << "Cannot fetch data to cpu, init_staging() first." << std::endl;
+        return nullptr;
+    }
+
+    const size_t row_pitch = layout.width * element_size;
+    const size_t slice_pitch = layout.height * row_pitch;
+    for (size_t t = 0; t < layout.tile_count(); t++) {
+        Tile_Extent ext = layout.extent(t);
+        if (!tiles[t].to_cpu(context, (unsigned char*)data + layout.host_offset(ext, element_size), row_pitch, slice_pitch))
+            return nullptr;
+    }
+
+    return data;
+}
+
+void Virtual_Texture_Array::to_gpu(ID3D11DeviceContext* context, const void *src)
+{
+    if (tiles == nullptr) {
+        std::cout << "Cannot push data to gpu, init() virtual texture array first." << std::endl;
+        return;
+    }
+
+    const size_t row_pitch = layout.width * element_size;
+    const size_t slice_pitch = layout.height * row_pitch;
+    for (size_t t = 0; t < layout.tile_count(); t++) {
+        Tile_Extent ext = layout.extent(t);
+        tiles[t].to_gpu(context, (const unsigned char*)src + layout.host_offset(ext, element_size), row_pitch, slice_pitch);
+    }
+}
+
+void Virtual_Texture_Array::dispatch(ID3D11DeviceContext* context, ID3D11ComputeShader* shader, Virtual_Texture_Array* const* inputs, size_t input_count,
+    UINT block_x, UINT block_y, UINT cb_slot)
+{
+    if (tiles == nullptr || shader == nullptr) {
+        std::cout << "Cannot dispatch, virtual texture array or shader not initialized." << std::endl;
+        return;
+    }
+
+    for (size_t k = 0; k < input_count; k++) {
+        const Tile_Layout& in = inputs[k]->layout;
+        if (inputs[k]->tiles == nullptr || in.tile_channels != layout.tile_channels || in.tile_height != layout.tile_height ||
+            in.tile_width != layout.tile_width || in.tile_count() != layout.tile_count()) {
+            std::cout << "Cannot dispatch, input " << k << " does not share the output tiling." << std::endl;
+            return;
+        }
+    }
+
+    context->CSSetShader(shader, nullptr, 0);
+    context->CSSetConstantBuffers(cb_slot, 1, &tile_constants.p_buffer);
+
+    for (size_t t = 0; t < layout.tile_count(); t++) {
+        Tile_Extent ext = layout.extent(t);
+        Virtual_Tile_Constants constants = { (UINT)ext.c0, (UINT)ext.h0, (UINT)ext.w0, 0 };
+        tile_constants.to_gpu(context, &constants);
+
+        for (size_t k = 0; k < input_count; k++)
+            context->CSSetShaderResources((UINT)k, 1, &inputs[k]->tiles[t].p_texture_srv);
+        context->CSSetUnorderedAccessViews(0, 1, &tiles[t].p_texture_uav, nullptr);
+
+        UINT dispatchX = ((UINT)ext.width + block_x - 1) / block_x;
+        UINT dispatchY = ((UINT)ext.height + block_y - 1) / block_y;
+        context->Dispatch(dispatchX, dispatchY, 1);
+        count_dispatch(dispatchX, dispatchY, 1);
+        capture_unreplayable_dispatch("Virtual_Texture_Array::dispatch", dispatchX, dispatchY, 1);
+    }
+
+    // Cleanup - unbind views so tiles can be used as inputs of the next dispatch
+    ID3D11UnorderedAccessView* nullUAV[1] = { nullptr };
+    context->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
+    ID3D11ShaderResourceView* nullSRV[1] = { nullptr };
+    for (size_t k = 0; k < input_count; k++)
+        context->CSSetShaderResources((UINT)k, 1, nullSRV);
+}
+
+void Virtual_Texture_Array::release()
+{
+    if (tiles)
+        delete[] tiles;
+    if (data)
+        delete[] ((unsigned char*)data);
+    tile_constants.release();
+
+    tiles = nullptr;
+    data = nullptr;
+}
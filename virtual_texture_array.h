@@ -0,0 +1,71 @@
+#pragma once
+#include <d3d11.h>
+#include <string>
+#include "texture_as_buffer.h"
+#include "d3d11_helper.h"
+#include "tile_layout.h"
+
+/* 
+ * Per-tile constants bound by Virtual_Texture_Array::dispatch(), layout matches
+ *   cbuffer Tile_Constants { uint tile_c0; uint tile_h0; uint tile_w0; uint tile_pad; };
+ * Kernels add the origin to SV_DispatchThreadID to recover logical coordinates.
+ */
+struct Virtual_Tile_Constants
+{
+    UINT c0;
+    UINT h0;
+    UINT w0;
+    UINT align_padding;
+};
+
+/* 
+ * Logical (channels, height, width) texture array tiled over as many physical
+ * Texture_As_Buffer objects as needed to stay within the D3D11 array-size,
+ * texture-dimension and per-resource size limits. Host data is always dense logical CHW.
+ */
+struct Virtual_Texture_Array
+{
+    Tile_Layout layout;
+    size_t element_size = 0;
+    Texture_As_Buffer* tiles = nullptr;
+
+    // Init physical tiles, limits default to the D3D11 maximums. The byte limit defaults to the
+    // per-resource size every D3D11 device guarantees (the 128 MB term of the resource size expression).
+    void init(ID3D11Device* device, size_t __channels, size_t __height, size_t __width, DXGI_FORMAT format = DXGI_FORMAT_R8_UNORM,
+        size_t max_tile_channels = D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION,
+        size_t max_tile_height = D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION,
+        size_t max_tile_width = D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION,
+        size_t max_tile_bytes = (size_t)D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM << 20);
+    // Init staging textures of every tile and the logical host buffer
+    void init_staging(ID3D11Device* device);
+    // Fetch all tiles from device into the logical host buffer and return it
+    void* to_cpu(ID3D11DeviceContext* context);
+    // Update all tiles from a dense logical CHW byte stream, one tile at a time
+    void to_gpu(ID3D11DeviceContext* context, const void *src);
+    // Dispatch shader once per tile: tile i of inputs[k] is bound to t<k>, tile i of this array
+    // to u0 and its Virtual_Tile_Constants to b<cb_slot>. Inputs must share this array's tiling.
+    void dispatch(ID3D11DeviceContext* context, ID3D11ComputeShader* shader, Virtual_Texture_Array* const* inputs, size_t input_count,
+        UINT block_x, UINT block_y, UINT cb_slot = 1);
+    // Release all memory
+    void release();
+
+    size_t tile_count() const
+    {
+        return tiles ? layout.tile_count() : 0;
+    }
+
+    std::string print_shape()
+    {
+       return std::to_string(layout.channels) + " " + std::to_string(layout.height) + " " + std::to_string(layout.width) +
+           " in " + std::to_string(layout.tiles_c) + "x" + std::to_string(layout.tiles_h) + "x" + std::to_string(layout.tiles_w) + " tiles";
+    }
+
+    // Destructor
+    ~Virtual_Texture_Array()
+    {
+        release();
+    }
+private:
+    D3D11_Constant_Buffer tile_constants;
+    void* data = nullptr;
+};